@@ -0,0 +1,393 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusParallelDeflate.h"
+#include "vtk_zlib.h"
+
+namespace
+{
+  // Number of blocks that are compressed by each worker before the results are written to file.
+  // Limits the memory that is needed for the compressed data.
+  const int BLOCKS_PER_WORKER = 4;
+
+  // Empty final block with fixed Huffman codes, terminates the deflate stream
+  const unsigned char DEFLATE_END_OF_STREAM[2] = { 0x03, 0x00 };
+
+  const unsigned char GZIP_OS_UNKNOWN = 0xFF;
+
+  //----------------------------------------------------------------------------
+  void AppendLittleEndian32(std::vector<unsigned char>& buffer, unsigned long value)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      buffer.push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xFF));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+class PlusParallelDeflate::Worker
+{
+public:
+  Worker() : Initialized(false)
+  {
+    this->Stream.zalloc = Z_NULL;
+    this->Stream.zfree = Z_NULL;
+    this->Stream.opaque = Z_NULL;
+  }
+  ~Worker()
+  {
+    if (this->Initialized)
+    {
+      deflateEnd(&this->Stream);
+    }
+  }
+  z_stream Stream;
+  bool Initialized;
+};
+
+//----------------------------------------------------------------------------
+struct PlusParallelDeflate::CompressedBlock
+{
+  CompressedBlock() : Size(0), Checksum(0), Status(PLUS_SUCCESS) {}
+  std::vector<unsigned char> Data;
+  size_t Size;
+  unsigned long Checksum;
+  PlusStatus Status;
+};
+
+//----------------------------------------------------------------------------
+PlusParallelDeflate::PlusParallelDeflate()
+  : OutputFile(NULL)
+  , Format(ZLIB_STREAM)
+  , NumberOfThreads(0)
+  , CompressionLevel(Z_DEFAULT_COMPRESSION)
+  , HeaderWritten(false)
+  , Checksum(0)
+  , NumberOfCompressedBytes(0)
+  , NumberOfUncompressedBytes(0)
+  , NumberOfBlocks(0)
+  , Threader(vtkSmartPointer<vtkMultiThreader>::New())
+  , PendingBlocks(NULL)
+  , NumberOfPendingBlocks(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusParallelDeflate::~PlusParallelDeflate()
+{
+  this->DeleteWorkers();
+  for (std::vector<CompressedBlock*>::iterator it = this->CompressedBlocks.begin(); it != this->CompressedBlocks.end(); ++it)
+  {
+    delete *it;
+  }
+  this->CompressedBlocks.clear();
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelDeflate::SetNumberOfThreads(int numberOfThreads)
+{
+  this->NumberOfThreads = numberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+int PlusParallelDeflate::GetNumberOfThreads() const
+{
+  return this->NumberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelDeflate::SetCompressionLevel(int level)
+{
+  this->CompressionLevel = level;
+}
+
+//----------------------------------------------------------------------------
+int PlusParallelDeflate::GetCompressionLevel() const
+{
+  return this->CompressionLevel;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusParallelDeflate::BeginStream(FILE* outputFile, StreamFormat format)
+{
+  if (this->IsStreamActive())
+  {
+    LOG_ERROR("Cannot begin a new compression stream, the previous one has not been finished");
+    return PLUS_FAIL;
+  }
+  if (outputFile == NULL)
+  {
+    LOG_ERROR("Cannot begin compression stream, output file is invalid");
+    return PLUS_FAIL;
+  }
+
+  int numberOfWorkers = this->NumberOfThreads > 0 ? this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  if (numberOfWorkers > VTK_MAX_THREADS)
+  {
+    numberOfWorkers = VTK_MAX_THREADS;
+  }
+  for (int workerIndex = 0; workerIndex < numberOfWorkers; ++workerIndex)
+  {
+    Worker* worker = new Worker;
+    this->Workers.push_back(worker);
+    // Raw deflate data: the header and checksum of the whole stream are written by this class
+    int ret = deflateInit2(&worker->Stream, this->CompressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK)
+    {
+      LOG_ERROR("Image compression initialization failed (errorCode=" << ret << ")");
+      this->DeleteWorkers();
+      return PLUS_FAIL;
+    }
+    worker->Initialized = true;
+  }
+  this->Threader->SetNumberOfThreads(numberOfWorkers);
+
+  this->OutputFile = outputFile;
+  this->Format = format;
+  this->HeaderWritten = false;
+  this->Checksum = (format == GZIP_STREAM) ? crc32(0L, Z_NULL, 0) : adler32(0L, Z_NULL, 0);
+  this->NumberOfCompressedBytes = 0;
+  this->NumberOfUncompressedBytes = 0;
+  this->NumberOfBlocks = 0;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusParallelDeflate::WriteBlocks(const std::vector<Block>& blocks, std::vector<unsigned long long>* blockOffsets /*=NULL*/)
+{
+  if (!this->IsStreamActive())
+  {
+    LOG_ERROR("Cannot write compressed blocks, the compression stream has not been started");
+    return PLUS_FAIL;
+  }
+  if (this->WriteHeader() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  const int numberOfWorkers = static_cast<int>(this->Workers.size());
+  const size_t blocksPerRound = numberOfWorkers * BLOCKS_PER_WORKER;
+  while (this->CompressedBlocks.size() < blocksPerRound)
+  {
+    this->CompressedBlocks.push_back(new CompressedBlock);
+  }
+
+  for (size_t firstBlock = 0; firstBlock < blocks.size(); firstBlock += blocksPerRound)
+  {
+    this->PendingBlocks = &blocks[firstBlock];
+    this->NumberOfPendingBlocks = std::min(blocksPerRound, blocks.size() - firstBlock);
+
+    // Compress the blocks in parallel
+    if (numberOfWorkers > 1 && this->NumberOfPendingBlocks > 1)
+    {
+      this->Threader->SetSingleMethod(CompressBlocksThreadFunction, this);
+      this->Threader->SingleMethodExecute();
+    }
+    else
+    {
+      this->CompressPendingBlocks(0, 1);
+    }
+
+    // Write the compressed blocks in the original order
+    for (size_t i = 0; i < this->NumberOfPendingBlocks; ++i)
+    {
+      const CompressedBlock* compressedBlock = this->CompressedBlocks[i];
+      if (compressedBlock->Status != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to compress block " << firstBlock + i);
+        this->PendingBlocks = NULL;
+        this->NumberOfPendingBlocks = 0;
+        return PLUS_FAIL;
+      }
+      if (blockOffsets != NULL)
+      {
+        // The first block includes the stream header
+        blockOffsets->push_back(this->NumberOfBlocks == 0 ? 0 : this->NumberOfCompressedBytes);
+      }
+      if (compressedBlock->Size > 0 && this->WriteToFile(&compressedBlock->Data[0], compressedBlock->Size) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Error writing compressed data into file");
+        this->PendingBlocks = NULL;
+        this->NumberOfPendingBlocks = 0;
+        return PLUS_FAIL;
+      }
+      size_t uncompressedSize = this->PendingBlocks[i].Size;
+      if (this->Format == GZIP_STREAM)
+      {
+        this->Checksum = crc32_combine(this->Checksum, compressedBlock->Checksum, static_cast<z_off_t>(uncompressedSize));
+      }
+      else
+      {
+        this->Checksum = adler32_combine(this->Checksum, compressedBlock->Checksum, static_cast<z_off_t>(uncompressedSize));
+      }
+      this->NumberOfUncompressedBytes += uncompressedSize;
+      ++this->NumberOfBlocks;
+    }
+  }
+
+  this->PendingBlocks = NULL;
+  this->NumberOfPendingBlocks = 0;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusParallelDeflate::EndStream()
+{
+  if (!this->IsStreamActive())
+  {
+    LOG_ERROR("Cannot end compression stream, the stream has not been started");
+    return PLUS_FAIL;
+  }
+  if (this->WriteHeader() != PLUS_SUCCESS)
+  {
+    this->AbortStream();
+    return PLUS_FAIL;
+  }
+
+  std::vector<unsigned char> trailer(DEFLATE_END_OF_STREAM, DEFLATE_END_OF_STREAM + sizeof(DEFLATE_END_OF_STREAM));
+  if (this->Format == GZIP_STREAM)
+  {
+    AppendLittleEndian32(trailer, this->Checksum);
+    // Size of the uncompressed data modulo 2^32
+    AppendLittleEndian32(trailer, static_cast<unsigned long>(this->NumberOfUncompressedBytes & 0xFFFFFFFF));
+  }
+  else
+  {
+    for (int i = 3; i >= 0; --i)
+    {
+      trailer.push_back(static_cast<unsigned char>((this->Checksum >> (8 * i)) & 0xFF));
+    }
+  }
+
+  PlusStatus status = this->WriteToFile(&trailer[0], trailer.size());
+  if (status != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Error writing compressed data into file");
+  }
+  this->AbortStream();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelDeflate::AbortStream()
+{
+  this->DeleteWorkers();
+  this->OutputFile = NULL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusParallelDeflate::WriteHeader()
+{
+  if (this->HeaderWritten)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  std::vector<unsigned char> header;
+  if (this->Format == GZIP_STREAM)
+  {
+    // Magic number, deflate method, no flags, no modification time, no extra flags
+    const unsigned char gzipHeader[] = { 0x1F, 0x8B, Z_DEFLATED, 0, 0, 0, 0, 0, 0, GZIP_OS_UNKNOWN };
+    header.assign(gzipHeader, gzipHeader + sizeof(gzipHeader));
+  }
+  else
+  {
+    // Deflate method with 32K window, and the compression level (informative only)
+    int level = (this->CompressionLevel == Z_DEFAULT_COMPRESSION) ? 6 : this->CompressionLevel;
+    unsigned int levelFlags = (level < 2) ? 0 : (level < 6) ? 1 : (level == 6) ? 2 : 3;
+    unsigned int zlibHeader = ((Z_DEFLATED + ((MAX_WBITS - 8) << 4)) << 8) | (levelFlags << 6);
+    // Check bits: the header must be a multiple of 31
+    zlibHeader += 31 - (zlibHeader % 31);
+    header.push_back(static_cast<unsigned char>(zlibHeader >> 8));
+    header.push_back(static_cast<unsigned char>(zlibHeader & 0xFF));
+  }
+
+  if (this->WriteToFile(&header[0], header.size()) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Error writing compression stream header into file");
+    return PLUS_FAIL;
+  }
+  this->HeaderWritten = true;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusParallelDeflate::WriteToFile(const void* data, size_t size)
+{
+  size_t numberOfBytesWritten = 0;
+  PlusStatus status = PlusCommon::RobustFwrite(this->OutputFile, const_cast<void*>(data), size, numberOfBytesWritten);
+  this->NumberOfCompressedBytes += numberOfBytesWritten;
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelDeflate::DeleteWorkers()
+{
+  for (std::vector<Worker*>::iterator it = this->Workers.begin(); it != this->Workers.end(); ++it)
+  {
+    delete *it;
+  }
+  this->Workers.clear();
+}
+
+//----------------------------------------------------------------------------
+void PlusParallelDeflate::CompressPendingBlocks(int workerIndex, int numberOfWorkers)
+{
+  z_stream& strm = this->Workers[workerIndex]->Stream;
+  for (size_t blockIndex = workerIndex; blockIndex < this->NumberOfPendingBlocks; blockIndex += numberOfWorkers)
+  {
+    const Block& block = this->PendingBlocks[blockIndex];
+    CompressedBlock* compressedBlock = this->CompressedBlocks[blockIndex];
+    compressedBlock->Status = PLUS_FAIL;
+    compressedBlock->Size = 0;
+
+    // Each block is compressed without history, so it can be decompressed independently
+    if (deflateReset(&strm) != Z_OK)
+    {
+      continue;
+    }
+    // Full flush adds an empty stored block, which is not included in the bound
+    size_t maxCompressedSize = deflateBound(&strm, static_cast<uLong>(block.Size)) + 16;
+    if (compressedBlock->Data.size() < maxCompressedSize)
+    {
+      compressedBlock->Data.resize(maxCompressedSize);
+    }
+
+    strm.next_in = static_cast<Bytef*>(const_cast<void*>(block.Data));
+    strm.avail_in = static_cast<uInt>(block.Size);
+    strm.next_out = &compressedBlock->Data[0];
+    strm.avail_out = static_cast<uInt>(compressedBlock->Data.size());
+    // Full flush: all output ends on a byte boundary, so the compressed blocks can be simply concatenated
+    int ret = deflate(&strm, Z_FULL_FLUSH);
+    if ((ret != Z_OK && ret != Z_BUF_ERROR) || strm.avail_in != 0 || strm.avail_out == 0)
+    {
+      continue;
+    }
+    compressedBlock->Size = compressedBlock->Data.size() - strm.avail_out;
+
+    const Bytef* data = static_cast<const Bytef*>(block.Data);
+    if (this->Format == GZIP_STREAM)
+    {
+      compressedBlock->Checksum = crc32(crc32(0L, Z_NULL, 0), data, static_cast<uInt>(block.Size));
+    }
+    else
+    {
+      compressedBlock->Checksum = adler32(adler32(0L, Z_NULL, 0), data, static_cast<uInt>(block.Size));
+    }
+    compressedBlock->Status = PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE PlusParallelDeflate::CompressBlocksThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  PlusParallelDeflate* self = static_cast<PlusParallelDeflate*>(threadInfo->UserData);
+  self->CompressPendingBlocks(threadInfo->ThreadID, threadInfo->NumberOfThreads);
+  return VTK_THREAD_RETURN_VALUE;
+}
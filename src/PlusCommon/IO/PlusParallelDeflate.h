@@ -0,0 +1,136 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PLUSPARALLELDEFLATE_H
+#define __PLUSPARALLELDEFLATE_H
+
+#include "PlusCommon.h"
+#include "vtkPlusCommonExport.h"
+#include "vtkMultiThreader.h"
+#include "vtkSmartPointer.h"
+
+#include <cstdio>
+#include <vector>
+
+/*!
+  \class PlusParallelDeflate
+  \brief Compresses a sequence of data blocks into a single zlib or gzip stream using multiple threads
+
+  Each block is compressed independently (the compression history is not shared between blocks) by a pool of worker
+  threads, and the compressed blocks are written to the output file in their original order. Each compressed block ends
+  on a byte boundary (full flush), so the concatenated blocks form one valid deflate stream. The zlib or gzip header is
+  written before the first block and the checksum of the whole stream is computed by combining the checksums of the blocks.
+
+  The result can be decompressed by any zlib or gzip reader. In addition, each block can be decompressed on its own
+  as raw deflate data (starting at the offset returned by WriteBlocks), which allows random access to the blocks.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusParallelDeflate
+{
+public:
+  enum StreamFormat
+  {
+    ZLIB_STREAM, /*!< zlib header and adler32 checksum (RFC 1950) */
+    GZIP_STREAM /*!< gzip header and crc32 checksum (RFC 1952) */
+  };
+
+  /*! Uncompressed data block */
+  struct Block
+  {
+    Block() : Data(NULL), Size(0) {}
+    Block(const void* data, size_t size) : Data(data), Size(size) {}
+    const void* Data;
+    size_t Size;
+  };
+
+  PlusParallelDeflate();
+  ~PlusParallelDeflate();
+
+  /*! Number of worker threads. 0 means the number of processors. */
+  void SetNumberOfThreads(int numberOfThreads);
+  int GetNumberOfThreads() const;
+
+  /*! zlib compression level (Z_DEFAULT_COMPRESSION or 0-9) */
+  void SetCompressionLevel(int level);
+  int GetCompressionLevel() const;
+
+  /*! Start a new stream that is written to the output file at the current file position */
+  PlusStatus BeginStream(FILE* outputFile, StreamFormat format);
+
+  /*!
+    Compress the blocks and append them to the stream.
+    If blockOffsets is not NULL then the start position of each compressed block (relative to the start of the stream) is appended to it.
+    The first block of the stream starts at position 0, as it includes the stream header.
+  */
+  PlusStatus WriteBlocks(const std::vector<Block>& blocks, std::vector<unsigned long long>* blockOffsets = NULL);
+
+  /*! Write the end of the stream and the checksum. The output file is not closed. */
+  PlusStatus EndStream();
+
+  /*! Release the compression buffers without writing the end of the stream */
+  void AbortStream();
+
+  /*! Returns true between BeginStream and EndStream */
+  bool IsStreamActive() const { return this->OutputFile != NULL; }
+
+  /*! Number of bytes written to the output file since BeginStream */
+  unsigned long long GetNumberOfCompressedBytes() const { return this->NumberOfCompressedBytes; }
+
+  /*! Number of blocks passed to WriteBlocks since BeginStream */
+  unsigned long long GetNumberOfBlocks() const { return this->NumberOfBlocks; }
+
+  /*! Number of bytes passed to WriteBlocks since BeginStream */
+  unsigned long long GetNumberOfUncompressedBytes() const { return this->NumberOfUncompressedBytes; }
+
+protected:
+  class Worker;
+  struct CompressedBlock;
+
+  /*! Compress the pending blocks into CompressedBlocks. Blocks are distributed between the workers in a round-robin manner. */
+  void CompressPendingBlocks(int workerIndex, int numberOfWorkers);
+
+  /*! Write the stream header if it has not been written yet */
+  PlusStatus WriteHeader();
+
+  /*! Write data to the output file and update the compressed byte counter */
+  PlusStatus WriteToFile(const void* data, size_t size);
+
+  /*! Delete the compression states of the workers */
+  void DeleteWorkers();
+
+  static VTK_THREAD_RETURN_TYPE CompressBlocksThreadFunction(void* arg);
+
+  FILE* OutputFile;
+  StreamFormat Format;
+  int NumberOfThreads;
+  int CompressionLevel;
+
+  /*! True if the stream header has been already written */
+  bool HeaderWritten;
+  unsigned long Checksum;
+  unsigned long long NumberOfCompressedBytes;
+  unsigned long long NumberOfUncompressedBytes;
+  unsigned long long NumberOfBlocks;
+
+  vtkSmartPointer<vtkMultiThreader> Threader;
+
+  /*! One compression state per worker thread, kept between WriteBlocks calls */
+  std::vector<Worker*> Workers;
+
+  /*! Output buffers, reused between WriteBlocks calls */
+  std::vector<CompressedBlock*> CompressedBlocks;
+
+  /*! Input of the currently running CompressBlocks call */
+  const Block* PendingBlocks;
+  size_t NumberOfPendingBlocks;
+
+private:
+  PlusParallelDeflate(const PlusParallelDeflate&);  // Not implemented.
+  void operator=(const PlusParallelDeflate&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusMemoryMappedFile.h"
+#include "vtkObjectFactory.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+vtkStandardNewMacro(vtkPlusMemoryMappedFile);
+
+//----------------------------------------------------------------------------
+vtkPlusMemoryMappedFile::vtkPlusMemoryMappedFile()
+  : Data(NULL)
+  , Size(0)
+#ifdef _WIN32
+  , FileHandle(INVALID_HANDLE_VALUE)
+  , MappingHandle(NULL)
+#endif
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusMemoryMappedFile::~vtkPlusMemoryMappedFile()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusMemoryMappedFile::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << this->FileName << std::endl;
+  os << indent << "Size: " << this->Size << std::endl;
+  os << indent << "Open: " << (this->IsOpen() ? "true" : "false") << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMemoryMappedFile::Open(const std::string& filename)
+{
+  this->Close();
+
+#ifdef _WIN32
+  this->FileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (this->FileHandle == INVALID_HANDLE_VALUE)
+  {
+    LOG_ERROR("Failed to open file " << filename << " for memory mapping");
+    return PLUS_FAIL;
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(this->FileHandle, &fileSize) || fileSize.QuadPart <= 0
+      || static_cast<unsigned long long>(fileSize.QuadPart) > static_cast<unsigned long long>(static_cast<SIZE_T>(-1)))
+  {
+    LOG_ERROR("Failed to map file " << filename << " into memory: the file is empty or too large");
+    this->Close();
+    return PLUS_FAIL;
+  }
+  this->MappingHandle = CreateFileMappingA(this->FileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  if (this->MappingHandle == NULL)
+  {
+    LOG_ERROR("Failed to create file mapping for " << filename);
+    this->Close();
+    return PLUS_FAIL;
+  }
+  this->Data = static_cast<unsigned char*>(MapViewOfFile(this->MappingHandle, FILE_MAP_COPY, 0, 0, 0));
+  if (this->Data == NULL)
+  {
+    LOG_ERROR("Failed to map file " << filename << " into memory");
+    this->Close();
+    return PLUS_FAIL;
+  }
+  this->Size = static_cast<unsigned long long>(fileSize.QuadPart);
+#else
+  int fileDescriptor = open(filename.c_str(), O_RDONLY);
+  if (fileDescriptor < 0)
+  {
+    LOG_ERROR("Failed to open file " << filename << " for memory mapping");
+    return PLUS_FAIL;
+  }
+  struct stat fileStatus;
+  if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size <= 0
+      || static_cast<unsigned long long>(fileStatus.st_size) > static_cast<unsigned long long>(static_cast<size_t>(-1)))
+  {
+    LOG_ERROR("Failed to map file " << filename << " into memory: the file is empty or too large");
+    close(fileDescriptor);
+    return PLUS_FAIL;
+  }
+  // Private mapping: writes create private copies of the pages and never reach the file
+  void* data = mmap(NULL, static_cast<size_t>(fileStatus.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0);
+  // the mapping remains valid after the file is closed
+  close(fileDescriptor);
+  if (data == MAP_FAILED)
+  {
+    LOG_ERROR("Failed to map file " << filename << " into memory");
+    return PLUS_FAIL;
+  }
+  this->Data = static_cast<unsigned char*>(data);
+  this->Size = static_cast<unsigned long long>(fileStatus.st_size);
+#endif
+
+  this->FileName = filename;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusMemoryMappedFile::Close()
+{
+#ifdef _WIN32
+  if (this->Data != NULL)
+  {
+    UnmapViewOfFile(this->Data);
+  }
+  if (this->MappingHandle != NULL)
+  {
+    CloseHandle(this->MappingHandle);
+    this->MappingHandle = NULL;
+  }
+  if (this->FileHandle != INVALID_HANDLE_VALUE)
+  {
+    CloseHandle(this->FileHandle);
+    this->FileHandle = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (this->Data != NULL)
+  {
+    munmap(this->Data, static_cast<size_t>(this->Size));
+  }
+#endif
+  this->Data = NULL;
+  this->Size = 0;
+  this->FileName.clear();
+}
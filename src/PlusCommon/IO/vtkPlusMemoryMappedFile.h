@@ -0,0 +1,74 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusMemoryMappedFile_h
+#define __vtkPlusMemoryMappedFile_h
+
+#include "PlusCommon.h"
+#include "vtkPlusCommonExport.h"
+#include "vtkObject.h"
+
+#include <string>
+
+/*!
+  \class vtkPlusMemoryMappedFile
+  \brief Maps the contents of a file into memory for reading
+
+  The file is mapped copy-on-write: the pages are read from the file when they are first accessed, and any
+  modification of the mapped memory only changes a private copy of the page, the file is never modified.
+  Memory used by unmodified pages can be reclaimed by the operating system at any time, so the resident memory
+  size is determined by the pages that are actually accessed and not by the file size.
+
+  The object is reference counted, the mapping is released when the last reference is removed.
+  Images that use the mapped memory as pixel data keep a reference to it (see PlusVideoFrame::SetExternalPixelData).
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport vtkPlusMemoryMappedFile : public vtkObject
+{
+public:
+  static vtkPlusMemoryMappedFile* New();
+  vtkTypeMacro(vtkPlusMemoryMappedFile, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Map the whole file into memory. Fails if the file is empty or cannot be mapped (e.g., it does not fit into the address space). */
+  PlusStatus Open(const std::string& filename);
+
+  /*! Release the mapping. Pointers returned by GetData become invalid. */
+  void Close();
+
+  /*! Returns true if a file is mapped */
+  bool IsOpen() const { return this->Data != NULL; }
+
+  /*! Pointer to the first byte of the mapped file, NULL if no file is mapped */
+  unsigned char* GetData() const { return this->Data; }
+
+  /*! Size of the mapped file in bytes */
+  unsigned long long GetSize() const { return this->Size; }
+
+  /*! Name of the mapped file */
+  const std::string& GetFileName() const { return this->FileName; }
+
+protected:
+  vtkPlusMemoryMappedFile();
+  virtual ~vtkPlusMemoryMappedFile();
+
+  std::string FileName;
+  unsigned char* Data;
+  unsigned long long Size;
+
+#ifdef _WIN32
+  /*! File and file mapping object handles */
+  void* FileHandle;
+  void* MappingHandle;
+#endif
+
+private:
+  vtkPlusMemoryMappedFile(const vtkPlusMemoryMappedFile&);  // Not implemented.
+  void operator=(const vtkPlusMemoryMappedFile&);  // Not implemented.
+};
+
+#endif
@@ -7,6 +7,9 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "itksys/SystemTools.hxx"
 #include "vtkPlusMetaImageSequenceIO.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <vector>
@@ -21,6 +24,7 @@ See License.txt for details.
 
 #include "vtksys/SystemTools.hxx"
 #include "vtkObjectFactory.h"
+#include "vtkPlusMemoryMappedFile.h"
 #include "vtkPlusTrackedFrameList.h"
 #include "PlusTrackedFrame.h"
 
@@ -58,9 +62,136 @@ namespace
   static const char* SEQMETA_FIELD_DIMSIZE = "DimSize";
   static const char* SEQMETA_FIELD_KINDS = "Kinds";
   static const char* SEQMETA_FIELD_COMPRESSED_DATA_SIZE = "CompressedDataSize";
+  static const char* SEQMETA_FIELD_COMPRESSED_DATA_FRAME_INDEX = "CompressedDataFrameIndex";
+
+  // Each entry of the compressed frame index is stored as a 64-bit little endian unsigned integer
+  static const int COMPRESSED_FRAME_INDEX_ENTRY_SIZE = 8;
 
   static std::string SEQMETA_FIELD_FRAME_FIELD_PREFIX = "Seq_Frame";
   static std::string SEQMETA_FIELD_IMG_STATUS = "ImageStatus";
+
+  // The text header is read in blocks of this size (the block is enlarged if a line does not fit into it)
+  static const size_t HEADER_READ_BLOCK_SIZE = 1 << 20;
+  // Frame numbers with more digits are rejected (to avoid integer overflow)
+  static const int MAX_FRAME_NUMBER_DIGITS = 9;
+
+  // The header index file is written in native byte order, files written on a machine with different
+  // byte order are recognized by the byte order mark and are regenerated
+  static const char* HEADER_INDEX_FILE_EXTENSION = ".plusidx";
+  static const char HEADER_INDEX_FILE_MAGIC[8] = {'P', 'L', 'U', 'S', 'I', 'D', 'X', 0};
+  // Increment when the layout of the header index file is changed
+  static const unsigned int HEADER_INDEX_FILE_VERSION = 2;
+  static const unsigned int HEADER_INDEX_BYTE_ORDER_MARK = 0x01020304;
+
+  // Frame field name and identifier found at a certain position within the previous frame
+  struct FrameFieldNameCacheEntry
+  {
+    FrameFieldNameCacheEntry() : Id(PlusFieldNameTable::INVALID_FIELD_ID) {}
+    std::string Name;
+    PlusFieldId Id;
+  };
+
+  // Case-insensitive check if a (not necessarily zero-terminated) string starts with a prefix
+  bool StartsWithInsensitive(const char* str, size_t strLength, const char* prefix)
+  {
+    for (size_t i = 0; prefix[i] != 0; ++i)
+    {
+      if (i >= strLength || tolower(static_cast<unsigned char>(str[i])) != tolower(static_cast<unsigned char>(prefix[i])))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void AppendIndexData(std::vector<char>& buffer, const void* data, size_t size)
+  {
+    const char* bytes = static_cast<const char*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+  }
+
+  template<class T> void AppendIndexValue(std::vector<char>& buffer, T value)
+  {
+    AppendIndexData(buffer, &value, sizeof(T));
+  }
+
+  // Strings are stored with their length and a terminating zero
+  void AppendIndexString(std::vector<char>& buffer, const char* str, size_t length)
+  {
+    AppendIndexValue<unsigned int>(buffer, static_cast<unsigned int>(length));
+    AppendIndexData(buffer, str, length);
+    buffer.push_back(0);
+  }
+
+  // Position of a field identifier in the sorted list of field identifiers
+  unsigned int GetFieldNameIndex(const std::vector<PlusFieldId>& sortedFieldIds, PlusFieldId fieldId)
+  {
+    return static_cast<unsigned int>(std::lower_bound(sortedFieldIds.begin(), sortedFieldIds.end(), fieldId) - sortedFieldIds.begin());
+  }
+
+  // 64-bit FNV-1a hash of the first length bytes of the stream, used for detecting modified headers
+  PlusStatus ComputeHeaderHash(FILE* stream, unsigned long long length, unsigned long long& hash)
+  {
+    std::vector<unsigned char> buffer(static_cast<size_t>(std::min<unsigned long long>(length, HEADER_READ_BLOCK_SIZE)));
+    hash = 14695981039346656037ULL;
+    while (length > 0)
+    {
+      size_t blockSize = static_cast<size_t>(std::min<unsigned long long>(length, buffer.size()));
+      if (fread(&buffer[0], 1, blockSize, stream) != blockSize)
+      {
+        return PLUS_FAIL;
+      }
+      for (size_t i = 0; i < blockSize; ++i)
+      {
+        hash = (hash ^ buffer[i]) * 1099511628211ULL;
+      }
+      length -= blockSize;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  // Reads values from the header index file contents, with bounds checking
+  class HeaderIndexReader
+  {
+  public:
+    HeaderIndexReader(const std::vector<char>& buffer)
+      : Position(buffer.empty() ? NULL : &buffer[0])
+      , End(buffer.empty() ? NULL : &buffer[0] + buffer.size())
+    {
+    }
+    bool Read(void* data, size_t size)
+    {
+      if (static_cast<size_t>(this->End - this->Position) < size)
+      {
+        return false;
+      }
+      memcpy(data, this->Position, size);
+      this->Position += size;
+      return true;
+    }
+    template<class T> bool ReadValue(T& value)
+    {
+      return this->Read(&value, sizeof(T));
+    }
+    // The returned zero-terminated string points into the buffer
+    bool ReadString(const char*& str, unsigned int& length)
+    {
+      if (!this->ReadValue(length) || static_cast<size_t>(this->End - this->Position) <= length || this->Position[length] != 0)
+      {
+        return false;
+      }
+      str = this->Position;
+      this->Position += length + 1;
+      return true;
+    }
+    bool IsAtEnd() const
+    {
+      return this->Position == this->End;
+    }
+  private:
+    const char* Position;
+    const char* End;
+  };
 }
 
 //----------------------------------------------------------------------------
@@ -72,12 +203,19 @@ vtkPlusMetaImageSequenceIO::vtkPlusMetaImageSequenceIO()
   : vtkPlusSequenceIOBase()
   , IsPixelDataBinary(true)
   , Output2DDataWithZDimensionIncluded(false)
+  , UseHeaderIndexFile(false)
+  , CompressedDataSize(0)
+  , PixelDataFileHandle(NULL)
+  , DecompressionStreamInitialized(false)
+  , DecompressionBytesRemaining(0)
+  , NextFrameToDecompress(0)
 {
 }
 
 //----------------------------------------------------------------------------
 vtkPlusMetaImageSequenceIO::~vtkPlusMetaImageSequenceIO()
 {
+  this->ClosePixelDataFileForReading();
 }
 
 //----------------------------------------------------------------------------
@@ -85,102 +223,26 @@ void vtkPlusMetaImageSequenceIO::PrintSelf(ostream& os, vtkIndent indent)
 {
   Superclass::PrintSelf(os, indent);
 
-  // TODO : anything specific to print
+  os << indent << "UseHeaderIndexFile: " << (this->UseHeaderIndexFile ? "true" : "false") << std::endl;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusMetaImageSequenceIO::ReadImageHeader()
 {
-  FILE* stream = NULL;
-  // open in binary mode because we determine the start of the image buffer also during this read
-  if (FileOpen(&stream, this->FileName.c_str(), "rb") != PLUS_SUCCESS)
-  {
-    LOG_ERROR("The file " << this->FileName << " could not be opened for reading");
-    return PLUS_FAIL;
-  }
-
-  char line[MAX_LINE_LENGTH + 1] = {0};
-  while (fgets(line, MAX_LINE_LENGTH, stream))
+  if (!this->UseHeaderIndexFile || this->ReadHeaderIndexFile() != PLUS_SUCCESS)
   {
-
-    std::string lineStr = line;
-
-    // Split line into name and value
-    size_t equalSignFound;
-    equalSignFound = lineStr.find_first_of("=");
-    if (equalSignFound == std::string::npos)
-    {
-      LOG_WARNING("Parsing line failed, equal sign is missing (" << lineStr << ")");
-      continue;
-    }
-    std::string name = lineStr.substr(0, equalSignFound);
-    std::string value = lineStr.substr(equalSignFound + 1);
-
-    // trim spaces from the left and right
-    PlusCommon::Trim(name);
-    PlusCommon::Trim(value);
-    if (!PlusCommon::HasSubstrInsensitive(name, SEQMETA_FIELD_FRAME_FIELD_PREFIX))
+    HeaderFieldListType headerFields;
+    unsigned long long headerSize = 0;
+    if (this->ParseImageHeader(headerFields, headerSize) != PLUS_SUCCESS)
     {
-      // field
-      SetCustomString(name.c_str(), value.c_str());
-
-      // Arrived to ElementDataFile, this is the last element
-      if (PlusCommon::IsEqualInsensitive(name, SEQMETA_FIELD_ELEMENT_DATA_FILE))
-      {
-        if (PlusCommon::IsEqualInsensitive(value, SEQMETA_FIELD_VALUE_ELEMENT_DATA_FILE_LOCAL))
-        {
-          // pixel data stored locally
-          this->PixelDataFileOffset = FTELL(stream);
-        }
-        else
-        {
-          // pixel data stored in separate file
-          this->PixelDataFileName = value;
-          this->PixelDataFileOffset = 0;
-        }
-        // this is the last element of the header
-        break;
-      }
+      return PLUS_FAIL;
     }
-    else
+    if (this->UseHeaderIndexFile && this->WriteHeaderIndexFile(headerFields, headerSize) != PLUS_SUCCESS)
     {
-      // frame field
-      // name: Seq_Frame0000_CustomTransform
-      name.erase(0, SEQMETA_FIELD_FRAME_FIELD_PREFIX.size());   // 0000_CustomTransform
-
-      // Split line into name and value
-      size_t underscoreFound;
-      underscoreFound = name.find_first_of("_");
-      if (underscoreFound == std::string::npos)
-      {
-        LOG_WARNING("Parsing line failed, underscore is missing from frame field name (" << lineStr << ")");
-        continue;
-      }
-      std::string frameNumberStr = name.substr(0, underscoreFound);   // 0000
-      std::string frameFieldName = name.substr(underscoreFound + 1);   // CustomTransform
-
-      int frameNumber = 0;
-      if (PlusCommon::StringToInt(frameNumberStr.c_str(), frameNumber) != PLUS_SUCCESS)
-      {
-        LOG_WARNING("Parsing line failed, cannot get frame number from frame field (" << lineStr << ")");
-        continue;
-      }
-      SetCustomFrameString(frameNumber, frameFieldName.c_str(), value.c_str());
-
-      if (ferror(stream))
-      {
-        LOG_ERROR("Error reading the file " << this->FileName);
-        break;
-      }
-      if (feof(stream))
-      {
-        break;
-      }
+      LOG_DEBUG("Header index file " << this->GetHeaderIndexFileName() << " could not be written, the header will be parsed again next time");
     }
   }
 
-  fclose(stream);
-
   int nDims = 3;
   if (PlusCommon::StringToInt(this->TrackedFrameList->GetCustomString("NDims"), nDims) == PLUS_SUCCESS)
   {
@@ -333,79 +395,511 @@ PlusStatus vtkPlusMetaImageSequenceIO::ReadImageHeader()
 }
 
 //----------------------------------------------------------------------------
-// Read the spacing and dimensions of the image.
-PlusStatus vtkPlusMetaImageSequenceIO::ReadImagePixels()
+PlusStatus vtkPlusMetaImageSequenceIO::ParseImageHeader(HeaderFieldListType& headerFields, unsigned long long& headerSize)
 {
-  int frameCount = this->Dimensions[3];
-  unsigned int frameSizeInBytes = 0;
-  if (this->Dimensions[0] > 0 && this->Dimensions[1] > 0 && this->Dimensions[2] > 0)
+  FILE* stream = NULL;
+  // open in binary mode because we determine the start of the image buffer also during this read
+  if (FileOpen(&stream, this->FileName.c_str(), "rb") != PLUS_SUCCESS)
   {
-    frameSizeInBytes = this->Dimensions[0] * this->Dimensions[1] * this->Dimensions[2] * PlusVideoFrame::GetNumberOfBytesPerScalar(this->PixelType) * this->NumberOfScalarComponents;
+    LOG_ERROR("The file " << this->FileName << " could not be opened for reading");
+    return PLUS_FAIL;
   }
 
-  if (frameSizeInBytes == 0)
+  // The file is read in large blocks and the lines are parsed in place: names and values are zero-terminated
+  // within the buffer, so no memory is allocated for each line. The last character of the buffer is reserved
+  // for terminating the last line of the file.
+  std::vector<char> buffer(HEADER_READ_BLOCK_SIZE);
+  size_t lineStart = 0; // position of the first unprocessed character in the buffer
+  size_t dataEnd = 0; // number of valid characters in the buffer
+  FilePositionOffsetType bufferFileOffset = 0; // position of the first character of the buffer in the file
+  bool endOfFile = false;
+  bool endOfHeader = false;
+  PlusStatus status = PLUS_SUCCESS;
+
+  const size_t framePrefixLength = SEQMETA_FIELD_FRAME_FIELD_PREFIX.size();
+  int currentFrameNumber = -1;
+  PlusTrackedFrame* currentFrame = NULL;
+  unsigned int fieldIndexInFrame = 0;
+  std::vector<FrameFieldNameCacheEntry> fieldNameCache;
+
+  while (!endOfHeader)
   {
-    LOG_DEBUG("No image data in the metafile");
-    return PLUS_SUCCESS;
+    char* lineBegin = &buffer[0] + lineStart;
+    char* newLine = static_cast<char*>(memchr(lineBegin, '\n', dataEnd - lineStart));
+    if (newLine == NULL && !endOfFile)
+    {
+      // Incomplete line: move it to the beginning of the buffer and read the next block
+      if (lineStart > 0)
+      {
+        memmove(&buffer[0], lineBegin, dataEnd - lineStart);
+        bufferFileOffset += lineStart;
+        dataEnd -= lineStart;
+        lineStart = 0;
+      }
+      if (dataEnd + 1 >= buffer.size())
+      {
+        // the line does not fit into the buffer
+        buffer.resize(buffer.size() * 2);
+      }
+      size_t bytesRead = fread(&buffer[0] + dataEnd, 1, buffer.size() - 1 - dataEnd, stream);
+      if (ferror(stream))
+      {
+        LOG_ERROR("Error reading the file " << this->FileName);
+        status = PLUS_FAIL;
+        break;
+      }
+      if (bytesRead == 0)
+      {
+        endOfFile = true;
+      }
+      dataEnd += bytesRead;
+      continue;
+    }
+
+    char* lineEnd = (newLine != NULL ? newLine : &buffer[0] + dataEnd);
+    if (newLine == NULL && lineBegin == lineEnd)
+    {
+      // all lines are processed
+      break;
+    }
+    lineStart = (lineEnd - &buffer[0]) + (newLine != NULL ? 1 : 0);
+
+    // Trim spaces from the left and right
+    while (lineBegin < lineEnd && isspace(static_cast<unsigned char>(*lineBegin)))
+    {
+      ++lineBegin;
+    }
+    while (lineEnd > lineBegin && isspace(static_cast<unsigned char>(lineEnd[-1])))
+    {
+      --lineEnd;
+    }
+    if (lineBegin == lineEnd)
+    {
+      continue;
+    }
+    *lineEnd = 0;
+
+    // Split line into name and value
+    char* equalSign = static_cast<char*>(memchr(lineBegin, '=', lineEnd - lineBegin));
+    if (equalSign == NULL)
+    {
+      LOG_WARNING("Parsing line failed, equal sign is missing (" << lineBegin << ")");
+      continue;
+    }
+    char* name = lineBegin;
+    char* nameEnd = equalSign;
+    while (nameEnd > name && isspace(static_cast<unsigned char>(nameEnd[-1])))
+    {
+      --nameEnd;
+    }
+    *nameEnd = 0;
+    const char* value = equalSign + 1;
+    while (value < lineEnd && isspace(static_cast<unsigned char>(*value)))
+    {
+      ++value;
+    }
+    size_t valueLength = lineEnd - value;
+
+    if (!StartsWithInsensitive(name, nameEnd - name, SEQMETA_FIELD_FRAME_FIELD_PREFIX.c_str()))
+    {
+      // field
+      SetCustomString(name, value);
+      headerFields.push_back(std::make_pair(std::string(name, nameEnd - name), std::string(value, valueLength)));
+
+      // Arrived to ElementDataFile, this is the last element
+      if (STRCASECMP(name, SEQMETA_FIELD_ELEMENT_DATA_FILE) == 0)
+      {
+        if (STRCASECMP(value, SEQMETA_FIELD_VALUE_ELEMENT_DATA_FILE_LOCAL) == 0)
+        {
+          // pixel data stored locally, right after this line
+          this->PixelDataFileOffset = bufferFileOffset + lineStart;
+        }
+        else
+        {
+          // pixel data stored in separate file
+          this->PixelDataFileName = value;
+          this->PixelDataFileOffset = 0;
+        }
+        // this is the last element of the header
+        endOfHeader = true;
+      }
+      continue;
+    }
+
+    // frame field
+    // name: Seq_Frame0000_CustomTransform
+    const char* frameNumberBegin = name + framePrefixLength; // 0000_CustomTransform
+    const char* underscore = static_cast<const char*>(memchr(frameNumberBegin, '_', nameEnd - frameNumberBegin));
+    if (underscore == NULL)
+    {
+      LOG_WARNING("Parsing line failed, underscore is missing from frame field name (" << name << " = " << value << ")");
+      continue;
+    }
+    int frameNumber = 0;
+    bool frameNumberValid = (underscore > frameNumberBegin && underscore - frameNumberBegin <= MAX_FRAME_NUMBER_DIGITS);
+    for (const char* digit = frameNumberBegin; frameNumberValid && digit < underscore; ++digit)
+    {
+      frameNumberValid = (isdigit(static_cast<unsigned char>(*digit)) != 0);
+      frameNumber = frameNumber * 10 + (*digit - '0');
+    }
+    if (!frameNumberValid)
+    {
+      LOG_WARNING("Parsing line failed, cannot get frame number from frame field (" << name << " = " << value << ")");
+      continue;
+    }
+    const char* frameFieldName = underscore + 1; // CustomTransform
+    size_t frameFieldNameLength = nameEnd - frameFieldName;
+
+    if (frameNumber != currentFrameNumber)
+    {
+      CreateTrackedFrameIfNonExisting(frameNumber);
+      currentFrame = this->TrackedFrameList->GetTrackedFrame(frameNumber);
+      currentFrameNumber = frameNumber;
+      fieldIndexInFrame = 0;
+    }
+
+    // Frames usually contain the same fields in the same order, so the field identifier found for the same
+    // position in the previous frame is reused if the name matches
+    if (fieldIndexInFrame >= fieldNameCache.size())
+    {
+      fieldNameCache.resize(fieldIndexInFrame + 1);
+    }
+    FrameFieldNameCacheEntry& cachedFieldName = fieldNameCache[fieldIndexInFrame++];
+    if (cachedFieldName.Id == PlusFieldNameTable::INVALID_FIELD_ID
+        || cachedFieldName.Name.size() != frameFieldNameLength
+        || memcmp(cachedFieldName.Name.c_str(), frameFieldName, frameFieldNameLength) != 0)
+    {
+      cachedFieldName.Name.assign(frameFieldName, frameFieldNameLength);
+      cachedFieldName.Id = PlusFieldNameTable::GetFieldId(frameFieldName);
+    }
+    currentFrame->SetCustomFrameField(cachedFieldName.Id, value, valueLength);
   }
+  headerSize = bufferFileOffset + lineStart;
 
-  int numberOfErrors = 0;
+  fclose(stream);
+  return status;
+}
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMetaImageSequenceIO::GetHeaderHash(unsigned long long headerSize, unsigned long long& headerHash)
+{
   FILE* stream = NULL;
+  if (FileOpen(&stream, this->FileName.c_str(), "rb") != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  PlusStatus status = ComputeHeaderHash(stream, headerSize, headerHash);
+  fclose(stream);
+  return status;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusMetaImageSequenceIO::GetHeaderIndexFileName()
+{
+  return this->FileName + HEADER_INDEX_FILE_EXTENSION;
+}
 
-  if (FileOpen(&stream, GetPixelDataFilePath().c_str(), "rb") != PLUS_SUCCESS)
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMetaImageSequenceIO::ReadHeaderIndexFile()
+{
+  std::string indexFileName = this->GetHeaderIndexFileName();
+  if (!vtksys::SystemTools::FileExists(indexFileName.c_str(), true))
   {
-    LOG_ERROR("The file " << GetPixelDataFilePath() << " could not be opened for reading");
+    LOG_DEBUG("Header index file " << indexFileName << " does not exist");
     return PLUS_FAIL;
   }
 
-  std::vector<unsigned char> allFramesPixelBuffer;
-  if (this->UseCompression)
+  FILE* stream = NULL;
+  if (FileOpen(&stream, indexFileName.c_str(), "rb") != PLUS_SUCCESS)
   {
-    unsigned int allFramesPixelBufferSize = frameCount * frameSizeInBytes;
+    LOG_DEBUG("Header index file " << indexFileName << " could not be opened for reading");
+    return PLUS_FAIL;
+  }
+  std::vector<char> buffer;
+  bool readSuccessful = (FSEEK(stream, 0, SEEK_END) == 0);
+  FilePositionOffsetType indexFileSize = (readSuccessful ? FTELL(stream) : 0);
+  if (readSuccessful && indexFileSize > 0 && FSEEK(stream, 0, SEEK_SET) == 0)
+  {
+    buffer.resize(static_cast<size_t>(indexFileSize));
+    readSuccessful = (fread(&buffer[0], 1, buffer.size(), stream) == buffer.size());
+  }
+  fclose(stream);
+  if (!readSuccessful || buffer.empty())
+  {
+    LOG_DEBUG("Header index file " << indexFileName << " could not be read");
+    return PLUS_FAIL;
+  }
 
-    try
+  HeaderIndexReader reader(buffer);
+
+  char magic[sizeof(HEADER_INDEX_FILE_MAGIC)] = {0};
+  unsigned int version = 0;
+  unsigned int byteOrderMark = 0;
+  if (!reader.Read(magic, sizeof(magic)) || memcmp(magic, HEADER_INDEX_FILE_MAGIC, sizeof(magic)) != 0
+      || !reader.ReadValue(version) || version != HEADER_INDEX_FILE_VERSION
+      || !reader.ReadValue(byteOrderMark) || byteOrderMark != HEADER_INDEX_BYTE_ORDER_MARK)
+  {
+    LOG_DEBUG("Header index file " << indexFileName << " has unsupported format");
+    return PLUS_FAIL;
+  }
+
+  // Size and modification time of the file are checked first, as they are cheap to compare. The file may be modified
+  // without changing them (e.g., within the resolution of the modification time), so the header bytes are compared, too.
+  unsigned long long headerFileSize = 0;
+  long long headerFileModifiedTime = 0;
+  unsigned long long headerSize = 0;
+  unsigned long long headerHash = 0;
+  unsigned long long currentHeaderHash = 0;
+  if (!reader.ReadValue(headerFileSize) || headerFileSize != static_cast<unsigned long long>(vtksys::SystemTools::FileLength(this->FileName.c_str()))
+      || !reader.ReadValue(headerFileModifiedTime) || headerFileModifiedTime != static_cast<long long>(vtksys::SystemTools::ModifiedTime(this->FileName.c_str()))
+      || !reader.ReadValue(headerSize) || headerSize > headerFileSize
+      || !reader.ReadValue(headerHash) || this->GetHeaderHash(headerSize, currentHeaderHash) != PLUS_SUCCESS || headerHash != currentHeaderHash)
+  {
+    LOG_DEBUG("Header index file " << indexFileName << " is out of date");
+    return PLUS_FAIL;
+  }
+
+  long long pixelDataFileOffset = 0;
+  const char* pixelDataFileName = NULL;
+  unsigned int pixelDataFileNameLength = 0;
+  bool valid = reader.ReadValue(pixelDataFileOffset) && reader.ReadString(pixelDataFileName, pixelDataFileNameLength);
+
+  // Header fields are only applied if the whole index is valid
+  std::vector< std::pair<const char*, const char*> > headerFields;
+  unsigned int numberOfHeaderFields = 0;
+  valid = valid && reader.ReadValue(numberOfHeaderFields);
+  for (unsigned int i = 0; valid && i < numberOfHeaderFields; ++i)
+  {
+    const char* name = NULL;
+    const char* value = NULL;
+    unsigned int length = 0;
+    valid = reader.ReadString(name, length) && reader.ReadString(value, length);
+    headerFields.push_back(std::make_pair(name, value));
+  }
+
+  // Frame field names, frame fields refer to them by their position in the table
+  std::vector<PlusFieldId> fieldIds;
+  unsigned int numberOfFieldNames = 0;
+  valid = valid && reader.ReadValue(numberOfFieldNames);
+  for (unsigned int i = 0; valid && i < numberOfFieldNames; ++i)
+  {
+    const char* name = NULL;
+    unsigned int length = 0;
+    valid = reader.ReadString(name, length);
+    if (valid)
     {
-      allFramesPixelBuffer.resize(allFramesPixelBufferSize);
+      fieldIds.push_back(PlusFieldNameTable::GetFieldId(name));
     }
-    catch (std::bad_alloc& e)
+  }
+
+  unsigned int numberOfFrames = 0;
+  valid = valid && reader.ReadValue(numberOfFrames);
+  if (valid && numberOfFrames > 0)
+  {
+    CreateTrackedFrameIfNonExisting(numberOfFrames - 1);
+  }
+  for (unsigned int frameNumber = 0; valid && frameNumber < numberOfFrames; ++frameNumber)
+  {
+    PlusTrackedFrame* trackedFrame = this->TrackedFrameList->GetTrackedFrame(frameNumber);
+
+    unsigned int numberOfFields = 0;
+    valid = reader.ReadValue(numberOfFields);
+    for (unsigned int i = 0; valid && i < numberOfFields; ++i)
     {
-      cerr << e.what() << endl;
-      LOG_ERROR("vtkPlusMetaImageSequenceIO::ReadImagePixels failed due to out of memory. Try to reduce image buffer sizes or use a 64-bit build of Plus.");
-      return PLUS_FAIL;
+      unsigned int fieldNameIndex = 0;
+      const char* value = NULL;
+      unsigned int valueLength = 0;
+      valid = reader.ReadValue(fieldNameIndex) && fieldNameIndex < fieldIds.size() && reader.ReadString(value, valueLength);
+      if (valid)
+      {
+        trackedFrame->SetCustomFrameField(fieldIds[fieldNameIndex], value, valueLength);
+      }
+    }
+
+    unsigned int numberOfTransforms = 0;
+    valid = valid && reader.ReadValue(numberOfTransforms);
+    for (unsigned int i = 0; valid && i < numberOfTransforms; ++i)
+    {
+      unsigned int fieldNameIndex = 0;
+      unsigned char matrixDefined = 0;
+      unsigned char statusDefined = 0;
+      int transformStatus = FIELD_INVALID;
+      double matrix[16] = {0};
+      valid = reader.ReadValue(fieldNameIndex) && fieldNameIndex < fieldIds.size()
+              && PlusFieldNameTable::GetFieldKind(fieldIds[fieldNameIndex]) == PlusFieldNameTable::TRANSFORM_FIELD
+              && reader.ReadValue(matrixDefined) && reader.ReadValue(statusDefined) && reader.ReadValue(transformStatus)
+              && (!matrixDefined || reader.Read(matrix, sizeof(matrix)));
+      if (!valid)
+      {
+        break;
+      }
+      if (matrixDefined)
+      {
+        trackedFrame->SetCustomFrameTransform(fieldIds[fieldNameIndex], matrix);
+      }
+      if (statusDefined)
+      {
+        trackedFrame->SetCustomFrameTransformStatus(fieldIds[fieldNameIndex], static_cast<TrackedFrameFieldStatus>(transformStatus));
+      }
+    }
+  }
+
+  if (!valid || !reader.IsAtEnd())
+  {
+    LOG_DEBUG("Header index file " << indexFileName << " is corrupted");
+    this->TrackedFrameList->Clear();
+    return PLUS_FAIL;
+  }
+
+  for (std::vector< std::pair<const char*, const char*> >::iterator field = headerFields.begin(); field != headerFields.end(); ++field)
+  {
+    SetCustomString(field->first, field->second);
+  }
+  this->PixelDataFileOffset = static_cast<FilePositionOffsetType>(pixelDataFileOffset);
+  this->PixelDataFileName = pixelDataFileName;
+
+  LOG_DEBUG("Header of " << this->FileName << " is read from header index file " << indexFileName);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMetaImageSequenceIO::WriteHeaderIndexFile(const HeaderFieldListType& headerFields, unsigned long long headerSize)
+{
+  std::string indexFileName = this->GetHeaderIndexFileName();
+  unsigned long long headerHash = 0;
+  if (this->GetHeaderHash(headerSize, headerHash) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  unsigned int numberOfFrames = this->TrackedFrameList->GetNumberOfTrackedFrames();
+
+  // Collect the names of all frame fields
+  std::vector<PlusFieldId> fieldIds;
+  for (unsigned int frameNumber = 0; frameNumber < numberOfFrames; ++frameNumber)
+  {
+    PlusTrackedFrame* trackedFrame = this->TrackedFrameList->GetTrackedFrame(frameNumber);
+    const PlusFrameFieldStore& fields = trackedFrame->GetCustomFrameFieldStore();
+    for (unsigned int i = 0; i < fields.GetNumberOfFields(); ++i)
+    {
+      fieldIds.push_back(fields.GetFieldId(i));
+    }
+    const PlusTrackedFrame::FrameTransformListType& transforms = trackedFrame->GetCustomFrameTransforms();
+    for (PlusTrackedFrame::FrameTransformListType::const_iterator transform = transforms.begin(); transform != transforms.end(); ++transform)
+    {
+      fieldIds.push_back(transform->FieldId);
+    }
+    // Frames usually have the same fields, keep the list short
+    std::sort(fieldIds.begin(), fieldIds.end());
+    fieldIds.erase(std::unique(fieldIds.begin(), fieldIds.end()), fieldIds.end());
+  }
+
+  std::vector<char> buffer;
+  AppendIndexData(buffer, HEADER_INDEX_FILE_MAGIC, sizeof(HEADER_INDEX_FILE_MAGIC));
+  AppendIndexValue<unsigned int>(buffer, HEADER_INDEX_FILE_VERSION);
+  AppendIndexValue<unsigned int>(buffer, HEADER_INDEX_BYTE_ORDER_MARK);
+  AppendIndexValue<unsigned long long>(buffer, vtksys::SystemTools::FileLength(this->FileName.c_str()));
+  AppendIndexValue<long long>(buffer, vtksys::SystemTools::ModifiedTime(this->FileName.c_str()));
+  AppendIndexValue<unsigned long long>(buffer, headerSize);
+  AppendIndexValue<unsigned long long>(buffer, headerHash);
+  AppendIndexValue<long long>(buffer, this->PixelDataFileOffset);
+  AppendIndexString(buffer, this->PixelDataFileName.c_str(), this->PixelDataFileName.size());
+
+  AppendIndexValue<unsigned int>(buffer, static_cast<unsigned int>(headerFields.size()));
+  for (HeaderFieldListType::const_iterator field = headerFields.begin(); field != headerFields.end(); ++field)
+  {
+    AppendIndexString(buffer, field->first.c_str(), field->first.size());
+    AppendIndexString(buffer, field->second.c_str(), field->second.size());
+  }
+
+  AppendIndexValue<unsigned int>(buffer, static_cast<unsigned int>(fieldIds.size()));
+  for (std::vector<PlusFieldId>::const_iterator fieldId = fieldIds.begin(); fieldId != fieldIds.end(); ++fieldId)
+  {
+    const std::string& fieldName = PlusFieldNameTable::GetFieldName(*fieldId);
+    AppendIndexString(buffer, fieldName.c_str(), fieldName.size());
+  }
+
+  AppendIndexValue<unsigned int>(buffer, numberOfFrames);
+  for (unsigned int frameNumber = 0; frameNumber < numberOfFrames; ++frameNumber)
+  {
+    PlusTrackedFrame* trackedFrame = this->TrackedFrameList->GetTrackedFrame(frameNumber);
+
+    const PlusFrameFieldStore& fields = trackedFrame->GetCustomFrameFieldStore();
+    AppendIndexValue<unsigned int>(buffer, fields.GetNumberOfFields());
+    for (unsigned int i = 0; i < fields.GetNumberOfFields(); ++i)
+    {
+      AppendIndexValue<unsigned int>(buffer, GetFieldNameIndex(fieldIds, fields.GetFieldId(i)));
+      AppendIndexString(buffer, fields.GetFieldValue(i), fields.GetFieldValueLength(i));
+    }
+
+    const PlusTrackedFrame::FrameTransformListType& transforms = trackedFrame->GetCustomFrameTransforms();
+    AppendIndexValue<unsigned int>(buffer, static_cast<unsigned int>(transforms.size()));
+    for (PlusTrackedFrame::FrameTransformListType::const_iterator transform = transforms.begin(); transform != transforms.end(); ++transform)
+    {
+      AppendIndexValue<unsigned int>(buffer, GetFieldNameIndex(fieldIds, transform->FieldId));
+      AppendIndexValue<unsigned char>(buffer, transform->MatrixDefined ? 1 : 0);
+      AppendIndexValue<unsigned char>(buffer, transform->StatusDefined ? 1 : 0);
+      AppendIndexValue<int>(buffer, transform->Status);
+      if (transform->MatrixDefined)
+      {
+        AppendIndexData(buffer, transform->Matrix, sizeof(transform->Matrix));
+      }
     }
+  }
+
+  FILE* stream = NULL;
+  if (FileOpen(&stream, indexFileName.c_str(), "wb") != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  bool writeSuccessful = (fwrite(&buffer[0], 1, buffer.size(), stream) == buffer.size());
+  writeSuccessful = (fclose(stream) == 0) && writeSuccessful;
+  if (!writeSuccessful)
+  {
+    // do not leave a truncated index file behind
+    vtksys::SystemTools::RemoveFile(indexFileName.c_str());
+    return PLUS_FAIL;
+  }
+
+  LOG_DEBUG("Header index file " << indexFileName << " is written");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// Read the spacing and dimensions of the image.
+PlusStatus vtkPlusMetaImageSequenceIO::ReadImagePixels()
+{
+  int frameCount = this->Dimensions[3];
+  unsigned long long frameSizeInBytes = this->GetFrameSizeInBytes();
+  if (frameSizeInBytes == 0)
+  {
+    LOG_DEBUG("No image data in the metafile");
+    return PLUS_SUCCESS;
+  }
 
-    unsigned int allFramesCompressedPixelBufferSize = 0;
-    PlusCommon::StringToInt(this->TrackedFrameList->GetCustomString(SEQMETA_FIELD_COMPRESSED_DATA_SIZE), allFramesCompressedPixelBufferSize);
-    std::vector<unsigned char> allFramesCompressedPixelBuffer;
-    allFramesCompressedPixelBuffer.resize(allFramesCompressedPixelBufferSize);
+  if (this->OpenPixelDataFileForReading() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
 
-    FSEEK(stream, this->PixelDataFileOffset, SEEK_SET);
-    if (fread(&(allFramesCompressedPixelBuffer[0]), 1, allFramesCompressedPixelBufferSize, stream) != allFramesCompressedPixelBufferSize)
-    {
-      LOG_ERROR("Could not read " << allFramesCompressedPixelBufferSize << " bytes from " << GetPixelDataFilePath());
-      fclose(stream);
-      return PLUS_FAIL;
-    }
+  int numberOfErrors = 0;
 
-    uLongf unCompSize = allFramesPixelBufferSize;
-    if (uncompress((Bytef*) & (allFramesPixelBuffer[0]), &unCompSize, (const Bytef*) & (allFramesCompressedPixelBuffer[0]), allFramesCompressedPixelBufferSize) != Z_OK)
-    {
-      LOG_ERROR("Cannot uncompress the pixel data");
-      fclose(stream);
-      return PLUS_FAIL;
-    }
-    if (unCompSize != allFramesPixelBufferSize)
-    {
-      LOG_ERROR("Cannot uncompress the pixel data: uncompressed data is less than expected");
-      fclose(stream);
-      return PLUS_FAIL;
-    }
+  PlusVideoFrame::FlipInfoType flipInfo;
+  if (PlusVideoFrame::GetFlipAxes(this->ImageOrientationInFile, this->ImageType, this->ImageOrientationInMemory, flipInfo) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to convert image data to the requested orientation, from " << PlusVideoFrame::GetStringFromUsImageOrientation(this->ImageOrientationInFile) <<
+              " to " << PlusVideoFrame::GetStringFromUsImageOrientation(this->ImageOrientationInMemory));
+    this->ClosePixelDataFileForReading();
+    return PLUS_FAIL;
+  }
 
+  // If the pixel data file is memory mapped then the frames reference the pixels in the file instead of a copy
+  vtkSmartPointer<vtkPlusMemoryMappedFile> mappedPixelDataFile;
+  if (!this->LoadImageDataOnDemand)
+  {
+    mappedPixelDataFile = this->MapPixelDataFile(flipInfo, frameSizeInBytes, frameCount);
   }
 
-  std::vector<unsigned char> pixelBuffer;
-  pixelBuffer.resize(frameSizeInBytes);
+  this->FrameImageValid.assign(frameCount, true);
   for (int frameNumber = 0; frameNumber < frameCount; frameNumber++)
   {
     CreateTrackedFrameIfNonExisting(frameNumber);
@@ -425,10 +919,27 @@ PlusStatus vtkPlusMetaImageSequenceIO::ReadImagePixels()
       if (STRCASECMP(strImgStatus.c_str(), "OK") != 0)     // Image status _not_ OK
       {
         LOG_DEBUG("Frame #" << frameNumber << " image data is invalid, no need to allocate data in the tracked frame list.");
+        this->FrameImageValid[frameNumber] = false;
         continue;
       }
     }
 
+    if (this->LoadImageDataOnDemand)
+    {
+      // pixel data will be read by ReadFrameImageData
+      continue;
+    }
+
+    if (mappedPixelDataFile != NULL)
+    {
+      if (this->SetFramePixelsFromMappedFile(trackedFrame, mappedPixelDataFile, frameNumber, frameSizeInBytes) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to set memory mapped pixel data of frame " << frameNumber);
+        numberOfErrors++;
+      }
+      continue;
+    }
+
     trackedFrame->GetImageData()->SetImageOrientation(this->ImageOrientationInMemory);
     trackedFrame->GetImageData()->SetImageType(this->ImageType);
 
@@ -439,48 +950,230 @@ PlusStatus vtkPlusMetaImageSequenceIO::ReadImagePixels()
       continue;
     }
 
+    if (this->ReadFramePixels(frameNumber, &(this->FramePixelBuffer[0])) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read pixel data from sequence metafile (frame number: " << frameNumber << ")!");
+      numberOfErrors++;
+      continue;
+    }
+
     int clipRectOrigin[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
     int clipRectSize[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
+    if (PlusVideoFrame::GetOrientedClippedImage(&(this->FramePixelBuffer[0]), flipInfo, this->ImageType, this->PixelType, this->NumberOfScalarComponents, this->Dimensions, *trackedFrame->GetImageData(), clipRectOrigin, clipRectSize) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get oriented image from sequence metafile (frame number: " << frameNumber << ")!");
+      numberOfErrors++;
+      continue;
+    }
+  }
+
+  if (!this->LoadImageDataOnDemand)
+  {
+    this->ClosePixelDataFileForReading();
+  }
+
+  if (numberOfErrors > 0)
+  {
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusMetaImageSequenceIO::GetFrameSizeInBytes()
+{
+  if (this->Dimensions[0] == 0 || this->Dimensions[1] == 0 || this->Dimensions[2] == 0)
+  {
+    return 0;
+  }
+  return static_cast<unsigned long long>(this->Dimensions[0]) * this->Dimensions[1] * this->Dimensions[2]
+         * PlusVideoFrame::GetNumberOfBytesPerScalar(this->PixelType) * this->NumberOfScalarComponents;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMetaImageSequenceIO::OpenPixelDataFileForReading()
+{
+  this->ClosePixelDataFileForReading();
+
+  if (FileOpen(&this->PixelDataFileHandle, GetPixelDataFilePath().c_str(), "rb") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("The file " << GetPixelDataFilePath() << " could not be opened for reading");
+    this->PixelDataFileHandle = NULL;
+    return PLUS_FAIL;
+  }
+
+  try
+  {
+    this->FramePixelBuffer.resize(this->GetFrameSizeInBytes());
+  }
+  catch (std::bad_alloc& e)
+  {
+    cerr << e.what() << endl;
+    LOG_ERROR("vtkPlusMetaImageSequenceIO::ReadImagePixels failed due to out of memory. Try to reduce image buffer sizes or use a 64-bit build of Plus.");
+    this->ClosePixelDataFileForReading();
+    return PLUS_FAIL;
+  }
+
+  if (!this->UseCompression)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  this->CompressedDataSize = 0;
+  PlusCommon::StringToLong(this->TrackedFrameList->GetCustomString(SEQMETA_FIELD_COMPRESSED_DATA_SIZE), this->CompressedDataSize);
+
+  const char* frameIndexFieldValue = this->TrackedFrameList->GetCustomString(SEQMETA_FIELD_COMPRESSED_DATA_FRAME_INDEX);
+  if (frameIndexFieldValue == NULL || STRCASECMP(frameIndexFieldValue, "true") != 0)
+  {
+    LOG_DEBUG("No compressed frame index in " << this->FileName << ". Frames will be decompressed sequentially.");
+    return PLUS_SUCCESS;
+  }
+
+  // The frame index is stored right after the compressed pixel data
+  const unsigned int frameCount = this->Dimensions[3];
+  std::vector<unsigned char> frameIndexBuffer(frameCount * COMPRESSED_FRAME_INDEX_ENTRY_SIZE);
+  FSEEK(this->PixelDataFileHandle, this->PixelDataFileOffset + this->CompressedDataSize, SEEK_SET);
+  if (frameCount == 0 || fread(&(frameIndexBuffer[0]), 1, frameIndexBuffer.size(), this->PixelDataFileHandle) != frameIndexBuffer.size())
+  {
+    LOG_WARNING("Failed to read the compressed frame index from " << GetPixelDataFilePath() << ". Frames will be decompressed sequentially.");
+    return PLUS_SUCCESS;
+  }
 
-    PlusVideoFrame::FlipInfoType flipInfo;
-    if (PlusVideoFrame::GetFlipAxes(this->ImageOrientationInFile, this->ImageType, this->ImageOrientationInMemory, flipInfo) != PLUS_SUCCESS)
+  this->CompressedFrameOffsets.resize(frameCount);
+  for (unsigned int frameNumber = 0; frameNumber < frameCount; frameNumber++)
+  {
+    unsigned long long offset = 0;
+    for (int byteIndex = COMPRESSED_FRAME_INDEX_ENTRY_SIZE - 1; byteIndex >= 0; byteIndex--)
     {
-      LOG_ERROR("Failed to convert image data to the requested orientation, from " << PlusVideoFrame::GetStringFromUsImageOrientation(this->ImageOrientationInFile) <<
-                " to " << PlusVideoFrame::GetStringFromUsImageOrientation(this->ImageOrientationInMemory));
-      return PLUS_FAIL;
+      offset = (offset << 8) | frameIndexBuffer[frameNumber * COMPRESSED_FRAME_INDEX_ENTRY_SIZE + byteIndex];
+    }
+    if ((frameNumber == 0 && offset != 0)
+        || (frameNumber > 0 && offset <= this->CompressedFrameOffsets[frameNumber - 1])
+        || offset >= this->CompressedDataSize)
+    {
+      LOG_WARNING("Invalid compressed frame index in " << GetPixelDataFilePath() << ". Frames will be decompressed sequentially.");
+      this->CompressedFrameOffsets.clear();
+      return PLUS_SUCCESS;
+    }
+    this->CompressedFrameOffsets[frameNumber] = offset;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusMetaImageSequenceIO::ClosePixelDataFileForReading()
+{
+  if (this->PixelDataFileHandle != NULL)
+  {
+    fclose(this->PixelDataFileHandle);
+    this->PixelDataFileHandle = NULL;
+  }
+  if (this->DecompressionStreamInitialized)
+  {
+    inflateEnd(&this->DecompressionStream);
+    this->DecompressionStreamInitialized = false;
+  }
+  this->CompressedFrameOffsets.clear();
+  std::vector<unsigned char>().swap(this->CompressedDataBuffer);
+  std::vector<unsigned char>().swap(this->FramePixelBuffer);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMetaImageSequenceIO::ReadFramePixels(unsigned int frameNumber, unsigned char* frameBuffer)
+{
+  const unsigned long long frameSizeInBytes = this->GetFrameSizeInBytes();
+
+  if (!this->UseCompression)
+  {
+    FilePositionOffsetType offset = this->PixelDataFileOffset + frameNumber * frameSizeInBytes;
+    FSEEK(this->PixelDataFileHandle, offset, SEEK_SET);
+    if (fread(frameBuffer, 1, frameSizeInBytes, this->PixelDataFileHandle) != frameSizeInBytes)
+    {
+      //LOG_ERROR("Could not read "<<frameSizeInBytes<<" bytes from "<<GetPixelDataFilePath());
     }
+    return PLUS_SUCCESS;
+  }
 
-    if (!this->UseCompression)
+  if (this->CompressedFrameOffsets.empty())
+  {
+    // No frame index, decompress the stream from the beginning until the requested frame is reached
+    if (!this->DecompressionStreamInitialized || frameNumber < this->NextFrameToDecompress)
     {
-      FilePositionOffsetType offset = PixelDataFileOffset + frameNumber * frameSizeInBytes;
-      FSEEK(stream, offset, SEEK_SET);
-      if (fread(&(pixelBuffer[0]), 1, frameSizeInBytes, stream) != frameSizeInBytes)
+      if (this->DecompressionStreamInitialized)
       {
-        //LOG_ERROR("Could not read "<<frameSizeInBytes<<" bytes from "<<GetPixelDataFilePath());
-        //numberOfErrors++;
+        inflateEnd(&this->DecompressionStream);
+        this->DecompressionStreamInitialized = false;
       }
-      if (PlusVideoFrame::GetOrientedClippedImage(&(pixelBuffer[0]), flipInfo, this->ImageType, this->PixelType, this->NumberOfScalarComponents, this->Dimensions, *trackedFrame->GetImageData(), clipRectOrigin, clipRectSize) != PLUS_SUCCESS)
+      this->DecompressionStream.zalloc = Z_NULL;
+      this->DecompressionStream.zfree = Z_NULL;
+      this->DecompressionStream.opaque = Z_NULL;
+      this->DecompressionStream.next_in = Z_NULL;
+      this->DecompressionStream.avail_in = 0;
+      if (inflateInit(&this->DecompressionStream) != Z_OK)
       {
-        LOG_ERROR("Failed to get oriented image from sequence metafile (frame number: " << frameNumber << ")!");
-        numberOfErrors++;
-        continue;
+        LOG_ERROR("Image decompression initialization failed");
+        return PLUS_FAIL;
       }
+      this->DecompressionStreamInitialized = true;
+      this->CompressedDataBuffer.resize(Z_BUFSIZE);
+      this->DecompressionBytesRemaining = this->CompressedDataSize;
+      this->NextFrameToDecompress = 0;
+      FSEEK(this->PixelDataFileHandle, this->PixelDataFileOffset, SEEK_SET);
     }
-    else
+    while (this->NextFrameToDecompress < frameNumber)
     {
-      if (PlusVideoFrame::GetOrientedClippedImage(&(allFramesPixelBuffer[0]) + frameNumber * frameSizeInBytes, flipInfo, this->ImageType, this->PixelType, this->NumberOfScalarComponents, this->Dimensions, *trackedFrame->GetImageData(), clipRectOrigin, clipRectSize) != PLUS_SUCCESS)
+      // skip frames before the requested frame
+      if (this->InflateNextFrame(frameBuffer) != PLUS_SUCCESS)
       {
-        LOG_ERROR("Failed to get oriented image from sequence metafile (frame number: " << frameNumber << ")!");
-        numberOfErrors++;
-        continue;
+        return PLUS_FAIL;
       }
     }
+    return this->InflateNextFrame(frameBuffer);
   }
 
-  fclose(stream);
+  // Frame index is available, decompress only the chunk of the requested frame
+  unsigned long long chunkStart = this->CompressedFrameOffsets[frameNumber];
+  unsigned long long chunkEnd = (frameNumber + 1 < this->CompressedFrameOffsets.size()) ? this->CompressedFrameOffsets[frameNumber + 1] : this->CompressedDataSize;
+  unsigned long long chunkSize = chunkEnd - chunkStart;
+  try
+  {
+    this->CompressedDataBuffer.resize(chunkSize);
+  }
+  catch (std::bad_alloc& e)
+  {
+    cerr << e.what() << endl;
+    LOG_ERROR("Failed to allocate " << chunkSize << " bytes for decompressing frame " << frameNumber);
+    return PLUS_FAIL;
+  }
+  FSEEK(this->PixelDataFileHandle, this->PixelDataFileOffset + chunkStart, SEEK_SET);
+  if (fread(&(this->CompressedDataBuffer[0]), 1, chunkSize, this->PixelDataFileHandle) != chunkSize)
+  {
+    LOG_ERROR("Could not read " << chunkSize << " bytes from " << GetPixelDataFilePath());
+    return PLUS_FAIL;
+  }
 
-  if (numberOfErrors > 0)
+  z_stream strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.next_in = &(this->CompressedDataBuffer[0]);
+  strm.avail_in = static_cast<uInt>(chunkSize);
+  // The first chunk starts with the zlib header, the others contain raw deflate data
+  int ret = (frameNumber == 0) ? inflateInit(&strm) : inflateInit2(&strm, -MAX_WBITS);
+  if (ret != Z_OK)
+  {
+    LOG_ERROR("Image decompression initialization failed (errorCode=" << ret << ")");
+    return PLUS_FAIL;
+  }
+  strm.next_out = frameBuffer;
+  strm.avail_out = static_cast<uInt>(frameSizeInBytes);
+  ret = inflate(&strm, Z_SYNC_FLUSH);
+  inflateEnd(&strm);
+  if ((ret != Z_OK && ret != Z_STREAM_END) || strm.avail_out != 0)
   {
+    LOG_ERROR("Cannot uncompress the pixel data of frame " << frameNumber << " (errorCode=" << ret << ")");
     return PLUS_FAIL;
   }
 
@@ -488,26 +1181,130 @@ PlusStatus vtkPlusMetaImageSequenceIO::ReadImagePixels()
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusMetaImageSequenceIO::PrepareImageFile()
+PlusStatus vtkPlusMetaImageSequenceIO::InflateNextFrame(unsigned char* frameBuffer)
 {
-  if (this->GetUseCompression())
+  z_stream& strm = this->DecompressionStream;
+  strm.next_out = frameBuffer;
+  strm.avail_out = static_cast<uInt>(this->GetFrameSizeInBytes());
+  while (strm.avail_out > 0)
   {
-    // use the default memory allocation routines
-    this->CompressionStream.zalloc = Z_NULL;
-    this->CompressionStream.zfree = Z_NULL;
-    this->CompressionStream.opaque = Z_NULL;
-    int ret = deflateInit(&this->CompressionStream, Z_DEFAULT_COMPRESSION);
-    if (ret != Z_OK)
+    if (strm.avail_in == 0)
+    {
+      if (this->DecompressionBytesRemaining == 0)
+      {
+        LOG_ERROR("Cannot uncompress the pixel data: uncompressed data is less than expected");
+        return PLUS_FAIL;
+      }
+      size_t bytesToRead = static_cast<size_t>(std::min<unsigned long long>(this->CompressedDataBuffer.size(), this->DecompressionBytesRemaining));
+      if (fread(&(this->CompressedDataBuffer[0]), 1, bytesToRead, this->PixelDataFileHandle) != bytesToRead)
+      {
+        LOG_ERROR("Could not read " << bytesToRead << " bytes from " << GetPixelDataFilePath());
+        return PLUS_FAIL;
+      }
+      this->DecompressionBytesRemaining -= bytesToRead;
+      strm.next_in = &(this->CompressedDataBuffer[0]);
+      strm.avail_in = static_cast<uInt>(bytesToRead);
+    }
+    int ret = inflate(&strm, Z_NO_FLUSH);
+    if (ret == Z_STREAM_END && strm.avail_out > 0)
+    {
+      // Files that were appended by multiple writes may contain several consecutive zlib streams
+      ret = inflateReset(&strm);
+    }
+    if (ret != Z_OK && ret != Z_STREAM_END)
     {
-      LOG_ERROR("Image compression initialization failed (errorCode=" << ret << ")");
+      LOG_ERROR("Cannot uncompress the pixel data (errorCode=" << ret << ")");
       return PLUS_FAIL;
     }
   }
+  this->NextFrameToDecompress++;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMetaImageSequenceIO::ReadFrameImageData(unsigned int frameNumber, PlusVideoFrame& frame)
+{
+  if (this->PixelDataFileHandle == NULL)
+  {
+    LOG_ERROR("Cannot read image data of frame " << frameNumber << ": pixel data file is not open. Read the file with LoadImageDataOnDemand enabled first.");
+    return PLUS_FAIL;
+  }
+  if (frameNumber >= this->Dimensions[3])
+  {
+    LOG_ERROR("Cannot read image data of frame " << frameNumber << ": the sequence contains " << this->Dimensions[3] << " frames");
+    return PLUS_FAIL;
+  }
+  if (!this->IsFrameImageValid(frameNumber))
+  {
+    LOG_DEBUG("Frame #" << frameNumber << " image data is invalid");
+    return PLUS_FAIL;
+  }
+
+  PlusVideoFrame::FlipInfoType flipInfo;
+  if (PlusVideoFrame::GetFlipAxes(this->ImageOrientationInFile, this->ImageType, this->ImageOrientationInMemory, flipInfo) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to convert image data to the requested orientation, from " << PlusVideoFrame::GetStringFromUsImageOrientation(this->ImageOrientationInFile) <<
+              " to " << PlusVideoFrame::GetStringFromUsImageOrientation(this->ImageOrientationInMemory));
+    return PLUS_FAIL;
+  }
+
+  frame.SetImageOrientation(this->ImageOrientationInMemory);
+  frame.SetImageType(this->ImageType);
+  if (frame.AllocateFrame(this->Dimensions, this->PixelType, this->NumberOfScalarComponents) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Cannot allocate memory for frame " << frameNumber);
+    return PLUS_FAIL;
+  }
+
+  if (this->ReadFramePixels(frameNumber, &(this->FramePixelBuffer[0])) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read pixel data from sequence metafile (frame number: " << frameNumber << ")!");
+    return PLUS_FAIL;
+  }
+
+  int clipRectOrigin[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
+  int clipRectSize[3] = {PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP};
+  if (PlusVideoFrame::GetOrientedClippedImage(&(this->FramePixelBuffer[0]), flipInfo, this->ImageType, this->PixelType, this->NumberOfScalarComponents, this->Dimensions, frame, clipRectOrigin, clipRectSize) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get oriented image from sequence metafile (frame number: " << frameNumber << ")!");
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusMetaImageSequenceIO::IsFrameRandomAccessSupported()
+{
+  return !this->UseCompression || !this->CompressedFrameOffsets.empty();
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusMetaImageSequenceIO::IsFrameImageValid(unsigned int frameNumber)
+{
+  return frameNumber >= this->FrameImageValid.size() || this->FrameImageValid[frameNumber];
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMetaImageSequenceIO::PrepareImageFile()
+{
   if (FileOpen(&this->OutputImageFileHandle, this->TempImageFileName.c_str(), "ab+") != PLUS_SUCCESS)
   {
     LOG_ERROR("Unable to open output stream for writing.");
     return PLUS_FAIL;
   }
+  if (this->GetUseCompression())
+  {
+    // The compression stream is started here and finished in Close, so that frames
+    // that are written by multiple WriteImages calls still end up in a single zlib stream
+    this->CompressedFrameOffsets.clear();
+    if (this->BeginCompressionStream(PlusParallelDeflate::ZLIB_STREAM) != PLUS_SUCCESS)
+    {
+      fclose(this->OutputImageFileHandle);
+      this->OutputImageFileHandle = NULL;
+      return PLUS_FAIL;
+    }
+  }
 
   return PLUS_SUCCESS;
 }
@@ -617,11 +1414,13 @@ PlusStatus vtkPlusMetaImageSequenceIO::WriteInitialImageHeader()
       compDataSize += " ";
     }
     SetCustomString(SEQMETA_FIELD_COMPRESSED_DATA_SIZE, compDataSize);   // add spaces so that later the field can be updated with larger values
+    SetCustomString(SEQMETA_FIELD_COMPRESSED_DATA_FRAME_INDEX, "True");
   }
   else
   {
     SetCustomString("CompressedData", "False");
     SetCustomString(SEQMETA_FIELD_COMPRESSED_DATA_SIZE, (const char*)(NULL));
+    SetCustomString(SEQMETA_FIELD_COMPRESSED_DATA_FRAME_INDEX, (const char*)(NULL));
   }
 
   unsigned int frameSize[3] = {0, 0, 0};
@@ -924,110 +1723,42 @@ PlusStatus vtkPlusMetaImageSequenceIO::WriteCompressedImagePixelsToFile(int& com
 {
   LOG_DEBUG("Writing compressed pixel data into file started");
 
-  compressedDataSize = 0;
-
-  const int outputBufferSize = 16384; // can be any number, just picked a value from a zlib example
-  unsigned char outputBuffer[outputBufferSize];
-
-  z_stream strm; // stream describing the compression state
-
-  // use the default memory allocation routines
-  strm.zalloc = Z_NULL;
-  strm.zfree = Z_NULL;
-  strm.opaque = Z_NULL;
-  int ret = deflateInit(&strm, Z_DEFAULT_COMPRESSION);
-  if (ret != Z_OK)
-  {
-    LOG_ERROR("Image compression initialization failed (errorCode=" << ret << ")");
-    return PLUS_FAIL;
-  }
-
-  // Create a blank frame if we have to write an invalid frame to metafile
-  PlusVideoFrame blankFrame;
-  if (blankFrame.AllocateFrame(this->Dimensions, this->PixelType, this->NumberOfScalarComponents) != PLUS_SUCCESS)
+  // Each frame is compressed independently (on multiple threads), so each frame can be decompressed
+  // on its own (random access). The offsets are relative to the start of the compressed data.
+  if (this->WriteCompressedFrames(&this->CompressedFrameOffsets, compressedDataSize) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Failed to allocate space for blank image.");
     return PLUS_FAIL;
   }
-  blankFrame.FillBlank();
-
-  for (unsigned int frameNumber = 0; frameNumber < this->TrackedFrameList->GetNumberOfTrackedFrames(); frameNumber++)
-  {
-    PlusTrackedFrame* trackedFrame(NULL);
-
-    if (this->EnableImageDataWrite)
-    {
-      trackedFrame = this->TrackedFrameList->GetTrackedFrame(frameNumber);
-      if (trackedFrame == NULL)
-      {
-        LOG_ERROR("Cannot access frame " << frameNumber << " while trying to writing compress data into file");
-        deflateEnd(&strm);
-        return PLUS_FAIL;
-      }
-    }
-
-    PlusVideoFrame* videoFrame = &blankFrame;
-    if (this->EnableImageDataWrite)
-    {
-      if (trackedFrame->GetImageData()->IsImageValid())
-      {
-        videoFrame = trackedFrame->GetImageData();
-      }
-    }
-
-    strm.next_in = (Bytef*)videoFrame->GetScalarPointer();
-    strm.avail_in = videoFrame->GetFrameSizeInBytes();
-
-    // Note: it's possible to request to consume all inputs and delete all history after each frame writing to allow random access
-    int flush = (frameNumber < this->TrackedFrameList->GetNumberOfTrackedFrames() - 1) ? Z_NO_FLUSH : Z_FINISH;
 
-    // run deflate() on input until output buffer not full, finish
-    // compression if all of source has been read in
-    do
-    {
-      strm.avail_out = outputBufferSize;
-      strm.next_out = outputBuffer;
-
-      ret = deflate(&strm, flush);    /* no bad return value */
-      if (ret == Z_STREAM_ERROR)
-      {
-        // state clobbered
-        LOG_ERROR("Zlib state became invalid during the compression process (errorCode=" << ret << ")");
-        deflateEnd(&strm);   // clean up
-        return PLUS_FAIL;
-      }
-
-      size_t numberOfBytesReadyForWriting = outputBufferSize - strm.avail_out;
-      size_t numberOfBytesWritten = 0;
-      if (PlusCommon::RobustFwrite(this->OutputImageFileHandle, outputBuffer, numberOfBytesReadyForWriting, numberOfBytesWritten) != PLUS_SUCCESS)
-      {
-        LOG_ERROR("Error writing compressed data into file");
-        deflateEnd(&strm);   // clean up
-        return PLUS_FAIL;
-      }
-      compressedDataSize += numberOfBytesWritten;
+  LOG_DEBUG("Writing compressed pixel data into file completed");
 
-    }
-    while (strm.avail_out == 0);
+  return PLUS_SUCCESS;
+}
 
-    if (strm.avail_in != 0)
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMetaImageSequenceIO::WriteCompressedFrameIndex()
+{
+  std::vector<unsigned char> frameIndexBuffer(this->CompressedFrameOffsets.size() * COMPRESSED_FRAME_INDEX_ENTRY_SIZE);
+  for (size_t frameNumber = 0; frameNumber < this->CompressedFrameOffsets.size(); frameNumber++)
+  {
+    unsigned long long offset = this->CompressedFrameOffsets[frameNumber];
+    for (int byteIndex = 0; byteIndex < COMPRESSED_FRAME_INDEX_ENTRY_SIZE; byteIndex++)
     {
-      // state clobbered (by now all input should have been consumed)
-      LOG_ERROR("Zlib state became invalid during the compression process");
-      deflateEnd(&strm);   // clean up
-      return PLUS_FAIL;
+      frameIndexBuffer[frameNumber * COMPRESSED_FRAME_INDEX_ENTRY_SIZE + byteIndex] = static_cast<unsigned char>(offset & 0xFF);
+      offset >>= 8;
     }
   }
-
-  deflateEnd(&strm);   // clean up
-
-  LOG_DEBUG("Writing compressed pixel data into file completed");
-
-  if (ret != Z_STREAM_END)
+  if (frameIndexBuffer.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+  size_t numberOfBytesWritten = 0;
+  if (PlusCommon::RobustFwrite(this->OutputImageFileHandle, &(frameIndexBuffer[0]), frameIndexBuffer.size(), numberOfBytesWritten) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Error occurred during compressing image data into file");
+    LOG_ERROR("Error writing compressed frame index into file");
     return PLUS_FAIL;
   }
+  this->TotalBytesWritten += numberOfBytesWritten;
   return PLUS_SUCCESS;
 }
 
@@ -1304,6 +2035,21 @@ PlusStatus vtkPlusMetaImageSequenceIO::Close()
   // Update fields that are known only at the end of the processing
   if (this->GetUseCompression())
   {
+    // Finish the compression stream (all frames have been already written, only the stream trailer is written)
+    if (this->EndCompressionStream() != PLUS_SUCCESS)
+    {
+      fclose(this->OutputImageFileHandle);
+      return PLUS_FAIL;
+    }
+
+    // The frame index is stored after the compressed data, so readers that are not aware of it just ignore it
+    if (this->WriteCompressedFrameIndex() != PLUS_SUCCESS)
+    {
+      fclose(this->OutputImageFileHandle);
+      return PLUS_FAIL;
+    }
+    this->CompressedFrameOffsets.clear();
+
     std::stringstream ss;
     ss << this->CompressedBytesWritten;
     this->SetCustomString(SEQMETA_FIELD_COMPRESSED_DATA_SIZE, ss.str().c_str());
@@ -1311,7 +2057,6 @@ PlusStatus vtkPlusMetaImageSequenceIO::Close()
     {
       return PLUS_FAIL;
     }
-    deflateEnd(&this->CompressionStream);   // clean up
   }
 
   fclose(this->OutputImageFileHandle);
@@ -16,11 +16,30 @@
 #include "vtkPlusSequenceIOBase.h"
 #include "itk_zlib.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
 class vtkPlusTrackedFrameList;
 
 /*!
   \class vtkPlusMetaImageSequenceIO
   \brief Read and write MetaImage file with a sequence of frames, with additional information for each frame
+
+  Compressed pixel data is written as a single zlib stream (so that any MetaImage reader can open the file),
+  but the compressor is fully flushed at the end of each frame, which makes each frame independently decodable.
+  The offset of each frame within the compressed data is stored in a frame index right after the compressed data
+  (indicated by the CompressedDataFrameIndex header field), therefore any frame can be read without decompressing
+  the preceding frames. Files without a frame index are decompressed sequentially, with a fixed-size buffer.
+  Since frames are compressed independently, they are compressed on multiple threads (see NumberOfCompressionThreads).
+
+  The header is parsed in place, in large blocks, without creating temporary strings for each line. Frame field names
+  are looked up in the field name table only when they differ from the field names of the previous frame.
+  If UseHeaderIndexFile is enabled then the parsed header (header fields, frame fields, binary frame transforms and
+  pixel data location) is also saved in a binary index file next to the sequence file (see GetHeaderIndexFileName),
+  and subsequent reads load the index instead of parsing the text header. The index is regenerated automatically
+  when the size or modification time of the sequence file or the contents of its text header change.
+
   \ingroup PlusLibCommon
 */
 class vtkPlusCommonExport vtkPlusMetaImageSequenceIO : public vtkPlusSequenceIOBase
@@ -74,13 +93,51 @@ public:
   */
   virtual PlusStatus SetFileName(const std::string& aFilename);
 
+  /*! Decode the pixel data of a single frame. Requires a preceding Read() with LoadImageDataOnDemand enabled. */
+  virtual PlusStatus ReadFrameImageData(unsigned int frameNumber, PlusVideoFrame& frame);
+
+  /*! Returns true if the pixel data is uncompressed or compressed with a frame index */
+  virtual bool IsFrameRandomAccessSupported();
+
+  /*! Returns false if the ImageStatus field of the frame indicated that it has no valid image data */
+  virtual bool IsFrameImageValid(unsigned int frameNumber);
+
+  /*!
+    If enabled then the header is read from the binary header index file (if it is up to date) and the index file
+    is created or updated after the text header is parsed. Failure to write the index file is not an error. Default: false.
+  */
+  vtkGetMacro(UseHeaderIndexFile, bool);
+  vtkSetMacro(UseHeaderIndexFile, bool);
+  vtkBooleanMacro(UseHeaderIndexFile, bool);
+
+  /*! Name of the binary header index file (sequence file name with .plusidx appended) */
+  std::string GetHeaderIndexFileName();
+
 protected:
   vtkPlusMetaImageSequenceIO();
   virtual ~vtkPlusMetaImageSequenceIO();
 
+  /*! Name and value of the header fields (fields that do not belong to a frame), in the order they appear in the file */
+  typedef std::vector< std::pair<std::string, std::string> > HeaderFieldListType;
+
   /*! Read all the fields in the metaimage file header */
   virtual PlusStatus ReadImageHeader();
 
+  /*!
+    Parse the text header of the metaimage file and store the header fields in headerFields.
+    headerSize returns the length of the text header in bytes (up to and including the ElementDataFile line).
+  */
+  PlusStatus ParseImageHeader(HeaderFieldListType& headerFields, unsigned long long& headerSize);
+
+  /*! Compute the hash of the first headerSize bytes of the metaimage file, used for detecting modified headers */
+  PlusStatus GetHeaderHash(unsigned long long headerSize, unsigned long long& headerHash);
+
+  /*! Read the header from the header index file. Fails if the index file is missing, invalid, or out of date. */
+  PlusStatus ReadHeaderIndexFile();
+
+  /*! Write the header fields and the frame fields read from the text header (of headerSize bytes) into the header index file */
+  PlusStatus WriteHeaderIndexFile(const HeaderFieldListType& headerFields, unsigned long long headerSize);
+
   /*! Read pixel data from the metaimage */
   virtual PlusStatus ReadImagePixels();
 
@@ -98,6 +155,24 @@ protected:
   */
   virtual PlusStatus WriteCompressedImagePixelsToFile(int& compressedDataSize);
 
+  /*! Open the pixel data file for reading and load the compressed frame index (if available) */
+  PlusStatus OpenPixelDataFileForReading();
+
+  /*! Close the pixel data file and release decompression resources */
+  void ClosePixelDataFileForReading();
+
+  /*! Read the pixel data of a frame (as stored in the file) into the provided buffer of GetFrameSizeInBytes() bytes */
+  PlusStatus ReadFramePixels(unsigned int frameNumber, unsigned char* frameBuffer);
+
+  /*! Decompress the next frame from the sequentially decompressed stream, used if there is no compressed frame index */
+  PlusStatus InflateNextFrame(unsigned char* frameBuffer);
+
+  /*! Write the compressed frame index after the compressed pixel data */
+  PlusStatus WriteCompressedFrameIndex();
+
+  /*! Size of one frame in the pixel data file, in bytes */
+  unsigned long long GetFrameSizeInBytes();
+
   /*! Conversion between ITK and METAIO pixel types */
   PlusStatus ConvertMetaElementTypeToVtkPixelType(const std::string& elementTypeStr, PlusCommon::VTKScalarPixelType& vtkPixelType);
   /*! Conversion between ITK and METAIO pixel types */
@@ -108,8 +183,28 @@ private:
   bool IsPixelDataBinary;
   /*! If 2D data, boolean to determine if we should write out in the form X Y Nfr (false) or X Y 1 Nfr (true) */
   bool Output2DDataWithZDimensionIncluded;
-  /*! compression stream handle for compression streaming */
-  z_stream CompressionStream;
+  /*! Read the header from, and save the parsed header into, the binary header index file */
+  bool UseHeaderIndexFile;
+  /*! Start position of each frame within the compressed pixel data, relative to the first byte of the compressed data */
+  std::vector<unsigned long long> CompressedFrameOffsets;
+  /*! Size of the compressed pixel data in the file being read */
+  unsigned long long CompressedDataSize;
+  /*! Pixel data file handle, kept open while frames are read on demand */
+  FILE* PixelDataFileHandle;
+  /*! Image status of each frame, read from the frame fields (only used when frames are read on demand) */
+  std::vector<bool> FrameImageValid;
+  /*! Buffer for storing compressed data of a frame or the input of the sequential decompressor */
+  std::vector<unsigned char> CompressedDataBuffer;
+  /*! Buffer for storing the pixel data of a frame as it is stored in the file */
+  std::vector<unsigned char> FramePixelBuffer;
+  /*! Decompression stream used if the compressed data has no frame index (frames can only be decompressed sequentially) */
+  z_stream DecompressionStream;
+  /*! True if DecompressionStream is initialized */
+  bool DecompressionStreamInitialized;
+  /*! Number of compressed bytes that have not been read yet by the sequential decompressor */
+  unsigned long long DecompressionBytesRemaining;
+  /*! Frame number that the sequential decompressor will return next */
+  unsigned int NextFrameToDecompress;
 
 protected:
   vtkPlusMetaImageSequenceIO(const vtkPlusMetaImageSequenceIO&); //purposely not implemented
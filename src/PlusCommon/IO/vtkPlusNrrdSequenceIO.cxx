@@ -22,6 +22,7 @@ See License.txt for details.
 
 #include "PlusTrackedFrame.h"
 #include "vtkObjectFactory.h"
+#include "vtkPlusMemoryMappedFile.h"
 #include "vtkPlusTrackedFrameList.h"
 #include "vtksys/SystemTools.hxx"
 
@@ -54,7 +55,6 @@ vtkStandardNewMacro(vtkPlusNrrdSequenceIO);
 vtkPlusNrrdSequenceIO::vtkPlusNrrdSequenceIO()
   : vtkPlusSequenceIOBase()
   , Encoding(NRRD_ENCODING_RAW)
-  , CompressionStream(NULL)
 {
 }
 
@@ -430,8 +430,19 @@ PlusStatus vtkPlusNrrdSequenceIO::ReadImagePixels()
     gzclose(gzStream);
   }
 
+  // If the pixel data file is memory mapped then the frames reference the pixels in the file instead of a copy
+  vtkSmartPointer<vtkPlusMemoryMappedFile> mappedPixelDataFile;
+  PlusVideoFrame::FlipInfoType mappingFlipInfo;
+  if (PlusVideoFrame::GetFlipAxes(this->ImageOrientationInFile, this->ImageType, this->ImageOrientationInMemory, mappingFlipInfo) == PLUS_SUCCESS)
+  {
+    mappedPixelDataFile = this->MapPixelDataFile(mappingFlipInfo, frameSizeInBytes, frameCount);
+  }
+
   std::vector<unsigned char> pixelBuffer;
-  pixelBuffer.resize(frameSizeInBytes);
+  if (mappedPixelDataFile == NULL)
+  {
+    pixelBuffer.resize(frameSizeInBytes);
+  }
   for (int frameNumber = 0; frameNumber < frameCount; frameNumber++)
   {
     this->CreateTrackedFrameIfNonExisting(frameNumber);
@@ -456,6 +467,16 @@ PlusStatus vtkPlusNrrdSequenceIO::ReadImagePixels()
       }
     }
 
+    if (mappedPixelDataFile != NULL)
+    {
+      if (this->SetFramePixelsFromMappedFile(trackedFrame, mappedPixelDataFile, frameNumber, frameSizeInBytes) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to set memory mapped pixel data of frame " << frameNumber);
+        numberOfErrors++;
+      }
+      continue;
+    }
+
     trackedFrame->GetImageData()->SetImageOrientation(this->ImageOrientationInMemory);
     trackedFrame->GetImageData()->SetImageType(this->ImageType);
 
@@ -520,22 +541,16 @@ PlusStatus vtkPlusNrrdSequenceIO::ReadImagePixels()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusNrrdSequenceIO::PrepareImageFile()
 {
-  if (this->GetUseCompression())
+  if (FileOpen(&this->OutputImageFileHandle, this->TempImageFileName.c_str(), "ab+") != PLUS_SUCCESS)
   {
-    this->CompressionStream = gzopen(this->TempImageFileName.c_str(), "ab");
-
-    int error;
-    gzerror(this->CompressionStream, &error);
-
-    if (error != Z_OK)
-    {
-      LOG_ERROR("Unable to open compressed file for writing.");
-      return PLUS_FAIL;
-    }
+    LOG_ERROR("Unable to open output stream for writing.");
+    return PLUS_FAIL;
   }
-  else if (FileOpen(&this->OutputImageFileHandle, this->TempImageFileName.c_str(), "ab+") != PLUS_SUCCESS)
+  // Frames are compressed on multiple threads and written as a single gzip stream, which is finished in Close
+  if (this->GetUseCompression() && this->BeginCompressionStream(PlusParallelDeflate::GZIP_STREAM) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Unable to open output stream for writing.");
+    fclose(this->OutputImageFileHandle);
+    this->OutputImageFileHandle = NULL;
     return PLUS_FAIL;
   }
 
@@ -847,13 +862,15 @@ PlusStatus vtkPlusNrrdSequenceIO::FinalizeHeader()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusNrrdSequenceIO::Close()
 {
+  PlusStatus status = PLUS_SUCCESS;
   if (this->GetUseCompression())
   {
-    gzclose(this->CompressionStream);
+    status = this->EndCompressionStream();
   }
-  else
+  fclose(this->OutputImageFileHandle);
+  if (status != PLUS_SUCCESS)
   {
-    fclose(this->OutputImageFileHandle);
+    return PLUS_FAIL;
   }
 
   return Superclass::Close();
@@ -864,58 +881,10 @@ PlusStatus vtkPlusNrrdSequenceIO::WriteCompressedImagePixelsToFile(int& compress
 {
   LOG_DEBUG("Writing compressed pixel data into file started");
 
-  compressedDataSize = 0;
-
-  // Create a blank frame if we have to write an invalid frame to file
-  PlusVideoFrame blankFrame;
-  if (blankFrame.AllocateFrame(this->Dimensions, this->PixelType, this->NumberOfScalarComponents) != PLUS_SUCCESS)
+  if (this->WriteCompressedFrames(NULL, compressedDataSize) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Failed to allocate space for blank image.");
     return PLUS_FAIL;
   }
-  blankFrame.FillBlank();
-
-  for (unsigned int frameNumber = 0; frameNumber < this->TrackedFrameList->GetNumberOfTrackedFrames(); frameNumber++)
-  {
-    PlusTrackedFrame* trackedFrame(NULL);
-
-    if (this->EnableImageDataWrite)
-    {
-      trackedFrame = this->TrackedFrameList->GetTrackedFrame(frameNumber);
-      if (trackedFrame == NULL)
-      {
-        LOG_ERROR("Cannot access frame " << frameNumber << " while trying to writing compress data into file");
-        gzclose(this->CompressionStream);
-        return PLUS_FAIL;
-      }
-    }
-
-    PlusVideoFrame* videoFrame = &blankFrame;
-    if (this->EnableImageDataWrite)
-    {
-      if (trackedFrame->GetImageData()->IsImageValid())
-      {
-        videoFrame = trackedFrame->GetImageData();
-      }
-    }
-
-    size_t numberOfBytesReadyForWriting = videoFrame->GetFrameSizeInBytes();
-    if (gzwrite(this->CompressionStream, (Bytef*)videoFrame->GetScalarPointer(), numberOfBytesReadyForWriting) != numberOfBytesReadyForWriting)
-    {
-      LOG_ERROR("Error writing compressed data into file");
-      gzclose(this->CompressionStream);
-      return PLUS_FAIL;
-    }
-    int errnum;
-    gzerror(this->CompressionStream, &errnum);
-    if (errnum != Z_OK)
-    {
-      LOG_ERROR("Error writing compressed data into file. errnum: " << errnum);
-      gzclose(this->CompressionStream);
-      return PLUS_FAIL;
-    }
-    compressedDataSize += numberOfBytesReadyForWriting;
-  }
 
   LOG_DEBUG("Writing compressed pixel data into file completed");
 
@@ -127,9 +127,6 @@ protected:
   /*! Nrrd encoding type */
   NrrdEncoding Encoding;
 
-  /*! file handle for the compression stream */
-  gzFile CompressionStream;
-
 private:
   vtkPlusNrrdSequenceIO( const vtkPlusNrrdSequenceIO& ); //purposely not implemented
   void operator=( const vtkPlusNrrdSequenceIO& ); //purposely not implemented
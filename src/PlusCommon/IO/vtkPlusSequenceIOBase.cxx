@@ -6,6 +6,7 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "vtkObjectFactory.h"
+#include "vtkPlusMemoryMappedFile.h"
 #include "vtkPlusSequenceIOBase.h"
 #include "vtkPlusTrackedFrameList.h"
 #include "vtksys/SystemTools.hxx"
@@ -25,12 +26,22 @@ See License.txt for details.
 
 vtkCxxSetObjectMacro( vtkPlusSequenceIOBase, TrackedFrameList, vtkPlusTrackedFrameList );
 
+namespace
+{
+  int DefaultNumberOfCompressionThreads = 0;
+  bool DefaultUseMemoryMapping = false;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusSequenceIOBase::vtkPlusSequenceIOBase()
   : TrackedFrameList( vtkPlusTrackedFrameList::New() )
   , UseCompression( false )
   , CompressedBytesWritten( 0 )
+  , NumberOfCompressionThreads( DefaultNumberOfCompressionThreads )
+  , Compressor( new PlusParallelDeflate )
   , EnableImageDataWrite( true )
+  , LoadImageDataOnDemand( false )
+  , UseMemoryMapping( DefaultUseMemoryMapping )
   , PixelType( VTK_VOID )
   , NumberOfScalarComponents( 1 )
   , IsDataTimeSeries(true)
@@ -57,6 +68,81 @@ vtkPlusSequenceIOBase::~vtkPlusSequenceIOBase()
   {
     this->SetTrackedFrameList( NULL );
   }
+  delete this->Compressor;
+  this->Compressor = NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSequenceIOBase::SetDefaultNumberOfCompressionThreads( int numberOfThreads )
+{
+  DefaultNumberOfCompressionThreads = numberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusSequenceIOBase::GetDefaultNumberOfCompressionThreads()
+{
+  return DefaultNumberOfCompressionThreads;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSequenceIOBase::SetDefaultUseMemoryMapping( bool useMemoryMapping )
+{
+  DefaultUseMemoryMapping = useMemoryMapping;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusSequenceIOBase::GetDefaultUseMemoryMapping()
+{
+  return DefaultUseMemoryMapping;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPlusMemoryMappedFile> vtkPlusSequenceIOBase::MapPixelDataFile( const PlusVideoFrame::FlipInfoType& flipInfo, unsigned long long frameSizeInBytes, unsigned int frameCount )
+{
+  if ( !this->UseMemoryMapping || frameSizeInBytes == 0 || frameCount == 0 )
+  {
+    return NULL;
+  }
+  if ( this->UseCompression )
+  {
+    LOG_DEBUG( "Pixel data of " << this->FileName << " is compressed, frames are read into memory instead of memory mapping" );
+    return NULL;
+  }
+  if ( flipInfo.hFlip || flipInfo.vFlip || flipInfo.eFlip || flipInfo.tranpose != PlusVideoFrame::TRANSPOSE_NONE )
+  {
+    LOG_DEBUG( "Pixel data of " << this->FileName << " has to be reoriented, frames are read into memory instead of memory mapping" );
+    return NULL;
+  }
+  if ( this->PixelDataFileOffset % PlusVideoFrame::GetNumberOfBytesPerScalar( this->PixelType ) != 0 )
+  {
+    // pixels would not be aligned to their natural boundary
+    LOG_DEBUG( "Pixel data of " << this->FileName << " is not aligned, frames are read into memory instead of memory mapping" );
+    return NULL;
+  }
+
+  vtkSmartPointer<vtkPlusMemoryMappedFile> mappedFile = vtkSmartPointer<vtkPlusMemoryMappedFile>::New();
+  if ( mappedFile->Open( this->GetPixelDataFilePath() ) != PLUS_SUCCESS )
+  {
+    LOG_WARNING( "Failed to memory map " << this->GetPixelDataFilePath() << ", frames are read into memory" );
+    return NULL;
+  }
+  if ( mappedFile->GetSize() < static_cast<unsigned long long>( this->PixelDataFileOffset ) + frameSizeInBytes * frameCount )
+  {
+    LOG_WARNING( "Pixel data file " << this->GetPixelDataFilePath() << " is shorter than expected, frames are read into memory" );
+    return NULL;
+  }
+
+  LOG_DEBUG( "Pixel data file " << this->GetPixelDataFilePath() << " is memory mapped" );
+  return mappedFile;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceIOBase::SetFramePixelsFromMappedFile( PlusTrackedFrame* trackedFrame, vtkPlusMemoryMappedFile* mappedFile, unsigned int frameNumber, unsigned long long frameSizeInBytes )
+{
+  trackedFrame->GetImageData()->SetImageOrientation( this->ImageOrientationInMemory );
+  trackedFrame->GetImageData()->SetImageType( this->ImageType );
+  unsigned char* framePixels = mappedFile->GetData() + this->PixelDataFileOffset + frameSizeInBytes * frameNumber;
+  return trackedFrame->GetImageData()->SetExternalPixelData( this->Dimensions, this->PixelType, this->NumberOfScalarComponents, framePixels, mappedFile );
 }
 
 //----------------------------------------------------------------------------
@@ -338,24 +424,28 @@ PlusStatus vtkPlusSequenceIOBase::WriteImages()
   {
     if ( imageDataAvailable )
     {
-      // Create a blank frame if we have to write an invalid frame to sequence file
+      // Blank frame, only allocated if we have to write an invalid frame to sequence file
+      // (frames are often written in small batches, so avoid allocating a full frame for each batch)
       PlusVideoFrame blankFrame;
-      if ( blankFrame.AllocateFrame( this->Dimensions, this->PixelType, this->NumberOfScalarComponents ) != PLUS_SUCCESS )
-      {
-        LOG_ERROR( "Failed to allocate space for blank image." );
-        return PLUS_FAIL;
-      }
-      blankFrame.FillBlank();
 
       // not compressed
       for ( unsigned int frameNumber = 0; frameNumber < this->TrackedFrameList->GetNumberOfTrackedFrames(); frameNumber++ )
       {
         PlusTrackedFrame* trackedFrame = this->TrackedFrameList->GetTrackedFrame( frameNumber );
 
-        PlusVideoFrame* videoFrame = &blankFrame;
-        if ( this->EnableImageDataWrite && trackedFrame->GetImageData()->IsImageValid() )
+        PlusVideoFrame* videoFrame = trackedFrame->GetImageData();
+        if ( !this->EnableImageDataWrite || !videoFrame->IsImageValid() )
         {
-          videoFrame = trackedFrame->GetImageData();
+          if ( !blankFrame.IsImageValid() )
+          {
+            if ( blankFrame.AllocateFrame( this->Dimensions, this->PixelType, this->NumberOfScalarComponents ) != PLUS_SUCCESS )
+            {
+              LOG_ERROR( "Failed to allocate space for blank image." );
+              return PLUS_FAIL;
+            }
+            blankFrame.FillBlank();
+          }
+          videoFrame = &blankFrame;
         }
 
         size_t writtenSize = 0;
@@ -392,6 +482,87 @@ PlusStatus vtkPlusSequenceIOBase::WriteImages()
   return result;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceIOBase::BeginCompressionStream( PlusParallelDeflate::StreamFormat format )
+{
+  this->Compressor->SetNumberOfThreads( this->NumberOfCompressionThreads );
+  if ( this->Compressor->BeginStream( this->OutputImageFileHandle, format ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Image compression initialization failed" );
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceIOBase::WriteCompressedFrames( std::vector<unsigned long long>* frameOffsets, int& compressedDataSize )
+{
+  compressedDataSize = 0;
+
+  // Blank frame, only allocated if we have to write an invalid frame to sequence file
+  PlusVideoFrame blankFrame;
+
+  std::vector<PlusParallelDeflate::Block> blocks;
+  blocks.reserve( this->TrackedFrameList->GetNumberOfTrackedFrames() );
+  for ( unsigned int frameNumber = 0; frameNumber < this->TrackedFrameList->GetNumberOfTrackedFrames(); frameNumber++ )
+  {
+    PlusVideoFrame* videoFrame = NULL;
+    if ( this->EnableImageDataWrite )
+    {
+      PlusTrackedFrame* trackedFrame = this->TrackedFrameList->GetTrackedFrame( frameNumber );
+      if ( trackedFrame == NULL )
+      {
+        LOG_ERROR( "Cannot access frame " << frameNumber << " while trying to writing compress data into file" );
+        return PLUS_FAIL;
+      }
+      if ( trackedFrame->GetImageData()->IsImageValid() )
+      {
+        videoFrame = trackedFrame->GetImageData();
+      }
+    }
+    if ( videoFrame == NULL )
+    {
+      if ( !blankFrame.IsImageValid() )
+      {
+        if ( blankFrame.AllocateFrame( this->Dimensions, this->PixelType, this->NumberOfScalarComponents ) != PLUS_SUCCESS )
+        {
+          LOG_ERROR( "Failed to allocate space for blank image." );
+          return PLUS_FAIL;
+        }
+        blankFrame.FillBlank();
+      }
+      videoFrame = &blankFrame;
+    }
+    blocks.push_back( PlusParallelDeflate::Block( videoFrame->GetScalarPointer(), videoFrame->GetFrameSizeInBytes() ) );
+  }
+
+  unsigned long long compressedBytesBefore = this->Compressor->GetNumberOfCompressedBytes();
+  PlusStatus status = this->Compressor->WriteBlocks( blocks, frameOffsets );
+  compressedDataSize = static_cast<int>( this->Compressor->GetNumberOfCompressedBytes() - compressedBytesBefore );
+  if ( status != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Error writing compressed data into file" );
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceIOBase::EndCompressionStream()
+{
+  unsigned long long compressedBytesBefore = this->Compressor->GetNumberOfCompressedBytes();
+  PlusStatus status = this->Compressor->EndStream();
+  unsigned long long numberOfBytesWritten = this->Compressor->GetNumberOfCompressedBytes() - compressedBytesBefore;
+  this->TotalBytesWritten += numberOfBytesWritten;
+  this->CompressedBytesWritten += numberOfBytesWritten;
+  if ( status != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Error occurred during compressing image data into file" );
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusSequenceIOBase::MoveFileInternal( const char* oldname, const char* newname )
 {
@@ -472,6 +643,19 @@ PlusTrackedFrame* vtkPlusSequenceIOBase::GetTrackedFrame( int frameNumber )
   return trackedFrame;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSequenceIOBase::ReadFrameImageData( unsigned int frameNumber, PlusVideoFrame& frame )
+{
+  LOG_ERROR( "Reading image data on demand is not supported for file " << this->FileName );
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusSequenceIOBase::IsFrameRandomAccessSupported()
+{
+  return false;
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusSequenceIOBase::GetMaximumImageDimensions( unsigned int maxFrameSize[3] )
 {
@@ -569,13 +753,13 @@ PlusStatus vtkPlusSequenceIOBase::AppendFile( const std::string& sourceFilename,
   }
   else
   {
-    const int BUFFER_SIZE = 32000;
+    // Long recordings may contain many gigabytes of pixel data, so copy in large blocks
+    const int BUFFER_SIZE = 4 * 1024 * 1024;
     char* buffer = new char[BUFFER_SIZE];
     size_t len = 0 ;
     while( ( len = fread( buffer, 1, BUFFER_SIZE, in ) ) > 0 )
     {
       fwrite( buffer, 1, len, out ) ;
-      memset( buffer, 0, BUFFER_SIZE );
     }
     fclose( in );
     fclose( out );
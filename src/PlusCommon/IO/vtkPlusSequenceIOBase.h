@@ -9,9 +9,12 @@
 
 #include "PlusCommon.h"
 #include "vtkPlusCommonExport.h"
+#include "PlusParallelDeflate.h"
 #include "PlusVideoFrame.h"
 #include "vtkObject.h"
+#include "vtkSmartPointer.h"
 
+class vtkPlusMemoryMappedFile;
 class vtkPlusTrackedFrameList;
 class PlusTrackedFrame;
 
@@ -95,6 +98,16 @@ public:
   /*! Returns a pointer to a single frame */
   virtual PlusTrackedFrame* GetTrackedFrame( int frameNumber );
 
+  /*!
+    Decode the pixel data of a single frame into the provided video frame.
+    Requires a preceding Read() with LoadImageDataOnDemand enabled. The frame is allocated if its size or type does not match.
+    Returns PLUS_FAIL if the frame has no valid image data or the file format does not support reading frames on demand.
+  */
+  virtual PlusStatus ReadFrameImageData( unsigned int frameNumber, PlusVideoFrame& frame );
+
+  /*! Returns true if any frame can be decoded by ReadFrameImageData without decoding the preceding frames */
+  virtual bool IsFrameRandomAccessSupported();
+
   /*! Close the sequence */
   virtual PlusStatus Close();
 
@@ -119,6 +132,33 @@ public:
   /*! Flag to enable/disable compression of image data */
   vtkBooleanMacro( UseCompression, bool );
 
+  /*! Number of threads used for compressing image data. 0 means the number of processors. */
+  vtkGetMacro( NumberOfCompressionThreads, int );
+  /*! Number of threads used for compressing image data. 0 means the number of processors. */
+  vtkSetMacro( NumberOfCompressionThreads, int );
+
+  /*! Number of compression threads of sequence readers/writers that are created afterwards. 0 (default) means the number of processors. */
+  static void SetDefaultNumberOfCompressionThreads( int numberOfThreads );
+  /*! Number of compression threads of sequence readers/writers that are created afterwards */
+  static int GetDefaultNumberOfCompressionThreads();
+
+  /*!
+    If enabled then Read() does not copy the pixel data of uncompressed files into memory: the pixel data file is
+    memory mapped and the frames reference the mapped pixels, which are loaded from the file when they are accessed.
+    Frames are read into memory as usual if the pixel data is compressed or has to be reoriented.
+    The file is never modified: a frame gets its own pixel buffer when it is modified (see PlusVideoFrame::SetExternalPixelData).
+  */
+  vtkGetMacro( UseMemoryMapping, bool );
+  /*! Memory map the pixel data of uncompressed files instead of reading it \sa UseMemoryMapping */
+  vtkSetMacro( UseMemoryMapping, bool );
+  /*! Memory map the pixel data of uncompressed files instead of reading it \sa UseMemoryMapping */
+  vtkBooleanMacro( UseMemoryMapping, bool );
+
+  /*! Memory mapping setting of sequence readers that are created afterwards. Default: false. */
+  static void SetDefaultUseMemoryMapping( bool useMemoryMapping );
+  /*! Memory mapping setting of sequence readers that are created afterwards */
+  static bool GetDefaultUseMemoryMapping();
+
   /*! Flag to indicate that there is a time dimension */
   vtkGetMacro(IsDataTimeSeries, bool);
   /*! Flag to indicate that there is a time dimension */
@@ -136,6 +176,25 @@ public:
   /*! Flag to enable/disable writing of image data */
   vtkBooleanMacro( EnableImageDataWrite, bool );
 
+  /*!
+    If enabled then Read() only reads the header and the frame fields, the pixel data is not loaded into the tracked frame list.
+    The image data of individual frames can be decoded afterwards by ReadFrameImageData.
+  */
+  vtkGetMacro( LoadImageDataOnDemand, bool );
+  /*! If enabled then Read() only reads the header and the frame fields \sa LoadImageDataOnDemand */
+  vtkSetMacro( LoadImageDataOnDemand, bool );
+  /*! If enabled then Read() only reads the header and the frame fields \sa LoadImageDataOnDemand */
+  vtkBooleanMacro( LoadImageDataOnDemand, bool );
+
+  /*! Return the pixel type of the frames (valid after the header is read) */
+  vtkGetMacro( PixelType, PlusCommon::VTKScalarPixelType );
+  /*! Return the number of scalar components of the frames (valid after the header is read) */
+  vtkGetMacro( NumberOfScalarComponents, int );
+  /*! Return the image type of the frames (valid after the header is read) */
+  vtkGetMacro( ImageType, US_IMAGE_TYPE );
+  /*! Return the orientation of the frames in memory (valid after the header is read) */
+  vtkGetMacro( ImageOrientationInMemory, US_IMAGE_ORIENTATION );
+
 protected:
   /*! Read all the fields in the image file header */
   virtual PlusStatus ReadImageHeader() = 0;
@@ -162,6 +221,20 @@ protected:
   */
   virtual PlusStatus WriteCompressedImagePixelsToFile( int& compressedDataSize ) = 0;
 
+  /*! Start the compressed pixel data stream in OutputImageFileHandle */
+  PlusStatus BeginCompressionStream( PlusParallelDeflate::StreamFormat format );
+
+  /*!
+    Compress the frames of the tracked frame list (on multiple threads) and append them to the compressed pixel data stream.
+    Invalid frames are written as blank frames.
+    \param frameOffsets if not NULL then the start position of each compressed frame (relative to the start of the stream) is appended to it
+    \param compressedDataSize returns the number of compressed bytes written to the file
+  */
+  PlusStatus WriteCompressedFrames( std::vector<unsigned long long>* frameOffsets, int& compressedDataSize );
+
+  /*! Finish the compressed pixel data stream. The written bytes are added to TotalBytesWritten and CompressedBytesWritten. */
+  PlusStatus EndCompressionStream();
+
   /*! Opens a file. Doesn't log error if it fails because it may be expected. */
   static PlusStatus FileOpen( FILE** stream, const char* filename, const char* flags );
 
@@ -192,6 +265,15 @@ protected:
   */
   virtual void CreateTrackedFrameIfNonExisting( unsigned int frameNumber );
 
+  /*!
+    Map the pixel data file into memory if UseMemoryMapping is enabled and the frames can reference the pixel data
+    as it is stored in the file (uncompressed, no reorientation needed). Returns NULL if the frames have to be read into memory.
+  */
+  vtkSmartPointer<vtkPlusMemoryMappedFile> MapPixelDataFile( const PlusVideoFrame::FlipInfoType& flipInfo, unsigned long long frameSizeInBytes, unsigned int frameCount );
+
+  /*! Set the image of the tracked frame to reference the pixels of the frame in the mapped pixel data file */
+  PlusStatus SetFramePixelsFromMappedFile( PlusTrackedFrame* trackedFrame, vtkPlusMemoryMappedFile* mappedFile, unsigned int frameNumber, unsigned long long frameSizeInBytes );
+
 protected:
 #ifdef _WIN32
   typedef __int64 FilePositionOffsetType;
@@ -214,8 +296,16 @@ protected:
   bool UseCompression;
   /*! Buffered compressed data size */
   unsigned long long CompressedBytesWritten;
+  /*! Number of threads used for compressing image data, 0 means the number of processors */
+  int NumberOfCompressionThreads;
+  /*! Compresses the pixel data on multiple threads */
+  PlusParallelDeflate* Compressor;
   /*! Whether to enable pixel writing */
   bool EnableImageDataWrite;
+  /*! If true then pixel data is not loaded by Read(), frames are decoded by ReadFrameImageData */
+  bool LoadImageDataOnDemand;
+  /*! If true then frames reference the memory mapped pixel data file instead of a copy of the pixels */
+  bool UseMemoryMapping;
   /*! Integer/float, short/long, signed/unsigned */
   PlusCommon::VTKScalarPixelType PixelType;
   /*! Number of components (or channels) */
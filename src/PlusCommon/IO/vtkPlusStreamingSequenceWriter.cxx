@@ -0,0 +1,378 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkPlusNewDataNotifier.h"
+#include "vtkPlusRecursiveCriticalSection.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusSequenceIOBase.h"
+#include "vtkPlusStreamingSequenceWriter.h"
+#include "vtkPlusTrackedFrameList.h"
+
+//----------------------------------------------------------------------------
+
+vtkStandardNewMacro(vtkPlusStreamingSequenceWriter);
+
+namespace
+{
+  // The writer thread is woken up when new frames are queued, the timeout only limits the wait if a notification is missed
+  const double WRITER_THREAD_MAX_WAIT_SEC = 0.1;
+  const unsigned int DEFAULT_MAXIMUM_NUMBER_OF_QUEUED_FRAMES = 64;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusStreamingSequenceWriter::vtkPlusStreamingSequenceWriter()
+  : Writer(NULL)
+  , QueuedFrames(vtkPlusTrackedFrameList::New())
+  , WritingFrames(vtkPlusTrackedFrameList::New())
+  , NumberOfFramesBeingWritten(0)
+  , QueueMutex(vtkSmartPointer<vtkPlusRecursiveCriticalSection>::New())
+  , WriterMutex(vtkSmartPointer<vtkPlusRecursiveCriticalSection>::New())
+  , NewFramesNotifier(vtkSmartPointer<vtkPlusNewDataNotifier>::New())
+  , Threader(vtkSmartPointer<vtkMultiThreader>::New())
+  , WriterThreadId(-1)
+  , WriterThreadActive(false)
+  , MaximumNumberOfQueuedFrames(DEFAULT_MAXIMUM_NUMBER_OF_QUEUED_FRAMES)
+  , PeakNumberOfQueuedFrames(0)
+  , NumberOfWrittenFrames(0)
+  , UseCompression(false)
+  , IsHeaderPrepared(false)
+  , IsData3D(false)
+  , WriteFailed(false)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusStreamingSequenceWriter::~vtkPlusStreamingSequenceWriter()
+{
+  this->StopWriterThread();
+  if (this->Writer != NULL)
+  {
+    if (this->IsHeaderPrepared)
+    {
+      LOG_WARNING("Sequence file " << this->Writer->GetFileName() << " was not closed, recorded frames are discarded");
+    }
+    this->Writer->Discard();
+    this->Writer->Delete();
+    this->Writer = NULL;
+  }
+  this->QueuedFrames->Delete();
+  this->QueuedFrames = NULL;
+  this->WritingFrames->Delete();
+  this->WritingFrames = NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusStreamingSequenceWriter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "MaximumNumberOfQueuedFrames: " << this->MaximumNumberOfQueuedFrames << std::endl;
+  os << indent << "PeakNumberOfQueuedFrames: " << this->PeakNumberOfQueuedFrames << std::endl;
+  os << indent << "NumberOfWrittenFrames: " << this->NumberOfWrittenFrames << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusStreamingSequenceWriter::Open(const std::string& filename)
+{
+  if (this->Writer != NULL)
+  {
+    if (this->IsHeaderPrepared)
+    {
+      LOG_WARNING("Sequence file " << this->Writer->GetFileName() << " was not closed, recorded frames are discarded");
+    }
+    this->Discard();
+  }
+
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> writerLock(this->WriterMutex);
+
+  this->Writer = vtkPlusSequenceIO::CreateSequenceHandlerForFile(filename);
+  if (this->Writer == NULL)
+  {
+    LOG_ERROR("Unable to create sequence file writer for file: " << filename);
+    return PLUS_FAIL;
+  }
+  this->Writer->SetUseCompression(this->UseCompression);
+  this->Writer->SetTrackedFrameList(this->WritingFrames);
+  if (this->Writer->SetFileName(filename) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Invalid sequence file name: " << filename);
+    this->Writer->Delete();
+    this->Writer = NULL;
+    return PLUS_FAIL;
+  }
+
+  this->IsHeaderPrepared = false;
+  this->IsData3D = false;
+  this->WriteFailed = false;
+  this->NumberOfWrittenFrames = 0;
+  this->PeakNumberOfQueuedFrames = 0;
+
+  this->WriterThreadActive = true;
+  this->WriterThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&WriterThread, this);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusStreamingSequenceWriter::SetFileName(const std::string& filename)
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> writerLock(this->WriterMutex);
+  if (this->Writer == NULL)
+  {
+    LOG_ERROR("Cannot set file name, the sequence file is not open");
+    return PLUS_FAIL;
+  }
+  return this->Writer->SetFileName(filename);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusStreamingSequenceWriter::GetFileName()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> writerLock(this->WriterMutex);
+  if (this->Writer == NULL)
+  {
+    return "";
+  }
+  return this->Writer->GetFileName();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusStreamingSequenceWriter::SetUseCompression(bool useCompression)
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> writerLock(this->WriterMutex);
+  this->UseCompression = useCompression;
+  if (this->Writer != NULL)
+  {
+    this->Writer->SetUseCompression(useCompression);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusStreamingSequenceWriter::AppendFrames(vtkPlusTrackedFrameList* frames)
+{
+  if (frames == NULL || frames->GetNumberOfTrackedFrames() == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+  if (this->Writer == NULL || this->WriteFailed)
+  {
+    LOG_ERROR("Cannot append " << frames->GetNumberOfTrackedFrames() << " frames, the sequence file is not open for writing");
+    frames->Clear();
+    return PLUS_FAIL;
+  }
+
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> queueLock(this->QueueMutex);
+    this->QueuedFrames->TakeTrackedFrameList(frames);
+    unsigned int numberOfFramesInMemory = this->QueuedFrames->GetNumberOfTrackedFrames() + this->NumberOfFramesBeingWritten;
+    if (numberOfFramesInMemory > this->PeakNumberOfQueuedFrames)
+    {
+      this->PeakNumberOfQueuedFrames = numberOfFramesInMemory;
+    }
+  }
+
+  this->NewFramesNotifier->Notify();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusStreamingSequenceWriter::Flush()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> writerLock(this->WriterMutex);
+  if (this->WriteQueuedFrames() != PLUS_SUCCESS || this->WriteFailed)
+  {
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusStreamingSequenceWriter::Close(std::string* resultFilename /*=NULL*/)
+{
+  this->StopWriterThread();
+
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> writerLock(this->WriterMutex);
+  if (this->Writer == NULL)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  PlusStatus status = this->WriteQueuedFrames();
+
+  if (this->IsHeaderPrepared)
+  {
+    // Fix the header to contain the correct number of frames
+    this->Writer->UpdateDimensionsCustomStrings(this->NumberOfWrittenFrames, this->IsData3D);
+    this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionSizeString());
+    this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionKindsString());
+    this->Writer->FinalizeHeader();
+
+    if (resultFilename != NULL)
+    {
+      (*resultFilename) = this->Writer->GetFileName();
+    }
+
+    if (this->Writer->Close() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to close sequence file " << this->Writer->GetFileName());
+      status = PLUS_FAIL;
+    }
+  }
+
+  LOG_DEBUG("Sequence file writing completed: " << this->NumberOfWrittenFrames << " frames written, at most "
+            << this->PeakNumberOfQueuedFrames << " frames were queued in memory");
+
+  this->Writer->Delete();
+  this->Writer = NULL;
+  this->IsHeaderPrepared = false;
+  this->NumberOfWrittenFrames = 0;
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusStreamingSequenceWriter::Discard()
+{
+  this->StopWriterThread();
+
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> writerLock(this->WriterMutex);
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> queueLock(this->QueueMutex);
+    this->QueuedFrames->Clear();
+    this->NumberOfFramesBeingWritten = 0;
+  }
+  this->WritingFrames->Clear();
+
+  if (this->Writer != NULL)
+  {
+    if (this->IsHeaderPrepared)
+    {
+      this->Writer->Discard();
+    }
+    this->Writer->Delete();
+    this->Writer = NULL;
+  }
+  this->IsHeaderPrepared = false;
+  this->NumberOfWrittenFrames = 0;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusStreamingSequenceWriter::HasUnsavedData()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> writerLock(this->WriterMutex);
+  return this->IsHeaderPrepared;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusStreamingSequenceWriter::GetNumberOfQueuedFrames()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> queueLock(this->QueueMutex);
+  return this->QueuedFrames->GetNumberOfTrackedFrames() + this->NumberOfFramesBeingWritten;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusStreamingSequenceWriter::IsQueueFull()
+{
+  return this->GetNumberOfQueuedFrames() >= this->MaximumNumberOfQueuedFrames;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusStreamingSequenceWriter::WriteQueuedFrames()
+{
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> queueLock(this->QueueMutex);
+    this->WritingFrames->TakeTrackedFrameList(this->QueuedFrames);
+    this->NumberOfFramesBeingWritten = this->WritingFrames->GetNumberOfTrackedFrames();
+  }
+
+  unsigned int numberOfFrames = this->WritingFrames->GetNumberOfTrackedFrames();
+  if (numberOfFrames == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  if (this->Writer == NULL || this->WriteFailed)
+  {
+    // Writing already failed (the error has been reported), drop the frames
+    status = PLUS_FAIL;
+  }
+  else
+  {
+    if (!this->IsHeaderPrepared)
+    {
+      // The header contains the image size and type, so it can only be prepared when the first frame is available
+      if (this->Writer->PrepareHeader() != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to prepare header of sequence file " << this->Writer->GetFileName());
+        status = PLUS_FAIL;
+      }
+      else
+      {
+        this->IsHeaderPrepared = true;
+        this->IsData3D = (this->WritingFrames->GetTrackedFrame(0)->GetFrameSize()[2] > 1);
+      }
+    }
+    if (status == PLUS_SUCCESS && this->Writer->AppendImagesToHeader() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to append " << numberOfFrames << " frames to the header of sequence file " << this->Writer->GetFileName());
+      status = PLUS_FAIL;
+    }
+    if (status == PLUS_SUCCESS && this->Writer->WriteImages() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to write images of " << numberOfFrames << " frames to sequence file " << this->Writer->GetFileName());
+      status = PLUS_FAIL;
+    }
+    if (status == PLUS_SUCCESS)
+    {
+      this->NumberOfWrittenFrames += numberOfFrames;
+    }
+    else
+    {
+      this->WriteFailed = true;
+    }
+  }
+
+  this->WritingFrames->Clear();
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> queueLock(this->QueueMutex);
+    this->NumberOfFramesBeingWritten = 0;
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusStreamingSequenceWriter::StopWriterThread()
+{
+  if (!this->WriterThreadActive)
+  {
+    return;
+  }
+  this->WriterThreadActive = false;
+  this->NewFramesNotifier->Notify();
+  // Waits until the thread function returns
+  this->Threader->TerminateThread(this->WriterThreadId);
+  this->WriterThreadId = -1;
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusStreamingSequenceWriter::WriterThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusStreamingSequenceWriter* self = (vtkPlusStreamingSequenceWriter*)(data->UserData);
+
+  unsigned long notificationCount = 0;
+  while (self->WriterThreadActive)
+  {
+    self->NewFramesNotifier->Wait(notificationCount, WRITER_THREAD_MAX_WAIT_SEC);
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> writerLock(self->WriterMutex);
+    // Errors are logged when they occur, after that the frames are dropped until the file is closed
+    self->WriteQueuedFrames();
+  }
+
+  return NULL;
+}
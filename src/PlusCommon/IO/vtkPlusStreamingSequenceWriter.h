@@ -0,0 +1,150 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusStreamingSequenceWriter_h
+#define __vtkPlusStreamingSequenceWriter_h
+
+#include "PlusCommon.h"
+#include "vtkPlusCommonExport.h"
+#include "vtkMultiThreader.h"
+#include "vtkObject.h"
+#include "vtkSmartPointer.h"
+
+class vtkPlusNewDataNotifier;
+class vtkPlusRecursiveCriticalSection;
+class vtkPlusSequenceIOBase;
+class vtkPlusTrackedFrameList;
+
+/*!
+  \class vtkPlusStreamingSequenceWriter
+  \brief Appends tracked frames to a sequence file as they arrive, with bounded memory usage
+
+  Frames are passed to the writer by AppendFrames(). They are moved (not copied) into a queue, and a dedicated writer
+  thread appends them to the sequence file as soon as they arrive. The thread that adds the frames (typically a data
+  capture thread) is therefore never blocked by disk writes.
+
+  Only the frames in the queue are kept in memory. Producers should check IsQueueFull() before acquiring new frames and
+  skip acquisition while the queue is full, so memory usage does not grow if the disk cannot keep up with the acquisition.
+  The length of a recording is only limited by the available disk space.
+
+  The header and the pixel data are assembled into the output file when Close() is called (see vtkPlusSequenceIOBase).
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport vtkPlusStreamingSequenceWriter : public vtkObject
+{
+public:
+  static vtkPlusStreamingSequenceWriter* New();
+  vtkTypeMacro(vtkPlusStreamingSequenceWriter, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Create a sequence file writer for the file (the format is determined from the file extension) and start the writer thread */
+  PlusStatus Open(const std::string& filename);
+
+  /*! Change the output file name. It can be set any time before Close() is called. */
+  PlusStatus SetFileName(const std::string& filename);
+
+  /*! Get the output file name */
+  std::string GetFileName();
+
+  /*! Enable compression of the pixel data. Must be set before the first frame is written. */
+  void SetUseCompression(bool useCompression);
+
+  /*!
+    Move all frames of the input list to the write queue, the input list is empty after the call.
+    The frames must have the same size, pixel type, image type and orientation as the frames that are already written.
+  */
+  PlusStatus AppendFrames(vtkPlusTrackedFrameList* frames);
+
+  /*! Write all queued frames to the file. Returns when all the frames are written. */
+  PlusStatus Flush();
+
+  /*!
+    Write all queued frames, finalize the header and move the data to the output file. The writer thread is stopped.
+    resultFilename contains the full path of the written file.
+  */
+  PlusStatus Close(std::string* resultFilename = NULL);
+
+  /*! Stop writing, delete the queued frames and remove the temporary files */
+  PlusStatus Discard();
+
+  /*! Returns true if any frame has been written to the file since it was opened */
+  bool HasUnsavedData();
+
+  /*! Number of frames that are in memory (queued or being written) */
+  unsigned int GetNumberOfQueuedFrames();
+
+  /*! Returns true if no more frames should be added until the writer thread writes the queued frames */
+  bool IsQueueFull();
+
+  /*! Maximum number of frames that are kept in memory, waiting to be written */
+  vtkSetMacro(MaximumNumberOfQueuedFrames, unsigned int);
+  /*! Maximum number of frames that are kept in memory, waiting to be written */
+  vtkGetMacro(MaximumNumberOfQueuedFrames, unsigned int);
+
+  /*! Number of frames written to the file since it was opened, reset to 0 when the file is closed or discarded */
+  vtkGetMacro(NumberOfWrittenFrames, unsigned int);
+
+  /*! Largest number of frames that were kept in memory since the file was opened */
+  vtkGetMacro(PeakNumberOfQueuedFrames, unsigned int);
+
+  /*! True if the written frames are volumes */
+  vtkGetMacro(IsData3D, bool);
+
+protected:
+  vtkPlusStreamingSequenceWriter();
+  virtual ~vtkPlusStreamingSequenceWriter();
+
+  /*! Write the frames that are in the queue. WriterMutex must be locked by the caller. */
+  PlusStatus WriteQueuedFrames();
+
+  /*! Stop the writer thread and wait for its termination */
+  void StopWriterThread();
+
+  /*! Thread function that writes the queued frames as they arrive */
+  static void* WriterThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Sequence file writer, exists between Open and Close/Discard. Protected by WriterMutex. */
+  vtkPlusSequenceIOBase* Writer;
+
+  /*! Frames waiting to be written. Protected by QueueMutex. */
+  vtkPlusTrackedFrameList* QueuedFrames;
+
+  /*! Frames that are being written by the writer (the tracked frame list of Writer). Protected by WriterMutex. */
+  vtkPlusTrackedFrameList* WritingFrames;
+
+  /*! Number of frames in WritingFrames. Protected by QueueMutex. */
+  unsigned int NumberOfFramesBeingWritten;
+
+  vtkSmartPointer<vtkPlusRecursiveCriticalSection> QueueMutex;
+  vtkSmartPointer<vtkPlusRecursiveCriticalSection> WriterMutex;
+
+  /*! Wakes up the writer thread when frames are added to the queue */
+  vtkSmartPointer<vtkPlusNewDataNotifier> NewFramesNotifier;
+
+  vtkSmartPointer<vtkMultiThreader> Threader;
+  int WriterThreadId;
+  bool WriterThreadActive;
+
+  unsigned int MaximumNumberOfQueuedFrames;
+  unsigned int PeakNumberOfQueuedFrames;
+  unsigned int NumberOfWrittenFrames;
+
+  bool UseCompression;
+
+  /*! The header can only be prepared when the first frame is available */
+  bool IsHeaderPrepared;
+  bool IsData3D;
+
+  /*! Set if writing of frames failed, all subsequent frames are discarded until the file is closed */
+  bool WriteFailed;
+
+private:
+  vtkPlusStreamingSequenceWriter(const vtkPlusStreamingSequenceWriter&);  // Not implemented.
+  void operator=(const vtkPlusStreamingSequenceWriter&);  // Not implemented.
+};
+
+#endif
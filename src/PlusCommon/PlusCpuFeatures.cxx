@@ -0,0 +1,107 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusCpuFeatures.h"
+
+#include <atomic>
+
+#if defined(PLUS_X86_SIMD) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  std::atomic<int> MaximumInstructionSet(PlusCpuFeatures::INSTRUCTION_SET_AVX2);
+
+  //----------------------------------------------------------------------------
+  PlusCpuFeatures::InstructionSetType DetectInstructionSet()
+  {
+#if defined(PLUS_X86_SIMD) && defined(_MSC_VER)
+    int cpuInfo[4] = { 0, 0, 0, 0 };
+    __cpuid(cpuInfo, 0);
+    int maxFunctionId = cpuInfo[0];
+    if (maxFunctionId < 1)
+    {
+      return PlusCpuFeatures::INSTRUCTION_SET_SCALAR;
+    }
+    __cpuid(cpuInfo, 1);
+    const bool ssse3 = (cpuInfo[2] & (1 << 9)) != 0;
+    const bool osxsave = (cpuInfo[2] & (1 << 27)) != 0;
+    const bool avx = (cpuInfo[2] & (1 << 28)) != 0;
+    if (!ssse3)
+    {
+      return PlusCpuFeatures::INSTRUCTION_SET_SCALAR;
+    }
+    // AVX registers can only be used if the operating system saves them on context switch
+    if (maxFunctionId < 7 || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+      return PlusCpuFeatures::INSTRUCTION_SET_SSSE3;
+    }
+    __cpuidex(cpuInfo, 7, 0);
+    const bool avx2 = (cpuInfo[1] & (1 << 5)) != 0;
+    return avx2 ? PlusCpuFeatures::INSTRUCTION_SET_AVX2 : PlusCpuFeatures::INSTRUCTION_SET_SSSE3;
+#elif defined(PLUS_X86_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+      return PlusCpuFeatures::INSTRUCTION_SET_AVX2;
+    }
+    if (__builtin_cpu_supports("ssse3"))
+    {
+      return PlusCpuFeatures::INSTRUCTION_SET_SSSE3;
+    }
+    return PlusCpuFeatures::INSTRUCTION_SET_SCALAR;
+#else
+    return PlusCpuFeatures::INSTRUCTION_SET_SCALAR;
+#endif
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusCpuFeatures::InstructionSetType PlusCpuFeatures::GetSupportedInstructionSet()
+{
+  // Detected only once, the result cannot change while the process is running
+  static const InstructionSetType supportedInstructionSet = DetectInstructionSet();
+  return supportedInstructionSet;
+}
+
+//----------------------------------------------------------------------------
+PlusCpuFeatures::InstructionSetType PlusCpuFeatures::GetInstructionSet()
+{
+  int supported = GetSupportedInstructionSet();
+  int maximum = MaximumInstructionSet.load(std::memory_order_relaxed);
+  return static_cast<InstructionSetType>(supported < maximum ? supported : maximum);
+}
+
+//----------------------------------------------------------------------------
+void PlusCpuFeatures::SetMaximumInstructionSet(InstructionSetType instructionSet)
+{
+  MaximumInstructionSet.store(instructionSet, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+PlusCpuFeatures::InstructionSetType PlusCpuFeatures::GetMaximumInstructionSet()
+{
+  return static_cast<InstructionSetType>(MaximumInstructionSet.load(std::memory_order_relaxed));
+}
+
+//----------------------------------------------------------------------------
+const char* PlusCpuFeatures::GetInstructionSetAsString(InstructionSetType instructionSet)
+{
+  switch (instructionSet)
+  {
+    case INSTRUCTION_SET_SCALAR:
+      return "Scalar";
+    case INSTRUCTION_SET_SSSE3:
+      return "SSSE3";
+    case INSTRUCTION_SET_AVX2:
+      return "AVX2";
+    default:
+      return "Unknown";
+  }
+}
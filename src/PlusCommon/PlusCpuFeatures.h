@@ -0,0 +1,63 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PLUSCPUFEATURES_H
+#define __PLUSCPUFEATURES_H
+
+#include "vtkPlusCommonExport.h"
+
+// Vectorized kernels that use x86 intrinsics are only compiled for x86 targets, by compilers that allow using
+// instruction sets for individual functions (without compiling the whole file with the instruction set enabled)
+#if (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)) && (defined(_MSC_VER) || defined(__GNUC__))
+#define PLUS_X86_SIMD
+#endif
+
+/*! Enable an instruction set (e.g., "ssse3", "avx2") for a function that is only called if the CPU supports it */
+#if defined(PLUS_X86_SIMD) && defined(__GNUC__)
+#define PLUS_SIMD_TARGET(instructionSet) __attribute__((target(instructionSet)))
+#else
+#define PLUS_SIMD_TARGET(instructionSet)
+#endif
+
+/*!
+  \class PlusCpuFeatures
+  \brief Runtime detection of the vector instruction sets that performance critical functions can use
+
+  Functions that have vectorized implementations call GetInstructionSet() and choose the best implementation
+  that is available, with the portable implementation as fallback. The instruction set can be limited by
+  SetMaximumInstructionSet, for example to compare the results of the vectorized and portable implementations.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusCpuFeatures
+{
+public:
+  /*! Instruction sets in increasing order of capabilities */
+  enum InstructionSetType
+  {
+    INSTRUCTION_SET_SCALAR = 0, /*!< portable implementation, no vector instructions */
+    INSTRUCTION_SET_SSSE3, /*!< SSE2, SSE3 and SSSE3 */
+    INSTRUCTION_SET_AVX2 /*!< AVX2, including all SSE instruction sets */
+  };
+
+  /*! Get the most capable instruction set that is supported by the CPU and the operating system */
+  static InstructionSetType GetSupportedInstructionSet();
+
+  /*! Get the instruction set that vectorized functions should use (the supported instruction set limited by the maximum instruction set) */
+  static InstructionSetType GetInstructionSet();
+
+  /*! Limit the instruction set that vectorized functions use. Can be called from any thread. */
+  static void SetMaximumInstructionSet(InstructionSetType instructionSet);
+  static InstructionSetType GetMaximumInstructionSet();
+
+  /*! Get instruction set name */
+  static const char* GetInstructionSetAsString(InstructionSetType instructionSet);
+
+private:
+  PlusCpuFeatures();
+};
+
+#endif
@@ -0,0 +1,605 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusFrameFieldStore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+namespace
+{
+  const char TIMESTAMP_FIELD_NAME[] = "Timestamp";
+  const char TRANSFORM_POSTFIX[] = "Transform";
+  const char TRANSFORM_STATUS_POSTFIX[] = "TransformStatus";
+
+  //----------------------------------------------------------------------------
+  /*! Returns true if the name is longer than the postfix and ends with it (case insensitive) */
+  bool EndsWithInsensitive(const std::string& name, const char* postfix)
+  {
+    size_t postfixLength = strlen(postfix);
+    if (name.length() <= postfixLength)
+    {
+      return false;
+    }
+    return STRCASECMP(name.c_str() + name.length() - postfixLength, postfix) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! FNV-1a hash of a field name */
+  size_t HashFieldName(const char* name, size_t length)
+  {
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+      hash = (hash ^ static_cast<unsigned char>(name[i])) * 16777619u;
+    }
+    return hash;
+  }
+
+  /*! Value of FieldNameEntry::TransformFieldId until the name is first used as a transform name */
+  const PlusFieldId TRANSFORM_FIELD_ID_NOT_COMPUTED = static_cast<PlusFieldId>(-1);
+
+  struct FieldNameEntry
+  {
+    std::string Name;
+    PlusFieldNameTable::FieldKind Kind;
+    PlusFieldId RelatedTransformFieldId;
+    /*! Transform field identifier if the name is used as a transform name, TRANSFORM_FIELD_ID_NOT_COMPUTED until first needed */
+    std::atomic<PlusFieldId> TransformFieldId;
+  };
+
+  //----------------------------------------------------------------------------
+  /*! Open addressing hash table of field identifiers. The capacity is a power of two, empty slots contain INVALID_FIELD_ID. */
+  struct FieldIdTable
+  {
+    explicit FieldIdTable(size_t capacity)
+      : Capacity(capacity)
+      , Slots(new std::atomic<PlusFieldId>[capacity])
+    {
+      for (size_t slot = 0; slot < capacity; ++slot)
+      {
+        this->Slots[slot].store(PlusFieldNameTable::INVALID_FIELD_ID, std::memory_order_relaxed);
+      }
+    }
+    ~FieldIdTable()
+    {
+      delete[] this->Slots;
+    }
+    size_t Capacity;
+    std::atomic<PlusFieldId>* Slots;
+  };
+
+  //----------------------------------------------------------------------------
+  /*!
+    Append-only registry of the field names. Looking up names and identifiers does not lock:
+    - Entries are stored in fixed-size chunks that are never moved or released, and a new identifier is only
+      published (by incrementing NumberOfEntries) after its entry is complete.
+    - Names are looked up in an open addressing hash table, where slots are only filled (never cleared) after the
+      identifier is published. When the table is full, a twice as large copy replaces it. Replaced tables are kept
+      until the registry is destroyed, because other threads may still read them (their total size is less than
+      the size of the current table).
+    Only adding names locks the mutex.
+  */
+  class FieldNameRegistry
+  {
+  public:
+    FieldNameRegistry()
+      : NumberOfEntries(0)
+      , NumberOfAllocatedEntries(0)
+      , Ids(new FieldIdTable(INITIAL_ID_TABLE_CAPACITY))
+    {
+      for (size_t chunkIndex = 0; chunkIndex < MAX_NUMBER_OF_CHUNKS; ++chunkIndex)
+      {
+        this->Chunks[chunkIndex].store(NULL, std::memory_order_relaxed);
+      }
+    }
+
+    ~FieldNameRegistry()
+    {
+      for (size_t chunkIndex = 0; chunkIndex < MAX_NUMBER_OF_CHUNKS; ++chunkIndex)
+      {
+        delete[] this->Chunks[chunkIndex].load(std::memory_order_relaxed);
+      }
+      delete this->Ids.load(std::memory_order_relaxed);
+      for (std::vector<FieldIdTable*>::iterator tableIt = this->ReplacedIds.begin(); tableIt != this->ReplacedIds.end(); ++tableIt)
+      {
+        delete *tableIt;
+      }
+    }
+
+    /*! Get the identifier of a name, add it if not found */
+    PlusFieldId GetId(const char* name, size_t length)
+    {
+      PlusFieldId fieldId = this->FindId(name, length);
+      return (fieldId != PlusFieldNameTable::INVALID_FIELD_ID ? fieldId : this->AddName(name, length));
+    }
+
+    /*! Get the identifier of a name, INVALID_FIELD_ID if not found. Does not lock and does not allocate memory. */
+    PlusFieldId FindId(const char* name, size_t length)
+    {
+      const FieldIdTable* table = this->Ids.load(std::memory_order_acquire);
+      size_t mask = table->Capacity - 1;
+      for (size_t slot = HashFieldName(name, length) & mask;; slot = (slot + 1) & mask)
+      {
+        PlusFieldId fieldId = table->Slots[slot].load(std::memory_order_acquire);
+        if (fieldId == PlusFieldNameTable::INVALID_FIELD_ID)
+        {
+          return PlusFieldNameTable::INVALID_FIELD_ID;
+        }
+        const FieldNameEntry& entry = this->GetAllocatedEntry(fieldId);
+        if (entry.Name.length() == length && memcmp(entry.Name.data(), name, length) == 0)
+        {
+          return fieldId;
+        }
+      }
+    }
+
+    /*! Get the entry of a valid identifier, NULL if the identifier is invalid. Does not lock. */
+    FieldNameEntry* GetEntry(PlusFieldId fieldId)
+    {
+      if (fieldId == PlusFieldNameTable::INVALID_FIELD_ID || fieldId > this->NumberOfEntries.load(std::memory_order_acquire))
+      {
+        return NULL;
+      }
+      return &this->GetAllocatedEntry(fieldId);
+    }
+
+    const std::string EmptyName;
+
+  protected:
+    enum
+    {
+      ENTRIES_PER_CHUNK = 1024,
+      MAX_NUMBER_OF_CHUNKS = 1024,
+      INITIAL_ID_TABLE_CAPACITY = 1024
+    };
+
+    /*! Get an entry that is allocated, but maybe not published yet */
+    FieldNameEntry& GetAllocatedEntry(PlusFieldId fieldId)
+    {
+      FieldNameEntry* chunk = this->Chunks[(fieldId - 1) / ENTRIES_PER_CHUNK].load(std::memory_order_acquire);
+      return chunk[(fieldId - 1) % ENTRIES_PER_CHUNK];
+    }
+
+    /*! Add a name (and the related transform or transform status name) and publish the new identifiers */
+    PlusFieldId AddName(const char* name, size_t length)
+    {
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      // The name may have been added by another thread since it was looked up
+      PlusFieldId fieldId = this->FindId(name, length);
+      if (fieldId != PlusFieldNameTable::INVALID_FIELD_ID)
+      {
+        return fieldId;
+      }
+
+      PlusFieldId firstNewFieldId = this->NumberOfAllocatedEntries + 1;
+      fieldId = this->AddEntry(name, length);
+
+      // Make the new entries accessible by identifier, then by name
+      this->NumberOfEntries.store(this->NumberOfAllocatedEntries, std::memory_order_release);
+      if (this->NumberOfAllocatedEntries * 2 > this->Ids.load(std::memory_order_relaxed)->Capacity)
+      {
+        this->GrowIdTable();
+      }
+      else
+      {
+        for (PlusFieldId newFieldId = firstNewFieldId; newFieldId <= this->NumberOfAllocatedEntries; ++newFieldId)
+        {
+          this->InsertId(this->Ids.load(std::memory_order_relaxed), newFieldId);
+        }
+      }
+      return fieldId;
+    }
+
+    /*! Allocate and fill an entry without publishing it. The mutex must be locked by the caller. */
+    PlusFieldId AddEntry(const char* name, size_t length)
+    {
+      // Check the entries that are added but not published yet
+      for (PlusFieldId fieldId = this->NumberOfEntries.load(std::memory_order_relaxed) + 1; fieldId <= this->NumberOfAllocatedEntries; ++fieldId)
+      {
+        const FieldNameEntry& entry = this->GetAllocatedEntry(fieldId);
+        if (entry.Name.length() == length && memcmp(entry.Name.data(), name, length) == 0)
+        {
+          return fieldId;
+        }
+      }
+      PlusFieldId fieldId = this->FindId(name, length);
+      if (fieldId != PlusFieldNameTable::INVALID_FIELD_ID)
+      {
+        return fieldId;
+      }
+
+      size_t chunkIndex = this->NumberOfAllocatedEntries / ENTRIES_PER_CHUNK;
+      if (chunkIndex >= MAX_NUMBER_OF_CHUNKS)
+      {
+        LOG_ERROR("Unable to add field name " << std::string(name, length) << ": maximum number of field names reached");
+        return PlusFieldNameTable::INVALID_FIELD_ID;
+      }
+      if (this->Chunks[chunkIndex].load(std::memory_order_relaxed) == NULL)
+      {
+        this->Chunks[chunkIndex].store(new FieldNameEntry[ENTRIES_PER_CHUNK], std::memory_order_release);
+      }
+      fieldId = static_cast<PlusFieldId>(++this->NumberOfAllocatedEntries);
+      FieldNameEntry& entry = this->GetAllocatedEntry(fieldId);
+      entry.Name.assign(name, length);
+      entry.RelatedTransformFieldId = PlusFieldNameTable::INVALID_FIELD_ID;
+      entry.TransformFieldId.store(TRANSFORM_FIELD_ID_NOT_COMPUTED, std::memory_order_relaxed);
+
+      if (EndsWithInsensitive(entry.Name, TRANSFORM_STATUS_POSTFIX))
+      {
+        entry.Kind = PlusFieldNameTable::TRANSFORM_STATUS_FIELD;
+        // Remove the "Status" from the end of the ...TransformStatus field name
+        size_t transformNameLength = entry.Name.length() - (strlen(TRANSFORM_STATUS_POSTFIX) - strlen(TRANSFORM_POSTFIX));
+        entry.RelatedTransformFieldId = this->AddEntry(entry.Name.c_str(), transformNameLength);
+      }
+      else if (EndsWithInsensitive(entry.Name, TRANSFORM_POSTFIX))
+      {
+        entry.Kind = PlusFieldNameTable::TRANSFORM_FIELD;
+        std::string statusName = entry.Name + "Status";
+        entry.RelatedTransformFieldId = this->AddEntry(statusName.c_str(), statusName.length());
+      }
+      else if (STRCASECMP(entry.Name.c_str(), TIMESTAMP_FIELD_NAME) == 0)
+      {
+        entry.Kind = PlusFieldNameTable::TIMESTAMP_FIELD;
+      }
+      else
+      {
+        entry.Kind = PlusFieldNameTable::PLAIN_FIELD;
+      }
+
+      return fieldId;
+    }
+
+    /*! Put a published identifier into an empty slot of the table. The mutex must be locked by the caller. */
+    void InsertId(FieldIdTable* table, PlusFieldId fieldId)
+    {
+      const FieldNameEntry& entry = this->GetAllocatedEntry(fieldId);
+      size_t mask = table->Capacity - 1;
+      size_t slot = HashFieldName(entry.Name.data(), entry.Name.length()) & mask;
+      while (table->Slots[slot].load(std::memory_order_relaxed) != PlusFieldNameTable::INVALID_FIELD_ID)
+      {
+        slot = (slot + 1) & mask;
+      }
+      table->Slots[slot].store(fieldId, std::memory_order_release);
+    }
+
+    /*! Replace the table by a larger one that contains all the published identifiers. The mutex must be locked by the caller. */
+    void GrowIdTable()
+    {
+      FieldIdTable* oldTable = this->Ids.load(std::memory_order_relaxed);
+      size_t capacity = oldTable->Capacity;
+      while (this->NumberOfAllocatedEntries * 2 > capacity)
+      {
+        capacity *= 2;
+      }
+      FieldIdTable* newTable = new FieldIdTable(capacity);
+      for (PlusFieldId fieldId = 1; fieldId <= this->NumberOfAllocatedEntries; ++fieldId)
+      {
+        this->InsertId(newTable, fieldId);
+      }
+      this->Ids.store(newTable, std::memory_order_release);
+      this->ReplacedIds.push_back(oldTable);
+    }
+
+    /*! Number of published entries */
+    std::atomic<PlusFieldId> NumberOfEntries;
+    /*! Number of entries, including the ones that are being added. Protected by Mutex. */
+    PlusFieldId NumberOfAllocatedEntries;
+    std::atomic<FieldNameEntry*> Chunks[MAX_NUMBER_OF_CHUNKS];
+    std::atomic<FieldIdTable*> Ids;
+    /*! Tables that have been replaced by a larger one. Protected by Mutex. */
+    std::vector<FieldIdTable*> ReplacedIds;
+    /*! Locked while names are added */
+    std::mutex Mutex;
+  };
+
+  //----------------------------------------------------------------------------
+  FieldNameRegistry& GetFieldNameRegistry()
+  {
+    static FieldNameRegistry registry;
+    return registry;
+  }
+}
+
+//----------------------------------------------------------------------------
+// ************************* PlusFieldNameTable ******************************
+//----------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------
+PlusFieldId PlusFieldNameTable::GetFieldId(const char* fieldName)
+{
+  if (fieldName == NULL)
+  {
+    LOG_ERROR("Unable to get field identifier: field name is NULL!");
+    return INVALID_FIELD_ID;
+  }
+  return GetFieldNameRegistry().GetId(fieldName, strlen(fieldName));
+}
+
+//----------------------------------------------------------------------------
+PlusFieldId PlusFieldNameTable::GetFieldId(const std::string& fieldName)
+{
+  return GetFieldNameRegistry().GetId(fieldName.c_str(), fieldName.length());
+}
+
+//----------------------------------------------------------------------------
+PlusFieldId PlusFieldNameTable::FindFieldId(const char* fieldName)
+{
+  if (fieldName == NULL)
+  {
+    return INVALID_FIELD_ID;
+  }
+  return GetFieldNameRegistry().FindId(fieldName, strlen(fieldName));
+}
+
+//----------------------------------------------------------------------------
+PlusFieldId PlusFieldNameTable::FindFieldId(const std::string& fieldName)
+{
+  return GetFieldNameRegistry().FindId(fieldName.c_str(), fieldName.length());
+}
+
+//----------------------------------------------------------------------------
+const std::string& PlusFieldNameTable::GetFieldName(PlusFieldId fieldId)
+{
+  FieldNameRegistry& registry = GetFieldNameRegistry();
+  FieldNameEntry* entry = registry.GetEntry(fieldId);
+  return (entry != NULL ? entry->Name : registry.EmptyName);
+}
+
+//----------------------------------------------------------------------------
+PlusFieldNameTable::FieldKind PlusFieldNameTable::GetFieldKind(PlusFieldId fieldId)
+{
+  FieldNameEntry* entry = GetFieldNameRegistry().GetEntry(fieldId);
+  return (entry != NULL ? entry->Kind : PLAIN_FIELD);
+}
+
+//----------------------------------------------------------------------------
+PlusFieldId PlusFieldNameTable::GetRelatedTransformFieldId(PlusFieldId fieldId)
+{
+  FieldNameEntry* entry = GetFieldNameRegistry().GetEntry(fieldId);
+  return (entry != NULL ? entry->RelatedTransformFieldId : INVALID_FIELD_ID);
+}
+
+//----------------------------------------------------------------------------
+PlusFieldId PlusFieldNameTable::GetTransformFieldId(const std::string& transformName)
+{
+  FieldNameRegistry& registry = GetFieldNameRegistry();
+  FieldNameEntry* entry = registry.GetEntry(registry.GetId(transformName.c_str(), transformName.length()));
+  if (entry == NULL)
+  {
+    return INVALID_FIELD_ID;
+  }
+  PlusFieldId transformFieldId = entry->TransformFieldId.load(std::memory_order_acquire);
+  if (transformFieldId != TRANSFORM_FIELD_ID_NOT_COMPUTED)
+  {
+    return transformFieldId;
+  }
+
+  // Parse the transform name only once (threads that parse it at the same time get the same result)
+  transformFieldId = INVALID_FIELD_ID;
+  PlusTransformName parsedTransformName;
+  std::string transformFieldName;
+  if (parsedTransformName.SetTransformName(transformName) == PLUS_SUCCESS && parsedTransformName.GetTransformName(transformFieldName) == PLUS_SUCCESS)
+  {
+    if (!EndsWithInsensitive(transformFieldName, TRANSFORM_STATUS_POSTFIX) && !EndsWithInsensitive(transformFieldName, TRANSFORM_POSTFIX))
+    {
+      transformFieldName.append(TRANSFORM_POSTFIX);
+    }
+    transformFieldId = registry.GetId(transformFieldName.c_str(), transformFieldName.length());
+    FieldNameEntry* transformFieldEntry = registry.GetEntry(transformFieldId);
+    if (transformFieldEntry != NULL && transformFieldEntry->Kind == TRANSFORM_STATUS_FIELD)
+    {
+      transformFieldId = transformFieldEntry->RelatedTransformFieldId;
+    }
+  }
+  entry->TransformFieldId.store(transformFieldId, std::memory_order_release);
+  return transformFieldId;
+}
+
+//----------------------------------------------------------------------------
+// ************************* PlusFrameFieldStore *****************************
+//----------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------
+PlusFrameFieldStore::PlusFrameFieldStore()
+  : NumberOfUnusedValueCharacters(0)
+{
+}
+
+//----------------------------------------------------------------------------
+std::vector<PlusFrameFieldStore::FieldEntry>::iterator PlusFrameFieldStore::FindEntry(PlusFieldId fieldId)
+{
+  return std::lower_bound(this->Entries.begin(), this->Entries.end(), fieldId,
+                          [](const FieldEntry & entry, PlusFieldId id) { return entry.Id < id; });
+}
+
+//----------------------------------------------------------------------------
+std::vector<PlusFrameFieldStore::FieldEntry>::const_iterator PlusFrameFieldStore::FindEntry(PlusFieldId fieldId) const
+{
+  return std::lower_bound(this->Entries.begin(), this->Entries.end(), fieldId,
+                          [](const FieldEntry & entry, PlusFieldId id) { return entry.Id < id; });
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusFrameFieldStore::AppendValue(const char* value, size_t valueLength)
+{
+  size_t offset = this->Values.size();
+  if (!this->Values.empty() && value >= &this->Values[0] && value < &this->Values[0] + this->Values.size())
+  {
+    // The value is stored in this store, get its position before the buffer is reallocated
+    size_t sourceOffset = value - &this->Values[0];
+    this->Values.resize(offset + valueLength + 1);
+    memmove(&this->Values[offset], &this->Values[sourceOffset], valueLength);
+  }
+  else
+  {
+    this->Values.resize(offset + valueLength + 1);
+    if (valueLength > 0)
+    {
+      memcpy(&this->Values[offset], value, valueLength);
+    }
+  }
+  this->Values[offset + valueLength] = 0;
+  return static_cast<unsigned int>(offset);
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFieldStore::CompactValues()
+{
+  // Only compact if at least half of the buffer is unused, so that values are not moved too often
+  const size_t minimumNumberOfUnusedCharacters = 256;
+  if (this->NumberOfUnusedValueCharacters < minimumNumberOfUnusedCharacters || this->NumberOfUnusedValueCharacters * 2 < this->Values.size())
+  {
+    return;
+  }
+  std::vector<char> compactedValues;
+  compactedValues.reserve(this->Values.size() - this->NumberOfUnusedValueCharacters);
+  for (std::vector<FieldEntry>::iterator entryIt = this->Entries.begin(); entryIt != this->Entries.end(); ++entryIt)
+  {
+    unsigned int offset = static_cast<unsigned int>(compactedValues.size());
+    compactedValues.insert(compactedValues.end(), this->Values.begin() + entryIt->ValueOffset, this->Values.begin() + entryIt->ValueOffset + entryIt->ValueLength + 1);
+    entryIt->ValueOffset = offset;
+  }
+  this->Values.swap(compactedValues);
+  this->NumberOfUnusedValueCharacters = 0;
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFieldStore::SetField(PlusFieldId fieldId, const char* value, size_t valueLength)
+{
+  if (fieldId == PlusFieldNameTable::INVALID_FIELD_ID || value == NULL)
+  {
+    LOG_ERROR("Unable to set frame field: invalid field identifier or value");
+    return;
+  }
+
+  std::vector<FieldEntry>::iterator entryIt = this->FindEntry(fieldId);
+  if (entryIt != this->Entries.end() && entryIt->Id == fieldId)
+  {
+    if (valueLength <= entryIt->ValueLength)
+    {
+      // The new value fits in place of the previous one
+      memmove(&this->Values[entryIt->ValueOffset], value, valueLength);
+      this->Values[entryIt->ValueOffset + valueLength] = 0;
+      this->NumberOfUnusedValueCharacters += entryIt->ValueLength - valueLength;
+      entryIt->ValueLength = static_cast<unsigned int>(valueLength);
+      return;
+    }
+    unsigned int previousValueLength = entryIt->ValueLength;
+    entryIt->ValueOffset = this->AppendValue(value, valueLength);
+    entryIt->ValueLength = static_cast<unsigned int>(valueLength);
+    this->NumberOfUnusedValueCharacters += previousValueLength + 1;
+    this->CompactValues();
+    return;
+  }
+
+  FieldEntry entry;
+  entry.Id = fieldId;
+  entry.ValueOffset = this->AppendValue(value, valueLength);
+  entry.ValueLength = static_cast<unsigned int>(valueLength);
+  this->Entries.insert(entryIt, entry);
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFieldStore::SetField(PlusFieldId fieldId, const std::string& value)
+{
+  this->SetField(fieldId, value.c_str(), value.length());
+}
+
+//----------------------------------------------------------------------------
+const char* PlusFrameFieldStore::GetField(PlusFieldId fieldId) const
+{
+  std::vector<FieldEntry>::const_iterator entryIt = this->FindEntry(fieldId);
+  if (entryIt == this->Entries.end() || entryIt->Id != fieldId)
+  {
+    return NULL;
+  }
+  return &this->Values[entryIt->ValueOffset];
+}
+
+//----------------------------------------------------------------------------
+bool PlusFrameFieldStore::IsFieldDefined(PlusFieldId fieldId) const
+{
+  std::vector<FieldEntry>::const_iterator entryIt = this->FindEntry(fieldId);
+  return (entryIt != this->Entries.end() && entryIt->Id == fieldId);
+}
+
+//----------------------------------------------------------------------------
+bool PlusFrameFieldStore::DeleteField(PlusFieldId fieldId)
+{
+  std::vector<FieldEntry>::iterator entryIt = this->FindEntry(fieldId);
+  if (entryIt == this->Entries.end() || entryIt->Id != fieldId)
+  {
+    return false;
+  }
+  this->NumberOfUnusedValueCharacters += entryIt->ValueLength + 1;
+  this->Entries.erase(entryIt);
+  if (this->Entries.empty())
+  {
+    this->Clear();
+  }
+  else
+  {
+    this->CompactValues();
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFieldStore::SetFields(const PlusFrameFieldStore& fields)
+{
+  if (&fields == this)
+  {
+    return;
+  }
+  if (this->Entries.empty())
+  {
+    // Copy the entries and values as they are
+    *this = fields;
+    return;
+  }
+  for (unsigned int index = 0; index < fields.GetNumberOfFields(); ++index)
+  {
+    this->SetField(fields.GetFieldId(index), fields.GetFieldValue(index), fields.GetFieldValueLength(index));
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFieldStore::Clear()
+{
+  this->Entries.clear();
+  this->Values.clear();
+  this->NumberOfUnusedValueCharacters = 0;
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFieldStore::Reserve(unsigned int numberOfFields, size_t numberOfValueCharacters)
+{
+  this->Entries.reserve(numberOfFields);
+  // each value is zero-terminated
+  this->Values.reserve(numberOfValueCharacters + numberOfFields);
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFieldStore::GetFieldMap(FieldMapType& fieldMap) const
+{
+  for (std::vector<FieldEntry>::const_iterator entryIt = this->Entries.begin(); entryIt != this->Entries.end(); ++entryIt)
+  {
+    fieldMap[PlusFieldNameTable::GetFieldName(entryIt->Id)].assign(&this->Values[entryIt->ValueOffset], entryIt->ValueLength);
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFieldStore::SetFieldMap(const FieldMapType& fieldMap)
+{
+  for (FieldMapType::const_iterator fieldIt = fieldMap.begin(); fieldIt != fieldMap.end(); ++fieldIt)
+  {
+    this->SetField(PlusFieldNameTable::GetFieldId(fieldIt->first), fieldIt->second);
+  }
+}
@@ -0,0 +1,166 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusFrameFieldStore_h
+#define __PlusFrameFieldStore_h
+
+#include "vtkPlusCommonExport.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/*! Identifier of an interned frame field name. 0 is never assigned to a field name. */
+typedef unsigned int PlusFieldId;
+
+/*!
+  \class PlusFieldNameTable
+  \brief Process-wide table of interned frame field names
+
+  Each distinct field name is assigned a small integer identifier the first time it is used. Identifiers are never
+  reused or released, so they can be stored and compared instead of the field name strings. Names can be looked up
+  without memory allocation.
+
+  The table also stores what kind of field a name refers to (transform, transform status, timestamp, or other),
+  so tracked frames do not have to parse the field names each time a field is set.
+
+  All methods are thread-safe. Only adding a new name locks a mutex: looking up existing names and identifiers
+  does not lock and does not allocate memory, so it can be done from any acquisition thread for every frame.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusFieldNameTable
+{
+public:
+  static const PlusFieldId INVALID_FIELD_ID = 0;
+
+  enum FieldKind
+  {
+    PLAIN_FIELD,            /*!< Field that has no special meaning */
+    TIMESTAMP_FIELD,        /*!< Timestamp field */
+    TRANSFORM_FIELD,        /*!< Name ends with Transform, e.g., ProbeToTrackerTransform */
+    TRANSFORM_STATUS_FIELD  /*!< Name ends with TransformStatus, e.g., ProbeToTrackerTransformStatus */
+  };
+
+  /*! Get the identifier of a field name. The name is added to the table if it is not present yet. */
+  static PlusFieldId GetFieldId(const char* fieldName);
+  static PlusFieldId GetFieldId(const std::string& fieldName);
+
+  /*! Get the identifier of a field name without adding it to the table. Returns INVALID_FIELD_ID if the name has never been used. */
+  static PlusFieldId FindFieldId(const char* fieldName);
+  static PlusFieldId FindFieldId(const std::string& fieldName);
+
+  /*! Get the name of a field. Returns an empty string for an invalid identifier. */
+  static const std::string& GetFieldName(PlusFieldId fieldId);
+
+  /*! Get the kind of a field */
+  static FieldKind GetFieldKind(PlusFieldId fieldId);
+
+  /*!
+    For a transform field get the corresponding transform status field (ProbeToTrackerTransform -> ProbeToTrackerTransformStatus),
+    for a transform status field get the corresponding transform field. Returns INVALID_FIELD_ID for other fields.
+  */
+  static PlusFieldId GetRelatedTransformFieldId(PlusFieldId fieldId);
+
+  /*!
+    Get the transform field identifier of a transform name (ProbeToTracker -> ProbeToTrackerTransform).
+    The transform name is only parsed the first time it is used. Returns INVALID_FIELD_ID if the transform name is invalid.
+  */
+  static PlusFieldId GetTransformFieldId(const std::string& transformName);
+};
+
+/*!
+  \class PlusFrameFieldStore
+  \brief Compact storage of frame field values, indexed by interned field name identifiers
+
+  Field entries are kept in a vector sorted by field identifier and all values are stored in a single character buffer,
+  so the fields of a frame occupy two memory blocks regardless of the number of fields. Copying a store into another
+  store that has enough capacity does not allocate memory.
+
+  Values are stored as zero-terminated strings. Pointers returned by GetField and GetFieldValue are valid until the
+  store is modified.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusFrameFieldStore
+{
+public:
+  typedef std::map<std::string, std::string> FieldMapType;
+
+  PlusFrameFieldStore();
+
+  /*! Set the value of a field. The field is added if it is not present yet. */
+  void SetField(PlusFieldId fieldId, const char* value, size_t valueLength);
+  void SetField(PlusFieldId fieldId, const std::string& value);
+
+  /*! Get the value of a field. Returns NULL if the field is not defined. */
+  const char* GetField(PlusFieldId fieldId) const;
+
+  /*! Returns true if the field is defined */
+  bool IsFieldDefined(PlusFieldId fieldId) const;
+
+  /*! Remove a field. Returns false if the field was not defined. */
+  bool DeleteField(PlusFieldId fieldId);
+
+  /*! Add all fields of another store. Values of fields that are present in both stores are overwritten. */
+  void SetFields(const PlusFrameFieldStore& fields);
+
+  /*! Remove all fields. Allocated memory is kept for reuse. */
+  void Clear();
+
+  /*! Allocate memory for the specified number of fields and total length of values */
+  void Reserve(unsigned int numberOfFields, size_t numberOfValueCharacters);
+
+  /*! Returns true if no fields are defined */
+  bool IsEmpty() const { return this->Entries.empty(); }
+
+  /*! Number of defined fields. Fields can be iterated by index, in ascending order of field identifiers. */
+  unsigned int GetNumberOfFields() const { return static_cast<unsigned int>(this->Entries.size()); }
+
+  /*! Identifier of the n-th field */
+  PlusFieldId GetFieldId(unsigned int index) const { return this->Entries[index].Id; }
+
+  /*! Value of the n-th field */
+  const char* GetFieldValue(unsigned int index) const { return &this->Values[this->Entries[index].ValueOffset]; }
+
+  /*! Length of the value of the n-th field */
+  size_t GetFieldValueLength(unsigned int index) const { return this->Entries[index].ValueLength; }
+
+  /*! Copy all fields into a map (keyed by field name) */
+  void GetFieldMap(FieldMapType& fieldMap) const;
+
+  /*! Add all fields of a map (keyed by field name) */
+  void SetFieldMap(const FieldMapType& fieldMap);
+
+protected:
+  struct FieldEntry
+  {
+    PlusFieldId Id;
+    unsigned int ValueOffset;
+    unsigned int ValueLength;
+  };
+
+  /*! Returns the position of the field entry or the position where it should be inserted */
+  std::vector<FieldEntry>::iterator FindEntry(PlusFieldId fieldId);
+  std::vector<FieldEntry>::const_iterator FindEntry(PlusFieldId fieldId) const;
+
+  /*! Append a value to the value buffer and return its offset */
+  unsigned int AppendValue(const char* value, size_t valueLength);
+
+  /*! Remove unused characters from the value buffer if they take up too much space */
+  void CompactValues();
+
+  /*! Field entries, sorted by field identifier */
+  std::vector<FieldEntry> Entries;
+
+  /*! Zero-terminated field values */
+  std::vector<char> Values;
+
+  /*! Number of characters in Values that belong to overwritten or deleted values */
+  size_t NumberOfUnusedValueCharacters;
+};
+
+#endif
@@ -24,10 +24,57 @@ const std::string PlusTrackedFrame::TransformPostfix = "Transform";
 const std::string PlusTrackedFrame::TransformStatusPostfix = "TransformStatus";
 const int FLOATING_POINT_PRECISION = 16; // Number of digits used when writing transforms and timestamps
 
+namespace
+{
+  //----------------------------------------------------------------------------
+  std::string ConvertTransformToString(const double transform[16])
+  {
+    std::ostringstream strTransform;
+    for (int i = 0; i < 16; ++i)
+    {
+      strTransform << std::setprecision(FLOATING_POINT_PRECISION) << transform[ i ] << " ";
+    }
+    return strTransform.str();
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Returns true if exactly 16 numbers could be read from the string */
+  bool ConvertStringToTransform(const char* str, double transform[16])
+  {
+    const char* pos = str;
+    for (int i = 0; i < 16; ++i)
+    {
+      char* end = NULL;
+      transform[i] = strtod(pos, &end);
+      if (end == pos)
+      {
+        return false;
+      }
+      pos = end;
+    }
+    while (isspace(static_cast<unsigned char>(*pos)))
+    {
+      ++pos;
+    }
+    return *pos == 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusTrackedFrame::FrameTransform::FrameTransform()
+  : FieldId(PlusFieldNameTable::INVALID_FIELD_ID)
+  , MatrixDefined(false)
+  , Status(FIELD_INVALID)
+  , StatusDefined(false)
+{
+  vtkMatrix4x4::Identity(this->Matrix);
+}
+
 //----------------------------------------------------------------------------
 PlusTrackedFrame::PlusTrackedFrame()
 {
   this->Timestamp = 0;
+  this->AllCustomFrameFieldsValid = false;
   this->FrameSize[0] = 0;
   this->FrameSize[1] = 0;
   this->FrameSize[2] = 1; // single-slice frame by default
@@ -44,6 +91,7 @@ PlusTrackedFrame::~PlusTrackedFrame()
 PlusTrackedFrame::PlusTrackedFrame(const PlusTrackedFrame& frame)
 {
   this->Timestamp = 0;
+  this->AllCustomFrameFieldsValid = false;
   this->FrameSize[0] = 0;
   this->FrameSize[1] = 0;
   this->FrameSize[2] = 1; // single-slice frame by default
@@ -62,6 +110,9 @@ PlusTrackedFrame& PlusTrackedFrame::operator=(PlusTrackedFrame const& trackedFra
   }
 
   this->CustomFrameFields = trackedFrame.CustomFrameFields;
+  this->CustomFrameTransforms = trackedFrame.CustomFrameTransforms;
+  this->CustomFrameTransformsText.clear();
+  this->AllCustomFrameFieldsValid = false;
   this->ImageData = trackedFrame.ImageData;
   this->Timestamp = trackedFrame.Timestamp;
   this->FrameSize[0] = trackedFrame.FrameSize[0];
@@ -114,7 +165,8 @@ PlusStatus PlusTrackedFrame::PrintToXML(vtkXMLDataElement* trackedFrame, const s
     trackedFrame->SetVectorAttribute("FrameSize", 3, frameSizeSigned);
   }
 
-  for (auto fieldIter = CustomFrameFields.begin(); fieldIter != CustomFrameFields.end(); ++fieldIter)
+  const FieldMapType& customFields = this->GetCustomFields();
+  for (auto fieldIter = customFields.begin(); fieldIter != customFields.end(); ++fieldIter)
   {
     // Only use requested transforms mechanism if the vector is not empty
     if (!requestedTransforms.empty() && (IsTransform(fieldIter->first) || IsTransformStatus(fieldIter->first)))
@@ -133,7 +185,8 @@ PlusStatus PlusTrackedFrame::PrintToXML(vtkXMLDataElement* trackedFrame, const s
       vtkSmartPointer<vtkXMLDataElement> customField = vtkSmartPointer<vtkXMLDataElement>::New();
       customField->SetName("CustomFrameField");
       customField->SetAttribute("Name", statusName.c_str());
-      customField->SetAttribute("Value", CustomFrameFields[statusName].c_str());
+      auto statusIter = customFields.find(statusName);
+      customField->SetAttribute("Value", statusIter != customFields.end() ? statusIter->second.c_str() : "");
       trackedFrame->AddNestedElement(customField);
     }
     vtkSmartPointer<vtkXMLDataElement> customField = vtkSmartPointer<vtkXMLDataElement>::New();
@@ -290,9 +343,12 @@ void PlusTrackedFrame::SetImageData(const PlusVideoFrame& value)
 void PlusTrackedFrame::SetTimestamp(double value)
 {
   this->Timestamp = value;
-  std::ostringstream strTimestamp;
-  strTimestamp << std::setprecision(FLOATING_POINT_PRECISION) << this->Timestamp;
-  this->CustomFrameFields["Timestamp"] = strTimestamp.str();
+  // Same format as std::setprecision(FLOATING_POINT_PRECISION), without the memory allocations of a string stream
+  static const PlusFieldId timestampFieldId = PlusFieldNameTable::GetFieldId("Timestamp");
+  char strTimestamp[64];
+  int length = snprintf(strTimestamp, sizeof(strTimestamp), "%.*g", FLOATING_POINT_PRECISION, this->Timestamp);
+  this->CustomFrameFields.SetField(timestampFieldId, strTimestamp, length);
+  this->AllCustomFrameFieldsValid = false;
 }
 
 //----------------------------------------------------------------------------
@@ -340,20 +396,95 @@ void PlusTrackedFrame::SetFiducialPointsCoordinatePx(vtkPoints* fiducialPoints)
 //----------------------------------------------------------------------------
 void PlusTrackedFrame::SetCustomFrameField(std::string name, std::string value)
 {
-  if (STRCASECMP(name.c_str(), "Timestamp") == 0)
+  this->SetCustomFrameFieldValue(PlusFieldNameTable::GetFieldId(name), value.c_str(), value.length());
+}
+
+//----------------------------------------------------------------------------
+void PlusTrackedFrame::SetCustomFrameField(PlusFieldId fieldId, const char* value, size_t valueLength)
+{
+  this->SetCustomFrameFieldValue(fieldId, value, valueLength);
+}
+
+//----------------------------------------------------------------------------
+void PlusTrackedFrame::SetCustomFrameFields(const PlusFrameFieldStore& fields)
+{
+  this->AllCustomFrameFieldsValid = false;
+  bool specialFieldFound = false;
+  for (unsigned int index = 0; index < fields.GetNumberOfFields(); ++index)
   {
-    double timestamp(0);
-    if (PlusCommon::StringToDouble(value.c_str(), timestamp) != PLUS_SUCCESS)
+    if (PlusFieldNameTable::GetFieldKind(fields.GetFieldId(index)) != PlusFieldNameTable::PLAIN_FIELD)
     {
-      LOG_ERROR("Unable to convert Timestamp '" << value << "' to double");
+      specialFieldFound = true;
+      break;
     }
-    else
+  }
+  if (!specialFieldFound)
+  {
+    // None of the fields need conversion, copy them at once
+    this->CustomFrameFields.SetFields(fields);
+    return;
+  }
+  for (unsigned int index = 0; index < fields.GetNumberOfFields(); ++index)
+  {
+    this->SetCustomFrameFieldValue(fields.GetFieldId(index), fields.GetFieldValue(index), fields.GetFieldValueLength(index));
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusTrackedFrame::SetCustomFrameFieldValue(PlusFieldId fieldId, const char* value, size_t valueLength)
+{
+  this->AllCustomFrameFieldsValid = false;
+  switch (PlusFieldNameTable::GetFieldKind(fieldId))
+  {
+    case PlusFieldNameTable::TIMESTAMP_FIELD:
+    {
+      double timestamp(0);
+      if (PlusCommon::StringToDouble(value, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to convert Timestamp '" << value << "' to double");
+      }
+      else
+      {
+        this->Timestamp = timestamp;
+      }
+      break;
+    }
+    case PlusFieldNameTable::TRANSFORM_STATUS_FIELD:
     {
-      this->Timestamp = timestamp;
+      PlusFieldId transformFieldId = PlusFieldNameTable::GetRelatedTransformFieldId(fieldId);
+      FrameTransform& frameTransform = this->GetOrAddFrameTransform(transformFieldId);
+      frameTransform.Status = ConvertFieldStatusFromString(value);
+      frameTransform.StatusDefined = true;
+      this->CustomFrameFields.DeleteField(fieldId);
+      this->InvalidateTransformText(transformFieldId);
+      return;
     }
+    case PlusFieldNameTable::TRANSFORM_FIELD:
+    {
+      double transform[16];
+      if (ConvertStringToTransform(value, transform))
+      {
+        FrameTransform& frameTransform = this->GetOrAddFrameTransform(fieldId);
+        std::copy(transform, transform + 16, frameTransform.Matrix);
+        frameTransform.MatrixDefined = true;
+        this->CustomFrameFields.DeleteField(fieldId);
+        this->InvalidateTransformText(fieldId);
+        return;
+      }
+      // Not a valid matrix, keep it as text
+      FrameTransform* frameTransform = this->FindFrameTransform(fieldId);
+      if (frameTransform != NULL)
+      {
+        frameTransform->MatrixDefined = false;
+        this->InvalidateTransformText(fieldId);
+      }
+      break;
+    }
+    default:
+      break;
   }
 
-  this->CustomFrameFields[name] = value;
+  this->CustomFrameFields.SetField(fieldId, value, valueLength);
 }
 
 //----------------------------------------------------------------------------
@@ -365,11 +496,43 @@ const char* PlusTrackedFrame::GetCustomFrameField(const char* fieldName)
     return NULL;
   }
 
-  FieldMapType::iterator fieldIterator;
-  fieldIterator = this->CustomFrameFields.find(fieldName);
-  if (fieldIterator != this->CustomFrameFields.end())
+  PlusFieldId fieldId = PlusFieldNameTable::FindFieldId(fieldName);
+  if (fieldId == PlusFieldNameTable::INVALID_FIELD_ID)
+  {
+    // this name has never been used as a field name
+    return NULL;
+  }
+
+  const char* value = this->CustomFrameFields.GetField(fieldId);
+  if (value != NULL)
+  {
+    return value;
+  }
+
+  // Transforms are converted to text on request
+  PlusFieldNameTable::FieldKind kind = PlusFieldNameTable::GetFieldKind(fieldId);
+  if (kind != PlusFieldNameTable::TRANSFORM_FIELD && kind != PlusFieldNameTable::TRANSFORM_STATUS_FIELD)
+  {
+    return NULL;
+  }
+  std::map<PlusFieldId, std::string>::iterator textIt = this->CustomFrameTransformsText.find(fieldId);
+  if (textIt != this->CustomFrameTransformsText.end())
   {
-    return fieldIterator->second.c_str();
+    return textIt->second.c_str();
+  }
+  bool isStatus = (kind == PlusFieldNameTable::TRANSFORM_STATUS_FIELD);
+  FrameTransform* frameTransform = this->FindFrameTransform(isStatus ? PlusFieldNameTable::GetRelatedTransformFieldId(fieldId) : fieldId);
+  if (frameTransform == NULL)
+  {
+    return NULL;
+  }
+  if (isStatus && frameTransform->StatusDefined)
+  {
+    return (this->CustomFrameTransformsText[fieldId] = ConvertFieldStatusToString(frameTransform->Status)).c_str();
+  }
+  if (!isStatus && frameTransform->MatrixDefined)
+  {
+    return (this->CustomFrameTransformsText[fieldId] = ConvertTransformToString(frameTransform->Matrix)).c_str();
   }
   return NULL;
 }
@@ -389,17 +552,39 @@ PlusStatus PlusTrackedFrame::DeleteCustomFrameField(const char* fieldName)
     return PLUS_FAIL;
   }
 
-  FieldMapType::iterator field = this->CustomFrameFields.find(fieldName);
-  if (field != this->CustomFrameFields.end())
+  PlusFieldId fieldId = PlusFieldNameTable::FindFieldId(fieldName);
+  this->AllCustomFrameFieldsValid = false;
+  if (this->CustomFrameFields.DeleteField(fieldId))
   {
-    this->CustomFrameFields.erase(field);
     return PLUS_SUCCESS;
   }
+
+  PlusFieldNameTable::FieldKind kind = PlusFieldNameTable::GetFieldKind(fieldId);
+  if (kind == PlusFieldNameTable::TRANSFORM_FIELD || kind == PlusFieldNameTable::TRANSFORM_STATUS_FIELD)
+  {
+    bool isStatus = (kind == PlusFieldNameTable::TRANSFORM_STATUS_FIELD);
+    PlusFieldId transformFieldId = isStatus ? PlusFieldNameTable::GetRelatedTransformFieldId(fieldId) : fieldId;
+    FrameTransform* frameTransform = this->FindFrameTransform(transformFieldId);
+    if (frameTransform != NULL)
+    {
+      bool& defined = isStatus ? frameTransform->StatusDefined : frameTransform->MatrixDefined;
+      if (defined)
+      {
+        defined = false;
+        if (!frameTransform->MatrixDefined && !frameTransform->StatusDefined)
+        {
+          this->CustomFrameTransforms.erase(this->CustomFrameTransforms.begin() + (frameTransform - &this->CustomFrameTransforms[0]));
+        }
+        this->InvalidateTransformText(transformFieldId);
+        return PLUS_SUCCESS;
+      }
+    }
+  }
+
   LOG_DEBUG("Failed to delete custom frame field - could find field " << fieldName);
   return PLUS_FAIL;
 }
 
-
 //----------------------------------------------------------------------------
 bool PlusTrackedFrame::IsCustomFrameTransformNameDefined(const PlusTransformName& transformName)
 {
@@ -426,42 +611,111 @@ bool PlusTrackedFrame::IsCustomFrameFieldDefined(const char* fieldName)
     return false;
   }
 
-  FieldMapType::iterator fieldIterator;
-  fieldIterator = this->CustomFrameFields.find(fieldName);
-  if (fieldIterator != this->CustomFrameFields.end())
+  PlusFieldId fieldId = PlusFieldNameTable::FindFieldId(fieldName);
+  if (fieldId == PlusFieldNameTable::INVALID_FIELD_ID)
+  {
+    // field is undefined
+    return false;
+  }
+
+  if (this->CustomFrameFields.IsFieldDefined(fieldId))
   {
     // field is found
     return true;
   }
-  // field is undefined
-  return false;
+
+  switch (PlusFieldNameTable::GetFieldKind(fieldId))
+  {
+    case PlusFieldNameTable::TRANSFORM_STATUS_FIELD:
+    {
+      FrameTransform* frameTransform = this->FindFrameTransform(PlusFieldNameTable::GetRelatedTransformFieldId(fieldId));
+      return frameTransform != NULL && frameTransform->StatusDefined;
+    }
+    case PlusFieldNameTable::TRANSFORM_FIELD:
+    {
+      FrameTransform* frameTransform = this->FindFrameTransform(fieldId);
+      return frameTransform != NULL && frameTransform->MatrixDefined;
+    }
+    default:
+      // field is undefined
+      return false;
+  }
 }
 
 //----------------------------------------------------------------------------
-PlusStatus PlusTrackedFrame::GetCustomFrameTransform(const PlusTransformName& frameTransformName, double transform[16])
+PlusFieldId PlusTrackedFrame::GetTransformFieldId(const PlusTransformName& frameTransformName)
 {
   std::string transformName;
   if (frameTransformName.GetTransformName(transformName) != PLUS_SUCCESS)
+  {
+    return PlusFieldNameTable::INVALID_FIELD_ID;
+  }
+  return PlusFieldNameTable::GetTransformFieldId(transformName);
+}
+
+//----------------------------------------------------------------------------
+PlusTrackedFrame::FrameTransform* PlusTrackedFrame::FindFrameTransform(PlusFieldId transformFieldId)
+{
+  FrameTransformListType::iterator transformIt = std::lower_bound(this->CustomFrameTransforms.begin(), this->CustomFrameTransforms.end(), transformFieldId,
+                                                 [](const FrameTransform & frameTransform, PlusFieldId id) { return frameTransform.FieldId < id; });
+  if (transformIt == this->CustomFrameTransforms.end() || transformIt->FieldId != transformFieldId)
+  {
+    return NULL;
+  }
+  return &(*transformIt);
+}
+
+//----------------------------------------------------------------------------
+PlusTrackedFrame::FrameTransform& PlusTrackedFrame::GetOrAddFrameTransform(PlusFieldId transformFieldId)
+{
+  FrameTransformListType::iterator transformIt = std::lower_bound(this->CustomFrameTransforms.begin(), this->CustomFrameTransforms.end(), transformFieldId,
+                                                 [](const FrameTransform & frameTransform, PlusFieldId id) { return frameTransform.FieldId < id; });
+  if (transformIt == this->CustomFrameTransforms.end() || transformIt->FieldId != transformFieldId)
+  {
+    FrameTransform frameTransform;
+    frameTransform.FieldId = transformFieldId;
+    transformIt = this->CustomFrameTransforms.insert(transformIt, frameTransform);
+  }
+  return *transformIt;
+}
+
+//----------------------------------------------------------------------------
+void PlusTrackedFrame::InvalidateTransformText(PlusFieldId transformFieldId)
+{
+  if (this->CustomFrameTransformsText.empty())
+  {
+    return;
+  }
+  this->CustomFrameTransformsText.erase(transformFieldId);
+  this->CustomFrameTransformsText.erase(PlusFieldNameTable::GetRelatedTransformFieldId(transformFieldId));
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTrackedFrame::GetCustomFrameTransform(const PlusTransformName& frameTransformName, double transform[16])
+{
+  PlusFieldId transformFieldId = GetTransformFieldId(frameTransformName);
+  if (transformFieldId == PlusFieldNameTable::INVALID_FIELD_ID)
   {
     LOG_ERROR("Unable to get custom transform, transform name is wrong!");
     return PLUS_FAIL;
   }
 
-  // Append Transform to the end of the transform name
-  if (!IsTransform(transformName))
+  FrameTransform* frameTransform = this->FindFrameTransform(transformFieldId);
+  if (frameTransform != NULL && frameTransform->MatrixDefined)
   {
-    transformName.append(TransformPostfix);
+    std::copy(frameTransform->Matrix, frameTransform->Matrix + 16, transform);
+    return PLUS_SUCCESS;
   }
 
-  const char* frameTransformStr = GetCustomFrameField(transformName.c_str());
-  if (frameTransformStr == NULL)
+  // Transforms that could not be converted to a matrix are stored as text
+  const char* transformText = this->CustomFrameFields.GetField(transformFieldId);
+  if (transformText == NULL)
   {
-    LOG_ERROR("Unable to get custom transform from name: " << transformName);
+    LOG_ERROR("Unable to get custom transform from name: " << PlusFieldNameTable::GetFieldName(transformFieldId));
     return PLUS_FAIL;
   }
 
-  // Find default frame transform
-  std::istringstream transformFieldValue(frameTransformStr);
+  std::istringstream transformFieldValue(transformText);
   double item;
   int i = 0;
   while (transformFieldValue >> item && i < 16)
@@ -485,31 +739,21 @@ PlusStatus PlusTrackedFrame::GetCustomFrameTransform(const PlusTransformName& fr
 PlusStatus PlusTrackedFrame::GetCustomFrameTransformStatus(const PlusTransformName& frameTransformName, TrackedFrameFieldStatus& status)
 {
   status = FIELD_INVALID;
-  std::string transformStatusName;
-  if (frameTransformName.GetTransformName(transformStatusName) != PLUS_SUCCESS)
+  PlusFieldId transformFieldId = GetTransformFieldId(frameTransformName);
+  if (transformFieldId == PlusFieldNameTable::INVALID_FIELD_ID)
   {
     LOG_ERROR("Unable to get custom transform status, transform name is wrong!");
     return PLUS_FAIL;
   }
 
-  // Append TransformStatus to the end of the transform name
-  if (IsTransform(transformStatusName))
+  FrameTransform* frameTransform = this->FindFrameTransform(transformFieldId);
+  if (frameTransform == NULL || !frameTransform->StatusDefined)
   {
-    transformStatusName.append("Status");
-  }
-  else if (!IsTransformStatus(transformStatusName))
-  {
-    transformStatusName.append(TransformStatusPostfix);
-  }
-
-  const char* strStatus = this->GetCustomFrameField(transformStatusName.c_str());
-  if (strStatus == NULL)
-  {
-    LOG_ERROR("Unable to get custom transform status from name: " << transformStatusName);
+    LOG_ERROR("Unable to get custom transform status from name: " << PlusFieldNameTable::GetFieldName(transformFieldId) << "Status");
     return PLUS_FAIL;
   }
 
-  status = PlusTrackedFrame::ConvertFieldStatusFromString(strStatus);
+  status = frameTransform->Status;
 
   return PLUS_SUCCESS;
 }
@@ -517,63 +761,73 @@ PlusStatus PlusTrackedFrame::GetCustomFrameTransformStatus(const PlusTransformNa
 //----------------------------------------------------------------------------
 PlusStatus PlusTrackedFrame::SetCustomFrameTransformStatus(const PlusTransformName& frameTransformName, TrackedFrameFieldStatus status)
 {
-  std::string transformStatusName;
-  if (frameTransformName.GetTransformName(transformStatusName) != PLUS_SUCCESS)
+  PlusFieldId transformFieldId = GetTransformFieldId(frameTransformName);
+  if (transformFieldId == PlusFieldNameTable::INVALID_FIELD_ID)
   {
     LOG_ERROR("Unable to set custom transform status, transform name is wrong!");
     return PLUS_FAIL;
   }
 
-  // Append TransformStatus to the end of the transform name
-  if (IsTransform(transformStatusName))
-  {
-    transformStatusName.append("Status");
-  }
-  else if (!IsTransformStatus(transformStatusName))
+  return this->SetCustomFrameTransformStatus(transformFieldId, status);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTrackedFrame::SetCustomFrameTransformStatus(PlusFieldId transformFieldId, TrackedFrameFieldStatus status)
+{
+  if (PlusFieldNameTable::GetFieldKind(transformFieldId) != PlusFieldNameTable::TRANSFORM_FIELD)
   {
-    transformStatusName.append(TransformStatusPostfix);
+    LOG_ERROR("Unable to set custom transform status, field " << PlusFieldNameTable::GetFieldName(transformFieldId) << " is not a transform!");
+    return PLUS_FAIL;
   }
 
-  std::string strStatus = PlusTrackedFrame::ConvertFieldStatusToString(status);
-
-  this->SetCustomFrameField(transformStatusName, strStatus);
+  FrameTransform& frameTransform = this->GetOrAddFrameTransform(transformFieldId);
+  frameTransform.Status = status;
+  frameTransform.StatusDefined = true;
+  this->InvalidateTransformText(transformFieldId);
+  this->AllCustomFrameFieldsValid = false;
 
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
-PlusStatus PlusTrackedFrame::SetCustomFrameTransform(const PlusTransformName& frameTransformName, double transform[16])
+PlusStatus PlusTrackedFrame::SetCustomFrameTransform(const PlusTransformName& frameTransformName, const double transform[16])
 {
-  std::ostringstream strTransform;
-  for (int i = 0; i < 16; ++i)
+  PlusFieldId transformFieldId = GetTransformFieldId(frameTransformName);
+  if (transformFieldId == PlusFieldNameTable::INVALID_FIELD_ID)
   {
-    strTransform << std::setprecision(FLOATING_POINT_PRECISION) << transform[ i ] << " ";
+    LOG_ERROR("Unable to get custom transform, transform name is wrong!");
+    return PLUS_FAIL;
   }
 
-  std::string transformName;
-  if (frameTransformName.GetTransformName(transformName) != PLUS_SUCCESS)
+  return this->SetCustomFrameTransform(transformFieldId, transform);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTrackedFrame::SetCustomFrameTransform(PlusFieldId transformFieldId, const double transform[16])
+{
+  if (PlusFieldNameTable::GetFieldKind(transformFieldId) != PlusFieldNameTable::TRANSFORM_FIELD)
   {
-    LOG_ERROR("Unable to get custom transform, transform name is wrong!");
+    LOG_ERROR("Unable to set custom transform, field " << PlusFieldNameTable::GetFieldName(transformFieldId) << " is not a transform!");
     return PLUS_FAIL;
   }
 
-  // Append Transform to the end of the transform name
-  if (!IsTransform(transformName))
+  FrameTransform& frameTransform = this->GetOrAddFrameTransform(transformFieldId);
+  std::copy(transform, transform + 16, frameTransform.Matrix);
+  frameTransform.MatrixDefined = true;
+  this->InvalidateTransformText(transformFieldId);
+  this->AllCustomFrameFieldsValid = false;
+  if (!this->CustomFrameFields.IsEmpty())
   {
-    transformName.append(TransformPostfix);
+    this->CustomFrameFields.DeleteField(transformFieldId);
   }
 
-  SetCustomFrameField(transformName, strTransform.str());
-
   return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus PlusTrackedFrame::SetCustomFrameTransform(const PlusTransformName& frameTransformName, vtkMatrix4x4* transform)
 {
-  double dTransform[ 16 ];
-  vtkMatrix4x4::DeepCopy(dTransform, transform);
-  return SetCustomFrameTransform(frameTransformName, dTransform);
+  return SetCustomFrameTransform(frameTransformName, &transform->Element[0][0]);
 }
 
 //----------------------------------------------------------------------------
@@ -661,25 +915,77 @@ PlusStatus PlusTrackedFrame::WriteToFile(const std::string& filename, vtkMatrix4
 void PlusTrackedFrame::GetCustomFrameFieldNameList(std::vector<std::string>& fieldNames)
 {
   fieldNames.clear();
-  for (FieldMapType::const_iterator it = this->CustomFrameFields.begin(); it != this->CustomFrameFields.end(); it++)
+  for (unsigned int index = 0; index < this->CustomFrameFields.GetNumberOfFields(); ++index)
   {
-    fieldNames.push_back(it->first);
+    fieldNames.push_back(PlusFieldNameTable::GetFieldName(this->CustomFrameFields.GetFieldId(index)));
   }
+  for (FrameTransformListType::const_iterator it = this->CustomFrameTransforms.begin(); it != this->CustomFrameTransforms.end(); it++)
+  {
+    if (it->MatrixDefined)
+    {
+      fieldNames.push_back(PlusFieldNameTable::GetFieldName(it->FieldId));
+    }
+    if (it->StatusDefined)
+    {
+      fieldNames.push_back(PlusFieldNameTable::GetFieldName(PlusFieldNameTable::GetRelatedTransformFieldId(it->FieldId)));
+    }
+  }
+  // Same order as if all fields were stored in a single map
+  std::sort(fieldNames.begin(), fieldNames.end());
 }
 
 //----------------------------------------------------------------------------
 void PlusTrackedFrame::GetCustomFrameTransformNameList(std::vector<PlusTransformName>& transformNames)
 {
+  std::vector<std::string> transformFieldNames;
+  for (FrameTransformListType::const_iterator it = this->CustomFrameTransforms.begin(); it != this->CustomFrameTransforms.end(); it++)
+  {
+    if (it->MatrixDefined)
+    {
+      transformFieldNames.push_back(PlusFieldNameTable::GetFieldName(it->FieldId));
+    }
+  }
+  for (unsigned int index = 0; index < this->CustomFrameFields.GetNumberOfFields(); ++index)
+  {
+    PlusFieldId fieldId = this->CustomFrameFields.GetFieldId(index);
+    if (PlusFieldNameTable::GetFieldKind(fieldId) == PlusFieldNameTable::TRANSFORM_FIELD)
+    {
+      transformFieldNames.push_back(PlusFieldNameTable::GetFieldName(fieldId));
+    }
+  }
+  std::sort(transformFieldNames.begin(), transformFieldNames.end());
+
   transformNames.clear();
-  for (FieldMapType::const_iterator it = this->CustomFrameFields.begin(); it != this->CustomFrameFields.end(); it++)
+  for (std::vector<std::string>::const_iterator it = transformFieldNames.begin(); it != transformFieldNames.end(); it++)
   {
-    if (IsTransform(it->first))
+    PlusTransformName trName;
+    trName.SetTransformName(it->substr(0, it->length() - TransformPostfix.length()).c_str());
+    transformNames.push_back(trName);
+  }
+}
+
+//----------------------------------------------------------------------------
+const PlusTrackedFrame::FieldMapType& PlusTrackedFrame::GetCustomFields()
+{
+  if (this->AllCustomFrameFieldsValid)
+  {
+    return this->AllCustomFrameFields;
+  }
+  this->AllCustomFrameFields.clear();
+  this->CustomFrameFields.GetFieldMap(this->AllCustomFrameFields);
+  for (FrameTransformListType::const_iterator it = this->CustomFrameTransforms.begin(); it != this->CustomFrameTransforms.end(); it++)
+  {
+    if (it->MatrixDefined)
+    {
+      this->AllCustomFrameFields[PlusFieldNameTable::GetFieldName(it->FieldId)] = ConvertTransformToString(it->Matrix);
+    }
+    if (it->StatusDefined)
     {
-      PlusTransformName trName;
-      trName.SetTransformName(it->first.substr(0, it->first.length() - TransformPostfix.length()).c_str());
-      transformNames.push_back(trName);
+      this->AllCustomFrameFields[PlusFieldNameTable::GetFieldName(PlusFieldNameTable::GetRelatedTransformFieldId(it->FieldId))] = ConvertFieldStatusToString(it->Status);
     }
   }
+  this->AllCustomFrameFieldsValid = true;
+  return this->AllCustomFrameFields;
 }
 
 //----------------------------------------------------------------------------
@@ -9,6 +9,7 @@
 
 #include "vtkPlusCommonExport.h"
 
+#include "PlusFrameFieldStore.h"
 #include "PlusVideoFrame.h"
 
 class vtkMatrix4x4;
@@ -30,6 +31,14 @@ enum TrackedFrameFieldStatus
 /*!
   \class TrackedFrame
   \brief Stores tracked frame (image + pose information)
+
+  Transforms and transform statuses are stored in binary form. They are only converted to text when they are
+  accessed as custom frame fields (e.g., when the frame is written to a sequence file or serialized to XML),
+  so setting and getting transforms does not involve any string formatting or parsing.
+
+  Field names are interned (see PlusFieldNameTable) and field values are stored in a PlusFrameFieldStore,
+  so copying the fields of a frame only copies a few contiguous memory blocks.
+
   \ingroup PlusLibCommon
 */
 class vtkPlusCommonExport PlusTrackedFrame
@@ -42,6 +51,21 @@ public:
   static const std::string TransformStatusPostfix;
   typedef std::map<std::string, std::string> FieldMapType;
 
+  /*! Transform matrix and status of a frame transform */
+  struct FrameTransform
+  {
+    FrameTransform();
+    /*! Identifier of the transform field name (e.g., ProbeToTrackerTransform) */
+    PlusFieldId FieldId;
+    /*! Homogeneous transformation matrix, row-major order */
+    double Matrix[16];
+    bool MatrixDefined;
+    TrackedFrameFieldStatus Status;
+    bool StatusDefined;
+  };
+  /*! Frame transforms, sorted by transform field identifier */
+  typedef std::vector<FrameTransform> FrameTransformListType;
+
 public:
   PlusTrackedFrame();
   ~PlusTrackedFrame();
@@ -61,10 +85,27 @@ public:
   /*! Get timestamp */
   double GetTimestamp() { return this->Timestamp; };
 
-  /*! Set custom frame field */
+  /*!
+    Set custom frame field.
+    Transform and transform status fields are converted to binary form.
+  */
   void SetCustomFrameField(std::string name, std::string value);
 
-  /*! Get custom frame field value */
+  /*!
+    Set custom frame field identified by its interned name (see PlusFieldNameTable).
+    Faster than setting the field by name, as the field name does not have to be looked up.
+    The value must be zero-terminated, valueLength does not include the terminating zero.
+  */
+  void SetCustomFrameField(PlusFieldId fieldId, const char* value, size_t valueLength);
+
+  /*! Set all the fields of a field store. Faster than setting the fields one by one. */
+  void SetCustomFrameFields(const PlusFrameFieldStore& fields);
+
+  /*!
+    Get custom frame field value.
+    The returned pointer is valid until the field is modified or deleted.
+    Transform fields are converted to text when requested, use GetCustomFrameTransform to get transforms efficiently.
+  */
   const char* GetCustomFrameField(const char* fieldName);
   const char* GetCustomFrameField(const std::string& fieldName);
 
@@ -92,13 +133,18 @@ public:
   PlusStatus GetCustomFrameTransformStatus(const PlusTransformName& frameTransformName, TrackedFrameFieldStatus& status);
   /*! Set custom frame status */
   PlusStatus SetCustomFrameTransformStatus(const PlusTransformName& frameTransformName, TrackedFrameFieldStatus status);
+  /*! Set custom frame status, identified by the transform field identifier (see PlusFieldNameTable::GetTransformFieldId) */
+  PlusStatus SetCustomFrameTransformStatus(PlusFieldId transformFieldId, TrackedFrameFieldStatus status);
 
   /*! Set custom frame transform */
-  PlusStatus SetCustomFrameTransform(const PlusTransformName& frameTransformName, double transform[16]);
+  PlusStatus SetCustomFrameTransform(const PlusTransformName& frameTransformName, const double transform[16]);
 
   /*! Set custom frame transform */
   PlusStatus SetCustomFrameTransform(const PlusTransformName& frameTransformName, vtkMatrix4x4* transform);
 
+  /*! Set custom frame transform, identified by the transform field identifier (see PlusFieldNameTable::GetTransformFieldId) */
+  PlusStatus SetCustomFrameTransform(PlusFieldId transformFieldId, const double transform[16]);
+
   /*! Get the list of the name of all custom frame fields */
   void GetCustomFrameFieldNameList(std::vector<std::string>& fieldNames);
 
@@ -148,8 +194,18 @@ public:
   /*! Convert from field status enum to field status string */
   static std::string ConvertFieldStatusToString(TrackedFrameFieldStatus status);
 
-  /*! Return all custom fields in a map */
-  const FieldMapType& GetCustomFields() { return this->CustomFrameFields; }
+  /*!
+    Return all custom fields in a map, including the transforms converted to text.
+    The map is only rebuilt if the fields have been modified since the previous call, so calling this method
+    repeatedly for the same frame is cheap. The returned map is valid until the next call of this method.
+  */
+  const FieldMapType& GetCustomFields();
+
+  /*! Return all custom frame transforms (in binary form) */
+  const FrameTransformListType& GetCustomFrameTransforms() { return this->CustomFrameTransforms; }
+
+  /*! Return the custom fields that are not stored in binary form (all fields except valid transforms and transform statuses) */
+  const PlusFrameFieldStore& GetCustomFrameFieldStore() const { return this->CustomFrameFields; }
 
   /*! Returns true if the input string ends with "Transform", else false */
   static bool IsTransform(std::string str);
@@ -168,7 +224,34 @@ protected:
   PlusVideoFrame ImageData;
   double Timestamp;
 
-  FieldMapType CustomFrameFields;
+  /*! Get the identifier of the transform field (ending with Transform) from a transform name */
+  static PlusFieldId GetTransformFieldId(const PlusTransformName& frameTransformName);
+
+  /*! Set a custom frame field, transform and transform status fields are converted to binary form */
+  void SetCustomFrameFieldValue(PlusFieldId fieldId, const char* value, size_t valueLength);
+
+  /*! Get a frame transform. Returns NULL if not found. */
+  FrameTransform* FindFrameTransform(PlusFieldId transformFieldId);
+
+  /*! Get a frame transform, add it if not found */
+  FrameTransform& GetOrAddFrameTransform(PlusFieldId transformFieldId);
+
+  /*! Delete the text representation of a transform (needed when the transform is modified) */
+  void InvalidateTransformText(PlusFieldId transformFieldId);
+
+  /*! Custom fields that are not stored in binary form */
+  PlusFrameFieldStore CustomFrameFields;
+
+  /*! Transforms and transform statuses */
+  FrameTransformListType CustomFrameTransforms;
+
+  /*! Text representation of the transform and transform status fields, created when the fields are accessed as text */
+  std::map<PlusFieldId, std::string> CustomFrameTransformsText;
+
+  /*! All custom fields as text, returned by GetCustomFields */
+  FieldMapType AllCustomFrameFields;
+  /*! True if AllCustomFrameFields is up-to-date, cleared whenever a custom field or transform is modified */
+  bool AllCustomFrameFieldsValid;
 
   unsigned int FrameSize[3];
 
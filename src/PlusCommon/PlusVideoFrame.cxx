@@ -6,14 +6,19 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "PlusVideoFrame.h"
+#include "PlusVideoFrameKernels.h"
 #include "itkImageBase.h"
 #include "vtkBMPReader.h"
+#include "vtkDataArray.h"
 #include "vtkExtractVOI.h"
 #include "vtkImageData.h"
 #include "vtkImageImport.h"
 #include "vtkImageReader.h"
+#include "vtkInformation.h"
+#include "vtkInformationObjectBaseKey.h"
 #include "vtkObjectFactory.h"
 #include "vtkPNMReader.h"
+#include "vtkPointData.h"
 #include "vtkTIFFReader.h"
 #include "vtkTrivialProducer.h"
 
@@ -334,6 +339,69 @@ namespace
 
     return PLUS_SUCCESS;
   }
+
+  //----------------------------------------------------------------------------
+  // Perform the most common operations (horizontal flip with or without vertical flip, transpose) with vectorized kernels.
+  // Returns false if the operation is not supported by the kernels, in this case FlipClipImageGeneric must be used.
+  bool FlipClipImageVectorized(vtkImageData* inputImage, const PlusVideoFrame::FlipInfoType& flipInfo, const int clipRectangleOrigin[3], vtkImageData* outputImage)
+  {
+    PlusCpuFeatures::InstructionSetType instructionSet = PlusCpuFeatures::GetInstructionSet();
+    if (instructionSet == PlusCpuFeatures::INSTRUCTION_SET_SCALAR || flipInfo.doubleRow || flipInfo.doubleColumn || flipInfo.eFlip)
+    {
+      return false;
+    }
+
+    const int bytesPerScalar = PlusVideoFrame::GetNumberOfBytesPerScalar(inputImage->GetScalarType());
+    const int bytesPerPixel = bytesPerScalar * inputImage->GetNumberOfScalarComponents();
+
+    int outputDims[3] = {0, 0, 0};
+    outputImage->GetDimensions(outputDims);
+
+    // vtkImageData increments are in scalars, the kernels use bytes
+    vtkIdType inputIncrements[3] = {0, 0, 0};
+    inputImage->GetIncrements(inputIncrements);
+    const long long inputRowStride = inputIncrements[1] * bytesPerScalar;
+    const long long inputImageStride = inputIncrements[2] * bytesPerScalar;
+    vtkIdType outputIncrements[3] = {0, 0, 0};
+    outputImage->GetIncrements(outputIncrements);
+    const long long outputRowStride = outputIncrements[1] * bytesPerScalar;
+    const long long outputImageStride = outputIncrements[2] * bytesPerScalar;
+
+    const unsigned char* inputFirstPixel = static_cast<unsigned char*>(inputImage->GetScalarPointer())
+                                           + clipRectangleOrigin[2] * inputImageStride + clipRectangleOrigin[1] * inputRowStride + clipRectangleOrigin[0] * bytesPerPixel;
+    unsigned char* outputFirstPixel = static_cast<unsigned char*>(outputImage->GetScalarPointer());
+
+    if (flipInfo.hFlip && flipInfo.tranpose == PlusVideoFrame::TRANSPOSE_NONE)
+    {
+      // flip X, or flip X and Y
+      for (int z = 0; z < outputDims[2]; z++)
+      {
+        if (!PlusVideoFrameKernels::FlipRows(inputFirstPixel + z * inputImageStride, inputRowStride, outputFirstPixel + z * outputImageStride, outputRowStride,
+                                             outputDims[0], outputDims[1], bytesPerPixel, flipInfo.vFlip, instructionSet))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    if (!flipInfo.hFlip && !flipInfo.vFlip && flipInfo.tranpose == PlusVideoFrame::TRANSPOSE_IJKtoKIJ)
+    {
+      // Each input row becomes an output image: the input (slice, column) pixels are written to the output (row, column) pixels
+      for (int y = 0; y < outputDims[2]; y++)
+      {
+        if (!PlusVideoFrameKernels::Transpose(inputFirstPixel + y * inputRowStride, inputImageStride, outputFirstPixel + y * outputImageStride, outputRowStride,
+                                              outputDims[0], outputDims[1], bytesPerPixel, instructionSet))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // vertical flip only is already a row-by-row memcpy in FlipClipImageGeneric
+    return false;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -405,6 +473,87 @@ PlusStatus PlusVideoFrame::DeepCopy(PlusVideoFrame* videoItem)
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus PlusVideoFrame::ShallowCopy(const PlusVideoFrame* videoItem)
+{
+  if (videoItem == NULL)
+  {
+    LOG_ERROR("Failed to shallow copy video buffer item - buffer item NULL!");
+    return PLUS_FAIL;
+  }
+
+  if (this == videoItem)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  this->ImageType = videoItem->ImageType;
+  this->ImageOrientation = videoItem->ImageOrientation;
+
+  if (videoItem->GetFrameSizeInBytes() > 0)
+  {
+    if (this->Image == NULL)
+    {
+      this->SetImageData(vtkImageData::New());
+    }
+    // Only the reference count of the pixel buffer is incremented
+    this->Image->ShallowCopy(videoItem->Image);
+  }
+  else
+  {
+    // Release the previous pixel buffer, so that this frame is empty like the source
+    DELETE_IF_NOT_NULL(this->Image);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool PlusVideoFrame::IsPixelDataShared(vtkImageData* image)
+{
+  if (image == NULL)
+  {
+    return false;
+  }
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  if (scalars == NULL)
+  {
+    return false;
+  }
+  return scalars->GetReferenceCount() > 1 || (scalars->HasInformation() && scalars->GetInformation()->Has(PlusVideoFrame::PIXEL_DATA_OWNER()));
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusVideoFrame::SetExternalPixelData(const unsigned int frameSize[3], PlusCommon::VTKScalarPixelType pixelType, unsigned int numberOfScalarComponents, void* pixelData, vtkObjectBase* pixelDataOwner)
+{
+  if (pixelData == NULL || pixelDataOwner == NULL || numberOfScalarComponents == 0)
+  {
+    LOG_ERROR("Failed to set external pixel data - invalid input");
+    return PLUS_FAIL;
+  }
+
+  vtkSmartPointer<vtkDataArray> scalars = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(pixelType));
+  if (scalars == NULL)
+  {
+    LOG_ERROR("Failed to set external pixel data - unsupported pixel type: " << pixelType);
+    return PLUS_FAIL;
+  }
+  scalars->SetNumberOfComponents(numberOfScalarComponents);
+  // save=1: the array does not free the memory, the owner stored in the array information keeps it valid
+  scalars->SetVoidArray(pixelData, static_cast<vtkIdType>(frameSize[0]) * frameSize[1] * frameSize[2] * numberOfScalarComponents, 1);
+  scalars->GetInformation()->Set(PlusVideoFrame::PIXEL_DATA_OWNER(), pixelDataOwner);
+
+  if (this->Image == NULL)
+  {
+    this->SetImageData(vtkImageData::New());
+  }
+  this->Image->SetExtent(0, frameSize[0] - 1, 0, frameSize[1] - 1, 0, frameSize[2] - 1);
+  this->Image->GetPointData()->SetScalars(scalars);
+  this->Image->Modified();
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus PlusVideoFrame::FillBlank()
 {
@@ -436,7 +585,8 @@ PlusStatus PlusVideoFrame::AllocateFrame(vtkImageData* image, const int imageSiz
         imageSize[1] == imageExtents[3] - imageExtents[2] + 1 &&
         imageSize[2] == imageExtents[5] - imageExtents[4] + 1 &&
         image->GetScalarType() == pixType &&
-        image->GetNumberOfScalarComponents() == numberOfScalarComponents)
+        image->GetNumberOfScalarComponents() == numberOfScalarComponents &&
+        !PlusVideoFrame::IsPixelDataShared(image))
     {
       // already allocated, no change
       return PLUS_SUCCESS;
@@ -465,7 +615,8 @@ PlusStatus PlusVideoFrame::AllocateFrame(vtkImageData* image, const unsigned int
         imageSize[1] == imageExtents[3] - imageExtents[2] + 1 &&
         imageSize[2] == imageExtents[5] - imageExtents[4] + 1 &&
         image->GetScalarType() == pixType &&
-        image->GetNumberOfScalarComponents() == numberOfScalarComponents)
+        image->GetNumberOfScalarComponents() == numberOfScalarComponents &&
+        !PlusVideoFrame::IsPixelDataShared(image))
     {
       // already allocated, no change
       return PLUS_SUCCESS;
@@ -1172,7 +1323,28 @@ PlusStatus PlusVideoFrame::FlipClipImage(vtkImageData* inUsImage,
     else
     {
       // no flip, clip or transpose
-      outUsOrientedImage->DeepCopy(inUsImage);
+      int inDimensions[3] = {0, 0, 0};
+      int outDimensions[3] = {0, 0, 0};
+      inUsImage->GetDimensions(inDimensions);
+      outUsOrientedImage->GetDimensions(outDimensions);
+      if (inDimensions[0] == outDimensions[0] && inDimensions[1] == outDimensions[1] && inDimensions[2] == outDimensions[2]
+          && inUsImage->GetScalarType() == outUsOrientedImage->GetScalarType()
+          && inUsImage->GetNumberOfScalarComponents() == outUsOrientedImage->GetNumberOfScalarComponents()
+          && outUsOrientedImage->GetPointData()->GetScalars() != NULL
+          && !PlusVideoFrame::IsPixelDataShared(outUsOrientedImage))
+      {
+        // Reuse the pixel buffer of the output image, DeepCopy would allocate a new one
+        outUsOrientedImage->SetExtent(inUsImage->GetExtent());
+        outUsOrientedImage->SetOrigin(inUsImage->GetOrigin());
+        outUsOrientedImage->SetSpacing(inUsImage->GetSpacing());
+        memcpy(outUsOrientedImage->GetScalarPointer(), inUsImage->GetScalarPointer(),
+               static_cast<size_t>(inDimensions[0]) * inDimensions[1] * inDimensions[2] * inUsImage->GetScalarSize() * inUsImage->GetNumberOfScalarComponents());
+        outUsOrientedImage->Modified();
+      }
+      else
+      {
+        outUsOrientedImage->DeepCopy(inUsImage);
+      }
       return PLUS_SUCCESS;
     }
   }
@@ -1235,13 +1407,20 @@ PlusStatus PlusVideoFrame::FlipClipImage(vtkImageData* inUsImage,
   outUsOrientedImage->GetDimensions(outDimensions);
 
   // Update the output image if the dimensions don't match the final clip size (which might be the same as the input image)
-  if (outDimensions[0] != finalOutputSize[0] || outDimensions[1] != finalOutputSize[1] || outDimensions[2] != finalOutputSize[2] || outUsOrientedImage->GetScalarType() != inUsImage->GetScalarType() || outUsOrientedImage->GetNumberOfScalarComponents() != inUsImage->GetNumberOfScalarComponents())
+  if (outDimensions[0] != finalOutputSize[0] || outDimensions[1] != finalOutputSize[1] || outDimensions[2] != finalOutputSize[2] || outUsOrientedImage->GetScalarType() != inUsImage->GetScalarType() || outUsOrientedImage->GetNumberOfScalarComponents() != inUsImage->GetNumberOfScalarComponents()
+      || PlusVideoFrame::IsPixelDataShared(outUsOrientedImage))
   {
-    // Allocate the output image, adjust for 1 based sizes to 0 based extents
+    // Allocate the output image, adjust for 1 based sizes to 0 based extents.
+    // AllocateScalars creates a new pixel buffer if the current one is shared with another frame.
     outUsOrientedImage->SetExtent(0, finalOutputSize[0] - 1, 0, finalOutputSize[1] - 1, 0, finalOutputSize[2] - 1);
     outUsOrientedImage->AllocateScalars(inUsImage->GetScalarType(), inUsImage->GetNumberOfScalarComponents());
   }
 
+  if (FlipClipImageVectorized(inUsImage, flipInfo, finalClipOrigin, outUsOrientedImage))
+  {
+    return PLUS_SUCCESS;
+  }
+
   int numberOfBytesPerScalar = PlusVideoFrame::GetNumberOfBytesPerScalar(inUsImage->GetScalarType());
 
   PlusStatus status(PLUS_FAIL);
@@ -1444,6 +1623,9 @@ vtkImageData* PlusVideoFrame::GetImage() const
   return this->Image;
 }
 
+//----------------------------------------------------------------------------
+vtkInformationKeyMacro(PlusVideoFrame, PIXEL_DATA_OWNER, ObjectBase);
+
 //----------------------------------------------------------------------------
 void PlusVideoFrame::SetImageData(vtkImageData* imageData)
 {
@@ -14,6 +14,8 @@ See License.txt for details.
 #include "vtkImageExport.h"
 #include "vtkImageData.h"
 
+class vtkInformationObjectBaseKey;
+
 /*!
 \enum US_IMAGE_ORIENTATION
 \brief Defines constant values for ultrasound image orientation
@@ -176,6 +178,29 @@ public:
   /*! Copy pixel data from another PlusVideoFrame object, same as operator= */
   PlusStatus DeepCopy(PlusVideoFrame* DataBufferItem);
 
+  /*!
+    Reference the pixel data of another PlusVideoFrame object instead of copying it.
+    The pixel data is reference counted: AllocateFrame, operator= and GetOrientedClippedImage allocate a new pixel buffer
+    if the current one is referenced by another frame, so writing into a frame never modifies the frames it is shared with.
+    Pixels written directly through GetScalarPointer() are not protected, call AllocateFrame before writing into a shallow copy.
+    If the other frame is empty then the pixel data of this frame is released.
+  */
+  PlusStatus ShallowCopy(const PlusVideoFrame* DataBufferItem);
+
+  /*! Returns true if the pixel buffer of the image is referenced by other images as well, or it is externally owned memory */
+  static bool IsPixelDataShared(vtkImageData* image);
+
+  /*!
+    Use externally owned memory (e.g., a memory mapped file) as pixel buffer, without copying it.
+    The pixel data array keeps a reference to pixelDataOwner, so the memory remains valid as long as any image uses it.
+    The pixel buffer is treated as shared (see IsPixelDataShared): AllocateFrame, operator= and GetOrientedClippedImage
+    allocate a new buffer instead of writing into the external memory.
+  */
+  PlusStatus SetExternalPixelData(const unsigned int frameSize[3], PlusCommon::VTKScalarPixelType pixelType, unsigned int numberOfScalarComponents, void* pixelData, vtkObjectBase* pixelDataOwner);
+
+  /*! Information key of pixel data arrays, stores the object that owns the memory of externally owned pixel buffers */
+  static vtkInformationObjectBaseKey* PIXEL_DATA_OWNER();
+
   /*! Sets the pixel buffer content by copying pixel data from a vtkImageData object.*/
   PlusStatus DeepCopyFrom(vtkImageData* frame);
 
@@ -283,7 +308,8 @@ public:
       const int clipRectangleSize[3]);
 
   /*!
-  Flip a 2D image along one or two axes. This is a performance optimized version of flipping that does not use ITK filters
+  Flip a 2D image along one or two axes. This is a performance optimized version of flipping that does not use ITK filters.
+  Horizontal flips and transposition use vectorized kernels if the CPU supports them (see PlusCpuFeatures).
   \param clipRectangleOrigin the clipping origin relative to the inUsImage data origin
   \param clipRectangleSize the size of the clipping space, a value of NO_CLIP in either [0],[1] or [2] indicates no clipping performed
   */
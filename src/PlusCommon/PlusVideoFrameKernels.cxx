@@ -0,0 +1,229 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusVideoFrameKernels.h"
+
+#include <string.h>
+
+#ifdef PLUS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Copy the pixels [first, width) of the input row reversed into the output row
+  inline void ReverseRowTail(const unsigned char* input, unsigned char* output, int first, int width, int bytesPerPixel)
+  {
+    for (int x = first; x < width; ++x)
+    {
+      memcpy(output + (width - 1 - x) * bytesPerPixel, input + x * bytesPerPixel, bytesPerPixel);
+    }
+  }
+
+#ifdef PLUS_X86_SIMD
+  //----------------------------------------------------------------------------
+  // Shuffle mask that reverses the order of the elements of elementSize bytes in a 16-byte vector
+  PLUS_SIMD_TARGET("ssse3")
+  __m128i GetReverseElementsMask(int elementSize)
+  {
+    alignas(16) unsigned char mask[16];
+    const int numberOfElements = 16 / elementSize;
+    for (int e = 0; e < numberOfElements; ++e)
+    {
+      for (int b = 0; b < elementSize; ++b)
+      {
+        mask[(numberOfElements - 1 - e) * elementSize + b] = static_cast<unsigned char>(e * elementSize + b);
+      }
+    }
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+  }
+
+  //----------------------------------------------------------------------------
+  // Shuffle mask that reverses 5 RGB pixels: input bytes 0-14 are written to output bytes 1-15 in reversed pixel order
+  PLUS_SIMD_TARGET("ssse3")
+  __m128i GetReverseRgbMask()
+  {
+    alignas(16) unsigned char mask[16];
+    mask[0] = 0x80; // zero, this byte is overwritten by the next block
+    for (int p = 0; p < 5; ++p)
+    {
+      for (int b = 0; b < 3; ++b)
+      {
+        mask[1 + (4 - p) * 3 + b] = static_cast<unsigned char>(p * 3 + b);
+      }
+    }
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+  }
+
+  //----------------------------------------------------------------------------
+  PLUS_SIMD_TARGET("ssse3")
+  void ReverseRowSsse3(const unsigned char* input, unsigned char* output, int width, int bytesPerPixel, __m128i mask)
+  {
+    int x = 0;
+    if (bytesPerPixel == 3)
+    {
+      // 5 pixels per block; the 16-byte load and store touch one extra byte, therefore one more pixel must remain in the row
+      for (; x + 6 <= width; x += 5)
+      {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + x * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + (width - x - 5) * 3 - 1), _mm_shuffle_epi8(pixels, mask));
+      }
+    }
+    else
+    {
+      const int pixelsPerBlock = 16 / bytesPerPixel;
+      for (; x + pixelsPerBlock <= width; x += pixelsPerBlock)
+      {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + x * bytesPerPixel));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + (width - x - pixelsPerBlock) * bytesPerPixel), _mm_shuffle_epi8(pixels, mask));
+      }
+    }
+    ReverseRowTail(input, output, x, width, bytesPerPixel);
+  }
+
+  //----------------------------------------------------------------------------
+  PLUS_SIMD_TARGET("avx2")
+  void ReverseRowAvx2(const unsigned char* input, unsigned char* output, int width, int bytesPerPixel, __m128i mask128)
+  {
+    // Reverse within each 128-bit lane, then swap the lanes
+    const __m256i mask = _mm256_broadcastsi128_si256(mask128);
+    const int pixelsPerBlock = 32 / bytesPerPixel;
+    int x = 0;
+    for (; x + pixelsPerBlock <= width; x += pixelsPerBlock)
+    {
+      __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + x * bytesPerPixel));
+      __m256i reversed = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(pixels, mask), 0x4E);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + (width - x - pixelsPerBlock) * bytesPerPixel), reversed);
+    }
+    ReverseRowTail(input, output, x, width, bytesPerPixel);
+  }
+
+  //----------------------------------------------------------------------------
+  // Transpose a 4x4 block of 32-bit pixels
+  PLUS_SIMD_TARGET("ssse3")
+  inline void Transpose4x4Sse(const unsigned char* input, long long inputRowStride, unsigned char* output, long long outputRowStride)
+  {
+    __m128 row0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input)));
+    __m128 row1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + inputRowStride)));
+    __m128 row2 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 2 * inputRowStride)));
+    __m128 row3 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 3 * inputRowStride)));
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_castps_si128(row0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + outputRowStride), _mm_castps_si128(row1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 2 * outputRowStride), _mm_castps_si128(row2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 3 * outputRowStride), _mm_castps_si128(row3));
+  }
+#endif
+
+  //----------------------------------------------------------------------------
+  // Transpose a block of pixels one by one. The pixel size is a template parameter so that copying a pixel compiles to a single move.
+  template<int BytesPerPixel>
+  inline void TransposeBlock(const unsigned char* input, long long inputRowStride, unsigned char* output, long long outputRowStride, int rows, int columns)
+  {
+    for (int c = 0; c < columns; ++c)
+    {
+      unsigned char* outputPixel = output + c * outputRowStride;
+      const unsigned char* inputPixel = input + c * BytesPerPixel;
+      for (int r = 0; r < rows; ++r)
+      {
+        memcpy(outputPixel, inputPixel, BytesPerPixel);
+        outputPixel += BytesPerPixel;
+        inputPixel += inputRowStride;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Cache-blocked transpose: the input and output blocks both fit in the L1 cache
+  template<int BytesPerPixel>
+  void TransposeBlocked(const unsigned char* input, long long inputRowStride, unsigned char* output, long long outputRowStride, int rows, int columns, bool useSse)
+  {
+    const int BLOCK_SIZE = 32;
+    for (int r0 = 0; r0 < rows; r0 += BLOCK_SIZE)
+    {
+      const int blockRows = (rows - r0 < BLOCK_SIZE ? rows - r0 : BLOCK_SIZE);
+      for (int c0 = 0; c0 < columns; c0 += BLOCK_SIZE)
+      {
+        const int blockColumns = (columns - c0 < BLOCK_SIZE ? columns - c0 : BLOCK_SIZE);
+        const unsigned char* inputBlock = input + r0 * inputRowStride + c0 * BytesPerPixel;
+        unsigned char* outputBlock = output + c0 * outputRowStride + r0 * BytesPerPixel;
+#ifdef PLUS_X86_SIMD
+        if (useSse && BytesPerPixel == 4 && blockRows == BLOCK_SIZE && blockColumns == BLOCK_SIZE)
+        {
+          for (int r = 0; r < BLOCK_SIZE; r += 4)
+          {
+            for (int c = 0; c < BLOCK_SIZE; c += 4)
+            {
+              Transpose4x4Sse(inputBlock + r * inputRowStride + c * 4, inputRowStride, outputBlock + c * outputRowStride + r * 4, outputRowStride);
+            }
+          }
+          continue;
+        }
+#endif
+        TransposeBlock<BytesPerPixel>(inputBlock, inputRowStride, outputBlock, outputRowStride, blockRows, blockColumns);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool PlusVideoFrameKernels::FlipRows(const unsigned char* input, long long inputRowStride, unsigned char* output, long long outputRowStride,
+                                     int width, int numberOfRows, int bytesPerPixel, bool reverseRowOrder, PlusCpuFeatures::InstructionSetType instructionSet)
+{
+#ifdef PLUS_X86_SIMD
+  if (instructionSet < PlusCpuFeatures::INSTRUCTION_SET_SSSE3 || (bytesPerPixel != 1 && bytesPerPixel != 2 && bytesPerPixel != 3 && bytesPerPixel != 4))
+  {
+    return false;
+  }
+  // There is no AVX2 kernel for 3-byte pixels, as 32-byte blocks do not contain whole pixels
+  const bool useAvx2 = (instructionSet >= PlusCpuFeatures::INSTRUCTION_SET_AVX2 && bytesPerPixel != 3);
+  const __m128i mask = (bytesPerPixel == 3 ? GetReverseRgbMask() : GetReverseElementsMask(bytesPerPixel));
+  for (int y = 0; y < numberOfRows; ++y)
+  {
+    const unsigned char* inputRow = input + y * inputRowStride;
+    unsigned char* outputRow = output + (reverseRowOrder ? numberOfRows - 1 - y : y) * outputRowStride;
+    if (useAvx2)
+    {
+      ReverseRowAvx2(inputRow, outputRow, width, bytesPerPixel, mask);
+    }
+    else
+    {
+      ReverseRowSsse3(inputRow, outputRow, width, bytesPerPixel, mask);
+    }
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool PlusVideoFrameKernels::Transpose(const unsigned char* input, long long inputRowStride, unsigned char* output, long long outputRowStride,
+                                      int numberOfInputRows, int numberOfInputColumns, int bytesPerPixel, PlusCpuFeatures::InstructionSetType instructionSet)
+{
+  if (instructionSet < PlusCpuFeatures::INSTRUCTION_SET_SSSE3)
+  {
+    return false;
+  }
+  switch (bytesPerPixel)
+  {
+    case 1:
+      TransposeBlocked<1>(input, inputRowStride, output, outputRowStride, numberOfInputRows, numberOfInputColumns, true);
+      return true;
+    case 2:
+      TransposeBlocked<2>(input, inputRowStride, output, outputRowStride, numberOfInputRows, numberOfInputColumns, true);
+      return true;
+    case 3:
+      TransposeBlocked<3>(input, inputRowStride, output, outputRowStride, numberOfInputRows, numberOfInputColumns, true);
+      return true;
+    case 4:
+      TransposeBlocked<4>(input, inputRowStride, output, outputRowStride, numberOfInputRows, numberOfInputColumns, true);
+      return true;
+    default:
+      return false;
+  }
+}
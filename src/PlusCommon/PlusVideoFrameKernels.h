@@ -0,0 +1,36 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PLUSVIDEOFRAMEKERNELS_H
+#define __PLUSVIDEOFRAMEKERNELS_H
+
+#include "PlusCpuFeatures.h"
+
+/*!
+  \namespace PlusVideoFrameKernels
+  \brief Vectorized pixel reordering kernels used by PlusVideoFrame::FlipClipImage
+
+  Strides are in bytes. The kernels return false if there is no vectorized implementation for the pixel size
+  or the instruction set, in this case the caller must use the portable implementation.
+  Internal to PlusVideoFrame, not exported.
+
+  \ingroup PlusLibCommon
+*/
+namespace PlusVideoFrameKernels
+{
+  /*!
+    Copy numberOfRows rows of width pixels, reversing the pixel order within each row (horizontal flip).
+    If reverseRowOrder is true then the first input row is written to the last output row (horizontal and vertical flip).
+  */
+  bool FlipRows(const unsigned char* input, long long inputRowStride, unsigned char* output, long long outputRowStride,
+                int width, int numberOfRows, int bytesPerPixel, bool reverseRowOrder, PlusCpuFeatures::InstructionSetType instructionSet);
+
+  /*! Transpose a 2D pixel array: output row c, column r is set to input row r, column c */
+  bool Transpose(const unsigned char* input, long long inputRowStride, unsigned char* output, long long outputRowStride,
+                 int numberOfInputRows, int numberOfInputColumns, int bytesPerPixel, PlusCpuFeatures::InstructionSetType instructionSet);
+}
+
+#endif
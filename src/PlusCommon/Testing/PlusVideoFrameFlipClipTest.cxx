@@ -0,0 +1,197 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusVideoFrameFlipClipTest.cxx
+  \brief Compares the vectorized and portable implementations of PlusVideoFrame::FlipClipImage
+
+  Each flip, transpose and clip operation is performed on typical ultrasound (820x616, 8-bit) and video (1920x1080 RGB) frames,
+  and on 16-bit and RGBA frames, once with vector instructions disabled and once with the best supported instruction set.
+  The test fails if the results are not bitwise identical. The average processing time of both implementations is reported.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusCpuFeatures.h"
+#include "PlusVideoFrame.h"
+#include "vtkImageData.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <string.h>
+
+namespace
+{
+  struct FrameFormat
+  {
+    const char* Name;
+    int Size[3];
+    int ScalarType;
+    int NumberOfScalarComponents;
+  };
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkImageData> CreateImage(const FrameFormat& format)
+  {
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetExtent(0, format.Size[0] - 1, 0, format.Size[1] - 1, 0, format.Size[2] - 1);
+    image->AllocateScalars(format.ScalarType, format.NumberOfScalarComponents);
+    unsigned char* pixels = static_cast<unsigned char*>(image->GetScalarPointer());
+    const size_t sizeInBytes = static_cast<size_t>(image->GetNumberOfPoints()) * format.NumberOfScalarComponents * image->GetScalarSize();
+    unsigned int state = 12345;
+    for (size_t i = 0; i < sizeInBytes; ++i)
+    {
+      state = state * 1103515245 + 12345;
+      pixels[i] = static_cast<unsigned char>(state >> 16);
+    }
+    return image;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus RunFlipClip(vtkImageData* inputImage, const PlusVideoFrame::FlipInfoType& flipInfo, const int clipOrigin[3], const int clipSize[3],
+                         PlusCpuFeatures::InstructionSetType instructionSet, int numberOfRepetitions, vtkImageData* outputImage, double& averageTimeMs)
+  {
+    PlusCpuFeatures::SetMaximumInstructionSet(instructionSet);
+    double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfRepetitions; ++i)
+    {
+      if (PlusVideoFrame::FlipClipImage(inputImage, flipInfo, clipOrigin, clipSize, outputImage) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("FlipClipImage failed");
+        return PLUS_FAIL;
+      }
+    }
+    averageTimeMs = (vtkPlusAccurateTimer::GetSystemTime() - startTime) * 1000.0 / numberOfRepetitions;
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int CompareImplementations(const FrameFormat& format, const char* operationName, const PlusVideoFrame::FlipInfoType& flipInfo, bool clip, int numberOfRepetitions)
+  {
+    vtkSmartPointer<vtkImageData> inputImage = CreateImage(format);
+    int clipOrigin[3] = { PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP };
+    int clipSize[3] = { PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP };
+    if (clip)
+    {
+      // odd origin and size, to test unaligned rows and partial vector blocks
+      clipOrigin[0] = 3;
+      clipOrigin[1] = 5;
+      clipOrigin[2] = 0;
+      clipSize[0] = format.Size[0] - 10;
+      clipSize[1] = format.Size[1] - 7;
+      clipSize[2] = format.Size[2];
+    }
+
+    vtkSmartPointer<vtkImageData> scalarOutput = vtkSmartPointer<vtkImageData>::New();
+    vtkSmartPointer<vtkImageData> vectorizedOutput = vtkSmartPointer<vtkImageData>::New();
+    double scalarTimeMs = 0;
+    double vectorizedTimeMs = 0;
+    PlusCpuFeatures::InstructionSetType supportedInstructionSet = PlusCpuFeatures::GetSupportedInstructionSet();
+    if (RunFlipClip(inputImage, flipInfo, clipOrigin, clipSize, PlusCpuFeatures::INSTRUCTION_SET_SCALAR, numberOfRepetitions, scalarOutput, scalarTimeMs) != PLUS_SUCCESS
+        || RunFlipClip(inputImage, flipInfo, clipOrigin, clipSize, supportedInstructionSet, numberOfRepetitions, vectorizedOutput, vectorizedTimeMs) != PLUS_SUCCESS)
+    {
+      return 1;
+    }
+
+    int scalarDims[3] = { 0, 0, 0 };
+    scalarOutput->GetDimensions(scalarDims);
+    int vectorizedDims[3] = { 0, 0, 0 };
+    vectorizedOutput->GetDimensions(vectorizedDims);
+    const size_t sizeInBytes = static_cast<size_t>(scalarOutput->GetNumberOfPoints()) * scalarOutput->GetNumberOfScalarComponents() * scalarOutput->GetScalarSize();
+    if (scalarDims[0] != vectorizedDims[0] || scalarDims[1] != vectorizedDims[1] || scalarDims[2] != vectorizedDims[2]
+        || memcmp(scalarOutput->GetScalarPointer(), vectorizedOutput->GetScalarPointer(), sizeInBytes) != 0)
+    {
+      LOG_ERROR(format.Name << " " << operationName << (clip ? " with clipping" : "") << ": " << PlusCpuFeatures::GetInstructionSetAsString(supportedInstructionSet)
+                << " result is different from the scalar result");
+      return 1;
+    }
+
+    LOG_INFO(format.Name << " " << operationName << (clip ? " with clipping" : "") << ": scalar " << scalarTimeMs << "ms, "
+             << PlusCpuFeatures::GetInstructionSetAsString(supportedInstructionSet) << " " << vectorizedTimeMs << "ms");
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfRepetitions(20);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of times each operation is timed (Default: 20).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfRepetitions < 1)
+  {
+    LOG_ERROR("Number of repetitions must be positive");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Supported instruction set: " << PlusCpuFeatures::GetInstructionSetAsString(PlusCpuFeatures::GetSupportedInstructionSet()));
+
+  const FrameFormat frameFormats[] =
+  {
+    { "Ultrasound 820x616 8-bit", { 820, 616, 1 }, VTK_UNSIGNED_CHAR, 1 },
+    { "Video 1920x1080 RGB", { 1920, 1080, 1 }, VTK_UNSIGNED_CHAR, 3 },
+    { "RF 512x256 16-bit", { 512, 256, 1 }, VTK_SHORT, 1 },
+    { "Video 641x479 RGBA", { 641, 479, 1 }, VTK_UNSIGNED_CHAR, 4 }
+  };
+  const FrameFormat volumeFormat = { "Volume 67x45x38 8-bit", { 67, 45, 38 }, VTK_UNSIGNED_CHAR, 1 };
+
+  PlusVideoFrame::FlipInfoType flipX;
+  flipX.hFlip = true;
+  PlusVideoFrame::FlipInfoType flipY;
+  flipY.vFlip = true;
+  PlusVideoFrame::FlipInfoType flipXY;
+  flipXY.hFlip = true;
+  flipXY.vFlip = true;
+  PlusVideoFrame::FlipInfoType transpose;
+  transpose.tranpose = PlusVideoFrame::TRANSPOSE_IJKtoKIJ;
+
+  int numberOfErrors = 0;
+  for (size_t i = 0; i < sizeof(frameFormats) / sizeof(frameFormats[0]); ++i)
+  {
+    for (int clip = 0; clip < 2; ++clip)
+    {
+      numberOfErrors += CompareImplementations(frameFormats[i], "flip X", flipX, clip != 0, numberOfRepetitions);
+      numberOfErrors += CompareImplementations(frameFormats[i], "flip Y", flipY, clip != 0, numberOfRepetitions);
+      numberOfErrors += CompareImplementations(frameFormats[i], "flip XY", flipXY, clip != 0, numberOfRepetitions);
+    }
+  }
+  numberOfErrors += CompareImplementations(volumeFormat, "transpose", transpose, false, numberOfRepetitions);
+  numberOfErrors += CompareImplementations(volumeFormat, "transpose", transpose, true, numberOfRepetitions);
+
+  PlusCpuFeatures::SetMaximumInstructionSet(PlusCpuFeatures::INSTRUCTION_SET_AVX2);
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
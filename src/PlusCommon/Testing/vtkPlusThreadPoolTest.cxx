@@ -0,0 +1,166 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusThreadPoolTest.cxx
+  \brief Tests vtkPlusThreadPool
+
+  Checks that each iteration of a loop is processed exactly once, for different numbers of threads and iterations and
+  with very uneven processing time of the iterations. Reports the overhead of running a short loop on the thread pool
+  and by vtkMultiThreader::SingleMethodExecute, which starts new threads for each loop.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkMultiThreader.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkPlusThreadPool.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <atomic>
+#include <vector>
+
+namespace
+{
+  struct LoopData
+  {
+    std::vector<std::atomic<int> >* ProcessedCount;
+    int NumberOfWorkers;
+    std::atomic<int> InvalidWorkerIndexCount;
+  };
+
+  //----------------------------------------------------------------------------
+  void CountIteration(void* userData, int iteration, int workerIndex)
+  {
+    LoopData* data = static_cast<LoopData*>(userData);
+    if (workerIndex < 0 || workerIndex >= data->NumberOfWorkers)
+    {
+      data->InvalidWorkerIndexCount++;
+    }
+    // The first few iterations take much longer than the others, the remaining work has to be taken over by other workers
+    if (iteration < 4)
+    {
+      volatile double sum = 0;
+      for (int i = 0; i < 100000; ++i)
+      {
+        sum = sum + i;
+      }
+    }
+    (*data->ProcessedCount)[iteration]++;
+  }
+
+  //----------------------------------------------------------------------------
+  void EmptyIteration(void* userData, int iteration, int workerIndex)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  VTK_THREAD_RETURN_TYPE EmptyThreadFunction(void* arg)
+  {
+    return VTK_THREAD_RETURN_VALUE;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestAllIterationsProcessed(vtkPlusThreadPool* pool, int numberOfThreads)
+  {
+    pool->SetNumberOfThreads(numberOfThreads);
+    int numberOfErrors = 0;
+    for (int numberOfIterations = 0; numberOfIterations < 200; numberOfIterations += 7)
+    {
+      std::vector<std::atomic<int> > processedCount(numberOfIterations);
+      for (int i = 0; i < numberOfIterations; ++i)
+      {
+        processedCount[i] = 0;
+      }
+      LoopData data;
+      data.ProcessedCount = &processedCount;
+      data.NumberOfWorkers = pool->GetNumberOfWorkers();
+      data.InvalidWorkerIndexCount = 0;
+      if (pool->Execute(CountIteration, &data, numberOfIterations) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to execute loop with " << numberOfIterations << " iterations on " << numberOfThreads << " threads");
+        numberOfErrors++;
+        continue;
+      }
+      for (int i = 0; i < numberOfIterations; ++i)
+      {
+        if (processedCount[i] != 1)
+        {
+          LOG_ERROR("Iteration " << i << " of " << numberOfIterations << " was processed " << processedCount[i] << " times on " << numberOfThreads << " threads");
+          numberOfErrors++;
+        }
+      }
+      if (data.InvalidWorkerIndexCount > 0)
+      {
+        LOG_ERROR("Invalid worker index was passed to the loop body " << data.InvalidWorkerIndexCount << " times");
+        numberOfErrors++;
+      }
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int numberOfLoops = 1000;
+  int numberOfThreads = 0;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--number-of-loops", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfLoops, "Number of loops executed in the timing test (default: 1000)");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads in the timing test, 0 means the number of processors (default: 0)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkPlusThreadPool> pool = vtkSmartPointer<vtkPlusThreadPool>::New();
+  int numberOfErrors = 0;
+  const int threadCounts[4] = { 1, 2, 5, 0 };
+  for (int i = 0; i < 4; ++i)
+  {
+    numberOfErrors += TestAllIterationsProcessed(pool, threadCounts[i]);
+  }
+
+  // Overhead of short loops
+  pool->SetNumberOfThreads(numberOfThreads);
+  double startTime = vtkPlusAccurateTimer::GetSystemTime();
+  for (int i = 0; i < numberOfLoops; ++i)
+  {
+    pool->Execute(EmptyIteration, NULL, 64);
+  }
+  double poolTimeSec = vtkPlusAccurateTimer::GetSystemTime() - startTime;
+
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(pool->GetNumberOfWorkers());
+  threader->SetSingleMethod(EmptyThreadFunction, NULL);
+  startTime = vtkPlusAccurateTimer::GetSystemTime();
+  for (int i = 0; i < numberOfLoops; ++i)
+  {
+    threader->SingleMethodExecute();
+  }
+  double threaderTimeSec = vtkPlusAccurateTimer::GetSystemTime() - startTime;
+
+  LOG_INFO("Loop overhead with " << pool->GetNumberOfWorkers() << " threads: thread pool " << poolTimeSec * 1e6 / numberOfLoops
+           << " us/loop, vtkMultiThreader::SingleMethodExecute " << threaderTimeSec * 1e6 / numberOfLoops << " us/loop");
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
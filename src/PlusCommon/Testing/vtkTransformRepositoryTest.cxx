@@ -373,6 +373,55 @@ int main(int argc, char **argv)
     return EXIT_FAILURE;
   }
 
+  /////////////////////////////////////////////////////////////////////////////
+  // Check that transform paths are updated when transforms are added or deleted
+  vtkSmartPointer<vtkMatrix4x4> mxPhantomToReference=vtkSmartPointer<vtkMatrix4x4>::New();
+  mxPhantomToReference->Element[0][3]=-12;
+  mxPhantomToReference->Element[1][1]=0.5;
+  transformRepository->SetTransform(PlusTransformName("Phantom", "Reference"), mxPhantomToReference);
+  // Get the transform (the path through Phantom is stored in the repository)
+  vtkSmartPointer<vtkMatrix4x4> mxProbeToReference=vtkSmartPointer<vtkMatrix4x4>::New();
+  if (transformRepository->GetTransform(PlusTransformName("Probe", "Reference"), mxProbeToReference)!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get ProbeToReference transform");
+    return EXIT_FAILURE;
+  }
+  if (transformRepository->DeleteTransform(PlusTransformName("Phantom", "Reference"))!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("Transform delete failed");
+    return EXIT_FAILURE;
+  }
+  if (transformRepository->IsExistingTransform(PlusTransformName("Probe", "Reference"))==PLUS_SUCCESS)
+  {
+    LOG_ERROR("ProbeToReference transform should not be available after deleting PhantomToReference");
+    return EXIT_FAILURE;
+  }
+  // Add a direct transform between Reference and Probe
+  vtkSmartPointer<vtkMatrix4x4> mxReferenceToProbe=vtkSmartPointer<vtkMatrix4x4>::New();
+  mxReferenceToProbe->Element[1][3]=7;
+  mxReferenceToProbe->Element[2][2]=2;
+  if (transformRepository->SetTransform(PlusTransformName("Reference", "Probe"), mxReferenceToProbe)!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("Set transform should have been succeeded");
+    return EXIT_FAILURE;
+  }
+  if (transformRepository->GetTransform(PlusTransformName("Probe", "Reference"), mxProbeToReference)!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get ProbeToReference transform");
+    return EXIT_FAILURE;
+  }
+  vtkSmartPointer<vtkMatrix4x4> mxProbeToReferenceManual=vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(mxReferenceToProbe, mxProbeToReferenceManual);
+  posDiff=PlusMath::GetPositionDifference(mxProbeToReference, mxProbeToReferenceManual); 
+  orientDiff=PlusMath::GetOrientationDifference(mxProbeToReference, mxProbeToReferenceManual); 
+  LOG_INFO("Position difference: "<< posDiff);
+  LOG_INFO("Orientation difference: "<< orientDiff);
+  if (fabs(posDiff)>0.001 || fabs(orientDiff)>0.001)
+  {
+    LOG_ERROR("Mismatch between transforms computed by transformRepository and manually after changing the transforms");
+    return EXIT_FAILURE;
+  }
+
   /////////////////////////////////////////////////////////////////////////////
   // Check clear
   transformRepository->Clear();
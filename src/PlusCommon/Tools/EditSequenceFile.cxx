@@ -8,6 +8,8 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "PlusMath.h"
 #include "PlusTrackedFrame.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkPlusMetaImageSequenceIO.h"
 #include "vtkPlusSequenceIO.h"
 #include "vtkPlusTrackedFrameList.h"
 #include "vtkPlusTransformRepository.h"
@@ -21,6 +23,11 @@ See License.txt for details.
 #include <vtkXMLUtilities.h>
 #include <vtksys/CommandLineArguments.hxx>
 #include <vtksys/RegularExpression.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <algorithm>
+#include <climits>
 
 enum OperationType
 {
@@ -68,6 +75,7 @@ public:
 
 PlusStatus TrimSequenceFile(vtkPlusTrackedFrameList* trackedFrameList, unsigned int firstFrameIndex, unsigned int lastFrameIndex);
 PlusStatus DecimateSequenceFile(vtkPlusTrackedFrameList* trackedFrameList, unsigned int decimationFactor);
+PlusStatus ReadSelectedFrames(vtkPlusTrackedFrameList* trackedFrameList, const std::string& inputFileName, unsigned int firstFrameIndex, unsigned int lastFrameIndex, unsigned int frameIndexIncrement);
 PlusStatus UpdateFrameFieldValue(FrameFieldUpdate& fieldUpdate);
 PlusStatus DeleteFrameField(vtkPlusTrackedFrameList* trackedFrameList, std::string fieldName);
 PlusStatus ConvertStringToMatrix(std::string& strMatrix, vtkMatrix4x4* matrix);
@@ -198,6 +206,29 @@ PlusStatus AppendTrackedFrameLists(vtkPlusTrackedFrameList* trackedFrameList, st
   return PLUS_SUCCESS;
 }
 
+// Read all frame fields but decode only the image data of the selected frames
+//----------------------------------------------------------------------------
+PlusStatus ReadSelectedFrames(vtkPlusTrackedFrameList* trackedFrameList, const std::string& inputFileName, unsigned int firstFrameIndex, unsigned int lastFrameIndex, unsigned int frameIndexIncrement)
+{
+  LOG_INFO("Read input sequence file: " << inputFileName);
+  vtkSmartPointer<vtkPlusMetaImageSequenceIO> reader = vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+  reader->SetFileName(inputFileName);
+  reader->SetTrackedFrameList(trackedFrameList);
+  reader->LoadImageDataOnDemandOn();
+  if (reader->Read() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Couldn't read sequence file: " << inputFileName);
+    return PLUS_FAIL;
+  }
+
+  for (unsigned int frameIndex = firstFrameIndex; frameIndex <= lastFrameIndex && frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); frameIndex += frameIndexIncrement)
+  {
+    // Frames with invalid image status have no image data, they are kept without image (same as when the whole file is read)
+    reader->ReadFrameImageData(frameIndex, *trackedFrameList->GetTrackedFrame(frameIndex)->GetImageData());
+  }
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
@@ -212,6 +243,7 @@ int main(int argc, char** argv)
   std::string                     strOperation;
   OperationType                   operation;
   bool                            useCompression = false;
+  int                             numberOfCompressionThreads = 0; // Number of threads used for compressing images (Default: number of processors)
   bool                            incrementTimestamps = false;
 
   int                             firstFrameIndex = -1; // First frame index used for trimming the sequence file.
@@ -281,6 +313,7 @@ int main(int argc, char** argv)
   args.AddArgument("--update-reference-transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &strUpdatedReferenceTransformName, "Set the reference transform name to update old files by changing all ToolToReference transforms to ToolToTracker transform.");
 
   args.AddArgument("--use-compression", vtksys::CommandLineArguments::NO_ARGUMENT, &useCompression, "Compress sequence file images.");
+  args.AddArgument("--compression-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfCompressionThreads, "Number of threads used for compressing sequence file images (Default: 0 = number of processors)");
   args.AddArgument("--increment-timestamps", vtksys::CommandLineArguments::NO_ARGUMENT, &incrementTimestamps, "Increment timestamps in the order of the input-file-names");
 
   args.AddArgument("--add-transform", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &transformNamesToAdd, "Name of the transform to add to each frame (e.g., StylusTipToTracker); multiple transforms can be added separated by a comma (e.g., StylusTipToReference,ProbeToReference)");
@@ -468,6 +501,23 @@ int main(int argc, char** argv)
   {
     status = MixTrackedFrameLists(trackedFrameList, inputFileNames);
   }
+  else if ((operation == TRIM || operation == DECIMATE) && inputFileNames.size() == 1 && vtkPlusMetaImageSequenceIO::CanReadFile(inputFileNames[0]))
+  {
+    // Only decode the image data of frames that are kept, the other frames are removed by the operation below
+    unsigned int firstSelectedFrameIndex = 0;
+    unsigned int lastSelectedFrameIndex = UINT_MAX;
+    unsigned int frameIndexIncrement = 1;
+    if (operation == TRIM)
+    {
+      firstSelectedFrameIndex = static_cast<unsigned int>(std::max(firstFrameIndex, 0));
+      lastSelectedFrameIndex = static_cast<unsigned int>(std::max(lastFrameIndex, 0));
+    }
+    else if (decimationFactor >= 2)
+    {
+      frameIndexIncrement = static_cast<unsigned int>(decimationFactor);
+    }
+    status = ReadSelectedFrames(trackedFrameList, inputFileNames[0], firstSelectedFrameIndex, lastSelectedFrameIndex, frameIndexIncrement);
+  }
   else
   {
     status = AppendTrackedFrameLists(trackedFrameList, inputFileNames, incrementTimestamps);
@@ -766,11 +816,27 @@ int main(int argc, char** argv)
   // Save output file to file
 
   LOG_INFO("Save output sequence file to: " << outputFileName);
+  vtkPlusSequenceIOBase::SetDefaultNumberOfCompressionThreads(numberOfCompressionThreads);
+  double imageDataSizeMb = 0.0;
+  if (operation != REMOVE_IMAGE_DATA)
+  {
+    for (unsigned int i = 0; i < trackedFrameList->GetNumberOfTrackedFrames(); ++i)
+    {
+      imageDataSizeMb += trackedFrameList->GetTrackedFrame(i)->GetImageData()->GetFrameSizeInBytes() / (1024.0 * 1024.0);
+    }
+  }
+  double writeStartTime = vtkPlusAccurateTimer::GetSystemTime();
   if (vtkPlusSequenceIO::Write(outputFileName, trackedFrameList, trackedFrameList->GetImageOrientation(), useCompression, operation != REMOVE_IMAGE_DATA) != PLUS_SUCCESS)
   {
     LOG_ERROR("Couldn't write sequence file: " << outputFileName);
     return EXIT_FAILURE;
   }
+  double writeTimeSec = vtkPlusAccurateTimer::GetSystemTime() - writeStartTime;
+  if (writeTimeSec > 0)
+  {
+    LOG_INFO("Wrote " << imageDataSizeMb << " MB of image data " << (useCompression ? "with" : "without") << " compression in " << writeTimeSec << " sec ("
+             << imageDataSizeMb / writeTimeSec << " MB/sec), output file size: " << vtksys::SystemTools::FileLength(outputFileName) / (1024.0 * 1024.0) << " MB");
+  }
 
   LOG_INFO("Sequence file editing was successful!");
   return EXIT_SUCCESS;
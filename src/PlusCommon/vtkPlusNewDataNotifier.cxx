@@ -0,0 +1,66 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusNewDataNotifier.h"
+
+#include "vtkObjectFactory.h"
+
+#include <chrono>
+
+vtkStandardNewMacro(vtkPlusNewDataNotifier);
+
+//----------------------------------------------------------------------------
+vtkPlusNewDataNotifier::vtkPlusNewDataNotifier()
+  : NotificationCount(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusNewDataNotifier::~vtkPlusNewDataNotifier()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusNewDataNotifier::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NotificationCount: " << this->GetNotificationCount() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusNewDataNotifier::Notify()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->NotificationCount++;
+  }
+  this->NewDataAvailable.notify_all();
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusNewDataNotifier::Wait(unsigned long& lastSeenNotificationCount, double timeoutSec)
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  if (this->NotificationCount == lastSeenNotificationCount && timeoutSec > 0)
+  {
+    const unsigned long notificationCountOnEntry = lastSeenNotificationCount;
+    this->NewDataAvailable.wait_for(lock, std::chrono::duration<double>(timeoutSec), [this, notificationCountOnEntry]
+    {
+      return this->NotificationCount != notificationCountOnEntry;
+    });
+  }
+  bool newData = (this->NotificationCount != lastSeenNotificationCount);
+  lastSeenNotificationCount = this->NotificationCount;
+  return newData;
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusNewDataNotifier::GetNotificationCount()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->NotificationCount;
+}
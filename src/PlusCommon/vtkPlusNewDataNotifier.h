@@ -0,0 +1,62 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusNewDataNotifier_h
+#define __vtkPlusNewDataNotifier_h
+
+#include "vtkPlusCommonExport.h"
+
+#include "vtkObject.h"
+
+#include <condition_variable>
+#include <mutex>
+
+/*!
+  \class vtkPlusNewDataNotifier
+  \brief Wakes up a waiting thread when new data is available
+
+  Producers (e.g., buffers when an item is added) call Notify(). A consumer thread calls Wait() with the notification
+  count it has already processed and is woken up as soon as any new notification arrives, or when the timeout expires.
+  This allows a consumer to react immediately to new data without polling.
+
+  All methods can be called from any thread.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport vtkPlusNewDataNotifier : public vtkObject
+{
+public:
+  static vtkPlusNewDataNotifier* New();
+  vtkTypeMacro(vtkPlusNewDataNotifier, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Signal that new data is available and wake up all waiting threads */
+  void Notify();
+
+  /*!
+    Wait until a notification arrives that has not been seen yet or until timeoutSec elapses.
+    \param lastSeenNotificationCount Number of notifications that the caller has already processed, updated to the current count on return
+    \return true if there were new notifications
+  */
+  bool Wait(unsigned long& lastSeenNotificationCount, double timeoutSec);
+
+  /*! Total number of notifications since the object was created */
+  unsigned long GetNotificationCount();
+
+protected:
+  vtkPlusNewDataNotifier();
+  virtual ~vtkPlusNewDataNotifier();
+
+  std::mutex Mutex;
+  std::condition_variable NewDataAvailable;
+  unsigned long NotificationCount;
+
+private:
+  vtkPlusNewDataNotifier(const vtkPlusNewDataNotifier&);  // Not implemented.
+  void operator=(const vtkPlusNewDataNotifier&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,290 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusThreadPool.h"
+
+#include "vtkObjectFactory.h"
+
+#include <algorithm>
+
+vtkStandardNewMacro(vtkPlusThreadPool);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // The range of iterations of a worker is stored in a single 64-bit value (begin in the low, end in the high 32 bits),
+  // so that the owner and the other workers can update it atomically without locking
+  unsigned long long MakeRange(unsigned int begin, unsigned int end)
+  {
+    return (static_cast<unsigned long long>(end) << 32) | begin;
+  }
+  unsigned int GetRangeBegin(unsigned long long range)
+  {
+    return static_cast<unsigned int>(range & 0xFFFFFFFFull);
+  }
+  unsigned int GetRangeEnd(unsigned long long range)
+  {
+    return static_cast<unsigned int>(range >> 32);
+  }
+}
+
+//----------------------------------------------------------------------------
+struct vtkPlusThreadPool::Worker
+{
+  Worker(vtkPlusThreadPool* pool, int index)
+    : Pool(pool)
+    , Index(index)
+    , ThreadId(-1)
+    , ProcessedLoopCount(0)
+    , Range(0)
+  {
+  }
+  vtkPlusThreadPool* Pool;
+  int Index;
+  /*! Id of the thread in the multithreader, -1 for the calling thread */
+  int ThreadId;
+  /*! Last loop that has been processed by the worker thread, protected by LoopMutex */
+  unsigned long ProcessedLoopCount;
+  /*! Keep the ranges of different workers in different cache lines, as they are modified frequently */
+  char Padding[64];
+  std::atomic<unsigned long long> Range;
+};
+
+//----------------------------------------------------------------------------
+vtkPlusThreadPool::vtkPlusThreadPool()
+  : NumberOfThreads(0)
+  , Threader(vtkSmartPointer<vtkMultiThreader>::New())
+  , LoopCount(0)
+  , NumberOfBusyThreads(0)
+  , StopRequested(false)
+  , LoopBody(NULL)
+  , LoopUserData(NULL)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusThreadPool::~vtkPlusThreadPool()
+{
+  this->StopThreads();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusThreadPool::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+  os << indent << "NumberOfWorkers: " << this->GetNumberOfWorkers() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusThreadPool::SetNumberOfThreads(int numberOfThreads)
+{
+  if (numberOfThreads == this->NumberOfThreads)
+  {
+    return;
+  }
+  this->StopThreads();
+  this->NumberOfThreads = numberOfThreads;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusThreadPool::GetNumberOfWorkers()
+{
+  int numberOfWorkers = (this->NumberOfThreads > 0 ? this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads());
+  // The calling thread is one of the workers, the others are spawned by the multithreader
+  return std::max(1, std::min(numberOfWorkers, VTK_MAX_THREADS));
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusThreadPool::StartThreads()
+{
+  if (!this->Workers.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+  int numberOfWorkers = this->GetNumberOfWorkers();
+  this->Workers.push_back(new Worker(this, 0));
+  for (int workerIndex = 1; workerIndex < numberOfWorkers; ++workerIndex)
+  {
+    Worker* worker = new Worker(this, workerIndex);
+    // Set before the thread is started, so that the thread does not miss a loop that is started before it runs
+    worker->ProcessedLoopCount = this->LoopCount;
+    worker->ThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&WorkerThread, worker);
+    if (worker->ThreadId < 0)
+    {
+      LOG_WARNING("Failed to start worker thread " << workerIndex << ", only " << workerIndex << " workers are used");
+      delete worker;
+      break;
+    }
+    this->Workers.push_back(worker);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusThreadPool::StopThreads()
+{
+  std::lock_guard<std::mutex> executeLock(this->ExecuteMutex);
+  if (this->Workers.empty())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->LoopMutex);
+    this->StopRequested = true;
+  }
+  this->LoopStarted.notify_all();
+  for (std::vector<Worker*>::iterator it = this->Workers.begin(); it != this->Workers.end(); ++it)
+  {
+    if ((*it)->ThreadId >= 0)
+    {
+      // Waits for the termination of the thread
+      this->Threader->TerminateThread((*it)->ThreadId);
+    }
+    delete *it;
+  }
+  this->Workers.clear();
+  std::lock_guard<std::mutex> lock(this->LoopMutex);
+  this->StopRequested = false;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusThreadPool::Execute(LoopBodyFunctionType loopBody, void* userData, int numberOfIterations)
+{
+  if (loopBody == NULL)
+  {
+    LOG_ERROR("vtkPlusThreadPool::Execute failed: loop body is NULL");
+    return PLUS_FAIL;
+  }
+  if (numberOfIterations <= 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  std::lock_guard<std::mutex> executeLock(this->ExecuteMutex);
+  this->StartThreads();
+
+  // Initial partitioning: equal contiguous ranges, the rest is balanced by work stealing
+  const unsigned long long numberOfWorkers = this->Workers.size();
+  for (unsigned long long workerIndex = 0; workerIndex < numberOfWorkers; ++workerIndex)
+  {
+    unsigned int begin = static_cast<unsigned int>(numberOfIterations * workerIndex / numberOfWorkers);
+    unsigned int end = static_cast<unsigned int>(numberOfIterations * (workerIndex + 1) / numberOfWorkers);
+    this->Workers[workerIndex]->Range.store(MakeRange(begin, end));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->LoopMutex);
+    this->LoopBody = loopBody;
+    this->LoopUserData = userData;
+    this->NumberOfBusyThreads = static_cast<int>(numberOfWorkers) - 1;
+    this->LoopCount++;
+  }
+  this->LoopStarted.notify_all();
+
+  this->ProcessIterations(0);
+
+  std::unique_lock<std::mutex> lock(this->LoopMutex);
+  this->LoopCompleted.wait(lock, [this] { return this->NumberOfBusyThreads == 0; });
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusThreadPool::ProcessIterations(int workerIndex)
+{
+  int iteration = 0;
+  do
+  {
+    while (this->PopIteration(workerIndex, iteration))
+    {
+      this->LoopBody(this->LoopUserData, iteration, workerIndex);
+    }
+  }
+  while (this->StealIterations(workerIndex));
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusThreadPool::PopIteration(int workerIndex, int& iteration)
+{
+  std::atomic<unsigned long long>& range = this->Workers[workerIndex]->Range;
+  unsigned long long currentRange = range.load();
+  for (;;)
+  {
+    unsigned int begin = GetRangeBegin(currentRange);
+    unsigned int end = GetRangeEnd(currentRange);
+    if (begin >= end)
+    {
+      return false;
+    }
+    if (range.compare_exchange_weak(currentRange, MakeRange(begin + 1, end)))
+    {
+      iteration = static_cast<int>(begin);
+      return true;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusThreadPool::StealIterations(int workerIndex)
+{
+  const int numberOfWorkers = static_cast<int>(this->Workers.size());
+  for (int i = 1; i < numberOfWorkers; ++i)
+  {
+    std::atomic<unsigned long long>& victimRange = this->Workers[(workerIndex + i) % numberOfWorkers]->Range;
+    unsigned long long currentRange = victimRange.load();
+    for (;;)
+    {
+      unsigned int begin = GetRangeBegin(currentRange);
+      unsigned int end = GetRangeEnd(currentRange);
+      if (begin >= end)
+      {
+        break;
+      }
+      // Take the second half, the victim continues with the first half
+      unsigned int stolenBegin = end - (end - begin + 1) / 2;
+      if (victimRange.compare_exchange_weak(currentRange, MakeRange(begin, stolenBegin)))
+      {
+        this->Workers[workerIndex]->Range.store(MakeRange(stolenBegin, end));
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusThreadPool::WorkerThread(vtkMultiThreader::ThreadInfo* data)
+{
+  Worker* worker = static_cast<Worker*>(data->UserData);
+  vtkPlusThreadPool* self = worker->Pool;
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(self->LoopMutex);
+      self->LoopStarted.wait(lock, [self, worker] { return self->StopRequested || self->LoopCount != worker->ProcessedLoopCount; });
+      if (self->StopRequested)
+      {
+        break;
+      }
+      worker->ProcessedLoopCount = self->LoopCount;
+    }
+
+    self->ProcessIterations(worker->Index);
+
+    bool loopCompleted = false;
+    {
+      std::lock_guard<std::mutex> lock(self->LoopMutex);
+      loopCompleted = (--self->NumberOfBusyThreads == 0);
+    }
+    if (loopCompleted)
+    {
+      self->LoopCompleted.notify_all();
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,116 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusThreadPool_h
+#define __vtkPlusThreadPool_h
+
+#include "PlusCommon.h"
+#include "vtkPlusCommonExport.h"
+
+#include "vtkMultiThreader.h"
+#include "vtkObject.h"
+#include "vtkSmartPointer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+/*!
+  \class vtkPlusThreadPool
+  \brief Runs parallel loops on a set of persistent worker threads
+
+  The worker threads are started when the first loop is executed and are kept waiting for the next loop until the pool
+  is deleted or the number of threads is changed. This avoids creating and joining threads for each loop, which is
+  significant for short loops that are executed many times per second (e.g., inserting a frame into a volume).
+
+  The iterations of a loop are distributed between the workers by work stealing: each worker starts with an equal,
+  contiguous range of iterations and when it has finished its own range it takes half of the remaining iterations of
+  another worker. Workers therefore remain busy even if the processing time of the iterations is very uneven.
+  The calling thread participates in the processing as well.
+
+  Only one loop can be executed at a time, Execute() calls from multiple threads are serialized.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport vtkPlusThreadPool : public vtkObject
+{
+public:
+  static vtkPlusThreadPool* New();
+  vtkTypeMacro(vtkPlusThreadPool, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*!
+    Function that processes one iteration of a loop.
+    \param userData Pointer that was passed to Execute()
+    \param iteration Index of the iteration, between 0 and numberOfIterations-1
+    \param workerIndex Index of the worker that processes the iteration, between 0 and GetNumberOfWorkers()-1. Can be used to access per-worker data without locking.
+  */
+  typedef void (*LoopBodyFunctionType)(void* userData, int iteration, int workerIndex);
+
+  /*!
+    Set the number of threads that process the loops (including the calling thread).
+    0 means the default number of threads (number of processors). Running threads are stopped if the number is changed.
+  */
+  void SetNumberOfThreads(int numberOfThreads);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /*! Number of workers that process the iterations (worker threads and the calling thread) */
+  int GetNumberOfWorkers();
+
+  /*! Call loopBody for each iteration from 0 to numberOfIterations-1 in parallel. Returns when all iterations are processed. */
+  PlusStatus Execute(LoopBodyFunctionType loopBody, void* userData, int numberOfIterations);
+
+  /*! Stop the worker threads. They are started again by the next Execute() call. */
+  void StopThreads();
+
+protected:
+  vtkPlusThreadPool();
+  virtual ~vtkPlusThreadPool();
+
+  struct Worker;
+
+  /*! Start the worker threads if they are not running yet */
+  PlusStatus StartThreads();
+
+  /*! Process iterations of the current loop by the specified worker until no iterations are left */
+  void ProcessIterations(int workerIndex);
+
+  /*! Take the next iteration from the range of the worker. Returns false if the range is empty. */
+  bool PopIteration(int workerIndex, int& iteration);
+
+  /*! Move half of the remaining iterations of another worker into the (empty) range of the specified worker */
+  bool StealIterations(int workerIndex);
+
+  static void* WorkerThread(vtkMultiThreader::ThreadInfo* data);
+
+  int NumberOfThreads;
+
+  vtkSmartPointer<vtkMultiThreader> Threader;
+  std::vector<Worker*> Workers;
+
+  /*! Serializes Execute() calls */
+  std::mutex ExecuteMutex;
+
+  /*! Protects the fields below, which describe the loop that is currently executed */
+  std::mutex LoopMutex;
+  std::condition_variable LoopStarted;
+  std::condition_variable LoopCompleted;
+  /*! Incremented when a new loop is started, workers compare it to the last loop they have processed */
+  unsigned long LoopCount;
+  /*! Number of worker threads that have not finished the current loop yet */
+  int NumberOfBusyThreads;
+  bool StopRequested;
+
+  LoopBodyFunctionType LoopBody;
+  void* LoopUserData;
+
+private:
+  vtkPlusThreadPool(const vtkPlusThreadPool&);  // Not implemented.
+  void operator=(const vtkPlusThreadPool&);  // Not implemented.
+};
+
+#endif
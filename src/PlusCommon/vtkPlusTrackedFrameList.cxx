@@ -143,6 +143,17 @@ PlusStatus vtkPlusTrackedFrameList::AddTrackedFrameList(vtkPlusTrackedFrameList*
   return status;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusTrackedFrameList::TakeTrackedFrameList(vtkPlusTrackedFrameList* inTrackedFrameList)
+{
+  if (inTrackedFrameList == NULL || inTrackedFrameList == this)
+  {
+    return;
+  }
+  this->TrackedFrameList.insert(this->TrackedFrameList.end(), inTrackedFrameList->TrackedFrameList.begin(), inTrackedFrameList->TrackedFrameList.end());
+  inTrackedFrameList->TrackedFrameList.clear();
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusTrackedFrameList::AddTrackedFrame(PlusTrackedFrame* trackedFrame, InvalidFrameAction action /*=ADD_INVALID_FRAME_AND_REPORT_ERROR*/)
 {
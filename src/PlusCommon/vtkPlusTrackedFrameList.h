@@ -65,6 +65,12 @@ public:
   /*! Add all frames from a tracked frame list to the container. It adds all invalid frames as well, but an error is reported. */
   virtual PlusStatus AddTrackedFrameList(vtkPlusTrackedFrameList* inTrackedFrameList, InvalidFrameAction action = ADD_INVALID_FRAME_AND_REPORT_ERROR);
 
+  /*!
+    Move all frames from a tracked frame list to the end of this container without copying them.
+    The frames are not validated again. The input list is empty after the call.
+  */
+  virtual void TakeTrackedFrameList(vtkPlusTrackedFrameList* inTrackedFrameList);
+
   /*! Get tracked frame from container */
   virtual PlusTrackedFrame* GetTrackedFrame(int frameNumber);
   virtual PlusTrackedFrame* GetTrackedFrame(unsigned int frameNumber);
@@ -141,21 +141,21 @@ PlusStatus vtkPlusTransformRepository::SetTransforms(PlusTrackedFrame& trackedFr
 
   int numberOfErrors(0);
 
+  // The matrix is copied by SetTransform, so the same matrix object can be used for all transforms
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
   for (std::vector<PlusTransformName>::iterator it = transformNames.begin(); it != transformNames.end(); ++it)
   {
-    std::string trName;
-    it->GetTransformName(trName);
-
     if (it->From() == it->To())
     {
+      std::string trName;
+      it->GetTransformName(trName);
       LOG_ERROR("Setting a transform to itself is not allowed: " << trName);
       continue;
     }
 
-    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
     if (trackedFrame.GetCustomFrameTransform(*it, matrix) != PLUS_SUCCESS)
     {
-      LOG_ERROR("Failed to get custom frame transform from tracked frame: " << trName);
+      LOG_ERROR("Failed to get custom frame transform from tracked frame: " << it->GetTransformName());
       numberOfErrors++;
       continue;
     }
@@ -163,14 +163,14 @@ PlusStatus vtkPlusTransformRepository::SetTransforms(PlusTrackedFrame& trackedFr
     TrackedFrameFieldStatus status = FIELD_INVALID;
     if (trackedFrame.GetCustomFrameTransformStatus(*it, status) != PLUS_SUCCESS)
     {
-      LOG_ERROR("Failed to get custom frame transform from tracked frame: " << trName);
+      LOG_ERROR("Failed to get custom frame transform from tracked frame: " << it->GetTransformName());
       numberOfErrors++;
       continue;
     }
 
     if (this->SetTransform(*it, matrix, status == FIELD_OK) != PLUS_SUCCESS)
     {
-      LOG_ERROR("Failed to set transform to repository: " << trName);
+      LOG_ERROR("Failed to set transform to repository: " << it->GetTransformName());
       numberOfErrors++;
       continue;
     }
@@ -233,8 +233,7 @@ PlusStatus vtkPlusTransformRepository::SetTransform(const PlusTransformName& aTr
   }
   // The transform does not exist yet, add it now
 
-  TransformInfoListType transformInfoList;
-  if (FindPath(aTransformName, transformInfoList, NULL, true /*silent*/) == PLUS_SUCCESS)
+  if (GetTransformPath(aTransformName, true /*silent*/) != NULL)
   {
     // a path already exist between the two coordinate frames
     // adding a new transform between these would result in a circle
@@ -259,6 +258,9 @@ PlusStatus vtkPlusTransformRepository::SetTransform(const PlusTransformName& aTr
   toCoordFrame[aTransformName.From()].m_Transform->SetInput(fromCoordFrame[aTransformName.To()].m_Transform);
   toCoordFrame[aTransformName.From()].m_Transform->Inverse();
   toCoordFrame[aTransformName.From()].m_IsValid = isValid;
+
+  // Paths may be shorter through the new transform
+  ClearTransformPathCache();
   return PLUS_SUCCESS;
 }
 
@@ -298,21 +300,27 @@ PlusStatus vtkPlusTransformRepository::GetTransform(const PlusTransformName& aTr
   PlusLockGuard<vtkPlusRecursiveCriticalSection> accessGuard(this->CriticalSection);
 
   // Check if we can find the transform by combining the input transforms
-  // To improve performance the already found paths could be stored in a map of transform name -> transformInfoList
-  TransformInfoListType transformInfoList;
-  if (FindPath(aTransformName, transformInfoList) != PLUS_SUCCESS)
+  TransformInfoListType* transformInfoList = GetTransformPath(aTransformName);
+  if (transformInfoList == NULL)
   {
     // the transform cannot be computed, error has been already logged by FindPath
-    *isValid = false;
+    if (isValid != NULL)
+    {
+      (*isValid) = false;
+    }
     return PLUS_FAIL;
   }
 
-  // Create transform chain and compute transform status
-  vtkSmartPointer<vtkTransform> combinedTransform = vtkSmartPointer<vtkTransform>::New();
+  // Combine the transforms of the path (in the same order as vtkTransform::Concatenate would) and compute transform status
+  double combinedMatrix[16];
+  vtkMatrix4x4::Identity(combinedMatrix);
   bool combinedTransformValid(true);
-  for (TransformInfoListType::iterator transformInfo = transformInfoList.begin(); transformInfo != transformInfoList.end(); ++transformInfo)
+  for (TransformInfoListType::iterator transformInfo = transformInfoList->begin(); transformInfo != transformInfoList->end(); ++transformInfo)
   {
-    combinedTransform->Concatenate((*transformInfo)->m_Transform);
+    if (matrix != NULL)
+    {
+      vtkMatrix4x4::Multiply4x4(combinedMatrix, &((*transformInfo)->m_Transform->GetMatrix()->Element[0][0]), combinedMatrix);
+    }
     if (!(*transformInfo)->m_IsValid)
     {
       combinedTransformValid = false;
@@ -321,7 +329,7 @@ PlusStatus vtkPlusTransformRepository::GetTransform(const PlusTransformName& aTr
   // Save the results
   if (matrix != NULL)
   {
-    matrix->DeepCopy(combinedTransform->GetMatrix());
+    matrix->DeepCopy(combinedMatrix);
   }
 
   if (isValid != NULL)
@@ -544,6 +552,34 @@ PlusStatus vtkPlusTransformRepository::FindPath(const PlusTransformName& aTransf
   return PLUS_FAIL;
 }
 
+//----------------------------------------------------------------------------
+vtkPlusTransformRepository::TransformInfoListType* vtkPlusTransformRepository::GetTransformPath(const PlusTransformName& aTransformName, bool silent /*=false*/)
+{
+  CoordFrameToTransformPathMapType& fromCoordFramePaths = this->TransformPathCache[aTransformName.From()];
+  CoordFrameToTransformPathMapType::iterator fromToPathIt = fromCoordFramePaths.find(aTransformName.To());
+  if (fromToPathIt != fromCoordFramePaths.end())
+  {
+    // path has been already found
+    return &(fromToPathIt->second);
+  }
+
+  TransformInfoListType transformInfoList;
+  if (FindPath(aTransformName, transformInfoList, NULL, silent) != PLUS_SUCCESS)
+  {
+    // paths that are not found are not cached, as a missing transform is usually a configuration error
+    return NULL;
+  }
+  TransformInfoListType& cachedTransformInfoList = fromCoordFramePaths[aTransformName.To()];
+  cachedTransformInfoList.swap(transformInfoList);
+  return &cachedTransformInfoList;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTransformRepository::ClearTransformPathCache()
+{
+  this->TransformPathCache.clear();
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusTransformRepository::IsExistingTransform(PlusTransformName aTransformName, bool aSilent/* = true*/)
 {
@@ -552,8 +588,7 @@ PlusStatus vtkPlusTransformRepository::IsExistingTransform(PlusTransformName aTr
     return PLUS_SUCCESS;
   }
   PlusLockGuard<vtkPlusRecursiveCriticalSection> accessGuard(this->CriticalSection);
-  TransformInfoListType transformInfoList;
-  return FindPath(aTransformName, transformInfoList, NULL, aSilent);
+  return (GetTransformPath(aTransformName, aSilent) != NULL ? PLUS_SUCCESS : PLUS_FAIL);
 }
 
 //----------------------------------------------------------------------------
@@ -582,6 +617,8 @@ PlusStatus vtkPlusTransformRepository::DeleteTransform(const PlusTransformName&
       return PLUS_FAIL;
     }
     fromCoordFrame.erase(fromToTransformInfoIt);
+    // Cached paths may refer to the deleted transform
+    ClearTransformPathCache();
   }
   else
   {
@@ -608,7 +645,9 @@ PlusStatus vtkPlusTransformRepository::DeleteTransform(const PlusTransformName&
 //----------------------------------------------------------------------------
 void vtkPlusTransformRepository::Clear()
 {
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> accessGuard(this->CriticalSection);
   this->CoordinateFrames.clear();
+  ClearTransformPathCache();
 }
 
 //----------------------------------------------------------------------------
@@ -189,6 +189,11 @@ protected:
   /*! List of transforms */
   typedef std::list<TransformInfo*> TransformInfoListType;
 
+  /*! For each "to" coordinate frame name (first) stores the list of transforms that has to be combined to get the transform (second) */
+  typedef std::map<std::string, TransformInfoListType> CoordFrameToTransformPathMapType;
+  /*! For each "from" coordinate frame (first) stores the transform paths to other coordinate frames (second) */
+  typedef std::map<std::string, CoordFrameToTransformPathMapType> CoordFrameToCoordFrameToTransformPathMapType;
+
   /*! Get a user-defined original input transform (or its inverse). Does not combine user-defined input transforms. */
   TransformInfo* GetOriginalTransform(const PlusTransformName& aTransformName);
 
@@ -202,8 +207,26 @@ protected:
   */
   PlusStatus FindPath(const PlusTransformName& aTransformName, TransformInfoListType& transformInfoList, const char* skipCoordFrameName = NULL, bool silent = false);
 
+  /*!
+    Get the list of transforms that has to be combined to get the transform between the specified coordinate frames.
+    The path is searched (see FindPath) only if it has not been found since the last change of the transform graph.
+    \param aTransformName name of the transform to find
+    \param silent Don't log an error if path cannot be found
+    \return the transform path, NULL if no path can be found
+  */
+  TransformInfoListType* GetTransformPath(const PlusTransformName& aTransformName, bool silent = false);
+
+  /*! Remove all cached transform paths. Must be called whenever a transform is added to or removed from the repository. */
+  void ClearTransformPathCache();
+
   CoordFrameToCoordFrameToTransformMapType CoordinateFrames;
 
+  /*!
+    Transform paths that have been found since the last change of the transform graph. Updating the matrix or the
+    status of an existing transform does not change the paths, as they only refer to the stored transforms.
+  */
+  CoordFrameToCoordFrameToTransformPathMapType TransformPathCache;
+
   vtkPlusRecursiveCriticalSection* CriticalSection;
 
   TransformInfo TransformToSelf;
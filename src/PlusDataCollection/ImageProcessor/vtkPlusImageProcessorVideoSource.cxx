@@ -304,8 +304,7 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
     aSource->SetInputFrameSize( processedTrackedFrame->GetFrameSize() );
   }
 
-  PlusTrackedFrame::FieldMapType customFields=processedTrackedFrame->GetCustomFields();
-  if (aSource->AddItem(processedTrackedFrame->GetImageData(), this->FrameNumber, frameTimestamp, frameTimestamp, &customFields)!=PLUS_SUCCESS)
+  if (aSource->AddItem(processedTrackedFrame->GetImageData(), this->FrameNumber, frameTimestamp, frameTimestamp, &processedTrackedFrame->GetCustomFields())!=PLUS_SUCCESS)
   {
     status = PLUS_FAIL;
   }
@@ -117,8 +117,8 @@ PlusStatus vtkPlusOpenCVCaptureVideoSource::InternalUpdate()
     return PLUS_SUCCESS;
   }
 
-  // Capture one frame from the OpenCV capture device
-  if (!this->Capture->read(*this->Frame))
+  // Wait for the next frame from the OpenCV capture device
+  if (!this->Capture->grab())
   {
     LOG_ERROR("Unable to receive frame");
     return PLUS_FAIL;
@@ -131,6 +131,14 @@ PlusStatus vtkPlusOpenCVCaptureVideoSource::InternalUpdate()
     return PLUS_FAIL;
   }
 
+  // Decode the frame outside of the buffer lock, as decoding may take a long time. The decoded frame memory is reused
+  // if the frame size does not change. The buffer is only locked while the decoded frame is copied into it.
+  if (!this->Capture->retrieve(*this->Frame))
+  {
+    LOG_ERROR("Unable to decode frame");
+    return PLUS_FAIL;
+  }
+
   if (aSource->GetNumberOfItems() == 0)
   {
     // Init the buffer with the metadata from the first frame
@@ -11,15 +11,20 @@ See License.txt for details.
 #include "PlusVideoFrame.h"
 #include "PlusTrackedFrame.h"
 #include "vtkImageData.h"
+#include "vtkMatrix4x4.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusIgtlMessageCommon.h"
 
+#include "igtl_header.h"
+#include "igtl_util.h"
+
 vtkStandardNewMacro(vtkPlusOpenIGTLinkVideoSource);
 
 //----------------------------------------------------------------------------
 vtkPlusOpenIGTLinkVideoSource::vtkPlusOpenIGTLinkVideoSource()
+  : ReceiveIntoStagingFrame(true)
 {
   this->RequireImageOrientationInConfiguration = true;
 }
@@ -33,6 +38,7 @@ vtkPlusOpenIGTLinkVideoSource::~vtkPlusOpenIGTLinkVideoSource()
 void vtkPlusOpenIGTLinkVideoSource::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "ReceiveIntoStagingFrame: " << (this->ReceiveIntoStagingFrame ? "true" : "false") << std::endl;
 }
 
 //----------------------------------------------------------------------------
@@ -64,11 +70,22 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::InternalUpdate()
   }
 
   // We've received valid header data
+  // Keep the CRC of the message body from the header, as the body may be received in parts, directly into the buffer
+  igtl_header rawHeader;
+  memcpy(&rawHeader, headerMsg->GetBufferPointer(), IGTL_HEADER_SIZE);
+  igtl_header_convert_byte_order(&rawHeader);
   headerMsg->Unpack(this->IgtlMessageCrcCheckEnabled);
 
   // Set unfiltered and filtered timestamp by converting UTC to system timestamp
   double unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTime();
 
+  std::string messageType = headerMsg->GetMessageType();
+  if (this->ReceiveIntoStagingFrame && headerMsg->GetHeaderVersion() == IGTL_HEADER_VERSION_1
+      && (PlusCommon::IsEqualInsensitive(messageType, "IMAGE") || PlusCommon::IsEqualInsensitive(messageType, "TRACKEDFRAME")))
+  {
+    return ReceiveFrameIntoBuffer(headerMsg, rawHeader.crc, unfilteredTimestamp);
+  }
+
   PlusTrackedFrame trackedFrame;
   igtl::MessageBase::Pointer bodyMsg = this->MessageFactory->CreateReceiveMessage(headerMsg);
 
@@ -132,8 +149,194 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::InternalUpdate()
     aSource->SetImageType(videoFrame->GetImageType());
     aSource->SetInputFrameSize(trackedFrame.GetFrameSize());
   }
-  PlusTrackedFrame::FieldMapType customFields = trackedFrame.GetCustomFields();
-  PlusStatus status = aSource->AddItem(trackedFrame.GetImageData(), this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &customFields);
+  PlusStatus status = aSource->AddItem(trackedFrame.GetImageData(), this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &trackedFrame.GetCustomFields());
+  this->Modified();
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkVideoSource::ReceiveFrameIntoBuffer(igtl::MessageHeader::Pointer headerMsg, igtl_uint64 bodyCrc, double unfilteredTimestamp)
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> socketGuard(this->SocketMutex);
+  igtl_uint64 bodySize = headerMsg->GetBodySizeToRead();
+
+  vtkPlusDataSource* aSource = NULL;
+  if (this->GetFirstActiveOutputVideoSource(aSource) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to retrieve the video source in the OpenIGTLinkVideo device.");
+    this->ClientSocket->Skip(bodySize, 0);
+    return PLUS_FAIL;
+  }
+
+  igtl_uint64 crc = crc64(0, 0, 0LL);
+  igtl_uint64* crcPtr = (this->IgtlMessageCrcCheckEnabled ? &crc : NULL);
+
+  // Get the frame format, custom fields and transforms from the part of the message body that precedes the pixel data
+  PlusTrackedFrame trackedFrame;
+  unsigned int frameSize[3] = { 0, 0, 0 };
+  PlusCommon::VTKScalarPixelType pixelType = VTK_VOID;
+  unsigned int numberOfScalarComponents = 0;
+  US_IMAGE_TYPE imageType = US_IMG_BRIGHTNESS;
+  igtl_uint64 pixelDataOffset = 0;
+  igtl_uint64 pixelDataSize = 0;
+  if (PlusCommon::IsEqualInsensitive(headerMsg->GetMessageType(), "IMAGE"))
+  {
+    igtl_image_header imageHeader;
+    if (bodySize < IGTL_IMAGE_HEADER_SIZE)
+    {
+      LOG_ERROR("Invalid IMAGE message received from OpenIGTLink server: body size (" << bodySize << " bytes) is smaller than the image header size");
+      this->ClientSocket->Skip(bodySize, 0);
+      return PLUS_FAIL;
+    }
+    if (vtkPlusIgtlMessageCommon::ReceiveImageMessageHeader(this->ClientSocket, imageHeader, crcPtr) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't get image from OpenIGTLink server!");
+      return PLUS_FAIL;
+    }
+    pixelDataOffset = IGTL_IMAGE_HEADER_SIZE;
+    for (int i = 0; i < 3; ++i)
+    {
+      frameSize[i] = imageHeader.size[i];
+      if (imageHeader.subvol_size[i] != imageHeader.size[i] || imageHeader.subvol_offset[i] != 0)
+      {
+        LOG_ERROR("Couldn't get image from OpenIGTLink server - sub-volume images are not supported");
+        this->ClientSocket->Skip(bodySize - pixelDataOffset, 0);
+        return PLUS_FAIL;
+      }
+    }
+    pixelType = PlusVideoFrame::GetVTKScalarPixelTypeFromIGTL(imageHeader.scalar_type);
+    numberOfScalarComponents = imageHeader.num_components;
+    // Set the image type to support color images
+    if (imageHeader.scalar_type == igtl::ImageMessage::TYPE_INT8)
+    {
+      imageType = (imageHeader.num_components == igtl::ImageMessage::DTYPE_VECTOR) ? US_IMG_RGB_COLOR : US_IMG_BRIGHTNESS;
+    }
+    if (pixelType != VTK_VOID)
+    {
+      pixelDataSize = static_cast<igtl_uint64>(frameSize[0]) * frameSize[1] * frameSize[2] * numberOfScalarComponents * PlusVideoFrame::GetNumberOfBytesPerScalar(pixelType);
+    }
+    if (this->ImageMessageEmbeddedTransformName.IsValid())
+    {
+      vtkSmartPointer<vtkMatrix4x4> vtkMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      if (vtkPlusIgtlMessageCommon::GetImageTransformFromImageHeader(imageHeader, vtkMatrix) != PLUS_SUCCESS)
+      {
+        this->ClientSocket->Skip(bodySize - pixelDataOffset, 0);
+        return PLUS_FAIL;
+      }
+      trackedFrame.SetCustomFrameTransform(this->ImageMessageEmbeddedTransformName, vtkMatrix);
+    }
+  }
+  else
+  {
+    igtl::PlusTrackedFrameMessage::TrackedFrameHeader trackedFrameHeader;
+    if (vtkPlusIgtlMessageCommon::ReceiveTrackedFrameMessageHeader(this->ClientSocket, bodySize, trackedFrameHeader, trackedFrame, crcPtr) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't get tracked frame from OpenIGTLink server!");
+      return PLUS_FAIL;
+    }
+    pixelDataOffset = trackedFrameHeader.GetMessageHeaderSize() + trackedFrameHeader.m_XmlDataSizeInBytes;
+    for (int i = 0; i < 3; ++i)
+    {
+      frameSize[i] = trackedFrameHeader.m_FrameSize[i];
+    }
+    pixelType = PlusVideoFrame::GetVTKScalarPixelTypeFromIGTL(trackedFrameHeader.m_ScalarType);
+    numberOfScalarComponents = trackedFrameHeader.m_NumberOfComponents;
+    imageType = static_cast<US_IMAGE_TYPE>(trackedFrameHeader.m_ImageType);
+    pixelDataSize = trackedFrameHeader.m_ImageDataSizeInBytes;
+    if (this->ImageMessageEmbeddedTransformName.IsValid())
+    {
+      // Save the transform that is embedded in the TRACKEDFRAME message into the tracked frame
+      vtkSmartPointer<vtkMatrix4x4> vtkMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      for (int i = 0; i < 4; ++i)
+      {
+        for (int j = 0; j < 4; ++j)
+        {
+          vtkMatrix->SetElement(i, j, trackedFrameHeader.m_EmbeddedImageTransform[i][j]);
+        }
+      }
+      trackedFrame.SetCustomFrameTransform(this->ImageMessageEmbeddedTransformName, vtkMatrix);
+    }
+    if (this->UseReceivedTimestamps)
+    {
+      // Use the timestamp in the OpenIGTLink message
+      // The received timestamp is in UTC and timestamps in the buffer are in system time, so conversion is needed
+      igtl::TimeStamp::Pointer igtlTimestamp = igtl::TimeStamp::New();
+      headerMsg->GetTimeStamp(igtlTimestamp);
+      unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTimeFromUniversalTime(igtlTimestamp->GetTimeStamp());
+    }
+  }
+
+  if (pixelType == VTK_VOID || pixelDataOffset + pixelDataSize > bodySize)
+  {
+    LOG_ERROR("Invalid " << headerMsg->GetMessageType() << " message received from OpenIGTLink server (unsupported pixel type or invalid body size)");
+    if (pixelDataOffset < bodySize)
+    {
+      this->ClientSocket->Skip(bodySize - pixelDataOffset, 0);
+    }
+    return PLUS_FAIL;
+  }
+
+  // The timestamps are already defined, so we don't need to filter them,
+  // for simplicity, we increase frame number always by 1.
+  this->FrameNumber++;
+
+  // If the buffer is empty, set the pixel type and frame size to the first received properties
+  if (aSource->GetNumberOfItems() == 0)
+  {
+    aSource->SetPixelType(pixelType);
+    aSource->SetNumberOfScalarComponents(numberOfScalarComponents);
+    aSource->SetImageType(imageType);
+    aSource->SetInputFrameSize(frameSize);
+  }
+
+  igtl_uint64 expectedPixelDataSize = static_cast<igtl_uint64>(frameSize[0]) * frameSize[1] * frameSize[2] * numberOfScalarComponents * PlusVideoFrame::GetNumberOfBytesPerScalar(pixelType);
+  if (expectedPixelDataSize != pixelDataSize)
+  {
+    LOG_ERROR("Invalid " << headerMsg->GetMessageType() << " message received from OpenIGTLink server: image data size is " << pixelDataSize
+              << " bytes, expected " << expectedPixelDataSize << " bytes");
+    this->ClientSocket->Skip(bodySize - pixelDataOffset, 0);
+    return PLUS_FAIL;
+  }
+
+  // Receive the pixel data into the staging frame. The video buffer is not locked while waiting for the socket,
+  // so readers of the buffer are not blocked. The staging frame memory is reused if the frame format does not change.
+  if (this->ReceiveStagingFrame.AllocateFrame(frameSize, pixelType, numberOfScalarComponents) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate frame for receiving " << headerMsg->GetMessageType() << " message from OpenIGTLink server");
+    this->ClientSocket->Skip(bodySize - pixelDataOffset, 0);
+    return PLUS_FAIL;
+  }
+  PlusStatus status = vtkPlusIgtlMessageCommon::ReceiveMessageBodyPart(this->ClientSocket, this->ReceiveStagingFrame.GetScalarPointer(), pixelDataSize, crcPtr);
+
+  // The rest of the message body is only needed for the CRC check
+  igtl_uint64 remainingSize = bodySize - pixelDataOffset - pixelDataSize;
+  if (status == PLUS_SUCCESS && remainingSize > 0)
+  {
+    if (crcPtr != NULL)
+    {
+      std::vector<unsigned char> remainingData(remainingSize);
+      status = vtkPlusIgtlMessageCommon::ReceiveMessageBodyPart(this->ClientSocket, &remainingData[0], remainingSize, crcPtr);
+    }
+    else
+    {
+      this->ClientSocket->Skip(remainingSize, 0);
+    }
+  }
+  if (status == PLUS_SUCCESS && crcPtr != NULL && crc != bodyCrc)
+  {
+    LOG_ERROR("CRC check failed for " << headerMsg->GetMessageType() << " message received from OpenIGTLink server");
+    status = PLUS_FAIL;
+  }
+  if (status != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  // The buffer is only locked while the received frame is copied into it
+  // No need to filter already filtered timestamped items received over OpenIGTLink
+  status = aSource->AddItem(this->ReceiveStagingFrame.GetScalarPointer(), US_IMG_ORIENT_MF, frameSize, pixelType, numberOfScalarComponents, imageType, 0,
+                            this->FrameNumber, unfilteredTimestamp, unfilteredTimestamp, &trackedFrame.GetCustomFields());
   this->Modified();
 
   return status;
@@ -144,6 +347,10 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::ReadConfiguration(vtkXMLDataElement* r
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
   XML_READ_STRING_ATTRIBUTE_OPTIONAL(ImageMessageEmbeddedTransformName, deviceConfig);
+  // ReceiveDirectlyIntoBuffer is the deprecated name of ReceiveIntoStagingFrame
+  XML_READ_WARNING_DEPRECATED_CSTRING_REPLACED(ReceiveDirectlyIntoBuffer, deviceConfig, ReceiveIntoStagingFrame);
+  XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(ReceiveDirectlyIntoBuffer, this->ReceiveIntoStagingFrame, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ReceiveIntoStagingFrame, deviceConfig);
   return PLUS_SUCCESS;
 }
 
@@ -152,6 +359,8 @@ PlusStatus vtkPlusOpenIGTLinkVideoSource::WriteConfiguration(vtkXMLDataElement*
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceConfig, rootConfigElement);
   deviceConfig->SetAttribute("ImageMessageEmbeddedTransformName", this->ImageMessageEmbeddedTransformName.GetTransformName().c_str());
+  deviceConfig->SetAttribute("ReceiveIntoStagingFrame", this->ReceiveIntoStagingFrame ? "true" : "false");
+  deviceConfig->RemoveAttribute("ReceiveDirectlyIntoBuffer");
   return PLUS_SUCCESS;
 }
 
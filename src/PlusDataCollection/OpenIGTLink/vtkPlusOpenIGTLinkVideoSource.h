@@ -8,16 +8,25 @@
 #define __vtkPlusOpenIGTLinkVideoSource_h
 
 #include "PlusConfigure.h"
+#include "PlusVideoFrame.h"
 #include "vtkPlusDataCollectionExport.h"
 #include "vtkPlusOpenIGTLinkDevice.h"
 #include "vtkPlusIgtlMessageFactory.h"
 
+#include "igtl_types.h"
+
 /*!
   \class vtkPlusOpenIGTLinkVideoSource
   \brief VTK interface for video input from OpenIGTLink image message
 
   vtkPlusOpenIGTLinkVideoSource is a class for providing video input interfaces between VTK and OpenIGTLink ready video device.
 
+  The pixel data of IMAGE and TRACKEDFRAME messages is received from the socket directly into a reusable frame and then
+  copied into the video buffer, without unpacking the message into a temporary tracked frame first. The video buffer is
+  only locked while the frame is copied, not while the data is received.
+  This can be disabled by setting ReceiveIntoStagingFrame="FALSE" in the device configuration
+  (ReceiveDirectlyIntoBuffer is a deprecated name of the same attribute).
+
   \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusOpenIGTLinkVideoSource : public vtkPlusOpenIGTLinkDevice
@@ -44,13 +53,31 @@ public:
   /*! Verify the device is correctly configured */
   virtual PlusStatus NotifyConfigured();
 
+  /*! Enable receiving the pixel data of image messages into a reusable frame without unpacking the message first */
+  vtkSetMacro(ReceiveIntoStagingFrame, bool);
+  vtkGetMacro(ReceiveIntoStagingFrame, bool);
+  vtkBooleanMacro(ReceiveIntoStagingFrame, bool);
+
 protected:
   vtkPlusOpenIGTLinkVideoSource();
   virtual ~vtkPlusOpenIGTLinkVideoSource();
 
+  /*!
+    Receive the body of an IMAGE or TRACKEDFRAME message (header version 1) and add the frame to the video buffer.
+    The pixel data is received directly into ReceiveStagingFrame. If CRC check is enabled then the CRC is computed
+    while the body is received and the frame is only added to the buffer if it matches bodyCrc (the CRC in the message header).
+  */
+  PlusStatus ReceiveFrameIntoBuffer(igtl::MessageHeader::Pointer headerMsg, igtl_uint64 bodyCrc, double unfilteredTimestamp);
+
   /*! igtl Factory for message handling */
   vtkSmartPointer<vtkPlusIgtlMessageFactory> IgtlMessageFactory;
 
+  /*! Receive the pixel data of image messages into ReceiveStagingFrame, which is then copied into the video buffer */
+  bool ReceiveIntoStagingFrame;
+
+  /*! Frame that the pixel data is received into before it is added to the video buffer */
+  PlusVideoFrame ReceiveStagingFrame;
+
 private:
   vtkPlusOpenIGTLinkVideoSource(const vtkPlusOpenIGTLinkVideoSource&);   // Not implemented.
   void operator=(const vtkPlusOpenIGTLinkVideoSource&);   // Not implemented.
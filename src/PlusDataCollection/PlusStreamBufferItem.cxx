@@ -17,9 +17,9 @@ StreamBufferItem::StreamBufferItem()
   , Index( 0 )
   , Uid( 0 )
   , ValidTransformData( false )
-  , Matrix( vtkSmartPointer<vtkMatrix4x4>::New() )
   , Status( TOOL_OK )
 {
+  vtkMatrix4x4::Identity( this->Matrix );
 }
 
 //----------------------------------------------------------------------------
@@ -30,8 +30,6 @@ StreamBufferItem::~StreamBufferItem()
 //----------------------------------------------------------------------------
 StreamBufferItem::StreamBufferItem( const StreamBufferItem& dataItem )
 {
-  this->Matrix = vtkSmartPointer<vtkMatrix4x4>::New();
-  this->Status = TOOL_OK;
   *this = dataItem;
 }
 
@@ -51,7 +49,7 @@ StreamBufferItem& StreamBufferItem::operator=( StreamBufferItem const& dataItem
   this->Uid = dataItem.Uid;
   this->CustomFrameFields = dataItem.CustomFrameFields;
   this->Status = dataItem.Status;
-  this->Matrix->DeepCopy( dataItem.Matrix );
+  std::copy( dataItem.Matrix, dataItem.Matrix + 16, this->Matrix );
   this->ValidTransformData = dataItem.ValidTransformData;
 
   return *this;
@@ -60,7 +58,7 @@ StreamBufferItem& StreamBufferItem::operator=( StreamBufferItem const& dataItem
 //----------------------------------------------------------------------------
 void StreamBufferItem::SetCustomFrameField( std::string fieldName, std::string fieldValue )
 {
-  this->CustomFrameFields[fieldName] = fieldValue;
+  this->CustomFrameFields.SetField( PlusFieldNameTable::GetFieldId( fieldName ), fieldValue );
 }
 
 //----------------------------------------------------------------------------
@@ -77,6 +75,31 @@ PlusStatus StreamBufferItem::DeepCopy( StreamBufferItem* dataItem )
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::ShallowCopy( StreamBufferItem* dataItem )
+{
+  if ( dataItem == NULL )
+  {
+    LOG_ERROR( "Failed to shallow copy data buffer item - buffer item NULL!" );
+    return PLUS_FAIL;
+  }
+  if ( this == dataItem )
+  {
+    return PLUS_SUCCESS;
+  }
+
+  this->FilteredTimeStamp = dataItem->FilteredTimeStamp;
+  this->UnfilteredTimeStamp = dataItem->UnfilteredTimeStamp;
+  this->Index = dataItem->Index;
+  this->Uid = dataItem->Uid;
+  this->CustomFrameFields = dataItem->CustomFrameFields;
+  this->Status = dataItem->Status;
+  std::copy( dataItem->Matrix, dataItem->Matrix + 16, this->Matrix );
+  this->ValidTransformData = dataItem->ValidTransformData;
+
+  return this->Frame.ShallowCopy( &dataItem->Frame );
+}
+
 //----------------------------------------------------------------------------
 PlusStatus StreamBufferItem::SetMatrix( vtkMatrix4x4* matrix )
 {
@@ -86,13 +109,19 @@ PlusStatus StreamBufferItem::SetMatrix( vtkMatrix4x4* matrix )
     return PLUS_FAIL;
   }
 
-  ValidTransformData = true;
-
-  this->Matrix->DeepCopy( matrix );
+  this->SetMatrix( &matrix->Element[0][0] );
 
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void StreamBufferItem::SetMatrix( const double matrix[16] )
+{
+  ValidTransformData = true;
+
+  std::copy( matrix, matrix + 16, this->Matrix );
+}
+
 //----------------------------------------------------------------------------
 PlusStatus StreamBufferItem::GetMatrix( vtkMatrix4x4* outputMatrix )
 {
@@ -107,6 +136,12 @@ PlusStatus StreamBufferItem::GetMatrix( vtkMatrix4x4* outputMatrix )
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void StreamBufferItem::GetMatrix( double outputMatrix[16] ) const
+{
+  std::copy( this->Matrix, this->Matrix + 16, outputMatrix );
+}
+
 //----------------------------------------------------------------------------
 void StreamBufferItem::SetStatus( ToolStatus status )
 {
@@ -10,6 +10,7 @@ See License.txt for details.
 #include "vtkPlusDataCollectionExport.h"
 
 #include "PlusCommon.h"
+#include "PlusFrameFieldStore.h"
 #include "PlusVideoFrame.h"
 
 #include "vtkSmartPointer.h"
@@ -89,7 +90,7 @@ public:
   /*! Set custom frame field */
   void SetCustomFrameField( std::string fieldName, std::string fieldValue );
 
-  /*! Get custom frame field value */
+  /*! Get custom frame field value. The returned pointer is valid until the custom fields are modified. */
   const char* GetCustomFrameField( const char* fieldName )
   {
     if ( fieldName == NULL )
@@ -98,16 +99,10 @@ public:
       return NULL;
     }
 
-    FieldMapType::iterator fieldIterator;
-    fieldIterator = this->CustomFrameFields.find( fieldName );
-    if ( fieldIterator != this->CustomFrameFields.end() )
-    {
-      return fieldIterator->second.c_str();
-    }
-    return NULL;
+    return this->CustomFrameFields.GetField( PlusFieldNameTable::FindFieldId( fieldName ) );
   }
-  /*! Get custom frame field map */
-  FieldMapType& GetCustomFrameFieldMap()
+  /*! Get custom frame fields */
+  PlusFrameFieldStore& GetCustomFrameFields()
   {
     return this->CustomFrameFields;
   }
@@ -120,10 +115,8 @@ public:
       return PLUS_FAIL;
     }
 
-    FieldMapType::iterator field = this->CustomFrameFields.find( fieldName );
-    if ( field != this->CustomFrameFields.end() )
+    if ( this->CustomFrameFields.DeleteField( PlusFieldNameTable::FindFieldId( fieldName ) ) )
     {
-      this->CustomFrameFields.erase( field );
       return PLUS_SUCCESS;
     }
     LOG_DEBUG( "Failed to delete custom frame field - could find field " << fieldName );
@@ -133,12 +126,19 @@ public:
   /*! Copy stream buffer item */
   PlusStatus DeepCopy( StreamBufferItem* dataItem );
 
+  /*! Copy stream buffer item, the pixel data is referenced instead of copied (see PlusVideoFrame::ShallowCopy) */
+  PlusStatus ShallowCopy( StreamBufferItem* dataItem );
+
   PlusVideoFrame& GetFrame() { return this->Frame; };
 
   /*! Set tracker matrix */
   PlusStatus SetMatrix( vtkMatrix4x4* matrix );
+  /*! Set tracker matrix (16 elements, row-major order) */
+  void SetMatrix( const double matrix[16] );
   /*! Get tracker matrix */
   PlusStatus GetMatrix( vtkMatrix4x4* outputMatrix );
+  /*! Get tracker matrix (16 elements, row-major order) */
+  void GetMatrix( double outputMatrix[16] ) const;
 
   /*! Set tracker item status */
   void SetStatus( ToolStatus status );
@@ -164,11 +164,13 @@ protected:
   BufferItemUidType Uid;
 
   /*! Custom frame fields */
-  FieldMapType CustomFrameFields;
+  /*! Custom fields, indexed by interned field name identifiers so that copying them is cheap */
+  PlusFrameFieldStore CustomFrameFields;
 
   bool ValidTransformData;
   PlusVideoFrame Frame;
-  vtkSmartPointer<vtkMatrix4x4> Matrix;
+  /*! Tracker matrix, row-major order. Stored as a plain array so that copying an item does not allocate memory. */
+  double Matrix[16];
   ToolStatus Status;
 };
 
@@ -7,6 +7,7 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "vtkImageData.h"
 #include "vtkMatrix4x4.h"
+#include "vtkPlusMetaImageSequenceIO.h"
 #include "vtkPlusSequenceIO.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusBuffer.h"
@@ -26,8 +27,10 @@ vtkPlusSavedDataSource::vtkPlusSavedDataSource()
   , LoopStartTime_Local(0.0)
   , LoopStopTime_Local(0.0)
   , LocalVideoBuffer(NULL)
+  , OnDemandSequenceReader(NULL)
   , UseAllFrameFields(false)
   , UseOriginalTimestamps(false)
+  , UseSequenceIndexFile(false)
   , LastAddedFrameUid(0)
   , LastAddedLoopIndex(0)
   , SimulatedStream(VIDEO_STREAM)
@@ -45,6 +48,11 @@ vtkPlusSavedDataSource::~vtkPlusSavedDataSource()
     this->Disconnect();
   }
   DeleteLocalBuffers();
+  if (this->OnDemandSequenceReader != NULL)
+  {
+    this->OnDemandSequenceReader->Delete();
+    this->OnDemandSequenceReader = NULL;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -155,8 +163,9 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdateOriginalTimestamp(BufferItemUid
     // TODO: use the UID difference as increment
     this->FrameNumber++;
 
+    // The frame pixels are copied directly from the local buffer into the output buffers, so retrieve only the metadata here
     StreamBufferItem dataBufferItemToBeAdded;
-    if (GetLocalBuffer()->GetStreamBufferItem(frameToBeAddedUid, &dataBufferItemToBeAdded) != ITEM_OK)
+    if (GetLocalBuffer()->GetStreamBufferItemMetadata(frameToBeAddedUid, &dataBufferItemToBeAdded) != ITEM_OK)
     {
       LOG_ERROR("vtkPlusSavedDataSource: Failed to retrieve item from the buffer, UID=" << frameToBeAddedUid);
       status = PLUS_FAIL;
@@ -176,9 +185,9 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdateOriginalTimestamp(BufferItemUid
         StreamBufferItem::FieldMapType fieldMap;
         if (this->UseAllFrameFields)
         {
-          fieldMap = dataBufferItemToBeAdded.GetCustomFrameFieldMap();
+          dataBufferItemToBeAdded.GetCustomFrameFields().GetFieldMap(fieldMap);
         }
-        if (this->AddVideoItemToVideoSources(this->GetVideoSources(), dataBufferItemToBeAdded.GetFrame(), this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &fieldMap) != PLUS_SUCCESS)
+        if (this->AddVideoItemFromLocalBuffer(frameToBeAddedUid, this->FrameNumber, unfilteredTimestamp, filteredTimestamp, &fieldMap) != PLUS_SUCCESS)
         {
           status = PLUS_FAIL;
         }
@@ -263,7 +272,7 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdateCurrentTimestamp(BufferItemUidT
 
   this->FrameNumber++;
   StreamBufferItem dataBufferItemToBeAdded;
-  if (GetLocalBuffer()->GetStreamBufferItem(frameToBeAddedUid, &dataBufferItemToBeAdded) != ITEM_OK)
+  if (GetLocalBuffer()->GetStreamBufferItemMetadata(frameToBeAddedUid, &dataBufferItemToBeAdded) != ITEM_OK)
   {
     LOG_ERROR("vtkPlusSavedDataSource: Failed to retrieve item from the buffer, UID=" << frameToBeAddedUid);
     return PLUS_FAIL;
@@ -277,9 +286,9 @@ PlusStatus vtkPlusSavedDataSource::InternalUpdateCurrentTimestamp(BufferItemUidT
       StreamBufferItem::FieldMapType fieldMap;
       if (this->UseAllFrameFields)
       {
-        fieldMap = dataBufferItemToBeAdded.GetCustomFrameFieldMap();
+        dataBufferItemToBeAdded.GetCustomFrameFields().GetFieldMap(fieldMap);
       }
-      if (this->AddVideoItemToVideoSources(this->GetVideoSources(), dataBufferItemToBeAdded.GetFrame(), this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &fieldMap) != PLUS_SUCCESS)
+      if (this->AddVideoItemFromLocalBuffer(frameToBeAddedUid, this->FrameNumber, UNDEFINED_TIMESTAMP, UNDEFINED_TIMESTAMP, &fieldMap) != PLUS_SUCCESS)
       {
         // UNDEFINED_TIMESTAMP => use current timestamp
         status = PLUS_FAIL;
@@ -382,7 +391,11 @@ PlusStatus vtkPlusSavedDataSource::InternalConnect()
   vtkSmartPointer<vtkPlusTrackedFrameList> savedDataBuffer = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
 
   // Read sequence file into tracked frame list
-  vtkPlusSequenceIO::Read(foundAbsoluteImagePath, savedDataBuffer);
+  if (this->ReadSequenceFile(foundAbsoluteImagePath, savedDataBuffer) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to connect to saved dataset - unable to read sequence file: " << foundAbsoluteImagePath);
+    return PLUS_FAIL;
+  }
 
   if (savedDataBuffer->GetNumberOfTrackedFrames() < 1)
   {
@@ -472,18 +485,25 @@ PlusStatus vtkPlusSavedDataSource::InternalConnectVideo(vtkPlusTrackedFrameList*
   }
 
   // Saved data buffer contains data read directly from file, set up a new local buffer
-  DeleteLocalBuffers();
-  this->LocalVideoBuffer = vtkPlusBuffer::New();
-  this->LocalVideoBuffer->SetImageOrientation(savedDataBuffer->GetImageOrientation());
-  this->LocalVideoBuffer->SetImageType(savedDataBuffer->GetImageType());
-  this->LocalVideoBuffer->SetFrameSize(savedDataBuffer->GetFrameSize());
-  this->LocalVideoBuffer->SetNumberOfScalarComponents(savedDataBuffer->GetTrackedFrame(0)->GetNumberOfScalarComponents());
-  this->LocalVideoBuffer->SetPixelType(savedDataBuffer->GetTrackedFrame(0)->GetImageData()->GetVTKScalarPixelType());
-  this->LocalVideoBuffer->SetBufferSize(savedDataBuffer->GetNumberOfTrackedFrames());
-  this->LocalVideoBuffer->SetLocalTimeOffsetSec(0.0);   // the time offset is copied from the output, so reset it to 0
-  this->LocalVideoBuffer->CopyImagesFromTrackedFrameList(savedDataBuffer, vtkPlusBuffer::READ_FILTERED_IGNORE_UNFILTERED_TIMESTAMPS, this->UseAllFrameFields);
+  this->CreateLocalVideoBuffer(savedDataBuffer);
+  if (this->OnDemandSequenceReader != NULL
+      && this->LocalVideoBuffer->GetNumberOfItems() != static_cast<int>(savedDataBuffer->GetNumberOfTrackedFrames()))
+  {
+    // Buffer items would not map one-to-one to frames in the file, so decoding on demand is not possible
+    LOG_WARNING("Not all frames of the sequence file could be added to the local video buffer, all frames are loaded into memory now");
+    if (this->DecodeAllFrames(savedDataBuffer) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    this->CreateLocalVideoBuffer(savedDataBuffer);
+  }
   savedDataBuffer->Clear();
 
+  unsigned int frameSize[3] = {0, 0, 0};
+  PlusCommon::VTKScalarPixelType pixelType = VTK_VOID;
+  unsigned int numberOfScalarComponents = 0;
+  this->GetVideoFrameFormat(frameSize, pixelType, numberOfScalarComponents);
+
   PlusStatus result(PLUS_SUCCESS);
   for (DataSourceContainerIterator it = this->VideoSources.begin(); it != this->VideoSources.end(); ++it)
   {
@@ -496,14 +516,14 @@ PlusStatus vtkPlusSavedDataSource::InternalConnectVideo(vtkPlusTrackedFrameList*
       continue;
     }
 
-    if (source->SetInputFrameSize(this->LocalVideoBuffer->GetFrameSize()) != PLUS_SUCCESS)
+    if (source->SetInputFrameSize(frameSize) != PLUS_SUCCESS)
     {
       LOG_ERROR(source->GetId() << ": Failed to set video image orientation");
       result = PLUS_FAIL;
       continue;
     }
 
-    if (source->SetNumberOfScalarComponents(this->LocalVideoBuffer->GetNumberOfScalarComponents()) != PLUS_SUCCESS)
+    if (source->SetNumberOfScalarComponents(numberOfScalarComponents) != PLUS_SUCCESS)
     {
       LOG_ERROR(source->GetId() << ": Failed to set video image orientation");
       result = PLUS_FAIL;
@@ -512,14 +532,14 @@ PlusStatus vtkPlusSavedDataSource::InternalConnectVideo(vtkPlusTrackedFrameList*
 
     source->Clear();
 
-    if (source->SetInputFrameSize(this->LocalVideoBuffer->GetFrameSize()) != PLUS_SUCCESS)
+    if (source->SetInputFrameSize(frameSize) != PLUS_SUCCESS)
     {
       LOG_ERROR(source->GetId() << ": Failed to set video image orientation");
       result = PLUS_FAIL;
       continue;
     }
 
-    if (source->SetPixelType(this->LocalVideoBuffer->GetPixelType()) != PLUS_SUCCESS)
+    if (source->SetPixelType(pixelType) != PLUS_SUCCESS)
     {
       LOG_ERROR(source->GetId() << ": Failed to set video image orientation");
       result = PLUS_FAIL;
@@ -530,6 +550,127 @@ PlusStatus vtkPlusSavedDataSource::InternalConnectVideo(vtkPlusTrackedFrameList*
   return result;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::ReadSequenceFile(const std::string& filePath, vtkPlusTrackedFrameList* savedDataBuffer)
+{
+  if (this->OnDemandSequenceReader != NULL)
+  {
+    this->OnDemandSequenceReader->Delete();
+    this->OnDemandSequenceReader = NULL;
+  }
+
+  if (this->SimulatedStream != VIDEO_STREAM || !vtkPlusMetaImageSequenceIO::CanReadFile(filePath))
+  {
+    return vtkPlusSequenceIO::Read(filePath, savedDataBuffer);
+  }
+
+  // Only read the frame fields now, the pixel data is decoded from the file when a frame is replayed
+  this->OnDemandSequenceReader = vtkPlusMetaImageSequenceIO::New();
+  this->OnDemandSequenceReader->SetLoadImageDataOnDemand(true);
+  this->OnDemandSequenceReader->SetUseHeaderIndexFile(this->UseSequenceIndexFile);
+  this->OnDemandSequenceReader->SetFileName(filePath);
+  this->OnDemandSequenceReader->SetTrackedFrameList(savedDataBuffer);
+  if (this->OnDemandSequenceReader->Read() != PLUS_SUCCESS)
+  {
+    this->OnDemandSequenceReader->Delete();
+    this->OnDemandSequenceReader = NULL;
+    return PLUS_FAIL;
+  }
+
+  if (!this->OnDemandSequenceReader->IsFrameRandomAccessSupported())
+  {
+    // Compressed file without frame index: jumping back to the first frame when looping would require
+    // decompressing the file from the beginning, so decode all frames now (sequentially, in one pass)
+    LOG_DEBUG("Frames of " << filePath << " cannot be decoded individually, all frames are loaded into memory");
+    return this->DecodeAllFrames(savedDataBuffer);
+  }
+
+  // The local buffer only stores the frame fields and timestamps, so allocate a minimal placeholder image for each frame
+  unsigned int placeholderFrameSize[3] = {1, 1, 1};
+  for (unsigned int frameNumber = 0; frameNumber < savedDataBuffer->GetNumberOfTrackedFrames(); ++frameNumber)
+  {
+    if (!this->OnDemandSequenceReader->IsFrameImageValid(frameNumber))
+    {
+      // frames without valid image data are not added to the local buffer (same as when all frames are loaded)
+      continue;
+    }
+    PlusVideoFrame* image = savedDataBuffer->GetTrackedFrame(frameNumber)->GetImageData();
+    if (image->AllocateFrame(placeholderFrameSize, this->OnDemandSequenceReader->GetPixelType(), static_cast<unsigned int>(this->OnDemandSequenceReader->GetNumberOfScalarComponents())) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate placeholder image for frame " << frameNumber);
+      return PLUS_FAIL;
+    }
+    image->SetImageOrientation(this->OnDemandSequenceReader->GetImageOrientationInMemory());
+    image->SetImageType(this->OnDemandSequenceReader->GetImageType());
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::DecodeAllFrames(vtkPlusTrackedFrameList* savedDataBuffer)
+{
+  if (this->OnDemandSequenceReader == NULL)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  for (unsigned int frameNumber = 0; frameNumber < savedDataBuffer->GetNumberOfTrackedFrames(); ++frameNumber)
+  {
+    if (!this->OnDemandSequenceReader->IsFrameImageValid(frameNumber))
+    {
+      continue;
+    }
+    if (this->OnDemandSequenceReader->ReadFrameImageData(frameNumber, *savedDataBuffer->GetTrackedFrame(frameNumber)->GetImageData()) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to decode frame " << frameNumber << " of " << this->OnDemandSequenceReader->GetFileName());
+      status = PLUS_FAIL;
+      break;
+    }
+  }
+
+  this->OnDemandSequenceReader->Delete();
+  this->OnDemandSequenceReader = NULL;
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSavedDataSource::CreateLocalVideoBuffer(vtkPlusTrackedFrameList* savedDataBuffer)
+{
+  DeleteLocalBuffers();
+  this->LocalVideoBuffer = vtkPlusBuffer::New();
+  this->LocalVideoBuffer->SetImageOrientation(savedDataBuffer->GetImageOrientation());
+  this->LocalVideoBuffer->SetImageType(savedDataBuffer->GetImageType());
+  this->LocalVideoBuffer->SetFrameSize(savedDataBuffer->GetFrameSize());
+  this->LocalVideoBuffer->SetNumberOfScalarComponents(savedDataBuffer->GetTrackedFrame(0)->GetNumberOfScalarComponents());
+  this->LocalVideoBuffer->SetPixelType(savedDataBuffer->GetTrackedFrame(0)->GetImageData()->GetVTKScalarPixelType());
+  this->LocalVideoBuffer->SetBufferSize(savedDataBuffer->GetNumberOfTrackedFrames());
+  this->LocalVideoBuffer->SetLocalTimeOffsetSec(0.0);   // the time offset is copied from the output, so reset it to 0
+  this->LocalVideoBuffer->CopyImagesFromTrackedFrameList(savedDataBuffer, vtkPlusBuffer::READ_FILTERED_IGNORE_UNFILTERED_TIMESTAMPS, this->UseAllFrameFields);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSavedDataSource::GetVideoFrameFormat(unsigned int frameSize[3], PlusCommon::VTKScalarPixelType& pixelType, unsigned int& numberOfScalarComponents)
+{
+  if (this->OnDemandSequenceReader != NULL)
+  {
+    const unsigned int* dimensions = this->OnDemandSequenceReader->GetDimensions();
+    frameSize[0] = dimensions[0];
+    frameSize[1] = dimensions[1];
+    frameSize[2] = dimensions[2];
+    pixelType = this->OnDemandSequenceReader->GetPixelType();
+    numberOfScalarComponents = static_cast<unsigned int>(this->OnDemandSequenceReader->GetNumberOfScalarComponents());
+    return;
+  }
+  const unsigned int* bufferFrameSize = this->LocalVideoBuffer->GetFrameSize();
+  frameSize[0] = bufferFrameSize[0];
+  frameSize[1] = bufferFrameSize[1];
+  frameSize[2] = bufferFrameSize[2];
+  pixelType = this->LocalVideoBuffer->GetPixelType();
+  numberOfScalarComponents = static_cast<unsigned int>(this->LocalVideoBuffer->GetNumberOfScalarComponents());
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusSavedDataSource::InternalConnectTracker(vtkPlusTrackedFrameList* savedDataBuffer)
 {
@@ -596,6 +737,11 @@ PlusStatus vtkPlusSavedDataSource::InternalConnectTracker(vtkPlusTrackedFrameLis
 PlusStatus vtkPlusSavedDataSource::InternalDisconnect()
 {
   DeleteLocalBuffers();
+  if (this->OnDemandSequenceReader != NULL)
+  {
+    this->OnDemandSequenceReader->Delete();
+    this->OnDemandSequenceReader = NULL;
+  }
   return PLUS_SUCCESS;
 }
 
@@ -652,6 +798,7 @@ PlusStatus vtkPlusSavedDataSource::ReadConfiguration(vtkXMLDataElement* rootConf
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(RepeatEnabled, deviceConfig);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseOriginalTimestamps, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(UseSequenceIndexFile, deviceConfig);
 
   const char* useData = deviceConfig->GetAttribute("UseData");
   if (useData != NULL)
@@ -689,6 +836,7 @@ PlusStatus vtkPlusSavedDataSource::WriteConfiguration(vtkXMLDataElement* rootCon
   XML_WRITE_CSTRING_ATTRIBUTE_IF_NOT_NULL(SequenceFile, imageAcquisitionConfig);
   XML_WRITE_BOOL_ATTRIBUTE(RepeatEnabled, imageAcquisitionConfig);
   XML_WRITE_BOOL_ATTRIBUTE(UseOriginalTimestamps, imageAcquisitionConfig);
+  XML_WRITE_BOOL_ATTRIBUTE(UseSequenceIndexFile, imageAcquisitionConfig);
 
   if (this->UseAllFrameFields)
   {
@@ -845,6 +993,64 @@ void vtkPlusSavedDataSource::DeleteLocalBuffers()
   this->LocalTrackerBuffers.clear();
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSavedDataSource::AddVideoItemFromLocalBuffer(BufferItemUidType uid, long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const PlusTrackedFrame::FieldMapType* customFields)
+{
+  if (this->LocalVideoBuffer == NULL)
+  {
+    LOG_ERROR("vtkPlusSavedDataSource: Local video buffer is not available");
+    return PLUS_FAIL;
+  }
+
+  unsigned int frameSize[3] = {0, 0, 0};
+  PlusCommon::VTKScalarPixelType pixelType = VTK_VOID;
+  unsigned int numberOfScalarComponents = 0;
+  this->GetVideoFrameFormat(frameSize, pixelType, numberOfScalarComponents);
+
+  PlusStatus result(PLUS_SUCCESS);
+  std::vector<vtkPlusDataSource*> videoSources = this->GetVideoSources();
+  for (std::vector<vtkPlusDataSource*>::iterator it = videoSources.begin(); it != videoSources.end(); ++it)
+  {
+    vtkPlusDataSource* source = *it;
+    PlusVideoFrame* frame = NULL;
+    if (source->ReserveItem(this->LocalVideoBuffer->GetImageOrientation(), frameSize, pixelType,
+                            numberOfScalarComponents, this->LocalVideoBuffer->GetImageType(), frameNumber, frame, unfilteredTimestamp, filteredTimestamp) != PLUS_SUCCESS)
+    {
+      result = PLUS_FAIL;
+      continue;
+    }
+    if (frame == NULL)
+    {
+      // the item is not recorded
+      continue;
+    }
+    if (this->OnDemandSequenceReader != NULL)
+    {
+      // Items of the local buffer are in the same order as the frames in the file
+      unsigned int fileFrameNumber = static_cast<unsigned int>(uid - this->LocalVideoBuffer->GetOldestItemUidInBuffer());
+      if (this->OnDemandSequenceReader->ReadFrameImageData(fileFrameNumber, *frame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("vtkPlusSavedDataSource: Failed to decode frame " << fileFrameNumber << " from the sequence file, UID=" << uid);
+        source->CancelReservedItem();
+        result = PLUS_FAIL;
+        continue;
+      }
+    }
+    else if (this->LocalVideoBuffer->CopyItemFrame(uid, *frame) != ITEM_OK)
+    {
+      LOG_ERROR("vtkPlusSavedDataSource: Failed to retrieve frame from the buffer, UID=" << uid);
+      source->CancelReservedItem();
+      result = PLUS_FAIL;
+      continue;
+    }
+    if (source->CommitReservedItem(customFields) != PLUS_SUCCESS)
+    {
+      result = PLUS_FAIL;
+    }
+  }
+  return result;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusBuffer* vtkPlusSavedDataSource::GetLocalBuffer()
 {
@@ -12,6 +12,7 @@ See License.txt for details.
 #include "vtkPlusDevice.h"
 
 class vtkPlusBuffer;
+class vtkPlusMetaImageSequenceIO;
 
 class vtkPlusDataCollectionExport vtkPlusSavedDataSource;
 
@@ -27,6 +28,8 @@ Attributes:
 \li UseOriginalTimestamps: if true then the original timestamps (recorded originally in the source file)
   will be replayed exactly, otherwise only the timestamp difference will be replayed exactly,
   starting from the current time (TRUE|FALSE)
+\li UseSequenceIndexFile: if true then the parsed header of a MetaImage sequence file is saved in (and later read from)
+  a binary index file next to the sequence file (TRUE|FALSE)
 
 */
 class vtkPlusDataCollectionExport vtkPlusSavedDataSource : public vtkPlusDevice
@@ -73,6 +76,13 @@ public:
   /*! Read the timestamps from the file and use provide them in the output (instead of the current time) */
   vtkBooleanMacro( UseOriginalTimestamps, bool );
 
+  /*! Read the sequence file header from a binary index file, create the index file if it is missing or out of date */
+  vtkGetMacro( UseSequenceIndexFile, bool );
+  /*! Read the sequence file header from a binary index file, create the index file if it is missing or out of date */
+  vtkSetMacro( UseSequenceIndexFile, bool );
+  /*! Read the sequence file header from a binary index file, create the index file if it is missing or out of date */
+  vtkBooleanMacro( UseSequenceIndexFile, bool );
+
   /*! Get local video buffer */
   vtkGetObjectMacro( LocalVideoBuffer, vtkPlusBuffer );
 
@@ -115,6 +125,21 @@ protected:
 
   BufferItemUidType GetClosestFrameUidWithinTimeRange( double time_Local, double startTime_Local, double stopTime_Local );
 
+  /*! Read the frame fields of the sequence file and prepare the pixel data of video frames for decoding on demand */
+  PlusStatus ReadSequenceFile( const std::string& filePath, vtkPlusTrackedFrameList* savedDataBuffer );
+
+  /*! Decode the pixel data of all frames into the tracked frame list and close the on-demand sequence reader */
+  PlusStatus DecodeAllFrames( vtkPlusTrackedFrameList* savedDataBuffer );
+
+  /*! Create the local video buffer from the frames of the tracked frame list */
+  void CreateLocalVideoBuffer( vtkPlusTrackedFrameList* savedDataBuffer );
+
+  /*! Get the format of the replayed video frames (the local video buffer only stores placeholder images if frames are decoded on demand) */
+  void GetVideoFrameFormat( unsigned int frameSize[3], PlusCommon::VTKScalarPixelType& pixelType, unsigned int& numberOfScalarComponents );
+
+  /*! Copy a frame from the local video buffer directly into the next item of each output video source */
+  PlusStatus AddVideoItemFromLocalBuffer( BufferItemUidType uid, long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const PlusTrackedFrame::FieldMapType* customFields );
+
   /*! Get local tracker buffer */
   vtkPlusBuffer* GetLocalTrackerBuffer();
 
@@ -152,6 +177,12 @@ protected:
   /*! Local video buffer */
   vtkPlusBuffer* LocalVideoBuffer;
 
+  /*!
+    Sequence file reader that decodes the video frames from the file when they are replayed.
+    If it is NULL then the local video buffer contains the pixel data of all the frames.
+  */
+  vtkPlusMetaImageSequenceIO* OnDemandSequenceReader;
+
   /*! Local buffer for each tracker tool, used for storing data read from sequence metafile */
   std::map<std::string, vtkPlusBuffer*> LocalTrackerBuffers;
 
@@ -161,6 +192,9 @@ protected:
   /*! Read the timestamps from the file and use provide them in the output (instead of the current time) */
   bool UseOriginalTimestamps;
 
+  /*! Read the sequence file header from a binary index file, create the index file if it is missing or out of date */
+  bool UseSequenceIndexFile;
+
   /*! Buffer item UID of the last added frame in the local buffer */
   BufferItemUidType LastAddedFrameUid;
 
@@ -6,7 +6,13 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "vtksys/CommandLineArguments.hxx"
+#include "vtksys/SystemTools.hxx"
+#include "vtk_zlib.h"
+#include <cctype>
+#include <fstream>
 #include <iomanip>
+#include <iterator>
+#include <sstream>
 
 #include "vtkSmartPointer.h"
 #include "vtkMatrix4x4.h"
@@ -17,6 +23,39 @@ See License.txt for details.
 #include "vtkPlusTrackedFrameList.h"
 #include "PlusTrackedFrame.h"
 
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Returns true if the frames have the same size, pixel type, and pixel data
+  bool AreFramesEqual(PlusVideoFrame& frame1, PlusVideoFrame& frame2)
+  {
+    if (!frame1.IsImageValid() || !frame2.IsImageValid())
+    {
+      return frame1.IsImageValid() == frame2.IsImageValid();
+    }
+    return frame1.GetVTKScalarPixelType() == frame2.GetVTKScalarPixelType()
+      && frame1.GetNumberOfScalarComponents() == frame2.GetNumberOfScalarComponents()
+      && frame1.GetFrameSizeInBytes() == frame2.GetFrameSizeInBytes()
+      && memcmp(frame1.GetScalarPointer(), frame2.GetScalarPointer(), frame1.GetFrameSizeInBytes()) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  // Reads the compressed pixel data that is stored after the header of a .mha file
+  bool ReadCompressedPixelData(const std::string& fileName, unsigned long compressedDataSize, std::vector<unsigned char>& compressedData)
+  {
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const std::string lastHeaderLine = "ElementDataFile = LOCAL\n";
+    size_t dataStart = contents.find(lastHeaderLine);
+    if (dataStart == std::string::npos || dataStart + lastHeaderLine.size() + compressedDataSize > contents.size())
+    {
+      return false;
+    }
+    dataStart += lastHeaderLine.size();
+    compressedData.assign(contents.begin() + dataStart, contents.begin() + dataStart + compressedDataSize);
+    return true;
+  }
+}
 
 ///////////////////////////////////////////////////////////////////
 
@@ -91,6 +130,47 @@ int main(int argc, char **argv)
     numberOfFailures++;   
   }
 
+  LOG_INFO("Test reading with memory mapping ..."); 
+  for (int pass = 0; pass < 2; pass++)
+  {
+    vtkSmartPointer<vtkPlusMetaImageSequenceIO> mappedReader=vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+    mappedReader->SetFileName(inputImageSequenceFileName.c_str());
+    mappedReader->UseMemoryMappingOn();
+    if (mappedReader->Read()!=PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't read sequence metafile with memory mapping: " <<  inputImageSequenceFileName ); 
+      return EXIT_FAILURE;
+    }
+    vtkPlusTrackedFrameList* mappedFrameList = mappedReader->GetTrackedFrameList();
+    if (mappedFrameList->GetNumberOfTrackedFrames() != trackedFrameList->GetNumberOfTrackedFrames())
+    {
+      LOG_ERROR("Number of frames read with memory mapping does not match"); 
+      numberOfFailures++; 
+      break;
+    }
+    for (unsigned int i = 0; i < mappedFrameList->GetNumberOfTrackedFrames(); i++)
+    {
+      PlusVideoFrame* mappedImage = mappedFrameList->GetTrackedFrame(i)->GetImageData();
+      PlusVideoFrame* readImage = trackedFrameList->GetTrackedFrame(i)->GetImageData();
+      if (mappedImage->IsImageValid() != readImage->IsImageValid()
+        || (readImage->IsImageValid() && (mappedImage->GetFrameSizeInBytes() != readImage->GetFrameSizeInBytes()
+          || memcmp(mappedImage->GetScalarPointer(), readImage->GetScalarPointer(), readImage->GetFrameSizeInBytes()) != 0)))
+      {
+        LOG_ERROR("Pixel data read with memory mapping does not match at frame #" << i); 
+        numberOfFailures++; 
+      }
+    }
+    // Modifying a frame must not change the file (checked by the second pass)
+    if (pass == 0 && mappedFrameList->GetNumberOfTrackedFrames() > 0 && mappedFrameList->GetTrackedFrame(0)->GetImageData()->IsImageValid())
+    {
+      PlusVideoFrame* firstImage = mappedFrameList->GetTrackedFrame(0)->GetImageData();
+      unsigned int frameSize[3] = {0, 0, 0};
+      firstImage->GetFrameSize(frameSize);
+      firstImage->AllocateFrame(frameSize, firstImage->GetVTKScalarPixelType(), firstImage->GetNumberOfScalarComponents());
+      firstImage->FillBlank();
+    }
+  }
+
   // Create an absolute path to the output image sequence, in the output directory
   outputImageSequenceFileName=vtkPlusConfig::GetInstance()->GetOutputPath(outputImageSequenceFileName);
 
@@ -209,6 +289,257 @@ int main(int argc, char **argv)
 
   }
 
+  // ****************************************************************************** 
+  // Test decoding compressed frames on demand, using the compressed frame index
+
+  LOG_INFO("Test decoding compressed frames on demand ..."); 
+  {
+    // the reader keeps the file open until it is deleted
+    vtkSmartPointer<vtkPlusMetaImageSequenceIO> onDemandReader=vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+    onDemandReader->SetFileName(outputImageSequenceFileName.c_str());
+    onDemandReader->LoadImageDataOnDemandOn();
+    if (onDemandReader->Read()!=PLUS_SUCCESS)
+    {
+      LOG_ERROR("Couldn't read sequence metafile with on-demand image loading: " <<  outputImageSequenceFileName ); 
+      return EXIT_FAILURE;
+    }
+    if (onDemandReader->GetTrackedFrameList()->GetNumberOfTrackedFrames() != static_cast<unsigned int>(numberOfFrames))
+    {
+      LOG_ERROR("Number of frames read with on-demand image loading does not match"); 
+      numberOfFailures++; 
+    }
+    if (onDemandReader->GetTrackedFrameList()->GetCustomString("CompressedDataFrameIndex") == NULL || !onDemandReader->IsFrameRandomAccessSupported())
+    {
+      LOG_ERROR("Compressed frame index is not written or not used for reading"); 
+      numberOfFailures++; 
+    }
+    // Decode a frame from the middle first (without decoding the preceding frames), then all frames in reverse order
+    std::vector<int> decodingOrder;
+    decodingOrder.push_back(numberOfFrames / 2);
+    for ( int i = numberOfFrames - 1; i >= 0; i-- )
+    {
+      decodingOrder.push_back(i);
+    }
+    for ( std::vector<int>::iterator frameIt = decodingOrder.begin(); frameIt != decodingOrder.end() && *frameIt < numberOfFrames; ++frameIt )
+    {
+      PlusVideoFrame* writtenImage = trackedFrameList->GetTrackedFrame(*frameIt)->GetImageData();
+      if (!onDemandReader->IsFrameImageValid(*frameIt))
+      {
+        if (writtenImage->IsImageValid())
+        {
+          LOG_ERROR("Frame #" << *frameIt << " is written as invalid"); 
+          numberOfFailures++; 
+        }
+        continue;
+      }
+      PlusVideoFrame decodedImage;
+      if (onDemandReader->ReadFrameImageData(*frameIt, decodedImage) != PLUS_SUCCESS || !AreFramesEqual(decodedImage, *writtenImage))
+      {
+        LOG_ERROR("Pixel data decoded on demand does not match at frame #" << *frameIt); 
+        numberOfFailures++; 
+      }
+    }
+  }
+
+  // ****************************************************************************** 
+  // Test multi-threaded compression
+
+  LOG_INFO("Test multi-threaded compression ..."); 
+  {
+    std::string outputFileNameRoot = vtksys::SystemTools::GetFilenamePath(outputImageSequenceFileName) + "/" + vtksys::SystemTools::GetFilenameWithoutLastExtension(outputImageSequenceFileName);
+    const int numberOfCompressionThreads[2] = {1, 4};
+    std::vector<unsigned char> compressedData[2];
+    for (int pass = 0; pass < 2; pass++)
+    {
+      std::ostringstream threadedFileName;
+      threadedFileName << outputFileNameRoot << "Threads" << numberOfCompressionThreads[pass] << ".mha";
+      vtkSmartPointer<vtkPlusMetaImageSequenceIO> threadedWriter=vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+      threadedWriter->UseCompressionOn();
+      threadedWriter->SetNumberOfCompressionThreads(numberOfCompressionThreads[pass]);
+      threadedWriter->SetFileName(threadedFileName.str().c_str());
+      threadedWriter->SetTrackedFrameList(trackedFrameList);
+      if (threadedWriter->Write()!=PLUS_SUCCESS)
+      {
+        LOG_ERROR("Couldn't write sequence metafile with " << numberOfCompressionThreads[pass] << " compression threads: " << threadedFileName.str()); 
+        return EXIT_FAILURE;
+      }
+
+      vtkSmartPointer<vtkPlusMetaImageSequenceIO> threadedReader=vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+      threadedReader->SetFileName(threadedFileName.str().c_str());
+      if (threadedReader->Read()!=PLUS_SUCCESS)
+      {
+        LOG_ERROR("Couldn't read sequence metafile: " << threadedFileName.str()); 
+        return EXIT_FAILURE;
+      }
+      vtkPlusTrackedFrameList* threadedFrameList = threadedReader->GetTrackedFrameList();
+      if (threadedFrameList->GetNumberOfTrackedFrames() != static_cast<unsigned int>(numberOfFrames))
+      {
+        LOG_ERROR("Number of frames written with " << numberOfCompressionThreads[pass] << " compression threads does not match"); 
+        numberOfFailures++; 
+        continue;
+      }
+      unsigned long frameSizeInBytes = 0;
+      for ( int i = 0; i < numberOfFrames; i++ )
+      {
+        PlusVideoFrame* writtenImage = trackedFrameList->GetTrackedFrame(i)->GetImageData();
+        if (writtenImage->IsImageValid())
+        {
+          frameSizeInBytes = writtenImage->GetFrameSizeInBytes();
+          if (!AreFramesEqual(*threadedFrameList->GetTrackedFrame(i)->GetImageData(), *writtenImage))
+          {
+            LOG_ERROR("Pixel data written with " << numberOfCompressionThreads[pass] << " compression threads does not match at frame #" << i); 
+            numberOfFailures++; 
+          }
+        }
+      }
+
+      // Decompress the whole stream at once: zlib verifies the adler32 checksum at the end of the stream,
+      // which the compressor computes by combining the checksums of the blocks compressed by the threads
+      unsigned long compressedDataSize = 0;
+      PlusCommon::StringToLong(threadedFrameList->GetCustomString("CompressedDataSize"), compressedDataSize);
+      if (!ReadCompressedPixelData(threadedFileName.str(), compressedDataSize, compressedData[pass]) || compressedData[pass].empty())
+      {
+        LOG_ERROR("Couldn't read the compressed pixel data of " << threadedFileName.str()); 
+        numberOfFailures++; 
+        continue;
+      }
+      // One more byte than expected, so that extra data in the stream would be detected
+      std::vector<unsigned char> decompressedData(numberOfFrames * frameSizeInBytes + 1);
+      uLongf decompressedSize = static_cast<uLongf>(decompressedData.size());
+      if (uncompress(&decompressedData[0], &decompressedSize, &compressedData[pass][0], static_cast<uLong>(compressedData[pass].size())) != Z_OK
+        || decompressedSize != numberOfFrames * frameSizeInBytes)
+      {
+        LOG_ERROR("Pixel data written with " << numberOfCompressionThreads[pass] << " compression threads is not a valid zlib stream or its checksum does not match"); 
+        numberOfFailures++; 
+        continue;
+      }
+      for ( int i = 0; i < numberOfFrames; i++ )
+      {
+        PlusVideoFrame* writtenImage = trackedFrameList->GetTrackedFrame(i)->GetImageData();
+        if (writtenImage->IsImageValid() && memcmp(&decompressedData[i * frameSizeInBytes], writtenImage->GetScalarPointer(), frameSizeInBytes) != 0)
+        {
+          LOG_ERROR("Decompressed stream written with " << numberOfCompressionThreads[pass] << " compression threads does not match at frame #" << i); 
+          numberOfFailures++; 
+        }
+      }
+    }
+    // Blocks are compressed independently, so the result must not depend on the number of threads
+    if (compressedData[0] != compressedData[1])
+    {
+      LOG_ERROR("Compressed pixel data depends on the number of compression threads"); 
+      numberOfFailures++; 
+    }
+  }
+
+  // ****************************************************************************** 
+  // Test header index file
+
+  LOG_INFO("Test reading with header index file ..."); 
+  vtkSmartPointer<vtkPlusMetaImageSequenceIO> indexWriterReader=vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+  indexWriterReader->SetFileName(outputImageSequenceFileName.c_str());
+  indexWriterReader->UseHeaderIndexFileOn();
+  indexWriterReader->LoadImageDataOnDemandOn();
+  vtksys::SystemTools::RemoveFile(indexWriterReader->GetHeaderIndexFileName().c_str());
+  if (indexWriterReader->Read()!=PLUS_SUCCESS || !vtksys::SystemTools::FileExists(indexWriterReader->GetHeaderIndexFileName().c_str(), true))
+  {
+    LOG_ERROR("Couldn't read sequence metafile and create header index file: " <<  outputImageSequenceFileName ); 
+    return EXIT_FAILURE;
+  }
+  vtkSmartPointer<vtkPlusMetaImageSequenceIO> indexReader=vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+  indexReader->SetFileName(outputImageSequenceFileName.c_str());
+  indexReader->UseHeaderIndexFileOn();
+  indexReader->LoadImageDataOnDemandOn();
+  if (indexReader->Read()!=PLUS_SUCCESS)
+  {
+    LOG_ERROR("Couldn't read sequence metafile using the header index file: " <<  outputImageSequenceFileName ); 
+    return EXIT_FAILURE;
+  }
+  if (indexReader->GetTrackedFrameList()->GetNumberOfTrackedFrames() != static_cast<unsigned int>(numberOfFrames)
+    || indexReader->GetTrackedFrameList()->GetCustomString("UltrasoundImageOrientation") == NULL)
+  {
+    LOG_ERROR("Number of frames or header fields read from the header index file do not match"); 
+    numberOfFailures++; 
+  }
+  for ( int i = 0; i < numberOfFrames && i < static_cast<int>(indexReader->GetTrackedFrameList()->GetNumberOfTrackedFrames()); i++ )
+  {
+    PlusTrackedFrame* parsedFrame = indexWriterReader->GetTrackedFrameList()->GetTrackedFrame(i);
+    PlusTrackedFrame* indexedFrame = indexReader->GetTrackedFrameList()->GetTrackedFrame(i);
+    vtkSmartPointer<vtkMatrix4x4> parsedMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkMatrix4x4> indexedMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    if ( parsedFrame->GetTimestamp() != indexedFrame->GetTimestamp()
+      || !parsedFrame->GetCustomFrameTransform(highPrecTransformName, parsedMatrix)
+      || !indexedFrame->GetCustomFrameTransform(highPrecTransformName, indexedMatrix) )
+    {
+      LOG_ERROR("Timestamp or transform read from the header index file does not match at frame #" << i); 
+      numberOfFailures++; 
+      continue;
+    }
+    for (int row = 0; row < 4; row++)
+    {
+      for (int col = 0; col < 4; col++)
+      {
+        if ( parsedMatrix->GetElement(row, col) != indexedMatrix->GetElement(row, col) ) 
+        {
+          LOG_ERROR("Transform read from the header index file does not match at frame #" << i << " element: (" << row << ", " << col << "). ");
+          numberOfFailures++; 
+        }
+      }
+    }
+  }
+  vtksys::SystemTools::RemoveFile(indexReader->GetHeaderIndexFileName().c_str());
+
+  LOG_INFO("Test header index file of modified header with unchanged file size and modification time ..."); 
+  std::string modifiedImageSequenceFileName = outputImageSequenceFileName + "_modified.mha";
+  vtksys::SystemTools::CopyFileAlways(outputImageSequenceFileName.c_str(), modifiedImageSequenceFileName.c_str());
+  vtksys::SystemTools::CopyFileTime(outputImageSequenceFileName.c_str(), modifiedImageSequenceFileName.c_str());
+  vtkSmartPointer<vtkPlusMetaImageSequenceIO> modifiedIndexWriter=vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+  modifiedIndexWriter->SetFileName(modifiedImageSequenceFileName.c_str());
+  modifiedIndexWriter->UseHeaderIndexFileOn();
+  modifiedIndexWriter->LoadImageDataOnDemandOn();
+  vtksys::SystemTools::RemoveFile(modifiedIndexWriter->GetHeaderIndexFileName().c_str());
+  if (modifiedIndexWriter->Read()!=PLUS_SUCCESS || !vtksys::SystemTools::FileExists(modifiedIndexWriter->GetHeaderIndexFileName().c_str(), true))
+  {
+    LOG_ERROR("Couldn't read sequence metafile and create header index file: " <<  modifiedImageSequenceFileName ); 
+    return EXIT_FAILURE;
+  }
+  // Change the last digit of the timestamp of the first frame, without changing the file size
+  std::string modifiedFileContents;
+  {
+    std::ifstream modifiedFile(modifiedImageSequenceFileName.c_str(), std::ios::binary);
+    modifiedFileContents.assign(std::istreambuf_iterator<char>(modifiedFile), std::istreambuf_iterator<char>());
+  }
+  size_t timestampPos = modifiedFileContents.find("Seq_Frame0000_Timestamp");
+  size_t timestampEndPos = (timestampPos == std::string::npos ? std::string::npos : modifiedFileContents.find_first_of("\r\n", timestampPos));
+  if (timestampEndPos == std::string::npos || !isdigit(static_cast<unsigned char>(modifiedFileContents[timestampEndPos - 1])))
+  {
+    LOG_ERROR("Timestamp of the first frame is not found in the header of " << modifiedImageSequenceFileName); 
+    return EXIT_FAILURE;
+  }
+  modifiedFileContents[timestampEndPos - 1] = (modifiedFileContents[timestampEndPos - 1] == '0' ? '1' : '0');
+  {
+    std::ofstream modifiedFile(modifiedImageSequenceFileName.c_str(), std::ios::binary | std::ios::trunc);
+    modifiedFile.write(modifiedFileContents.c_str(), modifiedFileContents.size());
+  }
+  vtksys::SystemTools::CopyFileTime(outputImageSequenceFileName.c_str(), modifiedImageSequenceFileName.c_str());
+  vtkSmartPointer<vtkPlusMetaImageSequenceIO> modifiedIndexReader=vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+  modifiedIndexReader->SetFileName(modifiedImageSequenceFileName.c_str());
+  modifiedIndexReader->UseHeaderIndexFileOn();
+  modifiedIndexReader->LoadImageDataOnDemandOn();
+  if (modifiedIndexReader->Read()!=PLUS_SUCCESS || modifiedIndexReader->GetTrackedFrameList()->GetNumberOfTrackedFrames() == 0)
+  {
+    LOG_ERROR("Couldn't read modified sequence metafile: " <<  modifiedImageSequenceFileName ); 
+    return EXIT_FAILURE;
+  }
+  if (modifiedIndexReader->GetTrackedFrameList()->GetTrackedFrame(0)->GetTimestamp() == modifiedIndexWriter->GetTrackedFrameList()->GetTrackedFrame(0)->GetTimestamp())
+  {
+    LOG_ERROR("Out of date header index file was used for reading modified sequence metafile: " <<  modifiedImageSequenceFileName ); 
+    numberOfFailures++; 
+  }
+  vtksys::SystemTools::RemoveFile(modifiedIndexReader->GetHeaderIndexFileName().c_str());
+  modifiedIndexReader = NULL;
+  modifiedIndexWriter = NULL;
+  vtksys::SystemTools::RemoveFile(modifiedImageSequenceFileName.c_str());
+
   // ****************************************************************************** 
   // Test image status 
 
@@ -0,0 +1,214 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferContentionTest.cxx
+  \brief Measures how the latency of adding items to a buffer depends on the number of concurrent readers
+
+  A writer thread adds tracking items to a vtkPlusBuffer as fast as possible while a varying number of reader threads
+  query the latest items and search items by timestamp (as the OpenIGTLink server, virtual capture, and volume reconstructor do).
+  The test runs both in the default (locked) and in the lock-free reading mode and reports the writer latency statistics.
+  The test fails if a reader receives inconsistent data (item UID going backward, timestamp not matching the item UID).
+*/
+
+#include "PlusConfigure.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusBuffer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const double FIRST_ITEM_TIMESTAMP = 1.0;
+  const double ITEM_PERIOD_SEC = 0.001;
+
+  struct WriterLatencyStatistics
+  {
+    double MeanUs;
+    double Percentile99Us;
+    double MaxUs;
+  };
+
+  //----------------------------------------------------------------------------
+  double GetExpectedTimestamp(BufferItemUidType uid)
+  {
+    // Items are added with frame number == UID, starting from 1
+    return FIRST_ITEM_TIMESTAMP + (uid - 1) * ITEM_PERIOD_SEC;
+  }
+
+  //----------------------------------------------------------------------------
+  void ReaderThread(vtkPlusBuffer* buffer, std::atomic<bool>* stopRequested, std::atomic<int>* numberOfErrors)
+  {
+    BufferItemUidType previousLatestUid = 0;
+    while (!stopRequested->load())
+    {
+      BufferItemUidType latestUid = buffer->GetLatestItemUidInBuffer();
+      if (latestUid < previousLatestUid)
+      {
+        LOG_ERROR("Latest item UID decreased from " << previousLatestUid << " to " << latestUid);
+        (*numberOfErrors)++;
+      }
+      previousLatestUid = latestUid;
+      if (latestUid == 0)
+      {
+        continue;
+      }
+
+      double latestTimestamp = 0;
+      if (buffer->GetTimeStamp(latestUid, latestTimestamp) == ITEM_OK
+          && fabs(latestTimestamp - GetExpectedTimestamp(latestUid)) > 1e-9)
+      {
+        LOG_ERROR("Inconsistent timestamp for item " << latestUid << ": " << std::fixed << latestTimestamp << " (expected " << GetExpectedTimestamp(latestUid) << ")");
+        (*numberOfErrors)++;
+      }
+
+      // Search for an item somewhere in the middle of the buffer
+      BufferItemUidType oldestUid = buffer->GetOldestItemUidInBuffer();
+      BufferItemUidType searchedUid = oldestUid + (latestUid - oldestUid) / 2;
+      BufferItemUidType foundUid = 0;
+      if (buffer->GetItemUidFromTime(GetExpectedTimestamp(searchedUid), foundUid) == ITEM_OK)
+      {
+        // the searched item may have been overwritten, but then a newer item must be found
+        if (foundUid < searchedUid)
+        {
+          LOG_ERROR("Item search by time returned item " << foundUid << " instead of " << searchedUid);
+          (*numberOfErrors)++;
+        }
+        unsigned long index = 0;
+        if (buffer->GetIndex(foundUid, index) == ITEM_OK && index != foundUid)
+        {
+          LOG_ERROR("Inconsistent index for item " << foundUid << ": " << index);
+          (*numberOfErrors)++;
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  WriterLatencyStatistics RunContention(bool lockFreeReading, int numberOfReaders, int numberOfItems, int bufferSize, std::atomic<int>& numberOfErrors)
+  {
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(bufferSize);
+    buffer->SetLockFreeReading(lockFreeReading);
+
+    std::atomic<bool> stopRequested(false);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < numberOfReaders; ++i)
+    {
+      readers.push_back(std::thread(ReaderThread, buffer.GetPointer(), &stopRequested, &numberOfErrors));
+    }
+
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    std::vector<double> latenciesUs;
+    latenciesUs.reserve(numberOfItems);
+    for (int frameNumber = 1; frameNumber <= numberOfItems; ++frameNumber)
+    {
+      double timestamp = GetExpectedTimestamp(frameNumber);
+      matrix->SetElement(0, 3, frameNumber);
+      double startTime = vtkPlusAccurateTimer::GetSystemTime();
+      if (buffer->AddTimeStampedItem(matrix, TOOL_OK, frameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add item " << frameNumber << " to the buffer");
+        numberOfErrors++;
+      }
+      latenciesUs.push_back((vtkPlusAccurateTimer::GetSystemTime() - startTime) * 1e6);
+    }
+
+    stopRequested = true;
+    for (std::vector<std::thread>::iterator it = readers.begin(); it != readers.end(); ++it)
+    {
+      it->join();
+    }
+
+    WriterLatencyStatistics stats;
+    stats.MeanUs = 0;
+    for (std::vector<double>::iterator it = latenciesUs.begin(); it != latenciesUs.end(); ++it)
+    {
+      stats.MeanUs += *it;
+    }
+    stats.MeanUs /= latenciesUs.size();
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    stats.Percentile99Us = latenciesUs[static_cast<size_t>(0.99 * (latenciesUs.size() - 1))];
+    stats.MaxUs = latenciesUs.back();
+    return stats;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfItems(20000);
+  int bufferSize(150);
+  int maxNumberOfReaders(8);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-items", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfItems, "Number of items added by the writer in each round (Default: 20000).");
+  args.AddArgument("--buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &bufferSize, "Number of items in the buffer (Default: 150).");
+  args.AddArgument("--max-number-of-readers", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxNumberOfReaders, "Maximum number of concurrent reader threads (Default: 8).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfItems < 1 || bufferSize < 2 || maxNumberOfReaders < 0)
+  {
+    LOG_ERROR("Invalid arguments: number of items and buffer size must be positive, number of readers must not be negative");
+    return EXIT_FAILURE;
+  }
+
+  std::atomic<int> numberOfErrors(0);
+  for (int mode = 0; mode < 2; ++mode)
+  {
+    bool lockFreeReading = (mode == 1);
+    WriterLatencyStatistics noReaderStats = { 0, 0, 0 };
+    WriterLatencyStatistics stats = { 0, 0, 0 };
+    for (int numberOfReaders = 0; numberOfReaders <= maxNumberOfReaders; numberOfReaders = (numberOfReaders == 0 ? 1 : numberOfReaders * 2))
+    {
+      stats = RunContention(lockFreeReading, numberOfReaders, numberOfItems, bufferSize, numberOfErrors);
+      if (numberOfReaders == 0)
+      {
+        noReaderStats = stats;
+      }
+      LOG_INFO((lockFreeReading ? "Lock-free" : "Locked") << " reading, " << numberOfReaders << " readers: writer latency mean = "
+               << stats.MeanUs << "us, 99th percentile = " << stats.Percentile99Us << "us, max = " << stats.MaxUs << "us");
+    }
+    if (noReaderStats.Percentile99Us > 0)
+    {
+      LOG_INFO((lockFreeReading ? "Lock-free" : "Locked") << " reading: 99th percentile writer latency with " << maxNumberOfReaders
+               << " readers is " << stats.Percentile99Us / noReaderStats.Percentile99Us << "x of the latency without readers");
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,371 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferReserveItemTest.cxx
+  \brief Tests adding frames to a vtkPlusBuffer by writing them directly into the buffer (ReserveItem/CommitReservedItem)
+
+  Checks that frames added by reserve/commit are identical to frames added by AddItem (both when the frame is written
+  directly into the buffer and when it has to be reoriented), that cancelling a reserved item keeps the buffer consistent
+  (also for lock-free readers),
+  that items retrieved from the buffer are not modified when their buffer slot is overwritten, and reports the time
+  needed to add large frames by AddItem and by reserve/commit.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <vector>
+
+namespace
+{
+  const int NUMBER_OF_COMPONENTS = 3;
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkPlusBuffer> CreateBuffer(int bufferSize, const unsigned int frameSize[3])
+  {
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(bufferSize);
+    buffer->SetImageOrientation(US_IMG_ORIENT_MF);
+    buffer->SetImageType(US_IMG_RGB_COLOR);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(NUMBER_OF_COMPONENTS);
+    buffer->SetFrameSize(frameSize[0], frameSize[1], frameSize[2]);
+    return buffer;
+  }
+
+  //----------------------------------------------------------------------------
+  void FillFrame(unsigned char* pixels, size_t sizeInBytes, int frameNumber)
+  {
+    for (size_t i = 0; i < sizeInBytes; ++i)
+    {
+      pixels[i] = static_cast<unsigned char>((i * 7 + frameNumber * 13) & 0xFF);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  size_t GetFrameSizeInBytes(const unsigned int frameSize[3])
+  {
+    return static_cast<size_t>(frameSize[0]) * frameSize[1] * frameSize[2] * NUMBER_OF_COMPONENTS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddFrameByReserve(vtkPlusBuffer* buffer, US_IMAGE_ORIENTATION inputOrientation, const unsigned int frameSize[3], int frameNumber, double timestamp)
+  {
+    int noClip[3] = { PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP };
+    PlusVideoFrame* frame = NULL;
+    if (buffer->ReserveItem(inputOrientation, frameSize, VTK_UNSIGNED_CHAR, NUMBER_OF_COMPONENTS, US_IMG_RGB_COLOR, frameNumber, noClip, noClip, frame, timestamp, timestamp) != PLUS_SUCCESS
+        || frame == NULL)
+    {
+      LOG_ERROR("Failed to reserve item " << frameNumber);
+      return PLUS_FAIL;
+    }
+    FillFrame(static_cast<unsigned char*>(frame->GetScalarPointer()), GetFrameSizeInBytes(frameSize), frameNumber);
+    if (buffer->CommitReservedItem() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to commit item " << frameNumber);
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddFrameByCopy(vtkPlusBuffer* buffer, US_IMAGE_ORIENTATION inputOrientation, const unsigned int frameSize[3], int frameNumber, double timestamp, std::vector<unsigned char>& deviceFrame)
+  {
+    int noClip[3] = { PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP };
+    deviceFrame.resize(GetFrameSizeInBytes(frameSize));
+    FillFrame(&deviceFrame[0], deviceFrame.size(), frameNumber);
+    if (buffer->AddItem(&deviceFrame[0], inputOrientation, frameSize, VTK_UNSIGNED_CHAR, NUMBER_OF_COMPONENTS, US_IMG_RGB_COLOR, 0, frameNumber, noClip, noClip, timestamp, timestamp) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add item " << frameNumber);
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int CompareLatestFrames(vtkPlusBuffer* reserveBuffer, vtkPlusBuffer* copyBuffer)
+  {
+    StreamBufferItem reservedItem;
+    StreamBufferItem copiedItem;
+    if (reserveBuffer->GetLatestStreamBufferItem(&reservedItem) != ITEM_OK || copyBuffer->GetLatestStreamBufferItem(&copiedItem) != ITEM_OK)
+    {
+      LOG_ERROR("Failed to get latest items");
+      return 1;
+    }
+    int numberOfErrors = 0;
+    if (reservedItem.GetFilteredTimestamp(0) != copiedItem.GetFilteredTimestamp(0) || reservedItem.GetIndex() != copiedItem.GetIndex())
+    {
+      LOG_ERROR("Item metadata mismatch: timestamp " << std::fixed << reservedItem.GetFilteredTimestamp(0) << " vs " << copiedItem.GetFilteredTimestamp(0)
+                << ", index " << reservedItem.GetIndex() << " vs " << copiedItem.GetIndex());
+      numberOfErrors++;
+    }
+    if (reservedItem.GetFrame().GetFrameSizeInBytes() != copiedItem.GetFrame().GetFrameSizeInBytes()
+        || memcmp(reservedItem.GetFrame().GetScalarPointer(), copiedItem.GetFrame().GetScalarPointer(), copiedItem.GetFrame().GetFrameSizeInBytes()) != 0)
+    {
+      LOG_ERROR("Frame pixels added by reserve/commit differ from the pixels added by AddItem (item index " << copiedItem.GetIndex() << ")");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestEqualToAddItem(US_IMAGE_ORIENTATION inputOrientation)
+  {
+    const unsigned int frameSize[3] = { 64, 48, 1 };
+    vtkSmartPointer<vtkPlusBuffer> reserveBuffer = CreateBuffer(5, frameSize);
+    vtkSmartPointer<vtkPlusBuffer> copyBuffer = CreateBuffer(5, frameSize);
+    std::vector<unsigned char> deviceFrame;
+    int numberOfErrors = 0;
+    for (int frameNumber = 1; frameNumber <= 12; ++frameNumber)
+    {
+      double timestamp = 1.0 + frameNumber * 0.1;
+      if (AddFrameByReserve(reserveBuffer, inputOrientation, frameSize, frameNumber, timestamp) != PLUS_SUCCESS
+          || AddFrameByCopy(copyBuffer, inputOrientation, frameSize, frameNumber, timestamp, deviceFrame) != PLUS_SUCCESS)
+      {
+        return numberOfErrors + 1;
+      }
+      numberOfErrors += CompareLatestFrames(reserveBuffer, copyBuffer);
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestCancel(bool lockFreeReading)
+  {
+    const unsigned int frameSize[3] = { 16, 16, 1 };
+    const int bufferSize = 5;
+    vtkSmartPointer<vtkPlusBuffer> buffer = CreateBuffer(bufferSize, frameSize);
+    buffer->SetLockFreeReading(lockFreeReading);
+    int frameNumber = 1;
+    for (; frameNumber <= bufferSize; ++frameNumber)
+    {
+      if (AddFrameByReserve(buffer, US_IMG_ORIENT_MF, frameSize, frameNumber, frameNumber) != PLUS_SUCCESS)
+      {
+        return 1;
+      }
+    }
+
+    BufferItemUidType latestUidBefore = buffer->GetLatestItemUidInBuffer();
+    BufferItemUidType oldestUidBefore = buffer->GetOldestItemUidInBuffer();
+
+    int noClip[3] = { PlusCommon::NO_CLIP, PlusCommon::NO_CLIP, PlusCommon::NO_CLIP };
+    PlusVideoFrame* frame = NULL;
+    if (buffer->ReserveItem(US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, NUMBER_OF_COMPONENTS, US_IMG_RGB_COLOR, frameNumber, noClip, noClip, frame, frameNumber, frameNumber) != PLUS_SUCCESS
+        || frame == NULL)
+    {
+      LOG_ERROR("Failed to reserve item");
+      return 1;
+    }
+    buffer->CancelReservedItem();
+
+    int numberOfErrors = 0;
+    // The oldest item was stored in the reserved slot, so it must have been removed
+    if (buffer->GetLatestItemUidInBuffer() != latestUidBefore || buffer->GetOldestItemUidInBuffer() != oldestUidBefore + 1 || buffer->GetNumberOfItems() != bufferSize - 1)
+    {
+      LOG_ERROR("Unexpected buffer content after cancelling a reserved item: latest UID = " << buffer->GetLatestItemUidInBuffer() << " (expected " << latestUidBefore
+                << "), oldest UID = " << buffer->GetOldestItemUidInBuffer() << " (expected " << oldestUidBefore + 1 << "), number of items = " << buffer->GetNumberOfItems());
+      numberOfErrors++;
+    }
+
+    // The new oldest item must be found by timestamp (the timestamp of each item is its frame number, which is the same as its UID)
+    BufferItemUidType oldestUidFromTime = 0;
+    if (buffer->GetItemUidFromTime(static_cast<double>(oldestUidBefore + 1), oldestUidFromTime) != ITEM_OK || oldestUidFromTime != oldestUidBefore + 1)
+    {
+      LOG_ERROR("Oldest item is not found by timestamp after cancelling a reserved item (lock-free reading: " << (lockFreeReading ? "enabled" : "disabled") << ")");
+      numberOfErrors++;
+    }
+
+    // The buffer must accept new items after cancelling
+    if (AddFrameByReserve(buffer, US_IMG_ORIENT_MF, frameSize, frameNumber, frameNumber) != PLUS_SUCCESS)
+    {
+      return numberOfErrors + 1;
+    }
+    unsigned long index = 0;
+    if (buffer->GetLatestItemUidInBuffer() != latestUidBefore + 1 || buffer->GetIndex(latestUidBefore + 1, index) != ITEM_OK || index != static_cast<unsigned long>(frameNumber))
+    {
+      LOG_ERROR("Failed to add item after cancelling a reserved item");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestSharedFrames(bool addByReserve)
+  {
+    const unsigned int frameSize[3] = { 16, 16, 1 };
+    const int bufferSize = 3;
+    vtkSmartPointer<vtkPlusBuffer> buffer = CreateBuffer(bufferSize, frameSize);
+    std::vector<unsigned char> deviceFrame;
+    int frameNumber = 1;
+    for (; frameNumber <= bufferSize + 1; ++frameNumber)
+    {
+      PlusStatus status = addByReserve ? AddFrameByReserve(buffer, US_IMG_ORIENT_MF, frameSize, frameNumber, frameNumber)
+                          : AddFrameByCopy(buffer, US_IMG_ORIENT_MF, frameSize, frameNumber, frameNumber, deviceFrame);
+      if (status != PLUS_SUCCESS)
+      {
+        return 1;
+      }
+    }
+
+    int numberOfErrors = 0;
+
+    // The pixels of an item that is not referenced anymore are overwritten in place
+    void* latestPixels = NULL;
+    {
+      StreamBufferItem oldestItem;
+      if (buffer->GetOldestStreamBufferItem(&oldestItem) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get oldest item");
+        return numberOfErrors + 1;
+      }
+      latestPixels = oldestItem.GetFrame().GetScalarPointer();
+    }
+
+    // Keep a reference to the second oldest item while its slot is overwritten
+    StreamBufferItem heldItem;
+    if (buffer->GetStreamBufferItem(buffer->GetOldestItemUidInBuffer() + 1, &heldItem) != ITEM_OK)
+    {
+      LOG_ERROR("Failed to get second oldest item");
+      return numberOfErrors + 1;
+    }
+    for (int i = 0; i < 2; ++i, ++frameNumber)
+    {
+      PlusStatus status = addByReserve ? AddFrameByReserve(buffer, US_IMG_ORIENT_MF, frameSize, frameNumber, frameNumber)
+                          : AddFrameByCopy(buffer, US_IMG_ORIENT_MF, frameSize, frameNumber, frameNumber, deviceFrame);
+      if (status != PLUS_SUCCESS)
+      {
+        return numberOfErrors + 1;
+      }
+      // The first added frame overwrites the slot of the released item, the second one overwrites the slot of the held item
+      if (i == 0)
+      {
+        StreamBufferItem latestItem;
+        if (buffer->GetLatestStreamBufferItem(&latestItem) != ITEM_OK || latestItem.GetFrame().GetScalarPointer() != latestPixels)
+        {
+          LOG_ERROR("The pixel data of a buffer item that is not referenced anymore was not reused");
+          numberOfErrors++;
+        }
+      }
+    }
+
+    std::vector<unsigned char> expectedPixels(GetFrameSizeInBytes(frameSize));
+    FillFrame(&expectedPixels[0], expectedPixels.size(), heldItem.GetIndex());
+    if (heldItem.GetFrame().GetFrameSizeInBytes() != expectedPixels.size()
+        || memcmp(heldItem.GetFrame().GetScalarPointer(), &expectedPixels[0], expectedPixels.size()) != 0)
+    {
+      LOG_ERROR("The pixels of a buffer item (index " << heldItem.GetIndex() << ") changed when its buffer slot was overwritten");
+      numberOfErrors++;
+    }
+    StreamBufferItem latestItem;
+    FillFrame(&expectedPixels[0], expectedPixels.size(), frameNumber - 1);
+    if (buffer->GetLatestStreamBufferItem(&latestItem) != ITEM_OK
+        || memcmp(latestItem.GetFrame().GetScalarPointer(), &expectedPixels[0], expectedPixels.size()) != 0)
+    {
+      LOG_ERROR("The latest buffer item does not contain the pixels of frame " << frameNumber - 1);
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int MeasureAddTime(const unsigned int frameSize[3], int numberOfFrames)
+  {
+    vtkSmartPointer<vtkPlusBuffer> reserveBuffer = CreateBuffer(30, frameSize);
+    vtkSmartPointer<vtkPlusBuffer> copyBuffer = CreateBuffer(30, frameSize);
+    std::vector<unsigned char> deviceFrame;
+
+    double reserveTimeSec = 0;
+    double copyTimeSec = 0;
+    for (int frameNumber = 1; frameNumber <= numberOfFrames; ++frameNumber)
+    {
+      double startTime = vtkPlusAccurateTimer::GetSystemTime();
+      if (AddFrameByCopy(copyBuffer, US_IMG_ORIENT_MF, frameSize, frameNumber, frameNumber, deviceFrame) != PLUS_SUCCESS)
+      {
+        return 1;
+      }
+      double copyDoneTime = vtkPlusAccurateTimer::GetSystemTime();
+      if (AddFrameByReserve(reserveBuffer, US_IMG_ORIENT_MF, frameSize, frameNumber, frameNumber) != PLUS_SUCCESS)
+      {
+        return 1;
+      }
+      copyTimeSec += copyDoneTime - startTime;
+      reserveTimeSec += vtkPlusAccurateTimer::GetSystemTime() - copyDoneTime;
+    }
+
+    double frameSizeMb = GetFrameSizeInBytes(frameSize) / 1e6;
+    LOG_INFO("Frame size " << frameSize[0] << "x" << frameSize[1] << " RGB: AddItem " << copyTimeSec * 1000 / numberOfFrames << "ms/frame, reserve/commit "
+             << reserveTimeSec * 1000 / numberOfFrames << "ms/frame (" << frameSizeMb * numberOfFrames << "MB written)");
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfFrames(100);
+  std::vector<int> frameSizeArg;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames added in the timing test (Default: 100).");
+  args.AddArgument("--frame-size", vtksys::CommandLineArguments::MULTI_ARGUMENT, &frameSizeArg, "Size of the frames in the timing test (Default: 1920 1080).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  unsigned int frameSize[3] = { 1920, 1080, 1 };
+  if (frameSizeArg.size() == 2 && frameSizeArg[0] > 0 && frameSizeArg[1] > 0)
+  {
+    frameSize[0] = frameSizeArg[0];
+    frameSize[1] = frameSizeArg[1];
+  }
+  else if (!frameSizeArg.empty())
+  {
+    LOG_ERROR("Invalid frame size, two positive values are expected");
+    return EXIT_FAILURE;
+  }
+
+  int numberOfErrors = 0;
+  LOG_INFO("Test frames written directly into the buffer");
+  numberOfErrors += TestEqualToAddItem(US_IMG_ORIENT_MF);
+  LOG_INFO("Test frames that have to be reoriented");
+  numberOfErrors += TestEqualToAddItem(US_IMG_ORIENT_MN);
+  LOG_INFO("Test cancelling reserved items");
+  numberOfErrors += TestCancel(false);
+  numberOfErrors += TestCancel(true);
+  LOG_INFO("Test sharing of frames between the buffer and its readers");
+  numberOfErrors += TestSharedFrames(false);
+  numberOfErrors += TestSharedFrames(true);
+  numberOfErrors += MeasureAddTime(frameSize, numberOfFrames);
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
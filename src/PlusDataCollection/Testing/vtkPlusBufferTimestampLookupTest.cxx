@@ -0,0 +1,211 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferTimestampLookupTest.cxx
+  \brief Measures the speed of finding buffer items by timestamp for different buffer sizes
+
+  Buffers of different sizes are filled with items that have jittered timestamps (with occasional acquisition gaps)
+  and then items are searched by random timestamps using GetItemUidFromTime, in both the locked and the lock-free reading mode.
+  The average lookup time is reported for each buffer size. The test fails if a lookup result differs from the
+  item that is found by an exhaustive search.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusBuffer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+  const double FIRST_ITEM_TIMESTAMP = 1.0;
+  const double ITEM_PERIOD_SEC = 0.01;
+  // An acquisition gap is inserted after every GAP_PERIOD items, to make the timestamps not perfectly uniform
+  const int GAP_PERIOD = 97;
+  const double GAP_LENGTH_SEC = 0.5;
+
+  //----------------------------------------------------------------------------
+  PlusStatus FillBuffer(vtkPlusBuffer* buffer, int numberOfItems, std::mt19937& randomGenerator)
+  {
+    std::uniform_real_distribution<double> jitter(0.0, 0.4 * ITEM_PERIOD_SEC);
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    double gapsSec = 0;
+    for (int frameNumber = 1; frameNumber <= numberOfItems; ++frameNumber)
+    {
+      if (frameNumber % GAP_PERIOD == 0)
+      {
+        gapsSec += GAP_LENGTH_SEC;
+      }
+      double timestamp = FIRST_ITEM_TIMESTAMP + frameNumber * ITEM_PERIOD_SEC + gapsSec + jitter(randomGenerator);
+      matrix->SetElement(0, 3, frameNumber);
+      if (buffer->AddTimeStampedItem(matrix, TOOL_OK, frameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add item " << frameNumber << " to the buffer");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns the smallest time difference between the requested time and any item in the buffer
+  double GetClosestTimeDifferenceExhaustive(vtkPlusBuffer* buffer, double time)
+  {
+    double closestTimeDifference = -1;
+    for (BufferItemUidType uid = buffer->GetOldestItemUidInBuffer(); uid <= buffer->GetLatestItemUidInBuffer(); ++uid)
+    {
+      double timestamp = 0;
+      if (buffer->GetTimeStamp(uid, timestamp) != ITEM_OK)
+      {
+        continue;
+      }
+      double timeDifference = fabs(timestamp - time);
+      if (closestTimeDifference < 0 || timeDifference < closestTimeDifference)
+      {
+        closestTimeDifference = timeDifference;
+      }
+    }
+    return closestTimeDifference;
+  }
+
+  //----------------------------------------------------------------------------
+  int RunLookups(bool lockFreeReading, int bufferSize, int numberOfLookups, int numberOfVerifiedLookups, double& lookupTimeNs)
+  {
+    std::mt19937 randomGenerator(bufferSize);
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(bufferSize);
+    buffer->SetLockFreeReading(lockFreeReading);
+    // Fill the buffer more than once, so that the items wrap around in the circular buffer
+    if (FillBuffer(buffer, 2 * bufferSize + bufferSize / 3, randomGenerator) != PLUS_SUCCESS)
+    {
+      return 1;
+    }
+
+    double oldestTimestamp = 0;
+    double latestTimestamp = 0;
+    if (buffer->GetOldestTimeStamp(oldestTimestamp) != ITEM_OK || buffer->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
+    {
+      LOG_ERROR("Failed to get the time range of the buffer");
+      return 1;
+    }
+
+    std::uniform_real_distribution<double> requestedTime(oldestTimestamp, latestTimestamp);
+    std::vector<double> requestedTimes(numberOfLookups);
+    for (int i = 0; i < numberOfLookups; ++i)
+    {
+      requestedTimes[i] = requestedTime(randomGenerator);
+    }
+
+    int numberOfErrors = 0;
+    std::vector<BufferItemUidType> foundUids(numberOfLookups);
+    double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    for (int i = 0; i < numberOfLookups; ++i)
+    {
+      if (buffer->GetItemUidFromTime(requestedTimes[i], foundUids[i]) != ITEM_OK)
+      {
+        foundUids[i] = 0;
+      }
+    }
+    lookupTimeNs = (vtkPlusAccurateTimer::GetSystemTime() - startTime) * 1e9 / numberOfLookups;
+
+    for (int i = 0; i < numberOfLookups && i < numberOfVerifiedLookups; ++i)
+    {
+      double foundTimestamp = 0;
+      if (foundUids[i] == 0 || buffer->GetTimeStamp(foundUids[i], foundTimestamp) != ITEM_OK)
+      {
+        LOG_ERROR("Item was not found at time " << std::fixed << requestedTimes[i]);
+        numberOfErrors++;
+        continue;
+      }
+      double closestTimeDifference = GetClosestTimeDifferenceExhaustive(buffer, requestedTimes[i]);
+      if (fabs(foundTimestamp - requestedTimes[i]) > closestTimeDifference + 1e-9)
+      {
+        LOG_ERROR("Item search by time " << std::fixed << requestedTimes[i] << " returned item " << foundUids[i] << " at " << foundTimestamp
+                  << ", but there is an item closer by " << closestTimeDifference << " sec");
+        numberOfErrors++;
+      }
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfLookups(100000);
+  int numberOfVerifiedLookups(1000);
+  std::vector<int> bufferSizes;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--buffer-sizes", vtksys::CommandLineArguments::MULTI_ARGUMENT, &bufferSizes, "Sizes of the tested buffers (Default: 150 1500 15000).");
+  args.AddArgument("--number-of-lookups", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfLookups, "Number of timed lookups for each buffer size (Default: 100000).");
+  args.AddArgument("--number-of-verified-lookups", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfVerifiedLookups, "Number of lookups that are compared to the result of an exhaustive search (Default: 1000).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (bufferSizes.empty())
+  {
+    bufferSizes.push_back(150);
+    bufferSizes.push_back(1500);
+    bufferSizes.push_back(15000);
+  }
+
+  if (numberOfLookups < 1)
+  {
+    LOG_ERROR("Invalid arguments: number of lookups must be positive");
+    return EXIT_FAILURE;
+  }
+
+  int numberOfErrors = 0;
+  for (std::vector<int>::iterator bufferSizeIt = bufferSizes.begin(); bufferSizeIt != bufferSizes.end(); ++bufferSizeIt)
+  {
+    if (*bufferSizeIt < 2)
+    {
+      LOG_ERROR("Invalid buffer size: " << *bufferSizeIt);
+      numberOfErrors++;
+      continue;
+    }
+    for (int mode = 0; mode < 2; ++mode)
+    {
+      bool lockFreeReading = (mode == 1);
+      double lookupTimeNs = 0;
+      numberOfErrors += RunLookups(lockFreeReading, *bufferSizeIt, numberOfLookups, numberOfVerifiedLookups, lookupTimeNs);
+      LOG_INFO("Buffer size " << *bufferSizeIt << ", " << (lockFreeReading ? "lock-free" : "locked") << " reading: "
+               << lookupTimeNs << "ns per GetItemUidFromTime call");
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusChannelGetTrackedFrameTest.cxx
+  \brief Measures the time needed to assemble a tracked frame from a channel with many tools
+
+  A channel with a video source and 10 tools is filled with data, then GetTrackedFrame is called repeatedly and the
+  transforms are passed to a transform repository (as the OpenIGTLink server and the data collector do for each frame).
+  For comparison, the same transforms are also passed through their text representation (the way tracked frames stored
+  transforms before they were kept in binary form). The test fails if any transform or status is not retrieved correctly.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusTrackedFrame.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusTransformRepository.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+  const double FIRST_ITEM_TIMESTAMP = 1.0;
+  const double ITEM_PERIOD_SEC = 0.01;
+
+  //----------------------------------------------------------------------------
+  double GetExpectedElement(int toolIndex, int itemIndex, int element)
+  {
+    return toolIndex * 100.0 + itemIndex + element / 16.0;
+  }
+
+  //----------------------------------------------------------------------------
+  std::string GetToolName(int toolIndex)
+  {
+    std::ostringstream name;
+    name << "Tool" << toolIndex;
+    return name.str();
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus VerifyTrackedFrame(PlusTrackedFrame& trackedFrame, vtkPlusTransformRepository* repository, int numberOfTools, int itemIndex)
+  {
+    PlusStatus result = PLUS_SUCCESS;
+    if (repository->SetTransforms(trackedFrame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set transforms of item " << itemIndex);
+      return PLUS_FAIL;
+    }
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+      PlusTransformName toolToTracker(GetToolName(toolIndex), "Tracker");
+      bool isValid = false;
+      if (repository->GetTransform(toolToTracker, matrix, &isValid) != PLUS_SUCCESS || isValid != (toolIndex % 2 == 0))
+      {
+        LOG_ERROR("Failed to get " << toolToTracker.GetTransformName() << " of item " << itemIndex << " or its status is incorrect");
+        result = PLUS_FAIL;
+        continue;
+      }
+      for (int element = 0; element < 16; ++element)
+      {
+        if (fabs(matrix->GetElement(element / 4, element % 4) - GetExpectedElement(toolIndex, itemIndex, element)) > 1e-9)
+        {
+          LOG_ERROR("Element " << element << " of " << toolToTracker.GetTransformName() << " of item " << itemIndex << " is incorrect");
+          result = PLUS_FAIL;
+          break;
+        }
+      }
+    }
+    return result;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int numberOfTools = 10;
+  int numberOfItems = 100;
+  int numberOfRepetitions = 50;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--number-of-tools", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfTools, "Number of tools in the channel (default: 10)");
+  args.AddArgument("--number-of-items", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfItems, "Number of items in each buffer (default: 100)");
+  args.AddArgument("--number-of-repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of times each tracked frame is retrieved (default: 50)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfTools < 1 || numberOfItems < 1 || numberOfRepetitions < 1)
+  {
+    LOG_ERROR("Number of tools, items, and repetitions must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  // Set up a channel with a video source and the tools
+  vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+
+  vtkSmartPointer<vtkPlusDataSource> videoSource = vtkSmartPointer<vtkPlusDataSource>::New();
+  videoSource->SetId("Video");
+  videoSource->SetBufferSize(numberOfItems);
+  videoSource->SetInputImageOrientation(US_IMG_ORIENT_MF);
+  videoSource->SetImageType(US_IMG_BRIGHTNESS);
+  videoSource->SetPixelType(VTK_UNSIGNED_CHAR);
+  videoSource->SetNumberOfScalarComponents(1);
+  videoSource->SetInputFrameSize(16, 16, 1);
+  channel->SetVideoSource(videoSource);
+
+  std::vector<vtkSmartPointer<vtkPlusDataSource> > tools;
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+  {
+    vtkSmartPointer<vtkPlusDataSource> tool = vtkSmartPointer<vtkPlusDataSource>::New();
+    tool->SetId(PlusTransformName(GetToolName(toolIndex), "Tracker").GetTransformName());
+    tool->SetBufferSize(numberOfItems);
+    channel->AddTool(tool);
+    tools.push_back(tool);
+  }
+
+  // Fill the buffers
+  PlusVideoFrame frame;
+  const unsigned int frameSize[3] = {16, 16, 1};
+  frame.AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1);
+  frame.SetImageOrientation(US_IMG_ORIENT_MF);
+  frame.SetImageType(US_IMG_BRIGHTNESS);
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+  {
+    double timestamp = FIRST_ITEM_TIMESTAMP + itemIndex * ITEM_PERIOD_SEC;
+    if (videoSource->AddItem(&frame, itemIndex, timestamp, timestamp) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add video item " << itemIndex);
+      exit(EXIT_FAILURE);
+    }
+    for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+      for (int element = 0; element < 16; ++element)
+      {
+        matrix->SetElement(element / 4, element % 4, GetExpectedElement(toolIndex, itemIndex, element));
+      }
+      ToolStatus status = (toolIndex % 2 == 0 ? TOOL_OK : TOOL_OUT_OF_VIEW);
+      if (tools[toolIndex]->AddTimeStampedItem(matrix, status, itemIndex, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add item " << itemIndex << " to tool " << toolIndex);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkPlusTransformRepository> repository = vtkSmartPointer<vtkPlusTransformRepository>::New();
+
+  // Binary transforms (current implementation)
+  double startTime = vtkPlusAccurateTimer::GetSystemTime();
+  for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    for (int itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+    {
+      PlusTrackedFrame trackedFrame;
+      if (channel->GetTrackedFrame(FIRST_ITEM_TIMESTAMP + itemIndex * ITEM_PERIOD_SEC, trackedFrame) != PLUS_SUCCESS
+          || repository->SetTransforms(trackedFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to get tracked frame " << itemIndex);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  double binaryTimeUs = (vtkPlusAccurateTimer::GetSystemTime() - startTime) * 1e6 / (numberOfRepetitions * numberOfItems);
+
+  // Transforms converted to text and parsed again (previous implementation)
+  startTime = vtkPlusAccurateTimer::GetSystemTime();
+  for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    for (int itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+    {
+      PlusTrackedFrame trackedFrame;
+      if (channel->GetTrackedFrame(FIRST_ITEM_TIMESTAMP + itemIndex * ITEM_PERIOD_SEC, trackedFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to get tracked frame " << itemIndex);
+        exit(EXIT_FAILURE);
+      }
+      PlusTrackedFrame textFrame;
+      std::vector<std::string> fieldNames;
+      trackedFrame.GetCustomFrameFieldNameList(fieldNames);
+      for (std::vector<std::string>::iterator it = fieldNames.begin(); it != fieldNames.end(); ++it)
+      {
+        textFrame.SetCustomFrameField(*it, std::string(trackedFrame.GetCustomFrameField(*it)));
+      }
+      if (repository->SetTransforms(textFrame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to set transforms of tracked frame " << itemIndex);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  double textTimeUs = (vtkPlusAccurateTimer::GetSystemTime() - startTime) * 1e6 / (numberOfRepetitions * numberOfItems);
+
+  LOG_INFO("GetTrackedFrame with " << numberOfTools << " tools: " << std::fixed << std::setprecision(2) << binaryTimeUs << " us/frame with binary transforms, "
+           << textTimeUs << " us/frame with text conversion of the transforms");
+
+  // Verify the transforms, both directly and after conversion to text (as they are written to sequence files)
+  for (int itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+  {
+    PlusTrackedFrame trackedFrame;
+    if (channel->GetTrackedFrame(FIRST_ITEM_TIMESTAMP + itemIndex * ITEM_PERIOD_SEC, trackedFrame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get tracked frame " << itemIndex);
+      ++numberOfFailures;
+      continue;
+    }
+    if (VerifyTrackedFrame(trackedFrame, repository, numberOfTools, itemIndex) != PLUS_SUCCESS)
+    {
+      ++numberOfFailures;
+    }
+
+    PlusTrackedFrame textFrame;
+    std::vector<std::string> fieldNames;
+    trackedFrame.GetCustomFrameFieldNameList(fieldNames);
+    for (std::vector<std::string>::iterator it = fieldNames.begin(); it != fieldNames.end(); ++it)
+    {
+      textFrame.SetCustomFrameField(*it, std::string(trackedFrame.GetCustomFrameField(*it)));
+    }
+    if (VerifyTrackedFrame(textFrame, repository, numberOfTools, itemIndex) != PLUS_SUCCESS)
+    {
+      ++numberOfFailures;
+    }
+
+    // The field map is cached between calls, but it must reflect the modifications of the frame
+    PlusTransformName toolToTracker(GetToolName(0), "Tracker");
+    std::string toolFieldName = toolToTracker.GetTransformName() + PlusTrackedFrame::TransformPostfix;
+    const PlusTrackedFrame::FieldMapType& fields = trackedFrame.GetCustomFields();
+    double identity[16];
+    vtkMatrix4x4::Identity(identity);
+    trackedFrame.SetCustomFrameTransform(toolToTracker, identity);
+    trackedFrame.SetCustomFrameField("CacheTestField", "1");
+    const PlusTrackedFrame::FieldMapType& modifiedFields = trackedFrame.GetCustomFields();
+    PlusTrackedFrame::FieldMapType::const_iterator toolField = modifiedFields.find(toolFieldName);
+    if (&fields != &modifiedFields || toolField == modifiedFields.end() || toolField->second != trackedFrame.GetCustomFrameField(toolFieldName)
+        || modifiedFields.find("CacheTestField") == modifiedFields.end())
+    {
+      LOG_ERROR("Custom field map of item " << itemIndex << " does not reflect the modified fields");
+      ++numberOfFailures;
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
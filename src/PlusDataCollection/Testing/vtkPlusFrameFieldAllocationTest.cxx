@@ -0,0 +1,350 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusFrameFieldAllocationTest.cxx
+  \brief Counts the memory allocations needed to copy frame metadata
+
+  The global operator new is replaced by a counting version. The test reports the number of allocations per frame
+  - for copying custom fields and transforms the way it was done with std::map<std::string, std::string> field maps
+    (map copied by value, then inserted key by key, transforms formatted as text),
+  - for copying the same fields with interned field names and PlusFrameFieldStore,
+  - for vtkPlusChannel::GetTrackedFrame with 10 tools (without image data).
+  The test fails if the field store needs more allocations than the map-based copy, if copying a field store
+  into a store that has enough capacity allocates memory, or if looking up interned field names allocates memory.
+
+  On Windows memory allocated inside shared libraries is not counted, so the reported numbers are only accurate
+  on platforms where the global operator new is shared by all modules.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusTrackedFrame.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+  std::atomic<unsigned long long> NumberOfAllocations(0);
+
+  const double FIRST_ITEM_TIMESTAMP = 1.0;
+  const double ITEM_PERIOD_SEC = 0.01;
+  const int NUMBER_OF_ITEMS = 50;
+  const int NUMBER_OF_TOOLS = 10;
+
+  //----------------------------------------------------------------------------
+  std::string GetToolId(int toolIndex)
+  {
+    std::ostringstream name;
+    name << "Tool" << toolIndex << "ToTracker";
+    return name.str();
+  }
+
+  //----------------------------------------------------------------------------
+  void GetVideoFields(int itemIndex, PlusTrackedFrame::FieldMapType& fields)
+  {
+    std::ostringstream depth;
+    depth << 40 + itemIndex % 10;
+    fields["DepthMm"] = depth.str();
+    fields["ProbeFrequencyMhz"] = "5.0";
+    fields["UltrasoundMachineConfiguration"] = "Abdominal preset with harmonic imaging enabled";
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Copy fields and transforms as it was done when all fields were stored in std::map<std::string, std::string> */
+  void CopyFieldsUsingMaps(const std::vector<PlusTrackedFrame::FieldMapType>& sourceFields, const std::vector<std::string>& transformValues,
+                           const std::vector<std::string>& transformFieldNames, PlusTrackedFrame::FieldMapType& destination)
+  {
+    for (std::vector<PlusTrackedFrame::FieldMapType>::const_iterator sourceIt = sourceFields.begin(); sourceIt != sourceFields.end(); ++sourceIt)
+    {
+      PlusTrackedFrame::FieldMapType fieldMap = *sourceIt;
+      for (PlusTrackedFrame::FieldMapType::iterator fieldIt = fieldMap.begin(); fieldIt != fieldMap.end(); ++fieldIt)
+      {
+        destination[fieldIt->first] = fieldIt->second;
+      }
+    }
+    for (size_t i = 0; i < transformFieldNames.size(); ++i)
+    {
+      destination[transformFieldNames[i]] = transformValues[i];
+      destination[transformFieldNames[i] + "Status"] = "OK";
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+  ++NumberOfAllocations;
+  void* p = malloc(size > 0 ? size : 1);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int numberOfRepetitions = 100;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--number-of-repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of times each measurement is repeated (default: 100)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfRepetitions < 1)
+  {
+    LOG_ERROR("Number of repetitions must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfFailures = 0;
+
+  // Fields of one frame: video fields, a field of each tool, and the tool transforms
+  std::vector<PlusTrackedFrame::FieldMapType> sourceFieldMaps(NUMBER_OF_TOOLS + 1);
+  GetVideoFields(0, sourceFieldMaps[0]);
+  std::vector<std::string> transformFieldNames;
+  std::vector<std::string> transformValues;
+  std::vector<PlusFieldId> transformFieldIds;
+  double matrix[16];
+  vtkMatrix4x4::Identity(matrix);
+  for (int toolIndex = 0; toolIndex < NUMBER_OF_TOOLS; ++toolIndex)
+  {
+    sourceFieldMaps[toolIndex + 1]["MarkerError" + GetToolId(toolIndex)] = "0.25";
+    transformFieldNames.push_back(GetToolId(toolIndex) + "Transform");
+    transformValues.push_back("1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1 ");
+    transformFieldIds.push_back(PlusFieldNameTable::GetTransformFieldId(GetToolId(toolIndex)));
+  }
+  std::vector<PlusFrameFieldStore> sourceFieldStores(sourceFieldMaps.size());
+  for (size_t i = 0; i < sourceFieldMaps.size(); ++i)
+  {
+    sourceFieldStores[i].SetFieldMap(sourceFieldMaps[i]);
+  }
+
+  // Map-based copy (previous implementation)
+  unsigned long long allocationsBefore = NumberOfAllocations;
+  for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    PlusTrackedFrame::FieldMapType destination;
+    CopyFieldsUsingMaps(sourceFieldMaps, transformValues, transformFieldNames, destination);
+  }
+  double mapAllocationsPerFrame = static_cast<double>(NumberOfAllocations - allocationsBefore) / numberOfRepetitions;
+
+  // Interned field names and field store
+  allocationsBefore = NumberOfAllocations;
+  for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    PlusTrackedFrame trackedFrame;
+    for (std::vector<PlusFrameFieldStore>::const_iterator storeIt = sourceFieldStores.begin(); storeIt != sourceFieldStores.end(); ++storeIt)
+    {
+      trackedFrame.SetCustomFrameFields(*storeIt);
+    }
+    for (int toolIndex = 0; toolIndex < NUMBER_OF_TOOLS; ++toolIndex)
+    {
+      trackedFrame.SetCustomFrameTransform(transformFieldIds[toolIndex], matrix);
+      trackedFrame.SetCustomFrameTransformStatus(transformFieldIds[toolIndex], FIELD_OK);
+    }
+  }
+  double storeAllocationsPerFrame = static_cast<double>(NumberOfAllocations - allocationsBefore) / numberOfRepetitions;
+
+  LOG_INFO("Copying " << NUMBER_OF_TOOLS << " transforms and " << sourceFieldMaps.size() << " field maps: "
+           << mapAllocationsPerFrame << " allocations per frame with std::map fields, "
+           << storeAllocationsPerFrame << " allocations per frame with field store");
+  if (storeAllocationsPerFrame > mapAllocationsPerFrame)
+  {
+    LOG_ERROR("Field store requires more allocations than std::map fields");
+    ++numberOfFailures;
+  }
+
+  // Looking up names and identifiers that are already interned must not allocate memory
+  const std::string videoFieldName("UltrasoundMachineConfiguration");
+  const std::string transformName(GetToolId(0));
+  const std::string transformFieldName(transformFieldNames[0]);
+  PlusFieldId expectedVideoFieldId = PlusFieldNameTable::GetFieldId(videoFieldName);
+  PlusFieldId expectedStatusFieldId = PlusFieldNameTable::GetRelatedTransformFieldId(transformFieldIds[0]);
+  bool lookupsCorrect = true;
+  allocationsBefore = NumberOfAllocations;
+  for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    lookupsCorrect &= (PlusFieldNameTable::GetFieldId(videoFieldName) == expectedVideoFieldId);
+    lookupsCorrect &= (PlusFieldNameTable::FindFieldId(videoFieldName.c_str()) == expectedVideoFieldId);
+    lookupsCorrect &= (PlusFieldNameTable::GetFieldId(transformFieldName.c_str()) == transformFieldIds[0]);
+    lookupsCorrect &= (PlusFieldNameTable::GetTransformFieldId(transformName) == transformFieldIds[0]);
+    lookupsCorrect &= !PlusFieldNameTable::GetFieldName(transformFieldIds[0]).empty();
+    lookupsCorrect &= (PlusFieldNameTable::GetFieldKind(transformFieldIds[0]) == PlusFieldNameTable::TRANSFORM_FIELD);
+    lookupsCorrect &= (PlusFieldNameTable::GetRelatedTransformFieldId(transformFieldIds[0]) == expectedStatusFieldId);
+  }
+  unsigned long long lookupAllocations = NumberOfAllocations - allocationsBefore;
+  LOG_INFO("Looking up interned field names: " << lookupAllocations << " allocations");
+  if (lookupAllocations > 0)
+  {
+    LOG_ERROR("Looking up interned field names allocated memory");
+    ++numberOfFailures;
+  }
+  if (!lookupsCorrect || PlusFieldNameTable::GetFieldName(transformFieldIds[0]) != transformFieldName)
+  {
+    LOG_ERROR("Interned field name lookup returned an incorrect result");
+    ++numberOfFailures;
+  }
+
+  // Copying into a store that already has enough capacity must not allocate memory
+  PlusFrameFieldStore destinationStore;
+  destinationStore = sourceFieldStores[0];
+  allocationsBefore = NumberOfAllocations;
+  for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    destinationStore = sourceFieldStores[0];
+  }
+  unsigned long long storeCopyAllocations = NumberOfAllocations - allocationsBefore;
+  LOG_INFO("Copying a field store into a store with enough capacity: " << storeCopyAllocations << " allocations");
+  if (storeCopyAllocations > 0)
+  {
+    LOG_ERROR("Copying a field store into a store with enough capacity allocated memory");
+    ++numberOfFailures;
+  }
+
+  // Same for copying tracked frame metadata (frames do not have image data)
+  PlusTrackedFrame sourceFrame;
+  for (std::vector<PlusFrameFieldStore>::const_iterator storeIt = sourceFieldStores.begin(); storeIt != sourceFieldStores.end(); ++storeIt)
+  {
+    sourceFrame.SetCustomFrameFields(*storeIt);
+  }
+  for (int toolIndex = 0; toolIndex < NUMBER_OF_TOOLS; ++toolIndex)
+  {
+    sourceFrame.SetCustomFrameTransform(transformFieldIds[toolIndex], matrix);
+    sourceFrame.SetCustomFrameTransformStatus(transformFieldIds[toolIndex], FIELD_OK);
+  }
+  PlusTrackedFrame destinationFrame;
+  destinationFrame = sourceFrame;
+  allocationsBefore = NumberOfAllocations;
+  for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    destinationFrame = sourceFrame;
+  }
+  LOG_INFO("Copying tracked frame metadata into an existing frame: " << static_cast<double>(NumberOfAllocations - allocationsBefore) / numberOfRepetitions
+           << " allocations per frame");
+
+  // GetTrackedFrame from a channel with a video source and tools
+  vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+  vtkSmartPointer<vtkPlusDataSource> videoSource = vtkSmartPointer<vtkPlusDataSource>::New();
+  videoSource->SetId("Video");
+  videoSource->SetBufferSize(NUMBER_OF_ITEMS);
+  videoSource->SetInputImageOrientation(US_IMG_ORIENT_MF);
+  videoSource->SetImageType(US_IMG_BRIGHTNESS);
+  videoSource->SetPixelType(VTK_UNSIGNED_CHAR);
+  videoSource->SetNumberOfScalarComponents(1);
+  videoSource->SetInputFrameSize(16, 16, 1);
+  channel->SetVideoSource(videoSource);
+  std::vector<vtkSmartPointer<vtkPlusDataSource> > tools;
+  for (int toolIndex = 0; toolIndex < NUMBER_OF_TOOLS; ++toolIndex)
+  {
+    vtkSmartPointer<vtkPlusDataSource> tool = vtkSmartPointer<vtkPlusDataSource>::New();
+    tool->SetId(GetToolId(toolIndex));
+    tool->SetBufferSize(NUMBER_OF_ITEMS);
+    channel->AddTool(tool);
+    tools.push_back(tool);
+  }
+  PlusVideoFrame frame;
+  const unsigned int frameSize[3] = {16, 16, 1};
+  frame.AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1);
+  frame.SetImageOrientation(US_IMG_ORIENT_MF);
+  frame.SetImageType(US_IMG_BRIGHTNESS);
+  vtkSmartPointer<vtkMatrix4x4> toolMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int itemIndex = 0; itemIndex < NUMBER_OF_ITEMS; ++itemIndex)
+  {
+    double timestamp = FIRST_ITEM_TIMESTAMP + itemIndex * ITEM_PERIOD_SEC;
+    PlusTrackedFrame::FieldMapType videoFields;
+    GetVideoFields(itemIndex, videoFields);
+    if (videoSource->AddItem(&frame, itemIndex, timestamp, timestamp, &videoFields) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add video item " << itemIndex);
+      exit(EXIT_FAILURE);
+    }
+    for (int toolIndex = 0; toolIndex < NUMBER_OF_TOOLS; ++toolIndex)
+    {
+      if (tools[toolIndex]->AddTimeStampedItem(toolMatrix, TOOL_OK, itemIndex, timestamp, timestamp, &sourceFieldMaps[toolIndex + 1]) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add item " << itemIndex << " to tool " << toolIndex);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  allocationsBefore = NumberOfAllocations;
+  for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    PlusTrackedFrame trackedFrame;
+    int itemIndex = repetition % NUMBER_OF_ITEMS;
+    if (channel->GetTrackedFrame(FIRST_ITEM_TIMESTAMP + itemIndex * ITEM_PERIOD_SEC, trackedFrame, false) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get tracked frame " << itemIndex);
+      exit(EXIT_FAILURE);
+    }
+  }
+  LOG_INFO("GetTrackedFrame with " << NUMBER_OF_TOOLS << " tools (without image data): "
+           << static_cast<double>(NumberOfAllocations - allocationsBefore) / numberOfRepetitions << " allocations per frame");
+
+  // Verify that the fields are copied correctly
+  PlusTrackedFrame trackedFrame;
+  if (channel->GetTrackedFrame(FIRST_ITEM_TIMESTAMP + 3 * ITEM_PERIOD_SEC, trackedFrame) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get tracked frame");
+    exit(EXIT_FAILURE);
+  }
+  PlusTrackedFrame::FieldMapType expectedVideoFields;
+  GetVideoFields(3, expectedVideoFields);
+  for (PlusTrackedFrame::FieldMapType::iterator fieldIt = expectedVideoFields.begin(); fieldIt != expectedVideoFields.end(); ++fieldIt)
+  {
+    const char* value = trackedFrame.GetCustomFrameField(fieldIt->first);
+    if (value == NULL || fieldIt->second != value)
+    {
+      LOG_ERROR("Field " << fieldIt->first << " is " << (value ? value : "undefined") << ", expected " << fieldIt->second);
+      ++numberOfFailures;
+    }
+  }
+  for (int toolIndex = 0; toolIndex < NUMBER_OF_TOOLS; ++toolIndex)
+  {
+    const char* value = trackedFrame.GetCustomFrameField("MarkerError" + GetToolId(toolIndex));
+    TrackedFrameFieldStatus status = FIELD_INVALID;
+    if (value == NULL || std::string(value) != "0.25"
+        || trackedFrame.GetCustomFrameTransformStatus(PlusTransformName(GetToolId(toolIndex)), status) != PLUS_SUCCESS || status != FIELD_OK)
+    {
+      LOG_ERROR("Fields of tool " << toolIndex << " are not copied correctly");
+      ++numberOfFailures;
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
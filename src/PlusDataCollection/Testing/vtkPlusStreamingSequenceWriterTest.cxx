@@ -0,0 +1,232 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusStreamingSequenceWriterTest.cxx
+  \brief Sustained throughput test of vtkPlusStreamingSequenceWriter
+
+  Generates frames as fast as the writer can accept them (the producer only waits while the write queue is full) and
+  reports the sustained write rate. The test fails if more frames are kept in memory than the configured maximum or if
+  the written file does not contain the generated frames.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusTrackedFrame.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkPlusMetaImageSequenceIO.h"
+#include "vtkPlusStreamingSequenceWriter.h"
+#include "vtkPlusTrackedFrameList.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include "vtksys/SystemTools.hxx"
+
+namespace
+{
+  const double FRAME_PERIOD_SEC = 0.01;
+
+  //----------------------------------------------------------------------------
+  unsigned char GetPixelValue(unsigned int frameIndex, unsigned int pixelIndex)
+  {
+    return static_cast<unsigned char>((frameIndex * 7 + pixelIndex) & 0xFF);
+  }
+
+  //----------------------------------------------------------------------------
+  PlusTrackedFrame* CreateFrame(unsigned int frameIndex, const unsigned int frameSize[3], vtkMatrix4x4* probeToTracker)
+  {
+    PlusTrackedFrame* frame = new PlusTrackedFrame;
+    PlusVideoFrame* image = frame->GetImageData();
+    image->SetImageOrientation(US_IMG_ORIENT_MF);
+    image->SetImageType(US_IMG_BRIGHTNESS);
+    image->AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1);
+    unsigned char* pixels = static_cast<unsigned char*>(image->GetScalarPointer());
+    const unsigned int numberOfPixels = frameSize[0] * frameSize[1] * frameSize[2];
+    for (unsigned int i = 0; i < numberOfPixels; ++i)
+    {
+      pixels[i] = GetPixelValue(frameIndex, i);
+    }
+    frame->SetTimestamp(frameIndex * FRAME_PERIOD_SEC);
+    probeToTracker->SetElement(0, 3, frameIndex * 0.1);
+    PlusTransformName probeToTrackerName("Probe", "Tracker");
+    frame->SetCustomFrameTransform(probeToTrackerName, probeToTracker);
+    frame->SetCustomFrameTransformStatus(probeToTrackerName, FIELD_OK);
+    return frame;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus VerifyFrame(vtkPlusMetaImageSequenceIO* reader, unsigned int frameIndex, const unsigned int frameSize[3])
+  {
+    PlusTrackedFrame* trackedFrame = reader->GetTrackedFrameList()->GetTrackedFrame(frameIndex);
+    if (trackedFrame == NULL || fabs(trackedFrame->GetTimestamp() - frameIndex * FRAME_PERIOD_SEC) > 1e-6)
+    {
+      LOG_ERROR("Timestamp of frame " << frameIndex << " is incorrect");
+      return PLUS_FAIL;
+    }
+    PlusVideoFrame image;
+    if (reader->ReadFrameImageData(frameIndex, image) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read image data of frame " << frameIndex);
+      return PLUS_FAIL;
+    }
+    const unsigned char* pixels = static_cast<const unsigned char*>(image.GetScalarPointer());
+    const unsigned int numberOfPixels = frameSize[0] * frameSize[1] * frameSize[2];
+    for (unsigned int i = 0; i < numberOfPixels; ++i)
+    {
+      if (pixels[i] != GetPixelValue(frameIndex, i))
+      {
+        LOG_ERROR("Pixel " << i << " of frame " << frameIndex << " is incorrect");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int numberOfFrames = 50000;
+  int frameWidth = 64;
+  int frameHeight = 64;
+  int framesPerBatch = 1;
+  int maximumNumberOfQueuedFrames = 64;
+  std::string outputFileName("StreamingSequenceWriterTest.mha");
+  bool keepOutputFile = false;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--number-of-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames to write (default: 50000)");
+  args.AddArgument("--frame-width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameWidth, "Frame width in pixels (default: 64)");
+  args.AddArgument("--frame-height", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameHeight, "Frame height in pixels (default: 64)");
+  args.AddArgument("--frames-per-batch", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &framesPerBatch, "Number of frames passed to the writer at once (default: 1)");
+  args.AddArgument("--maximum-queued-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maximumNumberOfQueuedFrames, "Maximum number of frames waiting to be written (default: 64)");
+  args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "Output sequence file name, relative to the output directory (default: StreamingSequenceWriterTest.mha)");
+  args.AddArgument("--keep-output-file", vtksys::CommandLineArguments::NO_ARGUMENT, &keepOutputFile, "Do not delete the output file at the end of the test");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfFrames < 1 || frameWidth < 1 || frameHeight < 1 || framesPerBatch < 1 || maximumNumberOfQueuedFrames < 1)
+  {
+    LOG_ERROR("Number of frames, frame size, batch size and maximum number of queued frames must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  const unsigned int frameSize[3] = {static_cast<unsigned int>(frameWidth), static_cast<unsigned int>(frameHeight), 1};
+  const double frameSizeMb = frameWidth * frameHeight / (1024.0 * 1024.0);
+  std::string outputFilePath = vtkPlusConfig::GetInstance()->GetOutputPath(outputFileName);
+
+  vtkSmartPointer<vtkPlusStreamingSequenceWriter> writer = vtkSmartPointer<vtkPlusStreamingSequenceWriter>::New();
+  writer->SetMaximumNumberOfQueuedFrames(maximumNumberOfQueuedFrames);
+  writer->SetUseCompression(false);
+  if (writer->Open(outputFilePath) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to open " << outputFilePath << " for writing");
+    exit(EXIT_FAILURE);
+  }
+
+  LOG_INFO("Writing " << numberOfFrames << " frames of " << frameWidth << "x" << frameHeight << " pixels to " << outputFilePath);
+
+  vtkSmartPointer<vtkPlusTrackedFrameList> batch = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
+  vtkSmartPointer<vtkMatrix4x4> probeToTracker = vtkSmartPointer<vtkMatrix4x4>::New();
+  int numberOfQueueFullWaits = 0;
+  double startTime = vtkPlusAccurateTimer::GetSystemTime();
+  for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+  {
+    batch->TakeTrackedFrame(CreateFrame(frameIndex, frameSize, probeToTracker), vtkPlusTrackedFrameList::ADD_INVALID_FRAME);
+    if (static_cast<int>(batch->GetNumberOfTrackedFrames()) < framesPerBatch && frameIndex + 1 < numberOfFrames)
+    {
+      continue;
+    }
+    // Same as a data capture thread: do not acquire new frames while the writer is busy with the queued frames
+    while (writer->IsQueueFull())
+    {
+      ++numberOfQueueFullWaits;
+      vtkPlusAccurateTimer::Delay(0.001);
+    }
+    if (writer->AppendFrames(batch) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to append frame " << frameIndex);
+      exit(EXIT_FAILURE);
+    }
+  }
+  double appendTimeSec = vtkPlusAccurateTimer::GetSystemTime() - startTime;
+
+  std::string writtenFilePath;
+  if (writer->Close(&writtenFilePath) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to close " << outputFilePath);
+    exit(EXIT_FAILURE);
+  }
+  double totalTimeSec = vtkPlusAccurateTimer::GetSystemTime() - startTime;
+
+  LOG_INFO("Frames appended in " << appendTimeSec << " sec, file closed after " << totalTimeSec << " sec");
+  LOG_INFO("Sustained write rate: " << numberOfFrames / totalTimeSec << " frames/sec, " << numberOfFrames * frameSizeMb / totalTimeSec << " MB/sec");
+  LOG_INFO("Peak number of frames in memory: " << writer->GetPeakNumberOfQueuedFrames() << " (maximum: " << maximumNumberOfQueuedFrames
+           << "), producer waited " << numberOfQueueFullWaits << " times for the writer");
+
+  int numberOfFailures = 0;
+  if (writer->GetPeakNumberOfQueuedFrames() > static_cast<unsigned int>(maximumNumberOfQueuedFrames + framesPerBatch))
+  {
+    LOG_ERROR("Memory usage is not bounded: " << writer->GetPeakNumberOfQueuedFrames() << " frames were queued, at most "
+              << maximumNumberOfQueuedFrames + framesPerBatch << " are allowed");
+    ++numberOfFailures;
+  }
+  if (writer->GetNumberOfWrittenFrames() != 0)
+  {
+    LOG_ERROR("Frame counter is not reset when the file is closed");
+    ++numberOfFailures;
+  }
+
+  // Read back the frame fields and a few images
+  vtkSmartPointer<vtkPlusMetaImageSequenceIO> reader = vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+  reader->SetLoadImageDataOnDemand(true);
+  reader->SetFileName(writtenFilePath);
+  if (reader->Read() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read " << writtenFilePath);
+    exit(EXIT_FAILURE);
+  }
+  if (reader->GetTrackedFrameList()->GetNumberOfTrackedFrames() != static_cast<unsigned int>(numberOfFrames))
+  {
+    LOG_ERROR("Number of frames in the written file is " << reader->GetTrackedFrameList()->GetNumberOfTrackedFrames() << ", expected " << numberOfFrames);
+    ++numberOfFailures;
+  }
+  else
+  {
+    const unsigned int framesToCheck[3] = {0, static_cast<unsigned int>(numberOfFrames / 2), static_cast<unsigned int>(numberOfFrames - 1)};
+    for (int i = 0; i < 3; ++i)
+    {
+      if (VerifyFrame(reader, framesToCheck[i], frameSize) != PLUS_SUCCESS)
+      {
+        ++numberOfFailures;
+      }
+    }
+  }
+  reader = NULL;
+
+  if (!keepOutputFile)
+  {
+    vtksys::SystemTools::RemoveFile(writtenFilePath.c_str());
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
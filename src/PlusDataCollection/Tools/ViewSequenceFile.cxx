@@ -21,6 +21,7 @@ See License.txt for details.
 #include "vtkRenderWindowInteractor.h"
 #include "vtkRenderer.h"
 #include "vtkRenderer.h"
+#include "vtkPlusMetaImageSequenceIO.h"
 #include "vtkPlusSequenceIO.h"
 #include "vtkSmartPointer.h"
 #include "vtkTextActor.h"
@@ -141,6 +142,7 @@ int main(int argc, char** argv)
   std::string outputModelFilename;
   std::string imageToReferenceTransformNameStr;
   bool renderingOff(false);
+  bool useIndexFile(false);
 
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
@@ -151,6 +153,7 @@ int main(int argc, char** argv)
   args.AddArgument("--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputSequenceFilename, "Tracked ultrasound recorded by Plus (e.g., by the TrackedUltrasoundCapturing application) in a sequence file (.mha/.nrrd)");
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Config file containing coordinate system definitions");
   args.AddArgument("--rendering-off", vtksys::CommandLineArguments::NO_ARGUMENT, &renderingOff, "Run in test mode, without rendering.");
+  args.AddArgument("--use-index-file", vtksys::CommandLineArguments::NO_ARGUMENT, &useIndexFile, "Read the sequence file header from a binary index file next to the sequence file (created if missing or out of date).");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
   args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
 
@@ -192,8 +195,23 @@ int main(int argc, char** argv)
   // Read input tracked ultrasound data.
   LOG_DEBUG("Reading input... ");
   vtkSmartPointer< vtkPlusTrackedFrameList > trackedFrameList = vtkSmartPointer< vtkPlusTrackedFrameList >::New();
+  // Images are copied into the actors anyway, so if possible then decode each frame only when its actor is created
+  vtkSmartPointer<vtkPlusMetaImageSequenceIO> onDemandReader;
+  if (vtkPlusMetaImageSequenceIO::CanReadFile(inputSequenceFilename))
+  {
+    onDemandReader = vtkSmartPointer<vtkPlusMetaImageSequenceIO>::New();
+    onDemandReader->SetFileName(inputSequenceFilename);
+    onDemandReader->SetTrackedFrameList(trackedFrameList);
+    onDemandReader->LoadImageDataOnDemandOn();
+    onDemandReader->SetUseHeaderIndexFile(useIndexFile);
+    if (onDemandReader->Read() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to load input sequences file.");
+      return EXIT_FAILURE;
+    }
+  }
   // Orientation is XX so that the orientation of the trackedFrameList will match the orientation defined in the file
-  if (vtkPlusSequenceIO::Read(inputSequenceFilename, trackedFrameList) != PLUS_SUCCESS)
+  else if (vtkPlusSequenceIO::Read(inputSequenceFilename, trackedFrameList) != PLUS_SUCCESS)
   {
     LOG_ERROR("Unable to load input sequences file.");
     return EXIT_FAILURE;
@@ -238,6 +256,7 @@ int main(int argc, char** argv)
     }
   }
 
+  PlusVideoFrame decodedFrame;
   int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
   for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
   {
@@ -252,7 +271,17 @@ int main(int argc, char** argv)
     }
 
     vtkSmartPointer<vtkImageData> frameImageData = vtkSmartPointer<vtkImageData>::New();
-    frameImageData->DeepCopy(frame->GetImageData()->GetImage());
+    if (onDemandReader.GetPointer() != NULL)
+    {
+      if (onDemandReader->ReadFrameImageData(frameIndex, decodedFrame) == PLUS_SUCCESS)
+      {
+        frameImageData->DeepCopy(decodedFrame.GetImage());
+      }
+    }
+    else
+    {
+      frameImageData->DeepCopy(frame->GetImageData()->GetImage());
+    }
 
     vtkSmartPointer<vtkImageActor> imageActor = vtkSmartPointer<vtkImageActor>::New();
     imageActor->SetInputData(frameImageData);
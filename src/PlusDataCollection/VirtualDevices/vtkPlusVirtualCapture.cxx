@@ -10,7 +10,7 @@ See License.txt for details.
 #include "vtkObjectFactory.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
-#include "vtkPlusSequenceIO.h"
+#include "vtkPlusStreamingSequenceWriter.h"
 #include "vtkPlusTrackedFrameList.h"
 #include "vtkPlusVirtualCapture.h"
 #include "vtksys/SystemTools.hxx"
@@ -41,10 +41,11 @@ vtkPlusVirtualCapture::vtkPlusVirtualCapture()
   , LastUpdateTime(0.0)
   , CurrentFilename("")
   , BaseFilename("TrackedImageSequence.nrrd")
-  , Writer(NULL)
+  , Writer(vtkPlusStreamingSequenceWriter::New())
   , EnableFileCompression(false)
-  , IsHeaderPrepared(false)
   , TotalFramesRecorded(0)
+  , NumberOfDroppedFrames(0)
+  , WriteQueueFull(false)
   , EnableCapturingOnStart(false)
   , EnableCapturing(false)
   , FrameBufferSize(DISABLE_FRAME_BUFFER)
@@ -63,7 +64,7 @@ vtkPlusVirtualCapture::vtkPlusVirtualCapture()
 //----------------------------------------------------------------------------
 vtkPlusVirtualCapture::~vtkPlusVirtualCapture()
 {
-  if (IsHeaderPrepared)
+  if (this->Writer->HasUnsavedData())
   {
     this->CloseFile();
   }
@@ -74,11 +75,8 @@ vtkPlusVirtualCapture::~vtkPlusVirtualCapture()
     this->RecordedFrames = NULL;
   }
 
-  if (Writer != NULL)
-  {
-    this->Writer->Delete();
-    this->Writer = NULL;
-  }
+  this->Writer->Delete();
+  this->Writer = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -126,6 +124,12 @@ PlusStatus vtkPlusVirtualCapture::WriteConfiguration(vtkXMLDataElement* rootConf
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualCapture::InternalConnect()
 {
+  if (this->IsFrameBuffered() && this->Writer->GetMaximumNumberOfQueuedFrames() <= this->FrameBufferSize)
+  {
+    // Frames are passed to the writer in batches of FrameBufferSize, make sure a full batch fits into the write queue
+    this->Writer->SetMaximumNumberOfQueuedFrames(this->FrameBufferSize + 1);
+  }
+
   if (OpenFile() != PLUS_SUCCESS)
   {
     return PLUS_FAIL;
@@ -146,25 +150,12 @@ PlusStatus vtkPlusVirtualCapture::InternalDisconnect()
 {
   this->EnableCapturing = false;
 
-  // If outstanding frames to be written, deal with them
-  if (this->RecordedFrames->GetNumberOfTrackedFrames() != 0 && this->IsHeaderPrepared)
-  {
-    if (this->Writer->AppendImagesToHeader() != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to append image data to header.");
-      this->Disconnect();
-      return PLUS_FAIL;
-    }
-    if (this->Writer->WriteImages() != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to append images. Stopping recording at timestamp: " << this->LastAlreadyRecordedFrameTimestamp);
-      this->Disconnect();
-      return PLUS_FAIL;
-    }
-
-    this->ClearRecordedFrames();
-  }
+  // Outstanding frames are written by CloseFile
   PlusStatus status = this->CloseFile();
+
+  // CloseFile opens a new file for the next recording, nothing is written into it while disconnected, so stop the writer thread
+  this->Writer->Discard();
+
   return status;
 }
 
@@ -203,11 +194,13 @@ PlusStatus vtkPlusVirtualCapture::OpenFile(const char* aFilename)
     this->CurrentFilename = aFilename;
   }
 
-  this->Writer = vtkPlusSequenceIO::CreateSequenceHandlerForFile(aFilename);
   this->Writer->SetUseCompression(this->EnableFileCompression);
-  this->Writer->SetTrackedFrameList(this->RecordedFrames);
   // Need to set the filename before finalizing header, because the pixel data file name depends on the file extension
-  this->Writer->SetFileName(vtkPlusConfig::GetInstance()->GetOutputPath(aFilename));
+  if (this->Writer->Open(vtkPlusConfig::GetInstance()->GetOutputPath(aFilename)) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to open file for writing: " << aFilename);
+    return PLUS_FAIL;
+  }
 
   return PLUS_SUCCESS;
 }
@@ -218,9 +211,12 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
   // Fix the header to write the correct number of frames
   PlusLockGuard<vtkPlusRecursiveCriticalSection> writerLock(this->WriterAccessMutex);
 
-  if (!this->IsHeaderPrepared)
+  // Write all outstanding frames (the header is prepared when the first frame is written)
+  this->WriteFrames(true);
+
+  if (!this->Writer->HasUnsavedData())
   {
-    // nothing has been prepared, so nothing to finalize
+    // nothing has been written, so nothing to finalize
     return PLUS_SUCCESS;
   }
 
@@ -231,23 +227,7 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
     this->CurrentFilename = aFilename;
   }
 
-  // Do we have any outstanding unwritten data?
-  if (this->RecordedFrames->GetNumberOfTrackedFrames() != 0)
-  {
-    this->WriteFrames(true);
-  }
-
-  this->Writer->UpdateDimensionsCustomStrings(this->TotalFramesRecorded, this->GetIsData3D());
-  this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionSizeString());
-  this->Writer->UpdateFieldInImageHeader(this->Writer->GetDimensionKindsString());
-  this->Writer->FinalizeHeader();
-
-  if (resultFilename != NULL)
-  {
-    (*resultFilename) = this->Writer->GetFileName();
-  }
-
-  this->Writer->Close();
+  PlusStatus status = this->Writer->Close(resultFilename);
 
   std::string fullPath = vtkPlusConfig::GetInstance()->GetOutputPath(this->CurrentFilename);
   std::string path = vtksys::SystemTools::GetFilenamePath(fullPath);
@@ -255,8 +235,8 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
   std::string configFileName = path + "/" + filename + "_config.xml";
   PlusCommon::XML::PrintXML(configFileName.c_str(), vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationData());
 
-  this->IsHeaderPrepared = false;
   this->TotalFramesRecorded = 0;
+  this->NumberOfDroppedFrames = 0;
   this->RecordedFrames->Clear();
 
   if (this->OpenFile() != PLUS_SUCCESS)
@@ -264,7 +244,7 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
     return PLUS_FAIL;
   }
 
-  return PLUS_SUCCESS;
+  return status;
 }
 
 //----------------------------------------------------------------------------
@@ -330,6 +310,36 @@ PlusStatus vtkPlusVirtualCapture::InternalUpdate()
     return PLUS_SUCCESS;
   }
 
+  if (this->Writer->IsQueueFull())
+  {
+    // Writing to disk cannot keep up with the acquisition. Do not get more frames now to keep the memory usage bounded:
+    // frames that are still in the input buffer at the next update are recorded then, older frames are skipped.
+    if (!this->WriteQueueFull)
+    {
+      // Only warn when the queue becomes full, not at every update while it stays full
+      LOG_WARNING("Write queue is full (" << this->Writer->GetNumberOfQueuedFrames() << " frames), recording is postponed. Frames that are removed from the input buffer meanwhile will be missing from the recording.");
+      this->WriteQueueFull = true;
+    }
+    this->LastUpdateTime = vtkPlusAccurateTimer::GetSystemTime();
+    return PLUS_SUCCESS;
+  }
+
+  if (this->WriteQueueFull)
+  {
+    // Recording is resumed: count the frames that were removed from the input buffer while the queue was full
+    this->WriteQueueFull = false;
+    double oldestInputTimestamp = 0.0;
+    if (this->NextFrameToBeRecordedTimestamp > 0.0
+        && this->GetOldestInputItemTimestamp(oldestInputTimestamp) == PLUS_SUCCESS
+        && oldestInputTimestamp > this->NextFrameToBeRecordedTimestamp)
+    {
+      long int droppedFrames = static_cast<long int>((oldestInputTimestamp - this->NextFrameToBeRecordedTimestamp) / requestedFramePeriodSec + 0.5);
+      this->NumberOfDroppedFrames += droppedFrames;
+      LOG_WARNING("Writing to disk could not keep up with the acquisition, approximately " << droppedFrames << " frames are missing from the recording ("
+                  << this->NumberOfDroppedFrames << " in total). Increase the input buffer size or decrease the requested frame rate to avoid this.");
+    }
+  }
+
   int nbFramesBefore = this->RecordedFrames->GetNumberOfTrackedFrames();
   if (this->GetInputTrackedFrameListSampled(this->LastAlreadyRecordedFrameTimestamp, this->NextFrameToBeRecordedTimestamp, this->RecordedFrames, requestedFramePeriodSec, maxProcessingTimeSec) != PLUS_SUCCESS)
   {
@@ -443,7 +453,7 @@ PlusStatus vtkPlusVirtualCapture::NotifyConfigured()
 //-----------------------------------------------------------------------------
 bool vtkPlusVirtualCapture::HasUnsavedData() const
 {
-  return this->IsHeaderPrepared;
+  return this->Writer->HasUnsavedData();
 }
 
 //-----------------------------------------------------------------------------
@@ -463,10 +473,7 @@ void vtkPlusVirtualCapture::InternalWriteOutputChannels(vtkXMLDataElement* rootX
 //----------------------------------------------------------------------------
 void vtkPlusVirtualCapture::SetEnableFileCompression(bool aFileCompression)
 {
-  if (this->Writer != NULL)
-  {
-    this->Writer->SetUseCompression(aFileCompression);
-  }
+  this->Writer->SetUseCompression(aFileCompression);
 
   this->EnableFileCompression = aFileCompression;
 }
@@ -482,6 +489,7 @@ void vtkPlusVirtualCapture::SetEnableCapturing(bool aValue)
     this->TimeWaited = 0.0;
     this->LastAlreadyRecordedFrameTimestamp = UNDEFINED_TIMESTAMP;
     this->NextFrameToBeRecordedTimestamp = 0.0;
+    this->WriteQueueFull = false;
     this->FirstFrameIndexInThisSegment = this->RecordedFrames->GetNumberOfTrackedFrames();
     this->RecordingStartTime = vtkPlusAccurateTimer::GetSystemTime(); // reset the starting time for the grace period
   }
@@ -495,15 +503,10 @@ PlusStatus vtkPlusVirtualCapture::Reset()
 
     this->SetEnableCapturing(false);
 
-    if (this->IsHeaderPrepared)
-    {
-      this->Writer->Discard();
-    }
-
     this->ClearRecordedFrames();
-    this->Writer->GetTrackedFrameList()->Clear();
-    this->IsHeaderPrepared = false;
+    this->Writer->Discard();
     this->TotalFramesRecorded = 0;
+    this->NumberOfDroppedFrames = 0;
   }
 
   if (this->OpenFile() != PLUS_SUCCESS)
@@ -591,41 +594,27 @@ PlusStatus vtkPlusVirtualCapture::TakeSnapshot()
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualCapture::WriteFrames(bool force)
 {
-  if (!this->IsHeaderPrepared && this->RecordedFrames->GetNumberOfTrackedFrames() != 0)
-  {
-    if (this->Writer->PrepareHeader() != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to prepare header");
-      this->StopRecording();
-      return PLUS_FAIL;
-    }
-    this->IsHeaderPrepared = true;
-  }
-
-  if (this->RecordedFrames->GetNumberOfTrackedFrames() == 0)
+  if (this->RecordedFrames->GetNumberOfTrackedFrames() != 0)
   {
-    return PLUS_SUCCESS;
+    this->SetIsData3D(this->RecordedFrames->GetTrackedFrame(0)->GetFrameSize()[2] > 1);
   }
 
-  this->SetIsData3D(this->RecordedFrames->GetTrackedFrame(0)->GetFrameSize()[2] > 1);
-
-  if (force || !this->IsFrameBuffered() ||
-      (this->IsFrameBuffered() && this->RecordedFrames->GetNumberOfTrackedFrames() > this->GetFrameBufferSize()))
+  if (this->RecordedFrames->GetNumberOfTrackedFrames() != 0 && (force || !this->IsFrameBuffered() ||
+      (this->IsFrameBuffered() && this->RecordedFrames->GetNumberOfTrackedFrames() > this->GetFrameBufferSize())))
   {
-    if (this->Writer->AppendImagesToHeader() != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to append image data to header.");
-      this->StopRecording();
-      return PLUS_FAIL;
-    }
-    if (this->Writer->WriteImages() != PLUS_SUCCESS)
+    // The frames are moved to the queue of the writer thread, so this thread is not blocked while they are written to disk
+    if (this->Writer->AppendFrames(this->RecordedFrames) != PLUS_SUCCESS)
     {
       LOG_ERROR("Unable to append images. Stopping recording at timestamp: " << LastAlreadyRecordedFrameTimestamp);
-      this->StopRecording();
+      this->SetEnableCapturing(false);
       return PLUS_FAIL;
     }
+  }
 
-    this->ClearRecordedFrames();
+  if (force && this->Writer->Flush() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to write recorded frames to " << this->Writer->GetFileName());
+    return PLUS_FAIL;
   }
 
   return PLUS_SUCCESS;
@@ -673,3 +662,14 @@ PlusStatus vtkPlusVirtualCapture::GetLatestInputItemTimestamp(double& timestamp)
   }
   return this->OutputChannels[0]->GetLatestTimestamp(timestamp);
 }
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualCapture::GetOldestInputItemTimestamp(double& timestamp)
+{
+  if (this->OutputChannels.empty())
+  {
+    LOG_ERROR("No output channels defined");
+    return PLUS_FAIL;
+  }
+  return this->OutputChannels[0]->GetOldestTimestamp(timestamp);
+}
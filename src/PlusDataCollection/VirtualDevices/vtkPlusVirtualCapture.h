@@ -9,9 +9,9 @@ See License.txt for details.
 
 #include "vtkPlusDataCollectionExport.h"
 #include "vtkPlusDevice.h"
-#include "vtkPlusSequenceIOBase.h"
 #include <string>
 
+class vtkPlusStreamingSequenceWriter;
 class vtkPlusTrackedFrameList;
 
 /*!
@@ -69,6 +69,8 @@ public:
 
   vtkGetMacro(ActualFrameRate, double);
   vtkGetMacro(TotalFramesRecorded, long int);
+  /*! Approximate number of frames that are missing from the current recording because writing to disk could not keep up */
+  vtkGetMacro(NumberOfDroppedFrames, long int);
 
   vtkGetMacro(BaseFilename, std::string);
   vtkSetMacro(BaseFilename, std::string);
@@ -105,8 +107,8 @@ protected:
   virtual bool IsFrameBuffered() const;
 
   /*!
-    Copy frames to memory buffer or disk.
-    If force flag is true then data is written to disk immediately.
+    Pass the recorded frames to the writer thread (if the frame buffer is full or frame buffering is disabled).
+    If force flag is true then all frames are passed and the function returns when they are written to disk.
   */
   virtual PlusStatus WriteFrames(bool force = false);
 
@@ -146,18 +148,21 @@ protected:
   std::string CurrentFilename;
   std::string BaseFilename;
 
-  /*! Sequence writer to write to */
-  vtkPlusSequenceIOBase* Writer;
+  /*! Sequence writer that writes the recorded frames to disk in a separate thread */
+  vtkPlusStreamingSequenceWriter* Writer;
 
   /*! When closing the file, re-read the data from file, and write it compressed */
   bool EnableFileCompression;
 
-  /*! Preparing the header requires image data already collected, this flag makes the header preparation wait until valid data is collected */
-  bool IsHeaderPrepared;
-
   /*! Record the number of frames captured */
   long int TotalFramesRecorded;  // hard drive will probably fill up before a regular int is hit, but still...
 
+  /*! Number of frames that were removed from the input buffer while the write queue was full */
+  long int NumberOfDroppedFrames;
+
+  /*! Internal flag that is set while recording is postponed because the write queue is full */
+  bool WriteQueueFull;
+
   /*! Whether to start capturing on connect */
   bool EnableCapturingOnStart;
 
@@ -176,6 +181,7 @@ protected:
   PlusStatus GetInputTrackedFrame(PlusTrackedFrame& aFrame);
   PlusStatus GetInputTrackedFrameListSampled(double& lastAlreadyRecordedFrameTimestamp, double& nextFrameToBeRecordedTimestamp, vtkPlusTrackedFrameList* recordedFrames, double requestedFramePeriodSec, double maxProcessingTimeSec);
   PlusStatus GetLatestInputItemTimestamp(double& timestamp);
+  PlusStatus GetOldestInputItemTimestamp(double& timestamp);
 
 private:
   vtkPlusVirtualCapture(const vtkPlusVirtualCapture&);   // Not implemented.
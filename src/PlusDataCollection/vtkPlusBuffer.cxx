@@ -78,6 +78,7 @@ vtkPlusBuffer::vtkPlusBuffer()
   , StreamBuffer(vtkPlusTimestampedCircularBuffer::New())
   , MaxAllowedTimeDifference(0.5)
   , DescriptiveName(NULL)
+  , NewItemNotifiersMutex(vtkSmartPointer<vtkPlusRecursiveCriticalSection>::New())
 {
   this->FrameSize[0] = 0;
   this->FrameSize[1] = 0;
@@ -328,6 +329,7 @@ PlusStatus vtkPlusBuffer::AddItem(const PlusTrackedFrame::FieldMapType& fields,
   if (newObjectInBuffer == NULL)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to data buffer object from the tracker buffer for the new frame!");
+    this->StreamBuffer->CancelNewItem(bufferIndex);
     return PLUS_FAIL;
   }
 
@@ -343,6 +345,9 @@ PlusStatus vtkPlusBuffer::AddItem(const PlusTrackedFrame::FieldMapType& fields,
     std::string name(it->first);
   }
 
+  this->StreamBuffer->CommitNewItem(bufferIndex);
+  this->NotifyNewItem();
+
   return PLUS_SUCCESS;
 }
 
@@ -439,6 +444,7 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
   if (newObjectInBuffer == NULL)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to video buffer object from the video buffer for the new frame!");
+    this->StreamBuffer->CancelNewItem(bufferIndex);
     return PLUS_FAIL;
   }
 
@@ -453,6 +459,7 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
                     outputFrameSizeInPx[0] << "x" << outputFrameSizeInPx[1] << "x" << outputFrameSizeInPx[2] <<
                     ",   buffer: " <<
                     receivedFrameSize[0] << "x" << receivedFrameSize[1] << "x" << receivedFrameSize[2] << ")!");
+    this->StreamBuffer->CancelNewItem(bufferIndex);
     return PLUS_FAIL;
   }
 
@@ -463,6 +470,7 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
   if (PlusVideoFrame::GetOrientedClippedImage(byteImageDataPtr, flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, newObjectInBuffer->GetFrame(), clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
   {
     LOCAL_LOG_ERROR("Failed to convert input US image to the requested orientation!");
+    this->StreamBuffer->CancelNewItem(bufferIndex);
     return PLUS_FAIL;
   }
 
@@ -473,22 +481,217 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
   newObjectInBuffer->GetFrame().SetImageType(imageType);
 
   // Add custom fields
-  if (customFields != NULL)
+  this->SetItemCustomFields(newObjectInBuffer, customFields);
+
+  this->StreamBuffer->CommitNewItem(bufferIndex);
+  this->NotifyNewItem();
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::ReserveItem(US_IMAGE_ORIENTATION usImageOrientation,
+                                      const unsigned int inputFrameSizeInPx[3],
+                                      PlusCommon::VTKScalarPixelType pixelType,
+                                      unsigned int numberOfScalarComponents,
+                                      US_IMAGE_TYPE imageType,
+                                      long frameNumber,
+                                      const int clipRectangleOrigin[3],
+                                      const int clipRectangleSize[3],
+                                      PlusVideoFrame*& frame,
+                                      double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
+                                      double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/)
+{
+  frame = NULL;
+  if (this->Reservation.Active)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to reserve item, the previously reserved item has not been committed or cancelled yet");
+    return PLUS_FAIL;
+  }
+
+  if (unfilteredTimestamp == UNDEFINED_TIMESTAMP)
+  {
+    unfilteredTimestamp = vtkPlusAccurateTimer::GetSystemTime();
+  }
+
+  PlusVideoFrame::FlipInfoType flipInfo;
+  if (PlusVideoFrame::GetFlipAxes(usImageOrientation, imageType, this->ImageOrientation, flipInfo) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to convert image data to the requested orientation, from " << PlusVideoFrame::GetStringFromUsImageOrientation(usImageOrientation) <<
+              " to " << PlusVideoFrame::GetStringFromUsImageOrientation(this->ImageOrientation));
+    return PLUS_FAIL;
+  }
+
+  ItemReservation reservation;
+  reservation.FrameNumber = frameNumber;
+  reservation.UnfilteredTimestamp = unfilteredTimestamp;
+  reservation.FilteredTimestamp = filteredTimestamp;
+  reservation.ImageType = imageType;
+  reservation.InputOrientation = usImageOrientation;
+  reservation.PixelType = pixelType;
+  reservation.NumberOfScalarComponents = numberOfScalarComponents;
+  for (int i = 0; i < 3; ++i)
+  {
+    reservation.InputFrameSize[i] = inputFrameSizeInPx[i];
+    reservation.ClipRectangleOrigin[i] = (clipRectangleOrigin != NULL ? clipRectangleOrigin[i] : PlusCommon::NO_CLIP);
+    reservation.ClipRectangleSize[i] = (clipRectangleSize != NULL ? clipRectangleSize[i] : PlusCommon::NO_CLIP);
+  }
+
+  if (flipInfo.hFlip || flipInfo.vFlip || flipInfo.eFlip || flipInfo.tranpose != PlusVideoFrame::TRANSPOSE_NONE
+      || PlusCommon::IsClippingRequested(reservation.ClipRectangleOrigin, reservation.ClipRectangleSize))
   {
-    for (PlusTrackedFrame::FieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
+    // The frame has to be converted, so the caller fills a staging frame that is added by AddItem on commit
+    if (this->ReservationStagingFrame.AllocateFrame(inputFrameSizeInPx, pixelType, numberOfScalarComponents) != PLUS_SUCCESS)
     {
-      newObjectInBuffer->SetCustomFrameField(it->first, it->second);
-      std::string name(it->first);
-      if (name.find("Transform") != std::string::npos)
-      {
-        newObjectInBuffer->SetValidTransformData(true);
-      }
+      LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to allocate staging frame for the reserved item");
+      return PLUS_FAIL;
     }
+    reservation.Direct = false;
+    reservation.Active = true;
+    this->Reservation = reservation;
+    frame = &this->ReservationStagingFrame;
+    return PLUS_SUCCESS;
   }
 
+  if (filteredTimestamp == UNDEFINED_TIMESTAMP)
+  {
+    bool filteredTimestampProbablyValid = true;
+    if (this->StreamBuffer->CreateFilteredTimeStampForItem(frameNumber, unfilteredTimestamp, filteredTimestamp, filteredTimestampProbablyValid) != PLUS_SUCCESS)
+    {
+      LOCAL_LOG_WARNING("Failed to create filtered timestamp for video buffer item with item index: " << frameNumber);
+      return PLUS_FAIL;
+    }
+    if (!filteredTimestampProbablyValid)
+    {
+      LOG_INFO("Filtered timestamp is probably invalid for video buffer item with item index=" << frameNumber << ", time=" <<
+               unfilteredTimestamp << ". The item may have been tagged with an inaccurate timestamp, therefore it will not be recorded.");
+      return PLUS_SUCCESS;
+    }
+    reservation.FilteredTimestamp = filteredTimestamp;
+  }
+  else
+  {
+    this->StreamBuffer->AddToTimeStampReport(frameNumber, unfilteredTimestamp, filteredTimestamp);
+  }
+
+  if (!this->CheckFrameFormat(inputFrameSizeInPx, pixelType, imageType, numberOfScalarComponents))
+  {
+    LOG_ERROR("vtkPlusBuffer: Unable to reserve frame in video buffer - frame format doesn't match!");
+    return PLUS_FAIL;
+  }
+
+  // The buffer remains locked until the item is committed or cancelled
+  this->StreamBuffer->Lock();
+  if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, reservation.Uid, reservation.BufferIndex) != PLUS_SUCCESS)
+  {
+    this->StreamBuffer->Unlock();
+    // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
+    LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to video buffer!");
+    return PLUS_FAIL;
+  }
+
+  StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(reservation.BufferIndex);
+  unsigned int bufferFrameSize[3] = { 0, 0, 0 };
+  if (newObjectInBuffer != NULL)
+  {
+    newObjectInBuffer->GetFrame().GetFrameSize(bufferFrameSize);
+  }
+  if (newObjectInBuffer == NULL
+      || bufferFrameSize[0] != inputFrameSizeInPx[0]
+      || bufferFrameSize[1] != inputFrameSizeInPx[1]
+      || bufferFrameSize[2] != inputFrameSizeInPx[2])
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to reserve item, input frame size (" << inputFrameSizeInPx[0] << "x" << inputFrameSizeInPx[1] << "x" << inputFrameSizeInPx[2]
+                    << ") is different from buffer frame size (" << bufferFrameSize[0] << "x" << bufferFrameSize[1] << "x" << bufferFrameSize[2] << ")!");
+    this->StreamBuffer->CancelNewItem(reservation.BufferIndex);
+    this->StreamBuffer->Unlock();
+    return PLUS_FAIL;
+  }
+
+  // Readers may still reference the pixel data of this item, in that case new pixel data is allocated for the item
+  if (newObjectInBuffer->GetFrame().AllocateFrame(inputFrameSizeInPx, pixelType, numberOfScalarComponents) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to allocate pixel data for the reserved item");
+    this->StreamBuffer->CancelNewItem(reservation.BufferIndex);
+    this->StreamBuffer->Unlock();
+    return PLUS_FAIL;
+  }
+
+  reservation.Direct = true;
+  reservation.Active = true;
+  this->Reservation = reservation;
+  frame = &newObjectInBuffer->GetFrame();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::CommitReservedItem(const PlusTrackedFrame::FieldMapType* customFields /*= NULL*/)
+{
+  if (!this->Reservation.Active)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to commit item, no item has been reserved");
+    return PLUS_FAIL;
+  }
+  this->Reservation.Active = false;
+
+  if (!this->Reservation.Direct)
+  {
+    // Reorient and clip the staging frame into the buffer
+    return this->AddItem(this->ReservationStagingFrame.GetScalarPointer(), this->Reservation.InputOrientation, this->Reservation.InputFrameSize,
+                         this->Reservation.PixelType, this->Reservation.NumberOfScalarComponents, this->Reservation.ImageType, 0, this->Reservation.FrameNumber,
+                         this->Reservation.ClipRectangleOrigin, this->Reservation.ClipRectangleSize, this->Reservation.UnfilteredTimestamp,
+                         this->Reservation.FilteredTimestamp, customFields);
+  }
+
+  // The stream buffer has been locked since the item was reserved
+  StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(this->Reservation.BufferIndex);
+  newObjectInBuffer->SetFilteredTimestamp(this->Reservation.FilteredTimestamp);
+  newObjectInBuffer->SetUnfilteredTimestamp(this->Reservation.UnfilteredTimestamp);
+  newObjectInBuffer->SetIndex(this->Reservation.FrameNumber);
+  newObjectInBuffer->SetUid(this->Reservation.Uid);
+  newObjectInBuffer->GetFrame().SetImageType(this->Reservation.ImageType);
+  newObjectInBuffer->GetFrame().GetImage()->Modified();
+  this->SetItemCustomFields(newObjectInBuffer, customFields);
+
+  this->StreamBuffer->CommitNewItem(this->Reservation.BufferIndex);
+  this->StreamBuffer->Unlock();
+  this->NotifyNewItem();
+
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::CancelReservedItem()
+{
+  if (!this->Reservation.Active)
+  {
+    return;
+  }
+  this->Reservation.Active = false;
+  if (this->Reservation.Direct)
+  {
+    this->StreamBuffer->CancelNewItem(this->Reservation.BufferIndex);
+    this->StreamBuffer->Unlock();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetItemCustomFields(StreamBufferItem* item, const PlusTrackedFrame::FieldMapType* customFields)
+{
+  if (customFields == NULL)
+  {
+    return;
+  }
+  for (PlusTrackedFrame::FieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
+  {
+    item->SetCustomFrameField(it->first, it->second);
+    if (it->first.find("Transform") != std::string::npos)
+    {
+      item->SetValidTransformData(true);
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/, const PlusTrackedFrame::FieldMapType* customFields /*= NULL*/)
 {
@@ -536,6 +739,7 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
   if (newObjectInBuffer == NULL)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to data buffer object from the tracker buffer for the new frame!");
+    this->StreamBuffer->CancelNewItem(bufferIndex);
     return PLUS_FAIL;
   }
 
@@ -547,18 +751,10 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
   newObjectInBuffer->SetUid(itemUid);
 
   // Add custom fields
-  if (customFields != NULL)
-  {
-    for (PlusTrackedFrame::FieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
-    {
-      newObjectInBuffer->SetCustomFrameField(it->first, it->second);
-      std::string name(it->first);
-      if (name.find("Transform") != std::string::npos)
-      {
-        newObjectInBuffer->SetValidTransformData(true);
-      }
-    }
-  }
+  this->SetItemCustomFields(newObjectInBuffer, customFields);
+
+  this->StreamBuffer->CommitNewItem(bufferIndex);
+  this->NotifyNewItem();
 
   return itemStatus;
 }
@@ -624,6 +820,60 @@ PlusStatus vtkPlusBuffer::GetTimeStampReportTable(vtkTable* timeStampReportTable
   return this->StreamBuffer->GetTimeStampReportTable(timeStampReportTable);
 }
 
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetStreamBufferItemMetadata(BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  if (bufferItem == NULL)
+  {
+    LOCAL_LOG_ERROR("Unable to copy data buffer item into a NULL data buffer item!");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  StreamBufferItem* dataItem = NULL;
+  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
+  if (itemStatus != ITEM_OK)
+  {
+    LOCAL_LOG_WARNING("Failed to retrieve data item");
+    return itemStatus;
+  }
+
+  bufferItem->SetFilteredTimestamp(dataItem->GetFilteredTimestamp(0));
+  bufferItem->SetUnfilteredTimestamp(dataItem->GetUnfilteredTimestamp(0));
+  bufferItem->SetIndex(dataItem->GetIndex());
+  bufferItem->SetUid(dataItem->GetUid());
+  bufferItem->SetStatus(dataItem->GetStatus());
+  bufferItem->GetCustomFrameFields() = dataItem->GetCustomFrameFields();
+  if (dataItem->HasValidTransformData())
+  {
+    double matrix[16];
+    dataItem->GetMatrix(matrix);
+    bufferItem->SetMatrix(matrix);
+  }
+  bufferItem->SetValidTransformData(dataItem->HasValidTransformData());
+
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::CopyItemFrame(BufferItemUidType uid, PlusVideoFrame& frame)
+{
+  PlusLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  StreamBufferItem* dataItem = NULL;
+  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
+  if (itemStatus != ITEM_OK)
+  {
+    LOCAL_LOG_WARNING("Failed to retrieve data item");
+    return itemStatus;
+  }
+
+  // PlusVideoFrame assignment reuses the memory of the destination frame if the format is the same
+  frame = dataItem->GetFrame();
+  return ITEM_OK;
+}
+
 //----------------------------------------------------------------------------
 ItemStatus vtkPlusBuffer::GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem)
 {
@@ -643,7 +893,8 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItem(BufferItemUidType uid, StreamBuffe
     return itemStatus;
   }
 
-  if (bufferItem->DeepCopy(dataItem) != PLUS_SUCCESS)
+  // Only the reference count of the pixel data is incremented, the buffer allocates new pixel data for the item if it is overwritten while still in use
+  if (bufferItem->ShallowCopy(dataItem) != PLUS_SUCCESS)
   {
     LOCAL_LOG_WARNING("Failed to copy data item");
     return ITEM_UNKNOWN_ERROR;
@@ -812,8 +1063,8 @@ PlusStatus vtkPlusBuffer::CopyImagesFromTrackedFrameList(vtkPlusTrackedFrameList
     if (copyCustomFrameFields)
     {
       // Copy all custom fields
-      StreamBufferItem::FieldMapType sourceCustomFields = sourceTrackedFrameList->GetTrackedFrame(frameNumber)->GetCustomFields();
-      StreamBufferItem::FieldMapType::iterator fieldIterator;
+      const StreamBufferItem::FieldMapType& sourceCustomFields = sourceTrackedFrameList->GetTrackedFrame(frameNumber)->GetCustomFields();
+      StreamBufferItem::FieldMapType::const_iterator fieldIterator;
       for (fieldIterator = sourceCustomFields.begin(); fieldIterator != sourceCustomFields.end(); fieldIterator++)
       {
         // skip special fields
@@ -1516,6 +1767,61 @@ bool vtkPlusBuffer::GetLatestItemHasValidFieldData()
   return this->StreamBuffer->GetLatestItemHasValidFieldData();
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetLockFreeReading(bool enable)
+{
+  this->StreamBuffer->SetLockFreeReading(enable);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusBuffer::GetLockFreeReading()
+{
+  return this->StreamBuffer->GetLockFreeReading();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::AddNewItemNotifier(vtkPlusNewDataNotifier* notifier)
+{
+  if (notifier == NULL)
+  {
+    return;
+  }
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> notifiersGuardedLock(this->NewItemNotifiersMutex);
+  for (std::vector< vtkSmartPointer<vtkPlusNewDataNotifier> >::iterator it = this->NewItemNotifiers.begin(); it != this->NewItemNotifiers.end(); ++it)
+  {
+    if (it->GetPointer() == notifier)
+    {
+      // already registered
+      return;
+    }
+  }
+  this->NewItemNotifiers.push_back(notifier);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::RemoveNewItemNotifier(vtkPlusNewDataNotifier* notifier)
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> notifiersGuardedLock(this->NewItemNotifiersMutex);
+  for (std::vector< vtkSmartPointer<vtkPlusNewDataNotifier> >::iterator it = this->NewItemNotifiers.begin(); it != this->NewItemNotifiers.end(); ++it)
+  {
+    if (it->GetPointer() == notifier)
+    {
+      this->NewItemNotifiers.erase(it);
+      return;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::NotifyNewItem()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> notifiersGuardedLock(this->NewItemNotifiersMutex);
+  for (std::vector< vtkSmartPointer<vtkPlusNewDataNotifier> >::iterator it = this->NewItemNotifiers.begin(); it != this->NewItemNotifiers.end(); ++it)
+  {
+    (*it)->Notify();
+  }
+}
+
 #undef LOCAL_LOG_ERROR
 #undef LOCAL_LOG_WARNING
 #undef LOCAL_LOG_DEBUG
\ No newline at end of file
@@ -20,8 +20,12 @@ See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
 #include "PlusStreamBufferItem.h"
 #include "PlusTrackedFrame.h"
 #include "vtkObject.h"
+#include "vtkPlusNewDataNotifier.h"
+#include "vtkPlusRecursiveCriticalSection.h"
 #include "vtkPlusTimestampedCircularBuffer.h"
 
+#include <vector>
+
 class vtkPlusDevice;
 enum ToolStatus;
 
@@ -134,6 +138,36 @@ public:
                              double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
                              double filteredTimestamp = UNDEFINED_TIMESTAMP);
 
+  /*!
+    Reserve the next item of the buffer, so that the caller can write the frame pixels directly into the buffer
+    instead of passing a frame that is then copied by AddItem.
+    If the input frame orientation matches the buffer orientation and no clipping is requested then the returned frame
+    is the preallocated frame of the next buffer item and the buffer remains locked until CommitReservedItem or
+    CancelReservedItem is called, so the caller must fill the frame quickly (e.g., by copying it from memory).
+    Readers of the buffer are blocked while the item is reserved, therefore devices that have to wait for or decode
+    the frame should do that into their own frame and add it by AddItem instead.
+    If the frame has to be reoriented or clipped then the returned frame is a staging frame of the input frame size and
+    it is converted into the buffer when CommitReservedItem is called.
+    If ReserveItem succeeds and frame is not NULL then either CommitReservedItem or CancelReservedItem must be called.
+    If the item must not be recorded (e.g., because its timestamp is probably invalid) then frame is set to NULL and PLUS_SUCCESS is returned.
+    Only one item can be reserved at a time.
+  */
+  virtual PlusStatus ReserveItem(US_IMAGE_ORIENTATION usImageOrientation,
+                                 const unsigned int inputFrameSizeInPx[3],
+                                 PlusCommon::VTKScalarPixelType pixelType,
+                                 unsigned int numberOfScalarComponents,
+                                 US_IMAGE_TYPE imageType,
+                                 long frameNumber,
+                                 const int clipRectangleOrigin[3],
+                                 const int clipRectangleSize[3],
+                                 PlusVideoFrame*& frame,
+                                 double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                                 double filteredTimestamp = UNDEFINED_TIMESTAMP);
+  /*! Add the item that was reserved by ReserveItem (and filled by the caller) to the buffer */
+  virtual PlusStatus CommitReservedItem(const PlusTrackedFrame::FieldMapType* customFields = NULL);
+  /*! Release the item that was reserved by ReserveItem without adding it to the buffer */
+  virtual void CancelReservedItem();
+
   /*!
     Add a matrix plus status to the list, with an exactly known timestamp value (e.g., provided by a high-precision hardware timer).
     If the timestamp is less than or equal to the previous timestamp, then nothing  will be done.
@@ -141,8 +175,19 @@ public:
   */
   PlusStatus AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp = UNDEFINED_TIMESTAMP, const PlusTrackedFrame::FieldMapType* customFields = NULL);
 
-  /*! Get a frame with the specified frame uid from the buffer */
+  /*!
+    Get a frame with the specified frame uid from the buffer.
+    The pixel data is shared with the buffer, it is not copied. The buffer allocates new pixel data for the item
+    when it is overwritten while the returned item still references it, so the returned pixels never change.
+  */
   virtual ItemStatus GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem);
+  /*! Get timestamps, index, status, transform and custom fields of an item, without copying the frame pixels */
+  virtual ItemStatus GetStreamBufferItemMetadata(BufferItemUidType uid, StreamBufferItem* bufferItem);
+  /*!
+    Copy the frame pixels of an item into the provided frame, reusing its memory if it is already allocated with the same format.
+    It allows copying the frame directly into a frame reserved in another buffer by ReserveItem.
+  */
+  virtual ItemStatus CopyItemFrame(BufferItemUidType uid, PlusVideoFrame& frame);
   /*! Get the most recent frame from the buffer */
   virtual ItemStatus GetLatestStreamBufferItem(StreamBufferItem* bufferItem)
   {
@@ -308,6 +353,22 @@ public:
   vtkGetStringMacro(DescriptiveName);
   vtkSetStringMacro(DescriptiveName);
 
+  /*!
+    Enable lock-free reading of item UIDs, timestamps and indexes, so that readers never delay the thread that adds new items.
+    See vtkPlusTimestampedCircularBuffer::SetLockFreeReading for details. Must be set before data acquisition is started.
+  */
+  virtual void SetLockFreeReading(bool enable);
+  virtual bool GetLockFreeReading();
+
+  /*!
+    Register a notifier that is notified each time a new item is added to the buffer.
+    The notification is sent right after the item is committed, so a waiting consumer can retrieve it immediately.
+    The buffer keeps a reference to the notifier until it is removed. Can be called from any thread.
+  */
+  virtual void AddNewItemNotifier(vtkPlusNewDataNotifier* notifier);
+  /*! Unregister a notifier that was added by AddNewItemNotifier. Can be called from any thread. */
+  virtual void RemoveNewItemNotifier(vtkPlusNewDataNotifier* notifier);
+
 protected:
   vtkPlusBuffer();
   ~vtkPlusBuffer();
@@ -337,6 +398,12 @@ protected:
   /*! Get tracker buffer item from the closest timestamp */
   virtual ItemStatus GetStreamBufferItemFromClosestTime(double time, StreamBufferItem* bufferItem);
 
+  /*! Notify all registered notifiers that a new item has been added */
+  void NotifyNewItem();
+
+  /*! Store the custom fields in the buffer item. Transform fields mark the item as having valid transform data. */
+  void SetItemCustomFields(StreamBufferItem* item, const PlusTrackedFrame::FieldMapType* customFields);
+
 protected:
   /*! Image frame size in pixel */
   unsigned int FrameSize[3];
@@ -362,6 +429,36 @@ protected:
 
   char* DescriptiveName;
 
+  /*! Notifiers that are signaled when a new item is added */
+  std::vector< vtkSmartPointer<vtkPlusNewDataNotifier> > NewItemNotifiers;
+  vtkSmartPointer<vtkPlusRecursiveCriticalSection> NewItemNotifiersMutex;
+
+  /*! Item reserved by ReserveItem */
+  struct ItemReservation
+  {
+    ItemReservation() : Active(false), Direct(false), BufferIndex(-1), Uid(0), FrameNumber(0), UnfilteredTimestamp(UNDEFINED_TIMESTAMP), FilteredTimestamp(UNDEFINED_TIMESTAMP),
+      ImageType(US_IMG_TYPE_XX), InputOrientation(US_IMG_ORIENT_XX), PixelType(VTK_VOID), NumberOfScalarComponents(0) {}
+    /*! True between ReserveItem and CommitReservedItem/CancelReservedItem */
+    bool Active;
+    /*! True if the caller writes directly into the buffer item (the stream buffer is locked), false if the staging frame is used */
+    bool Direct;
+    int BufferIndex;
+    BufferItemUidType Uid;
+    long FrameNumber;
+    double UnfilteredTimestamp;
+    double FilteredTimestamp;
+    US_IMAGE_TYPE ImageType;
+    US_IMAGE_ORIENTATION InputOrientation;
+    unsigned int InputFrameSize[3];
+    PlusCommon::VTKScalarPixelType PixelType;
+    unsigned int NumberOfScalarComponents;
+    int ClipRectangleOrigin[3];
+    int ClipRectangleSize[3];
+  };
+  ItemReservation Reservation;
+  /*! Frame that the caller fills if the reserved item has to be reoriented or clipped */
+  PlusVideoFrame ReservationStagingFrame;
+
 private:
   vtkPlusBuffer(const vtkPlusBuffer&);
   void operator=(const vtkPlusBuffer&);
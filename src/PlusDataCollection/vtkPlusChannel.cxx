@@ -390,6 +390,40 @@ PlusStatus vtkPlusChannel::RemoveFieldDataSources()
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusChannel::AddNewItemNotifier(vtkPlusNewDataNotifier* notifier)
+{
+  if (this->VideoSource != NULL)
+  {
+    this->VideoSource->GetBuffer()->AddNewItemNotifier(notifier);
+  }
+  for (DataSourceContainerIterator it = this->Tools.begin(); it != this->Tools.end(); ++it)
+  {
+    it->second->GetBuffer()->AddNewItemNotifier(notifier);
+  }
+  for (DataSourceContainerIterator it = this->FieldDataSources.begin(); it != this->FieldDataSources.end(); ++it)
+  {
+    it->second->GetBuffer()->AddNewItemNotifier(notifier);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::RemoveNewItemNotifier(vtkPlusNewDataNotifier* notifier)
+{
+  if (this->VideoSource != NULL)
+  {
+    this->VideoSource->GetBuffer()->RemoveNewItemNotifier(notifier);
+  }
+  for (DataSourceContainerIterator it = this->Tools.begin(); it != this->Tools.end(); ++it)
+  {
+    it->second->GetBuffer()->RemoveNewItemNotifier(notifier);
+  }
+  for (DataSourceContainerIterator it = this->FieldDataSources.begin(); it != this->FieldDataSources.end(); ++it)
+  {
+    it->second->GetBuffer()->RemoveNewItemNotifier(notifier);
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::Clear()
 {
@@ -546,17 +580,11 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
       return PLUS_FAIL;
     }
 
-    // Copy frame
-    PlusVideoFrame frame = CurrentStreamBufferItem.GetFrame();
-    aTrackedFrame.SetImageData(frame);
+    // Reference the pixel data of the buffer item, it is not modified by the buffer while the tracked frame uses it
+    aTrackedFrame.GetImageData()->ShallowCopy(&CurrentStreamBufferItem.GetFrame());
 
     // Copy all custom fields
-    StreamBufferItem::FieldMapType fieldMap = CurrentStreamBufferItem.GetCustomFrameFieldMap();
-    StreamBufferItem::FieldMapType::iterator fieldIterator;
-    for (fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
-    {
-      aTrackedFrame.SetCustomFrameField((*fieldIterator).first, (*fieldIterator).second);
-    }
+    aTrackedFrame.SetCustomFrameFields(CurrentStreamBufferItem.GetCustomFrameFields());
 
     synchronizedTimestamp = CurrentStreamBufferItem.GetTimestamp(this->VideoSource->GetLocalTimeOffsetSec());
   }
@@ -572,8 +600,9 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
   for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it)
   {
     vtkPlusDataSource* aTool = it->second;
-    PlusTransformName toolTransformName(aTool->GetId());
-    if (!toolTransformName.IsValid())
+    // The tool transform name is only parsed the first time it is used
+    PlusFieldId toolTransformFieldId = PlusFieldNameTable::GetTransformFieldId(aTool->GetId());
+    if (toolTransformFieldId == PlusFieldNameTable::INVALID_FIELD_ID)
     {
       LOG_ERROR("Tool transform name is invalid!");
       numberOfErrors++;
@@ -603,22 +632,17 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
       continue;
     }
 
-    vtkSmartPointer<vtkMatrix4x4> dMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    if (bufferItem.GetMatrix(dMatrix) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Failed to get matrix from buffer item for tool " << aTool->GetId());
-      numberOfErrors++;
-      continue;
-    }
-
-    if (aTrackedFrame.SetCustomFrameTransform(toolTransformName, dMatrix) != PLUS_SUCCESS)
+    // Transfer the matrix in binary form, it is only converted to text if the frame is written to file
+    double matrix[16];
+    bufferItem.GetMatrix(matrix);
+    if (aTrackedFrame.SetCustomFrameTransform(toolTransformFieldId, matrix) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to set transform for tool " << aTool->GetId());
       numberOfErrors++;
       continue;
     }
 
-    if (aTrackedFrame.SetCustomFrameTransformStatus(toolTransformName, vtkPlusDevice::ConvertToolStatusToTrackedFrameFieldStatus(bufferItem.GetStatus())) != PLUS_SUCCESS)
+    if (aTrackedFrame.SetCustomFrameTransformStatus(toolTransformFieldId, vtkPlusDevice::ConvertToolStatusToTrackedFrameFieldStatus(bufferItem.GetStatus())) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to set transform status for tool " << aTool->GetId());
       numberOfErrors++;
@@ -626,12 +650,7 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
     }
 
     // Copy all custom fields
-    StreamBufferItem::FieldMapType fieldMap = bufferItem.GetCustomFrameFieldMap();
-    StreamBufferItem::FieldMapType::iterator fieldIterator;
-    for (fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
-    {
-      aTrackedFrame.SetCustomFrameField((*fieldIterator).first, (*fieldIterator).second);
-    }
+    aTrackedFrame.SetCustomFrameFields(bufferItem.GetCustomFrameFields());
 
     synchronizedTimestamp = bufferItem.GetTimestamp(aTool->GetLocalTimeOffsetSec());
   }
@@ -664,12 +683,7 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, PlusTrackedFrame& a
     }
 
     // Copy all custom fields
-    StreamBufferItem::FieldMapType fieldMap = bufferItem.GetCustomFrameFieldMap();
-    StreamBufferItem::FieldMapType::iterator fieldIterator;
-    for (fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
-    {
-      aTrackedFrame.SetCustomFrameField((*fieldIterator).first, (*fieldIterator).second);
-    }
+    aTrackedFrame.SetCustomFrameFields(bufferItem.GetCustomFrameFields());
 
     synchronizedTimestamp = bufferItem.GetTimestamp(aSource->GetLocalTimeOffsetSec());
   }
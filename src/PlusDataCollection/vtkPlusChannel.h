@@ -18,6 +18,7 @@ class PlusTrackedFrame;
 class vtkPlusHTMLGenerator;
 class vtkPlusDataSource;
 class vtkPlusDevice;
+class vtkPlusNewDataNotifier;
 class vtkPlusTrackedFrameList;
 
 typedef std::map<std::string, vtkPlusDataSource*> DataSourceContainer;
@@ -141,6 +142,14 @@ public:
   /*! Return the oldest synchronized timestamp in the buffers */
   virtual PlusStatus GetOldestTimestamp(double& ts);
 
+  /*!
+    Register a notifier in the buffers of all the data sources (video, tools, fields) of the channel.
+    The notifier is signaled each time a new item is added to any of these buffers.
+  */
+  virtual void AddNewItemNotifier(vtkPlusNewDataNotifier* notifier);
+  /*! Unregister a notifier from the buffers of all the data sources of the channel */
+  virtual void RemoveNewItemNotifier(vtkPlusNewDataNotifier* notifier);
+
   virtual PlusStatus Clear();
 
   virtual void ShallowCopy(vtkDataObject*);
@@ -378,6 +378,11 @@ PlusStatus vtkPlusDataSource::ReadConfiguration(vtkXMLDataElement* sourceElement
     LOG_DEBUG("AveragedItemsForFiltering is not defined in source element \"" << this->GetId() << "\". Using default value: " << this->GetBuffer()->GetAveragedItemsForFiltering());
   }
 
+  // Readers (e.g., OpenIGTLink server, capture, volume reconstruction) query timestamps without blocking acquisition
+  bool bufferLockFreeReading = this->GetBuffer()->GetLockFreeReading();
+  XML_READ_BOOL_ATTRIBUTE_NONMEMBER_OPTIONAL(BufferLockFreeReading, bufferLockFreeReading, sourceElement);
+  this->GetBuffer()->SetLockFreeReading(bufferLockFreeReading);
+
   std::string descName;
   if (!aDescriptiveNameForBuffer.empty())
   {
@@ -439,6 +444,11 @@ PlusStatus vtkPlusDataSource::WriteConfiguration(vtkXMLDataElement* aSourceEleme
     aSourceElement->SetIntAttribute("AveragedItemsForFiltering", this->GetBuffer()->GetAveragedItemsForFiltering());
   }
 
+  if (aSourceElement->GetAttribute("BufferLockFreeReading") != NULL || this->GetBuffer()->GetLockFreeReading())
+  {
+    aSourceElement->SetAttribute("BufferLockFreeReading", this->GetBuffer()->GetLockFreeReading() ? "TRUE" : "FALSE");
+  }
+
   // Write custom properties
   if (this->CustomProperties.size() > 0)
   {
@@ -560,6 +570,27 @@ PlusStatus vtkPlusDataSource::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION u
                                     this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::ReserveItem(US_IMAGE_ORIENTATION usImageOrientation, const unsigned int frameSizeInPx[3], PlusCommon::VTKScalarPixelType pixelType,
+    unsigned int numberOfScalarComponents, US_IMAGE_TYPE imageType, long frameNumber, PlusVideoFrame*& frame,
+    double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/)
+{
+  return this->GetBuffer()->ReserveItem(usImageOrientation, frameSizeInPx, pixelType, numberOfScalarComponents, imageType, frameNumber,
+                                        this->ClipRectangleOrigin, this->ClipRectangleSize, frame, unfilteredTimestamp, filteredTimestamp);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::CommitReservedItem(const PlusTrackedFrame::FieldMapType* customFields /*= NULL*/)
+{
+  return this->GetBuffer()->CommitReservedItem(customFields);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataSource::CancelReservedItem()
+{
+  this->GetBuffer()->CancelReservedItem();
+}
+
 //-----------------------------------------------------------------------------
 US_IMAGE_TYPE vtkPlusDataSource::GetImageType()
 {
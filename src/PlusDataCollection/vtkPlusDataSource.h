@@ -223,6 +223,18 @@ public:
   */
   virtual PlusStatus AddItem(const PlusTrackedFrame::FieldMapType& customFields, long frameNumber, double unfilteredTimestamp = UNDEFINED_TIMESTAMP, double filteredTimestamp = UNDEFINED_TIMESTAMP);
 
+  /*!
+    Reserve the next item of the buffer so that the device can write the frame pixels directly into the buffer.
+    The clip rectangle of the source is applied. See vtkPlusBuffer::ReserveItem for details.
+  */
+  virtual PlusStatus ReserveItem(US_IMAGE_ORIENTATION usImageOrientation, const unsigned int frameSizeInPx[3], PlusCommon::VTKScalarPixelType pixelType,
+                                 unsigned int numberOfScalarComponents, US_IMAGE_TYPE imageType, long frameNumber, PlusVideoFrame*& frame,
+                                 double unfilteredTimestamp = UNDEFINED_TIMESTAMP, double filteredTimestamp = UNDEFINED_TIMESTAMP);
+  /*! Add the item that was reserved by ReserveItem to the buffer */
+  virtual PlusStatus CommitReservedItem(const PlusTrackedFrame::FieldMapType* customFields = NULL);
+  /*! Release the item that was reserved by ReserveItem without adding it to the buffer */
+  virtual void CancelReservedItem();
+
   /*!
   Add a matrix plus status to the list, with an exactly known timestamp value (e.g., provided by a high-precision hardware timer).
   If the timestamp is less than or equal to the previous timestamp, then nothing  will be done.
@@ -12,6 +12,32 @@ See License.txt for details.
 #include "vtkTable.h"
 #include "vtkVariantArray.h"
 
+#include <algorithm>
+
+// Number of times a lock-free search is restarted if the items are overwritten during the search
+static const int LOCK_FREE_SEARCH_MAX_ATTEMPTS = 3;
+
+//----------------------------------------------------------------------------
+// Items are usually acquired at a nearly constant rate, therefore the position of the item can be well estimated
+// by linear interpolation between the timestamps of the current search range. Interpolation and bisection steps
+// are alternated: for regularly sampled data the item is found in a few steps independently of the buffer size,
+// while the bisection steps guarantee logarithmic search time for irregularly sampled data.
+static BufferItemUidType GetSearchRangeSplitUid(const double time, BufferItemUidType lo, BufferItemUidType hi, double tlo, double thi, bool interpolate)
+{
+  BufferItemUidType mid = lo + (hi - lo) / 2;
+  if (interpolate && thi > tlo)
+  {
+    double ratio = (time - tlo) / (thi - tlo);
+    if (ratio > 0 && ratio < 1)
+    {
+      mid = lo + static_cast<BufferItemUidType>(ratio * (hi - lo));
+    }
+    // the split position must be strictly inside the range to make progress
+    mid = std::min(std::max(mid, lo + 1), hi - 1);
+  }
+  return mid;
+}
+
 vtkStandardNewMacro(vtkPlusTimestampedCircularBuffer);
 
 //----------------------------------------------------------------------------
@@ -28,6 +54,10 @@ vtkPlusTimestampedCircularBuffer::vtkPlusTimestampedCircularBuffer()
   , TimeStampLogging(false)
   , StartTime(0)
   , NegligibleTimeDifferenceSec(1e-5)
+  , LockFreeReading(false)
+  , LockFreeItemsSize(0)
+  , LockFreeLatestItemUid(0)
+  , LockFreeFirstItemUid(1)
 {
   this->BufferItemContainer.resize(0);
   this->FilterContainerIndexVector.set_size(0);
@@ -66,6 +96,7 @@ void vtkPlusTimestampedCircularBuffer::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "CurrentTimeStamp: " << this->CurrentTimeStamp << "\n";
   os << indent << "Local time offset: " << this->LocalTimeOffsetSec << "\n";
   os << indent << "Latest Item Uid: " << this->LatestItemUid << "\n";
+  os << indent << "Lock-free reading: " << (this->LockFreeReading ? "enabled" : "disabled") << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -83,6 +114,7 @@ PlusStatus vtkPlusTimestampedCircularBuffer::PrepareForNewItem(const double time
   newFrameUid = ++this->LatestItemUid;
   bufferIndex = this->WritePointer;
   this->CurrentTimeStamp = timestamp;
+  this->FilteredTimestampIndex[bufferIndex] = timestamp;
 
   this->NumberOfItems++;
   if (this->NumberOfItems > this->GetBufferSize())
@@ -98,6 +130,270 @@ PlusStatus vtkPlusTimestampedCircularBuffer::PrepareForNewItem(const double time
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::CommitNewItem(const int bufferIndex)
+{
+  // the caller must have locked the buffer
+  if (!this->LockFreeReading || this->LockFreeItemsSize <= 0 || bufferIndex < 0 || bufferIndex >= this->GetBufferSize())
+  {
+    return;
+  }
+  StreamBufferItem& item = this->BufferItemContainer[bufferIndex];
+  BufferItemUidType uid = item.GetUid();
+  LockFreeItemMetadata& itemMetadata = this->LockFreeItems[uid % this->LockFreeItemsSize];
+
+  // Invalidate the slot while it is updated, so that readers detect that the previous item has been overwritten
+  itemMetadata.Uid.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  itemMetadata.FilteredTimestamp.store(item.GetFilteredTimestamp(0), std::memory_order_relaxed);
+  itemMetadata.UnfilteredTimestamp.store(item.GetUnfilteredTimestamp(0), std::memory_order_relaxed);
+  itemMetadata.Index.store(item.GetIndex(), std::memory_order_relaxed);
+  itemMetadata.Uid.store(uid, std::memory_order_release);
+
+  this->LockFreeLatestItemUid.store(uid, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::CancelNewItem(const int bufferIndex)
+{
+  // the caller must have locked the buffer since PrepareForNewItem
+  if (bufferIndex < 0 || bufferIndex >= this->GetBufferSize() || this->NumberOfItems < 1)
+  {
+    LOG_ERROR("Failed to cancel new item in buffer index " << bufferIndex);
+    return;
+  }
+
+  BufferItemUidType cancelledUid = this->LatestItemUid;
+  this->LatestItemUid--;
+  this->WritePointer = bufferIndex;
+  // The item that was in the slot before is lost (if the buffer was full) or the slot was empty.
+  // In both cases the number of valid items is one less than after PrepareForNewItem.
+  this->NumberOfItems--;
+  if (this->NumberOfItems > 0)
+  {
+    this->CurrentTimeStamp = this->GetFilteredTimestampFromIndex(this->LatestItemUid) - this->LocalTimeOffsetSec;
+  }
+
+  if (this->LockFreeReading && this->LockFreeItemsSize > 0 && cancelledUid > static_cast<BufferItemUidType>(this->LockFreeItemsSize))
+  {
+    // The lost item shares the slot with the cancelled item, invalidate it for lock-free readers
+    BufferItemUidType lostUid = cancelledUid - this->LockFreeItemsSize;
+    LockFreeItemMetadata& itemMetadata = this->LockFreeItems[lostUid % this->LockFreeItemsSize];
+    if (itemMetadata.Uid.load(std::memory_order_relaxed) == lostUid)
+    {
+      itemMetadata.Uid.store(0, std::memory_order_release);
+    }
+    // The oldest item is now the one after the lost item
+    if (this->LockFreeFirstItemUid.load(std::memory_order_relaxed) <= lostUid)
+    {
+      this->LockFreeFirstItemUid.store(lostUid + 1, std::memory_order_release);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::SetLockFreeReading(bool enable)
+{
+  PlusLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->LockFreeReading == enable)
+  {
+    return;
+  }
+  if (enable)
+  {
+    this->RebuildLockFreeItemIndex();
+  }
+  this->LockFreeReading = enable;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::RebuildLockFreeItemIndex()
+{
+  // the caller must have locked the buffer
+  if (this->LockFreeItemsSize != this->GetBufferSize())
+  {
+    this->LockFreeItemsSize = this->GetBufferSize();
+    this->LockFreeItems.reset(this->LockFreeItemsSize > 0 ? new LockFreeItemMetadata[this->LockFreeItemsSize] : NULL);
+  }
+  for (int i = 0; i < this->LockFreeItemsSize; ++i)
+  {
+    this->LockFreeItems[i].Uid.store(0, std::memory_order_relaxed);
+    this->LockFreeItems[i].FilteredTimestamp.store(0, std::memory_order_relaxed);
+    this->LockFreeItems[i].UnfilteredTimestamp.store(0, std::memory_order_relaxed);
+    this->LockFreeItems[i].Index.store(0, std::memory_order_relaxed);
+  }
+
+  BufferItemUidType oldestUid = this->LatestItemUid + 1 - this->NumberOfItems;
+  for (BufferItemUidType uid = oldestUid; uid <= this->LatestItemUid; ++uid)
+  {
+    StreamBufferItem* itemPtr = NULL;
+    if (uid == 0 || this->GetBufferItemPointerFromUid(uid, itemPtr) != ITEM_OK)
+    {
+      continue;
+    }
+    LockFreeItemMetadata& itemMetadata = this->LockFreeItems[uid % this->LockFreeItemsSize];
+    itemMetadata.FilteredTimestamp.store(itemPtr->GetFilteredTimestamp(0), std::memory_order_relaxed);
+    itemMetadata.UnfilteredTimestamp.store(itemPtr->GetUnfilteredTimestamp(0), std::memory_order_relaxed);
+    itemMetadata.Index.store(itemPtr->GetIndex(), std::memory_order_relaxed);
+    itemMetadata.Uid.store(uid, std::memory_order_relaxed);
+  }
+
+  this->LockFreeFirstItemUid.store(std::max<BufferItemUidType>(oldestUid, 1), std::memory_order_relaxed);
+  this->LockFreeLatestItemUid.store(this->LatestItemUid, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+BufferItemUidType vtkPlusTimestampedCircularBuffer::GetLockFreeOldestItemUid(BufferItemUidType latestUid)
+{
+  BufferItemUidType firstUid = this->LockFreeFirstItemUid.load(std::memory_order_acquire);
+  BufferItemUidType bufferSize = static_cast<BufferItemUidType>(std::max(this->LockFreeItemsSize, 1));
+  BufferItemUidType oldestUidInRing = (latestUid >= bufferSize ? latestUid - bufferSize + 1 : 1);
+  return std::max(firstUid, oldestUidInRing);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTimestampedCircularBuffer::ReadLockFreeItem(BufferItemUidType uid, double* filteredTimestamp, double* unfilteredTimestamp, unsigned long* index)
+{
+  BufferItemUidType latestUid = this->LockFreeLatestItemUid.load(std::memory_order_acquire);
+  if (uid > latestUid || this->LockFreeItemsSize <= 0)
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  if (uid < this->GetLockFreeOldestItemUid(latestUid))
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+
+  LockFreeItemMetadata& itemMetadata = this->LockFreeItems[uid % this->LockFreeItemsSize];
+  if (itemMetadata.Uid.load(std::memory_order_acquire) != uid)
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  double filtered = itemMetadata.FilteredTimestamp.load(std::memory_order_relaxed);
+  double unfiltered = itemMetadata.UnfilteredTimestamp.load(std::memory_order_relaxed);
+  unsigned long itemIndex = itemMetadata.Index.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (itemMetadata.Uid.load(std::memory_order_relaxed) != uid)
+  {
+    // the item was overwritten while we were reading it
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+
+  if (filteredTimestamp != NULL)
+  {
+    *filteredTimestamp = filtered;
+  }
+  if (unfilteredTimestamp != NULL)
+  {
+    *unfilteredTimestamp = unfiltered;
+  }
+  if (index != NULL)
+  {
+    *index = itemIndex;
+  }
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTimeLockFree(const double time, BufferItemUidType& uid)
+{
+  // The writer may overwrite the oldest items while we search. If any item that we need is overwritten
+  // then we restart the search on the current content of the buffer.
+  for (int attempt = 0; attempt < LOCK_FREE_SEARCH_MAX_ATTEMPTS; ++attempt)
+  {
+    BufferItemUidType hi = this->LockFreeLatestItemUid.load(std::memory_order_acquire);
+    BufferItemUidType lo = this->GetLockFreeOldestItemUid(hi);
+    if (hi < lo)
+    {
+      // the buffer is empty
+      return ITEM_NOT_AVAILABLE_YET;
+    }
+    if (hi == lo)
+    {
+      // There is only one item, it's the closest one to any timestamp
+      uid = hi;
+      return ITEM_OK;
+    }
+
+    double tlo = 0;
+    double thi = 0;
+    if (this->ReadLockFreeItem(lo, &tlo, NULL, NULL) != ITEM_OK || this->ReadLockFreeItem(hi, &thi, NULL, NULL) != ITEM_OK)
+    {
+      continue;
+    }
+    tlo += this->LocalTimeOffsetSec;
+    thi += this->LocalTimeOffsetSec;
+
+    // If the timestamp is slightly out of range then still accept it
+    // (due to errors in conversions there could be slight differences)
+    if (time < tlo - this->NegligibleTimeDifferenceSec)
+    {
+      return ITEM_NOT_AVAILABLE_ANYMORE;
+    }
+    else if (time > thi + this->NegligibleTimeDifferenceSec)
+    {
+      return ITEM_NOT_AVAILABLE_YET;
+    }
+
+    bool itemOverwritten = false;
+    bool interpolate = true;
+    while (hi - lo > 1)
+    {
+      BufferItemUidType mid = GetSearchRangeSplitUid(time, lo, hi, tlo, thi, interpolate);
+      interpolate = !interpolate;
+      double tmid = 0;
+      if (this->ReadLockFreeItem(mid, &tmid, NULL, NULL) != ITEM_OK)
+      {
+        itemOverwritten = true;
+        break;
+      }
+      tmid += this->LocalTimeOffsetSec;
+      if (time < tmid)
+      {
+        hi = mid;
+        thi = tmid;
+      }
+      else
+      {
+        lo = mid;
+        tlo = tmid;
+      }
+    }
+    if (itemOverwritten)
+    {
+      continue;
+    }
+
+    uid = (time - tlo > thi - time) ? hi : lo;
+    return ITEM_OK;
+  }
+
+  return ITEM_NOT_AVAILABLE_ANYMORE;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTimestampedCircularBuffer::GetOldestTimeStamp(double& timestamp)
+{
+  if (this->LockFreeReading)
+  {
+    // The oldest item may be overwritten at any moment, retry with the new oldest item if it happens
+    ItemStatus status = ITEM_NOT_AVAILABLE_ANYMORE;
+    for (int attempt = 0; attempt < LOCK_FREE_SEARCH_MAX_ATTEMPTS && status == ITEM_NOT_AVAILABLE_ANYMORE; ++attempt)
+    {
+      status = this->GetTimeStamp(this->GetOldestItemUidInBuffer(), timestamp);
+    }
+    return status;
+  }
+
+  // The oldest item may be removed from the buffer at any moment
+  // therefore we need to retrieve its UID and timestamp within a single lock
+  PlusLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
+  BufferItemUidType oldestUid = (this->LatestItemUid - (this->NumberOfItems - 1));
+  return this->GetTimeStamp(oldestUid, timestamp);
+}
+
 //----------------------------------------------------------------------------
 // Sets the buffer size, and copies the maximum number of the most current old
 // frames and timestamps
@@ -160,6 +456,18 @@ PlusStatus vtkPlusTimestampedCircularBuffer::SetBufferSize(int newBufferSize)
     this->NumberOfItems = this->GetBufferSize();
   }
 
+  // Buffer indexes of the items may have changed
+  this->FilteredTimestampIndex.resize(this->GetBufferSize());
+  for (int i = 0; i < this->GetBufferSize(); ++i)
+  {
+    this->FilteredTimestampIndex[i] = this->BufferItemContainer[i].GetFilteredTimestamp(0);
+  }
+
+  if (this->LockFreeReading)
+  {
+    this->RebuildLockFreeItemIndex();
+  }
+
   this->Modified();
 
   return PLUS_SUCCESS;
@@ -208,6 +516,13 @@ StreamBufferItem* vtkPlusTimestampedCircularBuffer::GetBufferItemPointerFromBuff
 //----------------------------------------------------------------------------
 ItemStatus vtkPlusTimestampedCircularBuffer::GetFilteredTimeStamp(const BufferItemUidType uid, double& filteredTimestamp)
 {
+  if (this->LockFreeReading)
+  {
+    ItemStatus status = this->ReadLockFreeItem(uid, &filteredTimestamp, NULL, NULL);
+    filteredTimestamp = (status == ITEM_OK ? filteredTimestamp + this->LocalTimeOffsetSec : 0);
+    return status;
+  }
+
   PlusLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
   StreamBufferItem* itemPtr = NULL;
   ItemStatus status = GetBufferItemPointerFromUid(uid, itemPtr);
@@ -223,6 +538,13 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetFilteredTimeStamp(const BufferIt
 //----------------------------------------------------------------------------
 ItemStatus vtkPlusTimestampedCircularBuffer::GetUnfilteredTimeStamp(const BufferItemUidType uid, double& unfilteredTimestamp)
 {
+  if (this->LockFreeReading)
+  {
+    ItemStatus status = this->ReadLockFreeItem(uid, NULL, &unfilteredTimestamp, NULL);
+    unfilteredTimestamp = (status == ITEM_OK ? unfilteredTimestamp + this->LocalTimeOffsetSec : 0);
+    return status;
+  }
+
   PlusLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
   StreamBufferItem* itemPtr = NULL;
   ItemStatus status = GetBufferItemPointerFromUid(uid, itemPtr);
@@ -274,6 +596,16 @@ bool vtkPlusTimestampedCircularBuffer::GetLatestItemHasValidFieldData()
 //----------------------------------------------------------------------------
 ItemStatus vtkPlusTimestampedCircularBuffer::GetIndex(const BufferItemUidType uid, unsigned long& index)
 {
+  if (this->LockFreeReading)
+  {
+    ItemStatus status = this->ReadLockFreeItem(uid, NULL, NULL, &index);
+    if (status != ITEM_OK)
+    {
+      index = 0;
+    }
+    return status;
+  }
+
   PlusLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
   StreamBufferItem* itemPtr = NULL;
   ItemStatus status = GetBufferItemPointerFromUid(uid, itemPtr);
@@ -309,12 +641,20 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetBufferIndexFromTime(const double
 }
 
 //----------------------------------------------------------------------------
-// do a simple divide-and-conquer search for the transform
-// that best matches the given timestamp
 ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTime(const double time, BufferItemUidType& uid)
 {
+  if (this->LockFreeReading)
+  {
+    return this->GetItemUidFromTimeLockFree(time, uid);
+  }
+
   PlusLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
 
+  if (this->NumberOfItems < 1)
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+
   if (this->NumberOfItems == 1)
   {
     // There is only one item, it's the closest one to any timestamp
@@ -325,22 +665,10 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTime(const double tim
   BufferItemUidType lo = this->LatestItemUid - (this->NumberOfItems - 1);   // oldest item UID
   BufferItemUidType hi = this->LatestItemUid; // latest item UID
 
-  // minimum time
-  // This method is called often, therefore instead of calling this->GetTimeStamp(lo, tlo) we perform low-level operations to get the timestamp
-  int loBufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - lo);
-  if (loBufferIndex < 0)
-  {
-    loBufferIndex += this->BufferItemContainer.size();
-  }
-  double tlo = this->BufferItemContainer[loBufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
-
-  // This method is called often, therefore instead of calling this->GetTimeStamp(hi, thi) we perform low-level operations to get the timestamp
-  int hiBufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - hi);
-  if (hiBufferIndex < 0)
-  {
-    hiBufferIndex += this->BufferItemContainer.size();
-  }
-  double thi = this->BufferItemContainer[hiBufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
+  // This method is called often, therefore instead of calling this->GetTimeStamp(uid, t) we read the timestamps
+  // from the compact timestamp index
+  double tlo = this->GetFilteredTimestampFromIndex(lo);
+  double thi = this->GetFilteredTimestampFromIndex(hi);
 
   // If the timestamp is slightly out of range then still accept it
   // (due to errors in conversions there could be slight differences)
@@ -353,32 +681,12 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTime(const double tim
     return ITEM_NOT_AVAILABLE_YET;
   }
 
-  for (;;)
+  bool interpolate = true;
+  while (hi - lo > 1)
   {
-    if (hi - lo <= 1)
-    {
-      if (time - tlo > thi - time)
-      {
-        uid = hi;
-        return ITEM_OK;
-      }
-      else
-      {
-        uid = lo;
-        return ITEM_OK;
-      }
-    }
-
-    int mid = (lo + hi) / 2;
-
-    // This is a hot loop, therefore instead of calling this->GetTimeStamp(mid, tmid) we perform low-level operations to get the timestamp
-    int midBufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - mid);
-    if (midBufferIndex < 0)
-    {
-      midBufferIndex += this->BufferItemContainer.size();
-    }
-    double tmid = this->BufferItemContainer[midBufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
-
+    BufferItemUidType mid = GetSearchRangeSplitUid(time, lo, hi, tlo, thi, interpolate);
+    interpolate = !interpolate;
+    double tmid = this->GetFilteredTimestampFromIndex(mid);
     if (time < tmid)
     {
       hi = mid;
@@ -391,6 +699,8 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTime(const double tim
     }
   }
 
+  uid = (time - tlo > thi - time) ? hi : lo;
+  return ITEM_OK;
 }
 
 //----------------------------------------------------------------------------
@@ -411,6 +721,11 @@ void vtkPlusTimestampedCircularBuffer::DeepCopy(vtkPlusTimestampedCircularBuffer
   this->FilterContainerIndexVector = buffer->FilterContainerIndexVector;
 
   this->BufferItemContainer = buffer->BufferItemContainer;
+  this->FilteredTimestampIndex = buffer->FilteredTimestampIndex;
+  if (this->LockFreeReading)
+  {
+    this->RebuildLockFreeItemIndex();
+  }
   this->Unlock();
   buffer->Unlock();
 }
@@ -423,6 +738,10 @@ void vtkPlusTimestampedCircularBuffer::Clear()
   this->NumberOfItems = 0;
   this->CurrentTimeStamp = 0;
   this->LatestItemUid = 0;
+  if (this->LockFreeReading)
+  {
+    this->RebuildLockFreeItemIndex();
+  }
   this->Unlock();
 }
 
@@ -11,7 +11,10 @@
 #include "PlusStreamBufferItem.h"
 #include "vtkObject.h"
 #include "vtkTypeTemplate.h"
+#include <atomic>
 #include <deque>
+#include <memory>
+#include <vector>
 
 #include "vnl/vnl_matrix.h"
 #include "vnl/vnl_vector.h"
@@ -65,6 +68,10 @@ public:
   /*! Get the most recent frame UID that is already in the buffer */
   virtual BufferItemUidType GetLatestItemUidInBuffer()
   {
+    if (this->LockFreeReading)
+    {
+      return this->LockFreeLatestItemUid.load(std::memory_order_acquire);
+    }
     this->Lock();
     BufferItemUidType latestUid = this->LatestItemUid;
     this->Unlock();
@@ -74,6 +81,10 @@ public:
   /*! Get the oldest frame UID in the buffer  */
   virtual BufferItemUidType GetOldestItemUidInBuffer()
   {
+    if (this->LockFreeReading)
+    {
+      return this->GetLockFreeOldestItemUid(this->LockFreeLatestItemUid.load(std::memory_order_acquire));
+    }
     this->Lock();
     // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
     BufferItemUidType oldestUid = this->LatestItemUid - ( this->NumberOfItems - 1 );
@@ -87,17 +98,7 @@ public:
     return this->GetTimeStamp( this->GetLatestItemUidInBuffer(), timestamp );
   }
 
-  virtual ItemStatus GetOldestTimeStamp( double& timestamp )
-  {
-    // The oldest item may be removed from the buffer at any moment
-    // therefore we need to retrieve its UID and timestamp within a single lock
-    this->Lock();
-    // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
-    BufferItemUidType oldestUid = ( this->LatestItemUid - ( this->NumberOfItems - 1 ) );
-    ItemStatus status = this->GetTimeStamp( oldestUid, timestamp );
-    this->Unlock();
-    return status;
-  }
+  virtual ItemStatus GetOldestTimeStamp( double& timestamp );
 
   virtual ItemStatus GetTimeStamp( const BufferItemUidType uid, double& timestamp ) { return this->GetFilteredTimeStamp( uid, timestamp ); }
   virtual ItemStatus GetFilteredTimeStamp( const BufferItemUidType uid, double& filteredTimestamp );
@@ -123,6 +124,19 @@ public:
   */
   virtual void DeepCopy( vtkPlusTimestampedCircularBuffer* buffer );
 
+  /*!
+    Enable lock-free reading of item UIDs, timestamps and indexes.
+    If enabled then GetLatestItemUidInBuffer, GetOldestItemUidInBuffer, GetTimeStamp, GetFilteredTimeStamp, GetUnfilteredTimeStamp,
+    GetIndex, GetItemUidFromTime, GetLatestTimeStamp and GetOldestTimeStamp do not lock the buffer, so any number of readers
+    can query the buffer without delaying the thread that adds new items. An item becomes visible to these readers when
+    CommitNewItem is called. If the item is overwritten while it is being read then ITEM_NOT_AVAILABLE_ANYMORE is returned.
+    Retrieving the complete content of an item (e.g., image data) still requires locking the buffer.
+    The mode and the buffer size must not be changed while other threads are reading the buffer.
+  */
+  virtual void SetLockFreeReading( bool enable );
+  vtkGetMacro( LockFreeReading, bool );
+  vtkBooleanMacro( LockFreeReading, bool );
+
   /*!  Set the local time offset in seconds (global = local + offset) */
   vtkSetMacro( LocalTimeOffsetSec, double );
   /*!  Get the local time offset in seconds (global = local + offset) */
@@ -169,6 +183,19 @@ public:
 
   virtual PlusStatus PrepareForNewItem( const double timestamp, BufferItemUidType& newFrameUid, int& bufferIndex );
 
+  /*!
+    Make the item that was prepared by PrepareForNewItem and then filled by the caller visible for lock-free readers.
+    INTERNAL USE ONLY! Need to lock buffer until the item is committed
+  */
+  virtual void CommitNewItem( const int bufferIndex );
+
+  /*!
+    Revert PrepareForNewItem if the caller could not fill the item. The content of the prepared buffer slot may have been
+    already overwritten, therefore the oldest item (that was stored in that slot) is removed from the buffer.
+    INTERNAL USE ONLY! Need to lock buffer from PrepareForNewItem until the item is cancelled
+  */
+  virtual void CancelNewItem( const int bufferIndex );
+
   /*!
     Create filtered and unfiltered timestamp for accurate timing of the buffer item.
     The timing may be inaccurate because the timestamp is attached to the item when Plus receives it
@@ -211,6 +238,32 @@ protected:
   vtkPlusTimestampedCircularBuffer();
   ~vtkPlusTimestampedCircularBuffer();
 
+  /*! Get the filtered timestamp (with local time offset) of an item from the timestamp index. The caller must have locked the buffer. */
+  inline double GetFilteredTimestampFromIndex( BufferItemUidType uid )
+  {
+    int bufferIndex = ( this->WritePointer - 1 ) - static_cast<int>( this->LatestItemUid - uid );
+    if ( bufferIndex < 0 )
+    {
+      bufferIndex += static_cast<int>( this->FilteredTimestampIndex.size() );
+    }
+    return this->FilteredTimestampIndex[bufferIndex] + this->LocalTimeOffsetSec;
+  }
+
+  /*! Get the oldest item UID that lock-free readers may access, given the latest committed item UID */
+  BufferItemUidType GetLockFreeOldestItemUid( BufferItemUidType latestUid );
+
+  /*!
+    Read the timestamps and index of an item without locking the buffer.
+    Any of the output pointers may be NULL. Timestamps are returned without local time offset.
+  */
+  ItemStatus ReadLockFreeItem( BufferItemUidType uid, double* filteredTimestamp, double* unfilteredTimestamp, unsigned long* index );
+
+  /*! Lock-free implementation of GetItemUidFromTime */
+  ItemStatus GetItemUidFromTimeLockFree( const double time, BufferItemUidType& uid );
+
+  /*! Fill the lock-free item index from the items that are currently in the buffer. The caller must have locked the buffer. */
+  void RebuildLockFreeItemIndex();
+
 protected:
   vtkPlusRecursiveCriticalSection* Mutex;
 
@@ -232,6 +285,12 @@ protected:
 
   std::deque<StreamBufferItem> BufferItemContainer;
 
+  /*!
+    Filtered timestamps (without local time offset) of the items, at the same buffer index as the items in BufferItemContainer.
+    Searching by time only reads this compact array instead of the (large) buffer items.
+  */
+  std::vector<double> FilteredTimestampIndex;
+
   /*! Matrix used for storing the last number of AveragedItemsForFiltering frame index */
   vnl_vector<double> FilterContainerIndexVector;
 
@@ -277,6 +336,31 @@ protected:
   */
   double NegligibleTimeDifferenceSec;
 
+  /*!
+    Copy of the item metadata that can be read without locking the buffer.
+    The writer sets Uid to 0 while it updates the other members (seqlock), readers verify that Uid did not change while reading.
+  */
+  struct LockFreeItemMetadata
+  {
+    std::atomic<BufferItemUidType> Uid;
+    std::atomic<double> FilteredTimestamp;
+    std::atomic<double> UnfilteredTimestamp;
+    std::atomic<unsigned long> Index;
+  };
+
+  /*! If enabled then metadata queries do not lock the buffer */
+  bool LockFreeReading;
+
+  /*! Lock-free item metadata, the item with UID uid is stored at index (uid % LockFreeItemsSize) */
+  std::unique_ptr<LockFreeItemMetadata[]> LockFreeItems;
+  int LockFreeItemsSize;
+
+  /*! UID of the most recent item that was committed */
+  std::atomic<BufferItemUidType> LockFreeLatestItemUid;
+
+  /*! Items with smaller UID are not available for lock-free readers (e.g., because they were added before a buffer resize) */
+  std::atomic<BufferItemUidType> LockFreeFirstItemUid;
+
 private:
   vtkPlusTimestampedCircularBuffer( const vtkPlusTimestampedCircularBuffer& );
   void operator=( const vtkPlusTimestampedCircularBuffer& );
@@ -0,0 +1,200 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusRfToBrightnessConvertSimdTest.cxx
+  \brief Compare brightness conversion of RF data with and without SIMD instructions
+
+  Converts all frames of an RF sequence file to brightness images with and without SIMD instructions.
+  Each frame is converted with its own RF encoding type and as real RF data (US_IMG_RF_REAL), so that
+  the Hilbert transform is always tested. The test fails if the SIMD and non-SIMD results are not exactly the same.
+
+  Then the conversion of a synthetic real RF frame of --benchmark-lines x --benchmark-samples samples
+  (default: 128 x 2048) is timed on one thread and the achieved frame rate is reported.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusCpuFeatures.h"
+#include "PlusTrackedFrame.h"
+#include "vtkImageData.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkPlusRfToBrightnessConvert.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusTrackedFrameList.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  PlusStatus ConvertToBrightness(vtkImageData* rfImage, US_IMAGE_TYPE imageType, bool simdEnabled, vtkImageData* brightnessImage)
+  {
+    vtkSmartPointer<vtkPlusRfToBrightnessConvert> converter = vtkSmartPointer<vtkPlusRfToBrightnessConvert>::New();
+    converter->SetInputData(rfImage);
+    converter->SetImageType(imageType);
+    converter->SetSimdEnabled(simdEnabled);
+    converter->Update();
+    if (converter->GetOutput() == NULL || converter->GetOutput()->GetScalarPointer() == NULL)
+    {
+      LOG_ERROR("Brightness conversion failed for image type " << PlusVideoFrame::GetStringFromUsImageType(imageType));
+      return PLUS_FAIL;
+    }
+    brightnessImage->DeepCopy(converter->GetOutput());
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns true if the two brightness images have the same extent and pixel values
+  bool AreImagesEqual(vtkImageData* image1, vtkImageData* image2)
+  {
+    int* extent1 = image1->GetExtent();
+    int* extent2 = image2->GetExtent();
+    for (int i = 0; i < 6; ++i)
+    {
+      if (extent1[i] != extent2[i])
+      {
+        return false;
+      }
+    }
+    if (image1->GetScalarType() != VTK_UNSIGNED_CHAR || image2->GetScalarType() != VTK_UNSIGNED_CHAR)
+    {
+      return false;
+    }
+    return memcmp(image1->GetScalarPointer(), image2->GetScalarPointer(), image1->GetNumberOfPoints()) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  // Create an RF frame with the echoes of randomly placed scatterers: each line is the sum of 5 MHz pulses (sampled at 40 MHz)
+  void CreateRfFrame(int numberOfLines, int numberOfSamples, vtkImageData* rfImage)
+  {
+    rfImage->SetExtent(0, numberOfSamples - 1, 0, numberOfLines - 1, 0, 0);
+    rfImage->AllocateScalars(VTK_SHORT, 1);
+    short* rfPtr = static_cast<short*>(rfImage->GetScalarPointer());
+    const double pi = 3.14159265358979323846;
+    unsigned int seed = 12345;
+    for (int line = 0; line < numberOfLines; ++line)
+    {
+      for (int sample = 0; sample < numberOfSamples; ++sample)
+      {
+        seed = seed * 1103515245 + 12345;
+        double scattererAmplitude = static_cast<double>((seed >> 16) & 0x7FFF) / 0x7FFF;
+        double attenuation = exp(-3.0 * sample / numberOfSamples);
+        *(rfPtr++) = static_cast<short>(8000.0 * attenuation * scattererAmplitude * sin(2 * pi * sample / 8.0));
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  std::string inputRfFile;
+  int benchmarkLines = 128;
+  int benchmarkSamples = 2048;
+  int benchmarkFrames = 40;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--rf-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputRfFile, "File name of input RF image data");
+  args.AddArgument("--benchmark-lines", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &benchmarkLines, "Number of scan lines in the benchmark frame (default: 128)");
+  args.AddArgument("--benchmark-samples", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &benchmarkSamples, "Number of samples per scan line in the benchmark frame (default: 2048)");
+  args.AddArgument("--benchmark-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &benchmarkFrames, "Number of frames converted in the benchmark, 0 disables the benchmark (default: 40)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputRfFile.empty())
+  {
+    std::cerr << "--rf-file required" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  bool simdSupported = (PlusCpuFeatures::GetInstructionSet() >= PlusCpuFeatures::INSTRUCTION_SET_AVX2);
+  if (!simdSupported)
+  {
+    LOG_INFO("SIMD instructions are not available, brightness conversion is only tested without SIMD instructions");
+  }
+
+  vtkSmartPointer<vtkPlusTrackedFrameList> frameList = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(inputRfFile, frameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to load input sequence file: " << inputRfFile);
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfFailures = 0;
+  if (simdSupported)
+  {
+    for (unsigned int frameIndex = 0; frameIndex < frameList->GetNumberOfTrackedFrames(); ++frameIndex)
+    {
+      PlusVideoFrame* rfFrame = frameList->GetTrackedFrame(frameIndex)->GetImageData();
+      US_IMAGE_TYPE imageTypes[2] = { rfFrame->GetImageType(), US_IMG_RF_REAL };
+      int numberOfImageTypes = (imageTypes[0] == US_IMG_RF_REAL ? 1 : 2);
+      for (int imageTypeIndex = 0; imageTypeIndex < numberOfImageTypes; ++imageTypeIndex)
+      {
+        vtkSmartPointer<vtkImageData> referenceImage = vtkSmartPointer<vtkImageData>::New();
+        vtkSmartPointer<vtkImageData> simdImage = vtkSmartPointer<vtkImageData>::New();
+        if (ConvertToBrightness(rfFrame->GetImage(), imageTypes[imageTypeIndex], false, referenceImage) != PLUS_SUCCESS
+            || ConvertToBrightness(rfFrame->GetImage(), imageTypes[imageTypeIndex], true, simdImage) != PLUS_SUCCESS)
+        {
+          exit(EXIT_FAILURE);
+        }
+        if (!AreImagesEqual(referenceImage, simdImage))
+        {
+          LOG_ERROR("Frame " << frameIndex << ": brightness image is different with SIMD instructions (image type: "
+                    << PlusVideoFrame::GetStringFromUsImageType(imageTypes[imageTypeIndex]) << ")");
+          ++numberOfFailures;
+        }
+      }
+    }
+    LOG_INFO(frameList->GetNumberOfTrackedFrames() << " frames are compared");
+  }
+
+  if (benchmarkFrames > 0)
+  {
+    vtkSmartPointer<vtkImageData> rfImage = vtkSmartPointer<vtkImageData>::New();
+    CreateRfFrame(benchmarkLines, benchmarkSamples, rfImage);
+    for (int simdEnabled = 0; simdEnabled <= (simdSupported ? 1 : 0); ++simdEnabled)
+    {
+      vtkSmartPointer<vtkPlusRfToBrightnessConvert> converter = vtkSmartPointer<vtkPlusRfToBrightnessConvert>::New();
+      converter->SetInputData(rfImage);
+      converter->SetImageType(US_IMG_RF_REAL);
+      converter->SetSimdEnabled(simdEnabled != 0);
+      converter->SetNumberOfThreads(1);
+      double startTime = vtkPlusAccurateTimer::GetSystemTime();
+      for (int frame = 0; frame < benchmarkFrames; ++frame)
+      {
+        // force the execution of the filter, even though the input is not changed
+        converter->Modified();
+        converter->Update();
+      }
+      double conversionTimeSec = vtkPlusAccurateTimer::GetSystemTime() - startTime;
+      LOG_INFO("Brightness conversion of " << benchmarkLines << "x" << benchmarkSamples << " RF frames on one thread "
+               << (simdEnabled ? "with" : "without") << " SIMD instructions: "
+               << (conversionTimeSec > 0 ? benchmarkFrames / conversionTimeSec : 0.0) << " fps");
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
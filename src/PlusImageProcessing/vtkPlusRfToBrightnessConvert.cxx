@@ -7,6 +7,7 @@ See License.txt for details.
 #include "PlusConfigure.h"
 
 #include "vtkPlusRfToBrightnessConvert.h"
+#include "vtkPlusRfToBrightnessConvertHelperAVX2.h"
 
 #include "vtkImageData.h"
 #include "vtkInformation.h"
@@ -28,6 +29,7 @@ vtkPlusRfToBrightnessConvert::vtkPlusRfToBrightnessConvert()
   this->ImageType=US_IMG_TYPE_XX;
   this->BrightnessScale=10.0;
   this->NumberOfHilbertFilterCoeffs=64;
+  this->SimdEnabled=true;
 }
 
 //----------------------------------------------------------------------------
@@ -75,6 +77,8 @@ int vtkPlusRfToBrightnessConvert::RequestInformation(vtkInformation*,
       // B-mode data: BBB..., BBB...
       // => the output image size is the same as the input image size
       // keep the default extent
+      // Compute the Hilbert transform coefficients now, so that the threads do not modify them concurrently
+      ComputeHilbertTransformCoeffs();
     }
     break;
   case US_IMG_RF_IQ_LINE:
@@ -308,6 +312,7 @@ void vtkPlusRfToBrightnessConvert::ThreadedRequestData(
 void vtkPlusRfToBrightnessConvert::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "SimdEnabled: " << (this->SimdEnabled ? "true" : "false") << "\n";
 }
 
 //-----------------------------------------------------------------------------
@@ -348,6 +353,11 @@ void vtkPlusRfToBrightnessConvert::ComputeHilbertTransformCoeffs()
     // From http://www.vbforums.com/archive/index.php/t-639223.html
     this->HilbertTransformCoeffs[i]=1/((i-this->NumberOfHilbertFilterCoeffs/2)-0.5)/vtkMath::Pi();
   }
+  this->HilbertTransformCoeffsReversed.resize(this->NumberOfHilbertFilterCoeffs);
+  for (int i=0; i<this->NumberOfHilbertFilterCoeffs; i++)
+  {
+    this->HilbertTransformCoeffsReversed[i]=this->HilbertTransformCoeffs[this->NumberOfHilbertFilterCoeffs-i];
+  }
   
   bool debugOutput=false; // print Hilbert transform coefficients in Matlab format
   if (debugOutput)
@@ -380,6 +390,15 @@ PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(short *hilbertT
   }
 
   // Compute Hilbert transform by convolution
+#ifdef PLUS_X86_SIMD
+  if (this->SimdEnabled && PlusCpuFeatures::GetInstructionSet() >= PlusCpuFeatures::INSTRUCTION_SET_AVX2 && this->NumberOfHilbertFilterCoeffs>0)
+  {
+    // Same products and sums as in the loop below, computed for multiple output samples at once
+    vtkRfHilbertTransformConvolveAVX2(hilbertTransformOutput+1, input+1, npt-this->NumberOfHilbertFilterCoeffs+1,
+      &this->HilbertTransformCoeffsReversed[0], this->NumberOfHilbertFilterCoeffs);
+  }
+  else
+#endif
   for (int l=1; l<=npt-this->NumberOfHilbertFilterCoeffs+1; l++) 
   {
     double yt = 0.0;
@@ -416,6 +435,15 @@ void vtkPlusRfToBrightnessConvert::ComputeAmplitudeILineQLine(unsigned char *amp
   {
     ampl[i]=0;
   }
+#ifdef PLUS_X86_SIMD
+  if (this->SimdEnabled && PlusCpuFeatures::GetInstructionSet() >= PlusCpuFeatures::INSTRUCTION_SET_AVX2)
+  {
+    int firstSample=this->NumberOfHilbertFilterCoeffs/2+1;
+    vtkRfComputeAmplitudeAVX2(ampl+firstSample, inputSignal+firstSample, inputSignalHilbertTransformed+firstSample,
+      npt-this->NumberOfHilbertFilterCoeffs/2-firstSample+1, this->BrightnessScale);
+  }
+  else
+#endif
   for (int i=this->NumberOfHilbertFilterCoeffs/2+1; i<=npt-this->NumberOfHilbertFilterCoeffs/2; i++) 
   {
     double xt = inputSignal[i];
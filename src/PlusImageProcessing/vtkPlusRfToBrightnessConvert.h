@@ -57,6 +57,14 @@ public:
   vtkSetMacro(BrightnessScale, double);
   vtkGetMacro(BrightnessScale, double);
 
+  /*!
+    Enable use of SIMD (AVX2) instructions in Hilbert transform and envelope detection, if they are supported by the CPU.
+    The result is the same as without SIMD instructions. Enabled by default.
+  */
+  vtkSetMacro(SimdEnabled, bool);
+  vtkGetMacro(SimdEnabled, bool);
+  vtkBooleanMacro(SimdEnabled, bool);
+
 protected:
   vtkPlusRfToBrightnessConvert();
   ~vtkPlusRfToBrightnessConvert();
@@ -92,9 +100,15 @@ protected:
   /*! Coefficients of the Hilbert transform, computed from the NumberOfHilbertFilterCoeffs */
   std::vector<double> HilbertTransformCoeffs;
 
+  /*! Hilbert transform coefficients in reverse order (0-based), used by the SIMD implementation */
+  std::vector<double> HilbertTransformCoeffsReversed;
+
   /*! Image type (RF_IQ_LINE, RF_I_LINE_Q_LINE, ...) */
   US_IMAGE_TYPE ImageType;
 
+  /*! Use SIMD (AVX2) instructions if they are supported by the CPU */
+  bool SimdEnabled;
+
 private:
   vtkPlusRfToBrightnessConvert(const vtkPlusRfToBrightnessConvert&);  // Not implemented.
   void operator=(const vtkPlusRfToBrightnessConvert&);  // Not implemented.
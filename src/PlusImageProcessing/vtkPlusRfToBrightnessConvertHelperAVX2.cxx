@@ -0,0 +1,132 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "vtkPlusRfToBrightnessConvertHelperAVX2.h"
+
+#ifdef PLUS_X86_SIMD
+
+#include <immintrin.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Load 4 consecutive samples and convert them to double
+  PLUS_SIMD_TARGET("avx2")
+  inline __m256d LoadSamples(const short* samples)
+  {
+    __m128i samples16 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples));
+    return _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(samples16));
+  }
+
+  //----------------------------------------------------------------------------
+  // Store 4 values as short. The values are truncated to 32-bit integers, then the lower 16 bits
+  // are kept, which is what the scalar double to short conversion does.
+  PLUS_SIMD_TARGET("avx2")
+  inline void StoreSamples(short* samples, __m256d values)
+  {
+    const __m128i lowerHalves = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m128i values32 = _mm256_cvttpd_epi32(values);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(samples), _mm_shuffle_epi8(values32, lowerHalves));
+  }
+
+  //----------------------------------------------------------------------------
+  // Compute the compressed envelope of 4 samples, the results are 32-bit integers in the 0..255 range
+  PLUS_SIMD_TARGET("avx2")
+  inline __m128i ComputeAmplitude(const short* inputSignal, const short* phaseShiftedSignal, __m256d brightnessScale)
+  {
+    const __m256d minValue = _mm256_setzero_pd();
+    const __m256d maxValue = _mm256_set1_pd(255.0);
+    __m256d xt = LoadSamples(inputSignal);
+    __m256d xht = LoadSamples(phaseShiftedSignal);
+    __m256d squaredAmplitude = _mm256_add_pd(_mm256_mul_pd(xt, xt), _mm256_mul_pd(xht, xht));
+    __m256d brightness = _mm256_mul_pd(_mm256_sqrt_pd(_mm256_sqrt_pd(_mm256_sqrt_pd(squaredAmplitude))), brightnessScale);
+    brightness = _mm256_max_pd(_mm256_min_pd(brightness, maxValue), minValue);
+    return _mm256_cvttpd_epi32(brightness);
+  }
+}
+
+//----------------------------------------------------------------------------
+PLUS_SIMD_TARGET("avx2")
+void vtkRfHilbertTransformConvolveAVX2(short* output, const short* input, int numberOfOutputSamples, const double* coeffs, int numberOfCoeffs)
+{
+  int k = 0;
+  // 16 output samples per iteration, in 4 independent sums to hide the latency of the additions
+  for (; k + 16 <= numberOfOutputSamples; k += 16)
+  {
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    __m256d sum2 = _mm256_setzero_pd();
+    __m256d sum3 = _mm256_setzero_pd();
+    const short* samples = input + k;
+    for (int i = 0; i < numberOfCoeffs; ++i, ++samples)
+    {
+      __m256d coeff = _mm256_broadcast_sd(coeffs + i);
+      sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(LoadSamples(samples), coeff));
+      sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(LoadSamples(samples + 4), coeff));
+      sum2 = _mm256_add_pd(sum2, _mm256_mul_pd(LoadSamples(samples + 8), coeff));
+      sum3 = _mm256_add_pd(sum3, _mm256_mul_pd(LoadSamples(samples + 12), coeff));
+    }
+    StoreSamples(output + k, sum0);
+    StoreSamples(output + k + 4, sum1);
+    StoreSamples(output + k + 8, sum2);
+    StoreSamples(output + k + 12, sum3);
+  }
+  for (; k + 4 <= numberOfOutputSamples; k += 4)
+  {
+    __m256d sum = _mm256_setzero_pd();
+    const short* samples = input + k;
+    for (int i = 0; i < numberOfCoeffs; ++i, ++samples)
+    {
+      sum = _mm256_add_pd(sum, _mm256_mul_pd(LoadSamples(samples), _mm256_broadcast_sd(coeffs + i)));
+    }
+    StoreSamples(output + k, sum);
+  }
+  for (; k < numberOfOutputSamples; ++k)
+  {
+    double sum = 0.0;
+    for (int i = 0; i < numberOfCoeffs; ++i)
+    {
+      sum += input[k + i] * coeffs[i];
+    }
+    output[k] = static_cast<short>(sum);
+  }
+}
+
+//----------------------------------------------------------------------------
+PLUS_SIMD_TARGET("avx2")
+void vtkRfComputeAmplitudeAVX2(unsigned char* output, const short* inputSignal, const short* phaseShiftedSignal, int numberOfSamples, double brightnessScale)
+{
+  const __m256d scale = _mm256_set1_pd(brightnessScale);
+  int k = 0;
+  for (; k + 8 <= numberOfSamples; k += 8)
+  {
+    __m128i brightness0 = ComputeAmplitude(inputSignal + k, phaseShiftedSignal + k, scale);
+    __m128i brightness1 = ComputeAmplitude(inputSignal + k + 4, phaseShiftedSignal + k + 4, scale);
+    // values are already in the 0..255 range, so saturation does not change them
+    __m128i brightness16 = _mm_packs_epi32(brightness0, brightness1);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output + k), _mm_packus_epi16(brightness16, brightness16));
+  }
+  if (k < numberOfSamples)
+  {
+    // process the last few samples in zero-padded buffers
+    short inputSignalTail[8] = {0};
+    short phaseShiftedSignalTail[8] = {0};
+    unsigned char outputTail[8] = {0};
+    int numberOfTailSamples = numberOfSamples - k;
+    for (int i = 0; i < numberOfTailSamples; ++i)
+    {
+      inputSignalTail[i] = inputSignal[k + i];
+      phaseShiftedSignalTail[i] = phaseShiftedSignal[k + i];
+    }
+    vtkRfComputeAmplitudeAVX2(outputTail, inputSignalTail, phaseShiftedSignalTail, 8, brightnessScale);
+    for (int i = 0; i < numberOfTailSamples; ++i)
+    {
+      output[k + i] = outputTail[i];
+    }
+  }
+}
+
+#endif
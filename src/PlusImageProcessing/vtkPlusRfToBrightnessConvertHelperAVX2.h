@@ -0,0 +1,43 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusRfToBrightnessConvertHelperAVX2.h
+  \brief AVX2 implementation of Hilbert transform and envelope detection functions
+
+  The functions use AVX2 instructions, therefore they may only be called if PlusCpuFeatures::GetInstructionSet()
+  returns INSTRUCTION_SET_AVX2 (or higher). They are only available if PLUS_X86_SIMD is defined. Products, sums, and square roots are computed
+  in double precision in the same order as in the scalar loops (no fused multiply-add), so the
+  results are exactly the same.
+
+  \sa vtkPlusRfToBrightnessConvert
+  \ingroup PlusLibImageProcessingAlgo
+*/
+
+#ifndef __vtkPlusRfToBrightnessConvertHelperAVX2_h
+#define __vtkPlusRfToBrightnessConvertHelperAVX2_h
+
+#include "PlusCpuFeatures.h"
+
+#ifdef PLUS_X86_SIMD
+
+/*!
+  Convolve a signal with a filter:
+  output[k] = (short)(input[k]*coeffs[0] + input[k+1]*coeffs[1] + ... + input[k+numberOfCoeffs-1]*coeffs[numberOfCoeffs-1])
+  for k = 0..numberOfOutputSamples-1. The input must contain numberOfOutputSamples+numberOfCoeffs-1 samples.
+*/
+void vtkRfHilbertTransformConvolveAVX2(short* output, const short* input, int numberOfOutputSamples, const double* coeffs, int numberOfCoeffs);
+
+/*!
+  Compute compressed envelope from the original and the phase shifted signal:
+  output[k] = sqrt(sqrt(sqrt(inputSignal[k]^2+phaseShiftedSignal[k]^2)))*brightnessScale, clamped to 0..255
+  for k = 0..numberOfSamples-1.
+*/
+void vtkRfComputeAmplitudeAVX2(unsigned char* output, const short* inputSignal, const short* phaseShiftedSignal, int numberOfSamples, double brightnessScale);
+
+#endif
+
+#endif
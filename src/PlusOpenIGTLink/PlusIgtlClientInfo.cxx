@@ -16,6 +16,9 @@ PlusIgtlClientInfo::PlusIgtlClientInfo()
   , Resolution(0)
   , TDATARequested(false)
   , LastTDATASentTimeStamp(-1)
+  , SendQueueDepth(0)
+  , MaxSendQueueDepth(0)
+  , NumberOfDroppedMessages(0)
 {
 
 }
@@ -78,6 +78,15 @@ struct vtkPlusOpenIGTLinkExport PlusIgtlClientInfo
 
   /*! timestamp of the last sent TDATA message. */
   double LastTDATASentTimeStamp;
+
+  /*! Number of messages waiting in the server's outgoing queue for this client. Set by the server, not stored in the XML data. */
+  unsigned int SendQueueDepth;
+
+  /*! Largest number of messages that were waiting in the server's outgoing queue for this client. Set by the server, not stored in the XML data. */
+  unsigned int MaxSendQueueDepth;
+
+  /*! Number of messages that the server dropped because the client could not keep up. Set by the server, not stored in the XML data. */
+  unsigned long NumberOfDroppedMessages;
 };
 
 #endif
\ No newline at end of file
@@ -57,7 +57,7 @@ namespace igtl
     /*! Get the embedded transform of the underlying image */
     vtkSmartPointer<vtkMatrix4x4> GetEmbeddedImageTransform();
 
-  protected:
+    /*! Fixed size header of the message content, it is followed by the xml data and then the image data */
     class TrackedFrameHeader
     {
     public:
@@ -120,6 +120,7 @@ namespace igtl
       igtl::Matrix4x4 m_EmbeddedImageTransform; /* matrix representing the IJK to world transformation */
     };
 
+  protected:
     virtual int  CalculateContentBufferSize();
     virtual int  PackContent();
     virtual int  UnpackContent();
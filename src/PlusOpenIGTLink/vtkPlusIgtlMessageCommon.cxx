@@ -20,6 +20,7 @@ See License.txt for details.
 
 // OpenIGTLink includes
 #include <igtl_tdata.h>
+#include <igtl_util.h>
 
 // OpenIGTLinkIO includes
 #include <igtlioImageConverter.h>
@@ -414,6 +415,150 @@ PlusStatus vtkPlusIgtlMessageCommon::UnpackImageMessage(igtl::MessageHeader::Poi
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::ReceiveMessageBodyPart(igtl::Socket* socket, void* data, igtl_uint64 size, igtl_uint64* crc)
+{
+  if (socket == NULL)
+  {
+    LOG_ERROR("Unable to receive message body - socket is NULL!");
+    return PLUS_FAIL;
+  }
+  if (size == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  if (static_cast<igtl_uint64>(socket->Receive(data, size)) != size)
+  {
+    LOG_ERROR("Unable to receive message body - failed to receive " << size << " bytes from the socket");
+    return PLUS_FAIL;
+  }
+
+  if (crc != NULL)
+  {
+    *crc = crc64(static_cast<unsigned char*>(data), size, *crc);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::ReceiveImageMessageHeader(igtl::Socket* socket, igtl_image_header& imageHeader, igtl_uint64* crc)
+{
+  if (ReceiveMessageBodyPart(socket, &imageHeader, IGTL_IMAGE_HEADER_SIZE, crc) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Couldn't receive image header of image message from server!");
+    return PLUS_FAIL;
+  }
+
+  // The CRC is computed from the data in network byte order, so conversion is done after receiving
+  igtl_image_convert_byte_order(&imageHeader);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::GetImageTransformFromImageHeader(const igtl_image_header& imageHeader, vtkMatrix4x4* ijkToRasMatrix)
+{
+  if (ijkToRasMatrix == NULL)
+  {
+    LOG_ERROR("Unable to get image transform from image header - output matrix is NULL!");
+    return PLUS_FAIL;
+  }
+
+  igtl_image_header header = imageHeader;
+  float spacing[3] = { 0 };
+  float origin[3] = { 0 };
+  float normI[3] = { 0 };
+  float normJ[3] = { 0 };
+  float normK[3] = { 0 };
+  igtl_image_get_matrix(spacing, origin, normI, normJ, normK, &header);
+
+  // Set the geometry of an image message that has no pixel data, so that the transform is computed
+  // the same way as for image messages that are unpacked by UnpackImageMessage
+  igtl::ImageMessage::Pointer imgMsg = igtl::ImageMessage::New();
+  int size[3] = { header.size[0], header.size[1], header.size[2] };
+  int subvolumeSize[3] = { header.subvol_size[0], header.subvol_size[1], header.subvol_size[2] };
+  int subvolumeOffset[3] = { header.subvol_offset[0], header.subvol_offset[1], header.subvol_offset[2] };
+  imgMsg->SetDimensions(size);
+  imgMsg->SetSubVolume(subvolumeSize, subvolumeOffset);
+  imgMsg->SetSpacing(spacing);
+  imgMsg->SetScalarType(header.scalar_type);
+  imgMsg->SetNumComponents(header.num_components);
+  imgMsg->SetEndian(header.endian);
+  imgMsg->SetCoordinateSystem(header.coord);
+
+  igtl::Matrix4x4 matrix;
+  for (int i = 0; i < 3; ++i)
+  {
+    matrix[i][0] = normI[i];
+    matrix[i][1] = normJ[i];
+    matrix[i][2] = normK[i];
+    matrix[i][3] = origin[i];
+    matrix[3][i] = 0.0f;
+  }
+  matrix[3][3] = 1.0f;
+  imgMsg->SetMatrix(matrix);
+
+  if (igtlio::ImageConverter::IGTLImageToVTKTransform(imgMsg, ijkToRasMatrix) != 1)
+  {
+    LOG_ERROR("Unable to get image transform from image header - unable to extract IJKToRAS transform");
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::ReceiveTrackedFrameMessageHeader(igtl::Socket* socket, igtl_uint64 bodySize, igtl::PlusTrackedFrameMessage::TrackedFrameHeader& header, PlusTrackedFrame& trackedFrame, igtl_uint64* crc)
+{
+  if (socket == NULL)
+  {
+    LOG_ERROR("Unable to receive tracked frame message header - socket is NULL!");
+    return PLUS_FAIL;
+  }
+
+  igtl_uint64 headerSize = header.GetMessageHeaderSize();
+  if (bodySize < headerSize)
+  {
+    LOG_ERROR("Invalid tracked frame message received from server: body size (" << bodySize << " bytes) is smaller than the header size (" << headerSize << " bytes)");
+    socket->Skip(bodySize, 0);
+    return PLUS_FAIL;
+  }
+  if (ReceiveMessageBodyPart(socket, &header, headerSize, crc) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Couldn't receive header of tracked frame message from server!");
+    return PLUS_FAIL;
+  }
+  header.ConvertEndianness();
+  igtl_uint64 remainingSize = bodySize - headerSize;
+
+  // Check the size before allocating memory for the xml data, as it is read from the message
+  if (header.m_XmlDataSizeInBytes > remainingSize)
+  {
+    LOG_ERROR("Invalid tracked frame message received from server: xml data size (" << header.m_XmlDataSizeInBytes
+              << " bytes) is larger than the rest of the message body (" << remainingSize << " bytes)");
+    socket->Skip(remainingSize, 0);
+    return PLUS_FAIL;
+  }
+  std::string xmlData(header.m_XmlDataSizeInBytes, '\0');
+  if (!xmlData.empty() && ReceiveMessageBodyPart(socket, &xmlData[0], xmlData.size(), crc) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Couldn't receive xml data of tracked frame message from server!");
+    return PLUS_FAIL;
+  }
+  remainingSize -= xmlData.size();
+
+  if (trackedFrame.SetTrackedFrameFromXmlData(xmlData) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to set tracked frame data from xml received in Plus TrackedFrame message");
+    socket->Skip(remainingSize, 0);
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusIgtlMessageCommon::PackImageMetaMessage(igtl::ImageMetaMessage::Pointer imageMetaMessage,
     PlusCommon::ImageMetaDataList& imageMetaDataList)
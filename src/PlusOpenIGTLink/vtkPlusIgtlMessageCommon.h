@@ -26,6 +26,7 @@ See License.txt for details.
 #include <igtlStringMessage.h>
 #include <igtlTrackingDataMessage.h>
 #include <igtlTransformMessage.h>
+#include <igtl_image.h>
 
 class vtkXMLDataElement;
 class PlusTrackedFrame;
@@ -68,6 +69,33 @@ public:
   /*! Unpack image message to tracked frame */
   static PlusStatus UnpackImageMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket, PlusTrackedFrame& trackedFrame, const PlusTransformName& embeddedTransformName, int crccheck);
 
+  /*!
+    Receive the next part of a message body into the provided memory.
+    Allows receiving the pixel data of a message directly into its destination (e.g., a reserved buffer item).
+    If crc is not NULL then it is updated with the received data, so that the CRC of a message body that is received
+    in several parts can be compared to the CRC in the message header. The initial value is crc64(0, 0, 0LL).
+  */
+  static PlusStatus ReceiveMessageBodyPart(igtl::Socket* socket, void* data, igtl_uint64 size, igtl_uint64* crc);
+
+  /*!
+    Receive the image header of an IMAGE message body (the part that precedes the pixel data) and convert it to host byte order.
+    Only header version 1 messages are supported, as their body starts with the image header.
+  */
+  static PlusStatus ReceiveImageMessageHeader(igtl::Socket* socket, igtl_image_header& imageHeader, igtl_uint64* crc);
+
+  /*! Get the IJK to RAS transform of an image from an image header that is in host byte order */
+  static PlusStatus GetImageTransformFromImageHeader(const igtl_image_header& imageHeader, vtkMatrix4x4* ijkToRasMatrix);
+
+  /*!
+    Receive the fixed size header and the xml data of a TRACKEDFRAME message body (the parts that precede the pixel data).
+    The custom fields and transforms of the xml data are stored in trackedFrame, its image data is not changed.
+    Only header version 1 messages are supported, as their body starts with the fixed size header.
+    bodySize is the size of the whole message body. The header sizes are checked against it before memory is allocated.
+    If the message is invalid then the rest of the message body is skipped, so that the next message can be received
+    (nothing is skipped if receiving from the socket fails).
+  */
+  static PlusStatus ReceiveTrackedFrameMessageHeader(igtl::Socket* socket, igtl_uint64 bodySize, igtl::PlusTrackedFrameMessage::TrackedFrameHeader& header, PlusTrackedFrame& trackedFrame, igtl_uint64* crc);
+
   /*! Pack image meta deta message from vtkPlusServer::ImageMetaDataList  */
   static PlusStatus PackImageMetaMessage(igtl::ImageMetaMessage::Pointer imageMetaMessage, PlusCommon::ImageMetaDataList& imageMetaDataList);
 
@@ -32,8 +32,84 @@ See License.txt for details.
 
 //----------------------------------------------------------------------------
 
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Cache key part that identifies all image streams requested by a client */
+  std::string GetImageStreamsCacheKey(const PlusIgtlClientInfo& clientInfo)
+  {
+    std::string imageStreamsKey;
+    for (std::vector<PlusIgtlClientInfo::ImageStream>::const_iterator imageStreamIterator = clientInfo.ImageStreams.begin(); imageStreamIterator != clientInfo.ImageStreams.end(); ++imageStreamIterator)
+    {
+      imageStreamsKey += imageStreamIterator->Name + "To" + imageStreamIterator->EmbeddedTransformToFrame + ";";
+    }
+    return imageStreamsKey;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Cache key part that identifies the device that the tracked frame belongs to */
+  std::string GetDeviceCacheKey(PlusTrackedFrame& trackedFrame)
+  {
+    const char* deviceName = trackedFrame.GetCustomFrameField(PlusTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME);
+    return (deviceName != NULL ? deviceName : "");
+  }
+}
+
+//----------------------------------------------------------------------------
+
 vtkStandardNewMacro(vtkPlusIgtlMessageFactory);
 
+//----------------------------------------------------------------------------
+vtkPlusIgtlMessageFactory::PackedMessageCache::PackedMessageCache()
+  : NumberOfHits(0)
+  , NumberOfMisses(0)
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageFactory::PackedMessageCache::Clear()
+{
+  this->Messages.clear();
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlMessageFactory::PackedMessageCache::Find(const std::string& messageType, const std::string& deviceName, const std::string& embeddedTransformToFrame, int headerVersion, igtl::MessageBase::Pointer& message)
+{
+  std::map<KeyType, igtl::MessageBase::Pointer>::iterator it = this->Messages.find(KeyType(messageType, deviceName, embeddedTransformToFrame, headerVersion));
+  if (it == this->Messages.end())
+  {
+    this->NumberOfMisses++;
+    return false;
+  }
+  this->NumberOfHits++;
+  message = it->second;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageFactory::PackedMessageCache::Insert(const std::string& messageType, const std::string& deviceName, const std::string& embeddedTransformToFrame, int headerVersion, igtl::MessageBase::Pointer message)
+{
+  this->Messages[KeyType(messageType, deviceName, embeddedTransformToFrame, headerVersion)] = message;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusIgtlMessageFactory::PackedMessageCache::GetHitRate() const
+{
+  unsigned long numberOfLookups = this->NumberOfHits + this->NumberOfMisses;
+  if (numberOfLookups == 0)
+  {
+    return 0.0;
+  }
+  return static_cast<double>(this->NumberOfHits) / numberOfLookups;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlMessageFactory::PackedMessageCache::ResetStatistics()
+{
+  this->NumberOfHits = 0;
+  this->NumberOfMisses = 0;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusIgtlMessageFactory::vtkPlusIgtlMessageFactory()
   : IgtlFactory(igtl::MessageFactory::New())
@@ -127,7 +203,7 @@ igtl::MessageBase::Pointer vtkPlusIgtlMessageFactory::CreateSendMessage(const st
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtlMessages, PlusTrackedFrame& trackedFrame,
-    bool packValidTransformsOnly, vtkPlusTransformRepository* transformRepository/*=NULL*/)
+    bool packValidTransformsOnly, vtkPlusTransformRepository* transformRepository/*=NULL*/, PackedMessageCache* packedMessageCache/*=NULL*/)
 {
   int numberOfErrors(0);
   igtlMessages.clear();
@@ -165,6 +241,13 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
       {
         PlusIgtlClientInfo::ImageStream imageStream = (*imageStreamIterator);
 
+        igtl::MessageBase::Pointer cachedMessage;
+        if (packedMessageCache != NULL && packedMessageCache->Find(messageType, imageStream.Name, imageStream.EmbeddedTransformToFrame, clientInfo.ClientHeaderVersion, cachedMessage))
+        {
+          igtlMessages.push_back(cachedMessage);
+          continue;
+        }
+
         //Set transform name to [Name]To[CoordinateFrame]
         PlusTransformName imageTransformName = PlusTransformName(imageStream.Name, imageStream.EmbeddedTransformToFrame);
 
@@ -193,6 +276,10 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
           continue;
         }
         igtlMessages.push_back(imageMessage.GetPointer());
+        if (packedMessageCache != NULL)
+        {
+          packedMessageCache->Insert(messageType, imageStream.Name, imageStream.EmbeddedTransformToFrame, clientInfo.ClientHeaderVersion, imageMessage.GetPointer());
+        }
       }
     }
     // Transform message
@@ -201,6 +288,16 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
       for (std::vector<PlusTransformName>::const_iterator transformNameIterator = clientInfo.TransformNames.begin(); transformNameIterator != clientInfo.TransformNames.end(); ++transformNameIterator)
       {
         PlusTransformName transformName = (*transformNameIterator);
+        std::string transformNameStr;
+        transformName.GetTransformName(transformNameStr);
+
+        igtl::MessageBase::Pointer cachedMessage;
+        if (packedMessageCache != NULL && packedMessageCache->Find(messageType, transformNameStr, "", clientInfo.ClientHeaderVersion, cachedMessage))
+        {
+          igtlMessages.push_back(cachedMessage);
+          continue;
+        }
+
         bool isValid = false;
         transformRepository->GetTransformValid(transformName, isValid);
 
@@ -216,6 +313,10 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
         igtl::TransformMessage::Pointer transformMessage = dynamic_cast<igtl::TransformMessage*>(igtlMessage->Clone().GetPointer());
         vtkPlusIgtlMessageCommon::PackTransformMessage(transformMessage, transformName, igtlMatrix, trackedFrame.GetTimestamp());
         igtlMessages.push_back(transformMessage.GetPointer());
+        if (packedMessageCache != NULL)
+        {
+          packedMessageCache->Insert(messageType, transformNameStr, "", clientInfo.ClientHeaderVersion, transformMessage.GetPointer());
+        }
       }
     }
     // Tracking data message
@@ -261,6 +362,16 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
           pushing high frame-rate data from tracking devices.
         */
         PlusTransformName transformName = (*transformNameIterator);
+        std::string transformNameStr;
+        transformName.GetTransformName(transformNameStr);
+
+        igtl::MessageBase::Pointer cachedMessage;
+        if (packedMessageCache != NULL && packedMessageCache->Find(messageType, transformNameStr, "", clientInfo.ClientHeaderVersion, cachedMessage))
+        {
+          igtlMessages.push_back(cachedMessage);
+          continue;
+        }
+
         igtl::Matrix4x4 igtlMatrix;
         vtkPlusIgtlMessageCommon::GetIgtlMatrix(igtlMatrix, transformRepository, transformName);
 
@@ -271,13 +382,17 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
         igtl::PositionMessage::Pointer positionMessage = dynamic_cast<igtl::PositionMessage*>(igtlMessage->Clone().GetPointer());
         vtkPlusIgtlMessageCommon::PackPositionMessage(positionMessage, transformName, position, quaternion, trackedFrame.GetTimestamp());
         igtlMessages.push_back(positionMessage.GetPointer());
+        if (packedMessageCache != NULL)
+        {
+          packedMessageCache->Insert(messageType, transformNameStr, "", clientInfo.ClientHeaderVersion, positionMessage.GetPointer());
+        }
       }
     }
     // TRACKEDFRAME message
     else if (typeid(*igtlMessage) == typeid(igtl::PlusTrackedFrameMessage))
     {
-      igtl::PlusTrackedFrameMessage::Pointer trackedFrameMessage = dynamic_cast<igtl::PlusTrackedFrameMessage*>(igtlMessage->Clone().GetPointer());
-
+      // The requested transforms are stored in the tracked frame even if the message is found in the cache, so that
+      // messages packed later from the same tracked frame do not depend on whether this message was cached
       for (auto nameIter = clientInfo.TransformNames.begin(); nameIter != clientInfo.TransformNames.end(); ++nameIter)
       {
         bool isValid(false);
@@ -287,6 +402,24 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
         trackedFrame.SetCustomFrameTransformStatus(*nameIter, isValid ? FIELD_OK : FIELD_INVALID);
       }
 
+      // The content of the message depends on the device, the full list of requested transforms and the requested image streams
+      std::string transformNamesKey = GetDeviceCacheKey(trackedFrame) + ";";
+      for (auto nameIter = clientInfo.TransformNames.begin(); nameIter != clientInfo.TransformNames.end(); ++nameIter)
+      {
+        std::string transformNameStr;
+        nameIter->GetTransformName(transformNameStr);
+        transformNamesKey += transformNameStr + ";";
+      }
+      std::string imageStreamsKey = GetImageStreamsCacheKey(clientInfo);
+      igtl::MessageBase::Pointer cachedMessage;
+      if (packedMessageCache != NULL && packedMessageCache->Find(messageType, transformNamesKey, imageStreamsKey, clientInfo.ClientHeaderVersion, cachedMessage))
+      {
+        igtlMessages.push_back(cachedMessage);
+        continue;
+      }
+
+      igtl::PlusTrackedFrameMessage::Pointer trackedFrameMessage = dynamic_cast<igtl::PlusTrackedFrameMessage*>(igtlMessage->Clone().GetPointer());
+
       vtkSmartPointer<vtkMatrix4x4> imageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
       imageMatrix->Identity();
       if (!clientInfo.ImageStreams.empty())
@@ -305,10 +438,22 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
         continue;
       }
       igtlMessages.push_back(trackedFrameMessage.GetPointer());
+      if (packedMessageCache != NULL)
+      {
+        packedMessageCache->Insert(messageType, transformNamesKey, imageStreamsKey, clientInfo.ClientHeaderVersion, trackedFrameMessage.GetPointer());
+      }
     }
     // USMESSAGE message
     else if (typeid(*igtlMessage) == typeid(igtl::PlusUsMessage))
     {
+      std::string deviceKey = GetDeviceCacheKey(trackedFrame);
+      std::string imageStreamsKey = GetImageStreamsCacheKey(clientInfo);
+      igtl::MessageBase::Pointer cachedMessage;
+      if (packedMessageCache != NULL && packedMessageCache->Find(messageType, deviceKey, imageStreamsKey, clientInfo.ClientHeaderVersion, cachedMessage))
+      {
+        igtlMessages.push_back(cachedMessage);
+        continue;
+      }
       igtl::PlusUsMessage::Pointer usMessage = dynamic_cast<igtl::PlusUsMessage*>(igtlMessage->Clone().GetPointer());
       if (vtkPlusIgtlMessageCommon::PackUsMessage(usMessage, trackedFrame) != PLUS_SUCCESS)
       {
@@ -317,6 +462,10 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
         continue;
       }
       igtlMessages.push_back(usMessage.GetPointer());
+      if (packedMessageCache != NULL)
+      {
+        packedMessageCache->Insert(messageType, deviceKey, imageStreamsKey, clientInfo.ClientHeaderVersion, usMessage.GetPointer());
+      }
     }
     // String message
     else if (typeid(*igtlMessage) == typeid(igtl::StringMessage))
@@ -324,6 +473,12 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
       for (std::vector< std::string >::const_iterator stringNameIterator = clientInfo.StringNames.begin(); stringNameIterator != clientInfo.StringNames.end(); ++stringNameIterator)
       {
         const char* stringName = stringNameIterator->c_str();
+        igtl::MessageBase::Pointer cachedMessage;
+        if (packedMessageCache != NULL && packedMessageCache->Find(messageType, *stringNameIterator, "", clientInfo.ClientHeaderVersion, cachedMessage))
+        {
+          igtlMessages.push_back(cachedMessage);
+          continue;
+        }
         const char* stringValue = trackedFrame.GetCustomFrameField(stringName);
         if (stringValue == NULL)
         {
@@ -333,6 +488,10 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(const PlusIgtlClientInfo& cli
         igtl::StringMessage::Pointer stringMessage = dynamic_cast<igtl::StringMessage*>(igtlMessage->Clone().GetPointer());
         vtkPlusIgtlMessageCommon::PackStringMessage(stringMessage, stringName, stringValue, trackedFrame.GetTimestamp());
         igtlMessages.push_back(stringMessage.GetPointer());
+        if (packedMessageCache != NULL)
+        {
+          packedMessageCache->Insert(messageType, *stringNameIterator, "", clientInfo.ClientHeaderVersion, stringMessage.GetPointer());
+        }
       }
     }
     else if (typeid(*igtlMessage) == typeid(igtl::CommandMessage))
@@ -15,6 +15,9 @@
 #include "igtlMessageFactory.h"
 #include "PlusIgtlClientInfo.h" 
 
+#include <map>
+#include <tuple>
+
 class vtkXMLDataElement; 
 class PlusTrackedFrame; 
 class vtkPlusTransformRepository;
@@ -34,6 +37,48 @@ public:
   vtkTypeMacro(vtkPlusIgtlMessageFactory,vtkObject);
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
+  /*!
+    \class PackedMessageCache
+    \brief Stores packed IGTL messages of one tracked frame so that clients with identical subscriptions can share them
+
+    The cache key is (message type, device name, embedded transform "To" frame, header version). Messages stored
+    in the cache must not be modified after packing, as the same buffer is sent to all clients that request it.
+    Clear() must be called before packing messages of a new tracked frame. Hit/miss counters are preserved by Clear()
+    to allow computing the hit rate over many frames. Not thread safe, the caller is responsible for locking.
+  */
+  class vtkPlusOpenIGTLinkExport PackedMessageCache
+  {
+  public:
+    PackedMessageCache();
+
+    /*! Remove all cached messages (statistics are kept) */
+    void Clear();
+
+    /*! Look up a packed message. Returns true and sets message if found. */
+    bool Find(const std::string& messageType, const std::string& deviceName, const std::string& embeddedTransformToFrame, int headerVersion, igtl::MessageBase::Pointer& message);
+
+    /*! Store a packed message */
+    void Insert(const std::string& messageType, const std::string& deviceName, const std::string& embeddedTransformToFrame, int headerVersion, igtl::MessageBase::Pointer message);
+
+    /*! Number of lookups that returned an already packed message */
+    unsigned long GetNumberOfHits() const { return this->NumberOfHits; }
+
+    /*! Number of lookups that required packing a new message */
+    unsigned long GetNumberOfMisses() const { return this->NumberOfMisses; }
+
+    /*! Ratio of hits among all lookups since the last ResetStatistics() call. Returns 0 if there were no lookups. */
+    double GetHitRate() const;
+
+    /*! Reset hit and miss counters */
+    void ResetStatistics();
+
+  protected:
+    typedef std::tuple<std::string, std::string, std::string, int> KeyType;
+    std::map<KeyType, igtl::MessageBase::Pointer> Messages;
+    unsigned long NumberOfHits;
+    unsigned long NumberOfMisses;
+  };
+
   /*! Function pointer for storing New() static methods of igtl::MessageBase classes */ 
   typedef igtl::MessageBase::Pointer (*PointerToMessageBaseNew)(); 
 
@@ -70,9 +115,11 @@ public:
   \param igtMessages Output list for the generated IGTL messages
   \param trackedFrame Input tracked frame data used for IGTL message generation 
   \param transformRepository Transform repository used for computing the selected transforms 
+  \param packedMessageCache If not NULL then messages already packed for another client from the same tracked frame are reused
+    from this cache instead of being packed again, and newly packed messages are added to it
   */ 
   PlusStatus PackMessages(const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtMessages, PlusTrackedFrame& trackedFrame, 
-    bool packValidTransformsOnly, vtkPlusTransformRepository* transformRepository=NULL); 
+    bool packValidTransformsOnly, vtkPlusTransformRepository* transformRepository=NULL, PackedMessageCache* packedMessageCache=NULL); 
 
 protected:
   vtkPlusIgtlMessageFactory();
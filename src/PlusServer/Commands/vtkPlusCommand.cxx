@@ -14,6 +14,9 @@
 
 const std::string vtkPlusCommand::DEVICE_NAME_COMMAND = "CMD";
 const std::string vtkPlusCommand::DEVICE_NAME_REPLY = "ACK";
+const std::string vtkPlusCommand::RECORDED_FILES_ORDERING_KEY = "RecordedFiles";
+const std::string vtkPlusCommand::TRANSFORM_REPOSITORY_ORDERING_KEY = "TransformRepository";
+const std::string vtkPlusCommand::CONFIGURATION_ORDERING_KEY = "Configuration";
 
 //----------------------------------------------------------------------------
 vtkPlusCommand::vtkPlusCommand()
@@ -35,6 +38,18 @@ void vtkPlusCommand::PrintSelf(ostream& os, vtkIndent indent)
   this->Superclass::PrintSelf(os, indent);
 }
 
+//----------------------------------------------------------------------------
+vtkPlusCommand::ExecutionLaneType vtkPlusCommand::GetExecutionLane()
+{
+  return EXECUTION_LANE_FAST;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommand::GetOrderingKeys(std::list<std::string>& keys)
+{
+  keys.clear();
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
 {
@@ -30,6 +30,34 @@ class vtkPlusServerExport vtkPlusCommand : public vtkObject
 public:
   static const std::string DEVICE_NAME_COMMAND;
   static const std::string DEVICE_NAME_REPLY;
+  /*!
+    Ordering key of commands that write or read recorded sequence files. Ensures that a file is only read
+    (e.g., by volume reconstruction) after the command that writes it (e.g., stop recording) is completed.
+  */
+  static const std::string RECORDED_FILES_ORDERING_KEY;
+  /*!
+    Ordering key of commands that modify the transform repository (e.g., UpdateTransform) and of commands that use its
+    content (e.g., SaveConfig, volume reconstruction). GetTransform does not use this key, so that reading a transform
+    is not delayed by a long-running reconstruction: it only reads one transform from the thread-safe repository,
+    therefore executing it before a queued command that reads the repository does not change the result of either one.
+    It may also be executed before an UpdateTransform that was queued earlier but is still waiting for a long-running
+    command; clients that need the updated value have to wait for the UpdateTransform reply before sending GetTransform.
+  */
+  static const std::string TRANSFORM_REPOSITORY_ORDERING_KEY;
+  /*!
+    Ordering key of commands that modify or write the device set configuration (e.g., SaveConfig, stop recording
+    writes it next to the recorded file).
+  */
+  static const std::string CONFIGURATION_ORDERING_KEY;
+
+  /*! Execution lanes of the command processor (see vtkPlusCommandProcessor) */
+  enum ExecutionLaneType
+  {
+    /*! Lightweight command, executed right away by the thread that processes the command queue */
+    EXECUTION_LANE_FAST,
+    /*! Long-running command, executed by a worker thread so that it does not delay the other commands */
+    EXECUTION_LANE_WORKER
+  };
 
   virtual vtkPlusCommand* Clone() = 0;
 
@@ -41,6 +69,22 @@ public:
   */
   virtual PlusStatus Execute() = 0;
 
+  /*!
+    Get the lane where the command has to be executed. The command name and parameters are already read
+    when this method is called. Default: EXECUTION_LANE_FAST.
+  */
+  virtual ExecutionLaneType GetExecutionLane();
+
+  /*!
+    Get the ordering keys of the command. Commands that have a common ordering key are executed in the order
+    they were queued, even if they are executed in different lanes. Typically a key is the id of the device that
+    the command operates on. The keys are queried by the command processing thread right before the command is executed or passed
+    to a worker thread, therefore if the device is not specified in the command then the id of the device
+    that would be used by default has to be returned.
+    No keys are returned if the command does not have to be ordered with other commands (default).
+  */
+  virtual void GetOrderingKeys(std::list<std::string>& keys);
+
   /*! Read command parameters from XML */
   virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
 
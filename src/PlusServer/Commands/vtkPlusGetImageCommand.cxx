@@ -64,6 +64,29 @@ std::string vtkPlusGetImageCommand::GetDescription(const std::string& commandNam
   return desc;
 }
 
+//----------------------------------------------------------------------------
+vtkPlusCommand::ExecutionLaneType vtkPlusGetImageCommand::GetExecutionLane()
+{
+  return (PlusCommon::IsEqualInsensitive(this->Name, GET_IMAGE) ? EXECUTION_LANE_WORKER : EXECUTION_LANE_FAST);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetImageCommand::GetOrderingKeys(std::list<std::string>& keys)
+{
+  keys.clear();
+  if (!PlusCommon::IsEqualInsensitive(this->Name, GET_IMAGE))
+  {
+    // Image meta data is collected from all devices, it does not have to wait for other commands
+    return;
+  }
+  // Image id is DeviceId-ImageId, the command fails if the device is not specified
+  size_t dashFound = this->ImageId.find_last_of(DeviceNameImageIdSeparator);
+  if (dashFound != std::string::npos)
+  {
+    keys.push_back(this->ImageId.substr(0, dashFound));
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusGetImageCommand::SetNameToGetImageMeta()
 {
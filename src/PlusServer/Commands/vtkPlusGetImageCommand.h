@@ -37,6 +37,12 @@ public:
   /*! Gets the description for the specified command name. */
   virtual std::string GetDescription(const std::string& commandName);
 
+  /*! Getting an image is executed in the worker lane */
+  virtual ExecutionLaneType GetExecutionLane();
+
+  /*! Getting an image is executed in order with the other commands of the same device */
+  virtual void GetOrderingKeys(std::list<std::string>& keys);
+
   void SetNameToGetImageMeta();
   void SetNameToGetImage();
 
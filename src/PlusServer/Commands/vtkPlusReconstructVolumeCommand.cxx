@@ -135,6 +135,48 @@ std::string vtkPlusReconstructVolumeCommand::GetDescription(const std::string& c
   return desc;
 }
 
+//----------------------------------------------------------------------------
+vtkPlusCommand::ExecutionLaneType vtkPlusReconstructVolumeCommand::GetExecutionLane()
+{
+  if (PlusCommon::IsEqualInsensitive(this->Name, RECONSTRUCT_PRERECORDED_CMD)
+      || PlusCommon::IsEqualInsensitive(this->Name, STOP_LIVE_RECONSTRUCTION_CMD)
+      || PlusCommon::IsEqualInsensitive(this->Name, GET_LIVE_RECONSTRUCTION_SNAPSHOT_CMD))
+  {
+    return EXECUTION_LANE_WORKER;
+  }
+  return EXECUTION_LANE_FAST;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusReconstructVolumeCommand::GetOrderingKeys(std::list<std::string>& keys)
+{
+  keys.clear();
+  if (!this->VolumeReconstructorDeviceId.empty())
+  {
+    keys.push_back(this->VolumeReconstructorDeviceId);
+  }
+  else
+  {
+    // If the device is not specified then the first volume reconstructor device is used
+    vtkPlusVirtualVolumeReconstructor* reconstructorDevice = GetVolumeReconstructorDevice();
+    if (reconstructorDevice != NULL)
+    {
+      keys.push_back(reconstructorDevice->GetDeviceId());
+    }
+  }
+  if (PlusCommon::IsEqualInsensitive(this->Name, RECONSTRUCT_PRERECORDED_CMD))
+  {
+    // The input file may be written by a previous command (e.g., stop recording)
+    keys.push_back(RECORDED_FILES_ORDERING_KEY);
+  }
+  if (PlusCommon::IsEqualInsensitive(this->Name, RECONSTRUCT_PRERECORDED_CMD)
+      || PlusCommon::IsEqualInsensitive(this->Name, START_LIVE_RECONSTRUCTION_CMD))
+  {
+    // The transforms are copied from the repository
+    keys.push_back(TRANSFORM_REPOSITORY_ORDERING_KEY);
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusReconstructVolumeCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
 {
@@ -44,6 +44,16 @@ public:
   /*! Gets the description for the specified command name. */
   virtual std::string GetDescription(const std::string& commandName);
 
+  /*! Reconstruction from file, stopping and getting a snapshot of a live reconstruction are executed in the worker lane */
+  virtual ExecutionLaneType GetExecutionLane();
+
+  /*!
+    Commands of the same volume reconstructor device are executed in order. Reconstruction from file is also ordered with
+    commands that write recorded files (see RECORDED_FILES_ORDERING_KEY). Commands that copy the transform repository
+    to the device are ordered with the commands that modify it (see TRANSFORM_REPOSITORY_ORDERING_KEY).
+  */
+  virtual void GetOrderingKeys(std::list<std::string>& keys);
+
   /*! File name of the sequence file that contains the image frames */
   vtkGetStdStringMacro(InputSeqFilename);
   vtkSetStdStringMacro(InputSeqFilename);
@@ -55,6 +55,14 @@ std::string vtkPlusSaveConfigCommand::GetDescription(const std::string& commandN
   return desc;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusSaveConfigCommand::GetOrderingKeys(std::list<std::string>& keys)
+{
+  keys.clear();
+  keys.push_back(TRANSFORM_REPOSITORY_ORDERING_KEY);
+  keys.push_back(CONFIGURATION_ORDERING_KEY);
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusSaveConfigCommand::PrintSelf(ostream& os, vtkIndent indent)
 {
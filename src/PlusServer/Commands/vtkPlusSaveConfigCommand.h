@@ -42,6 +42,12 @@ public:
   /*! Gets the description for the specified command name. */
   virtual std::string GetDescription(const std::string& commandName);
 
+  /*!
+    Ordered with the commands that modify the transform repository or use the device set configuration
+    (see TRANSFORM_REPOSITORY_ORDERING_KEY and CONFIGURATION_ORDERING_KEY)
+  */
+  virtual void GetOrderingKeys(std::list<std::string>& keys);
+
   vtkGetStdStringMacro(Filename);
   vtkSetStdStringMacro(Filename);
 
@@ -93,6 +93,44 @@ vtkPlusCommand* vtkPlusStartStopRecordingCommand::Clone()
   return New();
 }
 
+//----------------------------------------------------------------------------
+vtkPlusCommand::ExecutionLaneType vtkPlusStartStopRecordingCommand::GetExecutionLane()
+{
+  return (PlusCommon::IsEqualInsensitive(this->Name, STOP_CMD) ? EXECUTION_LANE_WORKER : EXECUTION_LANE_FAST);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusStartStopRecordingCommand::GetOrderingKeys(std::list<std::string>& keys)
+{
+  keys.clear();
+  // Resolve the capture device the same way as Execute does, but do not create a new device
+  std::string captureDeviceId = this->CaptureDeviceId;
+  if (captureDeviceId.empty() && !this->ChannelId.empty())
+  {
+    vtkPlusVirtualCapture* captureDevice = FindCaptureDevice(this->ChannelId);
+    captureDeviceId = (captureDevice != NULL ? captureDevice->GetDeviceId() : this->ChannelId + "_capture");
+  }
+  else if (captureDeviceId.empty())
+  {
+    vtkPlusVirtualCapture* captureDevice = GetCaptureDevice(captureDeviceId);
+    if (captureDevice != NULL)
+    {
+      captureDeviceId = captureDevice->GetDeviceId();
+    }
+  }
+  if (!captureDeviceId.empty())
+  {
+    keys.push_back(captureDeviceId);
+  }
+  if (PlusCommon::IsEqualInsensitive(this->Name, STOP_CMD))
+  {
+    // The recorded file may be read by the next command (e.g., volume reconstruction)
+    keys.push_back(RECORDED_FILES_ORDERING_KEY);
+    // The device set configuration is saved next to the recorded file
+    keys.push_back(CONFIGURATION_ORDERING_KEY);
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusStartStopRecordingCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
 {
@@ -214,24 +252,7 @@ vtkPlusVirtualCapture* vtkPlusStartStopRecordingCommand::GetOrCreateCaptureDevic
     return nullptr;
   }
 
-  vtkPlusVirtualCapture* foundDevice(nullptr);
-  for (auto iter = dataCollector->GetDeviceConstIteratorBegin(); iter != dataCollector->GetDeviceConstIteratorEnd(); ++iter)
-  {
-    if (dynamic_cast<vtkPlusVirtualCapture*>(*iter) != nullptr)
-    {
-      std::vector<vtkPlusDevice*> devices;
-      (*iter)->GetInputDevices(devices);
-      for (auto it = devices.begin(); it != devices.end(); ++it)
-      {
-        vtkPlusChannel* aChannel;
-        if ((*it)->GetOutputChannelByName(aChannel, channelId) == PLUS_SUCCESS)
-        {
-          foundDevice = dynamic_cast<vtkPlusVirtualCapture*>(*iter);
-        }
-      }
-    }
-  }
-
+  vtkPlusVirtualCapture* foundDevice = FindCaptureDevice(channelId);
   if (foundDevice != nullptr)
   {
     return foundDevice;
@@ -257,6 +278,36 @@ vtkPlusVirtualCapture* vtkPlusStartStopRecordingCommand::GetOrCreateCaptureDevic
   return capDevice;
 }
 
+//----------------------------------------------------------------------------
+vtkPlusVirtualCapture* vtkPlusStartStopRecordingCommand::FindCaptureDevice(const std::string& channelId)
+{
+  vtkPlusDataCollector* dataCollector = GetDataCollector();
+  if (dataCollector == NULL)
+  {
+    LOG_ERROR("Data collector is invalid");
+    return nullptr;
+  }
+
+  vtkPlusVirtualCapture* foundDevice(nullptr);
+  for (auto iter = dataCollector->GetDeviceConstIteratorBegin(); iter != dataCollector->GetDeviceConstIteratorEnd(); ++iter)
+  {
+    if (dynamic_cast<vtkPlusVirtualCapture*>(*iter) != nullptr)
+    {
+      std::vector<vtkPlusDevice*> devices;
+      (*iter)->GetInputDevices(devices);
+      for (auto it = devices.begin(); it != devices.end(); ++it)
+      {
+        vtkPlusChannel* aChannel;
+        if ((*it)->GetOutputChannelByName(aChannel, channelId) == PLUS_SUCCESS)
+        {
+          foundDevice = dynamic_cast<vtkPlusVirtualCapture*>(*iter);
+        }
+      }
+    }
+  }
+  return foundDevice;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusStartStopRecordingCommand::Execute()
 {
@@ -268,14 +319,15 @@ PlusStatus vtkPlusStartStopRecordingCommand::Execute()
     return PLUS_FAIL;
   }
 
-  vtkPlusVirtualCapture* captureDevice;
-  if (!this->CaptureDeviceId.empty())
+  vtkPlusVirtualCapture* captureDevice = NULL;
+  if (this->CaptureDeviceId.empty() && !this->ChannelId.empty())
   {
-    captureDevice = GetCaptureDevice(this->CaptureDeviceId);
+    captureDevice = GetOrCreateCaptureDevice(this->ChannelId);
   }
-  else if (!this->ChannelId.empty())
+  else
   {
-    captureDevice = GetOrCreateCaptureDevice(this->ChannelId);
+    // If no capture device is specified then the first one is used
+    captureDevice = GetCaptureDevice(this->CaptureDeviceId);
   }
 
   if (captureDevice == NULL)
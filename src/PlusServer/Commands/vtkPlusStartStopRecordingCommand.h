@@ -43,6 +43,16 @@ public:
   /*! Gets the description for the specified command name. */
   virtual std::string GetDescription(const std::string& commandName);
 
+  /*! Stopping (and saving) a recording is executed in the worker lane */
+  virtual ExecutionLaneType GetExecutionLane();
+
+  /*!
+    Commands of the same capture device are executed in order. Stopping a recording is also ordered with
+    commands that read recorded files (see RECORDED_FILES_ORDERING_KEY) and with the commands that modify the device set
+    configuration, which is written next to the recorded file (see CONFIGURATION_ORDERING_KEY).
+  */
+  virtual void GetOrderingKeys(std::list<std::string>& keys);
+
   vtkGetStdStringMacro(OutputFilename);
   vtkSetStdStringMacro(OutputFilename);
 
@@ -72,6 +82,12 @@ public:
   */
   vtkPlusVirtualCapture* GetOrCreateCaptureDevice(const std::string& channelId);
 
+  /*!
+    Helper function to get pointer to an existing capture device that records the specified channel
+    \param channelId Channel ID. Returns NULL if no capture device records this channel.
+  */
+  vtkPlusVirtualCapture* FindCaptureDevice(const std::string& channelId);
+
 protected:
   vtkPlusStartStopRecordingCommand();
   virtual ~vtkPlusStartStopRecordingCommand();
@@ -67,6 +67,31 @@ void vtkPlusStealthLinkCommand::SetNameToGetExam()
   this->SetName(GET_STEALTHLINK_EXAM_DATA_CMD);
 }
 
+//----------------------------------------------------------------------------
+vtkPlusCommand::ExecutionLaneType vtkPlusStealthLinkCommand::GetExecutionLane()
+{
+  return EXECUTION_LANE_WORKER;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusStealthLinkCommand::GetOrderingKeys(std::list<std::string>& keys)
+{
+  keys.clear();
+  // The transforms are copied from the repository
+  keys.push_back(TRANSFORM_REPOSITORY_ORDERING_KEY);
+  if (!this->StealthLinkDeviceId.empty())
+  {
+    keys.push_back(this->StealthLinkDeviceId);
+    return;
+  }
+  // If the device is not specified then the first StealthLink device is used
+  vtkPlusStealthLinkTracker* stealthLinkDevice = GetStealthLinkDevice();
+  if (stealthLinkDevice != NULL)
+  {
+    keys.push_back(stealthLinkDevice->GetDeviceId());
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusStealthLinkCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
 {
@@ -43,6 +43,12 @@ public:
   /*! Gets the description for the specified command name. */
   virtual std::string GetDescription(const std::string& commandName);
 
+  /*! Getting exam data is executed in the worker lane */
+  virtual ExecutionLaneType GetExecutionLane();
+
+  /*! Commands of the same StealthLink device are executed in order, and after the preceding changes of the transform repository */
+  virtual void GetOrderingKeys(std::list<std::string>& keys);
+
   /*! Id of the stealthlink device */
   vtkGetStdStringMacro(StealthLinkDeviceId);
   vtkSetStdStringMacro(StealthLinkDeviceId);
@@ -57,6 +57,13 @@ std::string vtkPlusUpdateTransformCommand::GetDescription(const std::string& com
   return desc;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusUpdateTransformCommand::GetOrderingKeys(std::list<std::string>& keys)
+{
+  keys.clear();
+  keys.push_back(TRANSFORM_REPOSITORY_ORDERING_KEY);
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusUpdateTransformCommand::PrintSelf(ostream& os, vtkIndent indent)
 {
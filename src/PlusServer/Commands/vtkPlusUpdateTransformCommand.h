@@ -41,6 +41,9 @@ public:
   /*! Gets the description for the specified command name. */
   virtual std::string GetDescription(const std::string& commandName);
 
+  /*! Ordered with the commands that use the transform repository (see TRANSFORM_REPOSITORY_ORDERING_KEY) */
+  virtual void GetOrderingKeys(std::list<std::string>& keys);
+
   vtkGetStdStringMacro(TransformName);
   vtkSetStdStringMacro(TransformName);
 
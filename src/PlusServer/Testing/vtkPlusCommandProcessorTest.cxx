@@ -0,0 +1,294 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusCommandProcessorTest.cxx
+  \brief Tests execution lanes and command ordering of vtkPlusCommandProcessor
+
+  Test commands that only wait for a specified time are queued in the processor. Checks that lightweight commands
+  are not delayed by long-running commands, long-running commands that do not have a common ordering key are executed
+  in parallel, and commands that have a common ordering key are executed in the order they were queued (even if a command
+  has multiple keys, such as a reconstruction from file that has to wait for the recording that writes the file).
+  Without worker threads all commands have to be executed in the order they were queued.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkPlusCommand.h"
+#include "vtkPlusCommandProcessor.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkXMLDataElement.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  const std::string TEST_FAST_CMD = "TestFastCommand";
+  const std::string TEST_WORKER_CMD = "TestWorkerCommand";
+
+  struct ExecutionRecord
+  {
+    std::string Label;
+    double StartTime;
+    double EndTime;
+  };
+
+  std::mutex ExecutionLogMutex;
+  std::vector<ExecutionRecord> ExecutionLog;
+}
+
+//----------------------------------------------------------------------------
+/*! Command that waits for the specified time and records when it was executed */
+class vtkPlusTestCommand : public vtkPlusCommand
+{
+public:
+  static vtkPlusTestCommand* New();
+  vtkTypeMacro(vtkPlusTestCommand, vtkPlusCommand);
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  virtual PlusStatus Execute()
+  {
+    ExecutionRecord record;
+    record.Label = this->Label;
+    record.StartTime = vtkPlusAccurateTimer::GetSystemTime();
+    if (this->DurationSec > 0)
+    {
+      vtkPlusAccurateTimer::Delay(this->DurationSec);
+    }
+    record.EndTime = vtkPlusAccurateTimer::GetSystemTime();
+    std::lock_guard<std::mutex> logLock(ExecutionLogMutex);
+    ExecutionLog.push_back(record);
+    return PLUS_SUCCESS;
+  }
+
+  virtual void GetCommandNames(std::list<std::string>& cmdNames)
+  {
+    cmdNames.clear();
+    cmdNames.push_back(TEST_FAST_CMD);
+    cmdNames.push_back(TEST_WORKER_CMD);
+  }
+
+  virtual std::string GetDescription(const std::string& commandName)
+  {
+    return "Test command";
+  }
+
+  virtual ExecutionLaneType GetExecutionLane()
+  {
+    return (PlusCommon::IsEqualInsensitive(this->Name, TEST_WORKER_CMD) ? EXECUTION_LANE_WORKER : EXECUTION_LANE_FAST);
+  }
+
+  virtual void GetOrderingKeys(std::list<std::string>& keys)
+  {
+    keys = this->OrderingKeys;
+  }
+
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig)
+  {
+    if (vtkPlusCommand::ReadConfiguration(aConfig) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    XML_READ_STRING_ATTRIBUTE_OPTIONAL(Label, aConfig);
+    XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, DurationSec, aConfig);
+    const char* orderingKeys = aConfig->GetAttribute("OrderingKeys");
+    if (orderingKeys != NULL)
+    {
+      std::istringstream keysStream(orderingKeys);
+      std::string key;
+      while (keysStream >> key)
+      {
+        this->OrderingKeys.push_back(key);
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  vtkSetStdStringMacro(Label);
+  vtkSetMacro(DurationSec, double);
+
+protected:
+  vtkPlusTestCommand() : DurationSec(0) {}
+
+  std::string Label;
+  double DurationSec;
+  std::list<std::string> OrderingKeys;
+
+private:
+  vtkPlusTestCommand(const vtkPlusTestCommand&);
+  void operator=(const vtkPlusTestCommand&);
+};
+
+vtkStandardNewMacro(vtkPlusTestCommand);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  PlusStatus QueueTestCommand(vtkPlusCommandProcessor* processor, const std::string& commandName, const std::string& label, const std::string& orderingKeys, double durationSec)
+  {
+    static uint32_t uid = 0;
+    std::ostringstream commandString;
+    commandString << "<Command Name=\"" << commandName << "\" Label=\"" << label << "\" OrderingKeys=\"" << orderingKeys << "\" DurationSec=\"" << durationSec << "\" />";
+    return processor->QueueCommand(false, 0, commandName, commandString.str(), "", ++uid);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Execute the queued commands and wait until the specified number of commands are completed */
+  PlusStatus ExecuteTestCommands(vtkPlusCommandProcessor* processor, unsigned int numberOfCommands, std::map<std::string, ExecutionRecord>& records)
+  {
+    const double timeoutSec = 10.0;
+    double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    while (true)
+    {
+      processor->ExecuteCommands();
+      {
+        std::lock_guard<std::mutex> logLock(ExecutionLogMutex);
+        if (ExecutionLog.size() >= numberOfCommands)
+        {
+          break;
+        }
+      }
+      if (vtkPlusAccurateTimer::GetSystemTime() - startTime > timeoutSec)
+      {
+        LOG_ERROR("Not all of the " << numberOfCommands << " commands were executed in " << timeoutSec << " seconds");
+        processor->Stop();
+        return PLUS_FAIL;
+      }
+      vtkPlusAccurateTimer::Delay(0.010);
+    }
+    // Wait for the worker threads
+    processor->Stop();
+
+    std::lock_guard<std::mutex> logLock(ExecutionLogMutex);
+    records.clear();
+    for (std::vector<ExecutionRecord>::iterator record = ExecutionLog.begin(); record != ExecutionLog.end(); ++record)
+    {
+      if (records.find(record->Label) != records.end())
+      {
+        LOG_ERROR("Command " << record->Label << " was executed multiple times");
+        return PLUS_FAIL;
+      }
+      records[record->Label] = *record;
+    }
+    if (ExecutionLog.size() != numberOfCommands)
+    {
+      LOG_ERROR(ExecutionLog.size() << " commands were executed, expected " << numberOfCommands);
+      return PLUS_FAIL;
+    }
+    ExecutionLog.clear();
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckStartedAfter(std::map<std::string, ExecutionRecord>& records, const std::string& label, const std::string& previousLabel)
+  {
+    if (records[label].StartTime < records[previousLabel].EndTime)
+    {
+      LOG_ERROR(label << " was started before " << previousLabel << " was completed");
+      return 1;
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckStartedBefore(std::map<std::string, ExecutionRecord>& records, const std::string& label, const std::string& otherLabel, bool completed)
+  {
+    double time = (completed ? records[label].EndTime : records[label].StartTime);
+    if (time >= records[otherLabel].EndTime)
+    {
+      LOG_ERROR(label << " was " << (completed ? "completed" : "started") << " after " << otherLabel << " was completed");
+      return 1;
+    }
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = 0;
+  std::map<std::string, ExecutionRecord> records;
+
+  // Lane dispatch and ordering with worker threads
+  {
+    vtkSmartPointer<vtkPlusCommandProcessor> processor = vtkSmartPointer<vtkPlusCommandProcessor>::New();
+    processor->RegisterPlusCommand(vtkSmartPointer<vtkPlusTestCommand>::New());
+    processor->SetNumberOfWorkerThreads(2);
+    QueueTestCommand(processor, TEST_WORKER_CMD, "StopRecording", "Capture1 RecordedFiles", 0.3);
+    QueueTestCommand(processor, TEST_WORKER_CMD, "ReconstructFromFile", "Reconstructor1 RecordedFiles", 0.1);
+    QueueTestCommand(processor, TEST_WORKER_CMD, "GetSnapshot", "Reconstructor1", 0.05);
+    QueueTestCommand(processor, TEST_FAST_CMD, "GetTransform", "", 0);
+    QueueTestCommand(processor, TEST_WORKER_CMD, "GetOtherImage", "Device2", 0.05);
+    QueueTestCommand(processor, TEST_FAST_CMD, "StartRecording", "Capture1", 0);
+    if (ExecuteTestCommands(processor, 6, records) != PLUS_SUCCESS)
+    {
+      numberOfErrors++;
+    }
+    else
+    {
+      // Lightweight commands are not delayed by long-running ones
+      numberOfErrors += CheckStartedBefore(records, "GetTransform", "StopRecording", true);
+      // Commands without common keys are executed in parallel
+      numberOfErrors += CheckStartedBefore(records, "GetOtherImage", "StopRecording", false);
+      // Commands with common keys are executed in order, also across lanes and through multiple keys
+      numberOfErrors += CheckStartedAfter(records, "ReconstructFromFile", "StopRecording");
+      numberOfErrors += CheckStartedAfter(records, "GetSnapshot", "ReconstructFromFile");
+      numberOfErrors += CheckStartedAfter(records, "StartRecording", "StopRecording");
+    }
+  }
+
+  // All commands are executed in order without worker threads
+  {
+    vtkSmartPointer<vtkPlusCommandProcessor> processor = vtkSmartPointer<vtkPlusCommandProcessor>::New();
+    processor->RegisterPlusCommand(vtkSmartPointer<vtkPlusTestCommand>::New());
+    processor->SetNumberOfWorkerThreads(0);
+    QueueTestCommand(processor, TEST_WORKER_CMD, "First", "Capture1", 0.05);
+    QueueTestCommand(processor, TEST_FAST_CMD, "Second", "", 0);
+    QueueTestCommand(processor, TEST_WORKER_CMD, "Third", "Device2", 0.05);
+    if (ExecuteTestCommands(processor, 3, records) != PLUS_SUCCESS)
+    {
+      numberOfErrors++;
+    }
+    else
+    {
+      numberOfErrors += CheckStartedAfter(records, "Second", "First");
+      numberOfErrors += CheckStartedAfter(records, "Third", "Second");
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
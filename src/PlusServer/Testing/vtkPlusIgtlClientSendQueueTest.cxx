@@ -0,0 +1,159 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusIgtlClientSendQueueTest.cxx
+  \brief Tests the size limits of vtkPlusIgtlClientSendQueue
+
+  Checks that droppable messages are discarded when the queue is full, messages that must not be dropped are queued
+  beyond the maximum number of queued messages, and once the hard limit is reached the queue is cleared and marked as failed
+  (so that the server would disconnect the client) instead of growing without bounds.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusIgtlClientSendQueue.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// IGTL includes
+#include <igtlImageMessage.h>
+#include <igtlStatusMessage.h>
+
+namespace
+{
+  const unsigned int MAX_NUMBER_OF_QUEUED_MESSAGES = 5;
+
+  //----------------------------------------------------------------------------
+  igtl::MessageBase::Pointer CreateDroppableMessage()
+  {
+    igtl::ImageMessage::Pointer message = igtl::ImageMessage::New();
+    message->SetDeviceName("Image");
+    return message.GetPointer();
+  }
+
+  //----------------------------------------------------------------------------
+  igtl::MessageBase::Pointer CreateNonDroppableMessage()
+  {
+    igtl::StatusMessage::Pointer message = igtl::StatusMessage::New();
+    message->SetDeviceName("Status");
+    return message.GetPointer();
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = 0;
+
+  // Droppable messages do not grow the queue beyond its maximum size
+  {
+    vtkSmartPointer<vtkPlusIgtlClientSendQueue> sendQueue = vtkSmartPointer<vtkPlusIgtlClientSendQueue>::New();
+    sendQueue->SetMaxNumberOfQueuedMessages(MAX_NUMBER_OF_QUEUED_MESSAGES);
+    for (unsigned int i = 0; i < 3 * MAX_NUMBER_OF_QUEUED_MESSAGES; ++i)
+    {
+      sendQueue->PushMessage(CreateDroppableMessage());
+    }
+    if (sendQueue->GetNumberOfQueuedMessages() != MAX_NUMBER_OF_QUEUED_MESSAGES)
+    {
+      LOG_ERROR("Send queue contains " << sendQueue->GetNumberOfQueuedMessages() << " droppable messages, expected " << MAX_NUMBER_OF_QUEUED_MESSAGES);
+      numberOfErrors++;
+    }
+    if (sendQueue->GetNumberOfDroppedMessages() != 2 * MAX_NUMBER_OF_QUEUED_MESSAGES)
+    {
+      LOG_ERROR(sendQueue->GetNumberOfDroppedMessages() << " messages were dropped, expected " << 2 * MAX_NUMBER_OF_QUEUED_MESSAGES);
+      numberOfErrors++;
+    }
+    if (sendQueue->GetSendFailed())
+    {
+      LOG_ERROR("Send queue failed although only droppable messages were queued");
+      numberOfErrors++;
+    }
+  }
+
+  // Messages that must not be dropped are queued beyond the maximum size, but not beyond the hard limit
+  {
+    vtkSmartPointer<vtkPlusIgtlClientSendQueue> sendQueue = vtkSmartPointer<vtkPlusIgtlClientSendQueue>::New();
+    sendQueue->SetMaxNumberOfQueuedMessages(MAX_NUMBER_OF_QUEUED_MESSAGES);
+    unsigned int hardLimit = sendQueue->GetHardMaxNumberOfQueuedMessages();
+    if (hardLimit <= MAX_NUMBER_OF_QUEUED_MESSAGES)
+    {
+      LOG_ERROR("Hard limit of the send queue (" << hardLimit << ") is not larger than the maximum number of queued messages (" << MAX_NUMBER_OF_QUEUED_MESSAGES << ")");
+      numberOfErrors++;
+    }
+    for (unsigned int i = 0; i < hardLimit; ++i)
+    {
+      if (!sendQueue->PushMessage(CreateNonDroppableMessage()))
+      {
+        LOG_ERROR("Message " << i << " was dropped before the hard limit of the send queue was reached");
+        numberOfErrors++;
+        break;
+      }
+    }
+    if (sendQueue->GetNumberOfQueuedMessages() != hardLimit || sendQueue->GetSendFailed())
+    {
+      LOG_ERROR("Send queue contains " << sendQueue->GetNumberOfQueuedMessages() << " messages, expected " << hardLimit << " without failure");
+      numberOfErrors++;
+    }
+
+    // The queue is full of messages that must not be dropped, so an incoming droppable message is dropped
+    if (sendQueue->PushMessage(CreateDroppableMessage()) || sendQueue->GetSendFailed())
+    {
+      LOG_ERROR("Droppable message was not dropped from a send queue full of messages that must not be dropped");
+      numberOfErrors++;
+    }
+
+    LOG_INFO("Push a message that must not be dropped into the send queue at its hard limit, an error is expected");
+    if (sendQueue->PushMessage(CreateNonDroppableMessage()))
+    {
+      LOG_ERROR("Message was queued beyond the hard limit of the send queue");
+      numberOfErrors++;
+    }
+    if (!sendQueue->GetSendFailed())
+    {
+      LOG_ERROR("Send queue is not marked as failed after reaching its hard limit");
+      numberOfErrors++;
+    }
+    if (sendQueue->GetNumberOfQueuedMessages() != 0)
+    {
+      LOG_ERROR("Send queue still contains " << sendQueue->GetNumberOfQueuedMessages() << " messages after reaching its hard limit");
+      numberOfErrors++;
+    }
+
+    // No more messages are accepted until the client is disconnected
+    if (sendQueue->PushMessage(CreateNonDroppableMessage()) || sendQueue->GetNumberOfQueuedMessages() != 0)
+    {
+      LOG_ERROR("Message was queued after the send queue failed");
+      numberOfErrors++;
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -17,6 +17,9 @@ See License.txt for details.
 #include <vtkSmartPointer.h>
 #include <vtksys/CommandLineArguments.hxx>
 
+// STL includes
+#include <cstring>
+
 // -------------------------------------------------
 PlusStatus ConnectClients(int listeningPort, std::vector< vtkSmartPointer<vtkPlusOpenIGTLinkVideoSource> >& testClientList, int numberOfClientsToConnect, vtkSmartPointer<vtkXMLDataElement> configRootElement)
 {
@@ -57,6 +60,8 @@ PlusStatus ConnectClients(int listeningPort, std::vector< vtkSmartPointer<vtkPlu
     client->SetMessageType("TrackedFrame");
     PlusTransformName name("Image", "Reference");
     client->SetImageMessageEmbeddedTransformName(name);
+    // Every other client unpacks the messages, so that the frames received into the staging frame can be compared to them
+    client->SetReceiveIntoStagingFrame(i % 2 == 0);
     aSource->SetInputImageOrientation(US_IMG_ORIENT_MF);
 
     if (client->Connect() != PLUS_SUCCESS)
@@ -83,6 +88,107 @@ PlusStatus ConnectClients(int listeningPort, std::vector< vtkSmartPointer<vtkPlu
   return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
 }
 
+// -------------------------------------------------
+PlusStatus GetClientVideoSource(vtkPlusOpenIGTLinkVideoSource* client, vtkPlusDataSource*& aSource)
+{
+  if (client->OutputChannelCount() == 0)
+  {
+    return PLUS_FAIL;
+  }
+  vtkPlusChannel* aChannel = *(client->GetOutputChannelsStart());
+  return aChannel->GetVideoSource(aSource);
+}
+
+// -------------------------------------------------
+/*!
+  Compare the frames that were received into the staging frame by the first client to the frames that were
+  unpacked from the same messages by the clients that do not use the staging frame.
+  Frames are matched by their timestamp, which is read from the message by both methods.
+*/
+PlusStatus CompareReceivedFrames(std::vector< vtkSmartPointer<vtkPlusOpenIGTLinkVideoSource> >& testClientList)
+{
+  if (testClientList.size() < 2)
+  {
+    LOG_ERROR("At least two clients are needed for comparing the received frames");
+    return PLUS_FAIL;
+  }
+  vtkPlusDataSource* stagingSource(NULL);
+  if (!testClientList[0]->GetReceiveIntoStagingFrame() || GetClientVideoSource(testClientList[0], stagingSource) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("The first client does not receive frames into the staging frame");
+    return PLUS_FAIL;
+  }
+
+  int numberOfErrors = 0;
+  int numberOfComparedFrames = 0;
+  for (unsigned int i = 1; i < testClientList.size(); ++i)
+  {
+    vtkPlusDataSource* unpackedSource(NULL);
+    if (testClientList[i]->GetReceiveIntoStagingFrame() || GetClientVideoSource(testClientList[i], unpackedSource) != PLUS_SUCCESS)
+    {
+      continue;
+    }
+    if (unpackedSource->GetNumberOfItems() == 0)
+    {
+      continue;
+    }
+    for (BufferItemUidType uid = unpackedSource->GetOldestItemUidInBuffer(); uid <= unpackedSource->GetLatestItemUidInBuffer(); ++uid)
+    {
+      StreamBufferItem unpackedItem;
+      if (unpackedSource->GetStreamBufferItem(uid, &unpackedItem) != ITEM_OK)
+      {
+        continue;
+      }
+      StreamBufferItem stagingItem;
+      if (stagingSource->GetStreamBufferItemFromTime(unpackedItem.GetUnfilteredTimestamp(0), &stagingItem, vtkPlusBuffer::EXACT_TIME) != ITEM_OK)
+      {
+        // The frame has already been removed from the buffer of the first client or it has not been received yet
+        continue;
+      }
+      ++numberOfComparedFrames;
+
+      PlusVideoFrame& unpackedFrame = unpackedItem.GetFrame();
+      PlusVideoFrame& stagingFrame = stagingItem.GetFrame();
+      unsigned int unpackedFrameSize[3] = { 0, 0, 0 };
+      unsigned int stagingFrameSize[3] = { 0, 0, 0 };
+      unpackedFrame.GetFrameSize(unpackedFrameSize);
+      stagingFrame.GetFrameSize(stagingFrameSize);
+      if (unpackedFrameSize[0] != stagingFrameSize[0] || unpackedFrameSize[1] != stagingFrameSize[1] || unpackedFrameSize[2] != stagingFrameSize[2]
+          || unpackedFrame.GetVTKScalarPixelType() != stagingFrame.GetVTKScalarPixelType()
+          || unpackedFrame.GetNumberOfScalarComponents() != stagingFrame.GetNumberOfScalarComponents()
+          || unpackedFrame.GetImageType() != stagingFrame.GetImageType())
+      {
+        LOG_ERROR("Frame format received into the staging frame differs from the unpacked frame format (client #" << i + 1 << ", timestamp: " << unpackedItem.GetUnfilteredTimestamp(0) << ")");
+        ++numberOfErrors;
+        continue;
+      }
+      if (memcmp(unpackedFrame.GetScalarPointer(), stagingFrame.GetScalarPointer(), unpackedFrame.GetFrameSizeInBytes()) != 0)
+      {
+        LOG_ERROR("Pixel data received into the staging frame differs from the unpacked pixel data (client #" << i + 1 << ", timestamp: " << unpackedItem.GetUnfilteredTimestamp(0) << ")");
+        ++numberOfErrors;
+      }
+      StreamBufferItem::FieldMapType unpackedFields;
+      StreamBufferItem::FieldMapType stagingFields;
+      unpackedItem.GetCustomFrameFields().GetFieldMap(unpackedFields);
+      stagingItem.GetCustomFrameFields().GetFieldMap(stagingFields);
+      if (unpackedFields != stagingFields)
+      {
+        LOG_ERROR("Custom fields received into the staging frame differ from the unpacked custom fields (client #" << i + 1 << ", timestamp: " << unpackedItem.GetUnfilteredTimestamp(0) << ")");
+        ++numberOfErrors;
+      }
+    }
+  }
+
+  if (numberOfComparedFrames == 0)
+  {
+    LOG_ERROR("No frames were received by both the staging frame and the unpacking clients");
+    return PLUS_FAIL;
+  }
+  LOG_INFO(numberOfComparedFrames << " frames received into the staging frame are identical to the unpacked frames");
+
+  return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
+}
+
 // -------------------------------------------------
 PlusStatus DisconnectClients(std::vector< vtkSmartPointer<vtkPlusOpenIGTLinkVideoSource> >& testClientList)
 {
@@ -289,6 +395,18 @@ int main(int argc, char** argv)
     exit(EXIT_FAILURE);
   }
 
+  // Stop receiving frames, so that the buffers of the clients do not change while they are compared
+  for (unsigned int i = 0; i < outTestClients.size(); ++i)
+  {
+    outTestClients[i]->StopRecording();
+  }
+  if (CompareReceivedFrames(outTestClients) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Frames received into the staging frame do not match the unpacked frames!");
+    DisconnectClients(outTestClients);
+    exit(EXIT_FAILURE);
+  }
+
   // Disconnect clients from server
   LOG_INFO("Disconnecting clients...");
   if (DisconnectClients(outTestClients) != PLUS_SUCCESS)
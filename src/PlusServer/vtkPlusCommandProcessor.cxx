@@ -33,8 +33,25 @@ See License.txt for details.
 #include <vtkObjectFactory.h>
 #include <vtkXMLUtilities.h>
 
+// STL includes
+#include <algorithm>
+#include <iomanip>
+
 vtkStandardNewMacro(vtkPlusCommandProcessor);
 
+static const int DEFAULT_NUMBER_OF_WORKER_THREADS = 2;
+static const double COMMAND_STATISTICS_REPORT_INTERVAL_SEC = 10.0;
+
+//----------------------------------------------------------------------------
+vtkPlusCommandProcessor::CommandStatistics::CommandStatistics()
+  : NumberOfExecutions(0)
+  , TotalQueueWaitTimeSec(0)
+  , MaximumQueueWaitTimeSec(0)
+  , TotalExecutionTimeSec(0)
+  , MaximumExecutionTimeSec(0)
+{
+}
+
 //----------------------------------------------------------------------------
 vtkPlusCommandProcessor::vtkPlusCommandProcessor()
   : PlusServer(NULL)
@@ -42,6 +59,10 @@ vtkPlusCommandProcessor::vtkPlusCommandProcessor()
   , Mutex(vtkSmartPointer<vtkPlusRecursiveCriticalSection>::New())
   , CommandExecutionActive(std::make_pair(false, false))
   , CommandExecutionThreadId(-1)
+  , NumberOfWorkerThreads(DEFAULT_NUMBER_OF_WORKER_THREADS)
+  , WorkerStopRequested(false)
+  , NumberOfExecutionsSinceLastReport(0)
+  , LastCommandStatisticsReportTime(vtkPlusAccurateTimer::GetSystemTime())
 {
   // Register default commands
   RegisterPlusCommand(vtkSmartPointer<vtkPlusGetImageCommand>::New());
@@ -65,6 +86,8 @@ vtkPlusCommandProcessor::vtkPlusCommandProcessor()
 //----------------------------------------------------------------------------
 vtkPlusCommandProcessor::~vtkPlusCommandProcessor()
 {
+  // Commands that are still executed by the worker threads may use the server
+  StopWorkerThreads();
   SetPlusServer(NULL);
 }
 
@@ -77,6 +100,8 @@ void vtkPlusCommandProcessor::PrintSelf(ostream& os, vtkIndent indent)
   {
     os << indent << "  " << iter->first << std::endl;
   }
+  os << indent << "Number of worker threads: " << GetNumberOfWorkerThreads() << std::endl;
+  os << indent << "Command statistics: " << GetCommandStatisticsAsString() << std::endl;
 }
 
 //----------------------------------------------------------------------------
@@ -107,6 +132,8 @@ PlusStatus vtkPlusCommandProcessor::Stop()
 
   LOG_DEBUG("Command execution thread stopped");
 
+  StopWorkerThreads();
+
   return PLUS_SUCCESS;
 }
 
@@ -143,27 +170,65 @@ int vtkPlusCommandProcessor::ExecuteCommands()
   int numberOfExecutedCommands(0);
   while (1)
   {
-    vtkSmartPointer<vtkPlusCommand> cmd; // next command to be processed
+    QueuedCommand queuedCommand; // next command to be processed
     {
       PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
       if (this->CommandQueue.empty())
       {
+        double currentTime = vtkPlusAccurateTimer::GetSystemTime();
+        if (this->NumberOfExecutionsSinceLastReport > 0 && currentTime - this->LastCommandStatisticsReportTime > COMMAND_STATISTICS_REPORT_INTERVAL_SEC)
+        {
+          LOG_DEBUG("Command statistics: " << GetCommandStatisticsAsString());
+          this->NumberOfExecutionsSinceLastReport = 0;
+          this->LastCommandStatisticsReportTime = currentTime;
+        }
         return numberOfExecutedCommands;
       }
-      cmd = this->CommandQueue.front();
+      queuedCommand = this->CommandQueue.front();
       this->CommandQueue.pop_front();
     }
 
-    LOG_DEBUG("Executing command");
-    if (cmd->Execute() != PLUS_SUCCESS)
+    // The keys may depend on the devices of the data collector, therefore they are resolved by the processing thread
+    // (commands that are put back to the queue by StopWorkerThreads are resolved again, which gives the same result)
+    queuedCommand.Command->GetOrderingKeys(queuedCommand.OrderingKeys);
+    vtkPlusCommand::ExecutionLaneType lane = queuedCommand.Command->GetExecutionLane();
+
+    bool executeNow(true);
     {
-      LOG_ERROR("Command execution failed");
+      PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+      if (lane == vtkPlusCommand::EXECUTION_LANE_WORKER)
+      {
+        StartWorkerThreads();
+      }
+      std::lock_guard<std::mutex> workerLock(this->WorkerMutex);
+      if (IsPrecededByOrderedCommand(queuedCommand, this->OrderedCommands.end()))
+      {
+        // A previous command with a common key is not completed yet, a worker will execute this command after it
+        queuedCommand.WaitingForPreviousCommands = true;
+        this->OrderedCommands.push_back(queuedCommand);
+        executeNow = false;
+      }
+      else if (lane == vtkPlusCommand::EXECUTION_LANE_WORKER && !this->WorkerThreadIds.empty())
+      {
+        if (!queuedCommand.OrderingKeys.empty())
+        {
+          // Commands with a common key have to wait until this command is completed
+          queuedCommand.WaitingForPreviousCommands = false;
+          this->OrderedCommands.push_back(queuedCommand);
+        }
+        this->WorkerQueue.push_back(queuedCommand);
+        executeNow = false;
+      }
     }
 
-    // move the response objects from the command to the processor's queue
+    if (executeNow)
     {
-      PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
-      cmd->PopCommandResponses(this->CommandResponseQueue);
+      // Commands with a common key are not dispatched until this command is completed, as they are dispatched by this thread
+      ExecuteCommand(queuedCommand);
+    }
+    else
+    {
+      this->WorkerQueueChanged.notify_one();
     }
 
     numberOfExecutedCommands++;
@@ -173,6 +238,267 @@ int vtkPlusCommandProcessor::ExecuteCommands()
   return numberOfExecutedCommands;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::ExecuteCommand(QueuedCommand& queuedCommand)
+{
+  vtkPlusCommand* cmd = queuedCommand.Command;
+  double startTime = vtkPlusAccurateTimer::GetSystemTime();
+  LOG_DEBUG("Executing command: " << cmd->GetName());
+  if (cmd->Execute() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Command execution failed");
+  }
+  double endTime = vtkPlusAccurateTimer::GetSystemTime();
+
+  // move the response objects from the command to the processor's queue
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  cmd->PopCommandResponses(this->CommandResponseQueue);
+  if (this->ResponseNotifier.GetPointer() != NULL && !this->CommandResponseQueue.empty())
+  {
+    this->ResponseNotifier->Notify();
+  }
+
+  CommandStatistics& statistics = this->CommandStatisticsMap[cmd->GetName()];
+  double queueWaitTimeSec = startTime - queuedCommand.QueueTime;
+  double executionTimeSec = endTime - startTime;
+  statistics.NumberOfExecutions++;
+  statistics.TotalQueueWaitTimeSec += queueWaitTimeSec;
+  statistics.MaximumQueueWaitTimeSec = std::max(statistics.MaximumQueueWaitTimeSec, queueWaitTimeSec);
+  statistics.TotalExecutionTimeSec += executionTimeSec;
+  statistics.MaximumExecutionTimeSec = std::max(statistics.MaximumExecutionTimeSec, executionTimeSec);
+  this->NumberOfExecutionsSinceLastReport++;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusCommandProcessor::HaveCommonOrderingKey(const QueuedCommand& command1, const QueuedCommand& command2)
+{
+  for (std::list<std::string>::const_iterator key1 = command1.OrderingKeys.begin(); key1 != command1.OrderingKeys.end(); ++key1)
+  {
+    if (std::find(command2.OrderingKeys.begin(), command2.OrderingKeys.end(), *key1) != command2.OrderingKeys.end())
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusCommandProcessor::IsPrecededByOrderedCommand(const QueuedCommand& queuedCommand, std::list<QueuedCommand>::iterator end)
+{
+  if (queuedCommand.OrderingKeys.empty())
+  {
+    return false;
+  }
+  for (PlusCommandList::iterator orderedCommand = this->OrderedCommands.begin(); orderedCommand != end; ++orderedCommand)
+  {
+    if (HaveCommonOrderingKey(*orderedCommand, queuedCommand))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusCommandProcessor::CompleteOrderedCommand(const QueuedCommand& queuedCommand)
+{
+  for (PlusCommandList::iterator orderedCommand = this->OrderedCommands.begin(); orderedCommand != this->OrderedCommands.end(); ++orderedCommand)
+  {
+    if (orderedCommand->Command == queuedCommand.Command)
+    {
+      this->OrderedCommands.erase(orderedCommand);
+      break;
+    }
+  }
+
+  // Commands are checked in queue order, so a command is only passed to the workers if all previous commands
+  // with a common key (including the ones that are still waiting) are completed
+  int numberOfDispatchedCommands(0);
+  for (PlusCommandList::iterator orderedCommand = this->OrderedCommands.begin(); orderedCommand != this->OrderedCommands.end(); ++orderedCommand)
+  {
+    if (orderedCommand->WaitingForPreviousCommands && !IsPrecededByOrderedCommand(*orderedCommand, orderedCommand))
+    {
+      orderedCommand->WaitingForPreviousCommands = false;
+      this->WorkerQueue.push_back(*orderedCommand);
+      numberOfDispatchedCommands++;
+    }
+  }
+  return numberOfDispatchedCommands;
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusCommandProcessor::CommandWorkerThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusCommandProcessor* self = (vtkPlusCommandProcessor*)(data->UserData);
+
+  while (1)
+  {
+    QueuedCommand queuedCommand;
+    {
+      std::unique_lock<std::mutex> workerLock(self->WorkerMutex);
+      self->WorkerQueueChanged.wait(workerLock, [self] { return self->WorkerStopRequested || !self->WorkerQueue.empty(); });
+      if (self->WorkerStopRequested)
+      {
+        break;
+      }
+      queuedCommand = self->WorkerQueue.front();
+      self->WorkerQueue.pop_front();
+    }
+
+    self->ExecuteCommand(queuedCommand);
+
+    if (queuedCommand.OrderingKeys.empty())
+    {
+      continue;
+    }
+    // Allow execution of the next commands with a common key
+    int numberOfDispatchedCommands(0);
+    {
+      std::lock_guard<std::mutex> workerLock(self->WorkerMutex);
+      numberOfDispatchedCommands = self->CompleteOrderedCommand(queuedCommand);
+    }
+    if (numberOfDispatchedCommands > 0)
+    {
+      self->WorkerQueueChanged.notify_all();
+    }
+  }
+
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusCommandProcessor::StartWorkerThreads()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  if (!this->WorkerThreadIds.empty() || this->NumberOfWorkerThreads <= 0)
+  {
+    return PLUS_SUCCESS;
+  }
+  {
+    std::lock_guard<std::mutex> workerLock(this->WorkerMutex);
+    if (this->WorkerStopRequested)
+    {
+      // The previous worker threads are being stopped, commands are executed by the processing thread until then
+      return PLUS_SUCCESS;
+    }
+  }
+  for (int workerIndex = 0; workerIndex < this->NumberOfWorkerThreads; ++workerIndex)
+  {
+    int threadId = this->Threader->SpawnThread((vtkThreadFunctionType)&CommandWorkerThread, this);
+    if (threadId < 0)
+    {
+      LOG_WARNING("Failed to start command worker thread " << workerIndex << ", only " << workerIndex << " worker threads are used");
+      break;
+    }
+    this->WorkerThreadIds.push_back(threadId);
+  }
+  LOG_DEBUG("Started " << this->WorkerThreadIds.size() << " command worker threads");
+  return (this->WorkerThreadIds.empty() ? PLUS_FAIL : PLUS_SUCCESS);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::StopWorkerThreads()
+{
+  std::vector<int> workerThreadIds;
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+    if (this->WorkerThreadIds.empty())
+    {
+      return;
+    }
+    workerThreadIds.swap(this->WorkerThreadIds);
+    std::lock_guard<std::mutex> workerLock(this->WorkerMutex);
+    this->WorkerStopRequested = true;
+  }
+  this->WorkerQueueChanged.notify_all();
+  // Mutex is not locked here, because the worker threads need it to complete their current command
+  for (std::vector<int>::iterator threadIdIt = workerThreadIds.begin(); threadIdIt != workerThreadIds.end(); ++threadIdIt)
+  {
+    // Waits until the thread completes its current command
+    this->Threader->TerminateThread(*threadIdIt);
+  }
+
+  // Put the commands that are not executed yet back to the front of the command queue, keeping their order.
+  // Mutex is kept locked until the commands are back in the queue, so that newer commands cannot overtake them.
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  PlusCommandList notExecutedCommands;
+  {
+    std::lock_guard<std::mutex> workerLock(this->WorkerMutex);
+    notExecutedCommands.splice(notExecutedCommands.end(), this->WorkerQueue);
+    for (PlusCommandList::iterator orderedCommand = this->OrderedCommands.begin(); orderedCommand != this->OrderedCommands.end(); ++orderedCommand)
+    {
+      if (orderedCommand->WaitingForPreviousCommands)
+      {
+        notExecutedCommands.push_back(*orderedCommand);
+      }
+    }
+    this->OrderedCommands.clear();
+    this->WorkerStopRequested = false;
+  }
+  // Sorting is stable, therefore commands queued at the same time keep their order
+  notExecutedCommands.sort([](const QueuedCommand & a, const QueuedCommand & b) { return a.QueueTime < b.QueueTime; });
+  this->CommandQueue.splice(this->CommandQueue.begin(), notExecutedCommands);
+
+  LOG_DEBUG("Command worker threads stopped");
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::SetNumberOfWorkerThreads(int numberOfWorkerThreads)
+{
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+    if (numberOfWorkerThreads == this->NumberOfWorkerThreads)
+    {
+      return;
+    }
+    // The new number is used when the worker threads are started again
+    this->NumberOfWorkerThreads = numberOfWorkerThreads;
+  }
+  StopWorkerThreads();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusCommandProcessor::GetNumberOfWorkerThreads()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  return this->NumberOfWorkerThreads;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusCommandProcessor::GetCommandStatisticsAsString()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  if (this->CommandStatisticsMap.empty())
+  {
+    return "no commands executed";
+  }
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(1);
+  for (std::map<std::string, CommandStatistics>::iterator it = this->CommandStatisticsMap.begin(); it != this->CommandStatisticsMap.end(); ++it)
+  {
+    const CommandStatistics& statistics = it->second;
+    if (it != this->CommandStatisticsMap.begin())
+    {
+      ss << "; ";
+    }
+    ss << it->first << ": " << statistics.NumberOfExecutions << " executions, queue wait "
+       << statistics.TotalQueueWaitTimeSec * 1000.0 / statistics.NumberOfExecutions << " ms average "
+       << statistics.MaximumQueueWaitTimeSec * 1000.0 << " ms maximum, execution "
+       << statistics.TotalExecutionTimeSec * 1000.0 / statistics.NumberOfExecutions << " ms average "
+       << statistics.MaximumExecutionTimeSec * 1000.0 << " ms maximum";
+  }
+  return ss.str();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::ResetCommandStatistics()
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  this->CommandStatisticsMap.clear();
+  this->NumberOfExecutionsSinceLastReport = 0;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusCommandProcessor::RegisterPlusCommand(vtkPlusCommand* cmd)
 {
@@ -268,8 +594,12 @@ PlusStatus vtkPlusCommandProcessor::QueueCommand(bool respondUsingIGTLCommand, u
   cmd->SetRespondWithCommandMessage(respondUsingIGTLCommand);
 
   // Add command to the execution queue
+  QueuedCommand queuedCommand;
+  queuedCommand.Command = cmd;
+  queuedCommand.QueueTime = vtkPlusAccurateTimer::GetSystemTime();
+  queuedCommand.WaitingForPreviousCommands = false;
   PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
-  this->CommandQueue.push_back(cmd);
+  this->CommandQueue.push_back(queuedCommand);
 
   return PLUS_SUCCESS;
 }
@@ -294,6 +624,10 @@ PlusStatus vtkPlusCommandProcessor::QueueStringResponse(PlusStatus status, const
   // Add response to the command response queue
   PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
   this->CommandResponseQueue.push_back(response);
+  if (this->ResponseNotifier.GetPointer() != NULL)
+  {
+    this->ResponseNotifier->Notify();
+  }
 
   return PLUS_SUCCESS;
 }
@@ -312,10 +646,21 @@ PlusStatus vtkPlusCommandProcessor::QueueCommandResponse(PlusStatus status, cons
   // Add response to the command response queue
   PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
   this->CommandResponseQueue.push_back(response);
+  if (this->ResponseNotifier.GetPointer() != NULL)
+  {
+    this->ResponseNotifier->Notify();
+  }
 
   return PLUS_SUCCESS;
 }
 
+//------------------------------------------------------------------------------
+void vtkPlusCommandProcessor::SetResponseNotifier(vtkPlusNewDataNotifier* notifier)
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  this->ResponseNotifier = notifier;
+}
+
 //------------------------------------------------------------------------------
 void vtkPlusCommandProcessor::PopCommandResponses(PlusCommandResponseList& responses)
 {
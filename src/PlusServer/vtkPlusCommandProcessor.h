@@ -13,8 +13,15 @@
 #include "vtkObject.h"
 #include "vtkPlusCommand.h"
 #include "vtkPlusCommandResponse.h"
+#include "vtkPlusNewDataNotifier.h"
 #include "vtkPlusOpenIGTLinkServer.h"
+
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
 class vtkImageData;
 class vtkMatrix4x4;
@@ -26,6 +33,13 @@ class vtkMatrix4x4;
   If the commands are to be executed on a separate thread (to allow background processing, but maybe requiring more synchronization) call Start() to start an internal processing thread.
   Probably one of the processing models would be enough, but at this point it's not clear which one is better.
   TODO: keep only one method and remove the other approach completely once the processing model decision is finalized.
+
+  Commands are executed in two lanes (see vtkPlusCommand::GetExecutionLane). Lightweight commands (e.g., GetTransform, UpdateTransform,
+  RequestIds) are executed right away by the thread that processes the queue. Long-running commands (e.g., volume reconstruction,
+  stopping and saving a recording, getting an image) are passed to a pool of worker threads, so that they do not block the other commands.
+  Commands that have a common ordering key (see vtkPlusCommand::GetOrderingKeys, typically the id of the device they operate on)
+  are always executed in the order they were queued: a command waits until all previous commands that have a common key with it are completed.
+  Queue wait time and execution time are measured for each command type (see GetCommandStatisticsAsString).
   \ingroup PlusLibPlusServer
 */
 class vtkPlusServerExport vtkPlusCommandProcessor : public vtkObject
@@ -36,11 +50,27 @@ public:
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
   /*!
-    Execute all commands in the queue from the current thread (useful if commands should be executed from the main thread)
-    \return Number of executed commands
+    Execute all commands in the queue from the current thread (useful if commands should be executed from the main thread).
+    Long-running commands are passed to the worker threads.
+    \return Number of executed or dispatched commands
   */
   int ExecuteCommands();
 
+  /*!
+    Set the number of worker threads that execute long-running commands. If 0 then all commands are executed
+    by the thread that processes the command queue. Default: 2.
+    Worker threads are started when the first long-running command is received. Can be called from any thread.
+  */
+  void SetNumberOfWorkerThreads(int numberOfWorkerThreads);
+  /*! Get the number of worker threads that execute long-running commands. Can be called from any thread. */
+  int GetNumberOfWorkerThreads();
+
+  /*! Get the number of executions, queue wait time, and execution time of each command type as a human-readable string. Can be called from any thread. */
+  std::string GetCommandStatisticsAsString();
+
+  /*! Reset the execution statistics of all command types. Can be called from any thread. */
+  void ResetCommandStatistics();
+
   /*! Start thread for processing the commands in the queue. Must be called from the main thread. */
   virtual PlusStatus Start();
 
@@ -81,12 +111,24 @@ public:
   vtkGetObjectMacro(PlusServer, vtkPlusOpenIGTLinkServer);
   vtkSetObjectMacro(PlusServer, vtkPlusOpenIGTLinkServer);
 
+  /*! Set a notifier that is signaled whenever a response is added to the response queue, so that the sender does not have to poll the queue */
+  void SetResponseNotifier(vtkPlusNewDataNotifier* notifier);
+
 protected:
   vtkPlusCommand* CreatePlusCommand(const std::string& commandName, const std::string& commandStr);
 
   /*! Thread for client connection handling */
   static void* CommandExecutionThread(vtkMultiThreader::ThreadInfo* data);
 
+  /*! Thread for executing long-running commands */
+  static void* CommandWorkerThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Start the worker threads if they are not running yet. Can be called from any thread. */
+  PlusStatus StartWorkerThreads();
+
+  /*! Stop the worker threads after they complete the commands they are executing. Commands that are not started yet are put back to the command queue. */
+  void StopWorkerThreads();
+
   vtkPlusCommandProcessor();
   virtual ~vtkPlusCommandProcessor();
 
@@ -109,16 +151,83 @@ private:
   /*! Map command names and the New() static methods of vtkPlusCommand classes */
   std::map<std::string, vtkPlusCommand*> RegisteredCommands;
 
+  /*! Command that is waiting for execution */
+  struct QueuedCommand
+  {
+    vtkSmartPointer<vtkPlusCommand> Command;
+    /*! Ordering keys of the command, queried by the processing thread when the command is taken from the queue */
+    std::list<std::string> OrderingKeys;
+    /*! System time when the command was added to the queue */
+    double QueueTime;
+    /*! True if the command waits for the completion of previous commands (only used in OrderedCommands) */
+    bool WaitingForPreviousCommands;
+  };
+
+  /*! Execute a command, move its responses to the response queue, and update statistics. Can be called from any thread. */
+  void ExecuteCommand(QueuedCommand& queuedCommand);
+
+  /*! Returns true if the two commands have a common ordering key */
+  static bool HaveCommonOrderingKey(const QueuedCommand& command1, const QueuedCommand& command2);
+
+  /*!
+    Returns true if a command in OrderedCommands (before the position specified by the end iterator)
+    has a common ordering key with the command. WorkerMutex must be locked.
+  */
+  bool IsPrecededByOrderedCommand(const QueuedCommand& queuedCommand, std::list<QueuedCommand>::iterator end);
+
+  /*!
+    Remove a completed command from OrderedCommands and pass the commands that do not have to wait anymore
+    to the worker queue. WorkerMutex must be locked.
+    eturn Number of commands added to the worker queue
+  */
+  int CompleteOrderedCommand(const QueuedCommand& queuedCommand);
+
   /*!
     This queue contains all the active commands.
     After a command's execute method is called it may still remain active (remain in the queue),
     until it signals that it is completed.
   */
-  //std::list<vtkPlusCommand*> CommandQueue;
-  typedef std::list< vtkSmartPointer<vtkPlusCommand> > PlusCommandList;
+  typedef std::list<QueuedCommand> PlusCommandList;
   PlusCommandList CommandQueue;
   PlusCommandResponseList CommandResponseQueue;
 
+  /*! Protected by Mutex */
+  int NumberOfWorkerThreads;
+  /*! Thread identifiers of the worker threads (in Threader). Protected by Mutex. */
+  std::vector<int> WorkerThreadIds;
+
+  /*! Protects WorkerQueue, OrderedCommands, and WorkerStopRequested. If both are needed then Mutex has to be locked first. */
+  std::mutex WorkerMutex;
+  /*! Signaled when a command is added to the worker queue or stop is requested */
+  std::condition_variable WorkerQueueChanged;
+  bool WorkerStopRequested;
+  /*! Commands that can be executed by the worker threads */
+  PlusCommandList WorkerQueue;
+  /*!
+    Commands that have ordering keys and have not completed yet: either passed to the worker queue
+    (and maybe already in execution) or waiting for previous commands. In the order they were queued.
+  */
+  PlusCommandList OrderedCommands;
+
+  /*! Execution statistics of a command type */
+  struct CommandStatistics
+  {
+    CommandStatistics();
+    unsigned long NumberOfExecutions;
+    double TotalQueueWaitTimeSec;
+    double MaximumQueueWaitTimeSec;
+    double TotalExecutionTimeSec;
+    double MaximumExecutionTimeSec;
+  };
+  /*! Statistics for each command name. Protected by Mutex. */
+  std::map<std::string, CommandStatistics> CommandStatisticsMap;
+  /*! Number of executed commands since the statistics were last reported in the log. Protected by Mutex. */
+  unsigned long NumberOfExecutionsSinceLastReport;
+  double LastCommandStatisticsReportTime;
+
+  /*! Signaled when new responses are available. Protected by Mutex. */
+  vtkSmartPointer<vtkPlusNewDataNotifier> ResponseNotifier;
+
   vtkPlusCommandProcessor(const vtkPlusCommandProcessor&);  // Not implemented.
   void operator=(const vtkPlusCommandProcessor&);  // Not implemented.
 };
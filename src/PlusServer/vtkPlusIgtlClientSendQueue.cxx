@@ -0,0 +1,280 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusIgtlClientSendQueue.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STL includes
+#include <chrono>
+
+vtkStandardNewMacro(vtkPlusIgtlClientSendQueue);
+
+namespace
+{
+  // The queue may grow to this multiple of the maximum number of queued messages with messages that must not be dropped
+  const unsigned int HARD_LIMIT_QUEUE_SIZE_FACTOR = 4;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusIgtlClientSendQueue::vtkPlusIgtlClientSendQueue()
+  : MaxNumberOfQueuedMessages(50)
+  , DropPolicy(DROP_OLDEST)
+  , NumberOfDroppedMessages(0)
+  , MaxQueueDepth(0)
+  , Interrupted(false)
+  , SendFailed(false)
+{
+  this->DroppableMessageTypes.insert("IMAGE");
+  this->DroppableMessageTypes.insert("TRACKEDFRAME");
+  this->DroppableMessageTypes.insert("USMESSAGE");
+}
+
+//----------------------------------------------------------------------------
+vtkPlusIgtlClientSendQueue::~vtkPlusIgtlClientSendQueue()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlClientSendQueue::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  os << indent << "MaxNumberOfQueuedMessages: " << this->MaxNumberOfQueuedMessages << std::endl;
+  os << indent << "HardMaxNumberOfQueuedMessages: " << this->GetHardMaxNumberOfQueuedMessagesInternal() << std::endl;
+  os << indent << "DropPolicy: " << DropPolicyToString(this->DropPolicy) << std::endl;
+  os << indent << "NumberOfQueuedMessages: " << this->Messages.size() << std::endl;
+  os << indent << "NumberOfDroppedMessages: " << this->NumberOfDroppedMessages << std::endl;
+  os << indent << "MaxQueueDepth: " << this->MaxQueueDepth << std::endl;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusIgtlClientSendQueue::DropPolicyToString(DropPolicyType policy)
+{
+  switch (policy)
+  {
+    case DROP_OLDEST:
+      return "DROP_OLDEST";
+    case DROP_NEWEST:
+      return "DROP_NEWEST";
+  }
+  return "UNKNOWN";
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlClientSendQueue::DropPolicyFromString(const std::string& policyString, DropPolicyType& policy)
+{
+  if (PlusCommon::IsEqualInsensitive(policyString, "DROP_OLDEST"))
+  {
+    policy = DROP_OLDEST;
+    return PLUS_SUCCESS;
+  }
+  if (PlusCommon::IsEqualInsensitive(policyString, "DROP_NEWEST"))
+  {
+    policy = DROP_NEWEST;
+    return PLUS_SUCCESS;
+  }
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlClientSendQueue::PushMessage(igtl::MessageBase::Pointer message, double acquisitionTimestamp /*=UNDEFINED_TIMESTAMP*/)
+{
+  if (message.IsNull())
+  {
+    return true;
+  }
+
+  bool messageDropped = false;
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    if (this->SendFailed)
+    {
+      // The client is about to be disconnected, there is no point in queuing more messages
+      this->NumberOfDroppedMessages++;
+      return false;
+    }
+    if (this->Messages.size() >= this->MaxNumberOfQueuedMessages)
+    {
+      std::string messageType = message->GetMessageType();
+      bool incomingDroppable = this->DroppableMessageTypes.find(messageType) != this->DroppableMessageTypes.end();
+      if (this->DropPolicy == DROP_NEWEST && incomingDroppable)
+      {
+        this->NumberOfDroppedMessages++;
+        return false;
+      }
+      // Make room by removing the oldest message that may be dropped
+      for (std::deque<QueuedMessage>::iterator it = this->Messages.begin(); it != this->Messages.end(); ++it)
+      {
+        std::string queuedMessageType = it->Message->GetMessageType();
+        if (this->DroppableMessageTypes.find(queuedMessageType) != this->DroppableMessageTypes.end())
+        {
+          this->Messages.erase(it);
+          this->NumberOfDroppedMessages++;
+          messageDropped = true;
+          break;
+        }
+      }
+      if (!messageDropped && incomingDroppable)
+      {
+        // The queue is full of messages that must not be dropped, so drop the incoming one
+        this->NumberOfDroppedMessages++;
+        return false;
+      }
+      // Messages that must not be dropped are queued even if the queue is full, but only up to the hard limit
+      if (!messageDropped && this->Messages.size() >= this->GetHardMaxNumberOfQueuedMessagesInternal())
+      {
+        LOG_ERROR("Send queue reached its hard limit of " << this->GetHardMaxNumberOfQueuedMessagesInternal() << " messages, "
+                  << messageType << " message cannot be queued. The client cannot keep up with the data stream and will be disconnected.");
+        this->NumberOfDroppedMessages += this->Messages.size() + 1;
+        this->Messages.clear();
+        this->SendFailed = true;
+        return false;
+      }
+    }
+    QueuedMessage queuedMessage;
+    queuedMessage.Message = message;
+    queuedMessage.AcquisitionTimestamp = acquisitionTimestamp;
+    this->Messages.push_back(queuedMessage);
+    if (this->Messages.size() > this->MaxQueueDepth)
+    {
+      this->MaxQueueDepth = this->Messages.size();
+    }
+  }
+  this->MessageAvailable.notify_one();
+  return !messageDropped;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlClientSendQueue::PopMessage(igtl::MessageBase::Pointer& message, double timeoutSec, double* acquisitionTimestamp /*=NULL*/)
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  if (this->Messages.empty() && !this->Interrupted)
+  {
+    this->MessageAvailable.wait_for(lock, std::chrono::duration<double>(timeoutSec));
+  }
+  if (this->Interrupted || this->Messages.empty())
+  {
+    return false;
+  }
+  message = this->Messages.front().Message;
+  if (acquisitionTimestamp != NULL)
+  {
+    *acquisitionTimestamp = this->Messages.front().AcquisitionTimestamp;
+  }
+  this->Messages.pop_front();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlClientSendQueue::Interrupt()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Interrupted = true;
+  }
+  this->MessageAvailable.notify_all();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlClientSendQueue::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Messages.clear();
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlClientSendQueue::IsMessageTypeDroppable(const std::string& messageType) const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->DroppableMessageTypes.find(messageType) != this->DroppableMessageTypes.end();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlClientSendQueue::SetDroppableMessageTypes(const std::set<std::string>& messageTypes)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->DroppableMessageTypes = messageTypes;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlClientSendQueue::SetMaxNumberOfQueuedMessages(unsigned int maxNumberOfQueuedMessages)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->MaxNumberOfQueuedMessages = maxNumberOfQueuedMessages;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusIgtlClientSendQueue::GetMaxNumberOfQueuedMessages()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->MaxNumberOfQueuedMessages;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusIgtlClientSendQueue::GetHardMaxNumberOfQueuedMessages()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->GetHardMaxNumberOfQueuedMessagesInternal();
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusIgtlClientSendQueue::GetHardMaxNumberOfQueuedMessagesInternal() const
+{
+  return HARD_LIMIT_QUEUE_SIZE_FACTOR * this->MaxNumberOfQueuedMessages;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlClientSendQueue::SetDropPolicy(DropPolicyType policy)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->DropPolicy = policy;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusIgtlClientSendQueue::DropPolicyType vtkPlusIgtlClientSendQueue::GetDropPolicy()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->DropPolicy;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusIgtlClientSendQueue::GetNumberOfQueuedMessages()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Messages.size();
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusIgtlClientSendQueue::GetNumberOfDroppedMessages()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->NumberOfDroppedMessages;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusIgtlClientSendQueue::GetMaxQueueDepth()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->MaxQueueDepth;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIgtlClientSendQueue::SetSendFailed(bool failed)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->SendFailed = failed;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIgtlClientSendQueue::GetSendFailed()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->SendFailed;
+}
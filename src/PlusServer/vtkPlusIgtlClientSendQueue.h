@@ -0,0 +1,142 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusIgtlClientSendQueue_h
+#define __vtkPlusIgtlClientSendQueue_h
+
+// Local includes
+#include "vtkPlusServerExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STL includes
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+
+// IGTL includes
+#include <igtlMessageBase.h>
+
+/*!
+  \class vtkPlusIgtlClientSendQueue
+  \brief Bounded queue of packed OpenIGTLink messages waiting to be sent to one client
+
+  Each client connected to vtkPlusOpenIGTLinkServer has its own queue, which is emptied by a dedicated sender thread,
+  so that a client on a slow link only delays its own messages.
+
+  If the queue is full then a message of a droppable type (by default IMAGE, TRACKEDFRAME, USMESSAGE) is discarded:
+  either the oldest droppable message in the queue (DROP_OLDEST) or the incoming message (DROP_NEWEST).
+  Messages of other types (transforms, command replies, status messages) are not dropped, they are queued even if the queue
+  is already full, up to a hard limit (a multiple of the maximum number of queued messages). If even the hard limit is reached
+  then the client cannot keep up with messages that must be delivered: the message is dropped, the queue is cleared, and
+  the queue is marked as failed (SendFailed) so that the server disconnects the client.
+
+  All methods can be called from any thread.
+
+  \ingroup PlusLibPlusServer
+*/
+class vtkPlusServerExport vtkPlusIgtlClientSendQueue : public vtkObject
+{
+public:
+  static vtkPlusIgtlClientSendQueue* New();
+  vtkTypeMacro(vtkPlusIgtlClientSendQueue, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum DropPolicyType
+  {
+    DROP_OLDEST,
+    DROP_NEWEST
+  };
+
+  /*! Convert drop policy to string */
+  static std::string DropPolicyToString(DropPolicyType policy);
+  /*! Convert string to drop policy. Returns PLUS_FAIL if the string is not recognized. */
+  static PlusStatus DropPolicyFromString(const std::string& policyString, DropPolicyType& policy);
+
+  /*!
+    Add a packed message to the queue. The message must not be modified after it is queued.
+    \param acquisitionTimestamp System time when the data in the message was acquired, used for latency measurement. UNDEFINED_TIMESTAMP if not applicable.
+    \return false if a message had to be dropped to make room or the incoming message itself was dropped
+  */
+  bool PushMessage(igtl::MessageBase::Pointer message, double acquisitionTimestamp = UNDEFINED_TIMESTAMP);
+
+  /*!
+    Remove the oldest message from the queue. Waits at most timeoutSec for a message to arrive.
+    \param acquisitionTimestamp If not NULL then the acquisition timestamp that was specified when the message was queued is returned here
+    \return false if no message is available or the queue was interrupted
+  */
+  bool PopMessage(igtl::MessageBase::Pointer& message, double timeoutSec, double* acquisitionTimestamp = NULL);
+
+  /*! Wake up all threads that are waiting in PopMessage */
+  void Interrupt();
+
+  /*! Remove all queued messages */
+  void Clear();
+
+  /*! Returns true if a message of the given type may be dropped when the queue is full */
+  bool IsMessageTypeDroppable(const std::string& messageType) const;
+
+  /*! Set the list of message types that may be dropped if the client cannot keep up */
+  void SetDroppableMessageTypes(const std::set<std::string>& messageTypes);
+
+  /*! Maximum number of messages in the queue before droppable messages are discarded */
+  void SetMaxNumberOfQueuedMessages(unsigned int maxNumberOfQueuedMessages);
+  unsigned int GetMaxNumberOfQueuedMessages();
+
+  /*! Maximum number of messages in the queue including messages that must not be dropped. If it is reached then the send fails. */
+  unsigned int GetHardMaxNumberOfQueuedMessages();
+
+  void SetDropPolicy(DropPolicyType policy);
+  DropPolicyType GetDropPolicy();
+
+  /*! Number of messages currently waiting in the queue */
+  unsigned int GetNumberOfQueuedMessages();
+
+  /*! Number of messages that were dropped since the queue was created */
+  unsigned long GetNumberOfDroppedMessages();
+
+  /*! Largest number of messages that were waiting in the queue at the same time */
+  unsigned int GetMaxQueueDepth();
+
+  /*! Set by the sender thread if the message could not be sent (client is probably disconnected) */
+  void SetSendFailed(bool failed);
+  bool GetSendFailed();
+
+protected:
+  vtkPlusIgtlClientSendQueue();
+  virtual ~vtkPlusIgtlClientSendQueue();
+
+  struct QueuedMessage
+  {
+    igtl::MessageBase::Pointer Message;
+    double AcquisitionTimestamp;
+  };
+
+  /*! Returns the hard limit. The mutex must be locked by the caller. */
+  unsigned int GetHardMaxNumberOfQueuedMessagesInternal() const;
+
+  mutable std::mutex Mutex;
+  std::condition_variable MessageAvailable;
+
+  std::deque<QueuedMessage> Messages;
+  std::set<std::string> DroppableMessageTypes;
+  unsigned int MaxNumberOfQueuedMessages;
+  DropPolicyType DropPolicy;
+
+  unsigned long NumberOfDroppedMessages;
+  unsigned int MaxQueueDepth;
+  bool Interrupted;
+  bool SendFailed;
+
+private:
+  vtkPlusIgtlClientSendQueue(const vtkPlusIgtlClientSendQueue&);  // Not implemented.
+  void operator=(const vtkPlusIgtlClientSendQueue&);  // Not implemented.
+};
+
+#endif
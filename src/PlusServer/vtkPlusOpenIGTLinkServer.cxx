@@ -48,9 +48,14 @@ See License.txt for details.
 #endif
 
 static const double DELAY_ON_SENDING_ERROR_SEC = 0.02;
-static const double DELAY_ON_NO_NEW_FRAMES_SEC = 0.005;
+static const double DATA_SENDER_MAX_WAIT_SEC = 0.2; // wait time is limited to keep the thread responsive to stop requests
 static const int NUMBER_OF_RECENT_COMMAND_IDS_STORED = 10;
 static const int IGTL_EMPTY_DATA_SIZE = -1;
+static const double PACKED_MESSAGE_CACHE_REPORT_INTERVAL_SEC = 10.0;
+static const double CLIENT_SENDER_WAIT_TIMEOUT_SEC = 0.1;
+// Upper limits of the acquisition-to-send latency histogram bins. An additional bin collects all larger latencies.
+static const double SEND_LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_MS[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500 };
+static const int SEND_LATENCY_HISTOGRAM_NUMBER_OF_BINS = sizeof(SEND_LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_MS) / sizeof(SEND_LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_MS[0]) + 1;
 
 const float vtkPlusOpenIGTLinkServer::CLIENT_SOCKET_TIMEOUT_SEC = 0.5;
 
@@ -75,12 +80,19 @@ vtkPlusOpenIGTLinkServer::vtkPlusOpenIGTLinkServer()
   , NumberOfRetryAttempts(10)
   , DelayBetweenRetryAttemptsSec(0.05)
   , MaxNumberOfIgtlMessagesToSend(100)
+  , ClientSendQueueSize(50)
+  , ClientSendQueueDropPolicy(vtkPlusIgtlClientSendQueue::DROP_OLDEST)
   , ConnectionActive(std::make_pair(false, false))
   , DataSenderActive(std::make_pair(false, false))
   , ConnectionReceiverThreadId(-1)
   , DataSenderThreadId(-1)
   , IgtlMessageFactory(vtkSmartPointer<vtkPlusIgtlMessageFactory>::New())
   , IgtlClientsMutex(vtkSmartPointer<vtkPlusRecursiveCriticalSection>::New())
+  , LastPackedMessageCacheReportTime(0)
+  , DataSenderNotifier(vtkSmartPointer<vtkPlusNewDataNotifier>::New())
+  , DataSenderNotificationCount(0)
+  , SendLatencyHistogram(SEND_LATENCY_HISTOGRAM_NUMBER_OF_BINS, 0)
+  , SendLatencyHistogramMutex(vtkSmartPointer<vtkPlusRecursiveCriticalSection>::New())
   , LastSentTrackedFrameTimestamp(0)
   , MaxTimeSpentWithProcessingMs(50)
   , LastProcessingTimePerFrameMs(-1)
@@ -97,7 +109,9 @@ vtkPlusOpenIGTLinkServer::vtkPlusOpenIGTLinkServer()
   , MissingInputGracePeriodSec(0.0)
   , BroadcastStartTime(0.0)
 {
-
+  this->ClientSendQueueDroppableMessageTypes.insert("IMAGE");
+  this->ClientSendQueueDroppableMessageTypes.insert("TRACKEDFRAME");
+  this->ClientSendQueueDroppableMessageTypes.insert("USMESSAGE");
 }
 
 //----------------------------------------------------------------------------
@@ -131,8 +145,11 @@ PlusStatus vtkPlusOpenIGTLinkServer::QueueMessageResponseForClient(int clientId,
     return PLUS_FAIL;
   }
 
-  PlusLockGuard<vtkPlusRecursiveCriticalSection> mutexGuardedLock(this->MessageResponseQueueMutex);
-  this->MessageResponseQueue[clientId].push_back(message);
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> mutexGuardedLock(this->MessageResponseQueueMutex);
+    this->MessageResponseQueue[clientId].push_back(message);
+  }
+  this->DataSenderNotifier->Notify();
 
   return PLUS_SUCCESS;
 }
@@ -170,9 +187,22 @@ PlusStatus vtkPlusOpenIGTLinkServer::StartOpenIGTLinkService()
   LOG_DEBUG(ss.str());
 
   this->PlusCommandProcessor->SetPlusServer(this);
+  this->PlusCommandProcessor->SetResponseNotifier(this->DataSenderNotifier);
 
   this->BroadcastStartTime = vtkPlusAccurateTimer::GetSystemTime();
 
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+    this->IgtlPackedMessageCache.Clear();
+    this->IgtlPackedMessageCache.ResetStatistics();
+    this->LastPackedMessageCacheReportTime = this->BroadcastStartTime;
+  }
+
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> histogramGuardedLock(this->SendLatencyHistogramMutex);
+    std::fill(this->SendLatencyHistogram.begin(), this->SendLatencyHistogram.end(), 0);
+  }
+
   return PLUS_SUCCESS;
 }
 
@@ -207,6 +237,15 @@ PlusStatus vtkPlusOpenIGTLinkServer::StopOpenIGTLinkService()
     DisconnectClient(*it);
   }
 
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+    this->IgtlPackedMessageCache.Clear();
+    LOG_INFO("Packed message cache hit rate: " << this->IgtlPackedMessageCache.GetHitRate() * 100.0 << "% ("
+              << this->IgtlPackedMessageCache.GetNumberOfHits() << " hits, " << this->IgtlPackedMessageCache.GetNumberOfMisses() << " misses)");
+  }
+
+  LOG_INFO("Acquisition-to-send latency histogram: " << this->GetSendLatencyHistogramAsString());
+
   LOG_INFO("Plus OpenIGTLink server stopped.");
 
   return PLUS_SUCCESS;
@@ -247,6 +286,10 @@ void* vtkPlusOpenIGTLinkServer::ConnectionReceiverThread(vtkMultiThreader::Threa
       client->ClientSocket->SetSendTimeout(self->DefaultClientSendTimeoutSec * 1000);
       client->ClientInfo = self->DefaultClientInfo;
       client->Server = self;
+      client->SendQueue = vtkSmartPointer<vtkPlusIgtlClientSendQueue>::New();
+      client->SendQueue->SetMaxNumberOfQueuedMessages(self->ClientSendQueueSize);
+      client->SendQueue->SetDropPolicy(self->ClientSendQueueDropPolicy);
+      client->SendQueue->SetDroppableMessageTypes(self->ClientSendQueueDroppableMessageTypes);
 
       int port = 0;
       std::string address = "unknown";
@@ -257,6 +300,12 @@ void* vtkPlusOpenIGTLinkServer::ConnectionReceiverThread(vtkMultiThreader::Threa
 
       client->DataReceiverActive.first = true;
       client->DataReceiverThreadId = self->Threader->SpawnThread((vtkThreadFunctionType)&DataReceiverThread, client);
+
+      client->ClientSenderActive.first = true;
+      client->ClientSenderThreadId = self->Threader->SpawnThread((vtkThreadFunctionType)&ClientSenderThread, client);
+
+      // Start sending data to the new client without delay
+      self->DataSenderNotifier->Notify();
     }
   }
 
@@ -332,6 +381,9 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
     self->BroadcastChannel->GetMostRecentTimestamp(self->LastSentTrackedFrameTimestamp);
   }
 
+  // The broadcast channel buffers wake up the thread only while clients are connected
+  bool channelNotifierRegistered = false;
+
   double elapsedTimeSinceLastPacketSentSec = 0;
   while (self->ConnectionActive.first && self->DataSenderActive.first)
   {
@@ -343,10 +395,22 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
         clientsConnected = true;
       }
     }
+    if (self->BroadcastChannel != NULL && clientsConnected != channelNotifierRegistered)
+    {
+      if (clientsConnected)
+      {
+        self->BroadcastChannel->AddNewItemNotifier(self->DataSenderNotifier);
+      }
+      else
+      {
+        self->BroadcastChannel->RemoveNewItemNotifier(self->DataSenderNotifier);
+      }
+      channelNotifierRegistered = clientsConnected;
+    }
     if (!clientsConnected)
     {
-      // No client connected, wait for a while
-      vtkPlusAccurateTimer::Delay(0.2);
+      // No client connected, wait until a client connects
+      self->DataSenderNotifier->Wait(self->DataSenderNotificationCount, DATA_SENDER_MAX_WAIT_SEC);
       self->LastSentTrackedFrameTimestamp = 0; // next time start sending from the most recent timestamp
       continue;
     }
@@ -356,6 +420,8 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
       self->GracePeriodLogLevel = vtkPlusLogger::LOG_LEVEL_WARNING;
     }
 
+    self->DisconnectClientsWithFailedSend();
+
     SendMessageResponses(*self);
 
     // Send remote command execution replies to clients before sending any images/transforms/etc...
@@ -364,6 +430,12 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
     // Send image/tracking/string data
     SendLatestFramesToClients(*self, elapsedTimeSinceLastPacketSentSec);
   }
+
+  if (channelNotifierRegistered)
+  {
+    self->BroadcastChannel->RemoveNewItemNotifier(self->DataSenderNotifier);
+  }
+
   // Close thread
   self->DataSenderThreadId = -1;
   self->DataSenderActive.second = false;
@@ -419,7 +491,6 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLin
   // There is no new frame in the buffer
   if (trackedFrameList->GetNumberOfTrackedFrames() == 0)
   {
-    vtkPlusAccurateTimer::Delay(DELAY_ON_NO_NEW_FRAMES_SEC);
     elapsedTimeSinceLastPacketSentSec += vtkPlusAccurateTimer::GetSystemTime() - startTimeSec;
 
     // Send keep alive packet to clients
@@ -430,6 +501,12 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLin
       return PLUS_SUCCESS;
     }
 
+    // Wait until a new item is added to the broadcast channel (or a reply is queued), but not beyond the next keep alive time
+    double waitStartTimeSec = vtkPlusAccurateTimer::GetSystemTime();
+    double maxWaitTimeSec = std::min(self.KeepAliveIntervalSec - elapsedTimeSinceLastPacketSentSec, DATA_SENDER_MAX_WAIT_SEC);
+    self.DataSenderNotifier->Wait(self.DataSenderNotificationCount, maxWaitTimeSec);
+    elapsedTimeSinceLastPacketSentSec += vtkPlusAccurateTimer::GetSystemTime() - waitStartTimeSec;
+
     return PLUS_FAIL;
   }
 
@@ -460,17 +537,17 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendMessageResponses(vtkPlusOpenIGTLinkServ
     for (ClientIdToMessageListMap::iterator it = self.MessageResponseQueue.begin(); it != self.MessageResponseQueue.end(); ++it)
     {
       PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(self.IgtlClientsMutex);
-      igtl::ClientSocket::Pointer clientSocket = NULL;
+      vtkPlusIgtlClientSendQueue* sendQueue = NULL;
 
       for (std::list<ClientData>::iterator clientIterator = self.IgtlClients.begin(); clientIterator != self.IgtlClients.end(); ++clientIterator)
       {
         if (clientIterator->ClientId == it->first)
         {
-          clientSocket = clientIterator->ClientSocket;
+          sendQueue = clientIterator->SendQueue;
           break;
         }
       }
-      if (clientSocket.IsNull())
+      if (sendQueue == NULL)
       {
         LOG_WARNING("Message reply cannot be sent to client " << it->first << ", probably client has been disconnected.");
         continue;
@@ -478,7 +555,7 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendMessageResponses(vtkPlusOpenIGTLinkServ
 
       for (std::vector<igtl::MessageBase::Pointer>::iterator messageIt = it->second.begin(); messageIt != it->second.end(); ++messageIt)
       {
-        clientSocket->Send((*messageIt)->GetBufferPointer(), (*messageIt)->GetBufferSize());
+        sendQueue->PushMessage(*messageIt);
       }
     }
     self.MessageResponseQueue.clear();
@@ -507,22 +584,22 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendCommandResponses(vtkPlusOpenIGTLinkServ
       // Only send the response to the client that requested the command
       LOG_DEBUG("Send command reply to client " << (*responseIt)->GetClientId() << ": " << igtlResponseMessage->GetDeviceName());
       PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(self.IgtlClientsMutex);
-      igtl::ClientSocket::Pointer clientSocket = NULL;
+      vtkPlusIgtlClientSendQueue* sendQueue = NULL;
       for (std::list<ClientData>::iterator clientIterator = self.IgtlClients.begin(); clientIterator != self.IgtlClients.end(); ++clientIterator)
       {
         if (clientIterator->ClientId == (*responseIt)->GetClientId())
         {
-          clientSocket = clientIterator->ClientSocket;
+          sendQueue = clientIterator->SendQueue;
           break;
         }
       }
 
-      if (clientSocket.IsNull())
+      if (sendQueue == NULL)
       {
         LOG_WARNING("Message reply cannot be sent to client " << (*responseIt)->GetClientId() << ", probably client has been disconnected");
         continue;
       }
-      clientSocket->Send(igtlResponseMessage->GetBufferPointer(), igtlResponseMessage->GetBufferSize());
+      sendQueue->PushMessage(igtlResponseMessage);
     }
   }
 
@@ -596,7 +673,7 @@ void* vtkPlusOpenIGTLinkServer::DataReceiverThread(vtkMultiThreader::ThreadInfo*
       igtl::StatusMessage::Pointer replyMsg = dynamic_cast<igtl::StatusMessage*>(bodyMessage.GetPointer());
       replyMsg->SetCode(igtl::StatusMessage::STATUS_OK);
       replyMsg->Pack();
-      clientSocket->Send(replyMsg->GetPackPointer(), replyMsg->GetPackBodySize());
+      client->SendQueue->PushMessage(replyMsg.GetPointer());
     }
     else if (typeid(*bodyMessage) == typeid(igtl::StringMessage)
              && vtkPlusCommand::IsCommandDeviceName(headerMsg->GetDeviceName()))
@@ -821,6 +898,74 @@ void* vtkPlusOpenIGTLinkServer::DataReceiverThread(vtkMultiThreader::ThreadInfo*
   return NULL;
 }
 
+//----------------------------------------------------------------------------
+void* vtkPlusOpenIGTLinkServer::ClientSenderThread(vtkMultiThreader::ThreadInfo* data)
+{
+  ClientData* client = (ClientData*)(data->UserData);
+  client->ClientSenderActive.second = true;
+  vtkPlusOpenIGTLinkServer* self = client->Server;
+
+  // Make copy of frequently used data to avoid locking of client data
+  igtl::ClientSocket::Pointer clientSocket = client->ClientSocket;
+  vtkSmartPointer<vtkPlusIgtlClientSendQueue> sendQueue = client->SendQueue;
+
+  while (client->ClientSenderActive.first)
+  {
+    igtl::MessageBase::Pointer igtlMessage;
+    double acquisitionTimestamp = UNDEFINED_TIMESTAMP;
+    if (!sendQueue->PopMessage(igtlMessage, CLIENT_SENDER_WAIT_TIMEOUT_SEC, &acquisitionTimestamp))
+    {
+      continue;
+    }
+
+    int retValue = 0;
+    RETRY_UNTIL_TRUE((retValue = clientSocket->Send(igtlMessage->GetBufferPointer(), igtlMessage->GetBufferSize())) != 0, self->NumberOfRetryAttempts, self->DelayBetweenRetryAttemptsSec);
+    if (retValue == 0)
+    {
+      igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+      igtlMessage->GetTimeStamp(ts);
+      LOG_INFO("Client disconnected - could not send " << igtlMessage->GetMessageType() << " message to client " << client->ClientId << " (device name: " << igtlMessage->GetDeviceName()
+               << "  Timestamp: " << std::fixed << ts->GetTimeStamp() << ").");
+      // The data sender thread will disconnect the client
+      sendQueue->SetSendFailed(true);
+      sendQueue->Clear();
+      self->DataSenderNotifier->Notify();
+      break;
+    }
+
+    if (acquisitionTimestamp != UNDEFINED_TIMESTAMP)
+    {
+      self->RecordSendLatency(vtkPlusAccurateTimer::GetSystemTime() - acquisitionTimestamp);
+    }
+  }
+
+  // Close thread
+  client->ClientSenderThreadId = -1;
+  client->ClientSenderActive.second = false;
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkServer::DisconnectClientsWithFailedSend()
+{
+  std::vector<int> disconnectedClientIds;
+  {
+    PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+    for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
+    {
+      if (clientIterator->SendQueue->GetSendFailed())
+      {
+        disconnectedClientIds.push_back(clientIterator->ClientId);
+      }
+    }
+  }
+
+  for (std::vector< int >::iterator it = disconnectedClientIds.begin(); it != disconnectedClientIds.end(); ++it)
+  {
+    DisconnectClient(*it);
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(PlusTrackedFrame& trackedFrame)
 {
@@ -841,24 +986,21 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(PlusTrackedFrame& trackedF
   double timestampUniversal = vtkPlusAccurateTimer::GetUniversalTimeFromSystemTime(timestampSystem);
   trackedFrame.SetTimestamp(timestampUniversal);
 
-  std::vector<int> disconnectedClientIds;
   {
-    // Lock before we send message to the clients
+    // Lock before we queue messages for the clients. Messages are sent by the client sender threads, so the lock is held only while packing.
     PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
     for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
     {
-      igtl::ClientSocket::Pointer clientSocket = (*clientIterator).ClientSocket;
-
       // Create IGT messages
       std::vector<igtl::MessageBase::Pointer> igtlMessages;
       std::vector<igtl::MessageBase::Pointer>::iterator igtlMessageIterator;
 
-      if (this->IgtlMessageFactory->PackMessages(clientIterator->ClientInfo, igtlMessages, trackedFrame, this->SendValidTransformsOnly, this->TransformRepository) != PLUS_SUCCESS)
+      if (this->IgtlMessageFactory->PackMessages(clientIterator->ClientInfo, igtlMessages, trackedFrame, this->SendValidTransformsOnly, this->TransformRepository, &this->IgtlPackedMessageCache) != PLUS_SUCCESS)
       {
         LOG_WARNING("Failed to pack all IGT messages");
       }
 
-      // Send all messages to a client
+      // Queue all messages for the client
       for (igtlMessageIterator = igtlMessages.begin(); igtlMessageIterator != igtlMessages.end(); ++igtlMessageIterator)
       {
         igtl::MessageBase::Pointer igtlMessage = (*igtlMessageIterator);
@@ -867,28 +1009,28 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(PlusTrackedFrame& trackedF
           continue;
         }
 
-        int retValue = 0;
-        RETRY_UNTIL_TRUE((retValue = clientSocket->Send(igtlMessage->GetBufferPointer(), igtlMessage->GetBufferSize())) != 0, this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
-        if (retValue == 0)
+        if (!clientIterator->SendQueue->PushMessage(igtlMessage, timestampSystem))
         {
-          disconnectedClientIds.push_back(clientIterator->ClientId);
-          igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
-          igtlMessage->GetTimeStamp(ts);
-          LOG_INFO("Client disconnected - could not send " << igtlMessage->GetMessageType() << " message to client (device name: " << igtlMessage->GetDeviceName()
-                   << "  Timestamp: " << std::fixed << ts->GetTimeStamp() << ").");
-          break;
+          LOG_TRACE("Client " << clientIterator->ClientId << " cannot keep up with the data stream, a message was dropped from its send queue");
         }
 
         // Update the TDATA timestamp, even if TDATA isn't sent (cheaper than checking for existing TDATA message type)
         clientIterator->ClientInfo.LastTDATASentTimeStamp = trackedFrame.GetTimestamp();
       }
     }
-  }
 
-  // Clean up disconnected clients
-  for (std::vector< int >::iterator it = disconnectedClientIds.begin(); it != disconnectedClientIds.end(); ++it)
-  {
-    DisconnectClient(*it);
+    // Messages packed from this frame cannot be reused for the next one (the send queues keep their own references)
+    this->IgtlPackedMessageCache.Clear();
+
+    double currentTime = vtkPlusAccurateTimer::GetSystemTime();
+    if (currentTime - this->LastPackedMessageCacheReportTime > PACKED_MESSAGE_CACHE_REPORT_INTERVAL_SEC)
+    {
+      LOG_DEBUG("Packed message cache hit rate: " << this->IgtlPackedMessageCache.GetHitRate() * 100.0 << "% ("
+                << this->IgtlPackedMessageCache.GetNumberOfHits() << " hits, " << this->IgtlPackedMessageCache.GetNumberOfMisses() << " misses, "
+                << this->IgtlClients.size() << " clients)");
+      LOG_DEBUG("Acquisition-to-send latency histogram: " << this->GetSendLatencyHistogramAsString());
+      this->LastPackedMessageCacheReportTime = currentTime;
+    }
   }
 
   // restore original timestamp
@@ -911,6 +1053,12 @@ void vtkPlusOpenIGTLinkServer::DisconnectClient(int clientId)
         continue;
       }
       clientIterator->DataReceiverActive.first = false;
+      clientIterator->ClientSenderActive.first = false;
+      if (clientIterator->SendQueue != NULL)
+      {
+        // wake up the sender thread if it is waiting for messages
+        clientIterator->SendQueue->Interrupt();
+      }
       break;
     }
   }
@@ -941,8 +1089,21 @@ void vtkPlusOpenIGTLinkServer::DisconnectClient(int clientId)
             // thread stopped
             clientIterator->DataReceiverThreadId = -1;
           }
-          break;
         }
+        if (clientIterator->ClientSenderThreadId > 0)
+        {
+          if (clientIterator->ClientSenderActive.second)
+          {
+            // thread still running
+            clientDataReceiverThreadStillActive = true;
+          }
+          else
+          {
+            // thread stopped
+            clientIterator->ClientSenderThreadId = -1;
+          }
+        }
+        break;
       }
     }
     if (clientDataReceiverThreadStillActive)
@@ -983,39 +1144,66 @@ void vtkPlusOpenIGTLinkServer::KeepAlive()
 {
   LOG_TRACE("Keep alive packet sent to clients...");
 
-  std::vector< int > disconnectedClientIds;
+  // The same packed message is queued for all clients, status messages are never dropped
+  igtl::StatusMessage::Pointer replyMsg = igtl::StatusMessage::New();
+  replyMsg->SetCode(igtl::StatusMessage::STATUS_OK);
+  replyMsg->Pack();
 
+  // Lock before we queue the message for the clients
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+  for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
   {
-    // Lock before we send message to the clients
-    PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
-
-    for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
-    {
-      igtl::StatusMessage::Pointer replyMsg = igtl::StatusMessage::New();
-      replyMsg->SetCode(igtl::StatusMessage::STATUS_OK);
-      replyMsg->Pack();
+    clientIterator->SendQueue->PushMessage(replyMsg.GetPointer());
+  }
+}
 
-      int retValue = 0;
-      RETRY_UNTIL_TRUE(
-        (retValue = clientIterator->ClientSocket->Send(replyMsg->GetPackPointer(), replyMsg->GetPackSize())) != 0,
-        this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
-      if (retValue == 0)
-      {
-        disconnectedClientIds.push_back(clientIterator->ClientId);
-        igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
-        replyMsg->GetTimeStamp(ts);
+//------------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkServer::RecordSendLatency(double latencySec)
+{
+  double latencyMs = latencySec * 1000.0;
+  int binIndex = 0;
+  while (binIndex < SEND_LATENCY_HISTOGRAM_NUMBER_OF_BINS - 1 && latencyMs > SEND_LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_MS[binIndex])
+  {
+    binIndex++;
+  }
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> histogramGuardedLock(this->SendLatencyHistogramMutex);
+  this->SendLatencyHistogram[binIndex]++;
+}
 
-        LOG_DEBUG("Client disconnected - could not send " << replyMsg->GetMessageType() << " message to client (device name: " << replyMsg->GetDeviceName()
-                  << "  Timestamp: " << std::fixed <<  ts->GetTimeStamp() << ").");
-      }
-    } // clientIterator
-  } // unlock client list
+//------------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkServer::GetSendLatencyHistogram(std::vector<double>& binUpperLimitsMs, std::vector<unsigned long>& messageCounts) const
+{
+  binUpperLimitsMs.assign(SEND_LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_MS, SEND_LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_MS + SEND_LATENCY_HISTOGRAM_NUMBER_OF_BINS - 1);
+  binUpperLimitsMs.push_back(-1);
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> histogramGuardedLock(this->SendLatencyHistogramMutex);
+  messageCounts = this->SendLatencyHistogram;
+}
 
-  // Clean up disconnected clients
-  for (std::vector< int >::iterator it = disconnectedClientIds.begin(); it != disconnectedClientIds.end(); ++it)
+//------------------------------------------------------------------------------
+std::string vtkPlusOpenIGTLinkServer::GetSendLatencyHistogramAsString() const
+{
+  std::vector<double> binUpperLimitsMs;
+  std::vector<unsigned long> messageCounts;
+  this->GetSendLatencyHistogram(binUpperLimitsMs, messageCounts);
+  std::ostringstream ss;
+  double binLowerLimitMs = 0;
+  for (unsigned int i = 0; i < messageCounts.size(); ++i)
   {
-    DisconnectClient(*it);
+    if (i > 0)
+    {
+      ss << ", ";
+    }
+    if (binUpperLimitsMs[i] < 0)
+    {
+      ss << ">" << binLowerLimitMs << "ms: " << messageCounts[i];
+    }
+    else
+    {
+      ss << binLowerLimitMs << "-" << binUpperLimitsMs[i] << "ms: " << messageCounts[i];
+      binLowerLimitMs = binUpperLimitsMs[i];
+    }
   }
+  return ss.str();
 }
 
 //------------------------------------------------------------------------------
@@ -1026,6 +1214,13 @@ unsigned int vtkPlusOpenIGTLinkServer::GetNumberOfConnectedClients() const
   return this->IgtlClients.size();
 }
 
+//------------------------------------------------------------------------------
+double vtkPlusOpenIGTLinkServer::GetPackedMessageCacheHitRate() const
+{
+  PlusLockGuard<vtkPlusRecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+  return this->IgtlPackedMessageCache.GetHitRate();
+}
+
 //------------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkServer::GetClientInfo(unsigned int clientId, PlusIgtlClientInfo& outClientInfo) const
 {
@@ -1035,6 +1230,12 @@ PlusStatus vtkPlusOpenIGTLinkServer::GetClientInfo(unsigned int clientId, PlusIg
     if (it->ClientId == clientId)
     {
       outClientInfo = it->ClientInfo;
+      if (it->SendQueue != NULL)
+      {
+        outClientInfo.SendQueueDepth = it->SendQueue->GetNumberOfQueuedMessages();
+        outClientInfo.MaxSendQueueDepth = it->SendQueue->GetMaxQueueDepth();
+        outClientInfo.NumberOfDroppedMessages = it->SendQueue->GetNumberOfDroppedMessages();
+      }
       return PLUS_SUCCESS;
     }
   }
@@ -1062,6 +1263,21 @@ PlusStatus vtkPlusOpenIGTLinkServer::ReadConfiguration(vtkXMLDataElement* server
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfRetryAttempts, serverElement);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, DelayBetweenRetryAttemptsSec, serverElement);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, KeepAliveIntervalSec, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, ClientSendQueueSize, serverElement);
+  if (serverElement->GetAttribute("ClientSendQueueDropPolicy") != NULL)
+  {
+    if (vtkPlusIgtlClientSendQueue::DropPolicyFromString(serverElement->GetAttribute("ClientSendQueueDropPolicy"), this->ClientSendQueueDropPolicy) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Invalid ClientSendQueueDropPolicy: " << serverElement->GetAttribute("ClientSendQueueDropPolicy") << ". Valid values: DROP_OLDEST, DROP_NEWEST.");
+      return PLUS_FAIL;
+    }
+  }
+  if (serverElement->GetAttribute("ClientSendQueueDroppableMessageTypes") != NULL)
+  {
+    std::vector<std::string> messageTypes;
+    PlusCommon::SplitStringIntoTokens(serverElement->GetAttribute("ClientSendQueueDroppableMessageTypes"), ' ', messageTypes, false);
+    this->ClientSendQueueDroppableMessageTypes = std::set<std::string>(messageTypes.begin(), messageTypes.end());
+  }
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SendValidTransformsOnly, serverElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IgtlMessageCrcCheckEnabled, serverElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(LogWarningOnNoDataAvailable, serverElement);
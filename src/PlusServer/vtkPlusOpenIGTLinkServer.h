@@ -11,7 +11,9 @@
 #include "vtkPlusServerExport.h"
 #include "PlusIgtlClientInfo.h"
 #include "vtkPlusDataCollector.h"
+#include "vtkPlusIgtlClientSendQueue.h"
 #include "vtkPlusIgtlMessageFactory.h"
+#include "vtkPlusNewDataNotifier.h"
 #include "vtkPlusTransformRepository.h"
 
 // VTK includes
@@ -21,6 +23,7 @@
 
 // STL includes
 #include <deque>
+#include <set>
 
 // OS includes
 #if (_MSC_VER == 1500)
@@ -47,6 +50,8 @@ struct ClientData
     , ClientSocket(NULL)
     , DataReceiverActive(std::make_pair(false, false))
     , DataReceiverThreadId(-1)
+    , ClientSenderActive(std::make_pair(false, false))
+    , ClientSenderThreadId(-1)
     , Server(NULL)
   {
   }
@@ -65,6 +70,13 @@ struct ClientData
   std::pair<bool, bool> DataReceiverActive;
   int DataReceiverThreadId;
 
+  /// Active flag for the thread that sends the queued messages to the client (first: request, second: respond )
+  std::pair<bool, bool> ClientSenderActive;
+  int ClientSenderThreadId;
+
+  /// Messages waiting to be sent to the client
+  vtkSmartPointer<vtkPlusIgtlClientSendQueue> SendQueue;
+
   PlusIgtlClientInfo ClientInfo;
 
   vtkPlusOpenIGTLinkServer* Server;
@@ -137,8 +149,23 @@ public:
   /*! Get number of connected clients */
   virtual unsigned int GetNumberOfConnectedClients() const;
 
+  /*!
+    Get the ratio of IGTL messages that were reused from the packed message cache instead of being packed for each client.
+    Computed over all frames sent since the server was started.
+  */
+  double GetPackedMessageCacheHitRate() const;
+
+  /*!
+    Get the histogram of the acquisition-to-send latency of the data messages (time between the acquisition timestamp of a frame
+    and the time when the message is written to the client socket). Collected since the server was started.
+    \param binUpperLimitsMs Upper limit of each bin in milliseconds, the last bin has no upper limit (set to -1)
+    \param messageCounts Number of sent messages in each bin
+  */
+  void GetSendLatencyHistogram(std::vector<double>& binUpperLimitsMs, std::vector<unsigned long>& messageCounts) const;
+
   /*! Retrieve a COPY of client info for a given clientId
-    Locks access to the client info for the duration of the function
+    Locks access to the client info for the duration of the function.
+    The send queue statistics (SendQueueDepth, MaxSendQueueDepth, NumberOfDroppedMessages) are filled from the client's send queue.
     */
   virtual PlusStatus GetClientInfo(unsigned int clientId, PlusIgtlClientInfo& outClientInfo) const;
 
@@ -183,6 +210,18 @@ protected:
   /*! Thread for receiving control data from clients */
   static void* DataReceiverThread(vtkMultiThreader::ThreadInfo* data);
 
+  /*! Thread for sending the messages queued for a single client */
+  static void* ClientSenderThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Disconnect all clients whose sender thread failed to send a message */
+  void DisconnectClientsWithFailedSend();
+
+  /*! Add a message to the acquisition-to-send latency histogram */
+  void RecordSendLatency(double latencySec);
+
+  /*! Get the acquisition-to-send latency histogram in a human-readable form (for logging) */
+  std::string GetSendLatencyHistogramAsString() const;
+
   /*! Tracked frame interface, sends the selected message type and data to all clients */
   virtual PlusStatus SendTrackedFrame(PlusTrackedFrame& trackedFrame);
 
@@ -215,6 +254,9 @@ protected:
   vtkSetMacro(KeepAliveIntervalSec, double);
   vtkGetMacroConst(KeepAliveIntervalSec, double);
 
+  vtkSetMacro(ClientSendQueueSize, int);
+  vtkGetMacroConst(ClientSendQueueSize, int);
+
   vtkSetStdStringMacro(OutputChannelId);
   vtkSetStdStringMacro(ConfigFilename);
 
@@ -251,6 +293,15 @@ private:
   /*! Maximum number of IGTL messages to send in one period */
   int MaxNumberOfIgtlMessagesToSend;
 
+  /*! Maximum number of messages waiting to be sent to a client before droppable messages are discarded */
+  int ClientSendQueueSize;
+
+  /*! Decides which message is discarded when a client's send queue is full */
+  vtkPlusIgtlClientSendQueue::DropPolicyType ClientSendQueueDropPolicy;
+
+  /*! Message types that may be discarded when a client's send queue is full. Other message types are never dropped. */
+  std::set<std::string> ClientSendQueueDroppableMessageTypes;
+
   // Active flag for threads (first: request, second: respond )
   std::pair<bool, bool> ConnectionActive;
   std::pair<bool, bool> DataSenderActive;
@@ -268,6 +319,30 @@ private:
   /*! Mutex instance for accessing client data list */
   vtkSmartPointer<vtkPlusRecursiveCriticalSection> IgtlClientsMutex;
 
+  /*!
+    Messages packed from the tracked frame that is currently being sent. Clients with identical subscriptions share the packed messages.
+    Protected by IgtlClientsMutex.
+  */
+  vtkPlusIgtlMessageFactory::PackedMessageCache IgtlPackedMessageCache;
+
+  /*! Time of the last packed message cache statistics log message */
+  double LastPackedMessageCacheReportTime;
+
+  /*!
+    Wakes up the data sender thread when there is something to send: a new item in the broadcast channel buffers,
+    a new client connection, a queued reply, or a failed client.
+  */
+  vtkSmartPointer<vtkPlusNewDataNotifier> DataSenderNotifier;
+
+  /*! Number of DataSenderNotifier notifications that the data sender thread has already processed */
+  unsigned long DataSenderNotificationCount;
+
+  /*! Number of sent data messages in each acquisition-to-send latency bin */
+  std::vector<unsigned long> SendLatencyHistogram;
+
+  /*! Mutex to protect access to the latency histogram, which is updated by all the client sender threads */
+  vtkSmartPointer<vtkPlusRecursiveCriticalSection> SendLatencyHistogramMutex;
+
   /*! Last sent tracked frame timestamp */
   double LastSentTrackedFrameTimestamp;
 
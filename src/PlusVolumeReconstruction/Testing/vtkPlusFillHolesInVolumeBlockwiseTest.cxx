@@ -0,0 +1,296 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusFillHolesInVolumeBlockwiseTest.cxx
+  \brief Compare blockwise hole filling with the per-voxel hole filling
+
+  Fills the holes of a synthetic reconstructed volume (a tilted freehand sweep with gaps between the slices)
+  with gaussian, gaussian accumulation, distance weight inverse, nearest neighbor, and stick elements and
+  with a chain of elements. Holes are filled voxel by voxel, block by block without SIMD instructions, and
+  block by block with SIMD instructions. The test fails if a blockwise filled voxel differs by more than
+  one gray level from the per-voxel result or if the SIMD and non-SIMD results are not exactly the same.
+  The hole filling times are reported; use --volume-size=512 for benchmarking.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusCpuFeatures.h"
+#include "vtkImageData.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkPlusFillHolesInVolume.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <cstring>
+#include <stdlib.h>
+
+namespace
+{
+  // every SLICE_DISTANCE_VOXEL-th slice of the sweep contains data
+  const int SLICE_DISTANCE_VOXEL = 3;
+  // slices are tilted: slice index changes by SLICE_TILT voxels per row
+  const double SLICE_TILT = 0.3;
+  // radius of the scanned cylinder relative to the volume size
+  const double SCANNED_RADIUS_RATIO = 0.4;
+
+  enum ElementSetType
+  {
+    ELEMENT_SET_GAUSSIAN,
+    ELEMENT_SET_GAUSSIAN_ACCUMULATION,
+    ELEMENT_SET_DISTANCE_WEIGHT_INVERSE,
+    ELEMENT_SET_NEAREST_NEIGHBOR,
+    ELEMENT_SET_STICK,
+    ELEMENT_SET_CHAIN,
+    NUMBER_OF_ELEMENT_SETS
+  };
+
+  //----------------------------------------------------------------------------
+  const char* GetElementSetName(int elementSet)
+  {
+    switch (elementSet)
+    {
+    case ELEMENT_SET_GAUSSIAN: return "GAUSSIAN";
+    case ELEMENT_SET_GAUSSIAN_ACCUMULATION: return "GAUSSIAN_ACCUMULATION";
+    case ELEMENT_SET_DISTANCE_WEIGHT_INVERSE: return "DISTANCE_WEIGHT_INVERSE";
+    case ELEMENT_SET_NEAREST_NEIGHBOR: return "NEAREST_NEIGHBOR";
+    case ELEMENT_SET_STICK: return "STICK";
+    case ELEMENT_SET_CHAIN: return "GAUSSIAN+STICK+NEAREST_NEIGHBOR";
+    default: return "unknown";
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void SetElements(vtkPlusFillHolesInVolume* holeFiller, int elementSet)
+  {
+    FillHolesInVolumeElement elements[3];
+    int numberOfElements = 1;
+    switch (elementSet)
+    {
+    case ELEMENT_SET_GAUSSIAN:
+      elements[0].setupAsGaussian(7, 1.5, 0.1);
+      break;
+    case ELEMENT_SET_GAUSSIAN_ACCUMULATION:
+      elements[0].setupAsGaussianAccumulation(5, 1.0, 0.05);
+      break;
+    case ELEMENT_SET_DISTANCE_WEIGHT_INVERSE:
+      elements[0].setupAsDistanceWeightInverse(5, 0.1);
+      break;
+    case ELEMENT_SET_NEAREST_NEIGHBOR:
+      elements[0].setupAsNearestNeighbor(3, 0);
+      break;
+    case ELEMENT_SET_STICK:
+      elements[0].setupAsStick(9, 3);
+      break;
+    case ELEMENT_SET_CHAIN:
+      elements[0].setupAsGaussian(5, 1.0, 0.5);
+      elements[1].setupAsStick(9, 1);
+      elements[2].setupAsNearestNeighbor(5, 0);
+      numberOfElements = 3;
+      break;
+    }
+    holeFiller->SetNumHFElements(numberOfElements);
+    holeFiller->AllocateHFElements();
+    for (int i = 0; i < numberOfElements; ++i)
+    {
+      holeFiller->SetHFElement(i, elements[i]);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void CreateSweepVolume(int volumeSize, vtkImageData* reconstructedVolume, vtkImageData* accumulationBuffer)
+  {
+    reconstructedVolume->SetExtent(0, volumeSize - 1, 0, volumeSize - 1, 0, volumeSize - 1);
+    reconstructedVolume->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    accumulationBuffer->SetExtent(0, volumeSize - 1, 0, volumeSize - 1, 0, volumeSize - 1);
+    accumulationBuffer->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+    unsigned char* volumePtr = static_cast<unsigned char*>(reconstructedVolume->GetScalarPointer());
+    unsigned short* accumulationPtr = static_cast<unsigned short*>(accumulationBuffer->GetScalarPointer());
+    unsigned int seed = 1;
+    const double center = volumeSize / 2.0;
+    const double radius = volumeSize * SCANNED_RADIUS_RATIO;
+    for (int z = 0; z < volumeSize; ++z)
+    {
+      for (int y = 0; y < volumeSize; ++y)
+      {
+        for (int x = 0; x < volumeSize; ++x)
+        {
+          seed = seed * 1103515245 + 12345;
+          unsigned int random = (seed >> 16) & 0x7FFF;
+          bool scanned = (x - center) * (x - center) + (y - center) * (y - center) <= radius * radius
+                         && (z + static_cast<int>(SLICE_TILT * y)) % SLICE_DISTANCE_VOXEL == 0
+                         && random % 10 != 0; // some voxels are missed even within the slices
+          // a homogeneous region and a speckle-like region
+          *(volumePtr++) = (scanned ? (x < volumeSize / 3 ? 100 : static_cast<unsigned char>(random & 0xFF)) : 0);
+          *(accumulationPtr++) = (scanned ? static_cast<unsigned short>(1 + random % 3) : 0);
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus FillHoles(vtkImageData* reconstructedVolume, vtkImageData* accumulationBuffer, int elementSet, bool blockwise, bool simdEnabled,
+                       vtkImageData* holeFilledVolume, double& fillingTimeSec)
+  {
+    vtkSmartPointer<vtkPlusFillHolesInVolume> holeFiller = vtkSmartPointer<vtkPlusFillHolesInVolume>::New();
+    holeFiller->SetReconstructedVolume(reconstructedVolume);
+    holeFiller->SetAccumulationBuffer(accumulationBuffer);
+    SetElements(holeFiller, elementSet);
+    holeFiller->SetBlockwiseFillingEnabled(blockwise);
+    holeFiller->SetSimdEnabled(simdEnabled);
+    double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    holeFiller->Update();
+    fillingTimeSec = vtkPlusAccurateTimer::GetSystemTime() - startTime;
+    if (holeFiller->GetOutput() == NULL || holeFiller->GetOutput()->GetScalarPointer() == NULL)
+    {
+      LOG_ERROR("Hole filling failed with " << GetElementSetName(elementSet));
+      return PLUS_FAIL;
+    }
+    holeFilledVolume->DeepCopy(holeFiller->GetOutput());
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns the number of voxels that differ and the largest difference. Returns false if the images cannot be compared.
+  bool CompareVolumes(vtkImageData* volume1, vtkImageData* volume2, vtkIdType& numberOfDifferentVoxels, int& maximumDifference)
+  {
+    numberOfDifferentVoxels = 0;
+    maximumDifference = 0;
+    int* extent1 = volume1->GetExtent();
+    int* extent2 = volume2->GetExtent();
+    for (int i = 0; i < 6; ++i)
+    {
+      if (extent1[i] != extent2[i])
+      {
+        return false;
+      }
+    }
+    if (volume1->GetScalarType() != VTK_UNSIGNED_CHAR || volume2->GetScalarType() != VTK_UNSIGNED_CHAR)
+    {
+      return false;
+    }
+    const unsigned char* voxels1 = static_cast<unsigned char*>(volume1->GetScalarPointer());
+    const unsigned char* voxels2 = static_cast<unsigned char*>(volume2->GetScalarPointer());
+    vtkIdType numberOfVoxels = volume1->GetNumberOfPoints();
+    for (vtkIdType i = 0; i < numberOfVoxels; ++i)
+    {
+      int difference = abs(static_cast<int>(voxels1[i]) - static_cast<int>(voxels2[i]));
+      if (difference > 0)
+      {
+        ++numberOfDifferentVoxels;
+        if (difference > maximumDifference)
+        {
+          maximumDifference = difference;
+        }
+      }
+    }
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int volumeSize = 64;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--volume-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &volumeSize, "Number of voxels along each side of the volume (default: 64)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (volumeSize < 1)
+  {
+    LOG_ERROR("Volume size must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  bool simdSupported = (PlusCpuFeatures::GetInstructionSet() >= PlusCpuFeatures::INSTRUCTION_SET_AVX2);
+  if (!simdSupported)
+  {
+    LOG_INFO("SIMD instructions are not available, blockwise hole filling is only tested without SIMD instructions");
+  }
+
+  vtkSmartPointer<vtkImageData> reconstructedVolume = vtkSmartPointer<vtkImageData>::New();
+  vtkSmartPointer<vtkImageData> accumulationBuffer = vtkSmartPointer<vtkImageData>::New();
+  CreateSweepVolume(volumeSize, reconstructedVolume, accumulationBuffer);
+
+  int numberOfFailures = 0;
+  for (int elementSet = 0; elementSet < NUMBER_OF_ELEMENT_SETS; ++elementSet)
+  {
+    const char* elementSetName = GetElementSetName(elementSet);
+
+    vtkSmartPointer<vtkImageData> perVoxelVolume = vtkSmartPointer<vtkImageData>::New();
+    double perVoxelTimeSec = 0;
+    if (FillHoles(reconstructedVolume, accumulationBuffer, elementSet, false, false, perVoxelVolume, perVoxelTimeSec) != PLUS_SUCCESS)
+    {
+      exit(EXIT_FAILURE);
+    }
+
+    vtkSmartPointer<vtkImageData> blockwiseVolume = vtkSmartPointer<vtkImageData>::New();
+    double blockwiseTimeSec = 0;
+    if (FillHoles(reconstructedVolume, accumulationBuffer, elementSet, true, false, blockwiseVolume, blockwiseTimeSec) != PLUS_SUCCESS)
+    {
+      exit(EXIT_FAILURE);
+    }
+    LOG_INFO(elementSetName << ": per-voxel " << perVoxelTimeSec << " sec, blockwise " << blockwiseTimeSec << " sec (speedup: "
+             << (blockwiseTimeSec > 0 ? perVoxelTimeSec / blockwiseTimeSec : 0.0) << "x)");
+
+    vtkIdType numberOfDifferentVoxels = 0;
+    int maximumDifference = 0;
+    if (!CompareVolumes(perVoxelVolume, blockwiseVolume, numberOfDifferentVoxels, maximumDifference))
+    {
+      LOG_ERROR(elementSetName << ": blockwise hole filled volume cannot be compared to the per-voxel result");
+      ++numberOfFailures;
+    }
+    else if (maximumDifference > 1)
+    {
+      LOG_ERROR(elementSetName << ": " << numberOfDifferentVoxels << " voxels are different in the blockwise hole filled volume, maximum difference: " << maximumDifference);
+      ++numberOfFailures;
+    }
+    else
+    {
+      LOG_INFO(elementSetName << ": " << numberOfDifferentVoxels << " voxels differ by one gray level in the blockwise hole filled volume");
+    }
+
+    if (!simdSupported)
+    {
+      continue;
+    }
+
+    vtkSmartPointer<vtkImageData> simdVolume = vtkSmartPointer<vtkImageData>::New();
+    double simdTimeSec = 0;
+    if (FillHoles(reconstructedVolume, accumulationBuffer, elementSet, true, true, simdVolume, simdTimeSec) != PLUS_SUCCESS)
+    {
+      exit(EXIT_FAILURE);
+    }
+    LOG_INFO(elementSetName << ": blockwise with SIMD " << simdTimeSec << " sec (speedup: "
+             << (simdTimeSec > 0 ? perVoxelTimeSec / simdTimeSec : 0.0) << "x)");
+
+    if (!CompareVolumes(blockwiseVolume, simdVolume, numberOfDifferentVoxels, maximumDifference) || numberOfDifferentVoxels > 0)
+    {
+      LOG_ERROR(elementSetName << ": hole filled volume is different with SIMD instructions");
+      ++numberOfFailures;
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,217 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusPasteSliceIntoVolumeSimdTest.cxx
+  \brief Compare slice pasting with and without SIMD instructions
+
+  Pastes a synthetic freehand sweep of 8-bit B-mode frames into volumes with 0.5mm and 0.2mm spacing
+  using LINEAR interpolation, MEAN compounding, and FULL_OPTIMIZATION. Each volume is reconstructed with
+  and without SIMD instructions using one thread. The test fails if the reconstructed volumes or
+  accumulation buffers are not exactly the same. The number of pasted slices per second is reported.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusCpuFeatures.h"
+#include "vtkImageData.h"
+#include "vtkMath.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkPlusPasteSliceIntoVolume.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <cstring>
+
+namespace
+{
+  const double PIXEL_SIZE_MM = 0.1;
+  const double FRAME_DISTANCE_MM = 0.3;
+  const double FRAME_TILT_DEG = 5.0;
+  const double VOLUME_MARGIN_MM = 5.0;
+
+  //----------------------------------------------------------------------------
+  void CreateFrame(vtkImageData* frame, int frameWidth, int frameHeight, unsigned int seed)
+  {
+    frame->SetExtent(0, frameWidth - 1, 0, frameHeight - 1, 0, 0);
+    frame->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    unsigned char* pixels = static_cast<unsigned char*>(frame->GetScalarPointer());
+    // speckle-like pattern: pseudo-random values with brightness decreasing with depth
+    for (int y = 0; y < frameHeight; ++y)
+    {
+      for (int x = 0; x < frameWidth; ++x)
+      {
+        seed = seed * 1103515245 + 12345;
+        *(pixels++) = static_cast<unsigned char>(((seed >> 16) & 0xFF) * (frameHeight - y / 2) / frameHeight);
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void GetImageToReferenceMatrix(int frameIndex, vtkMatrix4x4* imageToReference)
+  {
+    // frames are parallel to the XY plane, slightly tilted around the X axis, moving along the Z axis
+    double tiltRad = vtkMath::RadiansFromDegrees(FRAME_TILT_DEG) * ((frameIndex % 20) < 10 ? 1.0 : -1.0);
+    imageToReference->Identity();
+    imageToReference->SetElement(0, 0, PIXEL_SIZE_MM);
+    imageToReference->SetElement(1, 1, PIXEL_SIZE_MM * cos(tiltRad));
+    imageToReference->SetElement(2, 1, PIXEL_SIZE_MM * sin(tiltRad));
+    imageToReference->SetElement(2, 3, frameIndex * FRAME_DISTANCE_MM);
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus ReconstructVolume(vtkImageData* frame, int numberOfFrames, double outputSpacingMm, bool simdEnabled,
+                               vtkImageData* reconstructedVolume, vtkImageData* accumulationBuffer, double& slicesPerSec)
+  {
+    int* frameExtent = frame->GetExtent();
+    double volumeSizeMm[3] =
+    {
+      (frameExtent[1] + 1) * PIXEL_SIZE_MM,
+      (frameExtent[3] + 1) * PIXEL_SIZE_MM,
+      numberOfFrames * FRAME_DISTANCE_MM + 2 * VOLUME_MARGIN_MM
+    };
+    vtkSmartPointer<vtkPlusPasteSliceIntoVolume> reconstructor = vtkSmartPointer<vtkPlusPasteSliceIntoVolume>::New();
+    reconstructor->SetOutputOrigin(0.0, 0.0, -VOLUME_MARGIN_MM);
+    reconstructor->SetOutputSpacing(outputSpacingMm, outputSpacingMm, outputSpacingMm);
+    reconstructor->SetOutputExtent(0, static_cast<int>(volumeSizeMm[0] / outputSpacingMm), 0, static_cast<int>(volumeSizeMm[1] / outputSpacingMm),
+                                   0, static_cast<int>(volumeSizeMm[2] / outputSpacingMm));
+    reconstructor->SetOutputScalarMode(VTK_UNSIGNED_CHAR);
+    reconstructor->SetInterpolationMode(vtkPlusPasteSliceIntoVolume::LINEAR_INTERPOLATION);
+    reconstructor->SetCompoundingMode(vtkPlusPasteSliceIntoVolume::MEAN_COMPOUNDING_MODE);
+    reconstructor->SetOptimization(vtkPlusPasteSliceIntoVolume::FULL_OPTIMIZATION);
+    reconstructor->SetNumberOfThreads(1);
+    reconstructor->SetSimdEnabled(simdEnabled);
+    if (reconstructor->ResetOutput() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate the output volume");
+      return PLUS_FAIL;
+    }
+
+    vtkSmartPointer<vtkMatrix4x4> imageToReference = vtkSmartPointer<vtkMatrix4x4>::New();
+    double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+      GetImageToReferenceMatrix(frameIndex, imageToReference);
+      if (reconstructor->InsertSlice(frame, imageToReference) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to paste frame " << frameIndex);
+        return PLUS_FAIL;
+      }
+    }
+    double reconstructionTimeSec = vtkPlusAccurateTimer::GetSystemTime() - startTime;
+    slicesPerSec = (reconstructionTimeSec > 0 ? numberOfFrames / reconstructionTimeSec : 0.0);
+
+    reconstructedVolume->DeepCopy(reconstructor->GetReconstructedVolume());
+    accumulationBuffer->DeepCopy(reconstructor->GetAccumulationBuffer());
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsEqual(vtkImageData* image1, vtkImageData* image2)
+  {
+    int* extent1 = image1->GetExtent();
+    int* extent2 = image2->GetExtent();
+    for (int i = 0; i < 6; ++i)
+    {
+      if (extent1[i] != extent2[i])
+      {
+        return false;
+      }
+    }
+    size_t imageSizeBytes = static_cast<size_t>(image1->GetNumberOfPoints()) * image1->GetScalarSize() * image1->GetNumberOfScalarComponents();
+    return image1->GetScalarType() == image2->GetScalarType()
+           && image1->GetNumberOfScalarComponents() == image2->GetNumberOfScalarComponents()
+           && memcmp(image1->GetScalarPointer(), image2->GetScalarPointer(), imageSizeBytes) == 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int numberOfFrames = 100;
+  int frameWidth = 640;
+  int frameHeight = 480;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--number-of-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of pasted frames (default: 100)");
+  args.AddArgument("--frame-width", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameWidth, "Frame width in pixels (default: 640)");
+  args.AddArgument("--frame-height", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &frameHeight, "Frame height in pixels (default: 480)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfFrames < 1 || frameWidth < 1 || frameHeight < 1)
+  {
+    LOG_ERROR("Number of frames and frame size must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  bool simdSupported = (PlusCpuFeatures::GetInstructionSet() >= PlusCpuFeatures::INSTRUCTION_SET_AVX2);
+  if (!simdSupported)
+  {
+    LOG_INFO("SIMD instructions are not available, only the reconstruction speed without SIMD instructions is measured");
+  }
+
+  vtkSmartPointer<vtkImageData> frame = vtkSmartPointer<vtkImageData>::New();
+  CreateFrame(frame, frameWidth, frameHeight, 1);
+
+  int numberOfFailures = 0;
+  const double outputSpacingsMm[2] = {0.5, 0.2};
+  for (int spacingIndex = 0; spacingIndex < 2; ++spacingIndex)
+  {
+    vtkSmartPointer<vtkImageData> referenceVolume = vtkSmartPointer<vtkImageData>::New();
+    vtkSmartPointer<vtkImageData> referenceAccumulation = vtkSmartPointer<vtkImageData>::New();
+    double referenceSlicesPerSec = 0;
+    if (ReconstructVolume(frame, numberOfFrames, outputSpacingsMm[spacingIndex], false, referenceVolume, referenceAccumulation, referenceSlicesPerSec) != PLUS_SUCCESS)
+    {
+      exit(EXIT_FAILURE);
+    }
+    LOG_INFO("Output spacing " << outputSpacingsMm[spacingIndex] << "mm, without SIMD: " << referenceSlicesPerSec << " slices/sec");
+    if (!simdSupported)
+    {
+      continue;
+    }
+
+    vtkSmartPointer<vtkImageData> simdVolume = vtkSmartPointer<vtkImageData>::New();
+    vtkSmartPointer<vtkImageData> simdAccumulation = vtkSmartPointer<vtkImageData>::New();
+    double simdSlicesPerSec = 0;
+    if (ReconstructVolume(frame, numberOfFrames, outputSpacingsMm[spacingIndex], true, simdVolume, simdAccumulation, simdSlicesPerSec) != PLUS_SUCCESS)
+    {
+      exit(EXIT_FAILURE);
+    }
+    LOG_INFO("Output spacing " << outputSpacingsMm[spacingIndex] << "mm, with SIMD: " << simdSlicesPerSec << " slices/sec (speedup: "
+             << (referenceSlicesPerSec > 0 ? simdSlicesPerSec / referenceSlicesPerSec : 0.0) << "x)");
+
+    if (!IsEqual(referenceVolume, simdVolume))
+    {
+      LOG_ERROR("Output spacing " << outputSpacingsMm[spacingIndex] << "mm: reconstructed volume is different with SIMD instructions");
+      ++numberOfFailures;
+    }
+    if (!IsEqual(referenceAccumulation, simdAccumulation))
+    {
+      LOG_ERROR("Output spacing " << outputSpacingsMm[spacingIndex] << "mm: accumulation buffer is different with SIMD instructions");
+      ++numberOfFailures;
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusVolumeReconstructorBatchTest.cxx
+  \brief Compare pasting frames in batches with adding them one by one
+
+  Reconstructs the volume from the input sequence with all the compounding modes that support concurrent
+  pasting of frames, using both interpolation modes. Each volume is reconstructed three times:
+  by adding the frames one by one using one thread (reference), by adding the frames one by one using
+  all threads (the frames are split between threads), and by adding the frames in batches using all threads.
+  The test fails if the volume that is reconstructed from batches is not exactly the same as the reference.
+  The reconstruction times are reported.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusTrackedFrame.h"
+#include "vtkImageData.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusTrackedFrameList.h"
+#include "vtkPlusTransformRepository.h"
+#include "vtkPlusVolumeReconstructor.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  enum InsertionMethod
+  {
+    INSERT_FRAMES_SINGLE_THREAD,
+    INSERT_FRAMES_MULTI_THREAD,
+    INSERT_FRAME_BATCHES_MULTI_THREAD
+  };
+
+  //----------------------------------------------------------------------------
+  PlusStatus ReconstructVolume(vtkXMLDataElement* configRootElement, vtkPlusTrackedFrameList* trackedFrameList, vtkPlusTransformRepository* transformRepository,
+                               vtkPlusPasteSliceIntoVolume::CompoundingType compoundingMode, vtkPlusPasteSliceIntoVolume::InterpolationType interpolationMode,
+                               InsertionMethod insertionMethod, vtkImageData* grayLevels, vtkImageData* accumulation, double& reconstructionTimeSec)
+  {
+    vtkSmartPointer<vtkPlusVolumeReconstructor> reconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
+    if (reconstructor->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read volume reconstruction configuration");
+      return PLUS_FAIL;
+    }
+    reconstructor->SetCompoundingMode(compoundingMode);
+    reconstructor->SetInterpolation(interpolationMode);
+    // fixed-point math is only faster with nearest neighbor interpolation
+    reconstructor->SetOptimization(interpolationMode == vtkPlusPasteSliceIntoVolume::NEAREST_NEIGHBOR_INTERPOLATION ?
+                                   vtkPlusPasteSliceIntoVolume::FULL_OPTIMIZATION : vtkPlusPasteSliceIntoVolume::PARTIAL_OPTIMIZATION);
+    reconstructor->SetNumberOfThreads(insertionMethod == INSERT_FRAMES_SINGLE_THREAD ? 1 : 0);
+    reconstructor->SetFillHoles(false);
+
+    std::string errorDescription;
+    if (reconstructor->SetOutputExtentFromFrameList(trackedFrameList, transformRepository, errorDescription) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set output extent of volume: " << errorDescription);
+      return PLUS_FAIL;
+    }
+
+    double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    if (insertionMethod == INSERT_FRAME_BATCHES_MULTI_THREAD)
+    {
+      if (reconstructor->AddTrackedFrames(trackedFrameList, transformRepository) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add tracked frames to the volume");
+        return PLUS_FAIL;
+      }
+    }
+    else
+    {
+      for (unsigned int frameIndex = 0; frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); frameIndex += reconstructor->GetSkipInterval())
+      {
+        PlusTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+        if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
+          return PLUS_FAIL;
+        }
+        if (reconstructor->AddTrackedFrame(frame, transformRepository) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to add tracked frame #" << frameIndex << " to the volume");
+          return PLUS_FAIL;
+        }
+      }
+    }
+    reconstructionTimeSec = vtkPlusAccurateTimer::GetSystemTime() - startTime;
+
+    if (reconstructor->ExtractGrayLevels(grayLevels) != PLUS_SUCCESS
+        || reconstructor->ExtractAccumulation(accumulation) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get the reconstructed volume");
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Returns the number of voxels that are different in the two volumes (-1 if the volumes cannot be compared) */
+  int GetNumberOfDifferentVoxels(vtkImageData* volume1, vtkImageData* volume2)
+  {
+    if (volume1->GetNumberOfPoints() != volume2->GetNumberOfPoints()
+        || volume1->GetScalarType() != volume2->GetScalarType()
+        || volume1->GetNumberOfScalarComponents() != volume2->GetNumberOfScalarComponents())
+    {
+      return -1;
+    }
+    const int voxelSize = volume1->GetScalarSize() * volume1->GetNumberOfScalarComponents();
+    const char* voxel1 = static_cast<const char*>(volume1->GetScalarPointer());
+    const char* voxel2 = static_cast<const char*>(volume2->GetScalarPointer());
+    int numberOfDifferentVoxels = 0;
+    for (vtkIdType i = 0; i < volume1->GetNumberOfPoints(); ++i, voxel1 += voxelSize, voxel2 += voxelSize)
+    {
+      if (memcmp(voxel1, voxel2, voxelSize) != 0)
+      {
+        ++numberOfDifferentVoxels;
+      }
+    }
+    return numberOfDifferentVoxels;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  bool printHelp(false);
+  std::string inputConfigFileName;
+  std::string inputImgSeqFileName;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Input configuration file name (.xml)");
+  cmdargs.AddArgument("--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputImgSeqFileName, "Input sequence file filename (.mha/.nrrd)");
+  cmdargs.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputConfigFileName.empty() || inputImgSeqFileName.empty())
+  {
+    std::cerr << "Input config file and sequence file names are required" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, inputConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << inputConfigFileName);
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkPlusTransformRepository> transformRepository = vtkSmartPointer<vtkPlusTransformRepository>::New();
+  if (configRootElement->FindNestedElementWithName("CoordinateDefinitions") != NULL
+      && transformRepository->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read transforms from CoordinateDefinitions");
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkPlusTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(inputImgSeqFileName, trackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to load input sequence file " << inputImgSeqFileName);
+    exit(EXIT_FAILURE);
+  }
+
+  const vtkPlusPasteSliceIntoVolume::CompoundingType compoundingModes[3] =
+  {
+    vtkPlusPasteSliceIntoVolume::LATEST_COMPOUNDING_MODE,
+    vtkPlusPasteSliceIntoVolume::MAXIMUM_COMPOUNDING_MODE,
+    vtkPlusPasteSliceIntoVolume::MEAN_COMPOUNDING_MODE
+  };
+  const vtkPlusPasteSliceIntoVolume::InterpolationType interpolationModes[2] =
+  {
+    vtkPlusPasteSliceIntoVolume::NEAREST_NEIGHBOR_INTERPOLATION,
+    vtkPlusPasteSliceIntoVolume::LINEAR_INTERPOLATION
+  };
+
+  vtkSmartPointer<vtkPlusPasteSliceIntoVolume> modeNames = vtkSmartPointer<vtkPlusPasteSliceIntoVolume>::New();
+  int numberOfFailures = 0;
+  for (int compoundingIndex = 0; compoundingIndex < 3; ++compoundingIndex)
+  {
+    for (int interpolationIndex = 0; interpolationIndex < 2; ++interpolationIndex)
+    {
+      vtkPlusPasteSliceIntoVolume::CompoundingType compoundingMode = compoundingModes[compoundingIndex];
+      vtkPlusPasteSliceIntoVolume::InterpolationType interpolationMode = interpolationModes[interpolationIndex];
+      std::string modeName = std::string(modeNames->GetCompoundingModeAsString(compoundingMode)) + " compounding, "
+                             + modeNames->GetInterpolationModeAsString(interpolationMode) + " interpolation";
+
+      vtkSmartPointer<vtkImageData> referenceGrayLevels = vtkSmartPointer<vtkImageData>::New();
+      vtkSmartPointer<vtkImageData> referenceAccumulation = vtkSmartPointer<vtkImageData>::New();
+      vtkSmartPointer<vtkImageData> grayLevels = vtkSmartPointer<vtkImageData>::New();
+      vtkSmartPointer<vtkImageData> accumulation = vtkSmartPointer<vtkImageData>::New();
+      double singleThreadTimeSec = 0;
+      double multiThreadTimeSec = 0;
+      double batchTimeSec = 0;
+      if (ReconstructVolume(configRootElement, trackedFrameList, transformRepository, compoundingMode, interpolationMode,
+                            INSERT_FRAMES_SINGLE_THREAD, referenceGrayLevels, referenceAccumulation, singleThreadTimeSec) != PLUS_SUCCESS
+          || ReconstructVolume(configRootElement, trackedFrameList, transformRepository, compoundingMode, interpolationMode,
+                               INSERT_FRAMES_MULTI_THREAD, grayLevels, accumulation, multiThreadTimeSec) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to reconstruct volume with " << modeName);
+        ++numberOfFailures;
+        continue;
+      }
+      // the frame-by-frame multi-threaded result may be slightly different, because the pixels are not pasted in the same order
+      LOG_INFO(modeName << ": " << GetNumberOfDifferentVoxels(referenceGrayLevels, grayLevels)
+               << " voxels are different when frames are added one by one using multiple threads");
+
+      if (ReconstructVolume(configRootElement, trackedFrameList, transformRepository, compoundingMode, interpolationMode,
+                            INSERT_FRAME_BATCHES_MULTI_THREAD, grayLevels, accumulation, batchTimeSec) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to reconstruct volume in batches with " << modeName);
+        ++numberOfFailures;
+        continue;
+      }
+      int numberOfDifferentGrayLevels = GetNumberOfDifferentVoxels(referenceGrayLevels, grayLevels);
+      int numberOfDifferentAccumulations = GetNumberOfDifferentVoxels(referenceAccumulation, accumulation);
+      if (numberOfDifferentGrayLevels != 0 || numberOfDifferentAccumulations != 0)
+      {
+        LOG_ERROR(modeName << ": volume reconstructed in batches is different from the reference ("
+                  << numberOfDifferentGrayLevels << " gray level and " << numberOfDifferentAccumulations << " accumulation voxels)");
+        ++numberOfFailures;
+      }
+
+      LOG_INFO(modeName << ": one frame at a time with one thread: " << singleThreadTimeSec << " sec, with multiple threads: " << multiThreadTimeSec
+               << " sec; batches with multiple threads: " << batchTimeSec << " sec (speedup: "
+               << (batchTimeSec > 0 ? multiThreadTimeSec / batchTimeSec : 0) << "x)");
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,317 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusVolumeReconstructorSparseTest.cxx
+  \brief Compare reconstruction into a sparse (bricked) volume with reconstruction into a dense volume
+
+  Reconstructs the volume from the input sequence with dense and with sparse output, using all compounding modes
+  that support concurrent pasting of frames and both interpolation modes, and then once more with hole filling.
+  Hole filling is also tested when the volume is updated after half of the frames are added, so that the second
+  update only fills holes around the modified bricks.
+  The test fails if the volumes or accumulation buffers are not exactly the same.
+  The memory used for storing the volume during reconstruction and the reconstruction times are reported.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkImageData.h"
+#include "vtkPlusAccurateTimer.h"
+#include "vtkPlusSequenceIO.h"
+#include "vtkPlusTrackedFrameList.h"
+#include "vtkPlusTransformRepository.h"
+#include "vtkPlusVolumeReconstructor.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  PlusStatus ReconstructVolume(vtkXMLDataElement* configRootElement, vtkPlusTrackedFrameList* trackedFrameList, vtkPlusTransformRepository* transformRepository,
+                               vtkPlusPasteSliceIntoVolume::CompoundingType compoundingMode, vtkPlusPasteSliceIntoVolume::InterpolationType interpolationMode,
+                               bool sparseOutput, bool intermediateUpdate, vtkImageData* grayLevels, vtkImageData* accumulation, unsigned long& memorySizeKiB, double& reconstructionTimeSec)
+  {
+    vtkSmartPointer<vtkPlusVolumeReconstructor> reconstructor = vtkSmartPointer<vtkPlusVolumeReconstructor>::New();
+    if (reconstructor->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read volume reconstruction configuration");
+      return PLUS_FAIL;
+    }
+    reconstructor->SetCompoundingMode(compoundingMode);
+    reconstructor->SetInterpolation(interpolationMode);
+    reconstructor->SetOptimization(interpolationMode == vtkPlusPasteSliceIntoVolume::NEAREST_NEIGHBOR_INTERPOLATION ?
+                                   vtkPlusPasteSliceIntoVolume::FULL_OPTIMIZATION : vtkPlusPasteSliceIntoVolume::PARTIAL_OPTIMIZATION);
+    reconstructor->SetSparseOutput(sparseOutput);
+
+    std::string errorDescription;
+    if (reconstructor->SetOutputExtentFromFrameList(trackedFrameList, transformRepository, errorDescription) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set output extent of volume: " << errorDescription);
+      return PLUS_FAIL;
+    }
+
+    double startTime = vtkPlusAccurateTimer::GetSystemTime();
+    if (intermediateUpdate)
+    {
+      // add the frames one by one and update the volume when half of the frames are added
+      const int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
+      for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += reconstructor->GetSkipInterval())
+      {
+        PlusTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+        if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS
+            || reconstructor->AddTrackedFrame(frame, transformRepository) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to add tracked frame " << frameIndex << " to the volume");
+          return PLUS_FAIL;
+        }
+        if (frameIndex < numberOfFrames / 2 && frameIndex + reconstructor->GetSkipInterval() >= numberOfFrames / 2
+            && reconstructor->UpdateReconstructedVolume() != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to update the reconstructed volume");
+          return PLUS_FAIL;
+        }
+      }
+    }
+    else if (reconstructor->AddTrackedFrames(trackedFrameList, transformRepository) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add tracked frames to the volume");
+      return PLUS_FAIL;
+    }
+    reconstructionTimeSec = vtkPlusAccurateTimer::GetSystemTime() - startTime;
+    // the volume storage only grows while frames are added, so this is the peak memory need of the reconstruction
+    memorySizeKiB = reconstructor->GetReconstructionMemorySize();
+
+    if (reconstructor->ExtractGrayLevels(grayLevels) != PLUS_SUCCESS
+        || reconstructor->ExtractAccumulation(accumulation) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get the reconstructed volume");
+      return PLUS_FAIL;
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Returns the number of voxels that are different in the two volumes (-1 if the volumes cannot be compared) */
+  int GetNumberOfDifferentVoxels(vtkImageData* volume1, vtkImageData* volume2)
+  {
+    if (volume1->GetNumberOfPoints() != volume2->GetNumberOfPoints()
+        || volume1->GetScalarType() != volume2->GetScalarType()
+        || volume1->GetNumberOfScalarComponents() != volume2->GetNumberOfScalarComponents())
+    {
+      return -1;
+    }
+    const int voxelSize = volume1->GetScalarSize() * volume1->GetNumberOfScalarComponents();
+    const char* voxel1 = static_cast<const char*>(volume1->GetScalarPointer());
+    const char* voxel2 = static_cast<const char*>(volume2->GetScalarPointer());
+    int numberOfDifferentVoxels = 0;
+    for (vtkIdType i = 0; i < volume1->GetNumberOfPoints(); ++i, voxel1 += voxelSize, voxel2 += voxelSize)
+    {
+      if (memcmp(voxel1, voxel2, voxelSize) != 0)
+      {
+        ++numberOfDifferentVoxels;
+      }
+    }
+    return numberOfDifferentVoxels;
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Reconstruct the volume with dense and with sparse output and compare the results. If testIntermediateUpdate is set then
+    the volume is reconstructed with an update after half of the frames as well, and compared to the dense volume.
+    Returns the number of errors.
+  */
+  int CompareDenseAndSparseReconstruction(vtkXMLDataElement* configRootElement, vtkPlusTrackedFrameList* trackedFrameList, vtkPlusTransformRepository* transformRepository,
+                                          vtkPlusPasteSliceIntoVolume::CompoundingType compoundingMode, vtkPlusPasteSliceIntoVolume::InterpolationType interpolationMode,
+                                          const std::string& modeName, bool testIntermediateUpdate)
+  {
+    vtkSmartPointer<vtkImageData> denseGrayLevels = vtkSmartPointer<vtkImageData>::New();
+    vtkSmartPointer<vtkImageData> denseAccumulation = vtkSmartPointer<vtkImageData>::New();
+    vtkSmartPointer<vtkImageData> sparseGrayLevels = vtkSmartPointer<vtkImageData>::New();
+    vtkSmartPointer<vtkImageData> sparseAccumulation = vtkSmartPointer<vtkImageData>::New();
+    unsigned long denseMemorySizeKiB = 0;
+    unsigned long sparseMemorySizeKiB = 0;
+    double denseTimeSec = 0;
+    double sparseTimeSec = 0;
+    if (ReconstructVolume(configRootElement, trackedFrameList, transformRepository, compoundingMode, interpolationMode,
+                          false, false, denseGrayLevels, denseAccumulation, denseMemorySizeKiB, denseTimeSec) != PLUS_SUCCESS
+        || ReconstructVolume(configRootElement, trackedFrameList, transformRepository, compoundingMode, interpolationMode,
+                             true, false, sparseGrayLevels, sparseAccumulation, sparseMemorySizeKiB, sparseTimeSec) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to reconstruct volume with " << modeName);
+      return 1;
+    }
+
+    int numberOfErrors = 0;
+    int numberOfDifferentGrayLevels = GetNumberOfDifferentVoxels(denseGrayLevels, sparseGrayLevels);
+    int numberOfDifferentAccumulations = GetNumberOfDifferentVoxels(denseAccumulation, sparseAccumulation);
+    if (numberOfDifferentGrayLevels != 0 || numberOfDifferentAccumulations != 0)
+    {
+      LOG_ERROR(modeName << ": sparse volume is different from the dense volume ("
+                << numberOfDifferentGrayLevels << " gray level and " << numberOfDifferentAccumulations << " accumulation voxels)");
+      ++numberOfErrors;
+    }
+
+    LOG_INFO(modeName << ": volume memory dense: " << denseMemorySizeKiB / 1024.0 << " MiB, sparse: " << sparseMemorySizeKiB / 1024.0
+             << " MiB (" << (denseMemorySizeKiB > 0 ? 100.0 * sparseMemorySizeKiB / denseMemorySizeKiB : 0) << "%); reconstruction time dense: "
+             << denseTimeSec << " sec, sparse: " << sparseTimeSec << " sec");
+
+    if (!testIntermediateUpdate)
+    {
+      return numberOfErrors;
+    }
+
+    // the second hole filling only processes the surroundings of the bricks that are modified after the first one
+    for (int sparseOutput = 0; sparseOutput < 2; ++sparseOutput)
+    {
+      vtkSmartPointer<vtkImageData> incrementalGrayLevels = vtkSmartPointer<vtkImageData>::New();
+      vtkSmartPointer<vtkImageData> incrementalAccumulation = vtkSmartPointer<vtkImageData>::New();
+      unsigned long incrementalMemorySizeKiB = 0;
+      double incrementalTimeSec = 0;
+      if (ReconstructVolume(configRootElement, trackedFrameList, transformRepository, compoundingMode, interpolationMode,
+                            sparseOutput != 0, true, incrementalGrayLevels, incrementalAccumulation, incrementalMemorySizeKiB, incrementalTimeSec) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to reconstruct volume with " << modeName << " and intermediate update");
+        ++numberOfErrors;
+        continue;
+      }
+      int numberOfDifferentIncrementalGrayLevels = GetNumberOfDifferentVoxels(denseGrayLevels, incrementalGrayLevels);
+      if (numberOfDifferentIncrementalGrayLevels != 0)
+      {
+        LOG_ERROR(modeName << ": incrementally hole filled " << (sparseOutput ? "sparse" : "dense") << " volume is different from the hole filled dense volume ("
+                  << numberOfDifferentIncrementalGrayLevels << " gray level voxels)");
+        ++numberOfErrors;
+      }
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  bool printHelp(false);
+  std::string inputConfigFileName;
+  std::string inputImgSeqFileName;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Input configuration file name (.xml)");
+  cmdargs.AddArgument("--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputImgSeqFileName, "Input sequence file filename (.mha/.nrrd)");
+  cmdargs.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputConfigFileName.empty() || inputImgSeqFileName.empty())
+  {
+    std::cerr << "Input config file and sequence file names are required" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, inputConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << inputConfigFileName);
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkPlusTransformRepository> transformRepository = vtkSmartPointer<vtkPlusTransformRepository>::New();
+  if (configRootElement->FindNestedElementWithName("CoordinateDefinitions") != NULL
+      && transformRepository->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read transforms from CoordinateDefinitions");
+    exit(EXIT_FAILURE);
+  }
+
+  vtkSmartPointer<vtkPlusTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(inputImgSeqFileName, trackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to load input sequence file " << inputImgSeqFileName);
+    exit(EXIT_FAILURE);
+  }
+
+  vtkXMLDataElement* reconConfig = configRootElement->FindNestedElementWithName("VolumeReconstruction");
+  if (reconConfig == NULL)
+  {
+    LOG_ERROR("VolumeReconstruction element is not found in " << inputConfigFileName);
+    exit(EXIT_FAILURE);
+  }
+  reconConfig->SetAttribute("FillHoles", "OFF");
+
+  const vtkPlusPasteSliceIntoVolume::CompoundingType compoundingModes[3] =
+  {
+    vtkPlusPasteSliceIntoVolume::LATEST_COMPOUNDING_MODE,
+    vtkPlusPasteSliceIntoVolume::MAXIMUM_COMPOUNDING_MODE,
+    vtkPlusPasteSliceIntoVolume::MEAN_COMPOUNDING_MODE
+  };
+  const vtkPlusPasteSliceIntoVolume::InterpolationType interpolationModes[2] =
+  {
+    vtkPlusPasteSliceIntoVolume::NEAREST_NEIGHBOR_INTERPOLATION,
+    vtkPlusPasteSliceIntoVolume::LINEAR_INTERPOLATION
+  };
+
+  vtkSmartPointer<vtkPlusPasteSliceIntoVolume> modeNames = vtkSmartPointer<vtkPlusPasteSliceIntoVolume>::New();
+  int numberOfFailures = 0;
+  for (int compoundingIndex = 0; compoundingIndex < 3; ++compoundingIndex)
+  {
+    for (int interpolationIndex = 0; interpolationIndex < 2; ++interpolationIndex)
+    {
+      std::string modeName = std::string(modeNames->GetCompoundingModeAsString(compoundingModes[compoundingIndex])) + " compounding, "
+                             + modeNames->GetInterpolationModeAsString(interpolationModes[interpolationIndex]) + " interpolation";
+      numberOfFailures += CompareDenseAndSparseReconstruction(configRootElement, trackedFrameList, transformRepository,
+                          compoundingModes[compoundingIndex], interpolationModes[interpolationIndex], modeName, false);
+    }
+  }
+
+  // hole filling reads voxels of neighboring bricks as well
+  reconConfig->SetAttribute("FillHoles", "ON");
+  vtkXMLDataElement* holeFillingConfig = reconConfig->FindNestedElementWithName("HoleFilling");
+  if (holeFillingConfig == NULL)
+  {
+    vtkSmartPointer<vtkXMLDataElement> newHoleFillingConfig = vtkSmartPointer<vtkXMLDataElement>::New();
+    newHoleFillingConfig->SetName("HoleFilling");
+    vtkSmartPointer<vtkXMLDataElement> gaussianElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    gaussianElement->SetName("HoleFillingElement");
+    gaussianElement->SetAttribute("Type", "GAUSSIAN");
+    gaussianElement->SetAttribute("Stdev", "0.6667");
+    gaussianElement->SetAttribute("Size", "5");
+    gaussianElement->SetAttribute("MinimumKnownVoxelsRatio", "0.50001");
+    newHoleFillingConfig->AddNestedElement(gaussianElement);
+    vtkSmartPointer<vtkXMLDataElement> stickElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    stickElement->SetName("HoleFillingElement");
+    stickElement->SetAttribute("Type", "STICK");
+    stickElement->SetAttribute("StickLengthLimit", "9");
+    stickElement->SetAttribute("NumberOfSticksToUse", "1");
+    newHoleFillingConfig->AddNestedElement(stickElement);
+    reconConfig->AddNestedElement(newHoleFillingConfig);
+  }
+  numberOfFailures += CompareDenseAndSparseReconstruction(configRootElement, trackedFrameList, transformRepository,
+                      vtkPlusPasteSliceIntoVolume::MEAN_COMPOUNDING_MODE, vtkPlusPasteSliceIntoVolume::LINEAR_INTERPOLATION,
+                      "MEAN compounding, LINEAR interpolation, hole filling", true);
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
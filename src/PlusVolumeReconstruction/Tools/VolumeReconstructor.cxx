@@ -9,6 +9,7 @@
 #include "vtkImageData.h"
 #include "vtkMatrix4x4.h"
 #include "vtkPlusSequenceIO.h"
+#include "vtkPlusSequenceIOBase.h"
 #include "vtkPlusTrackedFrameList.h"
 #include "vtkPlusTransformRepository.h"
 #include "vtkPlusVolumeReconstructor.h"
@@ -36,6 +37,7 @@ int main(int argc, char* argv[])
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   bool disableCompression = false;
+  bool memoryMapInput = false;
 
   vtksys::CommandLineArguments cmdargs;
   cmdargs.Initialize(argc, argv);
@@ -48,6 +50,7 @@ int main(int argc, char* argv[])
   cmdargs.AddArgument("--output-frame-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFrameFileName, "A filename that will be used for storing the tracked image frames. Each frame will be exported individually, with the proper position and orientation in the reference coordinate system");
   cmdargs.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
   cmdargs.AddArgument("--disable-compression", vtksys::CommandLineArguments::NO_ARGUMENT, &disableCompression, "Do not compress output image files.");
+  cmdargs.AddArgument("--memory-map-input", vtksys::CommandLineArguments::NO_ARGUMENT, &memoryMapInput, "Memory map the pixel data of an uncompressed input sequence file instead of reading it into memory. Pixels are loaded from the file when they are accessed.");
   cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
   cmdargs.AddArgument("--importance-mask-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &importanceMaskFileName, "The file to use as the importance mask.");
 
@@ -150,6 +153,7 @@ int main(int argc, char* argv[])
   // Read image sequence
   LOG_INFO("Reading image sequence " << inputImgSeqFileName);
   vtkSmartPointer<vtkPlusTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkPlusTrackedFrameList>::New();
+  vtkPlusSequenceIOBase::SetDefaultUseMemoryMapping(memoryMapInput);
   if (vtkPlusSequenceIO::Read(inputImgSeqFileName, trackedFrameList) != PLUS_SUCCESS)
   {
     LOG_ERROR("Unable to load input sequences file.");
@@ -182,35 +186,28 @@ int main(int argc, char* argv[])
   const int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
   int numberOfFramesAddedToVolume = 0;
 
-  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += reconstructor->GetSkipInterval())
+  // Frames are pasted into the volume in batches, which is much faster than adding them one by one
+  if (reconstructor->AddTrackedFrames(trackedFrameList, transformRepository, &numberOfFramesAddedToVolume) != PLUS_SUCCESS)
   {
-    LOG_DEBUG("Frame: " << frameIndex);
-    vtkPlusLogger::PrintProgressbar((100.0 * frameIndex) / numberOfFrames);
-
-    PlusTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+    LOG_ERROR("Failed to add some of the tracked frames to the volume");
+  }
 
-    if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+  // Write an ITK image with the image pose in the reference coordinate system
+  if (!outputFrameFileName.empty())
+  {
+    for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += reconstructor->GetSkipInterval())
     {
-      LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
-      continue;
-    }
+      LOG_DEBUG("Frame: " << frameIndex);
+      vtkPlusLogger::PrintProgressbar((100.0 * frameIndex) / numberOfFrames);
 
-    // Insert slice for reconstruction
-    bool insertedIntoVolume = false;
-    if (reconstructor->AddTrackedFrame(frame, transformRepository, &insertedIntoVolume) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
-      continue;
-    }
+      PlusTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
 
-    if (insertedIntoVolume)
-    {
-      numberOfFramesAddedToVolume++;
-    }
+      if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
+        continue;
+      }
 
-    // Write an ITK image with the image pose in the reference coordinate system
-    if (!outputFrameFileName.empty())
-    {
       vtkSmartPointer<vtkMatrix4x4> imageToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
       if (transformRepository->GetTransform(imageToReferenceTransformName, imageToReferenceTransformMatrix) != PLUS_SUCCESS)
       {
@@ -237,10 +234,9 @@ int main(int argc, char* argv[])
 
       frame->WriteToFile(ss.str(), imageToReferenceTransformMatrix);
     }
+    vtkPlusLogger::PrintProgressbar(100);
   }
 
-  vtkPlusLogger::PrintProgressbar(100);
-
   trackedFrameList->Clear();
 
   LOG_INFO("Number of frames added to the volume: " << numberOfFramesAddedToVolume << " out of " << numberOfFrames);
@@ -44,6 +44,9 @@ POSSIBILITY OF SUCH DAMAGES.
 #include "PlusMath.h"
 
 #include "vtkPlusFillHolesInVolume.h"
+#include "vtkPlusSparseVolume.h"
+#include "vtkPlusThreadPool.h"
+#include "vtkPlusFillHolesInVolumeHelperAVX2.h"
 
 #include "vtkDataArray.h"
 #include "vtkImageData.h"
@@ -54,12 +57,19 @@ POSSIBILITY OF SUCH DAMAGES.
 #include "vtkPointData.h"
 #include "vtkImageExtractComponents.h"
 #include "vtkMetaImageWriter.h"
+#include "vtkSmartPointer.h"
 
+#include <algorithm>
 #include <math.h>
+#include <string.h>
+#include <vector>
 
 static const int INPUT_PORT_RECONSTRUCTED_VOLUME=0;
 static const int INPUT_PORT_ACCUMULATION_BUFFER=1;
 
+// Number of stick directions (see FillHolesInVolumeElement::allocateSticks)
+static const int MAX_NUMBER_OF_STICKS=13;
+
 ///////////
 
 vtkStandardNewMacro(vtkPlusFillHolesInVolume);
@@ -71,6 +81,21 @@ struct FillHoleThreadFunctionInfoStruct
   int Compounding;
 };
 
+struct FillHolesInBricksThreadFunctionInfoStruct
+{
+  vtkPlusFillHolesInVolume* HoleFiller;
+  // Defines the bricks, also contains the input voxels if the input is sparse
+  vtkPlusSparseVolume* BrickGrid;
+  // Dense input, NULL if the input is sparse
+  vtkImageData* ReconstructedVolume;
+  vtkImageData* AccumulationBuffer;
+  vtkImageData* HoleFilledVolume;
+  int ElementReach;
+  std::vector<int> BrickIndices;
+  // Number of bricks that could not be processed, per worker
+  std::vector<int> NumberOfErrors;
+};
+
 //----------------------------------------------------------------------------
 void FillHolesInVolumeElement::setupAsDistanceWeightInverse(int size, float minRatio)
 {
@@ -507,6 +532,70 @@ void FillHolesInVolumeElement::allocateSticks() {
 
 }
 
+//----------------------------------------------------------------------------
+// Compute the value and weight of a stick that reached a known voxel in both directions: the value is interpolated
+// linearly between the two known voxels, the weight is the inverse of the length of the stick
+template <class T>
+static void EvaluateStick(const int* stickDirection, int fwdTrav, int rvsTrav, T fwdVal, T rvsVal, double& weight, T& value)
+{
+  double totalDistance = (fwdTrav + rvsTrav + 1);
+  double weightFwd = (rvsTrav+1)/totalDistance;
+  double weightRvs = 1.0 - weightFwd;
+  double realDistance = totalDistance * sqrt((double)(stickDirection[0]*stickDirection[0]+
+                                                      stickDirection[1]*stickDirection[1]+
+                                                      stickDirection[2]*stickDirection[2]));
+  weight = 1.0/realDistance;
+  value = weightRvs*rvsVal + weightFwd*fwdVal;
+}
+
+//----------------------------------------------------------------------------
+// Average the values of the sticks with the highest weights (bad sticks have 0 weight). The weights are modified.
+// Returns false if all sticks were bad.
+template <class T>
+static bool CombineSticks(int numSticksInList, int numSticksToUse, double* weights, const T* values, T& returnVal)
+{
+  // determine the highest score, and assign the corresponding value to the pixel
+  int numSticksUsed(0);
+  double sumWeightedValues(0.0);
+  double sumWeights(0.0);
+
+  // iterate through sticks to find the maximum score, use that stick in the calculation, then set the score for it to 0, and repeat
+  while (numSticksUsed < numSticksToUse) {
+
+    // determine highest score among remaining sticks
+    double maxWeight(0.0);
+    for (int i = 0; i < numSticksInList; i++) {
+      if (weights[i] > maxWeight) {
+        maxWeight = weights[i];
+      }
+    }
+
+    if (maxWeight == 0) { // indicates all sticks were bad
+      break;
+    }
+
+    // for all sticks with this weight, use them in the result
+    for (int i = 0; i < numSticksInList; i++) {
+      if (weights[i] == maxWeight) {
+        sumWeightedValues += (values[i] * weights[i]);
+        sumWeights += weights[i];
+        numSticksUsed++;
+        weights[i] = 0.0;
+      }
+    }
+
+  }
+
+  if (sumWeights != 0) {
+    returnVal = (T)(sumWeightedValues/sumWeights);
+    return true; // at least one stick was good, = success
+  }
+
+  // else sumWeights = 0 means all sticks were bad
+  returnVal = (T)0;
+  return false;
+}
+
 //----------------------------------------------------------------------------
 template <class T>
 bool FillHolesInVolumeElement::applySticks(
@@ -527,8 +616,8 @@ bool FillHolesInVolumeElement::applySticks(
   int fwdTrav, rvsTrav; // store the number of voxels that have been searched
   T fwdVal, rvsVal; // store the values at each end of the stick
 
-  T* values = new T[numSticksInList];
-  double* weights = new double[numSticksInList];
+  T values[MAX_NUMBER_OF_STICKS];
+  double weights[MAX_NUMBER_OF_STICKS];
 
   // try each stick direction
   for (int i = 0; i < numSticksInList; i++) {
@@ -594,60 +683,10 @@ bool FillHolesInVolumeElement::applySticks(
     }
 
     // evaluate score and direction
-    double totalDistance = (fwdTrav + rvsTrav + 1);
-    double weightFwd = (rvsTrav+1)/totalDistance;
-    double weightRvs = 1.0 - weightFwd;
-    double realDistance = totalDistance * sqrt((double)(sticksList[baseStickIndex  ]*sticksList[baseStickIndex  ]+
-                                                        sticksList[baseStickIndex+1]*sticksList[baseStickIndex+1]+
-                                                        sticksList[baseStickIndex+2]*sticksList[baseStickIndex+2]));
-    weights[i] = 1.0/realDistance;
-    values[i] = weightRvs*rvsVal + weightFwd*fwdVal;
-  }
-
-  // determine the highest score, and assign the corresponding value to the pixel
-  int numSticksUsed(0);
-  double sumWeightedValues(0.0);
-  double sumWeights(0.0);
-
-  // iterate through sticks to find the maximum score, use that stick in the calculation, then set the score for it to 0, and repeat
-  while (numSticksUsed < numSticksToUse) {
-
-    // determine highest score among remaining sticks
-    double maxWeight(0.0);
-    for (int i = 0; i < numSticksInList; i++) {
-      if (weights[i] > maxWeight) {
-        maxWeight = weights[i];
-      }
-    }
-
-    if (maxWeight == 0) { // indicates all sticks were bad
-      break;
-    }
-
-    // for all sticks with this weight, use them in the result
-    for (int i = 0; i < numSticksInList; i++) {
-      if (weights[i] == maxWeight) {
-        sumWeightedValues += (values[i] * weights[i]);
-        sumWeights += weights[i];
-        numSticksUsed++;
-        weights[i] = 0.0;
-      }
-    }
-
-  }
-
-  delete[] weights;
-  delete[] values;
-
-  if (sumWeights != 0) {
-    returnVal = (T)(sumWeightedValues/sumWeights);
-    return true; // at least one stick was good, = success
+    EvaluateStick(sticksList + baseStickIndex, fwdTrav, rvsTrav, fwdVal, rvsVal, weights[i], values[i]);
   }
 
-  // else sumWeights = 0 means all sticks were bad
-  returnVal = (T)0;
-  return false;
-
+  return CombineSticks(numSticksInList, numSticksToUse, weights, values, returnVal);
 }
 
 //----------------------------------------------------------------------------
@@ -682,6 +721,566 @@ bool FillHolesInVolumeElement::applySticks(
 
 }*/
 
+//----------------------------------------------------------------------------
+// Try to fill a hole voxel using one hole filling element
+template <class T>
+static bool ApplyHoleFillingElement(FillHolesInVolumeElement& element, T* inVolPtr, unsigned short* accPtr, vtkIdType* volInc, vtkIdType* accInc,
+                                    int component, int* bounds, int* wholeExtent, int* thisPixel, T& returnVal)
+{
+  switch (element.type) {
+  case FillHolesInVolumeElement::HFTYPE_GAUSSIAN:
+    return element.applyGaussian(inVolPtr,accPtr,volInc,accInc,component,bounds,wholeExtent,thisPixel,returnVal);
+  case FillHolesInVolumeElement::HFTYPE_GAUSSIAN_ACCUMULATION:
+    return element.applyGaussianAccumulation(inVolPtr,accPtr,volInc,accInc,component,bounds,wholeExtent,thisPixel,returnVal);
+  case FillHolesInVolumeElement::HFTYPE_STICK:
+    return element.applySticks(inVolPtr,accPtr,volInc,accInc,component,bounds,wholeExtent,thisPixel,returnVal);
+  case FillHolesInVolumeElement::HFTYPE_NEAREST_NEIGHBOR:
+    return element.applyNearestNeighbor(inVolPtr,accPtr,volInc,accInc,component,bounds,wholeExtent,thisPixel,returnVal);
+  case FillHolesInVolumeElement::HFTYPE_DISTANCE_WEIGHT_INVERSE:
+    return element.applyDistanceWeightInverse(inVolPtr,accPtr,volInc,accInc,component,bounds,wholeExtent,thisPixel,returnVal);
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+// Blockwise hole filling
+//
+// Instead of evaluating the neighborhood of each hole voxel independently, the elements are evaluated for a block
+// of voxels at once:
+// - gaussian elements: the weighted sums are computed by separable convolution, which needs O(size) operations
+//   per voxel instead of O(size^3)
+// - distance weight inverse elements: the kernel is not separable, the weighted sums are computed by adding
+//   shifted rows of the input, in the same order as the per-voxel evaluation
+// - stick elements: the distance of the nearest known voxel along a stick direction is computed for all voxels
+//   of the block by one sweep through the block
+// The rows are processed by vectorizable loops (or AVX2 instructions). If only a few voxels of the block are holes
+// then evaluating the holes one by one is faster, so the per-voxel evaluation is used instead.
+
+// Number of voxels along each side of a block
+static const int FILL_BLOCK_SIZE=32;
+// Minimum ratio of unfilled holes among the voxels of a block for using blockwise evaluation of an element
+// (estimated from the number of operations of the blockwise and per-voxel evaluation)
+static const double FILL_BLOCK_MIN_HOLE_RATIO_GAUSSIAN=1.0/16.0;
+static const double FILL_BLOCK_MIN_HOLE_RATIO_DISTANCE_WEIGHT_INVERSE=0.5;
+static const double FILL_BLOCK_MIN_HOLE_RATIO_STICK=0.5;
+
+// Voxel states and distances of the stick search
+static const unsigned char STICK_VOXEL_UNKNOWN=0;
+static const unsigned char STICK_VOXEL_KNOWN=1;
+static const unsigned char STICK_VOXEL_OUTSIDE=2;
+static const unsigned char STICK_DISTANCE_INFINITE=255;
+
+//----------------------------------------------------------------------------
+// Working memory of blockwise hole filling, reused for all blocks
+template <class T>
+struct FillHolesBlockBuffers
+{
+  // Indices of all hole voxels in the block and of the holes that the elements tried so far could not fill
+  std::vector<int> Holes;
+  std::vector<int> UnfilledHoles;
+  // Input of the element in the region (the block extended by the reach of the element)
+  std::vector<double> RegionKnown;
+  std::vector<double> RegionWeights;
+  std::vector<double> RegionWeightedValues;
+  std::vector<unsigned char> RegionStates;
+  // Intermediate results of separable convolution
+  std::vector<double> Pass1;
+  std::vector<double> Pass2;
+  // Sums for each voxel of the block
+  std::vector<double> NumberOfKnownVoxels;
+  std::vector<double> SumWeights;
+  std::vector<double> SumWeightedValues;
+  // Stick search results
+  std::vector<unsigned char> ForwardDistances;
+  std::vector<unsigned char> ReverseDistances;
+  std::vector<double> StickWeights;
+  std::vector<T> StickValues;
+};
+
+//----------------------------------------------------------------------------
+// sum[i] += weight * values[i]
+static inline void AddWeightedRow(double* sum, const double* values, double weight, int count, bool simdEnabled)
+{
+#ifdef PLUS_X86_SIMD
+  if (simdEnabled)
+  {
+    vtkFillHolesAddWeightedRowAVX2(sum, values, weight, count);
+    return;
+  }
+#endif
+  for (int i = 0; i < count; ++i)
+  {
+    sum[i] += weight * values[i];
+  }
+}
+
+//----------------------------------------------------------------------------
+// Get the global position of a voxel of the block from its index in the block
+static inline void GetBlockVoxelPosition(int blockVoxelIndex, const int blockExtent[6], int position[3])
+{
+  const int blockSizeX = blockExtent[1] - blockExtent[0] + 1;
+  const int blockSizeY = blockExtent[3] - blockExtent[2] + 1;
+  position[0] = blockExtent[0] + blockVoxelIndex % blockSizeX;
+  position[1] = blockExtent[2] + (blockVoxelIndex / blockSizeX) % blockSizeY;
+  position[2] = blockExtent[4] + blockVoxelIndex / (blockSizeX * blockSizeY);
+}
+
+//----------------------------------------------------------------------------
+// Copy the input voxels of the region into the region buffers. Voxels outside the whole extent are unknown.
+// The weight of a known voxel is its accumulation buffer value if accumulationWeighted is true, otherwise 1.
+// Returns the number of known voxels in the region.
+template <class T>
+static int ExtractBlockRegion(T* inVolPtr, unsigned short* accPtr, vtkIdType* volInc, vtkIdType* accInc, int component,
+                              int* wholeExtent, const int regionExtent[6], bool accumulationWeighted, FillHolesBlockBuffers<T>& buffers)
+{
+  const int regionSize[3] = {regionExtent[1]-regionExtent[0]+1, regionExtent[3]-regionExtent[2]+1, regionExtent[5]-regionExtent[4]+1};
+  const size_t numberOfRegionVoxels = size_t(regionSize[0]) * regionSize[1] * regionSize[2];
+  buffers.RegionKnown.assign(numberOfRegionVoxels, 0.0);
+  buffers.RegionWeights.assign(numberOfRegionVoxels, 0.0);
+  buffers.RegionWeightedValues.assign(numberOfRegionVoxels, 0.0);
+
+  int clippedExtent[6];
+  for (int i = 0; i < 3; i++)
+  {
+    clippedExtent[2*i] = std::max(regionExtent[2*i], wholeExtent[2*i]);
+    clippedExtent[2*i+1] = std::min(regionExtent[2*i+1], wholeExtent[2*i+1]);
+  }
+  int numberOfKnownVoxels = 0;
+  for (int z = clippedExtent[4]; z <= clippedExtent[5]; z++)
+  {
+    for (int y = clippedExtent[2]; y <= clippedExtent[3]; y++)
+    {
+      size_t regionIndex = (size_t(z - regionExtent[4]) * regionSize[1] + (y - regionExtent[2])) * regionSize[0] + (clippedExtent[0] - regionExtent[0]);
+      for (int x = clippedExtent[0]; x <= clippedExtent[1]; x++, regionIndex++)
+      {
+        unsigned short accumulation = accPtr[accInc[0]*x + accInc[1]*y + accInc[2]*z];
+        if (accumulation == 0)
+        {
+          continue;
+        }
+        double weight = (accumulationWeighted ? accumulation : 1.0);
+        buffers.RegionKnown[regionIndex] = 1.0;
+        buffers.RegionWeights[regionIndex] = weight;
+        buffers.RegionWeightedValues[regionIndex] = weight * inVolPtr[volInc[0]*x + volInc[1]*y + volInc[2]*z + component];
+        numberOfKnownVoxels++;
+      }
+    }
+  }
+  return numberOfKnownVoxels;
+}
+
+//----------------------------------------------------------------------------
+// Convolve the region with the one-dimensional kernel (2*reach+1 weights) along all three axes. The result is computed
+// for the voxels of the block, which is in the center of the region (the region is larger by reach voxels on each side).
+static void ConvolveSeparable(const double* region, const int blockSize[3], int reach, const std::vector<double>& kernel,
+                              bool simdEnabled, std::vector<double>& pass1, std::vector<double>& pass2, std::vector<double>& result)
+{
+  const int regionSize[3] = {blockSize[0] + 2*reach, blockSize[1] + 2*reach, blockSize[2] + 2*reach};
+  const int kernelSize = 2*reach + 1;
+
+  // along x: the result has the size of the block along x and the size of the region along y and z
+  pass1.assign(size_t(blockSize[0]) * regionSize[1] * regionSize[2], 0.0);
+  for (int z = 0; z < regionSize[2]; z++)
+  {
+    for (int y = 0; y < regionSize[1]; y++)
+    {
+      double* row = &pass1[(size_t(z) * regionSize[1] + y) * blockSize[0]];
+      const double* regionRow = region + (size_t(z) * regionSize[1] + y) * regionSize[0];
+      for (int k = 0; k < kernelSize; k++)
+      {
+        AddWeightedRow(row, regionRow + k, kernel[k], blockSize[0], simdEnabled);
+      }
+    }
+  }
+
+  // along y: the result has the size of the block along x and y and the size of the region along z
+  pass2.assign(size_t(blockSize[0]) * blockSize[1] * regionSize[2], 0.0);
+  for (int z = 0; z < regionSize[2]; z++)
+  {
+    for (int y = 0; y < blockSize[1]; y++)
+    {
+      double* row = &pass2[(size_t(z) * blockSize[1] + y) * blockSize[0]];
+      for (int k = 0; k < kernelSize; k++)
+      {
+        AddWeightedRow(row, &pass1[(size_t(z) * regionSize[1] + y + k) * blockSize[0]], kernel[k], blockSize[0], simdEnabled);
+      }
+    }
+  }
+
+  // along z: whole slices of the block are processed at once
+  const int sliceSize = blockSize[0] * blockSize[1];
+  result.assign(size_t(sliceSize) * blockSize[2], 0.0);
+  for (int z = 0; z < blockSize[2]; z++)
+  {
+    for (int k = 0; k < kernelSize; k++)
+    {
+      AddWeightedRow(&result[size_t(z) * sliceSize], &pass2[size_t(z + k) * sliceSize], kernel[k], sliceSize, simdEnabled);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Convolve the region with a three-dimensional kernel of kernelSize^3 weights. The kernel weights are processed in the
+// same order as in the per-voxel evaluation of the elements (x, y, z from the outermost loop), therefore the sums are the same.
+static void ConvolveDirect(const double* region, const int blockSize[3], int reach, const float* kernel, int kernelSize,
+                           bool simdEnabled, std::vector<double>& result)
+{
+  const int regionSize[3] = {blockSize[0] + 2*reach, blockSize[1] + 2*reach, blockSize[2] + 2*reach};
+  result.assign(size_t(blockSize[0]) * blockSize[1] * blockSize[2], 0.0);
+  for (int offsetX = 0; offsetX <= 2*reach; offsetX++)
+  {
+    for (int offsetY = 0; offsetY <= 2*reach; offsetY++)
+    {
+      for (int offsetZ = 0; offsetZ <= 2*reach; offsetZ++)
+      {
+        double weight = kernel[kernelSize*kernelSize*offsetZ + kernelSize*offsetY + offsetX];
+        for (int z = 0; z < blockSize[2]; z++)
+        {
+          for (int y = 0; y < blockSize[1]; y++)
+          {
+            AddWeightedRow(&result[(size_t(z) * blockSize[1] + y) * blockSize[0]],
+                           region + (size_t(z + offsetZ) * regionSize[1] + y + offsetY) * regionSize[0] + offsetX,
+                           weight, blockSize[0], simdEnabled);
+          }
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Fill the unfilled holes of the block using a gaussian or distance weight inverse element
+template <class T>
+static void FillHolesWithKernelInBlock(FillHolesInVolumeElement& element, bool simdEnabled, T* inVolPtr, unsigned short* accPtr,
+                                       vtkIdType* volInc, vtkIdType* accInc, int component, int* wholeExtent, const int blockExtent[6],
+                                       T* outPtr, FillHolesBlockBuffers<T>& buffers)
+{
+  const int reach = (element.size-1)/2;
+  const int blockSize[3] = {blockExtent[1]-blockExtent[0]+1, blockExtent[3]-blockExtent[2]+1, blockExtent[5]-blockExtent[4]+1};
+  int regionExtent[6];
+  for (int i = 0; i < 3; i++)
+  {
+    regionExtent[2*i] = blockExtent[2*i] - reach;
+    regionExtent[2*i+1] = blockExtent[2*i+1] + reach;
+  }
+  bool accumulationWeighted = (element.type == FillHolesInVolumeElement::HFTYPE_GAUSSIAN_ACCUMULATION);
+  if (ExtractBlockRegion(inVolPtr, accPtr, volInc, accInc, component, wholeExtent, regionExtent, accumulationWeighted, buffers) == 0)
+  {
+    // there are no known voxels within reach, none of the holes can be filled
+    return;
+  }
+
+  std::vector<double> boxKernel(2*reach+1, 1.0);
+  ConvolveSeparable(&buffers.RegionKnown[0], blockSize, reach, boxKernel, simdEnabled, buffers.Pass1, buffers.Pass2, buffers.NumberOfKnownVoxels);
+  if (element.type == FillHolesInVolumeElement::HFTYPE_DISTANCE_WEIGHT_INVERSE)
+  {
+    ConvolveDirect(&buffers.RegionWeights[0], blockSize, reach, element.kernel, element.size, simdEnabled, buffers.SumWeights);
+    ConvolveDirect(&buffers.RegionWeightedValues[0], blockSize, reach, element.kernel, element.size, simdEnabled, buffers.SumWeightedValues);
+  }
+  else
+  {
+    // the gaussian kernel is the product of one-dimensional gaussian kernels (the normalization factor cancels out)
+    std::vector<double> gaussianKernel(2*reach+1, 0.0);
+    float range = (element.size-1)/2.;
+    float divisor = element.stdev*element.stdev*2.0;
+    for (int k = 0; k <= 2*reach; k++)
+    {
+      gaussianKernel[k] = exp(-pow((double)k-range,2)/divisor);
+    }
+    ConvolveSeparable(&buffers.RegionWeights[0], blockSize, reach, gaussianKernel, simdEnabled, buffers.Pass1, buffers.Pass2, buffers.SumWeights);
+    ConvolveSeparable(&buffers.RegionWeightedValues[0], blockSize, reach, gaussianKernel, simdEnabled, buffers.Pass1, buffers.Pass2, buffers.SumWeightedValues);
+  }
+
+  // fill the holes where the weighted average can be computed and enough voxels are known
+  size_t numberOfUnfilledHoles = 0;
+  for (std::vector<int>::iterator holeIt = buffers.UnfilledHoles.begin(); holeIt != buffers.UnfilledHoles.end(); ++holeIt)
+  {
+    const int hole = *holeIt;
+    if (buffers.SumWeights[hole] == 0 || buffers.NumberOfKnownVoxels[hole]/(element.size*element.size*element.size) <= element.minRatio)
+    {
+      buffers.UnfilledHoles[numberOfUnfilledHoles++] = hole;
+      continue;
+    }
+    int position[3];
+    GetBlockVoxelPosition(hole, blockExtent, position);
+    outPtr[volInc[0]*position[0] + volInc[1]*position[1] + volInc[2]*position[2] + component] = (T)(buffers.SumWeightedValues[hole]/buffers.SumWeights[hole]);
+  }
+  buffers.UnfilledHoles.resize(numberOfUnfilledHoles);
+}
+
+//----------------------------------------------------------------------------
+// For each voxel of the region compute the number of steps along the direction to the nearest known voxel.
+// The distance is STICK_DISTANCE_INFINITE if a voxel outside the volume or the region is reached first.
+static void ComputeStickDistances(const unsigned char* states, const int regionSize[3], const int direction[3], std::vector<unsigned char>& distances)
+{
+  distances.resize(size_t(regionSize[0]) * regionSize[1] * regionSize[2]);
+  const vtkIdType nextOffset = direction[0] + vtkIdType(direction[1]) * regionSize[0] + vtkIdType(direction[2]) * regionSize[0] * regionSize[1];
+  // visit the rows in an order where the next voxel along the direction is already visited
+  const int startZ = (direction[2] > 0 ? regionSize[2]-1 : 0);
+  const int startY = (direction[1] > 0 ? regionSize[1]-1 : 0);
+  const int stepZ = (direction[2] > 0 ? -1 : 1);
+  const int stepY = (direction[1] > 0 ? -1 : 1);
+  for (int zIndex = 0, z = startZ; zIndex < regionSize[2]; zIndex++, z += stepZ)
+  {
+    for (int yIndex = 0, y = startY; yIndex < regionSize[1]; yIndex++, y += stepY)
+    {
+      unsigned char* distanceRow = &distances[(size_t(z) * regionSize[1] + y) * regionSize[0]];
+      if (z + direction[2] < 0 || z + direction[2] >= regionSize[2] || y + direction[1] < 0 || y + direction[1] >= regionSize[1])
+      {
+        // the next voxel is outside the region for the whole row
+        memset(distanceRow, STICK_DISTANCE_INFINITE, regionSize[0]);
+        continue;
+      }
+      const unsigned char* nextStates = states + (size_t(z) * regionSize[1] + y) * regionSize[0] + nextOffset;
+      const unsigned char* nextDistances = distanceRow + nextOffset;
+      // the next voxel of the first or last voxel of the row may be outside the region
+      int xStart = 0;
+      int xEnd = regionSize[0];
+      if (direction[0] > 0)
+      {
+        distanceRow[--xEnd] = STICK_DISTANCE_INFINITE;
+      }
+      else if (direction[0] < 0)
+      {
+        distanceRow[xStart++] = STICK_DISTANCE_INFINITE;
+      }
+      // along x the voxels are visited in the opposite order of the direction
+      const int stepX = (direction[0] > 0 ? -1 : 1);
+      const int startX = (direction[0] > 0 ? xEnd-1 : xStart);
+      for (int xIndex = xStart, x = startX; xIndex < xEnd; xIndex++, x += stepX)
+      {
+        unsigned char nextState = nextStates[x];
+        if (nextState == STICK_VOXEL_KNOWN)
+        {
+          distanceRow[x] = 1;
+        }
+        else if (nextState == STICK_VOXEL_OUTSIDE || nextDistances[x] >= STICK_DISTANCE_INFINITE-1)
+        {
+          distanceRow[x] = STICK_DISTANCE_INFINITE;
+        }
+        else
+        {
+          distanceRow[x] = nextDistances[x]+1;
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Fill the unfilled holes of the block using a stick element. The result is the same as applySticks for each hole.
+template <class T>
+static void FillHolesWithSticksInBlock(FillHolesInVolumeElement& element, T* inVolPtr, unsigned short* accPtr,
+                                       vtkIdType* volInc, vtkIdType* accInc, int component, int* wholeExtent, const int blockExtent[6],
+                                       T* outPtr, FillHolesBlockBuffers<T>& buffers)
+{
+  // a stick reaches known voxels at most stickLengthLimit-1 steps away
+  const int reach = element.stickLengthLimit-1;
+  if (reach < 1)
+  {
+    return;
+  }
+  int regionExtent[6];
+  int regionSize[3];
+  for (int i = 0; i < 3; i++)
+  {
+    regionExtent[2*i] = blockExtent[2*i] - reach;
+    regionExtent[2*i+1] = blockExtent[2*i+1] + reach;
+    regionSize[i] = regionExtent[2*i+1] - regionExtent[2*i] + 1;
+  }
+  buffers.RegionStates.resize(size_t(regionSize[0]) * regionSize[1] * regionSize[2]);
+  size_t regionIndex = 0;
+  for (int z = regionExtent[4]; z <= regionExtent[5]; z++)
+  {
+    for (int y = regionExtent[2]; y <= regionExtent[3]; y++)
+    {
+      for (int x = regionExtent[0]; x <= regionExtent[1]; x++, regionIndex++)
+      {
+        if (x < wholeExtent[0] || x > wholeExtent[1] || y < wholeExtent[2] || y > wholeExtent[3] || z < wholeExtent[4] || z > wholeExtent[5])
+        {
+          buffers.RegionStates[regionIndex] = STICK_VOXEL_OUTSIDE;
+        }
+        else
+        {
+          buffers.RegionStates[regionIndex] = (accPtr[accInc[0]*x + accInc[1]*y + accInc[2]*z] != 0 ? STICK_VOXEL_KNOWN : STICK_VOXEL_UNKNOWN);
+        }
+      }
+    }
+  }
+
+  const size_t numberOfHoles = buffers.UnfilledHoles.size();
+  const int numberOfSticks = element.numSticksInList;
+  buffers.StickWeights.assign(numberOfHoles * numberOfSticks, 0.0);
+  buffers.StickValues.resize(numberOfHoles * numberOfSticks);
+  for (int stickIndex = 0; stickIndex < numberOfSticks; stickIndex++)
+  {
+    const int* stickDirection = element.sticksList + 3*stickIndex;
+    const int reverseDirection[3] = {-stickDirection[0], -stickDirection[1], -stickDirection[2]};
+    ComputeStickDistances(&buffers.RegionStates[0], regionSize, stickDirection, buffers.ForwardDistances);
+    ComputeStickDistances(&buffers.RegionStates[0], regionSize, reverseDirection, buffers.ReverseDistances);
+    for (size_t holeIndex = 0; holeIndex < numberOfHoles; holeIndex++)
+    {
+      int position[3];
+      GetBlockVoxelPosition(buffers.UnfilledHoles[holeIndex], blockExtent, position);
+      size_t holeRegionIndex = (size_t(position[2]-regionExtent[4]) * regionSize[1] + (position[1]-regionExtent[2])) * regionSize[0] + (position[0]-regionExtent[0]);
+      int fwdTrav = buffers.ForwardDistances[holeRegionIndex];
+      if (fwdTrav > reach)
+      {
+        continue; // bad stick
+      }
+      int rvsTrav = buffers.ReverseDistances[holeRegionIndex];
+      if (rvsTrav > reach - fwdTrav)
+      {
+        continue; // bad stick
+      }
+      T fwdVal = inVolPtr[volInc[0]*(position[0]+fwdTrav*stickDirection[0]) + volInc[1]*(position[1]+fwdTrav*stickDirection[1])
+                          + volInc[2]*(position[2]+fwdTrav*stickDirection[2]) + component];
+      T rvsVal = inVolPtr[volInc[0]*(position[0]-rvsTrav*stickDirection[0]) + volInc[1]*(position[1]-rvsTrav*stickDirection[1])
+                          + volInc[2]*(position[2]-rvsTrav*stickDirection[2]) + component];
+      EvaluateStick(stickDirection, fwdTrav, rvsTrav, fwdVal, rvsVal,
+                    buffers.StickWeights[holeIndex*numberOfSticks + stickIndex], buffers.StickValues[holeIndex*numberOfSticks + stickIndex]);
+    }
+  }
+
+  size_t numberOfUnfilledHoles = 0;
+  for (size_t holeIndex = 0; holeIndex < numberOfHoles; holeIndex++)
+  {
+    const int hole = buffers.UnfilledHoles[holeIndex];
+    T value(0);
+    if (!CombineSticks(numberOfSticks, element.numSticksToUse, &buffers.StickWeights[holeIndex*numberOfSticks], &buffers.StickValues[holeIndex*numberOfSticks], value))
+    {
+      buffers.UnfilledHoles[numberOfUnfilledHoles++] = hole;
+      continue;
+    }
+    int position[3];
+    GetBlockVoxelPosition(hole, blockExtent, position);
+    outPtr[volInc[0]*position[0] + volInc[1]*position[1] + volInc[2]*position[2] + component] = value;
+  }
+  buffers.UnfilledHoles.resize(numberOfUnfilledHoles);
+}
+
+//----------------------------------------------------------------------------
+// Fill the unfilled holes of the block one by one
+template <class T>
+static void FillHolesPerVoxelInBlock(FillHolesInVolumeElement& element, T* inVolPtr, unsigned short* accPtr,
+                                     vtkIdType* volInc, vtkIdType* accInc, int component, int* wholeExtent, const int blockExtent[6],
+                                     T* outPtr, FillHolesBlockBuffers<T>& buffers)
+{
+  int bounds[6] = {blockExtent[0], blockExtent[1], blockExtent[2], blockExtent[3], blockExtent[4], blockExtent[5]};
+  size_t numberOfUnfilledHoles = 0;
+  for (std::vector<int>::iterator holeIt = buffers.UnfilledHoles.begin(); holeIt != buffers.UnfilledHoles.end(); ++holeIt)
+  {
+    int position[3];
+    GetBlockVoxelPosition(*holeIt, blockExtent, position);
+    T& outVoxel = outPtr[volInc[0]*position[0] + volInc[1]*position[1] + volInc[2]*position[2] + component];
+    if (!ApplyHoleFillingElement(element, inVolPtr, accPtr, volInc, accInc, component, bounds, wholeExtent, position, outVoxel))
+    {
+      buffers.UnfilledHoles[numberOfUnfilledHoles++] = *holeIt;
+    }
+  }
+  buffers.UnfilledHoles.resize(numberOfUnfilledHoles);
+}
+
+//----------------------------------------------------------------------------
+// Fill the holes in a block of the output. The elements are tried in order for each hole, the same way as in the
+// per-voxel evaluation. Holes that none of the elements can fill are set to 0.
+template <class T>
+static void FillHolesInBlock(FillHolesInVolumeElement* elements, int numberOfElements, bool simdEnabled,
+                             T* inVolPtr, unsigned short* accPtr, T* outPtr, vtkIdType* volInc, vtkIdType* accInc,
+                             int numberOfComponents, int* wholeExtent, const int blockExtent[6], FillHolesBlockBuffers<T>& buffers)
+{
+  // copy the known voxels and collect the holes
+  buffers.Holes.clear();
+  int blockVoxelIndex = 0;
+  for (int z = blockExtent[4]; z <= blockExtent[5]; z++)
+  {
+    for (int y = blockExtent[2]; y <= blockExtent[3]; y++)
+    {
+      for (int x = blockExtent[0]; x <= blockExtent[1]; x++, blockVoxelIndex++)
+      {
+        vtkIdType volIndex = volInc[0]*x + volInc[1]*y + volInc[2]*z;
+        bool isHole = (accPtr[accInc[0]*x + accInc[1]*y + accInc[2]*z] == 0);
+        if (isHole)
+        {
+          buffers.Holes.push_back(blockVoxelIndex);
+        }
+        for (int c = 0; c < numberOfComponents; c++)
+        {
+          outPtr[volIndex + c] = (isHole ? (T)0 : inVolPtr[volIndex + c]);
+        }
+      }
+    }
+  }
+  if (buffers.Holes.empty())
+  {
+    return;
+  }
+
+  const double numberOfBlockVoxels = blockVoxelIndex;
+  for (int c = 0; c < numberOfComponents; c++)
+  {
+    buffers.UnfilledHoles = buffers.Holes;
+    for (int k = 0; k < numberOfElements && !buffers.UnfilledHoles.empty(); k++) // k is the index of the element being tried
+    {
+      FillHolesInVolumeElement& element = elements[k];
+      const double holeRatio = buffers.UnfilledHoles.size() / numberOfBlockVoxels;
+      switch (element.type)
+      {
+      case FillHolesInVolumeElement::HFTYPE_GAUSSIAN:
+      case FillHolesInVolumeElement::HFTYPE_GAUSSIAN_ACCUMULATION:
+        if (holeRatio >= FILL_BLOCK_MIN_HOLE_RATIO_GAUSSIAN)
+        {
+          FillHolesWithKernelInBlock(element, simdEnabled, inVolPtr, accPtr, volInc, accInc, c, wholeExtent, blockExtent, outPtr, buffers);
+          continue;
+        }
+        break;
+      case FillHolesInVolumeElement::HFTYPE_DISTANCE_WEIGHT_INVERSE:
+        if (holeRatio >= FILL_BLOCK_MIN_HOLE_RATIO_DISTANCE_WEIGHT_INVERSE)
+        {
+          FillHolesWithKernelInBlock(element, simdEnabled, inVolPtr, accPtr, volInc, accInc, c, wholeExtent, blockExtent, outPtr, buffers);
+          continue;
+        }
+        break;
+      case FillHolesInVolumeElement::HFTYPE_STICK:
+        if (holeRatio >= FILL_BLOCK_MIN_HOLE_RATIO_STICK && element.stickLengthLimit < STICK_DISTANCE_INFINITE)
+        {
+          FillHolesWithSticksInBlock(element, inVolPtr, accPtr, volInc, accInc, c, wholeExtent, blockExtent, outPtr, buffers);
+          continue;
+        }
+        break;
+      default:
+        break;
+      }
+      FillHolesPerVoxelInBlock(element, inVolPtr, accPtr, volInc, accInc, c, wholeExtent, blockExtent, outPtr, buffers);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Fill the holes of outExt block by block
+template <class T>
+static void FillHolesBlockwise(FillHolesInVolumeElement* elements, int numberOfElements, bool simdEnabled,
+                               T* inVolPtr, unsigned short* accPtr, T* outPtr, vtkIdType* volInc, vtkIdType* accInc,
+                               int numberOfComponents, int* wholeExtent, const int outExt[6])
+{
+  FillHolesBlockBuffers<T> buffers;
+  int blockExtent[6];
+  for (blockExtent[4] = outExt[4]; blockExtent[4] <= outExt[5]; blockExtent[4] += FILL_BLOCK_SIZE)
+  {
+    blockExtent[5] = std::min(blockExtent[4] + FILL_BLOCK_SIZE - 1, outExt[5]);
+    for (blockExtent[2] = outExt[2]; blockExtent[2] <= outExt[3]; blockExtent[2] += FILL_BLOCK_SIZE)
+    {
+      blockExtent[3] = std::min(blockExtent[2] + FILL_BLOCK_SIZE - 1, outExt[3]);
+      for (blockExtent[0] = outExt[0]; blockExtent[0] <= outExt[1]; blockExtent[0] += FILL_BLOCK_SIZE)
+      {
+        blockExtent[1] = std::min(blockExtent[0] + FILL_BLOCK_SIZE - 1, outExt[1]);
+        FillHolesInBlock(elements, numberOfElements, simdEnabled, inVolPtr, accPtr, outPtr, volInc, accInc,
+                         numberOfComponents, wholeExtent, blockExtent, buffers);
+      }
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkPlusFillHolesInVolume::vtkPlusFillHolesInVolume()
 {
@@ -689,6 +1288,9 @@ vtkPlusFillHolesInVolume::vtkPlusFillHolesInVolume()
   this->SetNumberOfOutputPorts(1);
   this->Compounding=0;
   HFElements = NULL;
+  this->BlockwiseFillingEnabled = false;
+  this->SimdEnabled = true;
+  this->ThreadPool = vtkPlusThreadPool::New();
 }
 
 //----------------------------------------------------------------------------
@@ -696,6 +1298,11 @@ vtkPlusFillHolesInVolume::~vtkPlusFillHolesInVolume()
 {
   if (HFElements != NULL)
     delete[] HFElements;
+  if (this->ThreadPool != NULL)
+  {
+    this->ThreadPool->Delete();
+    this->ThreadPool = NULL;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -703,6 +1310,8 @@ void vtkPlusFillHolesInVolume::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
   os << indent << "Compounding: " << this->Compounding<< "\n";
+  os << indent << "BlockwiseFillingEnabled: " << (this->BlockwiseFillingEnabled ? "true" : "false") << "\n";
+  os << indent << "SimdEnabled: " << (this->SimdEnabled ? "true" : "false") << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -787,6 +1396,13 @@ void vtkPlusFillHolesInVolume::vtkPlusFillHolesInVolumeExecute(vtkImageData *inV
   int* wholeExtent;
   wholeExtent = outData->GetExtent();
 
+  if (this->BlockwiseFillingEnabled)
+  {
+    FillHolesBlockwise(this->HFElements, this->NumHFElements, this->SimdEnabled && PlusCpuFeatures::GetInstructionSet() >= PlusCpuFeatures::INSTRUCTION_SET_AVX2,
+                       inVolPtr, accPtr, outPtr, byteIncVol, byteIncAcc, numVolumeComponents, wholeExtent, outExt);
+    return;
+  }
+
   // iterate through each voxel. When the accumulation buffer is 0, fill that hole, and continue.
   for (currentPos[2] = outExt[4]; currentPos[2] <= outExt[5]; currentPos[2]++)
   {
@@ -804,23 +1420,7 @@ void vtkPlusFillHolesInVolume::vtkPlusFillHolesInVolumeExecute(vtkImageData *inV
             int volCompIndex = (currentPos[0]*byteIncVol[0])+(currentPos[1]*byteIncVol[1])+(currentPos[2]*byteIncVol[2])+c;
             for (int k = 0; k < NumHFElements; k++) // k is the index of the kernel being tried
             {
-              switch (HFElements[k].type) {
-              case FillHolesInVolumeElement::HFTYPE_GAUSSIAN:
-                result = HFElements[k].applyGaussian(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
-                break;
-              case FillHolesInVolumeElement::HFTYPE_GAUSSIAN_ACCUMULATION:
-                result = HFElements[k].applyGaussianAccumulation(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
-                break;
-              case FillHolesInVolumeElement::HFTYPE_STICK:
-                result = HFElements[k].applySticks(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
-                break;
-              case FillHolesInVolumeElement::HFTYPE_NEAREST_NEIGHBOR:
-                result = HFElements[k].applyNearestNeighbor(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
-                break;
-              case FillHolesInVolumeElement::HFTYPE_DISTANCE_WEIGHT_INVERSE:
-                result = HFElements[k].applyDistanceWeightInverse(inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
-                break;
-              }
+              result = ApplyHoleFillingElement(HFElements[k],inVolPtr,accPtr,byteIncVol,byteIncAcc,c,outExt,wholeExtent,currentPos,outPtr[volCompIndex]);
               if (result) {
                 break;
               } // end checking interpolation success
@@ -942,6 +1542,8 @@ void vtkPlusFillHolesInVolume::SetAccumulationBuffer(vtkImageData *accumulationB
 //--------------------------------------------------------------------------------------
 PlusStatus vtkPlusFillHolesInVolume::ReadConfiguration( vtkXMLDataElement* holeFillingConfig)
 {
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(BlockwiseFillingEnabled, holeFillingConfig);
+
   // find the number of kernels
   int numHFElements(0);
   for ( int nestedElementIndex = 0; nestedElementIndex < holeFillingConfig->GetNumberOfNestedElements(); ++nestedElementIndex )
@@ -1088,3 +1690,306 @@ PlusStatus vtkPlusFillHolesInVolume::ReadConfiguration( vtkXMLDataElement* holeF
 
   return PLUS_SUCCESS;
 }
+
+//--------------------------------------------------------------------------------------
+int vtkPlusFillHolesInVolume::GetMaximumElementReach()
+{
+  int reach = 0;
+  for (int k = 0; k < this->NumHFElements; k++)
+  {
+    int elementReach = 0;
+    switch (this->HFElements[k].type)
+    {
+    case FillHolesInVolumeElement::HFTYPE_STICK:
+      elementReach = this->HFElements[k].stickLengthLimit;
+      break;
+    default:
+      // gaussian, nearest neighbor and distance weight inverse elements use a cube of size voxels around the hole
+      elementReach = (this->HFElements[k].size - 1) / 2;
+      break;
+    }
+    reach = std::max(reach, elementReach);
+  }
+  return reach;
+}
+
+//--------------------------------------------------------------------------------------
+void vtkPlusFillHolesInVolume::GetBricksWithinElementReach(vtkPlusSparseVolume* brickGrid, const std::vector<int>& brickIndices, std::vector<int>& bricksWithinReach)
+{
+  int elementReach = this->GetMaximumElementReach();
+  std::vector<bool> brickWithinReach(brickGrid->GetNumberOfBricks(), false);
+  for (std::vector<int>::const_iterator brickIt = brickIndices.begin(); brickIt != brickIndices.end(); ++brickIt)
+  {
+    int reachExtent[6];
+    brickGrid->GetBrickExtent(*brickIt, reachExtent);
+    for (int i = 0; i < 3; i++)
+    {
+      reachExtent[2 * i] -= elementReach;
+      reachExtent[2 * i + 1] += elementReach;
+    }
+    int brickRange[6];
+    if (!brickGrid->GetBrickRange(reachExtent, brickRange))
+    {
+      continue;
+    }
+    for (int brickK = brickRange[4]; brickK <= brickRange[5]; brickK++)
+    {
+      for (int brickJ = brickRange[2]; brickJ <= brickRange[3]; brickJ++)
+      {
+        for (int brickI = brickRange[0]; brickI <= brickRange[1]; brickI++)
+        {
+          brickWithinReach[brickGrid->GetBrickIndex(brickI, brickJ, brickK)] = true;
+        }
+      }
+    }
+  }
+  bricksWithinReach.clear();
+  for (int brickIndex = 0; brickIndex < static_cast<int>(brickWithinReach.size()); brickIndex++)
+  {
+    if (brickWithinReach[brickIndex])
+    {
+      bricksWithinReach.push_back(brickIndex);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------
+// Returns true if the hole filled volume has the geometry and scalar type of the reconstructed volume
+static bool IsHoleFilledVolumeCompatible(vtkPlusSparseVolume* brickGrid, vtkImageData* holeFilledVolume)
+{
+  if (holeFilledVolume->GetScalarPointer() == NULL
+      || holeFilledVolume->GetScalarType() != brickGrid->GetScalarType()
+      || holeFilledVolume->GetNumberOfScalarComponents() != brickGrid->GetNumberOfScalarComponents())
+  {
+    return false;
+  }
+  int* holeFilledExtent = holeFilledVolume->GetExtent();
+  int* volumeExtent = brickGrid->GetExtent();
+  for (int i = 0; i < 6; i++)
+  {
+    if (holeFilledExtent[i] != volumeExtent[i])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------
+void vtkPlusFillHolesInVolume::FillHolesInBrick(void* userData, int brickListIndex, int workerIndex)
+{
+  FillHolesInBricksThreadFunctionInfoStruct* str = static_cast<FillHolesInBricksThreadFunctionInfoStruct*>(userData);
+  vtkPlusSparseVolume* brickGrid = str->BrickGrid;
+  int brickIndex = str->BrickIndices[brickListIndex];
+  int brickExtent[6];
+  brickGrid->GetBrickExtent(brickIndex, brickExtent);
+
+  if (str->ReconstructedVolume != NULL)
+  {
+    // dense input, the output voxels of the brick are computed directly
+    switch (str->ReconstructedVolume->GetScalarType())
+    {
+      vtkTemplateMacro(
+        str->HoleFiller->vtkPlusFillHolesInVolumeExecute(
+                                         str->ReconstructedVolume, static_cast<VTK_TT *>(str->ReconstructedVolume->GetScalarPointer()),
+                                         str->AccumulationBuffer, static_cast<unsigned short *>(str->AccumulationBuffer->GetScalarPointer()),
+                                         str->HoleFilledVolume,
+                                         static_cast<VTK_TT *>(str->HoleFilledVolume->GetScalarPointer()), brickExtent,
+                                         workerIndex));
+      default:
+        LOG_ERROR("FillHolesInBrick: Unknown ScalarType");
+        str->NumberOfErrors[workerIndex]++;
+    }
+    return;
+  }
+
+  // Holes of the brick may be filled from voxels of the neighboring bricks, therefore the brick and
+  // its surroundings (within the reach of the elements) are copied into a local image
+  int* volumeExtent = brickGrid->GetExtent();
+  int regionExtent[6];
+  int localRegionExtent[6];
+  int localBrickExtent[6];
+  for (int i = 0; i < 3; i++)
+  {
+    regionExtent[2 * i] = std::max(brickExtent[2 * i] - str->ElementReach, volumeExtent[2 * i]);
+    regionExtent[2 * i + 1] = std::min(brickExtent[2 * i + 1] + str->ElementReach, volumeExtent[2 * i + 1]);
+    // the elements compute voxel offsets from the first voxel of the image, so the local images start at index 0
+    localRegionExtent[2 * i] = 0;
+    localRegionExtent[2 * i + 1] = regionExtent[2 * i + 1] - regionExtent[2 * i];
+    localBrickExtent[2 * i] = brickExtent[2 * i] - regionExtent[2 * i];
+    localBrickExtent[2 * i + 1] = brickExtent[2 * i + 1] - regionExtent[2 * i];
+  }
+
+  vtkSmartPointer<vtkImageData> regionVolume = vtkSmartPointer<vtkImageData>::New();
+  regionVolume->SetExtent(localRegionExtent);
+  regionVolume->AllocateScalars(brickGrid->GetScalarType(), brickGrid->GetNumberOfScalarComponents());
+  vtkSmartPointer<vtkImageData> regionAccumulationBuffer = vtkSmartPointer<vtkImageData>::New();
+  regionAccumulationBuffer->SetExtent(localRegionExtent);
+  regionAccumulationBuffer->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+  vtkSmartPointer<vtkImageData> regionHoleFilledVolume = vtkSmartPointer<vtkImageData>::New();
+  regionHoleFilledVolume->SetExtent(localRegionExtent);
+  regionHoleFilledVolume->AllocateScalars(brickGrid->GetScalarType(), brickGrid->GetNumberOfScalarComponents());
+  if (brickGrid->ExtractRegion(regionExtent, regionVolume, regionAccumulationBuffer) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to extract the surroundings of brick " << brickIndex << " for hole filling");
+    str->NumberOfErrors[workerIndex]++;
+    return;
+  }
+
+  switch (brickGrid->GetScalarType())
+  {
+    vtkTemplateMacro(
+      str->HoleFiller->vtkPlusFillHolesInVolumeExecute(
+                                       regionVolume, static_cast<VTK_TT *>(regionVolume->GetScalarPointer()),
+                                       regionAccumulationBuffer, static_cast<unsigned short *>(regionAccumulationBuffer->GetScalarPointer()),
+                                       regionHoleFilledVolume,
+                                       static_cast<VTK_TT *>(regionHoleFilledVolume->GetScalarPointer()), localBrickExtent,
+                                       workerIndex));
+    default:
+      LOG_ERROR("FillHolesInBrick: Unknown ScalarType");
+      str->NumberOfErrors[workerIndex]++;
+      return;
+  }
+
+  // copy the voxels of the brick into the dense output volume
+  size_t rowSizeBytes = size_t(brickExtent[1] - brickExtent[0] + 1) * regionHoleFilledVolume->GetScalarSize() * brickGrid->GetNumberOfScalarComponents();
+  for (int z = brickExtent[4]; z <= brickExtent[5]; z++)
+  {
+    for (int y = brickExtent[2]; y <= brickExtent[3]; y++)
+    {
+      memcpy(str->HoleFilledVolume->GetScalarPointer(brickExtent[0], y, z),
+             regionHoleFilledVolume->GetScalarPointer(localBrickExtent[0], y - regionExtent[2], z - regionExtent[4]), rowSizeBytes);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------
+PlusStatus vtkPlusFillHolesInVolume::FillHolesInBricks(FillHolesInBricksThreadFunctionInfoStruct& str)
+{
+  str.HoleFiller = this;
+  str.ElementReach = this->GetMaximumElementReach();
+  LOG_DEBUG("Filling holes in " << str.BrickIndices.size() << " of " << str.BrickGrid->GetNumberOfBricks() << " bricks");
+
+  this->ThreadPool->SetNumberOfThreads(this->GetNumberOfThreads());
+  str.NumberOfErrors.assign(this->ThreadPool->GetNumberOfWorkers(), 0);
+  if (!str.BrickIndices.empty()
+      && this->ThreadPool->Execute(FillHolesInBrick, &str, static_cast<int>(str.BrickIndices.size())) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("vtkPlusFillHolesInVolume::FillHolesInBricks: failed to process the bricks");
+    return PLUS_FAIL;
+  }
+  str.HoleFilledVolume->Modified();
+
+  int numberOfErrors = 0;
+  for (std::vector<int>::iterator errorIt = str.NumberOfErrors.begin(); errorIt != str.NumberOfErrors.end(); ++errorIt)
+  {
+    numberOfErrors += *errorIt;
+  }
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("vtkPlusFillHolesInVolume::FillHolesInBricks: hole filling failed in " << numberOfErrors << " bricks");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//--------------------------------------------------------------------------------------
+PlusStatus vtkPlusFillHolesInVolume::FillHolesInSparseVolume(vtkPlusSparseVolume* sparseVolume, vtkImageData* holeFilledVolume)
+{
+  if (sparseVolume == NULL || holeFilledVolume == NULL)
+  {
+    LOG_ERROR("vtkPlusFillHolesInVolume::FillHolesInSparseVolume: invalid input or output volume");
+    return PLUS_FAIL;
+  }
+  int* volumeExtent = sparseVolume->GetExtent();
+  if (volumeExtent[0] > volumeExtent[1] || volumeExtent[2] > volumeExtent[3] || volumeExtent[4] > volumeExtent[5])
+  {
+    LOG_ERROR("vtkPlusFillHolesInVolume::FillHolesInSparseVolume: the sparse volume is not initialized");
+    return PLUS_FAIL;
+  }
+
+  // voxels of the bricks that are not processed remain empty
+  holeFilledVolume->SetExtent(volumeExtent);
+  holeFilledVolume->SetOrigin(sparseVolume->GetOrigin());
+  holeFilledVolume->SetSpacing(sparseVolume->GetSpacing());
+  holeFilledVolume->AllocateScalars(sparseVolume->GetScalarType(), sparseVolume->GetNumberOfScalarComponents());
+  if (holeFilledVolume->GetScalarPointer() == NULL)
+  {
+    LOG_ERROR("vtkPlusFillHolesInVolume::FillHolesInSparseVolume: cannot allocate memory for the hole filled volume");
+    return PLUS_FAIL;
+  }
+  memset(holeFilledVolume->GetScalarPointer(), 0, size_t(volumeExtent[1] - volumeExtent[0] + 1)
+         * size_t(volumeExtent[3] - volumeExtent[2] + 1) * size_t(volumeExtent[5] - volumeExtent[4] + 1)
+         * holeFilledVolume->GetScalarSize() * sparseVolume->GetNumberOfScalarComponents());
+
+  // process the allocated bricks and the empty bricks that have an allocated brick within the reach of the elements
+  FillHolesInBricksThreadFunctionInfoStruct str;
+  str.BrickGrid = sparseVolume;
+  str.ReconstructedVolume = NULL;
+  str.AccumulationBuffer = NULL;
+  str.HoleFilledVolume = holeFilledVolume;
+  std::vector<int> allocatedBrickIndices;
+  sparseVolume->GetAllocatedBricks(allocatedBrickIndices);
+  this->GetBricksWithinElementReach(sparseVolume, allocatedBrickIndices, str.BrickIndices);
+  return this->FillHolesInBricks(str);
+}
+
+//--------------------------------------------------------------------------------------
+PlusStatus vtkPlusFillHolesInVolume::UpdateHoleFilledVolume(vtkPlusSparseVolume* sparseVolume, const std::vector<int>& modifiedBricks, vtkImageData* holeFilledVolume)
+{
+  if (sparseVolume == NULL || holeFilledVolume == NULL)
+  {
+    LOG_ERROR("vtkPlusFillHolesInVolume::UpdateHoleFilledVolume: invalid input or output volume");
+    return PLUS_FAIL;
+  }
+  if (!IsHoleFilledVolumeCompatible(sparseVolume, holeFilledVolume))
+  {
+    LOG_ERROR("vtkPlusFillHolesInVolume::UpdateHoleFilledVolume: the hole filled volume does not match the sparse volume");
+    return PLUS_FAIL;
+  }
+
+  FillHolesInBricksThreadFunctionInfoStruct str;
+  str.BrickGrid = sparseVolume;
+  str.ReconstructedVolume = NULL;
+  str.AccumulationBuffer = NULL;
+  str.HoleFilledVolume = holeFilledVolume;
+  this->GetBricksWithinElementReach(sparseVolume, modifiedBricks, str.BrickIndices);
+  return this->FillHolesInBricks(str);
+}
+
+//--------------------------------------------------------------------------------------
+PlusStatus vtkPlusFillHolesInVolume::UpdateHoleFilledVolume(vtkImageData* reconstructedVolume, vtkImageData* accumulationBuffer, vtkPlusSparseVolume* brickGrid,
+    const std::vector<int>& modifiedBricks, vtkImageData* holeFilledVolume)
+{
+  if (reconstructedVolume == NULL || reconstructedVolume->GetScalarPointer() == NULL
+      || accumulationBuffer == NULL || accumulationBuffer->GetScalarPointer() == NULL
+      || brickGrid == NULL || holeFilledVolume == NULL)
+  {
+    LOG_ERROR("vtkPlusFillHolesInVolume::UpdateHoleFilledVolume: invalid input or output volume");
+    return PLUS_FAIL;
+  }
+  int* volumeExtent = reconstructedVolume->GetExtent();
+  int* accumulationBufferExtent = accumulationBuffer->GetExtent();
+  int* brickGridExtent = brickGrid->GetExtent();
+  for (int i = 0; i < 6; i++)
+  {
+    if (volumeExtent[i] != accumulationBufferExtent[i] || volumeExtent[i] != brickGridExtent[i])
+    {
+      LOG_ERROR("vtkPlusFillHolesInVolume::UpdateHoleFilledVolume: the extents of the reconstructed volume, accumulation buffer, and brick grid do not match");
+      return PLUS_FAIL;
+    }
+  }
+  if (!IsHoleFilledVolumeCompatible(brickGrid, holeFilledVolume) || reconstructedVolume->GetScalarType() != holeFilledVolume->GetScalarType())
+  {
+    LOG_ERROR("vtkPlusFillHolesInVolume::UpdateHoleFilledVolume: the hole filled volume does not match the reconstructed volume");
+    return PLUS_FAIL;
+  }
+
+  FillHolesInBricksThreadFunctionInfoStruct str;
+  str.BrickGrid = brickGrid;
+  str.ReconstructedVolume = reconstructedVolume;
+  str.AccumulationBuffer = accumulationBuffer;
+  str.HoleFilledVolume = holeFilledVolume;
+  this->GetBricksWithinElementReach(brickGrid, modifiedBricks, str.BrickIndices);
+  return this->FillHolesInBricks(str);
+}
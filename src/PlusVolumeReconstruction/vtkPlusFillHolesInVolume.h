@@ -45,6 +45,12 @@ POSSIBILITY OF SUCH DAMAGES.
 #include "vtkPlusVolumeReconstructionExport.h"
 #include "vtkThreadedImageAlgorithm.h"
 
+#include <vector>
+
+class vtkPlusSparseVolume;
+struct FillHolesInBricksThreadFunctionInfoStruct;
+class vtkPlusThreadPool;
+
 /*!
   /struct vtkPlusFillHolesInVolumeKernel
   /brief Holds information about a user-specified kernel
@@ -58,7 +64,14 @@ struct vtkPlusFillHolesInVolumeKernel
   float minRatio;
 };
 
-// TODO: This needs massive optimization
+/*!
+  \class FillHolesInVolumeElement
+  \brief Hole filling method and its parameters
+
+  The apply... methods fill one hole voxel. vtkPlusFillHolesInVolume evaluates the elements for blocks of voxels
+  at once if BlockwiseFillingEnabled is set.
+  \ingroup PlusLibVolumeReconstruction
+*/
 class FillHolesInVolumeElement 
 {
 public:
@@ -208,6 +221,25 @@ public:
   */
   vtkSetMacro(Compounding,int);
 
+  /*!
+    Fill the holes block by block: the elements are evaluated for blocks of voxels at once (separable convolution
+    for gaussian elements, one search per direction for stick elements), which is much faster than evaluating the
+    neighborhood of each hole independently. The result is the same, except for rounding errors of gaussian
+    elements (a filled voxel may differ by one gray level). Disabled by default, so that the result is exactly
+    the same as in earlier versions. Can be set by the BlockwiseFillingEnabled attribute of the HoleFilling element.
+  */
+  vtkSetMacro(BlockwiseFillingEnabled,bool);
+  vtkGetMacro(BlockwiseFillingEnabled,bool);
+  vtkBooleanMacro(BlockwiseFillingEnabled,bool);
+
+  /*!
+    Enable use of SIMD (AVX2) instructions in blockwise hole filling, if they are supported by the CPU.
+    The result is the same as without SIMD instructions. Enabled by default.
+  */
+  vtkSetMacro(SimdEnabled,bool);
+  vtkGetMacro(SimdEnabled,bool);
+  vtkBooleanMacro(SimdEnabled,bool);
+
   /*!
     Get the index'th kernel that is to be tried, index ranging from 0 (first kernel)
   up to NumKernels-1 (last kernel).
@@ -250,6 +282,30 @@ public:
   /*! Read hole filling parameter form a HoleFilling XML element */
   virtual PlusStatus ReadConfiguration( vtkXMLDataElement* holeFillingConfig); 
 
+  /*!
+    Fill holes in a sparse reconstructed volume and write the result into a dense volume of the full extent.
+    Only the allocated bricks and the bricks that are within the reach of the hole filling elements from an allocated brick
+    are processed, the other voxels could not be filled and are set to zero. The result is the same as filling the holes
+    of the exported dense volume, but the dense reconstructed volume and accumulation buffer are never created.
+  */
+  PlusStatus FillHolesInSparseVolume(vtkPlusSparseVolume* sparseVolume, vtkImageData* holeFilledVolume);
+
+  /*!
+    Update a previously filled volume after slices were pasted into the sparse reconstructed volume.
+    Only the modified bricks and the bricks that are within the reach of the hole filling elements from a modified brick
+    are filled again, the other voxels of holeFilledVolume are kept. The result is the same as filling all holes again
+    if holeFilledVolume contains the result of filling the volume before the modifications.
+  */
+  PlusStatus UpdateHoleFilledVolume(vtkPlusSparseVolume* sparseVolume, const std::vector<int>& modifiedBricks, vtkImageData* holeFilledVolume);
+
+  /*!
+    Update a previously filled volume after slices were pasted into the dense reconstructed volume.
+    The brick grid is used only for identifying the modified regions (bricks of the grid do not have to be allocated),
+    its extent must match the extent of the reconstructed volume.
+  */
+  PlusStatus UpdateHoleFilledVolume(vtkImageData* reconstructedVolume, vtkImageData* accumulationBuffer, vtkPlusSparseVolume* brickGrid,
+    const std::vector<int>& modifiedBricks, vtkImageData* holeFilledVolume);
+
 protected:
   vtkPlusFillHolesInVolume();
   ~vtkPlusFillHolesInVolume();
@@ -292,10 +348,28 @@ protected:
 
   static VTK_THREAD_RETURN_TYPE FillHoleThreadFunction( void *arg );
 
+  /*! Largest distance (in voxels, along any axis) from a hole voxel to the voxels that the hole filling elements use */
+  int GetMaximumElementReach();
+
+  /*! Get the bricks whose voxels may be filled from voxels of the listed bricks (including the listed bricks) */
+  void GetBricksWithinElementReach(vtkPlusSparseVolume* brickGrid, const std::vector<int>& brickIndices, std::vector<int>& bricksWithinReach);
+
+  /*! Fill holes in the bricks listed in str using the thread pool */
+  PlusStatus FillHolesInBricks(FillHolesInBricksThreadFunctionInfoStruct& str);
+
+  /*! Fill holes in one brick, called by the thread pool in FillHolesInBricks */
+  static void FillHolesInBrick(void* userData, int brickListIndex, int workerIndex);
+
   int Compounding;
   int NumHFElements;
   FillHolesInVolumeElement* HFElements;
 
+  bool BlockwiseFillingEnabled;
+  bool SimdEnabled;
+
+  /*! Persistent worker threads for brick-wise hole filling */
+  vtkPlusThreadPool* ThreadPool;
+
 private:
   vtkPlusFillHolesInVolume(const vtkPlusFillHolesInVolume&);  // Not implemented.
   void operator=(const vtkPlusFillHolesInVolume&);  // Not implemented.
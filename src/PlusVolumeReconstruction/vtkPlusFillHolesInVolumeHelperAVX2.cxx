@@ -0,0 +1,38 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "vtkPlusFillHolesInVolumeHelperAVX2.h"
+
+#ifdef PLUS_X86_SIMD
+
+#include <immintrin.h>
+
+//----------------------------------------------------------------------------
+PLUS_SIMD_TARGET("avx2")
+void vtkFillHolesAddWeightedRowAVX2(double* sum, const double* values, double weight, int count)
+{
+  const __m256d weights = _mm256_set1_pd(weight);
+  int i = 0;
+  // two vectors per iteration to hide the latency of the additions
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256d products1 = _mm256_mul_pd(weights, _mm256_loadu_pd(values + i));
+    __m256d products2 = _mm256_mul_pd(weights, _mm256_loadu_pd(values + i + 4));
+    _mm256_storeu_pd(sum + i, _mm256_add_pd(_mm256_loadu_pd(sum + i), products1));
+    _mm256_storeu_pd(sum + i + 4, _mm256_add_pd(_mm256_loadu_pd(sum + i + 4), products2));
+  }
+  for (; i + 4 <= count; i += 4)
+  {
+    __m256d products = _mm256_mul_pd(weights, _mm256_loadu_pd(values + i));
+    _mm256_storeu_pd(sum + i, _mm256_add_pd(_mm256_loadu_pd(sum + i), products));
+  }
+  for (; i < count; ++i)
+  {
+    sum[i] += weight * values[i];
+  }
+}
+
+#endif
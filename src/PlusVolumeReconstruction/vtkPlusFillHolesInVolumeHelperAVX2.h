@@ -0,0 +1,33 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusFillHolesInVolumeHelperAVX2.h
+  \brief AVX2 implementation of hole filling functions
+
+  The functions use AVX2 instructions, therefore they may only be called if PlusCpuFeatures::GetInstructionSet()
+  returns INSTRUCTION_SET_AVX2 (or higher). They are only available if PLUS_X86_SIMD is defined.
+
+  \sa vtkPlusFillHolesInVolume
+  \ingroup PlusLibVolumeReconstruction
+*/
+#ifndef __vtkPlusFillHolesInVolumeHelperAVX2_h
+#define __vtkPlusFillHolesInVolumeHelperAVX2_h
+
+#include "PlusCpuFeatures.h"
+
+#ifdef PLUS_X86_SIMD
+
+/*!
+  Add a weighted row of values to a row of sums: sum[i] += weight * values[i] for i = 0..count-1.
+  Products and sums are computed separately (no fused multiply-add), so the result is exactly the same
+  as the result of the scalar loop.
+*/
+void vtkFillHolesAddWeightedRowAVX2(double* sum, const double* values, double weight, int count);
+
+#endif
+
+#endif
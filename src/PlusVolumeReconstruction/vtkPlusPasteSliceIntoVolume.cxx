@@ -45,12 +45,17 @@ POSSIBILITY OF SUCH DAMAGES.
 #include "vtkImageData.h"
 #include "vtkIndent.h"
 #include "vtkMath.h"
-#include "vtkMultiThreader.h"
+#include "vtkMatrix4x4.h"
 #include "vtkTransform.h"
 #include "vtkXMLUtilities.h"
 #include "vtkXMLDataElement.h"
 
+#include <algorithm>
+#include <map>
+
 #include "vtkPlusPasteSliceIntoVolume.h"
+#include "vtkPlusSparseVolume.h"
+#include "vtkPlusThreadPool.h"
 #include "vtkPlusPasteSliceIntoVolumeHelperCommon.h"
 #include "vtkPlusPasteSliceIntoVolumeHelperUnoptimized.h"
 #include "vtkPlusPasteSliceIntoVolumeHelperOptimized.h"
@@ -68,6 +73,7 @@ struct InsertSliceThreadFunctionInfoStruct
   vtkPlusPasteSliceIntoVolume::InterpolationType InterpolationMode;
   vtkPlusPasteSliceIntoVolume::CompoundingType CompoundingMode;
   double PixelRejectionThreshold;
+  bool SimdEnabled;
 
   double ClipRectangleOrigin[2];
   double ClipRectangleSize[2];
@@ -75,16 +81,79 @@ struct InsertSliceThreadFunctionInfoStruct
   double FanOrigin[2];
   double FanRadiusStart;
   double FanRadiusStop;
+
+  int InputFrameExtent[6];
+  /*! The input frame is split into blocks of rows along this axis */
+  int SplitAxis;
+  int NumberOfRowBlocks;
+  /*! Output volume and accumulator pointers (NULL if the output is sparse) */
+  void* OutPtr;
+  unsigned short* AccPtr;
+  /*! Transform from input frame pixel indices to output volume voxel indices */
+  double MatrixDouble[16];
+  fixed MatrixFixed[16];
+  /*! Minimum and maximum output z index of the input frame corners */
+  double OutputZRange[2];
+
+  /*! Number of voxels with accumulation buffer overflow, one counter per worker thread */
+  std::vector<unsigned int> AccumulationBufferSaturationErrors;
+};
+
+struct InsertSlicesThreadFunctionInfoStruct
+{
+  /*! Slices in the order they have to be pasted */
+  std::vector<InsertSliceThreadFunctionInfoStruct> Slices;
+  /*! The output volume is split into slabs along the z axis, each slab is updated by one thread */
+  int NumberOfSlabs;
+  int NumberOfOutputPlanes;
+  int OutputZMin;
+
+  /*! Number of voxels with accumulation buffer overflow, one counter per worker thread */
+  std::vector<unsigned int> AccumulationBufferSaturationErrors;
+};
+
+struct InsertSlicesIntoBricksThreadFunctionInfoStruct
+{
+  /*! Part of a slice that is pasted into a brick */
+  struct SliceRegion
+  {
+    int SliceIndex;
+    int InputFrameExtent[6];
+  };
+
+  /*! Slices in the order they have to be pasted */
+  std::vector<InsertSliceThreadFunctionInfoStruct>* Slices;
+  vtkPlusSparseVolume* SparseVolume;
+  /*! Bricks that the slices are pasted into */
+  std::vector<int> BrickIndices;
+  /*! Slice regions that are pasted into each brick of BrickIndices, in pasting order */
+  std::vector< std::vector<SliceRegion> > BrickSliceRegions;
+
+  /*! Number of voxels with accumulation buffer overflow, one counter per worker thread */
   std::vector<unsigned int> AccumulationBufferSaturationErrors;
 };
 
+namespace
+{
+  /*! Number of row blocks per thread, more blocks allow better balancing but increase the overhead */
+  const int ROW_BLOCKS_PER_THREAD = 8;
+  /*! Number of output volume slabs per thread when multiple slices are pasted at once */
+  const int SLABS_PER_THREAD = 4;
+  /*! A slice may modify voxels within this distance (in voxels) from its bounding box */
+  const double SLAB_MARGIN = 2.0;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusPasteSliceIntoVolume::vtkPlusPasteSliceIntoVolume()
 {
   this->ReconstructedVolume = vtkImageData::New();
   this->AccumulationBuffer = vtkImageData::New();
   this->ImportanceMask = NULL;
-  this->Threader = vtkMultiThreader::New();
+  this->SparseVolume = vtkPlusSparseVolume::New();
+  this->SparseOutput = false;
+  this->OutputIsSparse = false;
+  this->AllBricksModified = true;
+  this->ThreadPool = vtkPlusThreadPool::New();
 
   this->OutputOrigin[0] = 0.0;
   this->OutputOrigin[1] = 0.0;
@@ -124,6 +193,7 @@ vtkPlusPasteSliceIntoVolume::vtkPlusPasteSliceIntoVolume()
   this->CompoundingMode = UNDEFINED_COMPOUNDING_MODE;
 
   this->NumberOfThreads = 0; // 0 means not set, the default number of threads will be used
+  this->SimdEnabled = true;
 
   this->EnableAccumulationBufferOverflowWarning = true;
 
@@ -148,10 +218,15 @@ vtkPlusPasteSliceIntoVolume::~vtkPlusPasteSliceIntoVolume()
     this->AccumulationBuffer = NULL;
   }
   this->SetImportanceMask(NULL);
-  if ( this->Threader )
+  if ( this->SparseVolume )
   {
-    this->Threader->Delete();
-    this->Threader = NULL;
+    this->SparseVolume->Delete();
+    this->SparseVolume = NULL;
+  }
+  if ( this->ThreadPool )
+  {
+    this->ThreadPool->Delete();
+    this->ThreadPool = NULL;
   }
 }
 
@@ -204,18 +279,65 @@ void vtkPlusPasteSliceIntoVolume::PrintSelf( ostream& os, vtkIndent indent )
   {
     os << "default\n";
   }
+  os << indent << "SimdEnabled: " << ( this->SimdEnabled ? "true" : "false" ) << "\n";
+  os << indent << "SparseOutput: " << ( this->SparseOutput ? "true" : "false" ) << "\n";
+  if ( this->OutputIsSparse )
+  {
+    os << indent << "SparseVolume:\n";
+    this->SparseVolume->PrintSelf( os, indent.GetNextIndent() );
+  }
 }
 
 
+//----------------------------------------------------------------------------
+unsigned long vtkPlusPasteSliceIntoVolume::GetOutputMemorySize()
+{
+  if ( this->OutputIsSparse )
+  {
+    return this->SparseVolume->GetActualMemorySize();
+  }
+  return this->ReconstructedVolume->GetActualMemorySize() + this->AccumulationBuffer->GetActualMemorySize();
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusPasteSliceIntoVolume::GetModifiedBricks( std::vector<int>& brickIndices )
+{
+  brickIndices.assign( this->ModifiedBricks.begin(), this->ModifiedBricks.end() );
+  return !this->AllBricksModified;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPasteSliceIntoVolume::ClearModifiedBricks()
+{
+  this->ModifiedBricks.clear();
+  this->AllBricksModified = false;
+}
+
 //----------------------------------------------------------------------------
 vtkImageData* vtkPlusPasteSliceIntoVolume::GetReconstructedVolume()
 {
+  if ( this->OutputIsSparse && this->ReconstructedVolume->GetMTime() < this->SparseVolume->GetMTime() )
+  {
+    // the dense volume is only created when it is needed
+    if ( this->SparseVolume->ExportVolume( this->ReconstructedVolume ) != PLUS_SUCCESS )
+    {
+      LOG_ERROR( "Failed to export the sparse reconstructed volume" );
+    }
+  }
   return this->ReconstructedVolume;
 }
 
 //----------------------------------------------------------------------------
 vtkImageData* vtkPlusPasteSliceIntoVolume::GetAccumulationBuffer()
 {
+  if ( this->OutputIsSparse && this->AccumulationBuffer->GetMTime() < this->SparseVolume->GetMTime() )
+  {
+    // the dense accumulation buffer is only created when it is needed
+    if ( this->SparseVolume->ExportAccumulationBuffer( this->AccumulationBuffer ) != PLUS_SUCCESS )
+    {
+      LOG_ERROR( "Failed to export the sparse accumulation buffer" );
+    }
+  }
   return this->AccumulationBuffer;
 }
 
@@ -223,10 +345,29 @@ vtkImageData* vtkPlusPasteSliceIntoVolume::GetAccumulationBuffer()
 // Clear the output volume and the accumulation buffer
 PlusStatus vtkPlusPasteSliceIntoVolume::ResetOutput()
 {
+  // The brick grid is set up for dense output as well, it is used for keeping track of the modified bricks
+  this->ModifiedBricks.clear();
+  this->AllBricksModified = true;
+  if ( this->SparseVolume->Initialize( this->OutputExtent, this->OutputOrigin, this->OutputSpacing, this->OutputScalarMode, 1 ) != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Failed to initialize the bricks of the output volume" );
+    return PLUS_FAIL;
+  }
+
+  if ( this->SparseOutput )
+  {
+    // Memory is allocated only for the bricks that slices are pasted into, dense images are created on request
+    this->ReconstructedVolume->Initialize();
+    this->AccumulationBuffer->Initialize();
+    this->OutputIsSparse = true;
+    return PLUS_SUCCESS;
+  }
+  this->OutputIsSparse = false;
+
   // Allocate memory for accumulation buffer and set all pixels to 0
   // Start with this buffer because if no compunding is needed then we release memory before allocating memory for the reconstructed image.
 
-  vtkImageData* accData = this->GetAccumulationBuffer();
+  vtkImageData* accData = this->AccumulationBuffer;
   if ( accData == NULL )
   {
     LOG_ERROR( "Accumulation buffer object is not created" );
@@ -292,10 +433,259 @@ PlusStatus vtkPlusPasteSliceIntoVolume::ResetOutput()
 // RECONSTRUCTION - OPTIMIZED
 //****************************************************************************
 
+//----------------------------------------------------------------------------
+// Slice insertion functions that can be selected for InsertSliceForInputScalarType
+struct OptimizedInsertSliceFunction
+{
+  static const char* GetName() { return "OptimizedInsertSlice"; }
+  template <class F, class T>
+  static void InsertSlice( vtkPlusPasteSliceIntoVolumeInsertSliceParams* insertionParams ) { vtkOptimizedInsertSlice<F, T>( insertionParams ); }
+};
+
+struct UnoptimizedInsertSliceFunction
+{
+  static const char* GetName() { return "UnoptimizedInsertSlice"; }
+  template <class F, class T>
+  static void InsertSlice( vtkPlusPasteSliceIntoVolumeInsertSliceParams* insertionParams ) { vtkUnoptimizedInsertSlice<F, T>( insertionParams ); }
+};
+
+//----------------------------------------------------------------------------
+// Calls the slice insertion function with the template argument matching the scalar type of the input frame
+template <class InsertSliceFunction, class F>
+static void InsertSliceForInputScalarType( vtkPlusPasteSliceIntoVolumeInsertSliceParams* insertionParams )
+{
+  switch ( insertionParams->inData->GetScalarType() )
+  {
+  case VTK_SHORT:
+    InsertSliceFunction::template InsertSlice<F, short>( insertionParams );
+    break;
+  case VTK_UNSIGNED_SHORT:
+    InsertSliceFunction::template InsertSlice<F, unsigned short>( insertionParams );
+    break;
+  case VTK_CHAR:
+    InsertSliceFunction::template InsertSlice<F, char>( insertionParams );
+    break;
+  case VTK_UNSIGNED_CHAR:
+    InsertSliceFunction::template InsertSlice<F, unsigned char>( insertionParams );
+    break;
+  case VTK_FLOAT:
+    InsertSliceFunction::template InsertSlice<F, float>( insertionParams );
+    break;
+  case VTK_DOUBLE:
+    InsertSliceFunction::template InsertSlice<F, double>( insertionParams );
+    break;
+  case VTK_INT:
+    InsertSliceFunction::template InsertSlice<F, int>( insertionParams );
+    break;
+  case VTK_UNSIGNED_INT:
+    InsertSliceFunction::template InsertSlice<F, unsigned int>( insertionParams );
+    break;
+  case VTK_LONG:
+    InsertSliceFunction::template InsertSlice<F, long>( insertionParams );
+    break;
+  case VTK_UNSIGNED_LONG:
+    InsertSliceFunction::template InsertSlice<F, unsigned long>( insertionParams );
+    break;
+  default:
+    LOG_ERROR( InsertSliceFunction::GetName() << ": Unknown input ScalarType" );
+  }
+}
+
+//----------------------------------------------------------------------------
+// Pastes the inputFrameExtent region of a slice into the output volume (the dense volume or a brick of the sparse volume).
+// outPtr and accPtr point to the first voxel of the output volume and accumulator. Only the voxels with z index
+// (relative to the output extent) between outSlabZMin and outSlabZMax are modified.
+// accOverflowCount is the accumulation buffer overflow counter of the calling thread (no locking is needed).
+static void PasteSliceExtent( InsertSliceThreadFunctionInfoStruct* str, vtkImageData* outputVolume, void* outPtr, unsigned short* accPtr,
+                              int inputFrameExtent[6], unsigned int* accOverflowCount, int outSlabZMin, int outSlabZMax )
+{
+  unsigned char* importancePtr = NULL;
+  if ( str->CompoundingMode == vtkPlusPasteSliceIntoVolume::IMPORTANCE_MASK_COMPOUNDING_MODE )
+  {
+    importancePtr = static_cast<unsigned char*>( str->ImportanceImage->GetScalarPointerForExtent( inputFrameExtent ) );
+  }
+
+  // Get input frame pointer
+  vtkImageData* inData = str->InputFrameImage;
+  void* inPtr = inData->GetScalarPointerForExtent( inputFrameExtent );
+
+  // set up all the info for passing into the appropriate insertSlice function
+  vtkPlusPasteSliceIntoVolumeInsertSliceParams insertionParams;
+  insertionParams.accOverflowCount = accOverflowCount;
+  insertionParams.accPtr = accPtr;
+  insertionParams.importanceMask = str->ImportanceImage;
+  insertionParams.importancePtr = importancePtr;
+  insertionParams.compoundingMode = str->CompoundingMode;
+  insertionParams.clipRectangleOrigin = str->ClipRectangleOrigin;
+  insertionParams.clipRectangleSize = str->ClipRectangleSize;
+  insertionParams.fanAnglesDeg = str->FanAnglesDeg;
+  insertionParams.fanRadiusStart = str->FanRadiusStart;
+  insertionParams.fanRadiusStop = str->FanRadiusStop;
+  insertionParams.fanOrigin = str->FanOrigin;
+  insertionParams.inData = str->InputFrameImage;
+  insertionParams.inExt = inputFrameExtent;
+  insertionParams.inPtr = inPtr;
+  insertionParams.interpolationMode = str->InterpolationMode;
+  insertionParams.outData = outputVolume;
+  insertionParams.outPtr = outPtr;
+  insertionParams.pixelRejectionThreshold = str->PixelRejectionThreshold;
+  insertionParams.outSlabZMin = outSlabZMin;
+  insertionParams.outSlabZMax = outSlabZMax;
+  insertionParams.simdEnabled = str->SimdEnabled;
+  // the matrix is set depending on the optimization level
+
+  if ( str->Optimization == vtkPlusPasteSliceIntoVolume::FULL_OPTIMIZATION )
+  {
+    // use fixed-point math
+    insertionParams.matrix = str->MatrixFixed;
+    InsertSliceForInputScalarType<OptimizedInsertSliceFunction, fixed>( &insertionParams );
+  }
+  else
+  {
+    // if we are not using fixed point math for optimization = 2, we are either:
+    // doing no optimization (0) OR
+    // breaking into x, y, z components with no bounds checking for nearest neighbor (1)
+    insertionParams.matrix = str->MatrixDouble;
+
+    if ( str->Optimization == vtkPlusPasteSliceIntoVolume::PARTIAL_OPTIMIZATION )
+    {
+      InsertSliceForInputScalarType<OptimizedInsertSliceFunction, double>( &insertionParams );
+    }
+    else
+    {
+      // no optimization
+      InsertSliceForInputScalarType<UnoptimizedInsertSliceFunction, double>( &insertionParams );
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 // Does the actual work of optimally inserting a slice, with optimization
-// Basically, just calls Multithread()
+// Basically, splits the slice into blocks of rows that are pasted by the thread pool
 PlusStatus vtkPlusPasteSliceIntoVolume::InsertSlice( vtkImageData* image, vtkMatrix4x4* transformImageToReference )
+{
+  if ( this->OutputIsSparse )
+  {
+    std::vector<InsertSliceThreadFunctionInfoStruct> slices( 1 );
+    if ( this->InitializeSliceInsertion( image, transformImageToReference, slices[0] ) != PLUS_SUCCESS )
+    {
+      return PLUS_FAIL;
+    }
+    return this->InsertSlicesIntoSparseVolume( slices );
+  }
+
+  InsertSliceThreadFunctionInfoStruct str;
+  if ( this->InitializeSliceInsertion( image, transformImageToReference, str ) != PLUS_SUCCESS )
+  {
+    return PLUS_FAIL;
+  }
+  this->MarkModifiedBricks( str );
+
+  // Split the slice into blocks of rows (or planes, for 3D input frames), several blocks per thread.
+  // Threads that are done with their own blocks take over blocks from the other threads, so the work is balanced
+  // even if most of the pasted pixels are in a few rows (e.g., because of fan clipping).
+  this->ThreadPool->SetNumberOfThreads( this->NumberOfThreads );
+  int numberOfWorkers = this->ThreadPool->GetNumberOfWorkers();
+  str.SplitAxis = 2; // preference is z, then y, then x
+  while ( str.SplitAxis > 0 && str.InputFrameExtent[str.SplitAxis * 2] == str.InputFrameExtent[str.SplitAxis * 2 + 1] )
+  {
+    --str.SplitAxis;
+  }
+  int numberOfRows = str.InputFrameExtent[str.SplitAxis * 2 + 1] - str.InputFrameExtent[str.SplitAxis * 2] + 1;
+  str.NumberOfRowBlocks = std::min( numberOfRows, numberOfWorkers > 1 ? numberOfWorkers * ROW_BLOCKS_PER_THREAD : 1 );
+
+  // initialize array that counts the number of insertion errors due to overflow in the accumulation buffer
+  str.AccumulationBufferSaturationErrors.assign( numberOfWorkers, 0 );
+
+  if ( str.NumberOfRowBlocks > 0 )
+  {
+    this->ThreadPool->Execute( InsertSliceRowBlock, &str, str.NumberOfRowBlocks );
+  }
+
+  this->FinalizeSliceInsertion( str.AccumulationBufferSaturationErrors );
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// Pastes a batch of slices concurrently. Each voxel is modified by only one thread and the slices are pasted
+// in their original order, therefore the result is the same as pasting the slices one by one with one thread.
+PlusStatus vtkPlusPasteSliceIntoVolume::InsertSlices( const std::vector<vtkImageData*>& images, const std::vector<vtkMatrix4x4*>& transformsImageToReference )
+{
+  if ( images.size() != transformsImageToReference.size() )
+  {
+    LOG_ERROR( "InsertSlices: number of images (" << images.size() << ") does not match the number of transforms (" << transformsImageToReference.size() << ")" );
+    return PLUS_FAIL;
+  }
+
+  if ( this->OutputIsSparse )
+  {
+    // bricks are independent, so concurrent pasting is supported in all modes
+    std::vector<InsertSliceThreadFunctionInfoStruct> slices( images.size() );
+    for ( unsigned int sliceIndex = 0; sliceIndex < images.size(); ++sliceIndex )
+    {
+      if ( this->InitializeSliceInsertion( images[sliceIndex], transformsImageToReference[sliceIndex], slices[sliceIndex] ) != PLUS_SUCCESS )
+      {
+        LOG_ERROR( "InsertSlices: slice " << sliceIndex << " cannot be inserted, none of the slices are inserted" );
+        return PLUS_FAIL;
+      }
+    }
+    return this->InsertSlicesIntoSparseVolume( slices );
+  }
+
+  bool concurrentPastingSupported = ( this->Optimization == PARTIAL_OPTIMIZATION || this->Optimization == FULL_OPTIMIZATION )
+                                    && ( this->CompoundingMode == LATEST_COMPOUNDING_MODE
+                                         || this->CompoundingMode == MAXIMUM_COMPOUNDING_MODE
+                                         || this->CompoundingMode == MEAN_COMPOUNDING_MODE );
+  if ( !concurrentPastingSupported || images.size() < 2 )
+  {
+    PlusStatus status = PLUS_SUCCESS;
+    for ( unsigned int sliceIndex = 0; sliceIndex < images.size(); ++sliceIndex )
+    {
+      if ( this->InsertSlice( images[sliceIndex], transformsImageToReference[sliceIndex] ) != PLUS_SUCCESS )
+      {
+        status = PLUS_FAIL;
+      }
+    }
+    return status;
+  }
+
+  InsertSlicesThreadFunctionInfoStruct batch;
+  batch.Slices.resize( images.size() );
+  for ( unsigned int sliceIndex = 0; sliceIndex < images.size(); ++sliceIndex )
+  {
+    InsertSliceThreadFunctionInfoStruct& str = batch.Slices[sliceIndex];
+    if ( this->InitializeSliceInsertion( images[sliceIndex], transformsImageToReference[sliceIndex], str ) != PLUS_SUCCESS )
+    {
+      LOG_ERROR( "InsertSlices: slice " << sliceIndex << " cannot be inserted, none of the slices are inserted" );
+      return PLUS_FAIL;
+    }
+  }
+  for ( unsigned int sliceIndex = 0; sliceIndex < images.size(); ++sliceIndex )
+  {
+    this->MarkModifiedBricks( batch.Slices[sliceIndex] );
+  }
+
+  // Split the output volume into slabs, several slabs per thread. The slices of a sweep usually intersect
+  // only a few slabs, so threads that are done with their own slabs take over slabs from the other threads.
+  this->ThreadPool->SetNumberOfThreads( this->NumberOfThreads );
+  int numberOfWorkers = this->ThreadPool->GetNumberOfWorkers();
+  int* outExt = this->ReconstructedVolume->GetExtent();
+  batch.OutputZMin = outExt[4];
+  batch.NumberOfOutputPlanes = outExt[5] - outExt[4] + 1;
+  batch.NumberOfSlabs = std::min( batch.NumberOfOutputPlanes, numberOfWorkers > 1 ? numberOfWorkers * SLABS_PER_THREAD : 1 );
+  batch.AccumulationBufferSaturationErrors.assign( numberOfWorkers, 0 );
+
+  if ( batch.NumberOfSlabs > 0 )
+  {
+    this->ThreadPool->Execute( InsertSlicesIntoSlab, &batch, batch.NumberOfSlabs );
+  }
+
+  this->FinalizeSliceInsertion( batch.AccumulationBufferSaturationErrors );
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusPasteSliceIntoVolume::InitializeSliceInsertion( vtkImageData* image, vtkMatrix4x4* transformImageToReference, InsertSliceThreadFunctionInfoStruct& str )
 {
   if ( this->OutputExtent[0] >= this->OutputExtent[1]
        && this->OutputExtent[2] >= this->OutputExtent[3]
@@ -307,11 +697,13 @@ PlusStatus vtkPlusPasteSliceIntoVolume::InsertSlice( vtkImageData* image, vtkMat
     return PLUS_FAIL;
   }
 
-  InsertSliceThreadFunctionInfoStruct str;
   str.InputFrameImage = image;
   str.TransformImageToReference = transformImageToReference;
-  str.OutputVolume = this->ReconstructedVolume;
-  str.Accumulator = this->AccumulationBuffer;
+  // the sparse volume bricks are set when the slice is pasted
+  str.OutputVolume = this->OutputIsSparse ? NULL : this->ReconstructedVolume;
+  str.Accumulator = this->OutputIsSparse ? NULL : this->AccumulationBuffer;
+  str.OutPtr = NULL;
+  str.AccPtr = NULL;
   str.ImportanceImage = this->ImportanceMask;
   str.InterpolationMode = this->InterpolationMode;
   str.CompoundingMode = this->CompoundingMode;
@@ -340,128 +732,84 @@ PlusStatus vtkPlusPasteSliceIntoVolume::InsertSlice( vtkImageData* image, vtkMat
   str.FanRadiusStop = this->FanRadiusStop;
 
   str.PixelRejectionThreshold = this->PixelRejectionThreshold;
+  str.SimdEnabled = this->SimdEnabled && PlusCpuFeatures::GetInstructionSet() >= PlusCpuFeatures::INSTRUCTION_SET_AVX2;
 
-  if ( this->NumberOfThreads > 0 )
-  {
-    this->Threader->SetNumberOfThreads( this->NumberOfThreads );
-  }
-
-  // initialize array that counts the number of insertion errors due to overflow in the accumulation buffer
-  int numThreads( this->Threader->GetNumberOfThreads() );
-  str.AccumulationBufferSaturationErrors.resize( numThreads );
-  str.AccumulationBufferSaturationErrors.clear();
-  for ( int i = 0; i < numThreads; i++ )
-  {
-    str.AccumulationBufferSaturationErrors.push_back( 0 );
-  }
+  image->GetExtent( str.InputFrameExtent );
 
-  this->Threader->SetSingleMethod( InsertSliceThreadFunction, &str );
-  this->Threader->SingleMethodExecute();
-
-  // sum up str.AccumulationBufferSaturationErrors
-  unsigned int sumAccOverflowErrors( 0 );
-  for ( int i = 0; i < numThreads; i++ )
-  {
-    sumAccOverflowErrors += str.AccumulationBufferSaturationErrors[i];
-  }
-  if ( sumAccOverflowErrors && !EnableAccumulationBufferOverflowWarning )
+  // Check the inputs once for the whole slice, before the work is distributed between threads
+  if ( str.CompoundingMode == IMPORTANCE_MASK_COMPOUNDING_MODE )
   {
-    LOG_WARNING( sumAccOverflowErrors << " voxels have had too many pixels inserted. This can result in errors in the final volume. It is recommended that the output volume resolution be increased." );
-  }
-
-  this->ReconstructedVolume->Modified();
-  this->AccumulationBuffer->Modified();
-  this->Modified();
-
-  return PLUS_SUCCESS;
-}
-
-//----------------------------------------------------------------------------
-VTK_THREAD_RETURN_TYPE vtkPlusPasteSliceIntoVolume::InsertSliceThreadFunction( void* arg )
-{
-  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>( arg );
-  InsertSliceThreadFunctionInfoStruct* str = static_cast<InsertSliceThreadFunctionInfoStruct*>( threadInfo->UserData );
-
-  // Compute what extent of the input image will be processed by this thread
-  int threadId = threadInfo->ThreadID;
-  int threadCount = threadInfo->NumberOfThreads;
-  int inputFrameExtent[6];
-  str->InputFrameImage->GetExtent( inputFrameExtent );
-  unsigned char *importancePtr = NULL;
-  int inputFrameExtentForCurrentThread[6] = { 0, -1, 0, -1, 0, -1 };
-
-  int totalUsedThreads = vtkPlusPasteSliceIntoVolume::SplitSliceExtent(inputFrameExtentForCurrentThread, inputFrameExtent, threadId, threadCount);
-
-  if (threadId >= totalUsedThreads)
-  {
-    // don't use this thread. Sometimes the threads dont
-    // break up very well and it is just as efficient to leave a
-    // few threads idle.
-    return VTK_THREAD_RETURN_VALUE;
-  }
-
-  if (str->CompoundingMode == IMPORTANCE_MASK_COMPOUNDING_MODE)
-  {
-    if (!str->ImportanceImage)
+    if ( !str.ImportanceImage )
     {
       LOG_ERROR( "OptimizedInsertSlice: IMPORTANCE_MASK_COMPOUNDING_MODE was selected but importance mask has not been defined" );
-      return VTK_THREAD_RETURN_VALUE;
+      return PLUS_FAIL;
     }
     int importanceMaskExtent[6];
-    str->ImportanceImage->GetExtent( importanceMaskExtent );
-    for (int i = 0; i < 6; i++)
+    str.ImportanceImage->GetExtent( importanceMaskExtent );
+    for ( int i = 0; i < 6; i++ )
     {
-      if (inputFrameExtent[i]!=importanceMaskExtent[i])
+      if ( str.InputFrameExtent[i] != importanceMaskExtent[i] )
       {
-        LOG_ERROR("OptimizedInsertSlice: input frame extent ["
-        << inputFrameExtent[0] << ", " << inputFrameExtent[1] << ", " << inputFrameExtent[2]<<", "
-        << inputFrameExtent[3] << ", " << inputFrameExtent[4] << ", " << inputFrameExtent[5]<<"]"
-        " does not match importance mask extent ["
-        << importanceMaskExtent[0] << ", " << importanceMaskExtent[1] << ", " << importanceMaskExtent[2]<<", "
-        << importanceMaskExtent[3] << ", " << importanceMaskExtent[4] << ", " << importanceMaskExtent[5]<<"]");
-        return VTK_THREAD_RETURN_VALUE;
+        LOG_ERROR( "OptimizedInsertSlice: input frame extent ["
+                   << str.InputFrameExtent[0] << ", " << str.InputFrameExtent[1] << ", " << str.InputFrameExtent[2] << ", "
+                   << str.InputFrameExtent[3] << ", " << str.InputFrameExtent[4] << ", " << str.InputFrameExtent[5] << "]"
+                   " does not match importance mask extent ["
+                   << importanceMaskExtent[0] << ", " << importanceMaskExtent[1] << ", " << importanceMaskExtent[2] << ", "
+                   << importanceMaskExtent[3] << ", " << importanceMaskExtent[4] << ", " << importanceMaskExtent[5] << "]" );
+        return PLUS_FAIL;
       }
     }
-    if (str->ImportanceImage->GetNumberOfScalarComponents() != 1)
+    if ( str.ImportanceImage->GetNumberOfScalarComponents() != 1 )
     {
-      LOG_ERROR("OptimizedInsertSlice: number of scalar components in importance mask is invalid (1 expected, actual value is "
-        << str->ImportanceImage->GetNumberOfScalarComponents() << ")");
-      return VTK_THREAD_RETURN_VALUE;
+      LOG_ERROR( "OptimizedInsertSlice: number of scalar components in importance mask is invalid (1 expected, actual value is "
+                 << str.ImportanceImage->GetNumberOfScalarComponents() << ")" );
+      return PLUS_FAIL;
     }
-    if (str->ImportanceImage->GetScalarType() != VTK_UNSIGNED_CHAR)
+    if ( str.ImportanceImage->GetScalarType() != VTK_UNSIGNED_CHAR )
     {
-      LOG_ERROR( "OptimizedInsertSlice: importance mask extent must have unsigned char scalar type");
-      return VTK_THREAD_RETURN_VALUE;
+      LOG_ERROR( "OptimizedInsertSlice: importance mask extent must have unsigned char scalar type" );
+      return PLUS_FAIL;
     }
-    importancePtr = static_cast<unsigned char*>(str->ImportanceImage->GetScalarPointerForExtent(inputFrameExtentForCurrentThread));
   }
 
-  // this filter expects that input is the same type as output.
-  if ( str->InputFrameImage->GetScalarType() != str->OutputVolume->GetScalarType() )
+  // Output volume geometry
+  int outputScalarType = VTK_VOID;
+  double* outputOrigin = NULL;
+  double* outputSpacing = NULL;
+  if ( this->OutputIsSparse )
   {
-    LOG_ERROR( "OptimizedInsertSlice: input ScalarType (" << str->InputFrameImage->GetScalarType() << ") "
-               << " must match out ScalarType (" << str->OutputVolume->GetScalarType() << ")" );
-    return VTK_THREAD_RETURN_VALUE;
+    outputScalarType = this->SparseVolume->GetScalarType();
+    outputOrigin = this->SparseVolume->GetOrigin();
+    outputSpacing = this->SparseVolume->GetSpacing();
+  }
+  else
+  {
+    outputScalarType = str.OutputVolume->GetScalarType();
+    outputOrigin = str.OutputVolume->GetOrigin();
+    outputSpacing = str.OutputVolume->GetSpacing();
   }
 
-  // Get input frame extent and pointer
-  vtkImageData* inData = str->InputFrameImage;
-  void* inPtr = inData->GetScalarPointerForExtent( inputFrameExtentForCurrentThread );
-
-  // Get output volume extent and pointer
-  vtkImageData* outData = str->OutputVolume;
-  int* outExt = outData->GetExtent();
-  void* outPtr = outData->GetScalarPointerForExtent( outExt );
-
-  if (str->Accumulator->GetScalarType() != VTK_UNSIGNED_SHORT || str->Accumulator->GetNumberOfScalarComponents() != 1)
+  // this filter expects that input is the same type as output.
+  if ( str.InputFrameImage->GetScalarType() != outputScalarType )
   {
-    LOG_ERROR( "OptimizedInsertSlice: accumulator must have unsigned short scalar type and 1 component");
-    return VTK_THREAD_RETURN_VALUE;
+    LOG_ERROR( "OptimizedInsertSlice: input ScalarType (" << str.InputFrameImage->GetScalarType() << ") "
+               << " must match out ScalarType (" << outputScalarType << ")" );
+    return PLUS_FAIL;
   }
-  unsigned short* accPtr = static_cast<unsigned short*>(str->Accumulator->GetScalarPointerForExtent(outExt));
 
-  // count the number of accumulation buffer overflow instances in the memory address here:
-  unsigned int* accumulationBufferSaturationErrorsThread = &( str->AccumulationBufferSaturationErrors[threadId] );
+  if ( !this->OutputIsSparse )
+  {
+    if ( str.Accumulator->GetScalarType() != VTK_UNSIGNED_SHORT || str.Accumulator->GetNumberOfScalarComponents() != 1 )
+    {
+      LOG_ERROR( "OptimizedInsertSlice: accumulator must have unsigned short scalar type and 1 component" );
+      return PLUS_FAIL;
+    }
+
+    // Get output volume and accumulator pointers
+    int* outExt = str.OutputVolume->GetExtent();
+    str.OutPtr = str.OutputVolume->GetScalarPointerForExtent( outExt );
+    str.AccPtr = static_cast<unsigned short*>( str.Accumulator->GetScalarPointerForExtent( outExt ) );
+  }
 
   // Transform chain:
   // ImagePixToVolumePix =
@@ -469,15 +817,15 @@ VTK_THREAD_RETURN_TYPE vtkPlusPasteSliceIntoVolume::InsertSliceThreadFunction( v
   //  = VolumePixFromRef * RefFromImage * ImageFromImagePix
 
   vtkSmartPointer<vtkTransform> tVolumePixFromRef = vtkSmartPointer<vtkTransform>::New();
-  tVolumePixFromRef->Translate( str->OutputVolume->GetOrigin() );
-  tVolumePixFromRef->Scale( str->OutputVolume->GetSpacing() );
+  tVolumePixFromRef->Translate( outputOrigin );
+  tVolumePixFromRef->Scale( outputSpacing );
   tVolumePixFromRef->Inverse();
 
   vtkSmartPointer<vtkTransform> tRefFromImage = vtkSmartPointer<vtkTransform>::New();
-  tRefFromImage->SetMatrix( str->TransformImageToReference );
+  tRefFromImage->SetMatrix( str.TransformImageToReference );
 
   vtkSmartPointer<vtkTransform> tImageFromImagePix = vtkSmartPointer<vtkTransform>::New();
-  tImageFromImagePix->Scale( str->InputFrameImage->GetSpacing() );
+  tImageFromImagePix->Scale( str.InputFrameImage->GetSpacing() );
 
   vtkSmartPointer<vtkTransform> tImagePixToVolumePix = vtkSmartPointer<vtkTransform>::New();
   tImagePixToVolumePix->Concatenate( tVolumePixFromRef );
@@ -487,243 +835,392 @@ VTK_THREAD_RETURN_TYPE vtkPlusPasteSliceIntoVolume::InsertSliceThreadFunction( v
   vtkSmartPointer<vtkMatrix4x4> mImagePixToVolumePix = vtkSmartPointer<vtkMatrix4x4>::New();
   tImagePixToVolumePix->GetMatrix( mImagePixToVolumePix );
 
+  // The matrix takes input indices -> output indices.
+  // Fixed-point math is used with full optimization, double otherwise.
+  for ( int i = 0; i < 4; i++ )
+  {
+    for ( int j = 0; j < 4; j++ )
+    {
+      str.MatrixDouble[( i << 2 ) + j] = mImagePixToVolumePix->GetElement( i, j );
+      str.MatrixFixed[( i << 2 ) + j] = mImagePixToVolumePix->GetElement( i, j );
+    }
+  }
 
-  // set up all the info for passing into the appropriate insertSlice function
-  vtkPlusPasteSliceIntoVolumeInsertSliceParams insertionParams;
-  insertionParams.accOverflowCount = accumulationBufferSaturationErrorsThread;
-  insertionParams.accPtr = accPtr;
-  insertionParams.importanceMask = str->ImportanceImage;
-  insertionParams.importancePtr = importancePtr;
-  insertionParams.compoundingMode = str->CompoundingMode;
-  insertionParams.clipRectangleOrigin = str->ClipRectangleOrigin;
-  insertionParams.clipRectangleSize = str->ClipRectangleSize;
-  insertionParams.fanAnglesDeg = str->FanAnglesDeg;
-  insertionParams.fanRadiusStart = str->FanRadiusStart;
-  insertionParams.fanRadiusStop = str->FanRadiusStop;
-  insertionParams.fanOrigin = str->FanOrigin;
-  insertionParams.inData = str->InputFrameImage;
-  insertionParams.inExt = inputFrameExtentForCurrentThread;
-  insertionParams.inPtr = inPtr;
-  insertionParams.interpolationMode = str->InterpolationMode;
-  insertionParams.outData = outData;
-  insertionParams.outPtr = outPtr;
-  insertionParams.pixelRejectionThreshold = str->PixelRejectionThreshold;
-  // the matrix will be set once we know more about the optimization level
+  // Range of output z indices covered by the corners of the input frame
+  str.OutputZRange[0] = VTK_DOUBLE_MAX;
+  str.OutputZRange[1] = -VTK_DOUBLE_MAX;
+  for ( int corner = 0; corner < 8; corner++ )
+  {
+    double z = str.MatrixDouble[8] * str.InputFrameExtent[( corner & 1 ) ? 1 : 0]
+               + str.MatrixDouble[9] * str.InputFrameExtent[( corner & 2 ) ? 3 : 2]
+               + str.MatrixDouble[10] * str.InputFrameExtent[( corner & 4 ) ? 5 : 4]
+               + str.MatrixDouble[11];
+    str.OutputZRange[0] = std::min( str.OutputZRange[0], z );
+    str.OutputZRange[1] = std::max( str.OutputZRange[1], z );
+  }
+
+  return PLUS_SUCCESS;
+}
 
-  if ( str->Optimization == FULL_OPTIMIZATION )
+//----------------------------------------------------------------------------
+void vtkPlusPasteSliceIntoVolume::FinalizeSliceInsertion( const std::vector<unsigned int>& accumulationBufferSaturationErrors )
+{
+  // sum up the number of accumulation buffer overflow errors of all workers
+  unsigned int sumAccOverflowErrors( 0 );
+  for ( unsigned int i = 0; i < accumulationBufferSaturationErrors.size(); i++ )
   {
-    // use fixed-point math
-    // change transform matrix so that instead of taking
-    // input coords -> output coords it takes output indices -> input indices
-    fixed newmatrix[16]; // fixed because optimization = 2
-    for ( int i = 0; i < 4; i++ )
+    sumAccOverflowErrors += accumulationBufferSaturationErrors[i];
+  }
+  if ( sumAccOverflowErrors && !EnableAccumulationBufferOverflowWarning )
+  {
+    LOG_WARNING( sumAccOverflowErrors << " voxels have had too many pixels inserted. This can result in errors in the final volume. It is recommended that the output volume resolution be increased." );
+  }
+
+  if ( this->OutputIsSparse )
+  {
+    // the dense images are updated from the sparse volume when they are requested
+    this->SparseVolume->Modified();
+  }
+  else
+  {
+    this->ReconstructedVolume->Modified();
+    this->AccumulationBuffer->Modified();
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPasteSliceIntoVolume::InsertSliceRowBlock( void* userData, int rowBlockIndex, int workerIndex )
+{
+  InsertSliceThreadFunctionInfoStruct* str = static_cast<InsertSliceThreadFunctionInfoStruct*>( userData );
+
+  // Compute what extent of the input image is processed in this block
+  int inputFrameExtentForCurrentThread[6] = { 0, -1, 0, -1, 0, -1 };
+  std::copy( str->InputFrameExtent, str->InputFrameExtent + 6, inputFrameExtentForCurrentThread );
+  int splitAxisMin = str->InputFrameExtent[str->SplitAxis * 2];
+  int numberOfRows = str->InputFrameExtent[str->SplitAxis * 2 + 1] - splitAxisMin + 1;
+  inputFrameExtentForCurrentThread[str->SplitAxis * 2] = splitAxisMin + static_cast<int>( static_cast<long long>( numberOfRows ) * rowBlockIndex / str->NumberOfRowBlocks );
+  inputFrameExtentForCurrentThread[str->SplitAxis * 2 + 1] = splitAxisMin + static_cast<int>( static_cast<long long>( numberOfRows ) * ( rowBlockIndex + 1 ) / str->NumberOfRowBlocks ) - 1;
+
+  // all voxels of the output volume may be modified
+  int* outExt = str->OutputVolume->GetExtent();
+  PasteSliceExtent( str, str->OutputVolume, str->OutPtr, str->AccPtr, inputFrameExtentForCurrentThread,
+                    &( str->AccumulationBufferSaturationErrors[workerIndex] ), 0, outExt[5] - outExt[4] );
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPasteSliceIntoVolume::InsertSlicesIntoSlab( void* userData, int slabIndex, int workerIndex )
+{
+  InsertSlicesThreadFunctionInfoStruct* batch = static_cast<InsertSlicesThreadFunctionInfoStruct*>( userData );
+
+  // Range of output z indices (relative to the output extent) that this slab contains
+  int outSlabZMin = static_cast<int>( static_cast<long long>( batch->NumberOfOutputPlanes ) * slabIndex / batch->NumberOfSlabs );
+  int outSlabZMax = static_cast<int>( static_cast<long long>( batch->NumberOfOutputPlanes ) * ( slabIndex + 1 ) / batch->NumberOfSlabs ) - 1;
+
+  for ( std::vector<InsertSliceThreadFunctionInfoStruct>::iterator sliceIt = batch->Slices.begin(); sliceIt != batch->Slices.end(); ++sliceIt )
+  {
+    // skip slices that are far from the slab
+    if ( sliceIt->OutputZRange[1] < batch->OutputZMin + outSlabZMin - SLAB_MARGIN
+         || sliceIt->OutputZRange[0] > batch->OutputZMin + outSlabZMax + SLAB_MARGIN )
     {
-      int rowindex = ( i << 2 );
-      newmatrix[rowindex  ] = mImagePixToVolumePix->GetElement( i, 0 );
-      newmatrix[rowindex + 1] = mImagePixToVolumePix->GetElement( i, 1 );
-      newmatrix[rowindex + 2] = mImagePixToVolumePix->GetElement( i, 2 );
-      newmatrix[rowindex + 3] = mImagePixToVolumePix->GetElement( i, 3 );
+      continue;
     }
-    insertionParams.matrix = newmatrix;
+    PasteSliceExtent( &( *sliceIt ), sliceIt->OutputVolume, sliceIt->OutPtr, sliceIt->AccPtr, sliceIt->InputFrameExtent,
+                      &( batch->AccumulationBufferSaturationErrors[workerIndex] ), outSlabZMin, outSlabZMax );
+  }
+}
 
-    switch ( str->InputFrameImage->GetScalarType() )
+//----------------------------------------------------------------------------
+// Computes the transform from output voxel indices to input frame pixel indices. For 2D input frames
+// the third coordinate is the signed distance from the frame plane (in voxels) instead of the frame index.
+// Returns false if the transform cannot be inverted.
+static bool GetVoxelToPixelMatrix( const InsertSliceThreadFunctionInfoStruct& str, vtkMatrix4x4* voxelToPixel )
+{
+  vtkSmartPointer<vtkMatrix4x4> pixelToVoxel = vtkSmartPointer<vtkMatrix4x4>::New();
+  pixelToVoxel->DeepCopy( str.MatrixDouble );
+  if ( str.InputFrameExtent[4] == str.InputFrameExtent[5] )
+  {
+    // the frame is a plane: replace its z axis by the unit normal of the plane and move the origin into the plane
+    double xAxis[3] = { str.MatrixDouble[0], str.MatrixDouble[4], str.MatrixDouble[8] };
+    double yAxis[3] = { str.MatrixDouble[1], str.MatrixDouble[5], str.MatrixDouble[9] };
+    double normal[3] = { 0, 0, 0 };
+    vtkMath::Cross( xAxis, yAxis, normal );
+    if ( vtkMath::Normalize( normal ) == 0.0 )
     {
-    case VTK_SHORT:
-      vtkOptimizedInsertSlice<fixed, short>( &insertionParams );
-      break;
-    case VTK_UNSIGNED_SHORT:
-      vtkOptimizedInsertSlice<fixed, unsigned short>( &insertionParams );
-      break;
-    case VTK_CHAR:
-      vtkOptimizedInsertSlice<fixed, char>( &insertionParams );
-      break;
-    case VTK_UNSIGNED_CHAR:
-      vtkOptimizedInsertSlice<fixed, unsigned char>( &insertionParams );
-      break;
-    case VTK_FLOAT:
-      vtkOptimizedInsertSlice<fixed, float>( &insertionParams );
-      break;
-    case VTK_DOUBLE:
-      vtkOptimizedInsertSlice<fixed, double>( &insertionParams );
-      break;
-    case VTK_INT:
-      vtkOptimizedInsertSlice<fixed, int>( &insertionParams );
-      break;
-    case VTK_UNSIGNED_INT:
-      vtkOptimizedInsertSlice<fixed, unsigned int>( &insertionParams );
-      break;
-    case VTK_LONG:
-      vtkOptimizedInsertSlice<fixed, long>( &insertionParams );
-      break;
-    case VTK_UNSIGNED_LONG:
-      vtkOptimizedInsertSlice<fixed, unsigned long>( &insertionParams );
-      break;
-    default:
-      LOG_ERROR( "OptimizedInsertSlice: Unknown input ScalarType" );
-      return VTK_THREAD_RETURN_VALUE;
+      return false;
+    }
+    for ( int i = 0; i < 3; i++ )
+    {
+      pixelToVoxel->SetElement( i, 2, normal[i] );
+      pixelToVoxel->SetElement( i, 3, str.MatrixDouble[( i << 2 ) + 3] + str.InputFrameExtent[4] * str.MatrixDouble[( i << 2 ) + 2] );
     }
   }
-  else
+  if ( fabs( pixelToVoxel->Determinant() ) < 1e-12 )
   {
-    // if we are not using fixed point math for optimization = 2, we are either:
-    // doing no optimization (0) OR
-    // breaking into x, y, z components with no bounds checking for nearest neighbor (1)
+    return false;
+  }
+  vtkMatrix4x4::Invert( pixelToVoxel, voxelToPixel );
+  return true;
+}
 
-    // change transform matrix so that instead of taking
-    // input coords -> output coords it takes output indices -> input indices
-    double newmatrix[16];
-    for ( int i = 0; i < 4; i++ )
+//----------------------------------------------------------------------------
+// Computes the part of the input frame (within inputFrameRegion) that may modify voxels of the volumeRegion.
+// The region is conservative (it may contain pixels that do not modify any voxel in the volume region).
+// Returns false if no pixels of the frame may modify the volume region.
+static bool GetInputFrameExtentForVolumeRegion( const InsertSliceThreadFunctionInfoStruct& str, vtkMatrix4x4* voxelToPixel,
+    const int inputFrameRegion[6], const int volumeRegion[6], int inputFrameExtent[6] )
+{
+  double pixelMin[3] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX };
+  double pixelMax[3] = { -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  for ( int corner = 0; corner < 8; corner++ )
+  {
+    double voxel[4] =
     {
-      int rowindex = ( i << 2 );
-      newmatrix[rowindex  ] = mImagePixToVolumePix->GetElement( i, 0 );
-      newmatrix[rowindex + 1] = mImagePixToVolumePix->GetElement( i, 1 );
-      newmatrix[rowindex + 2] = mImagePixToVolumePix->GetElement( i, 2 );
-      newmatrix[rowindex + 3] = mImagePixToVolumePix->GetElement( i, 3 );
+      ( corner & 1 ) ? volumeRegion[1] + SLAB_MARGIN : volumeRegion[0] - SLAB_MARGIN,
+      ( corner & 2 ) ? volumeRegion[3] + SLAB_MARGIN : volumeRegion[2] - SLAB_MARGIN,
+      ( corner & 4 ) ? volumeRegion[5] + SLAB_MARGIN : volumeRegion[4] - SLAB_MARGIN,
+      1.0
+    };
+    double pixel[4] = { 0, 0, 0, 1 };
+    voxelToPixel->MultiplyPoint( voxel, pixel );
+    for ( int i = 0; i < 3; i++ )
+    {
+      pixelMin[i] = std::min( pixelMin[i], pixel[i] );
+      pixelMax[i] = std::max( pixelMax[i], pixel[i] );
     }
-    insertionParams.matrix = newmatrix;
+  }
 
+  if ( str.InputFrameExtent[4] == str.InputFrameExtent[5] )
+  {
+    // 2D frame: the volume region must intersect the frame plane
+    if ( pixelMin[2] > 0 || pixelMax[2] < 0 )
+    {
+      return false;
+    }
+    pixelMin[2] = str.InputFrameExtent[4];
+    pixelMax[2] = str.InputFrameExtent[5];
+  }
 
-    if ( str->Optimization == PARTIAL_OPTIMIZATION )
+  for ( int i = 0; i < 3; i++ )
+  {
+    // clamp before converting to int to prevent overflow
+    inputFrameExtent[2 * i] = static_cast<int>( std::max<double>( inputFrameRegion[2 * i], floor( pixelMin[i] ) - 1 ) );
+    inputFrameExtent[2 * i + 1] = static_cast<int>( std::min<double>( inputFrameRegion[2 * i + 1], ceil( pixelMax[i] ) + 1 ) );
+    if ( inputFrameExtent[2 * i] > inputFrameExtent[2 * i + 1] )
     {
-      switch ( inData->GetScalarType() )
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Computes the clipped extent of the input frame and the extent of the output voxels that the clipped frame may
+// modify (it may exceed the volume extent by one voxel). Returns false if no pixels of the frame are pasted.
+static bool GetSliceVoxelExtent( const InsertSliceThreadFunctionInfoStruct& str, const int volumeExtent[6], int clipExtent[6], int sliceVoxelExtent[6] )
+{
+  // pixels outside the clip rectangle are not pasted
+  double inOrigin[3] = { 0, 0, 0 };
+  double inSpacing[3] = { 1, 1, 1 };
+  str.InputFrameImage->GetOrigin( inOrigin );
+  str.InputFrameImage->GetSpacing( inSpacing );
+  GetClipExtent( clipExtent, inOrigin, inSpacing, str.InputFrameExtent, str.ClipRectangleOrigin, str.ClipRectangleSize );
+  if ( clipExtent[0] > clipExtent[1] || clipExtent[2] > clipExtent[3] || clipExtent[4] > clipExtent[5] )
+  {
+    return false;
+  }
+
+  // bounding box of the clipped slice in the output volume
+  double voxelMin[3] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX };
+  double voxelMax[3] = { -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  for ( int corner = 0; corner < 8; corner++ )
+  {
+    for ( int i = 0; i < 3; i++ )
+    {
+      double voxel = str.MatrixDouble[( i << 2 )] * clipExtent[( corner & 1 ) ? 1 : 0]
+                     + str.MatrixDouble[( i << 2 ) + 1] * clipExtent[( corner & 2 ) ? 3 : 2]
+                     + str.MatrixDouble[( i << 2 ) + 2] * clipExtent[( corner & 4 ) ? 5 : 4]
+                     + str.MatrixDouble[( i << 2 ) + 3];
+      voxelMin[i] = std::min( voxelMin[i], voxel );
+      voxelMax[i] = std::max( voxelMax[i], voxel );
+    }
+  }
+  for ( int i = 0; i < 3; i++ )
+  {
+    // clamp before converting to int to prevent overflow
+    sliceVoxelExtent[2 * i] = static_cast<int>( std::max<double>( volumeExtent[2 * i] - 1, floor( voxelMin[i] - SLAB_MARGIN ) ) );
+    sliceVoxelExtent[2 * i + 1] = static_cast<int>( std::min<double>( volumeExtent[2 * i + 1] + 1, ceil( voxelMax[i] + SLAB_MARGIN ) ) );
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPasteSliceIntoVolume::MarkModifiedBricks( const InsertSliceThreadFunctionInfoStruct& str )
+{
+  int clipExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  int sliceVoxelExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  int brickRange[6] = { 0, -1, 0, -1, 0, -1 };
+  if ( !GetSliceVoxelExtent( str, this->SparseVolume->GetExtent(), clipExtent, sliceVoxelExtent )
+       || !this->SparseVolume->GetBrickRange( sliceVoxelExtent, brickRange ) )
+  {
+    // no voxels are modified
+    return;
+  }
+  for ( int brickK = brickRange[4]; brickK <= brickRange[5]; ++brickK )
+  {
+    for ( int brickJ = brickRange[2]; brickJ <= brickRange[3]; ++brickJ )
+    {
+      for ( int brickI = brickRange[0]; brickI <= brickRange[1]; ++brickI )
       {
-      case VTK_SHORT:
-        vtkOptimizedInsertSlice<double, short>( &insertionParams );
-        break;
-      case VTK_UNSIGNED_SHORT:
-        vtkOptimizedInsertSlice<double, unsigned short>( &insertionParams );
-        break;
-      case VTK_CHAR:
-        vtkOptimizedInsertSlice<double, char>( &insertionParams );
-        break;
-      case VTK_UNSIGNED_CHAR:
-        vtkOptimizedInsertSlice<double, unsigned char>( &insertionParams );
-        break;
-      case VTK_FLOAT:
-        vtkOptimizedInsertSlice<double, float>( &insertionParams );
-        break;
-      case VTK_DOUBLE:
-        vtkOptimizedInsertSlice<double, double>( &insertionParams );
-        break;
-      case VTK_INT:
-        vtkOptimizedInsertSlice<double, int>( &insertionParams );
-        break;
-      case VTK_UNSIGNED_INT:
-        vtkOptimizedInsertSlice<double, unsigned int>( &insertionParams );
-        break;
-      case VTK_LONG:
-        vtkOptimizedInsertSlice<double, long>( &insertionParams );
-        break;
-      case VTK_UNSIGNED_LONG:
-        vtkOptimizedInsertSlice<double, unsigned long>( &insertionParams );
-        break;
-      default:
-        LOG_ERROR( "OptimizedInsertSlice: Unknown input ScalarType" );
+        this->ModifiedBricks.insert( this->SparseVolume->GetBrickIndex( brickI, brickJ, brickK ) );
       }
     }
-    else
+  }
+}
+
+//----------------------------------------------------------------------------
+// The halo voxels of a brick are updated together with the voxels of the brick, but their values are ignored: the same voxels
+// are updated in the bricks that they belong to. Accumulation buffer overflow is only counted for voxels that have not
+// exceeded the threshold yet, so setting the accumulation buffer of the halo to the maximum makes sure that the overflow
+// of each voxel is counted only once, in its own brick.
+static void SaturateBrickHaloAccumulationBuffer( vtkPlusSparseVolume* sparseVolume, int brickIndex )
+{
+  int brickExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  int storageExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  sparseVolume->GetBrickExtent( brickIndex, brickExtent );
+  sparseVolume->GetBrickStorageExtent( brickIndex, storageExtent );
+  unsigned short* accPtr = static_cast<unsigned short*>( sparseVolume->GetBrickAccumulationBuffer( brickIndex )->GetScalarPointer() );
+  for ( int k = storageExtent[4]; k <= storageExtent[5]; ++k )
+  {
+    bool haloK = ( k < brickExtent[4] || k > brickExtent[5] );
+    for ( int j = storageExtent[2]; j <= storageExtent[3]; ++j )
     {
-      // no optimization
-      switch ( inData->GetScalarType() )
+      bool haloJK = haloK || j < brickExtent[2] || j > brickExtent[3];
+      for ( int i = storageExtent[0]; i <= storageExtent[1]; ++i, ++accPtr )
       {
-      case VTK_SHORT:
-        vtkUnoptimizedInsertSlice<double, short>( &insertionParams );
-        break;
-      case VTK_UNSIGNED_SHORT:
-        vtkUnoptimizedInsertSlice<double, unsigned short>( &insertionParams );
-        break;
-      case VTK_CHAR:
-        vtkUnoptimizedInsertSlice<double, char>( &insertionParams );
-        break;
-      case VTK_UNSIGNED_CHAR:
-        vtkUnoptimizedInsertSlice<double, unsigned char>( &insertionParams );
-        break;
-      case VTK_FLOAT:
-        vtkUnoptimizedInsertSlice<double, float>( &insertionParams );
-        break;
-      case VTK_DOUBLE:
-        vtkUnoptimizedInsertSlice<double, double>( &insertionParams );
-        break;
-      case VTK_INT:
-        vtkUnoptimizedInsertSlice<double, int>( &insertionParams );
-        break;
-      case VTK_UNSIGNED_INT:
-        vtkUnoptimizedInsertSlice<double, unsigned int>( &insertionParams );
-        break;
-      case VTK_LONG:
-        vtkUnoptimizedInsertSlice<double, long>( &insertionParams );
-        break;
-      case VTK_UNSIGNED_LONG:
-        vtkUnoptimizedInsertSlice<double, unsigned long>( &insertionParams );
-        break;
-      default:
-        LOG_ERROR( "UnoptimizedInsertSlice: Unknown input ScalarType" );
+        if ( haloJK || i < brickExtent[0] || i > brickExtent[1] )
+        {
+          *accPtr = ACCUMULATION_MAXIMUM;
+        }
       }
     }
   }
-
-  return VTK_THREAD_RETURN_VALUE;
 }
 
 //----------------------------------------------------------------------------
-// For streaming and threads.  Splits output update extent into num pieces.
-// This method needs to be called num times.  Results must not overlap for
-// consistent starting extent.  Subclass can override this method.
-// This method returns the number of pieces resulting from a successful split.
-// This can be from 1 to "requestedNumberOfThreads".
-// If 1 is returned, the extent cannot be split.
-int vtkPlusPasteSliceIntoVolume::SplitSliceExtent( int splitExt[6], int fullExt[6], int threadId, int requestedNumberOfThreads )
-{
-
-  int min, max; // the min and max indices of the axis of interest
-
-  LOG_TRACE( "SplitSliceExtent: ( " << fullExt[0] << ", "
-             << fullExt[1] << ", "
-             << fullExt[2] << ", " << fullExt[3] << ", "
-             << fullExt[4] << ", " << fullExt[5] << "), "
-             << threadId << " of " << requestedNumberOfThreads );
-
-  // start with same extent
-  memcpy( splitExt, fullExt, 6 * sizeof( int ) );
-
-  // determine which axis we should split along - preference is z, then y, then x
-  // as long as we can possibly split along that axis (i.e. as long as z0 != z1)
-  int splitAxis = 2; // the axis we should split along, try with z first
-  min = fullExt[4];
-  max = fullExt[5];
-  while ( min == max )
-  {
-    --splitAxis;
-    // we cannot split if the input extent is something like [50, 50, 100, 100, 0, 0]!
-    if ( splitAxis < 0 )
+// Only the bricks of the sparse volume that the slices may modify are allocated. Each brick stores a one voxel
+// wide halo, which contains all the voxels that a pixel may modify together with a voxel of the brick, therefore
+// the bricks can be pasted independently and the voxels of the bricks are the same as in a dense volume.
+PlusStatus vtkPlusPasteSliceIntoVolume::InsertSlicesIntoSparseVolume( std::vector<InsertSliceThreadFunctionInfoStruct>& slices )
+{
+  InsertSlicesIntoBricksThreadFunctionInfoStruct batch;
+  batch.Slices = &slices;
+  batch.SparseVolume = this->SparseVolume;
+
+  // Find the bricks that the slices may modify and the part of each slice that is pasted into them
+  std::map<int, unsigned int> brickListIndices; // brick index -> index in batch.BrickIndices
+  vtkSmartPointer<vtkMatrix4x4> voxelToPixel = vtkSmartPointer<vtkMatrix4x4>::New();
+  int* volumeExtent = this->SparseVolume->GetExtent();
+  for ( unsigned int sliceIndex = 0; sliceIndex < slices.size(); ++sliceIndex )
+  {
+    InsertSliceThreadFunctionInfoStruct& str = slices[sliceIndex];
+
+    int clipExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    int sliceVoxelExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    if ( !GetSliceVoxelExtent( str, volumeExtent, clipExtent, sliceVoxelExtent ) )
     {
-      LOG_DEBUG( "Cannot split the extent to multiple threads" );
-      return 1;
+      continue;
+    }
+    int brickRange[6] = { 0, -1, 0, -1, 0, -1 };
+    if ( !this->SparseVolume->GetBrickRange( sliceVoxelExtent, brickRange ) )
+    {
+      // the slice is outside the volume
+      continue;
+    }
+
+    bool voxelToPixelValid = GetVoxelToPixelMatrix( str, voxelToPixel );
+    for ( int brickK = brickRange[4]; brickK <= brickRange[5]; ++brickK )
+    {
+      for ( int brickJ = brickRange[2]; brickJ <= brickRange[3]; ++brickJ )
+      {
+        for ( int brickI = brickRange[0]; brickI <= brickRange[1]; ++brickI )
+        {
+          int brickIndex = this->SparseVolume->GetBrickIndex( brickI, brickJ, brickK );
+          InsertSlicesIntoBricksThreadFunctionInfoStruct::SliceRegion region;
+          region.SliceIndex = sliceIndex;
+          if ( voxelToPixelValid )
+          {
+            int storageExtent[6] = { 0, -1, 0, -1, 0, -1 };
+            this->SparseVolume->GetBrickStorageExtent( brickIndex, storageExtent );
+            if ( !GetInputFrameExtentForVolumeRegion( str, voxelToPixel, clipExtent, storageExtent, region.InputFrameExtent ) )
+            {
+              continue;
+            }
+          }
+          else
+          {
+            // degenerate slice transform, consider all pixels
+            std::copy( clipExtent, clipExtent + 6, region.InputFrameExtent );
+          }
+
+          std::map<int, unsigned int>::iterator brickListIndexIt = brickListIndices.find( brickIndex );
+          if ( brickListIndexIt == brickListIndices.end() )
+          {
+            bool newBrick = !this->SparseVolume->IsBrickAllocated( brickIndex );
+            if ( this->SparseVolume->AllocateBrick( brickIndex ) != PLUS_SUCCESS )
+            {
+              LOG_ERROR( "InsertSlices: failed to allocate memory for the sparse output volume" );
+              return PLUS_FAIL;
+            }
+            if ( newBrick )
+            {
+              SaturateBrickHaloAccumulationBuffer( this->SparseVolume, brickIndex );
+            }
+            brickListIndexIt = brickListIndices.insert( std::make_pair( brickIndex, static_cast<unsigned int>( batch.BrickIndices.size() ) ) ).first;
+            this->ModifiedBricks.insert( brickIndex );
+            batch.BrickIndices.push_back( brickIndex );
+            batch.BrickSliceRegions.push_back( std::vector<InsertSlicesIntoBricksThreadFunctionInfoStruct::SliceRegion>() );
+          }
+          batch.BrickSliceRegions[brickListIndexIt->second].push_back( region );
+        }
+      }
     }
-    min = fullExt[splitAxis * 2];
-    max = fullExt[splitAxis * 2 + 1];
   }
 
-  // determine the actual number of pieces that will be generated
-  int range = max - min + 1;
-  // split the range over the maximum number of threads
-  int valuesPerThread = ( int )ceil( range / ( double )requestedNumberOfThreads );
-  // figure out the largest thread id used
-  int maxThreadIdUsed = ( int )ceil( range / ( double )valuesPerThread ) - 1;
-  // if we are in a thread that will work on part of the extent, then figure
-  // out the range that this thread should work on
-  if ( threadId < maxThreadIdUsed )
+  // Each brick is updated by one thread, threads that are done with their own bricks take over bricks from the other threads
+  this->ThreadPool->SetNumberOfThreads( this->NumberOfThreads );
+  int numberOfWorkers = this->ThreadPool->GetNumberOfWorkers();
+  batch.AccumulationBufferSaturationErrors.assign( numberOfWorkers, 0 );
+
+  if ( !batch.BrickIndices.empty() )
   {
-    splitExt[splitAxis * 2] = splitExt[splitAxis * 2] + threadId * valuesPerThread;
-    splitExt[splitAxis * 2 + 1] = splitExt[splitAxis * 2] + valuesPerThread - 1;
+    this->ThreadPool->Execute( InsertSlicesIntoBrick, &batch, static_cast<int>( batch.BrickIndices.size() ) );
   }
-  if ( threadId == maxThreadIdUsed )
+
+  this->FinalizeSliceInsertion( batch.AccumulationBufferSaturationErrors );
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPasteSliceIntoVolume::InsertSlicesIntoBrick( void* userData, int brickListIndex, int workerIndex )
+{
+  InsertSlicesIntoBricksThreadFunctionInfoStruct* batch = static_cast<InsertSlicesIntoBricksThreadFunctionInfoStruct*>( userData );
+
+  // The brick contains its voxels and the halo around them, all of them are updated but only the voxels of the brick are used
+  // (accumulation buffer overflow is not counted in the halo, see SaturateBrickHaloAccumulationBuffer)
+  int brickIndex = batch->BrickIndices[brickListIndex];
+  vtkImageData* brickVolume = batch->SparseVolume->GetBrickVolume( brickIndex );
+  vtkImageData* brickAccumulationBuffer = batch->SparseVolume->GetBrickAccumulationBuffer( brickIndex );
+  int* brickExtent = brickVolume->GetExtent();
+  void* outPtr = brickVolume->GetScalarPointerForExtent( brickExtent );
+  unsigned short* accPtr = static_cast<unsigned short*>( brickAccumulationBuffer->GetScalarPointerForExtent( brickExtent ) );
+
+  std::vector<InsertSlicesIntoBricksThreadFunctionInfoStruct::SliceRegion>& regions = batch->BrickSliceRegions[brickListIndex];
+  for ( std::vector<InsertSlicesIntoBricksThreadFunctionInfoStruct::SliceRegion>::iterator regionIt = regions.begin(); regionIt != regions.end(); ++regionIt )
   {
-    splitExt[splitAxis * 2] = splitExt[splitAxis * 2] + threadId * valuesPerThread;
+    PasteSliceExtent( &( ( *batch->Slices )[regionIt->SliceIndex] ), brickVolume, outPtr, accPtr, regionIt->InputFrameExtent,
+                      &( batch->AccumulationBufferSaturationErrors[workerIndex] ), 0, brickExtent[5] - brickExtent[4] );
   }
-
-  // return the number of threads used
-  return maxThreadIdUsed + 1;
 }
 
 //****************************************************************************
@@ -45,11 +45,16 @@ POSSIBILITY OF SUCH DAMAGES.
 
 #include "vtkPlusVolumeReconstructionExport.h"
 
+#include <set>
+#include <vector>
+
 class PlusTrackedFrame;
 class vtkImageData;
 class vtkMatrix4x4;
 class vtkXMLDataElement;
-class vtkMultiThreader;
+class vtkPlusSparseVolume;
+class vtkPlusThreadPool;
+struct InsertSliceThreadFunctionInfoStruct;
 
 /*!
   \class vtkPlusPasteSliceIntoVolume
@@ -152,11 +157,26 @@ public:
   */
   virtual PlusStatus InsertSlice(vtkImageData *image, vtkMatrix4x4* mImageToReference);
 
+  /*!
+    Insert multiple slices into the reconstructed volume
+    The result is exactly the same as inserting the slices one by one, in the same order, using InsertSlice
+    with one thread. The slices are pasted concurrently: the output volume is split into slabs along the z axis
+    and each thread pastes all the slices into its own slab. This is much faster than pasting the slices one
+    by one if there are many small slices.
+    Concurrent pasting is supported with LATEST, MAXIMUM, and MEAN compounding with PARTIAL_OPTIMIZATION or
+    FULL_OPTIMIZATION, in other cases the slices are inserted one by one. With sparse output the slices
+    are always pasted concurrently, each thread pastes the slices into a different set of bricks.
+    If any of the slices cannot be inserted (e.g., because of invalid pixel type) then none of them is inserted.
+  */
+  virtual PlusStatus InsertSlices(const std::vector<vtkImageData*>& images, const std::vector<vtkMatrix4x4*>& mImageToReference);
+
   /*!
     Get the output reconstructed 3D ultrasound volume
     (the output is the reconstruction volume, the second component
     is the alpha component that stores whether or not a voxel has
     been touched by the reconstruction)
+    With sparse output the dense volume is created from the bricks when it is requested,
+    which needs memory for the whole output extent.
   */
   virtual vtkImageData *GetReconstructedVolume();
 
@@ -164,9 +184,35 @@ public:
     Get the accumulation buffer
     Accumulation buffer is for compounding, there is a voxel in
     the accumulation buffer for each voxel in the output.
+    With sparse output the dense accumulation buffer is created from the bricks when it is requested.
   */
   virtual vtkImageData *GetAccumulationBuffer();
 
+  /*!
+    Get the sparse output volume. It contains the reconstructed volume and accumulation buffer
+    if SparseOutput was enabled when the output was reset. With dense output no bricks are allocated
+    but the brick grid is defined, it specifies the bricks that GetModifiedBricks refers to.
+  */
+  vtkGetObjectMacro(SparseVolume, vtkPlusSparseVolume);
+
+  /*!
+    Get the indices of the bricks (see vtkPlusSparseVolume) that slices were pasted into since the last ClearModifiedBricks call.
+    Returns false if the output was reset since then, in which case all voxels of the output have to be considered modified.
+  */
+  bool GetModifiedBricks(std::vector<int>& brickIndices);
+
+  /*! Start a new period of keeping track of the modified bricks (e.g., after the output has been processed) */
+  void ClearModifiedBricks();
+
+  /*! Returns true if the current output is stored in the sparse volume (SparseOutput was enabled at the last ResetOutput) */
+  vtkGetMacro(OutputIsSparse, bool);
+
+  /*!
+    Memory used by the reconstructed volume and accumulation buffer, in kibibytes.
+    With sparse output only the memory of the allocated bricks is included.
+  */
+  unsigned long GetOutputMemorySize();
+
   /*! Creates the and clears all necessary image buffers */
   virtual PlusStatus ResetOutput();
 
@@ -255,8 +301,9 @@ public:
     PARTIAL_OPTIMIZATION: break transformation into x, y and z components, and
       don't do bounds checking for nearest-neighbor interpolation
     FULL_OPTIMIZATION: fixed-point (i.e. integer) math is used instead of float math,
-      it is only useful with NEAREST_NEIGHBOR interpolation
-      (when used with LINEAR interpolation then it is slower than NO_OPTIMIZATION)
+      it is mainly useful with NEAREST_NEIGHBOR interpolation
+      (when used with LINEAR interpolation then it is slower than NO_OPTIMIZATION, except for
+      MEAN compounding of 8-bit single-component images if SIMD instructions are enabled)
   */
   vtkSetMacro(Optimization,OptimizationType);
   /*! Get the current optimization method */
@@ -306,6 +353,30 @@ public:
   /*! Get number of threads used for processing the data */
   vtkGetMacro(NumberOfThreads,int);
 
+  /*!
+    Enable use of SIMD (AVX2) instructions, if they are supported by the CPU.
+    Currently used for LINEAR interpolation with MEAN compounding and FULL_OPTIMIZATION,
+    if the input frames are 8-bit single-component images. The result is exactly the same
+    as without SIMD instructions. Enabled by default.
+  */
+  vtkSetMacro(SimdEnabled,bool);
+  /*! Get if SIMD instructions may be used */
+  vtkGetMacro(SimdEnabled,bool);
+  vtkBooleanMacro(SimdEnabled,bool);
+
+  /*!
+    Store the output in a sparse volume (see vtkPlusSparseVolume): memory is only allocated for the bricks
+    of the output extent that slices are pasted into. Recommended if the output extent is large but mostly
+    empty, e.g., for long or curved sweeps. The reconstructed volume is the same as with dense storage, except
+    for NEAREST_NEIGHBOR interpolation with IMPORTANCE_MASK compounding, where pixels with zero importance
+    may cause skipping of other pixels of the same row (depending on where the row is split between bricks).
+    Applied when the output is reset (ResetOutput). Disabled by default.
+  */
+  vtkSetMacro(SparseOutput,bool);
+  /*! Get if the output is stored in a sparse volume */
+  vtkGetMacro(SparseOutput,bool);
+  vtkBooleanMacro(SparseOutput,bool);
+
   /*! DEPRECATED - use CompoundingMode instead! */
   vtkSetMacro(Compounding,int);
   /*! DEPRECATED - use CompoundingMode instead! */
@@ -332,20 +403,42 @@ protected:
   vtkPlusPasteSliceIntoVolume();
   ~vtkPlusPasteSliceIntoVolume();
 
-  /*! Thread function that actually performs the pasting of frame pixels into the volume */
-  static VTK_THREAD_RETURN_TYPE InsertSliceThreadFunction( void *arg );
-  
-  /*!
-    To split the extent over many threads
-    Input: the full extent (fullExt), current thread index (threadId), total number of threads (requestedNumberOfThreads)
-    Output: the split extent for the selected thread, number of threads to be used (return value)
-  */
-  static int SplitSliceExtent(int splitExt[6], int fullExt[6], int threadId, int requestedNumberOfThreads);
+  /*! Check the inputs and compute the image to volume transform of a slice */
+  PlusStatus InitializeSliceInsertion(vtkImageData* image, vtkMatrix4x4* mImageToReference, InsertSliceThreadFunctionInfoStruct& str);
+
+  /*! Report accumulation buffer overflow and mark the output as modified */
+  void FinalizeSliceInsertion(const std::vector<unsigned int>& accumulationBufferSaturationErrors);
+
+  /*! Thread pool loop body that actually performs the pasting of a block of frame rows into the volume */
+  static void InsertSliceRowBlock( void* userData, int rowBlockIndex, int workerIndex );
+
+  /*! Thread pool loop body that pastes all slices of a batch into a slab of the volume */
+  static void InsertSlicesIntoSlab( void* userData, int slabIndex, int workerIndex );
+
+  /*! Paste initialized slices into the sparse volume. The bricks that the slices intersect are allocated and pasted concurrently. */
+  PlusStatus InsertSlicesIntoSparseVolume(std::vector<InsertSliceThreadFunctionInfoStruct>& slices);
+
+  /*! Thread pool loop body that pastes all slices of a batch into a brick of the sparse volume */
+  static void InsertSlicesIntoBrick( void* userData, int brickListIndex, int workerIndex );
+
+  /*! Add the bricks that an initialized slice may modify to the set of modified bricks */
+  void MarkModifiedBricks(const InsertSliceThreadFunctionInfoStruct& str);
 
   vtkImageData *ReconstructedVolume;
   vtkImageData *AccumulationBuffer;
   vtkImageData *ImportanceMask;
 
+  // Sparse output. If OutputIsSparse is true then ReconstructedVolume and AccumulationBuffer
+  // are only updated from SparseVolume when they are requested.
+  vtkPlusSparseVolume *SparseVolume;
+  bool SparseOutput;
+  bool OutputIsSparse;
+
+  // Bricks that slices were pasted into since the last ClearModifiedBricks call.
+  // AllBricksModified is set when the output is reset.
+  std::set<int> ModifiedBricks;
+  bool AllBricksModified;
+
   // Output image position and size
   double OutputOrigin[3];
   double OutputSpacing[3];
@@ -368,9 +461,11 @@ protected:
   int Compounding;
   CalculationTypeDeprecated Calculation;
 
-  // Multithreading
-  vtkMultiThreader *Threader;
+  // Multithreading. The worker threads are created once and reused for all inserted slices.
+  vtkPlusThreadPool *ThreadPool;
   int NumberOfThreads;
+
+  bool SimdEnabled;
   
   double PixelRejectionThreshold;
   
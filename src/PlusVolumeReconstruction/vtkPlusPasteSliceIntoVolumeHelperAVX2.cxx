@@ -0,0 +1,230 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "vtkPlusPasteSliceIntoVolumeHelperAVX2.h"
+
+#ifdef PLUS_X86_SIMD
+
+#include <immintrin.h>
+
+namespace
+{
+  // Fixed-point number format of FULL_OPTIMIZATION (see fixed.h)
+  const int FIXED_POINT = 14;
+  const int FIXED_ONE = 1 << FIXED_POINT;
+  const int FIXED_HALF = 1 << (FIXED_POINT - 1);
+  // Adding this number to a double rounds it to the fixed-point precision, the fixed-point
+  // value is in the low 32 bits of the sum (see fixed::from_float)
+  const double FIXED_FROM_FLOAT_MAGIC = 412316860416.0;
+
+  // Accumulation buffer constants (see vtkPlusPasteSliceIntoVolumeHelperCommon.h)
+  const int ACCUMULATION_MULTIPLIER_BITS = 8; // ACCUMULATION_MULTIPLIER = 256
+  const int ACCUMULATION_MAXIMUM_VALUE = 65535;
+  const int ACCUMULATION_THRESHOLD_VALUE = 65279;
+
+  const int PIXELS_PER_BLOCK = 8;
+
+  //----------------------------------------------------------------------------
+  // Same as fixed::operator*: (x*y + 0.5) >> point
+  PLUS_SIMD_TARGET("avx2")
+  inline __m256i FixedMultiply(__m256i x, __m256i y)
+  {
+    return _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(x, y), _mm256_set1_epi32(FIXED_HALF)), FIXED_POINT);
+  }
+
+  //----------------------------------------------------------------------------
+  // Same as fixed::operator/: from_float(double(x)/y)
+  PLUS_SIMD_TARGET("avx2")
+  inline __m256i FixedDivide(__m256i x, __m256i y)
+  {
+    const __m256d magic = _mm256_set1_pd(FIXED_FROM_FLOAT_MAGIC);
+    const __m256i lowDwords = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    __m256d quotientLow = _mm256_add_pd(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x)),
+                                                      _mm256_cvtepi32_pd(_mm256_castsi256_si128(y))), magic);
+    __m256d quotientHigh = _mm256_add_pd(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)),
+                                                       _mm256_cvtepi32_pd(_mm256_extracti128_si256(y, 1))), magic);
+    __m256i resultLow = _mm256_permutevar8x32_epi32(_mm256_castpd_si256(quotientLow), lowDwords);
+    __m256i resultHigh = _mm256_permutevar8x32_epi32(_mm256_castpd_si256(quotientHigh), lowDwords);
+    return _mm256_permute2x128_si256(resultLow, resultHigh, 0x20);
+  }
+
+  //----------------------------------------------------------------------------
+  // Same as PlusMath::Round for a non-negative fixed-point value
+  PLUS_SIMD_TARGET("avx2")
+  inline __m256i FixedRound(__m256i x)
+  {
+    return _mm256_srai_epi32(_mm256_add_epi32(x, _mm256_set1_epi32(FIXED_HALF)), FIXED_POINT);
+  }
+
+  //----------------------------------------------------------------------------
+  inline unsigned int CountBits(int bits)
+  {
+    unsigned int count = 0;
+    for (; bits != 0; bits &= bits - 1)
+    {
+      ++count;
+    }
+    return count;
+  }
+}
+
+//----------------------------------------------------------------------------
+PLUS_SIMD_TARGET("avx2")
+void vtkTrilinearInterpolationMeanRowAVX2(int xIntersectionPixStart, int xIntersectionPixEnd,
+                                          const int outPoint1[3], const int xAxis[3],
+                                          const unsigned char* inPtr, unsigned char* outPtr, unsigned short* accPtr,
+                                          const int outExt[6], const vtkIdType outInc[3], unsigned int* accOverflowCount,
+                                          bool pixelRejectionEnabled, double pixelRejectionThreshold,
+                                          int outSlabZMin, int outSlabZMax)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i allOnes = _mm256_set1_epi32(-1);
+  const __m256i fractionMask = _mm256_set1_epi32(FIXED_ONE - 1);
+  const __m256i pixelOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i outMaxIdX = _mm256_set1_epi32(outExt[1] - outExt[0]);
+  const __m256i outMaxIdY = _mm256_set1_epi32(outExt[3] - outExt[2]);
+  const __m256i outMaxIdZ = _mm256_set1_epi32(outExt[5] - outExt[4]);
+  const __m256i outMinX = _mm256_set1_epi32(outExt[0]);
+  const __m256i outMinY = _mm256_set1_epi32(outExt[2]);
+  const __m256i outMinZ = _mm256_set1_epi32(outExt[4]);
+
+  // Each lane of a corner vector corresponds to one of the 8 voxels around a pixel, in the same order as in
+  // vtkTrilinearInterpolationInSlab: bit 2 of the lane index selects the x+1, bit 1 the y+1, bit 0 the z+1 voxel
+  const __m256i cornerX1 = _mm256_setr_epi32(0, 0, 0, 0, -1, -1, -1, -1);
+  const __m256i cornerY1 = _mm256_setr_epi32(0, 0, -1, -1, 0, 0, -1, -1);
+  const __m256i cornerZ1 = _mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+  const __m256i slabZMin = _mm256_set1_epi32(outSlabZMin);
+  const __m256i slabZMax = _mm256_set1_epi32(outSlabZMax);
+
+  const __m256i accThresholdFixed = _mm256_set1_epi32(ACCUMULATION_THRESHOLD_VALUE << FIXED_POINT);
+  const __m256i accThreshold = _mm256_set1_epi32(ACCUMULATION_THRESHOLD_VALUE);
+  const __m256i accMaximumFixedMinusOne = _mm256_set1_epi32((ACCUMULATION_MAXIMUM_VALUE << FIXED_POINT) - 1);
+  const __m256i accMaximum = _mm256_set1_epi32(ACCUMULATION_MAXIMUM_VALUE);
+  const __m256i one = _mm256_set1_epi32(1);
+
+  // the caller guarantees that the offsets of the corner voxels fit into int
+  const int outIncX = static_cast<int>(outInc[0]);
+  const int outIncY = static_cast<int>(outInc[1]);
+  const int outIncZ = static_cast<int>(outInc[2]);
+
+  int outIdX0[PIXELS_PER_BLOCK], outIdY0[PIXELS_PER_BLOCK], outIdZ0[PIXELS_PER_BLOCK];
+  int fx[PIXELS_PER_BLOCK], fy[PIXELS_PER_BLOCK], fz[PIXELS_PER_BLOCK];
+  int cornerOffsets[8], outValues[8], accValues[8], newOutValues[8], newAccValues[8];
+
+  for (int blockStart = xIntersectionPixStart; blockStart <= xIntersectionPixEnd; blockStart += PIXELS_PER_BLOCK)
+  {
+    const int blockSize = (xIntersectionPixEnd - blockStart + 1 < PIXELS_PER_BLOCK) ? xIntersectionPixEnd - blockStart + 1 : PIXELS_PER_BLOCK;
+
+    // output positions of the pixels, with the same integer arithmetic as outPoint1 + idX*xAxis of fixed
+    __m256i idX = _mm256_add_epi32(_mm256_set1_epi32(blockStart), pixelOffsets);
+    __m256i pointX = _mm256_add_epi32(_mm256_set1_epi32(outPoint1[0]), _mm256_mullo_epi32(idX, _mm256_set1_epi32(xAxis[0])));
+    __m256i pointY = _mm256_add_epi32(_mm256_set1_epi32(outPoint1[1]), _mm256_mullo_epi32(idX, _mm256_set1_epi32(xAxis[1])));
+    __m256i pointZ = _mm256_add_epi32(_mm256_set1_epi32(outPoint1[2]), _mm256_mullo_epi32(idX, _mm256_set1_epi32(xAxis[2])));
+
+    // integer (floor, relative to the first voxel of the output extent) and fractional components
+    __m256i idX0 = _mm256_sub_epi32(_mm256_srai_epi32(pointX, FIXED_POINT), outMinX);
+    __m256i idY0 = _mm256_sub_epi32(_mm256_srai_epi32(pointY, FIXED_POINT), outMinY);
+    __m256i idZ0 = _mm256_sub_epi32(_mm256_srai_epi32(pointZ, FIXED_POINT), outMinZ);
+    __m256i fractionX = _mm256_and_si256(pointX, fractionMask);
+    __m256i fractionY = _mm256_and_si256(pointY, fractionMask);
+    __m256i fractionZ = _mm256_and_si256(pointZ, fractionMask);
+
+    // ceiling: the integer component is incremented if the fraction is not zero
+    __m256i idX1 = _mm256_sub_epi32(idX0, _mm256_xor_si256(_mm256_cmpeq_epi32(fractionX, zero), allOnes));
+    __m256i idY1 = _mm256_sub_epi32(idY0, _mm256_xor_si256(_mm256_cmpeq_epi32(fractionY, zero), allOnes));
+    __m256i idZ1 = _mm256_sub_epi32(idZ0, _mm256_xor_si256(_mm256_cmpeq_epi32(fractionZ, zero), allOnes));
+
+    // bounds check: the sign bit is set if any of the voxels is outside the output extent
+    __m256i outOfBounds = _mm256_or_si256(_mm256_or_si256(idX0, _mm256_sub_epi32(outMaxIdX, idX1)),
+                                          _mm256_or_si256(_mm256_or_si256(idY0, _mm256_sub_epi32(outMaxIdY, idY1)),
+                                                          _mm256_or_si256(idZ0, _mm256_sub_epi32(outMaxIdZ, idZ1))));
+    int outOfBoundsPixels = _mm256_movemask_ps(_mm256_castsi256_ps(outOfBounds));
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(outIdX0), idX0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(outIdY0), idY0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(outIdZ0), idZ0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(fx), fractionX);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(fy), fractionY);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(fz), fractionZ);
+
+    // the pixels must be pasted in order, because neighbor pixels may update the same voxels
+    for (int pixel = 0; pixel < blockSize; ++pixel)
+    {
+      const unsigned char inValue = inPtr[blockStart - xIntersectionPixStart + pixel];
+      if (pixelRejectionEnabled && inValue < pixelRejectionThreshold)
+      {
+        // too dark, skip this pixel
+        continue;
+      }
+      if (outOfBoundsPixels & (1 << pixel))
+      {
+        continue;
+      }
+
+      // trilinear weights of the 8 voxels
+      __m256i weightX = _mm256_blendv_epi8(_mm256_set1_epi32(FIXED_ONE - fx[pixel]), _mm256_set1_epi32(fx[pixel]), cornerX1);
+      __m256i weightY = _mm256_blendv_epi8(_mm256_set1_epi32(FIXED_ONE - fy[pixel]), _mm256_set1_epi32(fy[pixel]), cornerY1);
+      __m256i weightZ = _mm256_blendv_epi8(_mm256_set1_epi32(FIXED_ONE - fz[pixel]), _mm256_set1_epi32(fz[pixel]), cornerZ1);
+      __m256i weight = FixedMultiply(weightX, FixedMultiply(weightY, weightZ));
+
+      // voxels with zero weight and voxels outside the slab are not modified
+      __m256i cornerZ = _mm256_add_epi32(_mm256_set1_epi32(outIdZ0[pixel]), _mm256_and_si256(cornerZ1, _mm256_set1_epi32(fz[pixel] != 0 ? 1 : 0)));
+      __m256i skippedCorners = _mm256_or_si256(_mm256_cmpeq_epi32(weight, zero),
+                                               _mm256_or_si256(_mm256_cmpgt_epi32(slabZMin, cornerZ), _mm256_cmpgt_epi32(cornerZ, slabZMax)));
+      int activeCorners = ~_mm256_movemask_ps(_mm256_castsi256_ps(skippedCorners)) & 0xFF;
+      if (activeCorners == 0)
+      {
+        continue;
+      }
+
+      // offsets of the voxels from the voxel at the integer position (voxels with zero fraction have zero weight)
+      __m256i offsets = _mm256_add_epi32(_mm256_and_si256(cornerX1, _mm256_set1_epi32(fx[pixel] != 0 ? outIncX : 0)),
+                                         _mm256_add_epi32(_mm256_and_si256(cornerY1, _mm256_set1_epi32(fy[pixel] != 0 ? outIncY : 0)),
+                                                          _mm256_and_si256(cornerZ1, _mm256_set1_epi32(fz[pixel] != 0 ? outIncZ : 0))));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(cornerOffsets), offsets);
+      vtkIdType voxelIndex = outIdX0[pixel] * outInc[0] + outIdY0[pixel] * outInc[1] + outIdZ0[pixel] * outInc[2];
+      unsigned char* voxelOutPtr = outPtr + voxelIndex;
+      unsigned short* voxelAccPtr = accPtr + voxelIndex;
+      for (int corner = 0; corner < 8; ++corner)
+      {
+        bool active = (activeCorners & (1 << corner)) != 0;
+        outValues[corner] = active ? voxelOutPtr[cornerOffsets[corner]] : 0;
+        accValues[corner] = active ? voxelAccPtr[cornerOffsets[corner]] : 0;
+      }
+      __m256i out = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(outValues));
+      __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(accValues));
+
+      // MEAN compounding, see vtkTrilinearInterpolationInSlab:
+      // r = acc/ACCUMULATION_MULTIPLIER, a = weight + r, out = round((weight*in + r*out)/a), acc = round(a*ACCUMULATION_MULTIPLIER)
+      __m256i r = _mm256_slli_epi32(acc, FIXED_POINT - ACCUMULATION_MULTIPLIER_BITS);
+      __m256i a = _mm256_add_epi32(weight, r);
+      __m256i numerator = _mm256_add_epi32(_mm256_mullo_epi32(weight, _mm256_set1_epi32(inValue)), _mm256_mullo_epi32(r, out));
+      // a is never zero for active voxels, the maximum only avoids division by zero for the others
+      __m256i newOut = FixedRound(FixedDivide(numerator, _mm256_max_epi32(a, one)));
+      __m256i newAccFixed = _mm256_slli_epi32(a, ACCUMULATION_MULTIPLIER_BITS);
+
+      // count the voxels that exceed the accumulation buffer threshold now
+      __m256i overflow = _mm256_andnot_si256(_mm256_cmpgt_epi32(acc, accThreshold), _mm256_cmpgt_epi32(newAccFixed, accThresholdFixed));
+      (*accOverflowCount) += CountBits(_mm256_movemask_ps(_mm256_castsi256_ps(overflow)) & activeCorners);
+
+      // don't allow accumulation buffer overflow
+      __m256i newAcc = _mm256_blendv_epi8(FixedRound(newAccFixed), accMaximum, _mm256_cmpgt_epi32(newAccFixed, accMaximumFixedMinusOne));
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(newOutValues), newOut);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(newAccValues), newAcc);
+      for (int corner = 0; corner < 8; ++corner)
+      {
+        if (activeCorners & (1 << corner))
+        {
+          voxelOutPtr[cornerOffsets[corner]] = static_cast<unsigned char>(newOutValues[corner]);
+          voxelAccPtr[cornerOffsets[corner]] = static_cast<unsigned short>(newAccValues[corner]);
+        }
+      }
+    }
+  }
+}
+
+#endif
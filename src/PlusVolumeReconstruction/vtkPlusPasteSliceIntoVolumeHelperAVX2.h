@@ -0,0 +1,49 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusPasteSliceIntoVolumeHelperAVX2.h
+  \brief AVX2 implementation of slice pasting functions
+
+  The functions use AVX2 instructions, therefore they may only be called if PlusCpuFeatures::GetInstructionSet()
+  returns INSTRUCTION_SET_AVX2 (or higher). They are only available if PLUS_X86_SIMD is defined.
+
+  \sa vtkPlusPasteSliceIntoVolume, vtkPlusPasteSliceIntoVolumeHelperOptimized
+  \ingroup PlusLibVolumeReconstruction
+*/
+#ifndef __vtkPlusPasteSliceIntoVolumeHelperAVX2_h
+#define __vtkPlusPasteSliceIntoVolumeHelperAVX2_h
+
+#include "PlusCpuFeatures.h"
+#include "vtkType.h"
+
+#ifdef PLUS_X86_SIMD
+
+/*!
+  Paste a range of pixels of an input image row into the volume using trilinear interpolation and MEAN compounding.
+  The input and output are 8-bit single-component images and the fixed-point math of FULL_OPTIMIZATION is used.
+  The result is exactly the same as calling vtkTrilinearInterpolationInSlab<fixed, unsigned char> for each pixel.
+  Pixels are processed in blocks of 8: the output positions, trilinear weights, and bounds checks are computed
+  for all pixels of a block at once, then the 8 voxels around each pixel are updated at once.
+  \param xIntersectionPixStart Index of the first pixel to paste
+  \param xIntersectionPixEnd Index of the last pixel to paste
+  \param outPoint1 Output voxel position of the pixel at x index 0 (raw value of fixed, with 14 fractional bits)
+  \param xAxis Change of the output voxel position between neighbor pixels (raw value of fixed)
+  \param inPtr Pointer to the pixel at xIntersectionPixStart
+  \param outExt Extent of the output volume
+  \param outInc Increments of the output volume, outInc[0] must be 1
+  \param outSlabZMin Only voxels with z index (relative to outExt) between outSlabZMin and outSlabZMax are modified
+*/
+void vtkTrilinearInterpolationMeanRowAVX2(int xIntersectionPixStart, int xIntersectionPixEnd,
+                                          const int outPoint1[3], const int xAxis[3],
+                                          const unsigned char* inPtr, unsigned char* outPtr, unsigned short* accPtr,
+                                          const int outExt[6], const vtkIdType outInc[3], unsigned int* accOverflowCount,
+                                          bool pixelRejectionEnabled, double pixelRejectionThreshold,
+                                          int outSlabZMin, int outSlabZMax);
+
+#endif
+
+#endif
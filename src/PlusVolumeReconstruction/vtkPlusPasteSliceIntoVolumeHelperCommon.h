@@ -144,6 +144,14 @@ struct vtkPlusPasteSliceIntoVolumeInsertSliceParams
   double fanRadiusStop; // in the input image physical coordinate system
 
   double pixelRejectionThreshold;
+
+  // range of output voxel z indices (relative to the output extent) that may be modified,
+  // used for pasting multiple slices concurrently into different slabs of the volume
+  int outSlabZMin;
+  int outSlabZMax;
+
+  // SIMD implementations may be used (enabled by the user and supported by the CPU)
+  bool simdEnabled;
 };
 
 
@@ -160,18 +168,22 @@ struct vtkPlusPasteSliceIntoVolumeInsertSliceParams
   If the lookup data is beyond the extent 'inExt', set 'outPtr' to
   the background color 'background'.
   The number of scalar components in the data is 'numscalars'
+  Only the voxels that have z index (relative to 'outExt') between 'outSlabZMin' and
+  'outSlabZMax' are modified.
 */
 template <class F, class T>
-static int vtkTrilinearInterpolation(F* point,
-                                     T* inPtr,
-                                     T* outPtr,
-                                     unsigned short* accPtr,
-                                     unsigned char* importancePtr,
-                                     int numscalars,
-                                     vtkPlusPasteSliceIntoVolume::CompoundingType compoundingMode,
-                                     int outExt[6],
-                                     vtkIdType outInc[3],
-                                     unsigned int* accOverflowCount)
+static int vtkTrilinearInterpolationInSlab(F* point,
+                                           T* inPtr,
+                                           T* outPtr,
+                                           unsigned short* accPtr,
+                                           unsigned char* importancePtr,
+                                           int numscalars,
+                                           vtkPlusPasteSliceIntoVolume::CompoundingType compoundingMode,
+                                           int outExt[6],
+                                           vtkIdType outInc[3],
+                                           unsigned int* accOverflowCount,
+                                           int outSlabZMin,
+                                           int outSlabZMax)
 {
   // Determine if the output is a floating point or integer type. If floating point type then we don't round
   // the interpolated value.
@@ -186,10 +198,11 @@ static int vtkTrilinearInterpolation(F* point,
   F fx, fy, fz;
 
   // convert point[0] into integer component and a fraction
-  int outIdX0 = PlusMath::Floor(point[0], fx);
+  // (the indices are relative to the first voxel of the output extent)
+  int outIdX0 = PlusMath::Floor(point[0], fx) - outExt[0];
   // point[0] is unchanged, outIdX0 is the integer (floor), fx is the float
-  int outIdY0 = PlusMath::Floor(point[1], fy);
-  int outIdZ0 = PlusMath::Floor(point[2], fz);
+  int outIdY0 = PlusMath::Floor(point[1], fy) - outExt[2];
+  int outIdZ0 = PlusMath::Floor(point[2], fz) - outExt[4];
 
   int outIdX1 = outIdX0 + (fx != 0); // ceiling
   int outIdY1 = outIdY0 + (fy != 0);
@@ -261,6 +274,13 @@ static int vtkTrilinearInterpolation(F* point,
       {
         continue;
       }
+      // odd corners are in the z+1 plane
+      int outIdZ = (j & 1) ? outIdZ1 : outIdZ0;
+      if (outIdZ < outSlabZMin || outIdZ > outSlabZMax)
+      {
+        // the voxel is outside the slab, it is updated by another thread
+        continue;
+      }
       inPtrTmp = inPtr;
       outPtrTmp = outPtr + idx[j];
       accPtrTmp = accPtr + ((idx[j] / outInc[0]));
@@ -370,6 +390,24 @@ static int vtkTrilinearInterpolation(F* point,
   return 0;
 }
 
+//----------------------------------------------------------------------------
+/*! Implements trilinear interpolation, all the voxels of the output extent may be modified */
+template <class F, class T>
+static int vtkTrilinearInterpolation(F* point,
+                                     T* inPtr,
+                                     T* outPtr,
+                                     unsigned short* accPtr,
+                                     unsigned char* importancePtr,
+                                     int numscalars,
+                                     vtkPlusPasteSliceIntoVolume::CompoundingType compoundingMode,
+                                     int outExt[6],
+                                     vtkIdType outInc[3],
+                                     unsigned int* accOverflowCount)
+{
+  return vtkTrilinearInterpolationInSlab(point, inPtr, outPtr, accPtr, importancePtr, numscalars, compoundingMode,
+    outExt, outInc, accOverflowCount, 0, outExt[5] - outExt[4]);
+}
+
 
 //----------------------------------------------------------------------------
 /*!
@@ -55,439 +55,81 @@ POSSIBILITY OF SUCH DAMAGES.
 
 #include "vtkPlusPasteSliceIntoVolumeHelperCommon.h"
 #include "fixed.h"
+#include "vtkPlusPasteSliceIntoVolumeHelperAVX2.h"
 
-//----------------------------------------------------------------------------
-/*! 
-  Find approximate intersection of line with the plane
-  x = x_min, y = y_min, or z = z_min (lower limit of data extent) 
-*/
-template<class F>
-static inline
-int intersectionHelper(F *point, F *axis, int *limit, int ai, int *inExt)
-{
-  F rd = limit[ai]*point[3]-point[ai]  + 0.5; 
-
-  if (rd < inExt[0])
-  { 
-    return inExt[0];
-  }
-  else if (rd > inExt[1])
-  {
-    return inExt[1];
-  }
-  else
-  {
-    return int(rd);
-  }
-}
-
-//----------------------------------------------------------------------------
-/*! Find the point just inside the extent */
-template <class F>
-static int intersectionLow(F *point, F *axis, int *sign,
-                           int *limit, int ai, int *inExt)
-{
-  // approximate value of r
-  int r = intersectionHelper(point,axis,limit,ai,inExt);
-
-  // move back and forth to find the point just inside the extent
-  for (;;)
-  {
-    F p = point[ai]+r*axis[ai];
-
-    if (((sign[ai] < 0 && r > inExt[0]) ||
-      (sign[ai] > 0 && r < inExt[1])) &&
-      PlusMath::Round(p) < limit[ai])
-    {
-      r += sign[ai];
-    }
-    else
-    {
-      break;
-    }
-  }
-
-  for (;;)
-  {
-    F p = point[ai]+(r-sign[ai])*axis[ai];
-
-    if (((sign[ai] > 0 && r > inExt[0]) ||
-      (sign[ai] < 0 && r < inExt[1])) &&
-      PlusMath::Round(p) >= limit[ai])
-    {
-      r -= sign[ai];
-    }
-    else
-    {
-      break;
-    }
-  }
-
-  return r;
-}
-
-//----------------------------------------------------------------------------
-/*! Find the point just inside the extent, for x = x_max */
-template <class F>
-static int intersectionHigh(F *point, F *axis, int *sign, 
-                            int *limit, int ai, int *inExt)
-{
-  // approximate value of r
-  int r = intersectionHelper(point,axis,limit,ai,inExt);
-
-  // move back and forth to find the point just inside the extent
-  for (;;)
-  {
-    F p = point[ai]+r*axis[ai];
-
-    if (((sign[ai] > 0 && r > inExt[0]) ||
-      (sign[ai] < 0 && r < inExt[1])) &&
-      PlusMath::Round(p) > limit[ai])
-    {
-      r -= sign[ai];
-    }
-    else
-    {
-      break;
-    }
-  }
-
-  for (;;)
-  {
-    F p = point[ai]+(r+sign[ai])*axis[ai];
-
-    if (((sign[ai] < 0 && r > inExt[0]) ||
-      (sign[ai] > 0 && r < inExt[1])) &&
-      PlusMath::Round(p) <= limit[ai])
-    {
-      r += sign[ai];
-    }
-    else
-    {
-      break;
-    }
-  }
-
-  return r;
-}
-
-//----------------------------------------------------------------------------
-template <class F>
-static int isBounded(F *point, F *xAxis, int *inMin, int *inMax, int ai, int r)
-{
-  int bi = ai+1; 
-  int ci = ai+2;
-  if (bi > 2) 
-  { 
-    bi -= 3; // coordinate index must be 0, 1 or 2 
-  } 
-  if (ci > 2)
-  { 
-    ci -= 3;
-  }
-
-  F fbp = point[bi]+r*xAxis[bi];
-  F fcp = point[ci]+r*xAxis[ci];
-
-  int bp = PlusMath::Round(fbp);
-  int cp = PlusMath::Round(fcp);
-
-  return (bp >= inMin[bi] && bp <= inMax[bi] &&
-    cp >= inMin[ci] && cp <= inMax[ci]);
-}
+#include <algorithm>
 
 //----------------------------------------------------------------------------
 /*!
-  This huge mess finds out where the current output raster
-  line intersects the input volume
+  Find the range of pixels of an input image row [xIntersectionPixStart, xIntersectionPixEnd] that are mapped
+  into the output extent, i.e., the rounded output position of the pixel is between outMin and outMax.
+  The rounded output position is monotonic along the row, so the range boundaries are found by binary search,
+  with exactly the same arithmetic as the pixel positions are computed when the pixels are pasted.
+  If no pixels are in the extent then xIntersectionPixEnd = xIntersectionPixStart - 1.
 */
-static void vtkUltraFindExtentHelper(int &xIntersectionPixStart, int &xIntersectionPixEnd, int sign, int *inExt)
-{
-  if (sign < 0)
-  {
-    int i = xIntersectionPixStart;
-    xIntersectionPixStart = xIntersectionPixEnd;
-    xIntersectionPixEnd = i;
-  }
-
-  // bound xIntersectionPixStart,xIntersectionPixEnd within reasonable limits
-  if (xIntersectionPixStart < inExt[0]) 
-  {
-    xIntersectionPixStart = inExt[0];
-  }
-  if (xIntersectionPixEnd > inExt[1]) 
-  {
-    xIntersectionPixEnd = inExt[1];
-  }
-  if (xIntersectionPixStart > xIntersectionPixEnd) 
-  {
-    xIntersectionPixStart = inExt[0];
-    xIntersectionPixEnd = inExt[0]-1;
-  }
-}  
-
-//----------------------------------------------------------------------------
 template <class F>
-static void vtkUltraFindExtent(int& xIntersectionPixStart, int& xIntersectionPixEnd, F *point, F *xAxis, 
-                               int *inMin, int *inMax, int *inExt)
+static void vtkFindRowExtent(int& xIntersectionPixStart, int& xIntersectionPixEnd, F *point, F *xAxis,
+                             int *outMin, int *outMax, int *inExt)
 {
-  int i, ix, iy, iz;
-  int sign[3];
-  int indx1[4],indx2[4];
-  F p1,p2;
-
-  // find signs of components of x axis 
-  // (this is complicated due to the homogeneous coordinate)
-  for (i = 0; i < 3; i++)
-  {
-    p1 = point[i];
-
-    p2 = point[i]+xAxis[i];
-
-    if (p1 <= p2)
-    {
-      sign[i] = 1;
-    }
-    else 
-    {
-      sign[i] = -1;
-    }
-  } 
-
-  // order components of xAxis from largest to smallest
-  ix = 0;
-  for (i = 1; i < 3; i++)
-  {
-    if (((xAxis[i] < 0) ? (-xAxis[i]) : (xAxis[i])) >
-      ((xAxis[ix] < 0) ? (-xAxis[ix]) : (xAxis[ix])))
-    {
-      ix = i;
-    }
-  }
-
-  iy = ((ix > 1) ? ix-2 : ix+1);
-  iz = ((ix > 0) ? ix-1 : ix+2);
-
-  if (((xAxis[iy] < 0) ? (-xAxis[iy]) : (xAxis[iy])) >
-    ((xAxis[iz] < 0) ? (-xAxis[iz]) : (xAxis[iz])))
-  {
-    i = iy;
-    iy = iz;
-    iz = i;
-  }
-
-  xIntersectionPixStart = intersectionLow(point,xAxis,sign,inMin,ix,inExt);
-  xIntersectionPixEnd = intersectionHigh(point,xAxis,sign,inMax,ix,inExt);
-
-  // find points of intersections
-  // first, find w-value for perspective (will usually be 1)
-  for (i = 0; i < 3; i++)
-  {
-    p1 = point[i]+xIntersectionPixStart*xAxis[i];
-    p2 = point[i]+xIntersectionPixEnd*xAxis[i];
-
-    indx1[i] = PlusMath::Round(p1);
-    indx2[i] = PlusMath::Round(p2);
-  }
-
-  // passed through x face, check opposing face
-  if (isBounded(point,xAxis,inMin,inMax,ix,xIntersectionPixStart))
+  int xStart = inExt[0];
+  int xEnd = inExt[1];
+  for (int i = 0; i < 3 && xStart <= xEnd; i++)
   {
-    if (isBounded(point,xAxis,inMin,inMax,ix,xIntersectionPixEnd))
-    {
-      vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[ix],inExt);
-      return;
-    }
-
-    // check y face
-    if (indx2[iy] < inMin[iy])
-    {
-      xIntersectionPixEnd = intersectionLow(point,xAxis,sign,inMin,iy,inExt);
-      if (isBounded(point,xAxis,inMin,inMax,iy,xIntersectionPixEnd))
-      {
-        vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[ix],inExt);
-        return;
-      }
-    }
-
-    // check other y face
-    else if (indx2[iy] > inMax[iy])
-    {
-      xIntersectionPixEnd = intersectionHigh(point,xAxis,sign,inMax,iy,inExt);
-      if (isBounded(point,xAxis,inMin,inMax,iy,xIntersectionPixEnd))
-      {
-        vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[ix],inExt);
-        return;
-      }
-    }
-
-    // check z face
-    if (indx2[iz] < inMin[iz])
+    if (xAxis[i] == 0)
     {
-      xIntersectionPixEnd = intersectionLow(point,xAxis,sign,inMin,iz,inExt);
-      if (isBounded(point,xAxis,inMin,inMax,iz,xIntersectionPixEnd))
+      // the row is parallel to this axis
+      int outId = PlusMath::Round(point[i]);
+      if (outId < outMin[i] || outId > outMax[i])
       {
-        vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[ix],inExt);
-        return;
+        xEnd = xStart - 1;
       }
+      continue;
     }
-
-    // check other z face
-    else if (indx2[iz] > inMax[iz])
+    bool increasing = (xAxis[i] > 0);
+    // first pixel that is not before the outMin (if increasing) or outMax (if decreasing) limit
+    int low = xStart;
+    int high = xEnd + 1;
+    while (low < high)
     {
-      xIntersectionPixEnd = intersectionHigh(point,xAxis,sign,inMax,iz,inExt);
-      if (isBounded(point,xAxis,inMin,inMax,iz,xIntersectionPixEnd))
+      int mid = low + (high - low) / 2;
+      F p = point[i] + mid * xAxis[i];
+      int outId = PlusMath::Round(p);
+      if (increasing ? (outId < outMin[i]) : (outId > outMax[i]))
       {
-        vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[ix],inExt);
-        return;
+        low = mid + 1;
       }
-    }
-  }
-
-  // passed through the opposite x face
-  if (isBounded(point,xAxis,inMin,inMax,ix,xIntersectionPixEnd))
-  {
-    // check y face
-    if (indx1[iy] < inMin[iy])
-    {
-      xIntersectionPixStart = intersectionLow(point,xAxis,sign,inMin,iy,inExt);
-      if (isBounded(point,xAxis,inMin,inMax,iy,xIntersectionPixStart))
-      {
-        vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[ix],inExt);
-        return;
-      }
-    }
-    // check other y face
-    else if (indx1[iy] > inMax[iy])
-    {
-      xIntersectionPixStart = intersectionHigh(point,xAxis,sign,inMax,iy,inExt);
-      if (isBounded(point,xAxis,inMin,inMax,iy,xIntersectionPixStart))
+      else
       {
-        vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[ix],inExt);
-        return;
+        high = mid;
       }
     }
-
-    // check other y face
-    if (indx1[iz] < inMin[iz])
+    xStart = low;
+    // first pixel that is after the outMax (if increasing) or outMin (if decreasing) limit
+    high = xEnd + 1;
+    while (low < high)
     {
-      xIntersectionPixStart = intersectionLow(point,xAxis,sign,inMin,iz,inExt);
-      if (isBounded(point,xAxis,inMin,inMax,iz,xIntersectionPixStart))
+      int mid = low + (high - low) / 2;
+      F p = point[i] + mid * xAxis[i];
+      int outId = PlusMath::Round(p);
+      if (increasing ? (outId <= outMax[i]) : (outId >= outMin[i]))
       {
-        vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[ix],inExt);
-        return;
+        low = mid + 1;
       }
-    }
-    // check other z face
-    else if (indx1[iz] > inMax[iz])
-    {
-      xIntersectionPixStart = intersectionHigh(point,xAxis,sign,inMax,iz,inExt);
-      if (isBounded(point,xAxis,inMin,inMax,iz,xIntersectionPixStart))
+      else
       {
-        vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[ix],inExt);
-        return;
+        high = mid;
       }
     }
+    xEnd = low - 1;
   }
-
-  // line might pass through bottom face
-  if ((indx1[iy] >= inMin[iy] && indx2[iy] < inMin[iy]) ||
-    (indx1[iy] < inMin[iy] && indx2[iy] >= inMin[iy]))
-  {
-    xIntersectionPixStart = intersectionLow(point,xAxis,sign,inMin,iy,inExt);
-    if (isBounded(point,xAxis,inMin,inMax,iy,xIntersectionPixStart))
-    {
-      // line might pass through top face
-      if ((indx1[iy] <= inMax[iy] && indx2[iy] > inMax[iy]) ||
-        (indx1[iy] > inMax[iy] && indx2[iy] <= inMax[iy]))
-      { 
-        xIntersectionPixEnd = intersectionHigh(point,xAxis,sign,inMax,iy,inExt);
-        if (isBounded(point,xAxis,inMin,inMax,iy,xIntersectionPixEnd))
-        {
-          vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[iy],inExt);
-          return;
-        }
-      }
-
-      // line might pass through in-to-screen face
-      if ((indx1[iz] < inMin[iz] && indx2[iy] < inMin[iy]) ||
-        (indx2[iz] < inMin[iz] && indx1[iy] < inMin[iy]))
-      { 
-        xIntersectionPixEnd = intersectionLow(point,xAxis,sign,inMin,iz,inExt);
-        if (isBounded(point,xAxis,inMin,inMax,iz,xIntersectionPixEnd))
-        {
-          vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[iy],inExt);
-          return;
-        }
-      }
-      // line might pass through out-of-screen face
-      else if ((indx1[iz] > inMax[iz] && indx2[iy] < inMin[iy]) ||
-        (indx2[iz] > inMax[iz] && indx1[iy] < inMin[iy]))
-      {
-        xIntersectionPixEnd = intersectionHigh(point,xAxis,sign,inMax,iz,inExt);
-        if (isBounded(point,xAxis,inMin,inMax,iz,xIntersectionPixEnd))
-        {
-          vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[iy],inExt);
-          return;
-        }
-      } 
-    }
-  }
-
-  // line might pass through top face
-  if ((indx1[iy] <= inMax[iy] && indx2[iy] > inMax[iy]) ||
-    (indx1[iy] > inMax[iy] && indx2[iy] <= inMax[iy]))
-  {
-    xIntersectionPixEnd = intersectionHigh(point,xAxis,sign,inMax,iy,inExt);
-    if (isBounded(point,xAxis,inMin,inMax,iy,xIntersectionPixEnd))
-    {
-      // line might pass through in-to-screen face
-      if ((indx1[iz] < inMin[iz] && indx2[iy] > inMax[iy]) ||
-        (indx2[iz] < inMin[iz] && indx1[iy] > inMax[iy]))
-      {
-        xIntersectionPixStart = intersectionLow(point,xAxis,sign,inMin,iz,inExt);
-        if (isBounded(point,xAxis,inMin,inMax,iz,xIntersectionPixStart))
-        {
-          vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[iy],inExt);
-          return;
-        }
-      }
-      // line might pass through out-of-screen face
-      else if ((indx1[iz] > inMax[iz] && indx2[iy] > inMax[iy]) ||
-        (indx2[iz] > inMax[iz] && indx1[iy] > inMax[iy]))
-      {
-        xIntersectionPixStart = intersectionHigh(point,xAxis,sign,inMax,iz,inExt);
-        if (isBounded(point,xAxis,inMin,inMax,iz,xIntersectionPixStart))
-        {
-          vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[iy],inExt);
-          return;
-        }
-      }
-    } 
-  }
-
-  // line might pass through in-to-screen face
-  if ((indx1[iz] >= inMin[iz] && indx2[iz] < inMin[iz]) ||
-    (indx1[iz] < inMin[iz] && indx2[iz] >= inMin[iz]))
+  if (xStart > xEnd)
   {
-    xIntersectionPixStart = intersectionLow(point,xAxis,sign,inMin,iz,inExt);
-    if (isBounded(point,xAxis,inMin,inMax,iz,xIntersectionPixStart))
-    {
-      // line might pass through out-of-screen face
-      if (indx1[iz] > inMax[iz] || indx2[iz] > inMax[iz])
-      {
-        xIntersectionPixEnd = intersectionHigh(point,xAxis,sign,inMax,iz,inExt);
-        if (isBounded(point,xAxis,inMin,inMax,iz,xIntersectionPixEnd))
-        {
-          vtkUltraFindExtentHelper(xIntersectionPixStart,xIntersectionPixEnd,sign[iz],inExt);
-          return;
-        }
-      }
-    }
+    xIntersectionPixStart = inExt[0];
+    xIntersectionPixEnd = inExt[0] - 1;
+    return;
   }
-
-  xIntersectionPixStart = inExt[0];
-  xIntersectionPixEnd = inExt[0] - 1;
+  xIntersectionPixStart = xStart;
+  xIntersectionPixEnd = xEnd;
 }
 
 
@@ -509,7 +151,9 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
                                                  unsigned short *accPtr,
                                                  unsigned char *&importancePtr,
                                                  unsigned int *accOverflowCount,
-                                                 double pixelRejectionThreshold)
+                                                 double pixelRejectionThreshold,
+                                                 int outSlabZMin,
+                                                 int outSlabZMax)
 {
   bool pixelRejectionEnabled = PixelRejectionEnabled(pixelRejectionThreshold);
   double pixelRejectionThresholdSumAllComponents = 0;
@@ -544,6 +188,13 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
       int outIdY = PlusMath::Round(outPoint[1]) - outExt[2];
       int outIdZ = PlusMath::Round(outPoint[2]) - outExt[4];
 
+      if (outIdZ < outSlabZMin || outIdZ > outSlabZMax)
+      {
+        // the voxel is outside the slab, it is updated by another thread
+        inPtr += numscalars;
+        continue;
+      }
+
       int inc = outIdX*outInc[0] + outIdY*outInc[1] + outIdZ*outInc[2];
       T *outPtr1 = outPtr + inc;
       // divide by outInc[0] to accomodate for the difference
@@ -573,8 +224,14 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
           *accPtr1 = newa;
         } 
       } else { // overflow, use recursive filtering with 255/256 and 1/256 as the weights, since 255 voxels have been inserted so far
-        // TODO : This doesn't iterate through the scalars, this could be a problem
-        *outPtr1 = (T)( (*inPtr++)*fraction1_256 + (*outPtr1)*fraction255_256 );
+        int i = numscalars;
+        do 
+        {
+          i--;
+          *outPtr1 = (T)( (*inPtr++)*fraction1_256 + (*outPtr1)*fraction255_256 );
+          outPtr1++;
+        }
+        while (i);
       }
     }
     break;
@@ -605,6 +262,14 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
       int outIdY = PlusMath::Round(outPoint[1]) - outExt[2];
       int outIdZ = PlusMath::Round(outPoint[2]) - outExt[4];
 
+      if (outIdZ < outSlabZMin || outIdZ > outSlabZMax)
+      {
+        // the voxel is outside the slab, it is updated by another thread
+        inPtr += numscalars;
+        importancePtr++;
+        continue;
+      }
+
       int inc = outIdX*outInc[0] + outIdY*outInc[1] + outIdZ*outInc[2];
       T *outPtr1 = outPtr + inc;
       // divide by outInc[0] to accomodate for the difference
@@ -646,8 +311,14 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
       else
       {
         // overflow, use recursive filtering with 255/256 and 1/256 as the weights, since 255 voxels have been inserted so far
-        // TODO : This doesn't iterate through the scalars, this could be a problem
-        *outPtr1 = (T)( (*inPtr++)*fraction1_256 + (*outPtr1)*fraction255_256 );
+        int i = numscalars;
+        do 
+        {
+          i--;
+          *outPtr1 = (T)( (*inPtr++)*fraction1_256 + (*outPtr1)*fraction255_256 );
+          outPtr1++;
+        }
+        while (i);
       }
     }
     break;
@@ -677,6 +348,13 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
       int outIdY = PlusMath::Round(outPoint[1]) - outExt[2];
       int outIdZ = PlusMath::Round(outPoint[2]) - outExt[4];
 
+      if (outIdZ < outSlabZMin || outIdZ > outSlabZMax)
+      {
+        // the voxel is outside the slab, it is updated by another thread
+        inPtr += numscalars;
+        continue;
+      }
+
       int inc = outIdX*outInc[0] + outIdY*outInc[1] + outIdZ*outInc[2];
       T *outPtr1 = outPtr + inc;
       // divide by outInc[0] to accomodate for the difference
@@ -723,6 +401,13 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
       int outIdY = PlusMath::Round(outPoint[1]) - outExt[2];
       int outIdZ = PlusMath::Round(outPoint[2]) - outExt[4];
 
+      if (outIdZ < outSlabZMin || outIdZ > outSlabZMax)
+      {
+        // the voxel is outside the slab, it is updated by another thread
+        inPtr += numscalars;
+        continue;
+      }
+
       int inc = outIdX*outInc[0] + outIdY*outInc[1] + outIdZ*outInc[2];
       T *outPtr1 = outPtr + inc;
       // divide by outInc[0] to accomodate for the difference
@@ -768,7 +453,9 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
                                                  unsigned short *accPtr,
                                                  unsigned char *&importancePtr,
                                                  unsigned int *accOverflowCount,
-                                                 double pixelRejectionThreshold)
+                                                 double pixelRejectionThreshold,
+                                                 int outSlabZMin,
+                                                 int outSlabZMax)
 {
   bool pixelRejectionEnabled = PixelRejectionEnabled(pixelRejectionThreshold);
   double pixelRejectionThresholdSumAllComponents = 0;
@@ -808,6 +495,16 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
       int outIdY = PlusMath::Round(outPoint[1]);
       int outIdZ = PlusMath::Round(outPoint[2]);
 
+      if (outIdZ < outSlabZMin || outIdZ > outSlabZMax)
+      {
+        // the voxel is outside the slab, it is updated by another thread
+        inPtr += numscalars;
+        outPoint[0] += xAxis[0];
+        outPoint[1] += xAxis[1];
+        outPoint[2] += xAxis[2];
+        continue;
+      }
+
       int inc = outIdX*outInc[0] + outIdY*outInc[1] + outIdZ*outInc[2];
       T *outPtr1 = outPtr + inc;
       // divide by outInc[0] to accomodate for the difference
@@ -837,8 +534,14 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
           *accPtr1 = newa;
         }
       } else { // overflow, use recursive filtering with 255/256 and 1/256 as the weights, since 255 voxels have been inserted so far
-        // TODO : This doesn't iterate through the scalars, this could be a problem
-        *outPtr1 = (T)( (*inPtr++)*fraction1_256 + (*outPtr1)*fraction255_256 );
+        int i = numscalars;
+        do 
+        {
+          i--;
+          *outPtr1 = (T)( (*inPtr++)*fraction1_256 + (*outPtr1)*fraction255_256 );
+          outPtr1++;
+        }
+        while (i);
       }
 
       outPoint[0] += xAxis[0];
@@ -873,6 +576,17 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
       int outIdY = PlusMath::Round(outPoint[1]);
       int outIdZ = PlusMath::Round(outPoint[2]);
 
+      if (outIdZ < outSlabZMin || outIdZ > outSlabZMax)
+      {
+        // the voxel is outside the slab, it is updated by another thread
+        inPtr += numscalars;
+        outPoint[0] += xAxis[0];
+        outPoint[1] += xAxis[1];
+        outPoint[2] += xAxis[2];
+        importancePtr++;
+        continue;
+      }
+
       int inc = outIdX*outInc[0] + outIdY*outInc[1] + outIdZ*outInc[2];
       T *outPtr1 = outPtr + inc;
       // divide by outInc[0] to accomodate for the difference
@@ -913,8 +627,14 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
       else
       {
         // overflow, use recursive filtering with 255/256 and 1/256 as the weights, since 255 voxels have been inserted so far
-        // TODO : This doesn't iterate through the scalars, this could be a problem
-        *outPtr1 = (T)( (*inPtr++)*fraction1_256 + (*outPtr1)*fraction255_256 );
+        int i = numscalars;
+        do 
+        {
+          i--;
+          *outPtr1 = (T)( (*inPtr++)*fraction1_256 + (*outPtr1)*fraction255_256 );
+          outPtr1++;
+        }
+        while (i);
       }
 
       outPoint[0] += xAxis[0];
@@ -947,6 +667,16 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
       int outIdY = PlusMath::Round(outPoint[1]);
       int outIdZ = PlusMath::Round(outPoint[2]);
 
+      if (outIdZ < outSlabZMin || outIdZ > outSlabZMax)
+      {
+        // the voxel is outside the slab, it is updated by another thread
+        inPtr += numscalars;
+        outPoint[0] += xAxis[0];
+        outPoint[1] += xAxis[1];
+        outPoint[2] += xAxis[2];
+        continue;
+      }
+
       int inc = outIdX*outInc[0] + outIdY*outInc[1] + outIdZ*outInc[2];
       T *outPtr1 = outPtr + inc;
       // divide by outInc[0] to accomodate for the difference
@@ -996,6 +726,16 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
       int outIdY = PlusMath::Round(outPoint[1]);
       int outIdZ = PlusMath::Round(outPoint[2]);
 
+      if (outIdZ < outSlabZMin || outIdZ > outSlabZMax)
+      {
+        // the voxel is outside the slab, it is updated by another thread
+        inPtr += numscalars;
+        outPoint[0] += xAxis[0];
+        outPoint[1] += xAxis[1];
+        outPoint[2] += xAxis[2];
+        continue;
+      }
+
       int inc = outIdX*outInc[0] + outIdY*outInc[1] + outIdZ*outInc[2];
       T *outPtr1 = outPtr + inc;
       // divide by outInc[0] to accomodate for the difference
@@ -1025,6 +765,181 @@ static inline void vtkFreehand2OptimizedNNHelper(int xIntersectionPixStart,
   }
 }
 
+//----------------------------------------------------------------------------
+/*!
+  Trilinear interpolation of a range of pixels of an input image row using SIMD instructions.
+  Returns false if there is no SIMD implementation for the pixel type, math type, and compounding mode
+  (in this case no pixels are pasted).
+*/
+template <class F, class T>
+static inline bool vtkTrilinearInterpolationRowSimd(int xIntersectionPixStart,
+                                                    int xIntersectionPixEnd,
+                                                    F *outPoint1,
+                                                    F *xAxis,
+                                                    T *inPtr,
+                                                    T *outPtr,
+                                                    int *outExt,
+                                                    vtkIdType *outInc,
+                                                    int numscalars,
+                                                    vtkPlusPasteSliceIntoVolume::CompoundingType compoundingMode,
+                                                    unsigned short *accPtr,
+                                                    unsigned int *accOverflowCount,
+                                                    double pixelRejectionThreshold,
+                                                    int outSlabZMin,
+                                                    int outSlabZMax)
+{
+  return false;
+}
+
+//----------------------------------------------------------------------------
+/*!
+  Trilinear interpolation of a range of pixels of an input image row using SIMD instructions,
+  for 8-bit images and fixed-point (i.e. integer) mathematics
+*/
+static inline bool vtkTrilinearInterpolationRowSimd(int xIntersectionPixStart,
+                                                    int xIntersectionPixEnd,
+                                                    fixed *outPoint1,
+                                                    fixed *xAxis,
+                                                    unsigned char *inPtr,
+                                                    unsigned char *outPtr,
+                                                    int *outExt,
+                                                    vtkIdType *outInc,
+                                                    int numscalars,
+                                                    vtkPlusPasteSliceIntoVolume::CompoundingType compoundingMode,
+                                                    unsigned short *accPtr,
+                                                    unsigned int *accOverflowCount,
+                                                    double pixelRejectionThreshold,
+                                                    int outSlabZMin,
+                                                    int outSlabZMax)
+{
+#ifdef PLUS_X86_SIMD
+  // the SIMD implementation computes the voxel offsets with int
+  if (compoundingMode != vtkPlusPasteSliceIntoVolume::MEAN_COMPOUNDING_MODE || numscalars != 1
+    || outInc[0] != 1 || outInc[0] + outInc[1] + outInc[2] > VTK_INT_MAX)
+  {
+    return false;
+  }
+  int outPoint1Fixed[3] = { outPoint1[0].i, outPoint1[1].i, outPoint1[2].i };
+  int xAxisFixed[3] = { xAxis[0].i, xAxis[1].i, xAxis[2].i };
+  vtkTrilinearInterpolationMeanRowAVX2(xIntersectionPixStart, xIntersectionPixEnd, outPoint1Fixed, xAxisFixed,
+    inPtr, outPtr, accPtr, outExt, outInc, accOverflowCount,
+    PixelRejectionEnabled(pixelRejectionThreshold), pixelRejectionThreshold, outSlabZMin, outSlabZMax);
+  return true;
+#else
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+/*! Trilinear interpolation of a range of pixels of an input image row */
+template <class F, class T>
+static inline void vtkTrilinearInterpolationRowHelper(int xIntersectionPixStart,
+                                                      int xIntersectionPixEnd,
+                                                      F *outPoint,
+                                                      F *outPoint1,
+                                                      F *xAxis,
+                                                      T *&inPtr,
+                                                      T *outPtr,
+                                                      int *outExt,
+                                                      vtkIdType *outInc,
+                                                      int numscalars,
+                                                      vtkPlusPasteSliceIntoVolume::CompoundingType compoundingMode,
+                                                      unsigned short *accPtr,
+                                                      unsigned char *&importancePtr,
+                                                      unsigned int *accOverflowCount,
+                                                      double pixelRejectionThreshold,
+                                                      bool simdEnabled,
+                                                      int outSlabZMin,
+                                                      int outSlabZMax)
+{
+  if (xIntersectionPixStart > xIntersectionPixEnd)
+  {
+    return;
+  }
+
+  if (simdEnabled && vtkTrilinearInterpolationRowSimd(xIntersectionPixStart, xIntersectionPixEnd, outPoint1, xAxis,
+    inPtr, outPtr, outExt, outInc, numscalars, compoundingMode, accPtr, accOverflowCount,
+    pixelRejectionThreshold, outSlabZMin, outSlabZMax))
+  {
+    inPtr += numscalars * (xIntersectionPixEnd - xIntersectionPixStart + 1);
+    importancePtr += xIntersectionPixEnd - xIntersectionPixStart + 1;
+    return;
+  }
+
+  bool pixelRejectionEnabled = PixelRejectionEnabled(pixelRejectionThreshold);
+  double pixelRejectionThresholdSumAllComponents = 0;
+  if (pixelRejectionEnabled)
+  {
+    pixelRejectionThresholdSumAllComponents = pixelRejectionThreshold * numscalars;
+  }
+
+  for (int idX = xIntersectionPixStart; idX <= xIntersectionPixEnd; idX++)
+  {
+    if (pixelRejectionEnabled)
+    {
+      double inPixelSumAllComponents = 0;
+      for (int i = numscalars-1; i>=0; i--)
+      {
+        inPixelSumAllComponents+=inPtr[i];
+      }
+      if (inPixelSumAllComponents<pixelRejectionThresholdSumAllComponents)
+      {
+        // too dark, skip this pixel
+        inPtr += numscalars; // go to the next x pixel
+        importancePtr++;
+        continue;
+      }
+    }
+
+    outPoint[0] = outPoint1[0] + idX*xAxis[0];
+    outPoint[1] = outPoint1[1] + idX*xAxis[1];
+    outPoint[2] = outPoint1[2] + idX*xAxis[2];
+    vtkTrilinearInterpolationInSlab(outPoint, inPtr, outPtr, accPtr, importancePtr, numscalars, compoundingMode, outExt, outInc, accOverflowCount, outSlabZMin, outSlabZMax); // hit is either 1 or 0
+    inPtr += numscalars; // go to the next x pixel
+    importancePtr++;
+  }
+}
+
+//----------------------------------------------------------------------------
+/*!
+  Reduce the pixel range of an input image row to the pixels that may modify voxels of an output slab
+  (voxels with z index between slabZMin and slabZMax). The range is conservative, the z index of the
+  voxels is checked again when the pixels are pasted.
+  \param z Output z index of the first (x=0) pixel of the row
+  \param dz Change of the output z index between neighbor pixels of the row
+*/
+static void vtkRestrictToOutputSlab(int& xIntersectionPixStart, int& xIntersectionPixEnd, double z, double dz, int slabZMin, int slabZMax)
+{
+  // a pixel modifies voxels within one voxel distance, a larger margin is used to be robust to rounding errors
+  const double margin = 2.0;
+  double zMin = slabZMin - margin;
+  double zMax = slabZMax + margin;
+  if (fabs(dz) < 1e-6)
+  {
+    // the row is parallel to the slab
+    double zStart = z + xIntersectionPixStart * dz;
+    if (zStart < zMin || zStart > zMax)
+    {
+      xIntersectionPixEnd = xIntersectionPixStart - 1;
+    }
+    return;
+  }
+  double xMin = (zMin - z) / dz;
+  double xMax = (zMax - z) / dz;
+  if (xMin > xMax)
+  {
+    std::swap(xMin, xMax);
+  }
+  if (xMin > xIntersectionPixStart)
+  {
+    xIntersectionPixStart = (xMin > xIntersectionPixEnd) ? xIntersectionPixEnd + 1 : PlusMath::Floor(xMin);
+  }
+  if (xMax < xIntersectionPixEnd)
+  {
+    xIntersectionPixEnd = (xMax < xIntersectionPixStart) ? xIntersectionPixStart - 1 : -PlusMath::Floor(-xMax);
+  }
+}
+
 //----------------------------------------------------------------------------
 /*! Actually inserts the slice, with optimization */
 template <class F, class T>
@@ -1127,6 +1042,15 @@ static void vtkOptimizedInsertSlice(vtkPlusPasteSliceIntoVolumeInsertSliceParams
     outMax[i] = outExt[2*i+1];
   }
 
+  // only the voxels in this range of z indices are modified
+  // (it is a slab of the volume if multiple slices are pasted concurrently)
+  int outSlabZMin = insertionParams->outSlabZMin;
+  int outSlabZMax = insertionParams->outSlabZMax;
+  bool restrictToSlab = (outSlabZMin > 0 || outSlabZMax < outMax[2] - outMin[2]);
+
+  // SIMD implementation of the interpolation may be used
+  bool simdEnabled = insertionParams->simdEnabled;
+
   // outPoint0, outPoint1, outPoint is a fancy way of incremetally multiplying the input point by
   // the index matrix to get the output point...  Outpoint is the result
   F outPoint0[3]; // temp, see above
@@ -1147,13 +1071,6 @@ static void vtkOptimizedInsertSlice(vtkPlusPasteSliceIntoVolumeInsertSliceParams
 
   bool fanClippingEnabled = (fanLinePixelRatioLeft != 0 || fanLinePixelRatioRight != 0);
 
-  bool pixelRejectionEnabled = PixelRejectionEnabled(insertionParams->pixelRejectionThreshold);
-  double pixelRejectionThresholdSumAllComponents = 0;
-  if (pixelRejectionEnabled)
-  {
-    pixelRejectionThresholdSumAllComponents = insertionParams->pixelRejectionThreshold * numscalars;
-  }
-
   int xIntersectionPixStart,xIntersectionPixEnd;
 
   // Loop through INPUT pixels - remember this is a 3D cube represented by the input extent
@@ -1172,7 +1089,7 @@ static void vtkOptimizedInsertSlice(vtkPlusPasteSliceIntoVolumeInsertSliceParams
       // find intersections of x raster line with the output extent
 
       // this only changes xIntersectionPixStart and xIntersectionPixEnd
-      vtkUltraFindExtent(xIntersectionPixStart,xIntersectionPixEnd,outPoint1,xAxis,outMin,outMax,inExt);
+      vtkFindRowExtent(xIntersectionPixStart,xIntersectionPixEnd,outPoint1,xAxis,outMin,outMax,inExt);
 
       // next, handle the 'fan' shape of the input
       double y = idY - fanOriginInPixels[1];
@@ -1246,6 +1163,13 @@ static void vtkOptimizedInsertSlice(vtkPlusPasteSliceIntoVolumeInsertSliceParams
         xIntersectionPixEnd = clipExt[1];
       }
 
+      // skip the pixels that cannot modify any voxel in the slab
+      if (restrictToSlab)
+      {
+        vtkRestrictToOutputSlab(xIntersectionPixStart, xIntersectionPixEnd, static_cast<double>(outPoint1[2]), static_cast<double>(xAxis[2]),
+          outMin[2] + outSlabZMin, outMin[2] + outSlabZMax);
+      }
+
       if (xIntersectionPixStart > xIntersectionPixEnd || idY < clipExt[2] || idY > clipExt[3])
       {
         xIntersectionPixStart = inExt[0];
@@ -1297,86 +1221,26 @@ static void vtkOptimizedInsertSlice(vtkPlusPasteSliceIntoVolumeInsertSliceParams
       { 
         if (skipMiddleSegment)
         {
-          for (int idX = xIntersectionPixStart; idX < xSkipMiddleSegmentPixStart; idX++) // for all of the x pixels within the fan before the skipped middle section
-          {
-            if (pixelRejectionEnabled)
-            {
-              double inPixelSumAllComponents = 0;
-              for (int i = numscalars-1; i>=0; i--)
-              {
-                inPixelSumAllComponents+=inPtr[i];
-              }
-              if (inPixelSumAllComponents<pixelRejectionThresholdSumAllComponents)
-              {
-                // too dark, skip this pixel
-                inPtr += numscalars; // go to the next x pixel
-                importancePtr++;
-                continue;
-              }
-            }
-
-            outPoint[0] = outPoint1[0] + idX*xAxis[0];
-            outPoint[1] = outPoint1[1] + idX*xAxis[1];
-            outPoint[2] = outPoint1[2] + idX*xAxis[2];
-            vtkTrilinearInterpolation(outPoint, inPtr, outPtr, accPtr, importancePtr, numscalars, compoundingMode, outExt, outInc, accOverflowCount); // hit is either 1 or 0
-            inPtr += numscalars; // go to the next x pixel
-            importancePtr++;
-          }
+          // all of the x pixels within the fan before the skipped middle section
+          vtkTrilinearInterpolationRowHelper(xIntersectionPixStart, xSkipMiddleSegmentPixStart-1, outPoint, outPoint1, xAxis,
+            inPtr, outPtr, outExt, outInc,
+            numscalars, compoundingMode, accPtr, importancePtr, accOverflowCount, insertionParams->pixelRejectionThreshold,
+            simdEnabled, outSlabZMin, outSlabZMax);
           inPtr += numscalars * (xSkipMiddleSegmentPixEnd-xSkipMiddleSegmentPixStart+1);
           importancePtr += xSkipMiddleSegmentPixEnd - xSkipMiddleSegmentPixStart + 1;
-          for (int idX = xSkipMiddleSegmentPixEnd+1; idX <= xIntersectionPixEnd; idX++) // for all of the x pixels within the fan after the skipped middle section
-          {
-            if (pixelRejectionEnabled)
-            {
-              double inPixelSumAllComponents = 0;
-              for (int i = numscalars-1; i>=0; i--)
-              {
-                inPixelSumAllComponents+=inPtr[i];
-              }
-              if (inPixelSumAllComponents<pixelRejectionThresholdSumAllComponents)
-              {
-                // too dark, skip this pixel
-                inPtr += numscalars; // go to the next x pixel
-                importancePtr++;
-                continue;
-              }
-            }
-
-            outPoint[0] = outPoint1[0] + idX*xAxis[0];
-            outPoint[1] = outPoint1[1] + idX*xAxis[1];
-            outPoint[2] = outPoint1[2] + idX*xAxis[2];
-            vtkTrilinearInterpolation(outPoint, inPtr, outPtr, accPtr, importancePtr, numscalars, compoundingMode, outExt, outInc, accOverflowCount); // hit is either 1 or 0
-            inPtr += numscalars; // go to the next x pixel
-            importancePtr++;
-          }
+          // all of the x pixels within the fan after the skipped middle section
+          vtkTrilinearInterpolationRowHelper(xSkipMiddleSegmentPixEnd+1, xIntersectionPixEnd, outPoint, outPoint1, xAxis,
+            inPtr, outPtr, outExt, outInc,
+            numscalars, compoundingMode, accPtr, importancePtr, accOverflowCount, insertionParams->pixelRejectionThreshold,
+            simdEnabled, outSlabZMin, outSlabZMax);
         }
         else
         {
-          for (int idX = xIntersectionPixStart; idX <= xIntersectionPixEnd; idX++) // for all of the x pixels within the fan
-          {
-            if (pixelRejectionEnabled)
-            {
-              double inPixelSumAllComponents = 0;
-              for (int i = numscalars-1; i>=0; i--)
-              {
-                inPixelSumAllComponents+=inPtr[i];
-              }
-              if (inPixelSumAllComponents<pixelRejectionThresholdSumAllComponents)
-              {
-                // too dark, skip this pixel
-                inPtr += numscalars; // go to the next x pixel
-                importancePtr++;
-                continue;
-              }
-            }
-
-            outPoint[0] = outPoint1[0] + idX*xAxis[0];
-            outPoint[1] = outPoint1[1] + idX*xAxis[1];
-            outPoint[2] = outPoint1[2] + idX*xAxis[2];
-            vtkTrilinearInterpolation(outPoint, inPtr, outPtr, accPtr, importancePtr, numscalars, compoundingMode, outExt, outInc, accOverflowCount); // hit is either 1 or 0
-            inPtr += numscalars; // go to the next x pixel
-            importancePtr++;
-          }
+          // all of the x pixels within the fan
+          vtkTrilinearInterpolationRowHelper(xIntersectionPixStart, xIntersectionPixEnd, outPoint, outPoint1, xAxis,
+            inPtr, outPtr, outExt, outInc,
+            numscalars, compoundingMode, accPtr, importancePtr, accOverflowCount, insertionParams->pixelRejectionThreshold,
+            simdEnabled, outSlabZMin, outSlabZMax);
         }
       }      
       else 
@@ -1386,18 +1250,18 @@ static void vtkOptimizedInsertSlice(vtkPlusPasteSliceIntoVolumeInsertSliceParams
         {
           vtkFreehand2OptimizedNNHelper(xIntersectionPixStart, xSkipMiddleSegmentPixStart-1, outPoint, outPoint1, xAxis, 
             inPtr, outPtr, outExt, outInc,
-            numscalars, compoundingMode, accPtr, importancePtr, accOverflowCount, insertionParams->pixelRejectionThreshold);
+            numscalars, compoundingMode, accPtr, importancePtr, accOverflowCount, insertionParams->pixelRejectionThreshold, outSlabZMin, outSlabZMax);
           inPtr += numscalars * (xSkipMiddleSegmentPixEnd-xSkipMiddleSegmentPixStart+1);
           importancePtr += (xSkipMiddleSegmentPixEnd - xSkipMiddleSegmentPixStart + 1);;
           vtkFreehand2OptimizedNNHelper(xSkipMiddleSegmentPixEnd+1, xIntersectionPixEnd, outPoint, outPoint1, xAxis, 
             inPtr, outPtr, outExt, outInc,
-            numscalars, compoundingMode, accPtr, importancePtr, accOverflowCount, insertionParams->pixelRejectionThreshold);
+            numscalars, compoundingMode, accPtr, importancePtr, accOverflowCount, insertionParams->pixelRejectionThreshold, outSlabZMin, outSlabZMax);
         }
         else
         {
           vtkFreehand2OptimizedNNHelper(xIntersectionPixStart, xIntersectionPixEnd, outPoint, outPoint1, xAxis, 
             inPtr, outPtr, outExt, outInc,
-            numscalars, compoundingMode, accPtr, importancePtr, accOverflowCount, insertionParams->pixelRejectionThreshold);
+            numscalars, compoundingMode, accPtr, importancePtr, accOverflowCount, insertionParams->pixelRejectionThreshold, outSlabZMin, outSlabZMax);
         }
       }
 
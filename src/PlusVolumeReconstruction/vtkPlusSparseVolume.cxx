@@ -0,0 +1,420 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+
+#include "vtkDataArray.h"
+#include "vtkObjectFactory.h"
+#include "vtkPlusSparseVolume.h"
+
+#include <algorithm>
+#include <string.h>
+
+vtkStandardNewMacro(vtkPlusSparseVolume);
+
+//----------------------------------------------------------------------------
+vtkPlusSparseVolume::vtkPlusSparseVolume()
+: ScalarType(VTK_UNSIGNED_CHAR)
+, NumberOfScalarComponents(1)
+, BrickSize(32)
+, GridBrickSize(32)
+, NumberOfAllocatedBricks(0)
+{
+  // empty volume
+  this->Extent[0] = 0;
+  this->Extent[1] = -1;
+  this->Extent[2] = 0;
+  this->Extent[3] = -1;
+  this->Extent[4] = 0;
+  this->Extent[5] = -1;
+  for (int i = 0; i < 3; i++)
+  {
+    this->Origin[i] = 0.0;
+    this->Spacing[i] = 1.0;
+    this->BrickGridSize[i] = 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkPlusSparseVolume::~vtkPlusSparseVolume()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSparseVolume::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Extent: " << this->Extent[0] << " " << this->Extent[1] << " " << this->Extent[2] << " "
+     << this->Extent[3] << " " << this->Extent[4] << " " << this->Extent[5] << "\n";
+  os << indent << "Origin: " << this->Origin[0] << " " << this->Origin[1] << " " << this->Origin[2] << "\n";
+  os << indent << "Spacing: " << this->Spacing[0] << " " << this->Spacing[1] << " " << this->Spacing[2] << "\n";
+  os << indent << "ScalarType: " << this->ScalarType << "\n";
+  os << indent << "NumberOfScalarComponents: " << this->NumberOfScalarComponents << "\n";
+  os << indent << "BrickSize: " << this->BrickSize << "\n";
+  os << indent << "BrickGridSize: " << this->BrickGridSize[0] << " " << this->BrickGridSize[1] << " " << this->BrickGridSize[2] << "\n";
+  os << indent << "NumberOfAllocatedBricks: " << this->NumberOfAllocatedBricks << "\n";
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSparseVolume::Initialize(const int extent[6], const double origin[3], const double spacing[3], int scalarType, int numberOfScalarComponents)
+{
+  this->ReleaseBricks();
+  this->BrickVolumes.clear();
+  this->BrickAccumulationBuffers.clear();
+  for (int i = 0; i < 3; i++)
+  {
+    this->BrickGridSize[i] = 0;
+  }
+
+  if (extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5])
+  {
+    LOG_ERROR("vtkPlusSparseVolume::Initialize: invalid extent [" << extent[0] << "," << extent[1] << "," << extent[2] << ","
+      << extent[3] << "," << extent[4] << "," << extent[5] << "]");
+    return PLUS_FAIL;
+  }
+  if (numberOfScalarComponents < 1)
+  {
+    LOG_ERROR("vtkPlusSparseVolume::Initialize: invalid number of scalar components: " << numberOfScalarComponents);
+    return PLUS_FAIL;
+  }
+
+  std::copy(extent, extent + 6, this->Extent);
+  std::copy(origin, origin + 3, this->Origin);
+  std::copy(spacing, spacing + 3, this->Spacing);
+  this->ScalarType = scalarType;
+  this->NumberOfScalarComponents = numberOfScalarComponents;
+
+  this->GridBrickSize = this->BrickSize;
+  for (int i = 0; i < 3; i++)
+  {
+    this->BrickGridSize[i] = (this->Extent[2 * i + 1] - this->Extent[2 * i] + this->GridBrickSize) / this->GridBrickSize;
+  }
+  this->BrickVolumes.resize(this->GetNumberOfBricks());
+  this->BrickAccumulationBuffers.resize(this->GetNumberOfBricks());
+
+  this->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSparseVolume::ReleaseBricks()
+{
+  std::fill(this->BrickVolumes.begin(), this->BrickVolumes.end(), vtkSmartPointer<vtkImageData>());
+  std::fill(this->BrickAccumulationBuffers.begin(), this->BrickAccumulationBuffers.end(), vtkSmartPointer<vtkImageData>());
+  this->NumberOfAllocatedBricks = 0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusSparseVolume::GetNumberOfBricks()
+{
+  return this->BrickGridSize[0] * this->BrickGridSize[1] * this->BrickGridSize[2];
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusSparseVolume::GetBrickIndex(int brickI, int brickJ, int brickK)
+{
+  return (brickK * this->BrickGridSize[1] + brickJ) * this->BrickGridSize[0] + brickI;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusSparseVolume::GetBrickRange(const int voxelExtent[6], int brickRange[6])
+{
+  for (int i = 0; i < 3; i++)
+  {
+    int minIndex = std::max(voxelExtent[2 * i], this->Extent[2 * i]);
+    int maxIndex = std::min(voxelExtent[2 * i + 1], this->Extent[2 * i + 1]);
+    if (minIndex > maxIndex)
+    {
+      return false;
+    }
+    brickRange[2 * i] = (minIndex - this->Extent[2 * i]) / this->GridBrickSize;
+    brickRange[2 * i + 1] = (maxIndex - this->Extent[2 * i]) / this->GridBrickSize;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSparseVolume::GetBrickExtent(int brickIndex, int extent[6])
+{
+  int brickPosition[3] =
+  {
+    brickIndex % this->BrickGridSize[0],
+    (brickIndex / this->BrickGridSize[0]) % this->BrickGridSize[1],
+    brickIndex / (this->BrickGridSize[0] * this->BrickGridSize[1])
+  };
+  for (int i = 0; i < 3; i++)
+  {
+    extent[2 * i] = this->Extent[2 * i] + brickPosition[i] * this->GridBrickSize;
+    extent[2 * i + 1] = std::min(extent[2 * i] + this->GridBrickSize - 1, this->Extent[2 * i + 1]);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSparseVolume::GetBrickStorageExtent(int brickIndex, int extent[6])
+{
+  this->GetBrickExtent(brickIndex, extent);
+  for (int i = 0; i < 3; i++)
+  {
+    extent[2 * i] = std::max(extent[2 * i] - 1, this->Extent[2 * i]);
+    extent[2 * i + 1] = std::min(extent[2 * i + 1] + 1, this->Extent[2 * i + 1]);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusSparseVolume::IsBrickAllocated(int brickIndex)
+{
+  return this->BrickVolumes[brickIndex].GetPointer() != NULL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSparseVolume::AllocateBrick(int brickIndex)
+{
+  if (brickIndex < 0 || brickIndex >= this->GetNumberOfBricks())
+  {
+    LOG_ERROR("vtkPlusSparseVolume::AllocateBrick: invalid brick index " << brickIndex);
+    return PLUS_FAIL;
+  }
+  if (this->IsBrickAllocated(brickIndex))
+  {
+    return PLUS_SUCCESS;
+  }
+
+  int storageExtent[6];
+  this->GetBrickStorageExtent(brickIndex, storageExtent);
+  size_t numberOfVoxels = size_t(storageExtent[1] - storageExtent[0] + 1)
+                          * size_t(storageExtent[3] - storageExtent[2] + 1)
+                          * size_t(storageExtent[5] - storageExtent[4] + 1);
+
+  vtkSmartPointer<vtkImageData> volume = vtkSmartPointer<vtkImageData>::New();
+  volume->SetExtent(storageExtent);
+  volume->SetOrigin(this->Origin);
+  volume->SetSpacing(this->Spacing);
+  volume->AllocateScalars(this->ScalarType, this->NumberOfScalarComponents);
+  void* volumePtr = volume->GetScalarPointer();
+
+  vtkSmartPointer<vtkImageData> accumulationBuffer = vtkSmartPointer<vtkImageData>::New();
+  accumulationBuffer->SetExtent(storageExtent);
+  accumulationBuffer->SetOrigin(this->Origin);
+  accumulationBuffer->SetSpacing(this->Spacing);
+  accumulationBuffer->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+  void* accumulationBufferPtr = accumulationBuffer->GetScalarPointer();
+
+  if (volumePtr == NULL || accumulationBufferPtr == NULL)
+  {
+    LOG_ERROR("vtkPlusSparseVolume::AllocateBrick: cannot allocate memory for brick " << brickIndex << " ("
+      << numberOfVoxels << " voxels)");
+    return PLUS_FAIL;
+  }
+  memset(volumePtr, 0, numberOfVoxels * volume->GetScalarSize() * this->NumberOfScalarComponents);
+  memset(accumulationBufferPtr, 0, numberOfVoxels * sizeof(unsigned short));
+
+  this->BrickVolumes[brickIndex] = volume;
+  this->BrickAccumulationBuffers[brickIndex] = accumulationBuffer;
+  this->NumberOfAllocatedBricks++;
+  this->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkPlusSparseVolume::GetBrickVolume(int brickIndex)
+{
+  return this->BrickVolumes[brickIndex];
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkPlusSparseVolume::GetBrickAccumulationBuffer(int brickIndex)
+{
+  return this->BrickAccumulationBuffers[brickIndex];
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusSparseVolume::GetAllocatedBricks(std::vector<int>& brickIndices)
+{
+  brickIndices.clear();
+  brickIndices.reserve(this->NumberOfAllocatedBricks);
+  for (int brickIndex = 0; brickIndex < static_cast<int>(this->BrickVolumes.size()); ++brickIndex)
+  {
+    if (this->IsBrickAllocated(brickIndex))
+    {
+      brickIndices.push_back(brickIndex);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusSparseVolume::GetActualMemorySize()
+{
+  unsigned long memorySizeKiB = 0;
+  for (unsigned int brickIndex = 0; brickIndex < this->BrickVolumes.size(); ++brickIndex)
+  {
+    if (this->BrickVolumes[brickIndex].GetPointer() != NULL)
+    {
+      memorySizeKiB += this->BrickVolumes[brickIndex]->GetActualMemorySize();
+      memorySizeKiB += this->BrickAccumulationBuffers[brickIndex]->GetActualMemorySize();
+    }
+  }
+  return memorySizeKiB;
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusSparseVolume::GetDenseMemorySize()
+{
+  if (this->Extent[0] > this->Extent[1] || this->Extent[2] > this->Extent[3] || this->Extent[4] > this->Extent[5])
+  {
+    return 0;
+  }
+  double numberOfVoxels = double(this->Extent[1] - this->Extent[0] + 1)
+                          * double(this->Extent[3] - this->Extent[2] + 1)
+                          * double(this->Extent[5] - this->Extent[4] + 1);
+  double bytesPerVoxel = vtkDataArray::GetDataTypeSize(this->ScalarType) * this->NumberOfScalarComponents + sizeof(unsigned short);
+  return static_cast<unsigned long>(numberOfVoxels * bytesPerVoxel / 1024.0);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSparseVolume::ExportVolume(vtkImageData* volume)
+{
+  return this->ExportBricks(this->BrickVolumes, volume, this->ScalarType, this->NumberOfScalarComponents);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSparseVolume::ExportAccumulationBuffer(vtkImageData* accumulationBuffer)
+{
+  return this->ExportBricks(this->BrickAccumulationBuffers, accumulationBuffer, VTK_UNSIGNED_SHORT, 1);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSparseVolume::ExportBricks(const std::vector< vtkSmartPointer<vtkImageData> >& bricks, vtkImageData* denseImage, int scalarType, int numberOfScalarComponents)
+{
+  if (denseImage == NULL)
+  {
+    LOG_ERROR("vtkPlusSparseVolume::ExportBricks: invalid output image");
+    return PLUS_FAIL;
+  }
+  if (this->Extent[0] > this->Extent[1] || this->Extent[2] > this->Extent[3] || this->Extent[4] > this->Extent[5])
+  {
+    LOG_ERROR("vtkPlusSparseVolume::ExportBricks: the sparse volume is not initialized");
+    return PLUS_FAIL;
+  }
+
+  denseImage->SetExtent(this->Extent);
+  denseImage->SetOrigin(this->Origin);
+  denseImage->SetSpacing(this->Spacing);
+  denseImage->AllocateScalars(scalarType, numberOfScalarComponents);
+  void* densePtr = denseImage->GetScalarPointer();
+  if (densePtr == NULL)
+  {
+    LOG_ERROR("vtkPlusSparseVolume::ExportBricks: cannot allocate memory for image extent: " << this->Extent[1] - this->Extent[0] + 1
+      << "x" << this->Extent[3] - this->Extent[2] + 1 << "x" << this->Extent[5] - this->Extent[4] + 1);
+    return PLUS_FAIL;
+  }
+  int bytesPerVoxel = denseImage->GetScalarSize() * numberOfScalarComponents;
+  memset(densePtr, 0, size_t(this->Extent[1] - this->Extent[0] + 1)
+         * size_t(this->Extent[3] - this->Extent[2] + 1)
+         * size_t(this->Extent[5] - this->Extent[4] + 1) * bytesPerVoxel);
+
+  // copy the brick voxels (without the halo) row by row
+  for (int brickIndex = 0; brickIndex < static_cast<int>(bricks.size()); ++brickIndex)
+  {
+    vtkImageData* brick = bricks[brickIndex];
+    if (brick == NULL)
+    {
+      continue;
+    }
+    int brickExtent[6];
+    this->GetBrickExtent(brickIndex, brickExtent);
+    size_t rowSizeBytes = size_t(brickExtent[1] - brickExtent[0] + 1) * bytesPerVoxel;
+    for (int z = brickExtent[4]; z <= brickExtent[5]; ++z)
+    {
+      for (int y = brickExtent[2]; y <= brickExtent[3]; ++y)
+      {
+        memcpy(denseImage->GetScalarPointer(brickExtent[0], y, z), brick->GetScalarPointer(brickExtent[0], y, z), rowSizeBytes);
+      }
+    }
+  }
+
+  denseImage->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusSparseVolume::ExtractRegion(const int voxelExtent[6], vtkImageData* volume, vtkImageData* accumulationBuffer)
+{
+  if (volume == NULL || volume->GetScalarPointer() == NULL || accumulationBuffer == NULL || accumulationBuffer->GetScalarPointer() == NULL)
+  {
+    LOG_ERROR("vtkPlusSparseVolume::ExtractRegion: the output images are not allocated");
+    return PLUS_FAIL;
+  }
+  if (volume->GetScalarType() != this->ScalarType || volume->GetNumberOfScalarComponents() != this->NumberOfScalarComponents
+      || accumulationBuffer->GetScalarType() != VTK_UNSIGNED_SHORT || accumulationBuffer->GetNumberOfScalarComponents() != 1)
+  {
+    LOG_ERROR("vtkPlusSparseVolume::ExtractRegion: the scalar type of the output images does not match the sparse volume");
+    return PLUS_FAIL;
+  }
+  int* volumeExtent = volume->GetExtent();
+  int* accumulationBufferExtent = accumulationBuffer->GetExtent();
+  for (int i = 0; i < 3; i++)
+  {
+    int regionSize = voxelExtent[2 * i + 1] - voxelExtent[2 * i];
+    if (volumeExtent[2 * i + 1] - volumeExtent[2 * i] != regionSize || accumulationBufferExtent[2 * i + 1] - accumulationBufferExtent[2 * i] != regionSize)
+    {
+      LOG_ERROR("vtkPlusSparseVolume::ExtractRegion: the dimensions of the output images do not match the region");
+      return PLUS_FAIL;
+    }
+  }
+
+  int bytesPerVoxel = volume->GetScalarSize() * this->NumberOfScalarComponents;
+  size_t numberOfVoxels = size_t(voxelExtent[1] - voxelExtent[0] + 1)
+                          * size_t(voxelExtent[3] - voxelExtent[2] + 1)
+                          * size_t(voxelExtent[5] - voxelExtent[4] + 1);
+  memset(volume->GetScalarPointer(), 0, numberOfVoxels * bytesPerVoxel);
+  memset(accumulationBuffer->GetScalarPointer(), 0, numberOfVoxels * sizeof(unsigned short));
+
+  int brickRange[6];
+  if (!this->GetBrickRange(voxelExtent, brickRange))
+  {
+    // the region is completely outside the volume
+    return PLUS_SUCCESS;
+  }
+
+  // copy the brick voxels (without the halo) that are in the region row by row
+  for (int brickK = brickRange[4]; brickK <= brickRange[5]; ++brickK)
+  {
+    for (int brickJ = brickRange[2]; brickJ <= brickRange[3]; ++brickJ)
+    {
+      for (int brickI = brickRange[0]; brickI <= brickRange[1]; ++brickI)
+      {
+        int brickIndex = this->GetBrickIndex(brickI, brickJ, brickK);
+        if (!this->IsBrickAllocated(brickIndex))
+        {
+          continue;
+        }
+        vtkImageData* brickVolume = this->BrickVolumes[brickIndex];
+        vtkImageData* brickAccumulationBuffer = this->BrickAccumulationBuffers[brickIndex];
+        int copyExtent[6];
+        this->GetBrickExtent(brickIndex, copyExtent);
+        for (int i = 0; i < 3; i++)
+        {
+          copyExtent[2 * i] = std::max(copyExtent[2 * i], voxelExtent[2 * i]);
+          copyExtent[2 * i + 1] = std::min(copyExtent[2 * i + 1], voxelExtent[2 * i + 1]);
+        }
+        int rowLength = copyExtent[1] - copyExtent[0] + 1;
+        for (int z = copyExtent[4]; z <= copyExtent[5]; ++z)
+        {
+          for (int y = copyExtent[2]; y <= copyExtent[3]; ++y)
+          {
+            memcpy(volume->GetScalarPointer(volumeExtent[0] + copyExtent[0] - voxelExtent[0], volumeExtent[2] + y - voxelExtent[2], volumeExtent[4] + z - voxelExtent[4]),
+                   brickVolume->GetScalarPointer(copyExtent[0], y, z), size_t(rowLength) * bytesPerVoxel);
+            memcpy(accumulationBuffer->GetScalarPointer(accumulationBufferExtent[0] + copyExtent[0] - voxelExtent[0], accumulationBufferExtent[2] + y - voxelExtent[2], accumulationBufferExtent[4] + z - voxelExtent[4]),
+                   brickAccumulationBuffer->GetScalarPointer(copyExtent[0], y, z), size_t(rowLength) * sizeof(unsigned short));
+          }
+        }
+      }
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
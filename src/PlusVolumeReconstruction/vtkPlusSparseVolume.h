@@ -0,0 +1,152 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusSparseVolume_h
+#define __vtkPlusSparseVolume_h
+
+#include "PlusConfigure.h"
+#include "vtkPlusVolumeReconstructionExport.h"
+
+#include "vtkImageData.h"
+#include "vtkObject.h"
+#include "vtkSmartPointer.h"
+
+#include <vector>
+
+/*!
+  \class vtkPlusSparseVolume
+  \brief Reconstructed volume and accumulation buffer that only store the regions that contain data
+
+  The volume is divided into cubic bricks of BrickSize voxels. Memory is allocated for a brick only when it is
+  requested (typically when the first slice is pasted into it); all voxels of an unallocated brick are zero.
+  This reduces the memory need of reconstructions where most of the output extent is empty, such as long or
+  curved sweeps.
+
+  Each brick stores its own voxels and a one voxel wide halo around them (clipped to the volume extent)
+  in vtkImageData objects that have the same origin and spacing as the volume. An algorithm that modifies voxels
+  only within one voxel distance from its input (such as slice pasting) can process each brick independently:
+  the voxels of the brick get the same values as in a dense volume, and the halo voxels are ignored.
+
+  A dense image is only created when the volume is exported (ExportVolume, ExportAccumulationBuffer).
+
+  \sa vtkPlusPasteSliceIntoVolume
+  \ingroup PlusLibVolumeReconstruction
+*/
+class vtkPlusVolumeReconstructionExport vtkPlusSparseVolume : public vtkObject
+{
+public:
+  static vtkPlusSparseVolume* New();
+  vtkTypeMacro(vtkPlusSparseVolume, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*!
+    Set the geometry and scalar type of the volume and release all bricks.
+    The accumulation buffer always has one unsigned short component.
+  */
+  PlusStatus Initialize(const int extent[6], const double origin[3], const double spacing[3], int scalarType, int numberOfScalarComponents);
+
+  /*! Release the memory of all bricks (all voxels become zero), the geometry of the volume is kept */
+  void ReleaseBricks();
+
+  vtkGetVector6Macro(Extent, int);
+  vtkGetVector3Macro(Origin, double);
+  vtkGetVector3Macro(Spacing, double);
+  vtkGetMacro(ScalarType, int);
+  vtkGetMacro(NumberOfScalarComponents, int);
+
+  /*! Set the number of voxels along each side of a brick. Applied at the next Initialize call. Default: 32. */
+  vtkSetClampMacro(BrickSize, int, 2, 1024);
+  vtkGetMacro(BrickSize, int);
+
+  /*! Number of bricks along each axis */
+  vtkGetVector3Macro(BrickGridSize, int);
+
+  /*! Total number of bricks (allocated or not) */
+  int GetNumberOfBricks();
+
+  /*! Index of the brick at the given brick grid position */
+  int GetBrickIndex(int brickI, int brickJ, int brickK);
+
+  /*!
+    Get the range of brick grid positions {iMin, iMax, jMin, jMax, kMin, kMax} that contain the voxels
+    of voxelExtent. Returns false if voxelExtent does not intersect the volume extent.
+  */
+  bool GetBrickRange(const int voxelExtent[6], int brickRange[6]);
+
+  /*! Get the extent of the voxels that belong to the brick */
+  void GetBrickExtent(int brickIndex, int extent[6]);
+
+  /*! Get the extent of the voxels that are stored in the brick: its own voxels and a one voxel wide halo */
+  void GetBrickStorageExtent(int brickIndex, int extent[6]);
+
+  /*! Returns true if memory is allocated for the brick */
+  bool IsBrickAllocated(int brickIndex);
+
+  /*!
+    Allocate memory for the brick and set its voxels to zero. Nothing is done if the brick is already allocated.
+    Must not be called concurrently with other methods of this class.
+  */
+  PlusStatus AllocateBrick(int brickIndex);
+
+  /*! Get the volume voxels of the brick (extent: brick storage extent). Returns NULL if the brick is not allocated. */
+  vtkImageData* GetBrickVolume(int brickIndex);
+
+  /*! Get the accumulation buffer voxels of the brick (extent: brick storage extent). Returns NULL if the brick is not allocated. */
+  vtkImageData* GetBrickAccumulationBuffer(int brickIndex);
+
+  /*! Get the indices of the allocated bricks, in increasing order */
+  void GetAllocatedBricks(std::vector<int>& brickIndices);
+
+  vtkGetMacro(NumberOfAllocatedBricks, int);
+
+  /*! Memory used by the allocated bricks, in kibibytes */
+  unsigned long GetActualMemorySize();
+
+  /*! Memory that a dense volume and accumulation buffer of the same extent would use, in kibibytes */
+  unsigned long GetDenseMemorySize();
+
+  /*! Copy the volume into a dense image of the full extent. Voxels of unallocated bricks are set to zero. */
+  PlusStatus ExportVolume(vtkImageData* volume);
+
+  /*! Copy the accumulation buffer into a dense image of the full extent. Voxels of unallocated bricks are set to zero. */
+  PlusStatus ExportAccumulationBuffer(vtkImageData* accumulationBuffer);
+
+  /*!
+    Copy the volume and accumulation buffer voxels of voxelExtent into allocated images that have the same dimensions as voxelExtent.
+    The extent of the images may start at a different index (e.g., at 0). Voxels of unallocated bricks and voxels outside
+    the volume extent are set to zero.
+  */
+  PlusStatus ExtractRegion(const int voxelExtent[6], vtkImageData* volume, vtkImageData* accumulationBuffer);
+
+protected:
+  vtkPlusSparseVolume();
+  virtual ~vtkPlusSparseVolume();
+
+  /*! Allocate a dense image of the full extent, set its voxels to zero, and copy the voxels of the bricks into it */
+  PlusStatus ExportBricks(const std::vector< vtkSmartPointer<vtkImageData> >& bricks, vtkImageData* denseImage, int scalarType, int numberOfScalarComponents);
+
+  int Extent[6];
+  double Origin[3];
+  double Spacing[3];
+  int ScalarType;
+  int NumberOfScalarComponents;
+
+  int BrickSize;
+  /*! Brick size used by the current brick grid (BrickSize may be changed after Initialize) */
+  int GridBrickSize;
+  int BrickGridSize[3];
+
+  /*! Volume and accumulation buffer voxels of each brick, NULL for unallocated bricks */
+  std::vector< vtkSmartPointer<vtkImageData> > BrickVolumes;
+  std::vector< vtkSmartPointer<vtkImageData> > BrickAccumulationBuffers;
+  int NumberOfAllocatedBricks;
+
+private:
+  vtkPlusSparseVolume(const vtkPlusSparseVolume&);  // Not implemented.
+  void operator=(const vtkPlusSparseVolume&);  // Not implemented.
+};
+
+#endif
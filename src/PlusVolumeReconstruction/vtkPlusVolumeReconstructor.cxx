@@ -9,6 +9,7 @@
 #include "PlusTrackedFrame.h"
 #include "vtkPlusFanAngleDetectorAlgo.h"
 #include "vtkPlusFillHolesInVolume.h"
+#include "vtkPlusSparseVolume.h"
 #include "vtkPlusTrackedFrameList.h"
 #include "vtkPlusTransformRepository.h"
 #include "vtkPlusVolumeReconstructor.h"
@@ -36,6 +37,12 @@
 
 vtkStandardNewMacro(vtkPlusVolumeReconstructor);
 
+namespace
+{
+  /*! Maximum number of frames that AddTrackedFrames pastes into the volume at once */
+  const unsigned int MAX_NUMBER_OF_FRAMES_PER_BATCH = 256;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusVolumeReconstructor::vtkPlusVolumeReconstructor()
   : ReconstructedVolume(vtkSmartPointer<vtkImageData>::New())
@@ -46,6 +53,7 @@ vtkPlusVolumeReconstructor::vtkPlusVolumeReconstructor()
   , EnableFanAnglesAutoDetect(false)
   , SkipInterval(1)
   , ReconstructedVolumeUpdatedTime(0)
+  , ReconstructedVolumeIsHoleFilled(false)
 {
   this->FanAnglesDeg[0] = 0.0;
   this->FanAnglesDeg[1] = 0.0;
@@ -134,6 +142,10 @@ PlusStatus vtkPlusVolumeReconstructor::ReadConfiguration(vtkXMLDataElement* conf
 
   XML_READ_ENUM2_ATTRIBUTE_OPTIONAL(FillHoles, reconConfig, "ON", true, "OFF", false);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableFanAnglesAutoDetect, reconConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SparseOutput, reconConfig);
+
+  // hole filling parameters may change, the whole volume has to be filled again
+  this->ReconstructedVolumeIsHoleFilled = false;
 
   // Find and read kernels. First for loop counts the number of kernels to allocate, second for loop stores them
   if (this->FillHoles)
@@ -251,6 +263,8 @@ PlusStatus vtkPlusVolumeReconstructor::WriteConfiguration(vtkXMLDataElement* con
     XML_REMOVE_ATTRIBUTE(reconConfig, "NumberOfThreads");
   }
 
+  XML_WRITE_BOOL_ATTRIBUTE(SparseOutput, reconConfig);
+
   XML_WRITE_STRING_ATTRIBUTE_REMOVE_IF_EMPTY(ImportanceMaskFilename, reconConfig);
 
   if (this->Reconstructor->IsPixelRejectionEnabled())
@@ -524,6 +538,139 @@ PlusStatus vtkPlusVolumeReconstructor::AddTrackedFrame(PlusTrackedFrame* frame,
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::AddTrackedFrames(vtkPlusTrackedFrameList* trackedFrameList, vtkPlusTransformRepository* transformRepository, int* numberOfFramesAddedToVolume/*=NULL*/)
+{
+  if (numberOfFramesAddedToVolume != NULL)
+  {
+    *numberOfFramesAddedToVolume = 0;
+  }
+
+  PlusTransformName imageToReferenceTransformName;
+  if (GetImageToReferenceTransformName(imageToReferenceTransformName) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Invalid ImageToReference transform name");
+    return PLUS_FAIL;
+  }
+
+  if (trackedFrameList == NULL)
+  {
+    LOG_ERROR("Failed to add tracked frames to volume - input frame list is NULL");
+    return PLUS_FAIL;
+  }
+
+  if (transformRepository == NULL)
+  {
+    LOG_ERROR("Failed to add tracked frames to volume - input transform repository is NULL");
+    return PLUS_FAIL;
+  }
+
+  if (this->Reconstructor->GetCompoundingMode() == vtkPlusPasteSliceIntoVolume::IMPORTANCE_MASK_COMPOUNDING_MODE)
+  {
+    if (UpdateImportanceMask() == PLUS_FAIL)
+    {
+      LOG_ERROR("Failed to get importance mask");
+      return PLUS_FAIL;
+    }
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  std::vector<vtkImageData*> frameImages;
+  std::vector< vtkSmartPointer<vtkMatrix4x4> > imageToReferenceTransforms;
+  const int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
+  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += this->SkipInterval)
+  {
+    PlusTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+    if (transformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to update transform repository with frame #" << frameIndex);
+      status = PLUS_FAIL;
+      continue;
+    }
+
+    bool isMatrixValid(false);
+    vtkSmartPointer<vtkMatrix4x4> imageToReferenceTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    if (transformRepository->GetTransform(imageToReferenceTransformName, imageToReferenceTransformMatrix, &isMatrixValid) != PLUS_SUCCESS)
+    {
+      std::string strImageToReferenceTransformName;
+      imageToReferenceTransformName.GetTransformName(strImageToReferenceTransformName);
+      LOG_ERROR("Failed to get transform '" << strImageToReferenceTransformName << "' from transform repository with frame #" << frameIndex);
+      status = PLUS_FAIL;
+      continue;
+    }
+    if (!isMatrixValid)
+    {
+      // Insert only valid frame into volume
+      LOG_DEBUG("Transform is invalid for frame #" << frameIndex << ", therefore this frame is not be inserted into the volume");
+      continue;
+    }
+    if (numberOfFramesAddedToVolume != NULL)
+    {
+      (*numberOfFramesAddedToVolume)++;
+    }
+
+    // Frames are pasted with the fan angles that are set when they are inserted, so if the fan angles
+    // are changed (e.g., because they are detected from each image) then the collected frames are pasted first
+    double previousFanAnglesDeg[2] = { this->Reconstructor->GetFanAnglesDeg()[0], this->Reconstructor->GetFanAnglesDeg()[1] };
+    vtkImageData* frameImage = frame->GetImageData()->GetImage();
+    bool isImageEmpty = false;
+    UpdateFanAnglesFromImage(frameImage, isImageEmpty);
+    if (isImageEmpty)
+    {
+      // nothing to insert, image is empty
+      this->Reconstructor->SetFanAnglesDeg(previousFanAnglesDeg);
+      continue;
+    }
+    double* fanAnglesDeg = this->Reconstructor->GetFanAnglesDeg();
+    if (!frameImages.empty() && (fanAnglesDeg[0] != previousFanAnglesDeg[0] || fanAnglesDeg[1] != previousFanAnglesDeg[1]))
+    {
+      double currentFanAnglesDeg[2] = { fanAnglesDeg[0], fanAnglesDeg[1] };
+      this->Reconstructor->SetFanAnglesDeg(previousFanAnglesDeg);
+      if (InsertFrameBatch(frameImages, imageToReferenceTransforms) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+      this->Reconstructor->SetFanAnglesDeg(currentFanAnglesDeg);
+    }
+
+    frameImages.push_back(frameImage);
+    imageToReferenceTransforms.push_back(imageToReferenceTransformMatrix);
+    if (frameImages.size() >= MAX_NUMBER_OF_FRAMES_PER_BATCH)
+    {
+      if (InsertFrameBatch(frameImages, imageToReferenceTransforms) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+    }
+  }
+
+  if (InsertFrameBatch(frameImages, imageToReferenceTransforms) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+
+  this->Modified();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVolumeReconstructor::InsertFrameBatch(std::vector<vtkImageData*>& frameImages, std::vector< vtkSmartPointer<vtkMatrix4x4> >& imageToReferenceTransforms)
+{
+  if (frameImages.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+  std::vector<vtkMatrix4x4*> transforms;
+  for (std::vector< vtkSmartPointer<vtkMatrix4x4> >::iterator transformIt = imageToReferenceTransforms.begin(); transformIt != imageToReferenceTransforms.end(); ++transformIt)
+  {
+    transforms.push_back(*transformIt);
+  }
+  PlusStatus status = this->Reconstructor->InsertSlices(frameImages, transforms);
+  frameImages.clear();
+  imageToReferenceTransforms.clear();
+  return status;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVolumeReconstructor::UpdateReconstructedVolume()
 {
@@ -546,9 +693,24 @@ PlusStatus vtkPlusVolumeReconstructor::UpdateReconstructedVolume()
   }
   else
   {
-    this->ReconstructedVolume->DeepCopy(this->Reconstructor->GetReconstructedVolume());
+    this->ReconstructedVolumeIsHoleFilled = false;
+    if (this->Reconstructor->GetOutputIsSparse())
+    {
+      // export directly, to avoid keeping a dense copy of the volume in the reconstructor as well
+      if (this->Reconstructor->GetSparseVolume()->ExportVolume(this->ReconstructedVolume) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to export the sparse reconstructed volume!");
+        return PLUS_FAIL;
+      }
+    }
+    else
+    {
+      this->ReconstructedVolume->DeepCopy(this->Reconstructor->GetReconstructedVolume());
+    }
   }
 
+  // the next hole filling only has to process the regions that are modified from now on
+  this->Reconstructor->ClearModifiedBricks();
   this->ReconstructedVolumeUpdatedTime = this->GetMTime();
 
   return PLUS_SUCCESS;
@@ -572,12 +734,50 @@ PlusStatus vtkPlusVolumeReconstructor::GetReconstructedVolume(vtkImageData* volu
 PlusStatus vtkPlusVolumeReconstructor::GenerateHoleFilledVolume()
 {
   LOG_INFO("Hole Filling has begun");
+  std::vector<int> modifiedBricks;
+  if (this->ReconstructedVolumeIsHoleFilled && this->Reconstructor->GetModifiedBricks(modifiedBricks))
+  {
+    // ReconstructedVolume contains the result of the previous hole filling, only the surroundings of the modified regions are filled again
+    this->ReconstructedVolumeIsHoleFilled = false;
+    PlusStatus status = PLUS_FAIL;
+    if (this->Reconstructor->GetOutputIsSparse())
+    {
+      status = this->HoleFiller->UpdateHoleFilledVolume(this->Reconstructor->GetSparseVolume(), modifiedBricks, this->ReconstructedVolume);
+    }
+    else
+    {
+      status = this->HoleFiller->UpdateHoleFilledVolume(this->Reconstructor->GetReconstructedVolume(), this->Reconstructor->GetAccumulationBuffer(),
+               this->Reconstructor->GetSparseVolume(), modifiedBricks, this->ReconstructedVolume);
+    }
+    if (status != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to update the hole filled volume");
+      return PLUS_FAIL;
+    }
+    this->ReconstructedVolumeIsHoleFilled = true;
+    LOG_INFO("Hole Filling has finished");
+    return PLUS_SUCCESS;
+  }
+
+  this->ReconstructedVolumeIsHoleFilled = false;
+  if (this->Reconstructor->GetOutputIsSparse())
+  {
+    if (this->HoleFiller->FillHolesInSparseVolume(this->Reconstructor->GetSparseVolume(), this->ReconstructedVolume) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to fill holes in the sparse reconstructed volume");
+      return PLUS_FAIL;
+    }
+    this->ReconstructedVolumeIsHoleFilled = true;
+    LOG_INFO("Hole Filling has finished");
+    return PLUS_SUCCESS;
+  }
   this->HoleFiller->SetReconstructedVolume(this->Reconstructor->GetReconstructedVolume());
   this->HoleFiller->SetAccumulationBuffer(this->Reconstructor->GetAccumulationBuffer());
   this->HoleFiller->Update();
   LOG_INFO("Hole Filling has finished");
 
   this->ReconstructedVolume->DeepCopy(HoleFiller->GetOutput());
+  this->ReconstructedVolumeIsHoleFilled = true;
 
   return PLUS_SUCCESS;
 }
@@ -614,7 +814,20 @@ PlusStatus vtkPlusVolumeReconstructor::ExtractAccumulation(vtkImageData* accumul
   vtkSmartPointer<vtkImageExtractComponents> extract = vtkSmartPointer<vtkImageExtractComponents>::New();
 
   extract->SetComponents(0);
-  extract->SetInputData(this->Reconstructor->GetAccumulationBuffer());
+  if (this->Reconstructor->GetOutputIsSparse())
+  {
+    vtkSmartPointer<vtkImageData> denseAccumulationBuffer = vtkSmartPointer<vtkImageData>::New();
+    if (this->Reconstructor->GetSparseVolume()->ExportAccumulationBuffer(denseAccumulationBuffer) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to export the sparse accumulation buffer");
+      return PLUS_FAIL;
+    }
+    extract->SetInputData(denseAccumulationBuffer);
+  }
+  else
+  {
+    extract->SetInputData(this->Reconstructor->GetAccumulationBuffer());
+  }
   extract->Update();
 
   accumulationBuffer->DeepCopy(extract->GetOutput());
@@ -751,6 +964,24 @@ void vtkPlusVolumeReconstructor::SetOutputExtent(int* extent)
   this->Reconstructor->SetOutputExtent(extent);
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusVolumeReconstructor::SetSparseOutput(bool sparseOutput)
+{
+  this->Reconstructor->SetSparseOutput(sparseOutput);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusVolumeReconstructor::GetSparseOutput()
+{
+  return this->Reconstructor->GetSparseOutput();
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusVolumeReconstructor::GetReconstructionMemorySize()
+{
+  return this->Reconstructor->GetOutputMemorySize();
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusVolumeReconstructor::SetNumberOfThreads(int numberOfThreads)
 {
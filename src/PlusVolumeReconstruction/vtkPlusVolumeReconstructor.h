@@ -73,6 +73,15 @@ public:
   */
   virtual PlusStatus AddTrackedFrame(PlusTrackedFrame* frame, vtkPlusTransformRepository* transformRepository, bool* insertedIntoVolume = NULL);
 
+  /*!
+    Inserts every SkipInterval-th frame of the list into the volume. The transform repository is updated with
+    the transforms of each frame. The result is the same as adding the frames one by one using AddTrackedFrame,
+    but multiple frames are pasted at once (see vtkPlusPasteSliceIntoVolume::InsertSlices), which is much faster
+    for long sequences of small frames.
+    \param numberOfFramesAddedToVolume Number of frames that had a valid ImageToReference transform
+  */
+  virtual PlusStatus AddTrackedFrames(vtkPlusTrackedFrameList* trackedFrameList, vtkPlusTransformRepository* transformRepository, int* numberOfFramesAddedToVolume = NULL);
+
   /*!
     Makes the reconstructed volume ready to be retrieved.
     The slices are pasted into the volume immediately, but hole filling is performed only when this method is called.
@@ -82,7 +91,10 @@ public:
   /*! Load the reconstructed volume into the volume pointer */
   virtual PlusStatus GetReconstructedVolume(vtkImageData* volume);
 
-  /*! Apply hole filling to the reconstructed image, is called by UpdateReconstructedVolume so an explicit call is not needed */
+  /*!
+    Apply hole filling to the reconstructed image, is called by UpdateReconstructedVolume so an explicit call is not needed.
+    If the volume was already hole filled then only the regions around the slices that were pasted since then are filled again.
+  */
   virtual PlusStatus GenerateHoleFilledVolume();
 
   /*! Returns the reconstructed volume gray levels from the provided volume */
@@ -174,6 +186,16 @@ public:
   vtkSetMacro(FillHoles, bool);
   vtkGetMacro(FillHoles, bool);
 
+  /*!
+    Store the reconstructed volume in bricks that are only allocated where frames are pasted
+    (see vtkPlusPasteSliceIntoVolume::SetSparseOutput). The dense volume is only created when the result is requested.
+  */
+  void SetSparseOutput(bool sparseOutput);
+  bool GetSparseOutput();
+
+  /*! Memory used for storing the reconstructed volume and accumulation buffer while frames are added, in kibibytes */
+  unsigned long GetReconstructionMemorySize();
+
   bool FanClippingApplied();
 
   double* GetFanOrigin();
@@ -211,6 +233,9 @@ protected:
   /*! Construct ImageToReference transform name from the image and reference coordinate frame member variables */
   PlusStatus GetImageToReferenceTransformName(PlusTransformName& imageToReferenceTransformName);
 
+  /*! Paste the collected frames into the volume and clear the lists */
+  PlusStatus InsertFrameBatch(std::vector<vtkImageData*>& frameImages, std::vector< vtkSmartPointer<vtkMatrix4x4> >& imageToReferenceTransforms);
+
 protected:
   vtkPlusPasteSliceIntoVolume* Reconstructor;
   vtkPlusFillHolesInVolume* HoleFiller;
@@ -240,6 +265,12 @@ protected:
   /*! Modified time when reconstructing. This is used to determine whether re-reconstruction is necessary */
   vtkMTimeType ReconstructedVolumeUpdatedTime;
 
+  /*!
+    True if ReconstructedVolume contains the hole filled volume that was computed at ReconstructedVolumeUpdatedTime.
+    Then only the regions modified since then have to be filled again.
+  */
+  bool ReconstructedVolumeIsHoleFilled;
+
   /*!
     If EnableFanAnglesAutoDetect is enabled then actually used fan angles will be computed from each frame (these angles define the maximum range.
     If EnableFanAnglesAutoDetect is disabled then these values will be used as fan angles.